@@ -0,0 +1,30 @@
+include_guard(GLOBAL)
+
+set(XBROWSER_PSL_FILE "${CMAKE_SOURCE_DIR}/third_party/publicsuffix/public_suffix_list.dat" CACHE FILEPATH
+  "Public Suffix List compiled into the eTLD+1 table")
+
+# Builds tools/psl_compile for the host, runs it over XBROWSER_PSL_FILE and
+# makes the generated PublicSuffixTable.inc visible to target_name.
+function(xbrowser_add_public_suffix_table target_name)
+  set(_out_dir "${CMAKE_BINARY_DIR}/generated/psl")
+  set(_out "${_out_dir}/PublicSuffixTable.inc")
+
+  if(NOT TARGET xbrowser_psl_table)
+    add_executable(xbrowser_psl_compile "${CMAKE_SOURCE_DIR}/tools/psl_compile.cpp")
+    target_include_directories(xbrowser_psl_compile PRIVATE "${CMAKE_SOURCE_DIR}/src")
+    set_target_properties(xbrowser_psl_compile PROPERTIES AUTOMOC OFF AUTORCC OFF AUTOUIC OFF)
+
+    file(MAKE_DIRECTORY "${_out_dir}")
+    add_custom_command(
+      OUTPUT "${_out}"
+      COMMAND xbrowser_psl_compile "${XBROWSER_PSL_FILE}" "${_out}"
+      DEPENDS xbrowser_psl_compile "${XBROWSER_PSL_FILE}" "${CMAKE_SOURCE_DIR}/src/core/PublicSuffixHash.h"
+      COMMENT "Compiling public suffix table"
+      VERBATIM
+    )
+    add_custom_target(xbrowser_psl_table DEPENDS "${_out}")
+  endif()
+
+  add_dependencies(${target_name} xbrowser_psl_table)
+  target_include_directories(${target_name} PRIVATE "${_out_dir}")
+endfunction()
@@ -8,9 +8,12 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QGuiApplication>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QPointer>
 #include <QQmlApplicationEngine>
+#include <QQmlComponent>
 #include <QQmlContext>
 #include <QQmlError>
 #include <QQuickStyle>
@@ -19,14 +22,18 @@
 #include <QTemporaryDir>
 #include <QTextStream>
 #include <QUrlQuery>
+#include <QWindow>
 #include <memory>
 
 #include "../core/AppPaths.h"
 #include "../core/ProfileLock.h"
 #include "../core/BrowserController.h"
+#include "../core/BrowsingDataCleaner.h"
 #include "../core/BookmarksFilterModel.h"
 #include "../core/BookmarksStore.h"
 #include "../core/CommandBus.h"
+#include "../core/ContentBlocker.h"
+#include "../core/CookieModel.h"
 #include "../core/DiagnosticsController.h"
 #include "../core/DownloadFilterModel.h"
 #include "../core/DownloadModel.h"
@@ -34,14 +41,20 @@
 #include "../core/ExtensionsFilterModel.h"
 #include "../core/FaviconCache.h"
 #include "../core/HistoryFilterModel.h"
+#include "../core/HistoryImporter.h"
 #include "../core/HistoryStore.h"
+#include "../core/HostPreresolver.h"
+#include "../core/HistoryTextIndex.h"
+#include "../core/InstanceBroker.h"
 #include "../core/LayoutController.h"
 #include "../core/ModsModel.h"
+#include "../core/NavigationPredictor.h"
 #include "../core/NotificationCenter.h"
 #include "../core/OmniboxUtils.h"
 #include "../core/QuickLinksModel.h"
 #include "../core/WebPanelsStore.h"
 #include "../core/ShortcutStore.h"
+#include "../core/SegmentedDownloader.h"
 #include "../core/SessionStore.h"
 #include "../core/SitePermissionsStore.h"
 #include "../core/SplitViewController.h"
@@ -50,9 +63,13 @@
 #include "../core/ThemeController.h"
 #include "../core/ThemePackModel.h"
 #include "../core/ToastController.h"
+#include "../core/TopSitesModel.h"
+#include "../core/UrlCompletionIndex.h"
+#include "../core/UserDataStorage.h"
+#include "../core/WindowManager.h"
 #include "../core/SourceViewerHelper.h"
 #include "../engine/webview2/BrowserExtensionsModel.h"
-#include "../engine/webview2/WebView2CookieModel.h"
+#include "../engine/webview2/WebView2CookieSource.h"
 #include "../engine/webview2/WebView2View.h"
 #include "../platform/windows/NativeUtils.h"
 #include "../platform/windows/WindowsShareController.h"
@@ -159,6 +176,7 @@ struct LaunchOptions
   QString profileId;
   QStringList startupUrls;
   bool incognito = false;
+  bool newWindow = false;
 };
 
 QString sanitizeProfileId(const QString& rawId)
@@ -197,18 +215,35 @@ LaunchOptions parseLaunchOptions(QCoreApplication& app)
     QStringLiteral("url"),
     QStringLiteral("Open a URL on startup (may be repeated)."),
     QStringLiteral("url"));
+  QCommandLineOption newWindowOpt(
+    QStringLiteral("new-window"),
+    QStringLiteral("Open the URLs in a new window of the running instance."));
 
   parser.addOption(dataDirOpt);
   parser.addOption(profileOpt);
   parser.addOption(incognitoOpt);
   parser.addOption(urlOpt);
+  parser.addOption(newWindowOpt);
+  parser.addPositionalArgument(QStringLiteral("urls"), QStringLiteral("URLs or files to open."), QStringLiteral("[urls...]"));
   parser.process(app);
 
   LaunchOptions opts;
   opts.dataDir = parser.value(dataDirOpt).trimmed();
   opts.profileId = sanitizeProfileId(parser.value(profileOpt));
-  opts.startupUrls = parser.values(urlOpt);
   opts.incognito = parser.isSet(incognitoOpt);
+  opts.newWindow = parser.isSet(newWindowOpt);
+
+  // Resolved here: a forwarded launch is handled by a process with another
+  // working directory.
+  const QStringList rawUrls = parser.values(urlOpt) + parser.positionalArguments();
+  for (const QString& rawUrl : rawUrls) {
+    const QString trimmed = rawUrl.trimmed();
+    if (trimmed.isEmpty()) {
+      continue;
+    }
+    const QUrl url = QUrl::fromUserInput(trimmed, QDir::currentPath());
+    opts.startupUrls.push_back((url.isValid() ? url : QUrl("about:blank")).toString(QUrl::FullyEncoded));
+  }
   return opts;
 }
 
@@ -316,6 +351,9 @@ int main(int argc, char* argv[])
 
     qputenv("XBROWSER_DATA_DIR", incognitoDir->path().toUtf8());
     qputenv("XBROWSER_INCOGNITO", "1");
+    // History, bookmarks, downloads, session, favicons and permissions stay
+    // in memory; the temp dir is left to the web engine's own profile.
+    xbrowser::setUserDataStorage(std::make_unique<xbrowser::MemoryUserDataStorage>());
   } else if (!launchOptions.dataDir.isEmpty()) {
     const QString dir = QDir(launchOptions.dataDir).absolutePath();
     QDir().mkpath(dir);
@@ -329,20 +367,38 @@ int main(int argc, char* argv[])
   }
 
   std::unique_ptr<xbrowser::ProfileLock> profileLock;
+  std::unique_ptr<InstanceBroker> instanceBroker;
+  QString instanceBrokerError;
   if (!launchOptions.incognito) {
     QString lockError;
     const QString dataDir = xbrowser::appDataRoot();
     profileLock = xbrowser::tryAcquireProfileLock(dataDir, &lockError);
     if (!profileLock) {
+      // Another instance owns the profile: hand it our URLs and get out of
+      // the way. It is allowed to take focus on our behalf.
+      InstanceBroker::Request request;
+      request.urls = launchOptions.startupUrls;
+      request.newWindow = launchOptions.newWindow;
+      AllowSetForegroundWindow(ASFW_ANY);
+      if (InstanceBroker::forward(dataDir, request)) {
+        return 0;
+      }
+
       const QString message =
         QStringLiteral("Another XBrowser instance is already using this profile.\n\n%1\n\nTip: start a separate instance with --profile <id> or --incognito.")
           .arg(lockError.isEmpty() ? QDir::toNativeSeparators(dataDir) : lockError);
       showFatalMessage(message);
       return 1;
     }
+
+    instanceBroker = std::make_unique<InstanceBroker>(dataDir);
+    instanceBroker->listen(&instanceBrokerError);
   }
 
   installLogging();
+  if (instanceBroker && !instanceBroker->isListening()) {
+    qWarning().noquote() << "Single-instance broker unavailable:" << instanceBrokerError;
+  }
 
   QQuickStyle::setStyle("Material");
 
@@ -353,15 +409,42 @@ int main(int argc, char* argv[])
     "BrowserController",
     "BrowserController is provided as a singleton instance");
   qmlRegisterType<WebView2View>("XBrowser", 1, 0, "WebView2View");
-  qmlRegisterType<WebView2CookieModel>("XBrowser", 1, 0, "WebView2CookieModel");
+  qmlRegisterUncreatableType<CookieSource>("XBrowser", 1, 0, "CookieSource", "CookieSource is abstract");
+  qmlRegisterType<WebView2CookieSource>("XBrowser", 1, 0, "WebView2CookieSource");
+  qmlRegisterType<CookieModel>("XBrowser", 1, 0, "CookieModel");
+  qmlRegisterUncreatableType<BrowsingDataCleaner>(
+    "XBrowser",
+    1,
+    0,
+    "BrowsingDataCleaner",
+    "BrowsingDataCleaner is exposed as browsingDataCleaner");
+  qmlRegisterUncreatableType<SegmentedDownloader>(
+    "XBrowser",
+    1,
+    0,
+    "SegmentedDownloader",
+    "SegmentedDownloader is exposed as segmentedDownloads");
+  qmlRegisterUncreatableType<TopSitesModel>("XBrowser", 1, 0, "TopSitesModel", "TopSitesModel is exposed as topSites");
   qmlRegisterType<WindowChromeController>("XBrowser", 1, 0, "WindowChromeController");
   qmlRegisterUncreatableType<TabModel>("XBrowser", 1, 0, "TabModel", "TabModel is exposed via BrowserController.tabs");
+  qmlRegisterUncreatableType<GlobalTabIndex>(
+    "XBrowser",
+    1,
+    0,
+    "GlobalTabIndex",
+    "GlobalTabIndex is exposed via BrowserController.tabIndex");
   qmlRegisterUncreatableType<TabGroupModel>(
     "XBrowser",
     1,
     0,
     "TabGroupModel",
     "TabGroupModel is exposed via BrowserController.tabGroups");
+  qmlRegisterUncreatableType<SplitViewController>(
+    "XBrowser",
+    1,
+    0,
+    "SplitViewController",
+    "SplitViewController is provided per window as splitView");
   qmlRegisterType<TabFilterModel>("XBrowser", 1, 0, "TabFilterModel");
   qmlRegisterType<TabSwitcherModel>("XBrowser", 1, 0, "TabSwitcherModel");
   qmlRegisterType<BookmarksFilterModel>("XBrowser", 1, 0, "BookmarksFilterModel");
@@ -369,9 +452,8 @@ int main(int argc, char* argv[])
   qmlRegisterType<ExtensionsFilterModel>("XBrowser", 1, 0, "ExtensionsFilterModel");
   qmlRegisterType<HistoryFilterModel>("XBrowser", 1, 0, "HistoryFilterModel");
 
-  BrowserController browser;
-  LayoutController layoutController;
-  layoutController.setSettings(browser.settings());
+  WindowManager windows;
+  windows.createWindow();
   OmniboxUtils omniboxUtils;
   FaviconCache favicons;
   CommandBus commands;
@@ -383,149 +465,171 @@ int main(int argc, char* argv[])
   DownloadModel downloads;
   BookmarksStore bookmarks;
   HistoryStore history;
+  {
+    AppSettings* settings = windows.settings();
+    const auto applyRetention = [&history, settings] {
+      history.setDetailDays(settings->historyDetailDays());
+      history.setRetentionDays(settings->historyRetentionDays());
+    };
+    applyRetention();
+    QObject::connect(settings, &AppSettings::historyDetailDaysChanged, &history, applyRetention);
+    QObject::connect(settings, &AppSettings::historyRetentionDaysChanged, &history, applyRetention);
+  }
+  UrlCompletionIndex urlCompletion;
+  urlCompletion.setHistory(&history);
+  urlCompletion.setBookmarks(&bookmarks);
+  NavigationPredictor navigationPredictor;
+  navigationPredictor.setHistory(&history);
+  HostPreresolver hostPreresolver;
+  HistoryTextIndex historyText;
+  historyText.setHistory(&history);
+  HistoryImporter historyImporter;
+  historyImporter.setHistory(&history);
+  QObject::connect(&historyImporter, &HistoryImporter::finished, &toast, [&toast](int imported, const QString& error) {
+    if (!error.isEmpty() && imported == 0) {
+      toast.showToast(QStringLiteral("History import failed: %1").arg(error));
+      return;
+    }
+    toast.showToast(QStringLiteral("Imported %1 history visits").arg(imported));
+  });
   SourceViewerHelper sourceViewer;
   WebPanelsStore webPanels;
   ModsModel mods;
   ThemeController theme;
-  theme.setWorkspaces(browser.workspaces());
-  theme.setSettings(browser.settings());
+  theme.setSettings(windows.settings());
   ThemePackModel themes;
   theme.setThemePacks(&themes);
   QuickLinksModel quickLinks;
-  quickLinks.setWorkspaces(browser.workspaces());
-  SplitViewController splitView;
-  splitView.setBrowser(&browser);
+  TopSitesModel topSites;
+  topSites.setFavicons(&favicons);
+  topSites.setHistory(&history);
   BrowserExtensionsModel extensions;
   DiagnosticsController diagnostics;
   SitePermissionsStore& sitePermissions = SitePermissionsStore::instance();
+  BrowsingDataCleaner dataCleaner;
+  dataCleaner.setHistory(&history);
+  dataCleaner.setDownloads(&downloads);
+  dataCleaner.setFavicons(&favicons);
+  dataCleaner.setSitePermissions(&sitePermissions);
+  SegmentedDownloader segmentedDownloads;
+  segmentedDownloads.setDownloads(&downloads);
+  segmentedDownloads.restorePending();
+  ContentBlocker::instance().reloadAsync();
   SessionStore session;
-  session.attach(&browser, &splitView);
-
-  if (!launchOptions.startupUrls.isEmpty()) {
-    for (const QString& rawUrl : launchOptions.startupUrls) {
-      const QString trimmed = rawUrl.trimmed();
-      if (trimmed.isEmpty()) {
-        continue;
-      }
+  session.attach(&windows);
 
-      const QUrl url = QUrl::fromUserInput(trimmed);
-      browser.newTab(url.isValid() ? url : QUrl("about:blank"));
+  // Theme and quick links follow the workspaces of the focused window.
+  auto followActiveWindow = [&windows, &theme, &quickLinks] {
+    if (BrowserController* active = windows.activeBrowser()) {
+      theme.setWorkspaces(active->workspaces());
+      quickLinks.setWorkspaces(active->workspaces());
     }
+  };
+  followActiveWindow();
+  QObject::connect(&windows, &WindowManager::activeWindowChanged, &theme, followActiveWindow);
+
+  for (const QString& url : launchOptions.startupUrls) {
+    windows.activeBrowser()->newTab(QUrl(url));
   }
 
   QObject::connect(&toast, &ToastController::actionRequested, &commands, [&commands](const QString& commandId) {
     commands.invoke(commandId);
   });
 
-  QObject::connect(
-    &commands,
-    &CommandBus::commandInvoked,
-    &browser,
-    [&browser, &splitView, &toast, &shareController](const QString& id, const QVariantMap& args) {
-    if (id == "new-window") {
-      const QString profileId =
-        QStringLiteral("window-%1").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz")));
-      const bool ok = QProcess::startDetached(
-        QCoreApplication::applicationFilePath(),
-        QStringList { QStringLiteral("--profile"), profileId });
-      if (!ok) {
-        toast.showToast(QStringLiteral("Failed to open new window"));
+  // Commands that run in C++ resolve the focused window when invoked.
+  const auto onActiveBrowser = [&windows](auto handler) -> CommandBus::Handler {
+    return [&windows, handler](const QVariantMap& args) {
+      if (BrowserController* browser = windows.activeBrowser()) {
+        handler(*browser, args);
       }
-      return;
+    };
+  };
+  const auto toggleSetting = [&windows](bool (AppSettings::*getter)() const, void (AppSettings::*setter)(bool)) -> CommandBus::Handler {
+    return [&windows, getter, setter](const QVariantMap&) {
+      AppSettings* settings = windows.settings();
+      (settings->*setter)(!(settings->*getter)());
+    };
+  };
+  // The tab a command targets: args.tabId when it names one, else the active tab.
+  const auto targetTabIndex = [](TabModel* model, const QVariantMap& args) {
+    if (!model) {
+      return -1;
     }
-
-    if (id == "move-tab-to-new-window") {
-      TabModel* model = browser.tabs();
-      if (!model) {
-        return;
-      }
-
-      const int tabId = args.value("tabId").toInt();
-      if (tabId <= 0) {
-        return;
-      }
-
-      const int index = model->indexOfTabId(tabId);
-      if (index < 0) {
-        return;
-      }
-
-      QUrl url = model->urlAt(index);
-      if (!url.isValid()) {
-        url = QUrl("about:blank");
+    const int tabId = args.value("tabId").toInt();
+    if (tabId > 0) {
+      const int resolved = model->indexOfTabId(tabId);
+      if (resolved >= 0) {
+        return resolved;
       }
+    }
+    return model->activeIndex();
+  };
 
-      const QString profileId =
-        QStringLiteral("window-%1").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss-zzz")));
-      const bool ok = QProcess::startDetached(
-        QCoreApplication::applicationFilePath(),
-        QStringList {
-          QStringLiteral("--profile"),
-          profileId,
-          QStringLiteral("--url"),
-          url.toString(QUrl::FullyEncoded),
-        });
-      if (!ok) {
-        toast.showToast(QStringLiteral("Failed to move tab to new window"));
-        return;
-      }
+  commands.registerCommand({ "new-window", "New Window", "Windows", "Ctrl+N" }, [&windows](const QVariantMap&) {
+    windows.openWindow();
+  });
 
-      model->removeTab(index);
+  commands.registerCommand({ "move-tab-to-new-window", {}, "Windows", {} }, [&windows, &toast](const QVariantMap& args) {
+    const int tabId = args.value("tabId").toInt();
+    if (tabId <= 0) {
       return;
     }
+    if (windows.moveTabToNewWindow(windows.activeWindowId(), tabId) < 0) {
+      toast.showToast(QStringLiteral("Failed to move tab to new window"));
+    }
+  });
 
-    if (id == "new-incognito-window") {
-      const bool ok = QProcess::startDetached(QCoreApplication::applicationFilePath(), QStringList { QStringLiteral("--incognito") });
-      if (!ok) {
-        toast.showToast(QStringLiteral("Failed to open incognito window"));
-      }
-      return;
+  // Incognito needs its own data directory, so it stays a separate process.
+  commands.registerCommand({ "new-incognito-window", "New Incognito Window", "Windows", "Ctrl+Shift+N" }, [&toast](const QVariantMap&) {
+    const bool ok = QProcess::startDetached(QCoreApplication::applicationFilePath(), QStringList { QStringLiteral("--incognito") });
+    if (!ok) {
+      toast.showToast(QStringLiteral("Failed to open incognito window"));
     }
+  });
+
+  commands.registerCommand({ "new-tab", "New Tab", "Tabs", "Ctrl+T" }, onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+    const QUrl url = args.value("url").toUrl();
+    browser.newTab(url.isValid() ? url : QUrl("about:blank"));
+  }));
 
-    if (id == "new-tab") {
-      const QUrl url = args.value("url").toUrl();
-      browser.newTab(url.isValid() ? url : QUrl("about:blank"));
+  commands.registerCommand({ "close-tab", "Close Tab", "Tabs", "Ctrl+W" }, onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+    TabModel* model = browser.tabs();
+    if (!model) {
       return;
     }
 
-    if (id == "close-tab") {
-      TabModel* model = browser.tabs();
-      if (!model) {
+    const QVariant tabIdVar = args.value("tabId");
+    if (tabIdVar.isValid()) {
+      const int tabId = tabIdVar.toInt();
+      if (tabId > 0) {
+        browser.closeTabById(tabId);
         return;
       }
-
-      const QVariant tabIdVar = args.value("tabId");
-      if (tabIdVar.isValid()) {
-        const int tabId = tabIdVar.toInt();
-        if (tabId > 0) {
-          browser.closeTabById(tabId);
-          return;
-        }
-      }
-
-      const QVariant indexVar = args.value("index");
-      const int index = indexVar.isValid() ? indexVar.toInt() : model->activeIndex();
-      browser.closeTab(index);
-      return;
     }
 
-    if (id == "restore-closed-tab") {
+    const QVariant indexVar = args.value("index");
+    const int index = indexVar.isValid() ? indexVar.toInt() : model->activeIndex();
+    browser.closeTab(index);
+  }));
+
+  commands.registerCommand(
+    { "restore-closed-tab", "Restore Closed Tab", "Tabs", "Ctrl+Shift+T" },
+    onActiveBrowser([&toast](BrowserController& browser, const QVariantMap&) {
       if (!browser.restoreLastClosedTab()) {
         toast.showToast(QStringLiteral("No recently closed tab"));
       }
-      return;
-    }
+    }));
 
-    if (id == "duplicate-tab") {
-      const int tabId = args.value("tabId").toInt();
-      if (tabId <= 0) {
-        return;
-      }
-      browser.duplicateTabById(tabId);
+  commands.registerCommand({ "duplicate-tab", "Duplicate Tab", "Tabs", {} }, onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+    const int tabId = args.value("tabId").toInt();
+    if (tabId <= 0) {
       return;
     }
+    browser.duplicateTabById(tabId);
+  }));
 
-    if (id == "next-tab" || id == "prev-tab") {
+  const auto cycleTab = [](int delta) {
+    return [delta](BrowserController& browser, const QVariantMap&) {
       TabModel* model = browser.tabs();
       if (!model) {
         return;
@@ -540,86 +644,70 @@ int main(int argc, char* argv[])
       if (index < 0) {
         index = 0;
       }
-
-      const int delta = (id == "next-tab") ? 1 : -1;
-      const int next = (index + delta + count) % count;
-      model->setActiveIndex(next);
-      return;
-    }
-
-    if (id == "toggle-sidebar") {
-      AppSettings* settings = browser.settings();
-      settings->setSidebarExpanded(!settings->sidebarExpanded());
-      return;
-    }
-
-    if (id == "toggle-addressbar") {
-      AppSettings* settings = browser.settings();
-      settings->setAddressBarVisible(!settings->addressBarVisible());
-      return;
-    }
-
-    if (id == "toggle-compact-mode") {
-      AppSettings* settings = browser.settings();
-      settings->setCompactMode(!settings->compactMode());
-      return;
-    }
-
-    if (id == "toggle-reduce-motion") {
-      AppSettings* settings = browser.settings();
-      settings->setReduceMotion(!settings->reduceMotion());
-      return;
-    }
-
-    if (id == "new-workspace") {
-      WorkspaceModel* workspaces = browser.workspaces();
-      const int nextNumber = workspaces->count() + 1;
-      const int index = workspaces->addWorkspace(QStringLiteral("Workspace %1").arg(nextNumber));
-      workspaces->setActiveIndex(index);
-      browser.newTab(QUrl("about:blank"));
-      return;
-    }
-
-    if (id == "toggle-essential") {
-      const int tabId = args.value("tabId").toInt();
-      if (tabId <= 0) {
-        return;
-      }
-      browser.toggleTabEssentialById(tabId);
-      return;
-    }
-
-    if (id == "toggle-essentials-close-resets") {
-      AppSettings* settings = browser.settings();
-      settings->setEssentialCloseResets(!settings->essentialCloseResets());
+      model->setActiveIndex((index + delta + count) % count);
+    };
+  };
+  commands.registerCommand({ "next-tab", "Next Tab", "Tabs", "Ctrl+Tab" }, onActiveBrowser(cycleTab(1)));
+  commands.registerCommand({ "prev-tab", "Previous Tab", "Tabs", "Ctrl+Shift+Tab" }, onActiveBrowser(cycleTab(-1)));
+  commands.registerCommand(
+    { "recent-tab", "Switch to Last Used Tab", "Tabs", "Ctrl+`" },
+    onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+      browser.activateRecentTab(args.value("position", 1).toInt());
+    }));
+
+  commands.registerCommand(
+    { "toggle-sidebar", "Toggle Sidebar", "View", "Ctrl+B" },
+    toggleSetting(&AppSettings::sidebarExpanded, &AppSettings::setSidebarExpanded));
+  commands.registerCommand(
+    { "toggle-addressbar", "Toggle Address Bar", "View", "Ctrl+Shift+L" },
+    toggleSetting(&AppSettings::addressBarVisible, &AppSettings::setAddressBarVisible));
+  commands.registerCommand(
+    { "toggle-compact-mode", "Toggle Compact Mode", "View", "Ctrl+Shift+C" },
+    toggleSetting(&AppSettings::compactMode, &AppSettings::setCompactMode));
+  commands.registerCommand(
+    { "toggle-reduce-motion", "Toggle Reduce Motion", "View", {} },
+    toggleSetting(&AppSettings::reduceMotion, &AppSettings::setReduceMotion));
+  commands.registerCommand(
+    { "toggle-essentials-close-resets", "Toggle Essentials Reset on Close", "Tabs", {} },
+    toggleSetting(&AppSettings::essentialCloseResets, &AppSettings::setEssentialCloseResets));
+  commands.registerCommand(
+    { "toggle-menubar", "Toggle Menu Bar", "View", {} },
+    toggleSetting(&AppSettings::showMenuBar, &AppSettings::setShowMenuBar));
+  commands.registerCommand(
+    { "toggle-back-close", "Toggle Back Closes Tab", "Navigation", {} },
+    toggleSetting(&AppSettings::closeTabOnBackNoHistory, &AppSettings::setCloseTabOnBackNoHistory));
+
+  commands.registerCommand({ "new-workspace", "New Workspace", "Workspaces", {} }, onActiveBrowser([](BrowserController& browser, const QVariantMap&) {
+    WorkspaceModel* workspaces = browser.workspaces();
+    const int nextNumber = workspaces->count() + 1;
+    const int index = workspaces->addWorkspace(QStringLiteral("Workspace %1").arg(nextNumber));
+    workspaces->setActiveIndex(index);
+    browser.newTab(QUrl("about:blank"));
+  }));
+
+  commands.registerCommand({ "toggle-essential", "Toggle Essential Tab", "Tabs", {} }, onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+    const int tabId = args.value("tabId").toInt();
+    if (tabId <= 0) {
       return;
     }
+    browser.toggleTabEssentialById(tabId);
+  }));
 
-    if (id == "toggle-split-view") {
-      splitView.setEnabled(!splitView.enabled());
-      return;
+  commands.registerCommand({ "toggle-split-view", "Toggle Split View", "View", "Ctrl+E" }, [&windows](const QVariantMap&) {
+    if (SplitViewController* splitView = windows.activeSplitView()) {
+      splitView->setEnabled(!splitView->enabled());
     }
+  });
 
-    if (id == "switch-workspace") {
-      const int index = args.value("index").toInt();
-      browser.workspaces()->setActiveIndex(index);
-      return;
-    }
+  commands.registerCommand({ "switch-workspace", {}, "Workspaces", {} }, onActiveBrowser([](BrowserController& browser, const QVariantMap& args) {
+    browser.workspaces()->setActiveIndex(args.value("index").toInt());
+  }));
 
-    if (id == "copy-url") {
+  commands.registerCommand(
+    { "copy-url", "Copy URL", "Tabs", {} },
+    onActiveBrowser([&toast, targetTabIndex](BrowserController& browser, const QVariantMap& args) {
       TabModel* model = browser.tabs();
-      if (!model) {
-        return;
-      }
-
-      int index = model->activeIndex();
-      const int tabId = args.value("tabId").toInt();
-      if (tabId > 0) {
-        const int resolved = model->indexOfTabId(tabId);
-        if (resolved >= 0) {
-          index = resolved;
-        }
-      }
+      const int index = targetTabIndex(model, args);
       if (index < 0) {
         return;
       }
@@ -631,10 +719,11 @@ int main(int argc, char* argv[])
 
       QGuiApplication::clipboard()->setText(url.toString(QUrl::FullyEncoded));
       toast.showToast(QStringLiteral("Copied URL"));
-      return;
-    }
+    }));
 
-    if (id == "open-external-url") {
+  commands.registerCommand(
+    { "open-external-url", "Open in Default Browser", "Tabs", {} },
+    onActiveBrowser([&toast, targetTabIndex](BrowserController& browser, const QVariantMap& args) {
       QUrl url;
 
       const QString explicitUrl = args.value("url").toString().trimmed();
@@ -642,22 +731,10 @@ int main(int argc, char* argv[])
         url = QUrl(explicitUrl);
       } else {
         TabModel* model = browser.tabs();
-        if (!model) {
-          return;
-        }
-
-        int index = model->activeIndex();
-        const int tabId = args.value("tabId").toInt();
-        if (tabId > 0) {
-          const int resolved = model->indexOfTabId(tabId);
-          if (resolved >= 0) {
-            index = resolved;
-          }
-        }
+        const int index = targetTabIndex(model, args);
         if (index < 0) {
           return;
         }
-
         url = model->urlAt(index);
       }
 
@@ -671,43 +748,32 @@ int main(int argc, char* argv[])
 
       QGuiApplication::clipboard()->setText(url.toString(QUrl::FullyEncoded));
       toast.showToast(QStringLiteral("Failed to open default browser (copied URL)"));
+    }));
+
+  commands.registerCommand({ "open-external-link", {}, "Tabs", {} }, [&toast](const QVariantMap& args) {
+    const QString urlText = args.value("url").toString().trimmed();
+    if (urlText.isEmpty()) {
       return;
     }
 
-    if (id == "open-external-link") {
-      const QString urlText = args.value("url").toString().trimmed();
-      if (urlText.isEmpty()) {
-        return;
-      }
-
-      const QUrl url(urlText);
-      if (!url.isValid()) {
-        return;
-      }
-
-      if (QDesktopServices::openUrl(url)) {
-        return;
-      }
+    const QUrl url(urlText);
+    if (!url.isValid()) {
+      return;
+    }
 
-      QGuiApplication::clipboard()->setText(url.toString(QUrl::FullyEncoded));
-      toast.showToast(QStringLiteral("Failed to open default browser (copied URL)"));
+    if (QDesktopServices::openUrl(url)) {
       return;
     }
 
-    if (id == "copy-title") {
-      TabModel* model = browser.tabs();
-      if (!model) {
-        return;
-      }
+    QGuiApplication::clipboard()->setText(url.toString(QUrl::FullyEncoded));
+    toast.showToast(QStringLiteral("Failed to open default browser (copied URL)"));
+  });
 
-      int index = model->activeIndex();
-      const int tabId = args.value("tabId").toInt();
-      if (tabId > 0) {
-        const int resolved = model->indexOfTabId(tabId);
-        if (resolved >= 0) {
-          index = resolved;
-        }
-      }
+  commands.registerCommand(
+    { "copy-title", "Copy Title", "Tabs", {} },
+    onActiveBrowser([&toast, targetTabIndex](BrowserController& browser, const QVariantMap& args) {
+      TabModel* model = browser.tabs();
+      const int index = targetTabIndex(model, args);
       if (index < 0) {
         return;
       }
@@ -719,35 +785,23 @@ int main(int argc, char* argv[])
 
       QGuiApplication::clipboard()->setText(title);
       toast.showToast(QStringLiteral("Copied title"));
-      return;
-    }
-
-    if (id == "copy-text") {
-      const QString text = args.value("text").toString();
-      const QString trimmed = text.trimmed();
-      if (trimmed.isEmpty()) {
-        return;
-      }
+    }));
 
-      QGuiApplication::clipboard()->setText(trimmed);
-      toast.showToast(QStringLiteral("Copied"));
+  commands.registerCommand({ "copy-text", {}, "Tools", {} }, [&toast](const QVariantMap& args) {
+    const QString trimmed = args.value("text").toString().trimmed();
+    if (trimmed.isEmpty()) {
       return;
     }
 
-    if (id == "share-url") {
-      TabModel* model = browser.tabs();
-      if (!model) {
-        return;
-      }
+    QGuiApplication::clipboard()->setText(trimmed);
+    toast.showToast(QStringLiteral("Copied"));
+  });
 
-      int index = model->activeIndex();
-      const int tabId = args.value("tabId").toInt();
-      if (tabId > 0) {
-        const int resolved = model->indexOfTabId(tabId);
-        if (resolved >= 0) {
-          index = resolved;
-        }
-      }
+  commands.registerCommand(
+    { "share-url", "Share", "Tabs", {} },
+    onActiveBrowser([&toast, &shareController, targetTabIndex](BrowserController& browser, const QVariantMap& args) {
+      TabModel* model = browser.tabs();
+      const int index = targetTabIndex(model, args);
       if (index < 0) {
         return;
       }
@@ -772,24 +826,54 @@ int main(int argc, char* argv[])
         QGuiApplication::clipboard()->setText(url.toString(QUrl::FullyEncoded));
         toast.showToast(QStringLiteral("Copied URL"));
       }
-      return;
-    }
-
-    if (id == "toggle-menubar") {
-      AppSettings* settings = browser.settings();
-      settings->setShowMenuBar(!settings->showMenuBar());
-      return;
-    }
-
-    if (id == "toggle-back-close") {
-      AppSettings* settings = browser.settings();
-      settings->setCloseTabOnBackNoHistory(!settings->closeTabOnBackNoHistory());
-      return;
-    }
-  });
+    }));
+
+  // Handled by the focused window's QML (BrowserWindow.qml), which gets
+  // them through CommandBus::commandInvoked.
+  const CommandBus::CommandInfo windowCommands[] = {
+    { "focus-address", "Focus Address Bar", "Navigation", "Ctrl+L" },
+    { "nav-back", "Back", "Navigation", "Alt+Left" },
+    { "nav-forward", "Forward", "Navigation", "Alt+Right" },
+    { "nav-reload", "Reload", "Navigation", "Ctrl+R" },
+    { "nav-stop", "Stop Loading", "Navigation", "Esc" },
+    { "navigate", {}, "Navigation", {} },
+    { "open-find", "Find in Page", "Navigation", "Ctrl+F" },
+    { "zoom-in", "Zoom In", "View", "Ctrl++" },
+    { "zoom-out", "Zoom Out", "View", "Ctrl+-" },
+    { "zoom-reset", "Reset Zoom", "View", "Ctrl+0" },
+    { "toggle-fullscreen", "Toggle Fullscreen", "View", "F11" },
+    { "focus-split-primary", "Focus Split Primary", "View", "Ctrl+Alt+Left" },
+    { "focus-split-secondary", "Focus Split Secondary", "View", "Ctrl+Alt+Right" },
+    { "split-swap", "Swap Split Panes", "View", "Ctrl+Shift+S" },
+    { "split-close-pane", "Close Split Pane", "View", "Ctrl+Shift+E" },
+    { "split-focus-next", "Focus Next Split Pane", "View", "Ctrl+Alt+Down" },
+    { "open-tab-switcher", "Switch Tab", "Tabs", "Ctrl+K" },
+    { "view-source", "View Source", "Tools", {} },
+    { "open-devtools", "DevTools", "Tools", "F12" },
+    { "open-file", "Open File", "Tools", "Ctrl+O" },
+    { "open-print", "Print / Save PDF", "Output", "Ctrl+P" },
+    { "open-settings", "Settings", "Tools", "Ctrl+," },
+    { "open-downloads", "Downloads", "Tools", "Ctrl+J" },
+    { "open-bookmarks", "Bookmarks", "Tools", "Ctrl+D" },
+    { "open-history", "History", "Tools", "Ctrl+H" },
+    { "open-permissions", "Permissions", "Tools", {} },
+    { "open-mods", "Mods", "Tools", {} },
+    { "open-themes", "Themes", "Tools", {} },
+    { "open-clear-data", "Clear Browsing Data", "Tools", {} },
+    { "open-extensions", "Extensions", "Tools", {} },
+    { "open-welcome", "Welcome", "Tools", {} },
+    { "open-diagnostics", "Diagnostics", "Tools", {} },
+    { "open-latest-download-file", "Open Latest Download", "Tools", {} },
+    { "open-latest-download-folder", "Show Latest Download in Folder", "Tools", {} },
+    { "retry-last-download", "Retry Last Download", "Tools", {} },
+    { "theme-update", {}, "Tools", {} },
+  };
+  for (const CommandBus::CommandInfo& info : windowCommands) {
+    commands.registerCommand(info);
+  }
 
   {
-    AppSettings* settings = browser.settings();
+    AppSettings* settings = windows.settings();
     const QString currentVersion = QCoreApplication::applicationVersion().trimmed();
     const QString lastSeen = settings->lastSeenAppVersion().trimmed();
 
@@ -809,7 +893,7 @@ int main(int argc, char* argv[])
       qmlWarnings.push_back(w.toString());
     }
   });
-  engine.rootContext()->setContextProperty("browser", &browser);
+  engine.rootContext()->setContextProperty("windows", &windows);
   engine.rootContext()->setContextProperty("commands", &commands);
   engine.rootContext()->setContextProperty("shortcutStore", &shortcutStore);
   engine.rootContext()->setContextProperty("notifications", &notifications);
@@ -819,29 +903,110 @@ int main(int argc, char* argv[])
   engine.rootContext()->setContextProperty("downloads", &downloads);
   engine.rootContext()->setContextProperty("bookmarks", &bookmarks);
   engine.rootContext()->setContextProperty("history", &history);
+  engine.rootContext()->setContextProperty("urlCompletion", &urlCompletion);
+  engine.rootContext()->setContextProperty("navigationPredictor", &navigationPredictor);
+  engine.rootContext()->setContextProperty("hostPreresolver", &hostPreresolver);
+  engine.rootContext()->setContextProperty("historyText", &historyText);
+  engine.rootContext()->setContextProperty("historyImporter", &historyImporter);
   engine.rootContext()->setContextProperty("sourceViewer", &sourceViewer);
   engine.rootContext()->setContextProperty("webPanels", &webPanels);
-  engine.rootContext()->setContextProperty("layoutController", &layoutController);
   engine.rootContext()->setContextProperty("omniboxUtils", &omniboxUtils);
   engine.rootContext()->setContextProperty("faviconCache", &favicons);
   engine.rootContext()->setContextProperty("mods", &mods);
   engine.rootContext()->setContextProperty("theme", &theme);
   engine.rootContext()->setContextProperty("themes", &themes);
   engine.rootContext()->setContextProperty("quickLinks", &quickLinks);
-  engine.rootContext()->setContextProperty("splitView", &splitView);
+  engine.rootContext()->setContextProperty("topSites", &topSites);
   engine.rootContext()->setContextProperty("extensions", &extensions);
   engine.rootContext()->setContextProperty("extensionsStore", &ExtensionsStore::instance());
   engine.rootContext()->setContextProperty("diagnostics", &diagnostics);
   engine.rootContext()->setContextProperty("sitePermissions", &sitePermissions);
-  engine.load(QUrl("qrc:/ui/qml/Main.qml"));
-  if (engine.rootObjects().isEmpty()) {
-    QString message = QStringLiteral("Failed to load UI (qrc:/ui/qml/Main.qml).");
-    if (!qmlWarnings.isEmpty()) {
-      message += QStringLiteral("\n\nQML errors:\n%1").arg(qmlWarnings.join('\n'));
+  engine.rootContext()->setContextProperty("browsingDataCleaner", &dataCleaner);
+  engine.rootContext()->setContextProperty("segmentedDownloads", &segmentedDownloads);
+
+  // One instance of Main.qml per window. Per-window controllers are context
+  // properties of a child context, so the QML keeps using "browser" etc.
+  QQmlComponent windowComponent(&engine, QUrl("qrc:/ui/qml/Main.qml"));
+  QHash<int, QPointer<QObject>> windowUis;
+  auto createWindowUi = [&engine, &windows, &windowComponent, &windowUis](int windowId) -> bool {
+    auto* context = new QQmlContext(engine.rootContext(), &engine);
+    context->setContextProperty("windowId", windowId);
+    context->setContextProperty("browser", windows.browser(windowId));
+    context->setContextProperty("splitView", windows.splitView(windowId));
+    context->setContextProperty("layoutController", windows.layout(windowId));
+
+    QObject* ui = windowComponent.create(context);
+    if (!ui) {
+      delete context;
+      return false;
+    }
+    QObject::connect(ui, &QObject::destroyed, context, &QObject::deleteLater);
+    windowUis.insert(windowId, ui);
+    return true;
+  };
+
+  for (const int windowId : windows.windowIds()) {
+    if (!createWindowUi(windowId)) {
+      QString message = QStringLiteral("Failed to load UI (qrc:/ui/qml/Main.qml).");
+      QStringList errors = qmlWarnings;
+      for (const QQmlError& error : windowComponent.errors()) {
+        errors.push_back(error.toString());
+      }
+      if (!errors.isEmpty()) {
+        message += QStringLiteral("\n\nQML errors:\n%1").arg(errors.join('\n'));
+      }
+      message += QStringLiteral("\n\nLog: %1").arg(logFilePath());
+      showFatalMessage(message);
+      return 1;
     }
-    message += QStringLiteral("\n\nLog: %1").arg(logFilePath());
-    showFatalMessage(message);
-    return 1;
+  }
+
+  // Queued so a window opened for a moved tab already has that tab when its
+  // UI completes and does not add a default one.
+  QObject::connect(
+    &windows,
+    &WindowManager::windowCreated,
+    &engine,
+    [createWindowUi, &windows, &toast](int windowId) {
+      if (windows.hasWindow(windowId) && !createWindowUi(windowId)) {
+        toast.showToast(QStringLiteral("Failed to open new window"));
+      }
+    },
+    Qt::QueuedConnection);
+  QObject::connect(&windows, &WindowManager::windowClosed, &engine, [&windowUis](int windowId) {
+    // Usually called from the window's own onClosing handler.
+    if (QObject* ui = windowUis.take(windowId)) {
+      ui->deleteLater();
+    }
+  });
+
+  if (instanceBroker) {
+    // Launching again with nothing to open asks for a window, as in other
+    // browsers; URLs go to the focused window unless --new-window was given.
+    QObject::connect(
+      instanceBroker.get(),
+      &InstanceBroker::requestReceived,
+      &windows,
+      [&windows, &windowUis](const QStringList& urls, bool newWindow) {
+        if (urls.isEmpty() || newWindow || !windows.activeBrowser()) {
+          const int windowId = windows.openWindow(urls.isEmpty() ? QUrl() : QUrl(urls.first()));
+          for (int i = 1; i < urls.size(); ++i) {
+            windows.browser(windowId)->newTab(QUrl(urls.at(i)));
+          }
+          return;
+        }
+
+        for (const QString& url : urls) {
+          windows.activeBrowser()->newTab(QUrl(url));
+        }
+        if (auto* window = qobject_cast<QWindow*>(windowUis.value(windows.activeWindowId()).data())) {
+          if (window->visibility() == QWindow::Minimized) {
+            window->showNormal();
+          }
+          window->raise();
+          window->requestActivate();
+        }
+      });
   }
 
   return app.exec();
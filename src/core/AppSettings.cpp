@@ -53,7 +53,7 @@ int AppSettings::sidebarWidth() const
 
 void AppSettings::setSidebarWidth(int width)
 {
-  const int clamped = qBound(160, width, 520);
+  const int clamped = qBound(kMinSidebarWidth, width, kMaxSidebarWidth);
   if (m_sidebarWidth == clamped) {
     return;
   }
@@ -451,6 +451,53 @@ void AppSettings::setWebPanelTitle(const QString& title)
   scheduleSave();
 }
 
+int AppSettings::historyDetailDays() const
+{
+  return m_historyDetailDays;
+}
+
+void AppSettings::setHistoryDetailDays(int days)
+{
+  const int clamped = qBound(0, days, 3650);
+  if (m_historyDetailDays == clamped) {
+    return;
+  }
+  m_historyDetailDays = clamped;
+  emit historyDetailDaysChanged();
+  scheduleSave();
+}
+
+int AppSettings::historyRetentionDays() const
+{
+  return m_historyRetentionDays;
+}
+
+void AppSettings::setHistoryRetentionDays(int days)
+{
+  const int clamped = qBound(0, days, 3650);
+  if (m_historyRetentionDays == clamped) {
+    return;
+  }
+  m_historyRetentionDays = clamped;
+  emit historyRetentionDaysChanged();
+  scheduleSave();
+}
+
+bool AppSettings::acceleratedDownloads() const
+{
+  return m_acceleratedDownloads;
+}
+
+void AppSettings::setAcceleratedDownloads(bool enabled)
+{
+  if (m_acceleratedDownloads == enabled) {
+    return;
+  }
+  m_acceleratedDownloads = enabled;
+  emit acceleratedDownloadsChanged();
+  scheduleSave();
+}
+
 void AppSettings::load()
 {
   QFile f(settingsPath());
@@ -471,7 +518,7 @@ void AppSettings::load()
   const bool needsUpgrade = version < 8;
 
   const int width = obj.value("sidebarWidth").toInt(m_sidebarWidth);
-  m_sidebarWidth = qBound(160, width, 520);
+  m_sidebarWidth = qBound(kMinSidebarWidth, width, kMaxSidebarWidth);
   m_sidebarExpanded = obj.value("sidebarExpanded").toBool(m_sidebarExpanded);
   m_sidebarOnRight = obj.value("sidebarOnRight").toBool(m_sidebarOnRight);
   m_useSingleToolbar = obj.value("useSingleToolbar").toBool(m_useSingleToolbar);
@@ -520,6 +567,9 @@ void AppSettings::load()
     }
   }
   m_webPanelTitle = obj.value("webPanelTitle").toString(m_webPanelTitle).trimmed();
+  m_historyDetailDays = qBound(0, obj.value("historyDetailDays").toInt(m_historyDetailDays), 3650);
+  m_historyRetentionDays = qBound(0, obj.value("historyRetentionDays").toInt(m_historyRetentionDays), 3650);
+  m_acceleratedDownloads = obj.value("acceleratedDownloads").toBool(m_acceleratedDownloads);
 
   if (needsUpgrade) {
     scheduleSave();
@@ -573,6 +623,9 @@ bool AppSettings::saveNow(QString* error) const
   obj.insert("webPanelVisible", m_webPanelVisible);
   obj.insert("webPanelUrl", m_webPanelUrl.toString());
   obj.insert("webPanelTitle", m_webPanelTitle);
+  obj.insert("historyDetailDays", m_historyDetailDays);
+  obj.insert("historyRetentionDays", m_historyRetentionDays);
+  obj.insert("acceleratedDownloads", m_acceleratedDownloads);
 
   f.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
   if (!f.commit()) {
@@ -45,8 +45,16 @@ class AppSettings : public QObject
   Q_PROPERTY(bool webPanelVisible READ webPanelVisible WRITE setWebPanelVisible NOTIFY webPanelVisibleChanged)
   Q_PROPERTY(QUrl webPanelUrl READ webPanelUrl WRITE setWebPanelUrl NOTIFY webPanelUrlChanged)
   Q_PROPERTY(QString webPanelTitle READ webPanelTitle WRITE setWebPanelTitle NOTIFY webPanelTitleChanged)
+  Q_PROPERTY(int historyDetailDays READ historyDetailDays WRITE setHistoryDetailDays NOTIFY historyDetailDaysChanged)
+  Q_PROPERTY(
+    int historyRetentionDays READ historyRetentionDays WRITE setHistoryRetentionDays NOTIFY historyRetentionDaysChanged)
+  Q_PROPERTY(
+    bool acceleratedDownloads READ acceleratedDownloads WRITE setAcceleratedDownloads NOTIFY acceleratedDownloadsChanged)
 
 public:
+  static constexpr int kMinSidebarWidth = 160;
+  static constexpr int kMaxSidebarWidth = 520;
+
   explicit AppSettings(QObject* parent = nullptr);
 
   int sidebarWidth() const;
@@ -124,6 +132,17 @@ public:
   QString webPanelTitle() const;
   void setWebPanelTitle(const QString& title);
 
+  // Days of history kept visit by visit, and in total; 0 means no limit.
+  int historyDetailDays() const;
+  void setHistoryDetailDays(int days);
+
+  int historyRetentionDays() const;
+  void setHistoryRetentionDays(int days);
+
+  // Downloads go through SegmentedDownloader instead of the web engine.
+  bool acceleratedDownloads() const;
+  void setAcceleratedDownloads(bool enabled);
+
 signals:
   void sidebarWidthChanged();
   void sidebarExpandedChanged();
@@ -149,6 +168,9 @@ signals:
   void webPanelVisibleChanged();
   void webPanelUrlChanged();
   void webPanelTitleChanged();
+  void historyDetailDaysChanged();
+  void historyRetentionDaysChanged();
+  void acceleratedDownloadsChanged();
 
 private:
   void load();
@@ -179,5 +201,8 @@ private:
   bool m_webPanelVisible = false;
   QUrl m_webPanelUrl = QUrl(QStringLiteral("about:blank"));
   QString m_webPanelTitle;
+  int m_historyDetailDays = 90;
+  int m_historyRetentionDays = 730;
+  bool m_acceleratedDownloads = false;
   QTimer m_saveTimer;
 };
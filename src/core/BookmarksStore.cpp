@@ -1,8 +1,7 @@
 #include "BookmarksStore.h"
 
-#include "AppPaths.h"
+#include "UserDataStorage.h"
 
-#include <QDir>
 #include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -19,10 +18,7 @@ namespace
 {
 constexpr int kBookmarksVersion = 2;
 
-QString storagePath()
-{
-  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("bookmarks.json"));
-}
+const QString kStorageName = QStringLiteral("bookmarks.json");
 
 QString normalizeUserFilePath(const QString& input)
 {
@@ -1207,29 +1203,13 @@ bool BookmarksStore::saveNow(QString* error) const
   root.insert(QStringLiteral("nextId"), m_nextId);
   root.insert(QStringLiteral("nodes"), nodes);
 
-  QSaveFile out(storagePath());
-  if (!out.open(QIODevice::WriteOnly)) {
-    if (error) {
-      *error = out.errorString();
-    }
-    return false;
-  }
-
-  out.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
-  if (!out.commit()) {
-    if (error) {
-      *error = out.errorString();
-    }
-    return false;
-  }
-
-  return true;
+  return xbrowser::userDataStorage().write(kStorageName, QJsonDocument(root).toJson(QJsonDocument::Indented), error);
 }
 
 void BookmarksStore::load()
 {
-  QFile f(storagePath());
-  if (!f.exists()) {
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (!storage.exists(kStorageName)) {
     beginResetModel();
     m_nodes.clear();
     m_nextId = 1;
@@ -1240,12 +1220,14 @@ void BookmarksStore::load()
     return;
   }
 
-  if (!f.open(QIODevice::ReadOnly)) {
-    setLastError(f.errorString());
+  QByteArray payload;
+  QString readError;
+  if (!storage.read(kStorageName, &payload, &readError)) {
+    setLastError(readError);
     return;
   }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
   if (!doc.isObject()) {
     setLastError(QStringLiteral("bookmarks.json is not a JSON object"));
     return;
@@ -1,11 +1,31 @@
 #include "BrowserController.h"
 
-#include <QDateTime>
+#include <QSignalBlocker>
 #include <QVariant>
 
 BrowserController::BrowserController(QObject* parent)
+  : BrowserController(nullptr, nullptr, parent)
+{
+}
+
+BrowserController::BrowserController(AppSettings* settings, ClosedTabJournal* closedTabs, QObject* parent)
   : QObject(parent)
 {
+  if (!closedTabs) {
+    m_ownedClosedTabs = std::make_unique<ClosedTabJournal>();
+    closedTabs = m_ownedClosedTabs.get();
+  }
+  if (!settings) {
+    m_ownedSettings = std::make_unique<AppSettings>();
+    settings = m_ownedSettings.get();
+  }
+  m_closedTabs = closedTabs;
+  m_settings = settings;
+
+  m_workspaces.setClosedTabJournal(m_closedTabs);
+  m_tabIndex.setWorkspaces(&m_workspaces);
+  connect(m_closedTabs, &ClosedTabJournal::changed, this, &BrowserController::recentlyClosedChanged);
+
   m_workspaces.addWorkspace("Default");
   m_lastWorkspaceIndex = m_workspaces.activeIndex();
 
@@ -13,23 +33,23 @@ BrowserController::BrowserController(QObject* parent)
     if (workspaceIndex < 0 || workspaceIndex >= m_workspaces.count()) {
       return;
     }
-    m_workspaces.setSidebarWidthAt(workspaceIndex, m_settings.sidebarWidth());
-    m_workspaces.setSidebarExpandedAt(workspaceIndex, m_settings.sidebarExpanded());
+    m_workspaces.setSidebarWidthAt(workspaceIndex, m_settings->sidebarWidth());
+    m_workspaces.setSidebarExpandedAt(workspaceIndex, m_settings->sidebarExpanded());
   };
 
   syncSettingsToWorkspace(m_lastWorkspaceIndex);
 
-  connect(&m_settings, &AppSettings::sidebarWidthChanged, this, [this, syncSettingsToWorkspace] {
+  connect(m_settings, &AppSettings::sidebarWidthChanged, this, [this, syncSettingsToWorkspace] {
     syncSettingsToWorkspace(m_workspaces.activeIndex());
   });
-  connect(&m_settings, &AppSettings::sidebarExpandedChanged, this, [this, syncSettingsToWorkspace] {
+  connect(m_settings, &AppSettings::sidebarExpandedChanged, this, [this, syncSettingsToWorkspace] {
     syncSettingsToWorkspace(m_workspaces.activeIndex());
   });
 
   connect(&m_workspaces, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
     for (int i = first; i <= last; ++i) {
-      m_workspaces.setSidebarWidthAt(i, m_settings.sidebarWidth());
-      m_workspaces.setSidebarExpandedAt(i, m_settings.sidebarExpanded());
+      m_workspaces.setSidebarWidthAt(i, m_settings->sidebarWidth());
+      m_workspaces.setSidebarExpandedAt(i, m_settings->sidebarExpanded());
     }
   });
 
@@ -40,8 +60,8 @@ BrowserController::BrowserController(QObject* parent)
       syncSettingsToWorkspace(m_lastWorkspaceIndex);
 
       if (nextIndex >= 0 && nextIndex < m_workspaces.count()) {
-        m_settings.setSidebarWidth(m_workspaces.sidebarWidthAt(nextIndex));
-        m_settings.setSidebarExpanded(m_workspaces.sidebarExpandedAt(nextIndex));
+        m_settings->setSidebarWidth(m_workspaces.sidebarWidthAt(nextIndex));
+        m_settings->setSidebarExpanded(m_workspaces.sidebarExpandedAt(nextIndex));
       }
 
       m_lastWorkspaceIndex = nextIndex;
@@ -67,9 +87,19 @@ WorkspaceModel* BrowserController::workspaces()
   return &m_workspaces;
 }
 
+GlobalTabIndex* BrowserController::tabIndex()
+{
+  return &m_tabIndex;
+}
+
 AppSettings* BrowserController::settings()
 {
-  return &m_settings;
+  return m_settings;
+}
+
+ClosedTabJournal* BrowserController::closedTabJournal()
+{
+  return m_closedTabs;
 }
 
 int BrowserController::newTab(const QUrl& url)
@@ -92,7 +122,7 @@ void BrowserController::closeTab(int index)
     return;
   }
 
-  if (model->isEssentialAt(index) && m_settings.essentialCloseResets()) {
+  if (model->isEssentialAt(index) && m_settings->essentialCloseResets()) {
     const QUrl initialUrl = model->initialUrlAt(index);
     model->setUrlAt(index, initialUrl.isValid() ? initialUrl : QUrl("about:blank"));
     model->setTitleAt(index, QStringLiteral("New Tab"));
@@ -100,18 +130,6 @@ void BrowserController::closeTab(int index)
     return;
   }
 
-  RecentlyClosedTab closed;
-  closed.workspaceId = m_workspaces.activeWorkspaceId();
-  closed.url = model->urlAt(index);
-  closed.initialUrl = model->initialUrlAt(index);
-  closed.pageTitle = model->pageTitleAt(index);
-  closed.customTitle = model->customTitleAt(index);
-  closed.essential = model->isEssentialAt(index);
-  closed.groupId = model->groupIdAt(index);
-  closed.faviconUrl = model->faviconUrlAt(index);
-  closed.closedAtMs = QDateTime::currentMSecsSinceEpoch();
-  recordRecentlyClosed(closed);
-
   model->closeTab(index);
 }
 
@@ -152,6 +170,31 @@ void BrowserController::activateTabById(int tabId)
   model->setActiveIndex(index);
 }
 
+bool BrowserController::activateTabInWorkspace(int workspaceId, int tabId)
+{
+  const int workspaceIndex = workspaceIndexForId(workspaceId);
+  TabModel* model = m_workspaces.tabsForIndex(workspaceIndex);
+  const int index = model ? model->indexOfTabId(tabId) : -1;
+  if (index < 0) {
+    return false;
+  }
+
+  // Tab first: activating the workspace is what marks its tab as used.
+  model->setActiveIndex(index);
+  m_workspaces.setActiveIndex(workspaceIndex);
+  return true;
+}
+
+bool BrowserController::activateRecentTab(int position)
+{
+  const QVariantMap recent = m_tabIndex.recentAt(position);
+  if (recent.isEmpty()) {
+    return false;
+  }
+  return activateTabInWorkspace(recent.value(QStringLiteral("workspaceId")).toInt(),
+                                recent.value(QStringLiteral("tabId")).toInt());
+}
+
 void BrowserController::toggleTabEssentialById(int tabId)
 {
   TabModel* model = tabs();
@@ -304,7 +347,7 @@ bool BrowserController::handleBackRequested(int tabId, bool canGoBack)
   if (canGoBack) {
     return false;
   }
-  if (!m_settings.closeTabOnBackNoHistory()) {
+  if (!m_settings->closeTabOnBackNoHistory()) {
     return false;
   }
 
@@ -462,7 +505,7 @@ bool BrowserController::restoreLastClosedTab()
 
 int BrowserController::recentlyClosedCount() const
 {
-  return m_recentlyClosed.size();
+  return m_closedTabs->count();
 }
 
 QVariantList BrowserController::recentlyClosedItems(int limit) const
@@ -472,18 +515,26 @@ QVariantList BrowserController::recentlyClosedItems(int limit) const
     return items;
   }
 
-  const int count = qMin(limit, m_recentlyClosed.size());
+  const int count = qMin(limit, m_closedTabs->count());
   items.reserve(count);
 
   for (int i = 0; i < count; ++i) {
-    const RecentlyClosedTab& entry = m_recentlyClosed.at(i);
+    const ClosedTabJournal::Record& record = m_closedTabs->at(i);
+    if (record.tabs.isEmpty()) {
+      continue;
+    }
+
+    const ClosedTabJournal::TabRecord& entry = record.tabs.first();
     const QString title = !entry.customTitle.trimmed().isEmpty() ? entry.customTitle : entry.pageTitle;
 
     QVariantMap obj;
     obj.insert(QStringLiteral("title"), title);
-    obj.insert(QStringLiteral("url"), entry.url.toString(QUrl::FullyEncoded));
+    obj.insert(QStringLiteral("url"), entry.url);
     obj.insert(QStringLiteral("workspaceId"), entry.workspaceId);
-    obj.insert(QStringLiteral("closedAtMs"), entry.closedAtMs);
+    obj.insert(QStringLiteral("closedAtMs"), record.closedAtMs);
+    obj.insert(QStringLiteral("kind"),
+               record.kind == ClosedTabJournal::Kind::Window ? QStringLiteral("window") : QStringLiteral("tab"));
+    obj.insert(QStringLiteral("tabCount"), record.tabs.size());
     items.push_back(obj);
   }
 
@@ -492,76 +543,127 @@ QVariantList BrowserController::recentlyClosedItems(int limit) const
 
 bool BrowserController::restoreRecentlyClosed(int index)
 {
-  if (index < 0 || index >= m_recentlyClosed.size()) {
+  if (index < 0 || index >= m_closedTabs->count()) {
     return false;
   }
 
-  const RecentlyClosedTab entry = m_recentlyClosed.at(index);
-  const int targetWorkspaceIndex = workspaceIndexForId(entry.workspaceId);
-  const int workspaceIndex = targetWorkspaceIndex >= 0 ? targetWorkspaceIndex : m_workspaces.activeIndex();
-
-  if (workspaceIndex < 0 || workspaceIndex >= m_workspaces.count()) {
+  const ClosedTabJournal::Record& pending = m_closedTabs->at(index);
+  if (pending.tabs.isEmpty()) {
+    m_closedTabs->takeAt(index);
     return false;
   }
 
-  TabModel* tabs = m_workspaces.tabsForIndex(workspaceIndex);
-  if (!tabs) {
+  const int targetWorkspaceIndex = workspaceIndexForId(pending.tabs.first().workspaceId);
+  const int workspaceIndex = targetWorkspaceIndex >= 0 ? targetWorkspaceIndex : m_workspaces.activeIndex();
+  if (workspaceIndex < 0 || workspaceIndex >= m_workspaces.count()) {
     return false;
   }
 
-  TabGroupModel* groups = m_workspaces.groupsForIndex(workspaceIndex);
-
-  if (m_workspaces.activeIndex() != workspaceIndex) {
-    m_workspaces.setActiveIndex(workspaceIndex);
-  }
-
-  const QUrl url = entry.url.isValid() ? entry.url : QUrl("about:blank");
-  const int restoredIndex = tabs->addTab(url);
-  tabs->setInitialUrlAt(restoredIndex, entry.initialUrl.isValid() ? entry.initialUrl : url);
-  tabs->setTitleAt(restoredIndex, entry.pageTitle);
-  tabs->setCustomTitleAt(restoredIndex, entry.customTitle);
-  tabs->setEssentialAt(restoredIndex, entry.essential);
+  return restoreClosedRecord(m_closedTabs->takeAt(index), true) > 0;
+}
 
-  const int groupId = (groups && entry.groupId > 0 && groups->indexOfGroupId(entry.groupId) >= 0) ? entry.groupId : 0;
-  tabs->setGroupIdAt(restoredIndex, groupId);
-  tabs->setFaviconUrlAt(restoredIndex, entry.faviconUrl);
-  tabs->setActiveIndex(restoredIndex);
+int BrowserController::restoreRecentlyClosedRange(int first, int count)
+{
+  const QVector<ClosedTabJournal::Record> records = m_closedTabs->takeRange(first, count);
 
-  m_recentlyClosed.removeAt(index);
-  emit recentlyClosedChanged();
-  return true;
+  int restored = 0;
+  for (int i = records.size() - 1; i >= 0; --i) {
+    restored += restoreClosedRecord(records.at(i), i == 0);
+  }
+  return restored;
 }
 
 void BrowserController::clearRecentlyClosed()
 {
-  if (m_recentlyClosed.isEmpty()) {
-    return;
-  }
-  m_recentlyClosed.clear();
-  emit recentlyClosedChanged();
+  m_closedTabs->clear();
 }
 
 QVector<BrowserController::RecentlyClosedTab> BrowserController::recentlyClosedTabs() const
 {
-  return m_recentlyClosed;
+  QVector<RecentlyClosedTab> out;
+  out.reserve(m_closedTabs->count());
+
+  for (int i = 0; i < m_closedTabs->count(); ++i) {
+    const ClosedTabJournal::Record& record = m_closedTabs->at(i);
+    for (const ClosedTabJournal::TabRecord& tab : record.tabs) {
+      RecentlyClosedTab entry;
+      entry.workspaceId = tab.workspaceId;
+      entry.url = QUrl(tab.url);
+      entry.initialUrl = tab.initialUrl.isEmpty() ? entry.url : QUrl(tab.initialUrl);
+      entry.pageTitle = tab.pageTitle;
+      entry.customTitle = tab.customTitle;
+      entry.essential = tab.essential;
+      entry.groupId = tab.groupId;
+      entry.faviconUrl = QUrl(tab.faviconUrl);
+      entry.closedAtMs = record.closedAtMs;
+      out.push_back(entry);
+    }
+  }
+
+  return out;
 }
 
 void BrowserController::setRecentlyClosedTabs(const QVector<RecentlyClosedTab>& tabs)
 {
-  m_recentlyClosed = tabs;
-  if (m_recentlyClosed.size() > kMaxRecentlyClosed) {
-    m_recentlyClosed.resize(kMaxRecentlyClosed);
+  const QSignalBlocker blocker(m_closedTabs);
+  m_closedTabs->clear();
+
+  for (int i = tabs.size() - 1; i >= 0; --i) {
+    const RecentlyClosedTab& entry = tabs.at(i);
+
+    ClosedTabJournal::TabRecord record;
+    record.workspaceId = entry.workspaceId;
+    record.groupId = entry.groupId;
+    record.essential = entry.essential;
+    record.url = entry.url.toString(QUrl::FullyEncoded);
+    record.initialUrl = entry.initialUrl.toString(QUrl::FullyEncoded);
+    record.pageTitle = entry.pageTitle;
+    record.customTitle = entry.customTitle;
+    record.faviconUrl = entry.faviconUrl.toString(QUrl::FullyEncoded);
+    m_closedTabs->push(ClosedTabJournal::Kind::Tab, {record}, entry.closedAtMs);
   }
+
   emit recentlyClosedChanged();
 }
 
-void BrowserController::recordRecentlyClosed(const RecentlyClosedTab& tab)
+int BrowserController::restoreClosedRecord(const ClosedTabJournal::Record& record, bool activate)
 {
-  m_recentlyClosed.insert(0, tab);
-  if (m_recentlyClosed.size() > kMaxRecentlyClosed) {
-    m_recentlyClosed.resize(kMaxRecentlyClosed);
+  int restored = 0;
+  int lastWorkspaceIndex = -1;
+  int lastTabIndex = -1;
+
+  for (const ClosedTabJournal::TabRecord& entry : record.tabs) {
+    const int targetWorkspaceIndex = workspaceIndexForId(entry.workspaceId);
+    const int workspaceIndex = targetWorkspaceIndex >= 0 ? targetWorkspaceIndex : m_workspaces.activeIndex();
+    if (workspaceIndex < 0 || workspaceIndex >= m_workspaces.count()) {
+      continue;
+    }
+
+    TabModel* tabs = m_workspaces.tabsForIndex(workspaceIndex);
+    if (!tabs) {
+      continue;
+    }
+
+    TabGroupModel* groups = m_workspaces.groupsForIndex(workspaceIndex);
+    const int restoredIndex = tabs->addClosedTab(entry, false);
+    const int groupId = (groups && entry.groupId > 0 && groups->indexOfGroupId(entry.groupId) >= 0) ? entry.groupId : 0;
+    tabs->setGroupIdAt(restoredIndex, groupId);
+
+    lastWorkspaceIndex = workspaceIndex;
+    lastTabIndex = restoredIndex;
+    restored++;
   }
-  emit recentlyClosedChanged();
+
+  if (activate && lastWorkspaceIndex >= 0) {
+    if (m_workspaces.activeIndex() != lastWorkspaceIndex) {
+      m_workspaces.setActiveIndex(lastWorkspaceIndex);
+    }
+    if (TabModel* tabs = m_workspaces.tabsForIndex(lastWorkspaceIndex)) {
+      tabs->setActiveIndex(lastTabIndex);
+    }
+  }
+
+  return restored;
 }
 
 int BrowserController::workspaceIndexForId(int workspaceId) const
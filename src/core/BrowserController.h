@@ -2,7 +2,11 @@
 
 #include <QObject>
 
+#include <memory>
+
 #include "AppSettings.h"
+#include "ClosedTabJournal.h"
+#include "GlobalTabIndex.h"
 #include "TabModel.h"
 #include "TabGroupModel.h"
 #include "WorkspaceModel.h"
@@ -13,6 +17,7 @@ class BrowserController : public QObject
   Q_PROPERTY(TabModel* tabs READ tabs NOTIFY tabsChanged)
   Q_PROPERTY(TabGroupModel* tabGroups READ tabGroups NOTIFY tabGroupsChanged)
   Q_PROPERTY(WorkspaceModel* workspaces READ workspaces CONSTANT)
+  Q_PROPERTY(GlobalTabIndex* tabIndex READ tabIndex CONSTANT)
   Q_PROPERTY(AppSettings* settings READ settings CONSTANT)
   Q_PROPERTY(int recentlyClosedCount READ recentlyClosedCount NOTIFY recentlyClosedChanged)
 
@@ -31,17 +36,26 @@ public:
   };
 
   explicit BrowserController(QObject* parent = nullptr);
+  // Windows of one process share settings and the recently-closed journal;
+  // both must outlive the controller.
+  BrowserController(AppSettings* settings, ClosedTabJournal* closedTabs, QObject* parent = nullptr);
 
   TabModel* tabs();
   TabGroupModel* tabGroups();
   WorkspaceModel* workspaces();
+  GlobalTabIndex* tabIndex();
   AppSettings* settings();
+  ClosedTabJournal* closedTabJournal();
 
   Q_INVOKABLE int newTab(const QUrl& url = QUrl("https://example.com"));
   Q_INVOKABLE void closeTab(int index);
   Q_INVOKABLE void closeTabById(int tabId);
   Q_INVOKABLE void setActiveIndex(int index);
   Q_INVOKABLE void activateTabById(int tabId);
+  // Switches workspace if needed. Returns false if the tab is gone.
+  Q_INVOKABLE bool activateTabInWorkspace(int workspaceId, int tabId);
+  // Goes back position steps in the tab usage order of all workspaces.
+  Q_INVOKABLE bool activateRecentTab(int position = 1);
 
   Q_INVOKABLE void toggleTabEssentialById(int tabId);
   Q_INVOKABLE void setTabCustomTitleById(int tabId, const QString& title);
@@ -71,6 +85,7 @@ public:
   int recentlyClosedCount() const;
   Q_INVOKABLE QVariantList recentlyClosedItems(int limit = 10) const;
   Q_INVOKABLE bool restoreRecentlyClosed(int index);
+  Q_INVOKABLE int restoreRecentlyClosedRange(int first, int count);
   Q_INVOKABLE void clearRecentlyClosed();
 
   QVector<RecentlyClosedTab> recentlyClosedTabs() const;
@@ -84,13 +99,14 @@ signals:
   void recentlyClosedChanged();
 
 private:
-  static constexpr int kMaxRecentlyClosed = 50;
-
-  void recordRecentlyClosed(const RecentlyClosedTab& tab);
+  int restoreClosedRecord(const ClosedTabJournal::Record& record, bool activate);
   int workspaceIndexForId(int workspaceId) const;
 
+  std::unique_ptr<ClosedTabJournal> m_ownedClosedTabs;
+  std::unique_ptr<AppSettings> m_ownedSettings;
+  ClosedTabJournal* m_closedTabs = nullptr;
+  AppSettings* m_settings = nullptr;
   WorkspaceModel m_workspaces;
-  AppSettings m_settings;
+  GlobalTabIndex m_tabIndex;
   int m_lastWorkspaceIndex = -1;
-  QVector<RecentlyClosedTab> m_recentlyClosed;
 };
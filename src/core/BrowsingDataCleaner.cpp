@@ -0,0 +1,354 @@
+#include "BrowsingDataCleaner.h"
+
+#include "DownloadModel.h"
+#include "FaviconCache.h"
+#include "HistoryStore.h"
+#include "SitePermissionsStore.h"
+#include "ThumbnailStore.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+
+namespace
+{
+// COREWEBVIEW2_BROWSING_DATA_KINDS, kept here so core does not need the
+// WebView2 headers.
+constexpr int kEngineCookies = 0x40;
+constexpr int kEngineDiskCache = 0x100;
+constexpr int kEngineDownloadHistory = 0x200;
+constexpr int kEngineBrowsingHistory = 0x1000;
+
+// Worker threads report file progress this often rather than per file.
+constexpr int kFileProgressStep = 64;
+
+bool hasRange(qint64 fromMs, qint64 toMs)
+{
+  return fromMs > 0 && toMs > fromMs;
+}
+}
+
+BrowsingDataCleaner::BrowsingDataCleaner(QObject* parent)
+  : QObject(parent)
+{
+  // Favicons and thumbnails are deleted side by side.
+  m_pool.setMaxThreadCount(2);
+  m_pool.setExpiryTimeout(10000);
+}
+
+BrowsingDataCleaner::~BrowsingDataCleaner()
+{
+  m_pool.waitForDone();
+}
+
+void BrowsingDataCleaner::setHistory(HistoryStore* history)
+{
+  m_history = history;
+}
+
+void BrowsingDataCleaner::setDownloads(DownloadModel* downloads)
+{
+  m_downloads = downloads;
+}
+
+void BrowsingDataCleaner::setFavicons(FaviconCache* favicons)
+{
+  m_favicons = favicons;
+}
+
+void BrowsingDataCleaner::setSitePermissions(SitePermissionsStore* permissions)
+{
+  m_permissions = permissions;
+}
+
+QObject* BrowsingDataCleaner::view() const
+{
+  return m_view;
+}
+
+void BrowsingDataCleaner::setView(QObject* view)
+{
+  if (m_view == view) {
+    return;
+  }
+  m_view = view;
+  emit viewChanged();
+}
+
+bool BrowsingDataCleaner::running() const
+{
+  return m_running;
+}
+
+double BrowsingDataCleaner::progress() const
+{
+  if (m_parts.isEmpty()) {
+    return m_running ? 0.0 : 1.0;
+  }
+
+  double done = 0.0;
+  for (const double part : m_parts) {
+    done += part;
+  }
+  return done / m_parts.size();
+}
+
+bool BrowsingDataCleaner::clear(int kinds, qint64 fromMs, qint64 toMs)
+{
+  if (m_running || kinds == 0) {
+    return false;
+  }
+
+  if (!hasRange(fromMs, toMs)) {
+    fromMs = 0;
+    toMs = 0;
+  }
+
+  m_parts.clear();
+  m_pendingParts = 0;
+  m_errors.clear();
+  m_running = true;
+  m_starting = true;
+  emit runningChanged();
+  emit progressChanged();
+
+  if ((kinds & History) && m_history) {
+    const QPointer<HistoryStore> history = m_history;
+    startStore([history, fromMs, toMs] {
+      if (!history) {
+        return;
+      }
+      if (hasRange(fromMs, toMs)) {
+        history->clearRange(fromMs, toMs);
+      } else {
+        history->clearAll();
+      }
+    });
+  }
+  if ((kinds & Downloads) && m_downloads) {
+    const QPointer<DownloadModel> downloads = m_downloads;
+    startStore([downloads, fromMs, toMs] {
+      if (!downloads) {
+        return;
+      }
+      if (hasRange(fromMs, toMs)) {
+        downloads->clearRange(fromMs, toMs);
+      } else {
+        downloads->clearAll();
+      }
+    });
+  }
+  if ((kinds & SitePermissions) && m_permissions) {
+    // Decisions carry no timestamps, so they go regardless of the range.
+    const QPointer<SitePermissionsStore> permissions = m_permissions;
+    startStore([permissions] {
+      if (permissions) {
+        permissions->clearAll();
+      }
+    });
+  }
+
+  if (kinds & Cache) {
+    const QString favicons = FaviconCache::cacheDirectory();
+    if (!favicons.isEmpty()) {
+      startFiles(favicons, fromMs, toMs, FileCache::Favicons);
+    }
+    startFiles(ThumbnailStore::directory(), fromMs, toMs, FileCache::Thumbnails);
+  }
+
+  startEngine(kinds, fromMs, toMs);
+
+  // Parts that finished synchronously wait for this, so finished always
+  // arrives after clear() returns.
+  m_starting = false;
+  if (m_pendingParts == 0) {
+    QMetaObject::invokeMethod(this, &BrowsingDataCleaner::finish, Qt::QueuedConnection);
+  }
+  return true;
+}
+
+int BrowsingDataCleaner::engineKinds(int kinds)
+{
+  int engine = 0;
+  if (kinds & History) {
+    engine |= kEngineBrowsingHistory;
+  }
+  if (kinds & Downloads) {
+    engine |= kEngineDownloadHistory;
+  }
+  if (kinds & Cookies) {
+    engine |= kEngineCookies;
+  }
+  if (kinds & Cache) {
+    engine |= kEngineDiskCache;
+  }
+  return engine;
+}
+
+QStringList BrowsingDataCleaner::removeFiles(const QString& dir, qint64 fromMs, qint64 toMs, const FileProgress& progress)
+{
+  QStringList candidates;
+  QDirIterator it(dir, QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QString path = it.next();
+    if (hasRange(fromMs, toMs)) {
+      const qint64 modifiedMs = it.fileInfo().lastModified().toMSecsSinceEpoch();
+      if (modifiedMs < fromMs || modifiedMs >= toMs) {
+        continue;
+      }
+    }
+    candidates.push_back(path);
+  }
+
+  QStringList removed;
+  removed.reserve(candidates.size());
+  const int total = candidates.size();
+  for (int i = 0; i < total; ++i) {
+    if (QFile::remove(candidates.at(i))) {
+      removed.push_back(candidates.at(i));
+    }
+    if (progress && ((i + 1) % kFileProgressStep == 0 || i + 1 == total)) {
+      progress(i + 1, total);
+    }
+  }
+  return removed;
+}
+
+void BrowsingDataCleaner::onBrowsingDataCleared(int dataKinds, bool success, const QString& error)
+{
+  // The view also reports clears other callers asked for.
+  if (m_enginePart < 0 || dataKinds != m_engineKinds) {
+    return;
+  }
+
+  if (m_engineView) {
+    disconnect(m_engineView, nullptr, this, nullptr);
+  }
+  m_engineView = nullptr;
+  const int part = m_enginePart;
+  m_enginePart = -1;
+  completePart(part, success ? QString() : (error.isEmpty() ? QStringLiteral("Web engine clear failed") : error));
+}
+
+int BrowsingDataCleaner::addPart()
+{
+  m_parts.push_back(0.0);
+  ++m_pendingParts;
+  return m_parts.size() - 1;
+}
+
+void BrowsingDataCleaner::setPartProgress(int part, double fraction)
+{
+  if (part < 0 || part >= m_parts.size() || m_parts.at(part) >= fraction) {
+    return;
+  }
+  m_parts[part] = qBound(0.0, fraction, 1.0);
+  emit progressChanged();
+}
+
+void BrowsingDataCleaner::completePart(int part, const QString& error)
+{
+  if (part < 0 || part >= m_parts.size()) {
+    return;
+  }
+
+  m_parts[part] = 1.0;
+  if (!error.isEmpty()) {
+    m_errors.push_back(error);
+  }
+  emit progressChanged();
+
+  if (--m_pendingParts > 0 || m_starting) {
+    return;
+  }
+  finish();
+}
+
+void BrowsingDataCleaner::finish()
+{
+  m_running = false;
+  emit runningChanged();
+  emit finished(m_errors.isEmpty(), m_errors.join(QStringLiteral("; ")));
+}
+
+void BrowsingDataCleaner::startEngine(int kinds, qint64 fromMs, qint64 toMs)
+{
+  const int engine = engineKinds(kinds);
+  if (engine == 0) {
+    return;
+  }
+
+  QObject* view = m_view;
+  const bool usable = view && view->metaObject()->indexOfSignal("browsingDataCleared(int,bool,QString)") >= 0;
+  if (!usable) {
+    // History and downloads are ours; only cookies and the HTTP cache need
+    // the engine.
+    if (kinds & (Cookies | Cache)) {
+      m_errors.push_back(QStringLiteral("Web engine unavailable (could not clear cookies/cache)"));
+    }
+    return;
+  }
+
+  m_enginePart = addPart();
+  m_engineKinds = engine;
+  m_engineView = view;
+  connect(view, SIGNAL(browsingDataCleared(int, bool, QString)), this, SLOT(onBrowsingDataCleared(int, bool, QString)));
+  connect(view, &QObject::destroyed, this, [this] {
+    m_engineView = nullptr;
+    const int part = m_enginePart;
+    m_enginePart = -1;
+    completePart(part, QStringLiteral("The tab closed before its data was cleared"));
+  });
+
+  const bool invoked = QMetaObject::invokeMethod(view, "clearBrowsingData", Q_ARG(int, engine), Q_ARG(qint64, fromMs), Q_ARG(qint64, toMs));
+  if (!invoked && m_enginePart >= 0) {
+    disconnect(view, nullptr, this, nullptr);
+    m_engineView = nullptr;
+    const int part = m_enginePart;
+    m_enginePart = -1;
+    completePart(part, QStringLiteral("Web engine cannot clear browsing data"));
+  }
+}
+
+void BrowsingDataCleaner::startFiles(const QString& dir, qint64 fromMs, qint64 toMs, FileCache cache)
+{
+  const int part = addPart();
+  m_pool.start([this, part, dir, fromMs, toMs, cache] {
+    const QStringList removed = removeFiles(dir, fromMs, toMs, [this, part](int done, int total) {
+      QMetaObject::invokeMethod(
+        this,
+        [this, part, done, total] {
+          setPartProgress(part, double(done) / total);
+        },
+        Qt::QueuedConnection);
+    });
+
+    QMetaObject::invokeMethod(
+      this,
+      [this, part, removed, cache] {
+        if (cache == FileCache::Thumbnails) {
+          ThumbnailStore::instance().forgetDiskFiles(removed);
+        } else if (m_favicons) {
+          // Otherwise the next save would write the cleared hosts back.
+          m_favicons->forgetDiskFiles(removed);
+        }
+        completePart(part);
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+void BrowsingDataCleaner::startStore(const std::function<void()>& clearStore)
+{
+  // One store per event-loop turn, so the window repaints in between.
+  const int part = addPart();
+  QMetaObject::invokeMethod(
+    this,
+    [this, part, clearStore] {
+      clearStore();
+      completePart(part);
+    },
+    Qt::QueuedConnection);
+}
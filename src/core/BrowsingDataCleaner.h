@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+class DownloadModel;
+class FaviconCache;
+class HistoryStore;
+class SitePermissionsStore;
+
+// Clears browsing data across the web engine, the in-memory stores and the
+// on-disk caches in one go. The engine clears in its own process, cache
+// files are deleted on worker threads, and each store is cleared in its own
+// GUI-thread turn with a single model reset, so the window keeps painting
+// while a large profile is cleared. progress covers every part; finished
+// fires once all of them are done.
+class BrowsingDataCleaner final : public QObject
+{
+  Q_OBJECT
+  // Any object with clearBrowsingData(int, qint64, qint64) and a
+  // browsingDataCleared(int, bool, QString) signal, i.e. a WebView2View.
+  Q_PROPERTY(QObject* view READ view WRITE setView NOTIFY viewChanged)
+  Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+  Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+
+public:
+  enum DataKind
+  {
+    History = 0x1,
+    Downloads = 0x2,
+    Cookies = 0x4,
+    Cache = 0x8,
+    SitePermissions = 0x10,
+  };
+  Q_ENUM(DataKind)
+
+  using FileProgress = std::function<void(int done, int total)>;
+
+  explicit BrowsingDataCleaner(QObject* parent = nullptr);
+  ~BrowsingDataCleaner() override;
+
+  void setHistory(HistoryStore* history);
+  void setDownloads(DownloadModel* downloads);
+  void setFavicons(FaviconCache* favicons);
+  void setSitePermissions(SitePermissionsStore* permissions);
+
+  QObject* view() const;
+  void setView(QObject* view);
+
+  bool running() const;
+  double progress() const;
+
+  // kinds is a DataKind mask. A zero or empty range clears all time. Returns
+  // false if a clear is already running or nothing was selected.
+  Q_INVOKABLE bool clear(int kinds, qint64 fromMs, qint64 toMs);
+
+  // COREWEBVIEW2_BROWSING_DATA_KINDS for the engine side of kinds.
+  static int engineKinds(int kinds);
+
+  // Synchronous; safe to call from any thread. Deletes the files under dir
+  // last modified in [fromMs, toMs), or all of them for an empty range, and
+  // returns their paths.
+  static QStringList removeFiles(const QString& dir, qint64 fromMs, qint64 toMs, const FileProgress& progress = {});
+
+signals:
+  void viewChanged();
+  void runningChanged();
+  void progressChanged();
+  void finished(bool success, const QString& error);
+
+private slots:
+  void onBrowsingDataCleared(int dataKinds, bool success, const QString& error);
+
+private:
+  enum class FileCache
+  {
+    Favicons,
+    Thumbnails,
+  };
+
+  int addPart();
+  void setPartProgress(int part, double fraction);
+  void completePart(int part, const QString& error = {});
+  void finish();
+  void startEngine(int kinds, qint64 fromMs, qint64 toMs);
+  void startFiles(const QString& dir, qint64 fromMs, qint64 toMs, FileCache cache);
+  void startStore(const std::function<void()>& clearStore);
+
+  QThreadPool m_pool;
+  QPointer<HistoryStore> m_history;
+  QPointer<DownloadModel> m_downloads;
+  QPointer<FaviconCache> m_favicons;
+  QPointer<SitePermissionsStore> m_permissions;
+  QPointer<QObject> m_view;
+
+  QPointer<QObject> m_engineView;
+  int m_enginePart = -1;
+  int m_engineKinds = 0;
+
+  // Completion of each part of the running clear, 0..1.
+  QVector<double> m_parts;
+  int m_pendingParts = 0;
+  QStringList m_errors;
+  bool m_running = false;
+  bool m_starting = false;
+};
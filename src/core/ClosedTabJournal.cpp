@@ -0,0 +1,469 @@
+#include "ClosedTabJournal.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+namespace
+{
+constexpr int kDefaultCapacity = 50;
+constexpr qint64 kDefaultByteBudget = 128LL * 1024LL;
+constexpr int kMinLogLinesBeforeCompact = 32;
+
+QJsonObject tabToJson(const ClosedTabJournal::TabRecord& tab)
+{
+  QJsonObject obj;
+  if (tab.workspaceId != 0) {
+    obj.insert(QStringLiteral("workspaceId"), tab.workspaceId);
+  }
+  if (tab.groupId != 0) {
+    obj.insert(QStringLiteral("groupId"), tab.groupId);
+  }
+  if (tab.essential) {
+    obj.insert(QStringLiteral("essential"), true);
+  }
+  obj.insert(QStringLiteral("url"), tab.url);
+  if (!tab.initialUrl.isEmpty()) {
+    obj.insert(QStringLiteral("initialUrl"), tab.initialUrl);
+  }
+  if (!tab.pageTitle.isEmpty()) {
+    obj.insert(QStringLiteral("pageTitle"), tab.pageTitle);
+  }
+  if (!tab.customTitle.isEmpty()) {
+    obj.insert(QStringLiteral("customTitle"), tab.customTitle);
+  }
+  if (!tab.faviconUrl.isEmpty()) {
+    obj.insert(QStringLiteral("faviconUrl"), tab.faviconUrl);
+  }
+  return obj;
+}
+
+ClosedTabJournal::TabRecord tabFromJson(const QJsonObject& obj)
+{
+  ClosedTabJournal::TabRecord tab;
+  tab.workspaceId = obj.value(QStringLiteral("workspaceId")).toInt(0);
+  tab.groupId = obj.value(QStringLiteral("groupId")).toInt(0);
+  tab.essential = obj.value(QStringLiteral("essential")).toBool(false);
+  tab.url = obj.value(QStringLiteral("url")).toString();
+  tab.initialUrl = obj.value(QStringLiteral("initialUrl")).toString();
+  tab.pageTitle = obj.value(QStringLiteral("pageTitle")).toString();
+  tab.customTitle = obj.value(QStringLiteral("customTitle")).toString();
+  tab.faviconUrl = obj.value(QStringLiteral("faviconUrl")).toString();
+  return tab;
+}
+
+QJsonObject pushToJson(const ClosedTabJournal::Record& record)
+{
+  QJsonArray tabsArr;
+  for (const auto& tab : record.tabs) {
+    tabsArr.push_back(tabToJson(tab));
+  }
+
+  QJsonObject obj;
+  obj.insert(QStringLiteral("op"), QStringLiteral("push"));
+  obj.insert(QStringLiteral("seq"), static_cast<double>(record.seq));
+  obj.insert(QStringLiteral("kind"), static_cast<int>(record.kind));
+  obj.insert(QStringLiteral("closedAtMs"), static_cast<double>(record.closedAtMs));
+  obj.insert(QStringLiteral("tabs"), tabsArr);
+  return obj;
+}
+}
+
+ClosedTabJournal::ClosedTabJournal(QObject* parent)
+  : ClosedTabJournal(kDefaultCapacity, kDefaultByteBudget, parent)
+{
+}
+
+ClosedTabJournal::ClosedTabJournal(int capacity, qint64 byteBudget, QObject* parent)
+  : QObject(parent)
+  , m_capacity(qMax(1, capacity))
+  , m_byteBudget(qMax<qint64>(0, byteBudget))
+{
+}
+
+int ClosedTabJournal::capacity() const
+{
+  return m_capacity;
+}
+
+qint64 ClosedTabJournal::byteBudget() const
+{
+  return m_byteBudget;
+}
+
+void ClosedTabJournal::setByteBudget(qint64 bytes)
+{
+  const qint64 next = qMax<qint64>(0, bytes);
+  if (m_byteBudget == next) {
+    return;
+  }
+
+  const int before = m_count;
+  m_byteBudget = next;
+  evictOverBudget();
+  if (m_count != before) {
+    emit changed();
+  }
+}
+
+qint64 ClosedTabJournal::bytesUsed() const
+{
+  return m_bytesUsed;
+}
+
+int ClosedTabJournal::count() const
+{
+  return m_count;
+}
+
+bool ClosedTabJournal::isEmpty() const
+{
+  return m_count == 0;
+}
+
+const ClosedTabJournal::Record& ClosedTabJournal::at(int index) const
+{
+  Q_ASSERT(index >= 0 && index < m_count);
+  return m_ring.at(slotForIndex(index));
+}
+
+int ClosedTabJournal::newestIndexForWorkspace(int workspaceId, Kind kind) const
+{
+  for (int i = 0; i < m_count; ++i) {
+    const Record& record = m_ring.at(slotForIndex(i));
+    if (record.kind != kind || record.tabs.isEmpty()) {
+      continue;
+    }
+    if (record.tabs.first().workspaceId == workspaceId) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+quint64 ClosedTabJournal::push(Kind kind, const QVector<TabRecord>& tabs, qint64 closedAtMs)
+{
+  if (tabs.isEmpty()) {
+    return 0;
+  }
+
+  Record record;
+  record.seq = m_nextSeq++;
+  record.kind = kind;
+  record.closedAtMs = closedAtMs > 0 ? closedAtMs : QDateTime::currentMSecsSinceEpoch();
+  record.tabs = tabs;
+  for (auto& tab : record.tabs) {
+    if (tab.initialUrl == tab.url) {
+      tab.initialUrl.clear();
+    }
+  }
+
+  pushRecord(record);
+  appendLogLine(pushToJson(record));
+  emit changed();
+  return record.seq;
+}
+
+ClosedTabJournal::Record ClosedTabJournal::takeAt(int index)
+{
+  if (index < 0 || index >= m_count) {
+    return {};
+  }
+
+  Record record = removeAtInternal(index);
+
+  QJsonObject obj;
+  obj.insert(QStringLiteral("op"), QStringLiteral("take"));
+  obj.insert(QStringLiteral("seq"), static_cast<double>(record.seq));
+  appendLogLine(obj);
+
+  emit changed();
+  return record;
+}
+
+ClosedTabJournal::Record ClosedTabJournal::takeNewest()
+{
+  return takeAt(0);
+}
+
+QVector<ClosedTabJournal::Record> ClosedTabJournal::takeRange(int first, int count)
+{
+  if (first < 0 || first >= m_count || count <= 0) {
+    return {};
+  }
+
+  const QVector<Record> out = removeRangeInternal(first, qMin(count, m_count - first));
+
+  QJsonArray seqs;
+  for (const Record& record : out) {
+    seqs.push_back(static_cast<double>(record.seq));
+  }
+  QJsonObject obj;
+  obj.insert(QStringLiteral("op"), QStringLiteral("take"));
+  obj.insert(QStringLiteral("seqs"), seqs);
+  appendLogLine(obj);
+
+  emit changed();
+  return out;
+}
+
+void ClosedTabJournal::clear()
+{
+  if (m_count == 0 && m_ring.isEmpty()) {
+    return;
+  }
+
+  m_ring.clear();
+  m_head = 0;
+  m_count = 0;
+  m_bytesUsed = 0;
+
+  QJsonObject obj;
+  obj.insert(QStringLiteral("op"), QStringLiteral("clear"));
+  appendLogLine(obj);
+
+  emit changed();
+}
+
+QString ClosedTabJournal::storagePath() const
+{
+  return m_storagePath;
+}
+
+void ClosedTabJournal::setStoragePath(const QString& path)
+{
+  if (m_storagePath == path) {
+    return;
+  }
+
+  m_storagePath = path;
+  m_logLines = 0;
+  if (m_storagePath.isEmpty()) {
+    return;
+  }
+
+  if (!QFile::exists(m_storagePath)) {
+    if (m_count > 0) {
+      compactNow();
+    }
+    return;
+  }
+
+  load();
+  emit changed();
+}
+
+bool ClosedTabJournal::compactNow()
+{
+  if (m_storagePath.isEmpty()) {
+    return false;
+  }
+
+  QByteArray payload;
+  for (int i = m_count - 1; i >= 0; --i) {
+    payload += QJsonDocument(pushToJson(m_ring.at(slotForIndex(i)))).toJson(QJsonDocument::Compact);
+    payload += '\n';
+  }
+
+  QSaveFile out(m_storagePath);
+  if (!out.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  out.write(payload);
+  if (!out.commit()) {
+    return false;
+  }
+
+  m_logLines = m_count;
+  return true;
+}
+
+qint64 ClosedTabJournal::recordBytes(const Record& record)
+{
+  qint64 bytes = sizeof(Record);
+  for (const auto& tab : record.tabs) {
+    bytes += sizeof(TabRecord);
+    const qint64 chars = tab.url.size() + tab.initialUrl.size() + tab.pageTitle.size() + tab.customTitle.size()
+                         + tab.faviconUrl.size();
+    bytes += chars * static_cast<qint64>(sizeof(QChar));
+  }
+  return bytes;
+}
+
+int ClosedTabJournal::slotForIndex(int index) const
+{
+  const int fromOldest = m_count - 1 - index;
+  return (m_head + fromOldest) % m_ring.size();
+}
+
+void ClosedTabJournal::pushRecord(const Record& record)
+{
+  if (m_count == m_capacity) {
+    m_bytesUsed -= recordBytes(m_ring.at(m_head));
+    m_ring[m_head] = Record();
+    m_head = (m_head + 1) % m_ring.size();
+    m_count--;
+  }
+
+  if (m_count == m_ring.size()) {
+    if (m_head != 0) {
+      QVector<Record> linear;
+      linear.reserve(m_count + 1);
+      for (int i = m_count - 1; i >= 0; --i) {
+        linear.push_back(std::move(m_ring[slotForIndex(i)]));
+      }
+      m_ring = std::move(linear);
+      m_head = 0;
+    }
+    m_ring.push_back(Record());
+  }
+
+  m_count++;
+  m_ring[slotForIndex(0)] = record;
+  m_bytesUsed += recordBytes(record);
+  if (record.seq >= m_nextSeq) {
+    m_nextSeq = record.seq + 1;
+  }
+
+  evictOverBudget();
+}
+
+void ClosedTabJournal::evictOverBudget()
+{
+  while (m_count > 1 && m_bytesUsed > m_byteBudget) {
+    m_bytesUsed -= recordBytes(m_ring.at(m_head));
+    m_ring[m_head] = Record();
+    m_head = (m_head + 1) % m_ring.size();
+    m_count--;
+  }
+}
+
+ClosedTabJournal::Record ClosedTabJournal::removeAtInternal(int index)
+{
+  return removeRangeInternal(index, 1).takeFirst();
+}
+
+QVector<ClosedTabJournal::Record> ClosedTabJournal::removeRangeInternal(int first, int count)
+{
+  const int size = m_ring.size();
+  const int oldestRemoved = m_count - first - count;
+
+  QVector<Record> out;
+  out.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    Record& slot = m_ring[(m_head + m_count - 1 - first - i) % size];
+    m_bytesUsed -= recordBytes(slot);
+    out.push_back(std::move(slot));
+  }
+
+  // Newer records slide down over the gap in one pass.
+  for (int k = oldestRemoved; k + count < m_count; ++k) {
+    m_ring[(m_head + k) % size] = std::move(m_ring[(m_head + k + count) % size]);
+  }
+  for (int k = m_count - count; k < m_count; ++k) {
+    m_ring[(m_head + k) % size] = Record();
+  }
+  m_count -= count;
+
+  if (m_count == 0) {
+    m_head = 0;
+  }
+  return out;
+}
+
+void ClosedTabJournal::load()
+{
+  QFile f(m_storagePath);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  m_ring.clear();
+  m_head = 0;
+  m_count = 0;
+  m_bytesUsed = 0;
+  m_logLines = 0;
+  m_replaying = true;
+
+  while (!f.atEnd()) {
+    const QByteArray line = f.readLine().trimmed();
+    if (line.isEmpty()) {
+      continue;
+    }
+    m_logLines++;
+
+    const QJsonObject obj = QJsonDocument::fromJson(line).object();
+    const QString op = obj.value(QStringLiteral("op")).toString();
+
+    if (op == QStringLiteral("push")) {
+      Record record;
+      record.seq = static_cast<quint64>(obj.value(QStringLiteral("seq")).toDouble(0));
+      record.kind = obj.value(QStringLiteral("kind")).toInt(0) == static_cast<int>(Kind::Window) ? Kind::Window
+                                                                                                 : Kind::Tab;
+      record.closedAtMs = static_cast<qint64>(obj.value(QStringLiteral("closedAtMs")).toDouble(0));
+      const QJsonArray tabsArr = obj.value(QStringLiteral("tabs")).toArray();
+      record.tabs.reserve(tabsArr.size());
+      for (const QJsonValue& v : tabsArr) {
+        record.tabs.push_back(tabFromJson(v.toObject()));
+      }
+      if (record.seq == 0) {
+        record.seq = m_nextSeq;
+      }
+      if (!record.tabs.isEmpty()) {
+        pushRecord(record);
+      }
+    } else if (op == QStringLiteral("take")) {
+      // takeRange writes one line for the whole range.
+      QJsonArray seqs = obj.value(QStringLiteral("seqs")).toArray();
+      if (obj.contains(QStringLiteral("seq"))) {
+        seqs.push_back(obj.value(QStringLiteral("seq")));
+      }
+      for (const QJsonValue& value : seqs) {
+        const quint64 seq = static_cast<quint64>(value.toDouble(0));
+        for (int i = 0; i < m_count; ++i) {
+          if (m_ring.at(slotForIndex(i)).seq == seq) {
+            removeAtInternal(i);
+            break;
+          }
+        }
+      }
+    } else if (op == QStringLiteral("clear")) {
+      m_ring.clear();
+      m_head = 0;
+      m_count = 0;
+      m_bytesUsed = 0;
+    }
+  }
+
+  m_replaying = false;
+  maybeCompact();
+}
+
+void ClosedTabJournal::appendLogLine(const QJsonObject& obj)
+{
+  if (m_replaying || m_storagePath.isEmpty()) {
+    return;
+  }
+
+  QFile f(m_storagePath);
+  if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    return;
+  }
+  f.write(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+  f.write("\n");
+  f.close();
+
+  m_logLines++;
+  maybeCompact();
+}
+
+void ClosedTabJournal::maybeCompact()
+{
+  if (m_logLines <= qMax(kMinLogLinesBeforeCompact, m_count * 2)) {
+    return;
+  }
+  compactNow();
+}
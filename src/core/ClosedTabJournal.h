@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class QJsonObject;
+
+class ClosedTabJournal final : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum class Kind
+  {
+    Tab = 0,
+    Window = 1,
+  };
+
+  struct TabRecord
+  {
+    int workspaceId = 0;
+    int groupId = 0;
+    bool essential = false;
+    QString url;
+    QString initialUrl;
+    QString pageTitle;
+    QString customTitle;
+    QString faviconUrl;
+  };
+
+  struct Record
+  {
+    quint64 seq = 0;
+    Kind kind = Kind::Tab;
+    qint64 closedAtMs = 0;
+    QVector<TabRecord> tabs;
+  };
+
+  explicit ClosedTabJournal(QObject* parent = nullptr);
+  ClosedTabJournal(int capacity, qint64 byteBudget, QObject* parent = nullptr);
+
+  int capacity() const;
+  qint64 byteBudget() const;
+  void setByteBudget(qint64 bytes);
+  qint64 bytesUsed() const;
+
+  int count() const;
+  bool isEmpty() const;
+  const Record& at(int index) const;
+  int newestIndexForWorkspace(int workspaceId, Kind kind = Kind::Tab) const;
+
+  quint64 push(Kind kind, const QVector<TabRecord>& tabs, qint64 closedAtMs = 0);
+  Record takeAt(int index);
+  Record takeNewest();
+  QVector<Record> takeRange(int first, int count);
+  void clear();
+
+  QString storagePath() const;
+  void setStoragePath(const QString& path);
+  bool compactNow();
+
+  static qint64 recordBytes(const Record& record);
+
+signals:
+  void changed();
+
+private:
+  int slotForIndex(int index) const;
+  void pushRecord(const Record& record);
+  void evictOverBudget();
+  Record removeAtInternal(int index);
+  QVector<Record> removeRangeInternal(int first, int count);
+
+  void load();
+  void appendLogLine(const QJsonObject& obj);
+  void maybeCompact();
+
+  QVector<Record> m_ring;
+  int m_capacity = 0;
+  int m_head = 0;
+  int m_count = 0;
+  qint64 m_byteBudget = 0;
+  qint64 m_bytesUsed = 0;
+  quint64 m_nextSeq = 1;
+
+  QString m_storagePath;
+  int m_logLines = 0;
+  bool m_replaying = false;
+};
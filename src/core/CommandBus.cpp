@@ -1,16 +1,194 @@
 #include "CommandBus.h"
 
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <bit>
+
 CommandBus::CommandBus(QObject* parent)
   : QObject(parent)
 {
 }
 
-void CommandBus::invoke(const QString& id, const QVariantMap& args)
+int CommandBus::registerCommand(const CommandInfo& info, Handler handler)
+{
+  CommandInfo normalized = info;
+  normalized.id = info.id.trimmed();
+  if (normalized.id.isEmpty()) {
+    return -1;
+  }
+  normalized.title = info.title.trimmed();
+
+  const auto it = m_index.constFind(normalized.id);
+  if (it != m_index.constEnd()) {
+    Entry& entry = m_commands[it.value()];
+    entry.info = normalized;
+    entry.handler = std::move(handler);
+    emit commandsChanged();
+    return it.value();
+  }
+
+  Entry entry;
+  entry.info = normalized;
+  entry.handler = std::move(handler);
+  m_commands.push_back(std::move(entry));
+
+  const int commandId = m_commands.size() - 1;
+  m_index.insert(normalized.id, commandId);
+  emit commandsChanged();
+  return commandId;
+}
+
+int CommandBus::commandId(const QString& id) const
+{
+  const auto it = m_index.constFind(id);
+  if (it != m_index.constEnd()) {
+    return it.value();
+  }
+  return m_index.value(id.trimmed(), -1);
+}
+
+int CommandBus::commandCount() const
+{
+  return m_commands.size();
+}
+
+bool CommandBus::hasCommand(const QString& id) const
+{
+  return commandId(id) >= 0;
+}
+
+bool CommandBus::invoke(const QString& id, const QVariantMap& args)
+{
+  return invoke(commandId(id), args);
+}
+
+bool CommandBus::invoke(int commandId, const QVariantMap& args)
+{
+  if (commandId < 0 || commandId >= m_commands.size()) {
+    return false;
+  }
+
+  // Copied: a handler may register commands, which can move the entry or
+  // replace the handler while it runs.
+  const Handler handler = m_commands.at(commandId).handler;
+
+  QElapsedTimer timer;
+  timer.start();
+  if (handler) {
+    handler(args);
+  } else {
+    emit commandInvoked(m_commands.at(commandId).info.id, args);
+  }
+  const qint64 elapsedNs = timer.nsecsElapsed();
+
+  Stats& stats = m_commands[commandId].stats;
+  ++stats.invocations;
+  stats.totalNs += elapsedNs;
+  stats.maxNs = std::max(stats.maxNs, elapsedNs);
+  const auto micros = static_cast<quint64>(std::max<qint64>(0, elapsedNs / 1000));
+  const int bucket = std::min(kLatencyBuckets - 1, static_cast<int>(std::bit_width(micros)));
+  ++stats.histogram[static_cast<size_t>(bucket)];
+  return true;
+}
+
+QVariantList CommandBus::searchCommands(const QString& query, int limit) const
+{
+  const QString trimmed = query.trimmed();
+
+  struct Hit
+  {
+    int score = 0;
+    int commandId = 0;
+  };
+
+  QVector<Hit> hits;
+  for (int i = 0; i < m_commands.size(); ++i) {
+    const CommandInfo& info = m_commands.at(i).info;
+    if (info.title.isEmpty()) {
+      continue;
+    }
+
+    const int score = matchScore(trimmed, info.title);
+    if (score >= 0) {
+      hits.push_back({ score, i });
+    }
+  }
+
+  std::stable_sort(hits.begin(), hits.end(), [this](const Hit& a, const Hit& b) {
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    return m_commands.at(a.commandId).stats.invocations > m_commands.at(b.commandId).stats.invocations;
+  });
+
+  QVariantList out;
+  for (const Hit& hit : hits) {
+    if (limit > 0 && out.size() >= limit) {
+      break;
+    }
+
+    const Entry& entry = m_commands.at(hit.commandId);
+    QVariantMap row;
+    row.insert(QStringLiteral("command"), entry.info.id);
+    row.insert(QStringLiteral("title"), entry.info.title);
+    row.insert(QStringLiteral("group"), entry.info.group);
+    row.insert(QStringLiteral("shortcut"), entry.info.shortcut);
+    row.insert(QStringLiteral("score"), hit.score);
+    row.insert(QStringLiteral("invocations"), static_cast<double>(entry.stats.invocations));
+    out.push_back(row);
+  }
+  return out;
+}
+
+CommandBus::Stats CommandBus::stats(const QString& id) const
+{
+  const int index = commandId(id);
+  return index >= 0 ? m_commands.at(index).stats : Stats {};
+}
+
+QVariantMap CommandBus::commandStats(const QString& id) const
+{
+  const Stats s = stats(id);
+
+  QVariantList histogram;
+  for (const quint32 count : s.histogram) {
+    histogram.push_back(count);
+  }
+
+  QVariantMap out;
+  out.insert(QStringLiteral("invocations"), static_cast<double>(s.invocations));
+  out.insert(QStringLiteral("totalUs"), static_cast<double>(s.totalNs / 1000));
+  out.insert(QStringLiteral("maxUs"), static_cast<double>(s.maxNs / 1000));
+  out.insert(QStringLiteral("meanUs"), s.invocations > 0 ? static_cast<double>(s.totalNs) / 1000.0 / static_cast<double>(s.invocations) : 0.0);
+  out.insert(QStringLiteral("histogram"), histogram);
+  return out;
+}
+
+void CommandBus::resetStats()
 {
-  const QString trimmed = id.trimmed();
-  if (trimmed.isEmpty()) {
-    return;
+  for (Entry& entry : m_commands) {
+    entry.stats = {};
   }
-  emit commandInvoked(trimmed, args);
 }
 
+int CommandBus::matchScore(const QString& query, const QString& target)
+{
+  // Same subsequence scoring as the omnibox: consecutive characters score
+  // higher than scattered ones.
+  if (query.isEmpty()) {
+    return 0;
+  }
+
+  int ti = 0;
+  int score = 0;
+  for (const QChar ch : query) {
+    const int found = target.indexOf(ch, ti, Qt::CaseInsensitive);
+    if (found < 0) {
+      return -1;
+    }
+    score += (found == ti) ? 3 : 1;
+    ti = found + 1;
+  }
+  return score;
+}
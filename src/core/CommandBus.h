@@ -1,18 +1,84 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QVariantMap>
+#include <QVector>
 
+#include <array>
+#include <functional>
+
+// Registry of every command the UI can run. Commands are registered once
+// and dispatched through a hash lookup of their id. Commands registered
+// without a C++ handler belong to the focused window's QML, which receives
+// them through commandInvoked.
 class CommandBus : public QObject
 {
   Q_OBJECT
+  Q_PROPERTY(int commandCount READ commandCount NOTIFY commandsChanged)
 
 public:
+  using Handler = std::function<void(const QVariantMap& args)>;
+
+  // Bucket i counts invocations that took less than 2^i microseconds (and
+  // at least 2^(i-1)); the last bucket also takes everything slower.
+  static constexpr int kLatencyBuckets = 16;
+
+  struct CommandInfo
+  {
+    QString id;
+    // Commands without a title need arguments the palette cannot supply
+    // and are left out of searchCommands.
+    QString title;
+    QString group;
+    QString shortcut;
+  };
+
+  struct Stats
+  {
+    quint64 invocations = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    std::array<quint32, kLatencyBuckets> histogram {};
+  };
+
   explicit CommandBus(QObject* parent = nullptr);
 
-  Q_INVOKABLE void invoke(const QString& id, const QVariantMap& args = {});
+  // Returns the interned id for invoke(int), or -1 for an empty id.
+  // Registering an id again replaces its info and handler but keeps its
+  // interned id and stats.
+  int registerCommand(const CommandInfo& info, Handler handler = {});
+  int commandId(const QString& id) const;
+  int commandCount() const;
+
+  Q_INVOKABLE bool hasCommand(const QString& id) const;
+
+  // Returns false for ids nobody registered.
+  Q_INVOKABLE bool invoke(const QString& id, const QVariantMap& args = {});
+  bool invoke(int commandId, const QVariantMap& args = {});
+
+  // Listed commands matching query as a subsequence of their title, best
+  // match first and more frequently used commands first among equals.
+  Q_INVOKABLE QVariantList searchCommands(const QString& query, int limit = 50) const;
+
+  Stats stats(const QString& id) const;
+  Q_INVOKABLE QVariantMap commandStats(const QString& id) const;
+  Q_INVOKABLE void resetStats();
 
 signals:
   void commandInvoked(const QString& id, const QVariantMap& args);
-};
+  void commandsChanged();
 
+private:
+  struct Entry
+  {
+    CommandInfo info;
+    Handler handler;
+    Stats stats;
+  };
+
+  static int matchScore(const QString& query, const QString& target);
+
+  QVector<Entry> m_commands;
+  QHash<QString, int> m_index;
+};
@@ -0,0 +1,162 @@
+#include "ContentBlocker.h"
+
+#include "AppPaths.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace
+{
+quint64 listsStamp(const QFileInfoList& lists)
+{
+  if (lists.isEmpty()) {
+    return 0;
+  }
+
+  quint64 h = 1469598103934665603ULL;
+  auto mix = [&h](const QByteArray& bytes) {
+    for (char c : bytes) {
+      h ^= static_cast<uchar>(c);
+      h *= 1099511628211ULL;
+    }
+    h ^= 0xFF;
+    h *= 1099511628211ULL;
+  };
+  for (const QFileInfo& info : lists) {
+    mix(info.fileName().toUtf8());
+    mix(QByteArray::number(info.size()));
+    mix(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+  }
+  return h == 0 ? 1 : h;
+}
+}
+
+ContentBlocker& ContentBlocker::instance()
+{
+  static ContentBlocker blocker;
+  return blocker;
+}
+
+ContentBlocker::ContentBlocker(QObject* parent)
+  : QObject(parent)
+{
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(5000);
+}
+
+ContentBlocker::~ContentBlocker()
+{
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
+QString ContentBlocker::filterListsDir()
+{
+  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("filters"));
+}
+
+QString ContentBlocker::compiledPath()
+{
+  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("content_filter.bin"));
+}
+
+void ContentBlocker::reloadAsync()
+{
+  const int generation = ++m_generation;
+  const QString listsDir = filterListsDir();
+  const QString blobPath = compiledPath();
+
+  ++m_pendingReloads;
+  m_pool.start([this, generation, listsDir, blobPath] {
+    const QFileInfoList lists =
+      QDir(listsDir).entryInfoList({ QStringLiteral("*.txt") }, QDir::Files | QDir::Readable, QDir::Name);
+    const quint64 stamp = listsStamp(lists);
+
+    auto engine = std::make_shared<ContentFilterEngine>();
+    bool compiled = false;
+    if (lists.isEmpty()) {
+      QFile::remove(blobPath);
+    } else if (ContentFilterEngine::fileSourceStamp(blobPath) != stamp || !engine->loadFile(blobPath)) {
+      QStringList texts;
+      texts.reserve(lists.size());
+      for (const QFileInfo& info : lists) {
+        QFile f(info.filePath());
+        if (f.open(QIODevice::ReadOnly)) {
+          texts.push_back(QString::fromUtf8(f.readAll()));
+        }
+      }
+
+      const QByteArray blob = ContentFilterEngine::compile(texts, stamp);
+      compiled = true;
+
+      // The previous blob may still be mapped by the live engine, which can
+      // make the replace fail on Windows; serve from memory in that case.
+      QSaveFile out(blobPath);
+      const bool saved = out.open(QIODevice::WriteOnly) && out.write(blob) == blob.size() && out.commit();
+      if (!saved || !engine->loadFile(blobPath) || engine->sourceStamp() != stamp) {
+        engine->loadBlob(blob);
+      }
+    }
+
+    QMetaObject::invokeMethod(
+      this,
+      [this, generation, engine, compiled] {
+        m_pendingReloads = qMax(0, m_pendingReloads - 1);
+        if (generation != m_generation) {
+          return;
+        }
+        m_engine = engine->isLoaded() ? engine : nullptr;
+        m_lastReloadCompiled = compiled;
+        emit rulesReloaded(ruleCount());
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+bool ContentBlocker::waitForIdle(int msecs)
+{
+  const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+  while (m_pendingReloads > 0) {
+    if (!m_pool.waitForDone(static_cast<int>(deadline.remainingTime()))) {
+      return false;
+    }
+    QCoreApplication::sendPostedEvents(this);
+    if (deadline.hasExpired() && m_pendingReloads > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ContentBlocker::isReady() const
+{
+  return m_engine != nullptr;
+}
+
+int ContentBlocker::ruleCount() const
+{
+  return m_engine ? m_engine->ruleCount() : 0;
+}
+
+bool ContentBlocker::lastReloadCompiled() const
+{
+  return m_lastReloadCompiled;
+}
+
+ContentFilterEngine::Decision ContentBlocker::match(const QString& url, const QString& sourceHost, ResourceType type) const
+{
+  if (!m_engine) {
+    return ContentFilterEngine::Decision::NoMatch;
+  }
+  return m_engine->match(url, sourceHost, type);
+}
+
+bool ContentBlocker::shouldBlock(const QString& url, const QString& sourceHost, ResourceType type) const
+{
+  return match(url, sourceHost, type) == ContentFilterEngine::Decision::Block;
+}
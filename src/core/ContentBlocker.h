@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include <memory>
+
+#include "ContentFilterEngine.h"
+
+class ContentBlocker final : public QObject
+{
+  Q_OBJECT
+
+public:
+  using ResourceType = ContentFilterEngine::ResourceType;
+
+  static ContentBlocker& instance();
+  ~ContentBlocker() override;
+
+  static QString filterListsDir();
+  static QString compiledPath();
+
+  void reloadAsync();
+  bool waitForIdle(int msecs = -1);
+
+  bool isReady() const;
+  int ruleCount() const;
+  bool lastReloadCompiled() const;
+
+  ContentFilterEngine::Decision match(const QString& url, const QString& sourceHost, ResourceType type) const;
+  bool shouldBlock(const QString& url, const QString& sourceHost, ResourceType type) const;
+
+signals:
+  void rulesReloaded(int ruleCount);
+
+private:
+  explicit ContentBlocker(QObject* parent = nullptr);
+
+  QThreadPool m_pool;
+  std::shared_ptr<ContentFilterEngine> m_engine;
+  int m_pendingReloads = 0;
+  int m_generation = 0;
+  bool m_lastReloadCompiled = false;
+};
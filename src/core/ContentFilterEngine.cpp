@@ -0,0 +1,1424 @@
+#include "ContentFilterEngine.h"
+
+#include "PublicSuffixList.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+using ResourceType = ContentFilterEngine::ResourceType;
+using Decision = ContentFilterEngine::Decision;
+
+constexpr char kMagic[4] = { 'X', 'B', 'C', 'F' };
+constexpr quint32 kBlobVersion = 1;
+constexpr quint32 kByteOrderMark = 0x01020304u;
+constexpr quint32 kNoNode = 0;
+
+enum RuleFlag : quint16
+{
+  RuleException = 1 << 0,
+  RuleImportant = 1 << 1,
+  RuleHostAnchor = 1 << 2,
+  RuleStartAnchor = 1 << 3,
+  RuleEndAnchor = 1 << 4,
+  RuleMatchCase = 1 << 5,
+  RuleThirdParty = 1 << 6,
+  RuleFirstParty = 1 << 7,
+};
+
+enum DomainFlag : quint32
+{
+  DomainNegated = 1,
+};
+
+constexpr quint32 typeBit(ResourceType type)
+{
+  return 1u << static_cast<quint32>(type);
+}
+
+constexpr quint32 kAllTypesMask = (typeBit(ResourceType::Ping) << 1) - 1;
+constexpr quint32 kDefaultTypeMask = kAllTypesMask & ~typeBit(ResourceType::Document);
+
+// The blob is a flat little-endian image: header, then 4-byte aligned POD
+// arrays addressed by offset. It is used in place whether it lives in a
+// QByteArray or in a file mapping.
+struct BlobHeader
+{
+  char magic[4];
+  quint32 version;
+  quint32 byteOrderMark;
+  quint32 totalSize;
+  quint32 sourceStampLow;
+  quint32 sourceStampHigh;
+  quint32 rulesOffset;
+  quint32 ruleCount;
+  quint32 stringsOffset;
+  quint32 stringsSize;
+  quint32 domainsOffset;
+  quint32 domainCount;
+  quint32 tokenFilterOffset;
+  quint32 tokenSlotsOffset;
+  quint32 tokenSlotCount;
+  quint32 tokenRulesOffset;
+  quint32 tokenRuleCount;
+  quint32 acRootOffset;
+  quint32 acNodesOffset;
+  quint32 acNodeCount;
+  quint32 acEdgesOffset;
+  quint32 acEdgeCount;
+  quint32 acOutputsOffset;
+  quint32 acOutputCount;
+  quint32 genericOffset;
+  quint32 genericCount;
+};
+
+struct BlobRule
+{
+  quint32 patternOffset;
+  quint16 patternLength;
+  quint16 flags;
+  quint32 typeMask;
+  quint32 domainsStart;
+  quint32 domainsCount;
+};
+
+struct BlobDomain
+{
+  quint32 offset;
+  quint32 length;
+  quint32 flags;
+};
+
+struct BlobTokenSlot
+{
+  quint32 hash;
+  quint32 start;
+  quint32 count;
+};
+
+struct BlobAcNode
+{
+  quint32 fail;
+  quint32 dict;
+  quint32 edgeStart;
+  quint32 edgeCount;
+  quint32 outStart;
+  quint32 outCount;
+};
+
+struct BlobAcEdge
+{
+  quint32 label;
+  quint32 target;
+};
+
+// One bit per token hash prefix; most URL tokens miss here and never touch
+// the (much larger) slot table.
+constexpr int kTokenFilterBits = 16;
+constexpr quint32 kTokenFilterWords = (1u << kTokenFilterBits) / 32;
+constexpr int kAcRootFanout = 256;
+constexpr quint32 kAcLinearEdges = 8;
+
+static_assert(sizeof(BlobHeader) % 4 == 0);
+static_assert(sizeof(BlobRule) == 20);
+static_assert(sizeof(BlobDomain) == 12);
+static_assert(sizeof(BlobTokenSlot) == 12);
+static_assert(sizeof(BlobAcNode) == 24);
+static_assert(sizeof(BlobAcEdge) == 8);
+
+inline uchar lowerAscii(uchar c)
+{
+  return (c >= 'A' && c <= 'Z') ? static_cast<uchar>(c + ('a' - 'A')) : c;
+}
+
+constexpr bool isTokenCharSlow(uchar c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || c == '%';
+}
+
+struct TokenCharTable
+{
+  bool chars[256] = {};
+
+  constexpr TokenCharTable()
+  {
+    for (int c = 0; c < 256; ++c) {
+      chars[c] = isTokenCharSlow(static_cast<uchar>(c));
+    }
+  }
+};
+
+constexpr TokenCharTable kTokenChars;
+
+inline bool isTokenChar(uchar c)
+{
+  return kTokenChars.chars[c];
+}
+
+inline bool isSeparator(uchar c)
+{
+  if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z')) {
+    return false;
+  }
+  return c != '_' && c != '-' && c != '.' && c != '%';
+}
+
+constexpr quint32 kFnvOffset = 2166136261u;
+
+inline quint32 fnv1aStep(quint32 h, uchar c)
+{
+  return (h ^ lowerAscii(c)) * 16777619u;
+}
+
+inline quint32 fnv1a(const char* data, size_t len)
+{
+  quint32 h = kFnvOffset;
+  for (size_t i = 0; i < len; ++i) {
+    h = fnv1aStep(h, static_cast<uchar>(data[i]));
+  }
+  return h;
+}
+
+std::string_view trimmed(std::string_view s)
+{
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t' || s.front() == '\r')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+std::string toLower(std::string_view s)
+{
+  std::string out(s);
+  for (char& c : out) {
+    c = static_cast<char>(lowerAscii(static_cast<uchar>(c)));
+  }
+  return out;
+}
+
+std::string_view normalizeDomain(std::string_view s)
+{
+  while (!s.empty() && s.front() == '.') {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && s.back() == '.') {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool hostMatchesDomain(std::string_view host, std::string_view domain)
+{
+  if (domain.empty() || host.size() < domain.size()) {
+    return false;
+  }
+  if (host.compare(host.size() - domain.size(), domain.size(), domain) != 0) {
+    return false;
+  }
+  return host.size() == domain.size() || host[host.size() - domain.size() - 1] == '.';
+}
+
+// Hosts without a registrable domain (IP literals, bare public suffixes)
+// are their own site.
+std::string_view siteOf(std::string_view host)
+{
+  const std::string_view domain = PublicSuffixList::registrableDomain(host);
+  return domain.empty() ? host : domain;
+}
+
+struct HostRange
+{
+  size_t start = 0;
+  size_t end = 0;
+};
+
+HostRange findHost(std::string_view url)
+{
+  HostRange range;
+  const size_t scheme = url.find("://");
+  if (scheme == std::string_view::npos) {
+    return range;
+  }
+
+  size_t start = scheme + 3;
+  size_t end = url.find_first_of("/?#", start);
+  if (end == std::string_view::npos) {
+    end = url.size();
+  }
+
+  const size_t at = url.rfind('@', end);
+  if (at != std::string_view::npos && at >= start) {
+    start = at + 1;
+  }
+
+  size_t hostEnd = end;
+  if (start < end && url[start] == '[') {
+    const size_t close = url.find(']', start);
+    hostEnd = (close != std::string_view::npos && close < end) ? close + 1 : end;
+  } else {
+    const size_t colon = url.find(':', start);
+    if (colon != std::string_view::npos && colon < end) {
+      hostEnd = colon;
+    }
+  }
+
+  range.start = start;
+  range.end = hostEnd;
+  return range;
+}
+
+// Wildcard match of an ABP pattern ('*' any run, '^' separator or end of
+// input) against text starting at pos. With anyStart the pattern behaves as
+// if it had a leading '*'; with foldCase the text is compared lowercased.
+bool globMatch(const char* pattern, size_t patternLen, std::string_view text, size_t pos, bool anyStart, bool endAnchor,
+               bool foldCase)
+{
+  constexpr size_t kNone = size_t(-1);
+  size_t pi = 0;
+  size_t ti = pos;
+  size_t starPattern = anyStart ? 0 : kNone;
+  size_t starText = pos;
+  const size_t textLen = text.size();
+
+  while (true) {
+    if (pi == patternLen) {
+      if (!endAnchor || ti == textLen) {
+        return true;
+      }
+    } else {
+      const uchar pc = static_cast<uchar>(pattern[pi]);
+      if (pc == '*') {
+        starPattern = ++pi;
+        starText = ti;
+        continue;
+      }
+      if (ti < textLen) {
+        const uchar tc = foldCase ? lowerAscii(static_cast<uchar>(text[ti])) : static_cast<uchar>(text[ti]);
+        if (pc == '^' ? isSeparator(tc) : pc == tc) {
+          ++pi;
+          ++ti;
+          continue;
+        }
+      } else if (pc == '^') {
+        ++pi;
+        continue;
+      }
+    }
+
+    if (starPattern == kNone || starText >= textLen) {
+      return false;
+    }
+    pi = starPattern;
+    ti = ++starText;
+  }
+}
+
+struct TypeOption
+{
+  std::string_view name;
+  ResourceType type;
+};
+
+constexpr TypeOption kTypeOptions[] = {
+  { "script", ResourceType::Script },
+  { "image", ResourceType::Image },
+  { "stylesheet", ResourceType::Stylesheet },
+  { "css", ResourceType::Stylesheet },
+  { "object", ResourceType::Object },
+  { "xmlhttprequest", ResourceType::XmlHttpRequest },
+  { "xhr", ResourceType::XmlHttpRequest },
+  { "subdocument", ResourceType::Subdocument },
+  { "frame", ResourceType::Subdocument },
+  { "media", ResourceType::Media },
+  { "font", ResourceType::Font },
+  { "websocket", ResourceType::WebSocket },
+  { "ping", ResourceType::Ping },
+  { "beacon", ResourceType::Ping },
+  { "other", ResourceType::Other },
+  { "document", ResourceType::Document },
+  { "doc", ResourceType::Document },
+};
+
+// Tokens that occur in nearly every URL; indexing a rule under one of them
+// would make it a candidate for every request.
+constexpr std::string_view kBadTokens[] = { "http", "https", "www", "com", "net", "org", "js", "html", "php" };
+
+struct ParsedRule
+{
+  std::string pattern;
+  quint16 flags = 0;
+  quint32 typeMask = kDefaultTypeMask;
+  std::vector<std::pair<std::string, bool>> domains;
+};
+
+enum class ParseResult
+{
+  Ignored,
+  Skipped,
+  Parsed,
+};
+
+bool parseOptions(std::string_view options, ParsedRule* rule)
+{
+  quint32 positiveTypes = 0;
+  quint32 negativeTypes = 0;
+
+  size_t pos = 0;
+  while (pos <= options.size()) {
+    size_t comma = options.find(',', pos);
+    if (comma == std::string_view::npos) {
+      comma = options.size();
+    }
+    const std::string option = toLower(trimmed(options.substr(pos, comma - pos)));
+    pos = comma + 1;
+    if (option.empty()) {
+      continue;
+    }
+
+    const bool negated = option.front() == '~';
+    const std::string_view name = negated ? std::string_view(option).substr(1) : std::string_view(option);
+
+    const auto type = std::find_if(std::begin(kTypeOptions), std::end(kTypeOptions), [name](const TypeOption& o) {
+      return o.name == name;
+    });
+    if (type != std::end(kTypeOptions)) {
+      (negated ? negativeTypes : positiveTypes) |= typeBit(type->type);
+      continue;
+    }
+
+    if (name == "third-party" || name == "3p") {
+      rule->flags |= negated ? RuleFirstParty : RuleThirdParty;
+    } else if (name == "first-party" || name == "1p") {
+      rule->flags |= negated ? RuleThirdParty : RuleFirstParty;
+    } else if (name == "match-case" && !negated) {
+      rule->flags |= RuleMatchCase;
+    } else if (name == "important" && !negated) {
+      rule->flags |= RuleImportant;
+    } else if (name == "all" && !negated) {
+      positiveTypes |= kAllTypesMask;
+    } else if (name == "collapse") {
+      continue;
+    } else if (!negated && (name.substr(0, 7) == "domain=" || name.substr(0, 5) == "from=")) {
+      std::string_view list = name.substr(name.find('=') + 1);
+      while (!list.empty()) {
+        size_t bar = list.find('|');
+        if (bar == std::string_view::npos) {
+          bar = list.size();
+        }
+        std::string_view entry = trimmed(list.substr(0, bar));
+        list.remove_prefix(qMin(bar + 1, list.size()));
+
+        const bool entryNegated = !entry.empty() && entry.front() == '~';
+        if (entryNegated) {
+          entry.remove_prefix(1);
+        }
+        entry = normalizeDomain(entry);
+        if (entry.empty()) {
+          continue;
+        }
+        if (entry.size() >= 2 && entry.substr(entry.size() - 2) == ".*") {
+          if (!entryNegated) {
+            return false;
+          }
+          continue;
+        }
+        rule->domains.emplace_back(std::string(entry), entryNegated);
+      }
+    } else {
+      return false;
+    }
+  }
+
+  if ((rule->flags & RuleThirdParty) && (rule->flags & RuleFirstParty)) {
+    return false;
+  }
+
+  if (positiveTypes != 0) {
+    rule->typeMask = positiveTypes & ~negativeTypes;
+  } else {
+    rule->typeMask = kDefaultTypeMask & ~negativeTypes;
+  }
+  return rule->typeMask != 0;
+}
+
+ParseResult parseLine(std::string_view raw, ParsedRule* rule)
+{
+  std::string_view line = trimmed(raw);
+  if (line.empty() || line.front() == '!' || line.front() == '[' || line.front() == '#') {
+    return ParseResult::Ignored;
+  }
+
+  for (std::string_view marker : { "##", "#@#", "#?#", "#$#", "#%#" }) {
+    if (line.find(marker) != std::string_view::npos) {
+      return ParseResult::Ignored;
+    }
+  }
+
+  for (std::string_view sinkhole : { "0.0.0.0 ", "127.0.0.1 ", "0.0.0.0\t", "127.0.0.1\t" }) {
+    if (line.substr(0, sinkhole.size()) == sinkhole) {
+      std::string_view host = trimmed(line.substr(sinkhole.size()));
+      const size_t comment = host.find_first_of(" \t#");
+      if (comment != std::string_view::npos) {
+        host = host.substr(0, comment);
+      }
+      host = normalizeDomain(host);
+      if (host.empty() || host == "localhost" || host == "0.0.0.0" || host.find('.') == std::string_view::npos) {
+        return ParseResult::Ignored;
+      }
+      rule->pattern = toLower(host);
+      rule->pattern.push_back('^');
+      rule->flags = RuleHostAnchor;
+      return ParseResult::Parsed;
+    }
+  }
+
+  if (line.substr(0, 2) == "@@") {
+    rule->flags |= RuleException;
+    line.remove_prefix(2);
+  }
+
+  std::string_view pattern = line;
+  const size_t dollar = line.rfind('$');
+  if (dollar != std::string_view::npos) {
+    pattern = line.substr(0, dollar);
+    if (!parseOptions(line.substr(dollar + 1), rule)) {
+      return ParseResult::Skipped;
+    }
+  }
+
+  if (pattern.size() >= 2 && pattern.front() == '/' && pattern.back() == '/') {
+    return ParseResult::Skipped;
+  }
+
+  if (pattern.substr(0, 2) == "||") {
+    rule->flags |= RuleHostAnchor;
+    pattern.remove_prefix(2);
+  } else if (!pattern.empty() && pattern.front() == '|') {
+    rule->flags |= RuleStartAnchor;
+    pattern.remove_prefix(1);
+  }
+  if (!pattern.empty() && pattern.back() == '|') {
+    rule->flags |= RuleEndAnchor;
+    pattern.remove_suffix(1);
+  }
+
+  std::string compact;
+  compact.reserve(pattern.size());
+  for (char c : pattern) {
+    if (c == '*' && !compact.empty() && compact.back() == '*') {
+      continue;
+    }
+    compact.push_back(c);
+  }
+  if (!compact.empty() && compact.front() == '*') {
+    compact.erase(0, 1);
+    rule->flags &= ~(RuleHostAnchor | RuleStartAnchor);
+  }
+  if (!compact.empty() && compact.back() == '*') {
+    compact.pop_back();
+    rule->flags &= ~RuleEndAnchor;
+  }
+
+  if (compact.size() > 0xFFFF) {
+    return ParseResult::Skipped;
+  }
+  if (compact.empty() && rule->domains.empty() && !(rule->flags & (RuleThirdParty | RuleFirstParty))
+      && rule->typeMask == kDefaultTypeMask) {
+    return ParseResult::Skipped;
+  }
+
+  rule->pattern = (rule->flags & RuleMatchCase) ? compact : toLower(compact);
+  return ParseResult::Parsed;
+}
+
+std::vector<std::string> tokenCandidates(const std::string& lowerPattern, quint16 flags)
+{
+  std::vector<std::string> out;
+  const size_t n = lowerPattern.size();
+  size_t i = 0;
+  while (i < n) {
+    if (!isTokenChar(static_cast<uchar>(lowerPattern[i]))) {
+      ++i;
+      continue;
+    }
+    const size_t start = i;
+    while (i < n && isTokenChar(static_cast<uchar>(lowerPattern[i]))) {
+      ++i;
+    }
+    const bool leftBounded = start == 0 ? (flags & (RuleHostAnchor | RuleStartAnchor)) != 0 : lowerPattern[start - 1] != '*';
+    const bool rightBounded = i == n ? (flags & RuleEndAnchor) != 0 : lowerPattern[i] != '*';
+    if (leftBounded && rightBounded) {
+      out.push_back(lowerPattern.substr(start, i - start));
+    }
+  }
+  return out;
+}
+
+std::string longestLiteral(const std::string& lowerPattern)
+{
+  size_t bestStart = 0;
+  size_t bestLen = 0;
+  size_t i = 0;
+  while (i < lowerPattern.size()) {
+    if (lowerPattern[i] == '*' || lowerPattern[i] == '^') {
+      ++i;
+      continue;
+    }
+    const size_t start = i;
+    while (i < lowerPattern.size() && lowerPattern[i] != '*' && lowerPattern[i] != '^') {
+      ++i;
+    }
+    if (i - start > bestLen) {
+      bestStart = start;
+      bestLen = i - start;
+    }
+  }
+  return lowerPattern.substr(bestStart, bestLen);
+}
+
+class BlobWriter
+{
+public:
+  quint32 offset() const
+  {
+    return static_cast<quint32>(m_bytes.size());
+  }
+
+  template <typename T>
+  quint32 append(const std::vector<T>& items)
+  {
+    align();
+    const quint32 at = offset();
+    if (!items.empty()) {
+      m_bytes.append(reinterpret_cast<const char*>(items.data()), qsizetype(items.size() * sizeof(T)));
+    }
+    return at;
+  }
+
+  quint32 appendBytes(const std::string& bytes)
+  {
+    align();
+    const quint32 at = offset();
+    m_bytes.append(bytes.data(), qsizetype(bytes.size()));
+    return at;
+  }
+
+  void reserveHeader()
+  {
+    m_bytes.fill('\0', sizeof(BlobHeader));
+  }
+
+  QByteArray finish(const BlobHeader& header)
+  {
+    align();
+    BlobHeader h = header;
+    h.totalSize = offset();
+    std::memcpy(m_bytes.data(), &h, sizeof(BlobHeader));
+    return m_bytes;
+  }
+
+private:
+  void align()
+  {
+    while (m_bytes.size() % 4 != 0) {
+      m_bytes.append('\0');
+    }
+  }
+
+  QByteArray m_bytes;
+};
+
+struct TrieNode
+{
+  std::map<uchar, quint32> next;
+  quint32 fail = 0;
+  quint32 dict = kNoNode;
+  std::vector<quint32> outputs;
+};
+
+void buildAutomaton(const std::vector<std::pair<std::string, quint32>>& literals, std::vector<quint32>* rootTable,
+                    std::vector<BlobAcNode>* nodesOut, std::vector<BlobAcEdge>* edgesOut, std::vector<quint32>* outputsOut)
+{
+  std::vector<TrieNode> trie(1);
+  for (const auto& [literal, ruleId] : literals) {
+    quint32 node = 0;
+    for (char c : literal) {
+      const uchar label = static_cast<uchar>(c);
+      const auto it = trie[node].next.find(label);
+      if (it != trie[node].next.end()) {
+        node = it->second;
+        continue;
+      }
+      const quint32 child = static_cast<quint32>(trie.size());
+      trie[node].next.emplace(label, child);
+      trie.emplace_back();
+      node = child;
+    }
+    trie[node].outputs.push_back(ruleId);
+  }
+
+  // Breadth-first order gives every node an id greater than its failure and
+  // dictionary links, which keeps the match loop trivially bounded.
+  std::vector<quint32> order;
+  order.reserve(trie.size());
+  std::deque<quint32> queue;
+  queue.push_back(0);
+  while (!queue.empty()) {
+    const quint32 node = queue.front();
+    queue.pop_front();
+    order.push_back(node);
+    for (const auto& [label, child] : trie[node].next) {
+      if (node == 0) {
+        trie[child].fail = 0;
+      } else {
+        quint32 f = trie[node].fail;
+        while (true) {
+          const auto it = trie[f].next.find(label);
+          if (it != trie[f].next.end() && it->second != child) {
+            trie[child].fail = it->second;
+            break;
+          }
+          if (f == 0) {
+            trie[child].fail = 0;
+            break;
+          }
+          f = trie[f].fail;
+        }
+      }
+      const quint32 fail = trie[child].fail;
+      trie[child].dict = !trie[fail].outputs.empty() ? fail : trie[fail].dict;
+      queue.push_back(child);
+    }
+  }
+
+  std::vector<quint32> renumber(trie.size());
+  for (quint32 i = 0; i < order.size(); ++i) {
+    renumber[order[i]] = i;
+  }
+
+  rootTable->assign(kAcRootFanout, 0);
+  for (const auto& [label, child] : trie[0].next) {
+    (*rootTable)[label] = renumber[child];
+  }
+
+  nodesOut->clear();
+  edgesOut->clear();
+  outputsOut->clear();
+  for (quint32 old : order) {
+    const TrieNode& node = trie[old];
+    BlobAcNode out{};
+    out.fail = renumber[node.fail];
+    out.dict = node.dict == kNoNode ? kNoNode : renumber[node.dict];
+    out.edgeStart = static_cast<quint32>(edgesOut->size());
+    out.edgeCount = static_cast<quint32>(node.next.size());
+    for (const auto& [label, child] : node.next) {
+      edgesOut->push_back(BlobAcEdge{ label, renumber[child] });
+    }
+    out.outStart = static_cast<quint32>(outputsOut->size());
+    out.outCount = static_cast<quint32>(node.outputs.size());
+    outputsOut->insert(outputsOut->end(), node.outputs.begin(), node.outputs.end());
+    nodesOut->push_back(out);
+  }
+}
+
+template <typename T>
+const T* section(const uchar* data, quint32 offset)
+{
+  return reinterpret_cast<const T*>(data + offset);
+}
+
+bool sectionFits(qint64 size, quint32 offset, quint32 count, size_t elementSize)
+{
+  if (offset % 4 != 0) {
+    return false;
+  }
+  return quint64(offset) + quint64(count) * elementSize <= quint64(size);
+}
+
+std::string_view lowerInto(std::string_view s, char (&buffer)[256])
+{
+  const size_t n = qMin(s.size(), sizeof(buffer));
+  for (size_t i = 0; i < n; ++i) {
+    buffer[i] = static_cast<char>(lowerAscii(static_cast<uchar>(s[i])));
+  }
+  return std::string_view(buffer, n);
+}
+
+struct MatchContext
+{
+  const uchar* data = nullptr;
+  const BlobHeader* header = nullptr;
+  std::string_view url;
+  std::string_view sourceHost;
+  quint32 typeBit = 0;
+  bool blocked = false;
+  bool allowed = false;
+
+  // Resolved on first use; most candidate rules are rejected before either
+  // is needed.
+  HostRange host;
+  bool hostResolved = false;
+  bool thirdParty = false;
+  bool partyResolved = false;
+
+  const HostRange& requestHost()
+  {
+    if (!hostResolved) {
+      host = findHost(url);
+      hostResolved = true;
+    }
+    return host;
+  }
+
+  bool isThirdParty()
+  {
+    if (!partyResolved) {
+      const HostRange& range = requestHost();
+      char buffer[256];
+      const std::string_view request = lowerInto(url.substr(range.start, range.end - range.start), buffer);
+      thirdParty = !sourceHost.empty() && siteOf(request) != siteOf(sourceHost);
+      partyResolved = true;
+    }
+    return thirdParty;
+  }
+};
+
+bool rulePatternMatches(MatchContext& ctx, const BlobRule& rule)
+{
+  const char* pattern = reinterpret_cast<const char*>(ctx.data + ctx.header->stringsOffset + rule.patternOffset);
+  const size_t len = rule.patternLength;
+  const std::string_view text = ctx.url;
+  const bool foldCase = !(rule.flags & RuleMatchCase);
+  const bool endAnchor = (rule.flags & RuleEndAnchor) != 0;
+
+  if (rule.flags & RuleHostAnchor) {
+    const HostRange& host = ctx.requestHost();
+    for (size_t pos = host.start; pos < host.end; ++pos) {
+      if (pos != host.start && text[pos - 1] != '.') {
+        continue;
+      }
+      if (globMatch(pattern, len, text, pos, false, endAnchor, foldCase)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  if (rule.flags & RuleStartAnchor) {
+    return globMatch(pattern, len, text, 0, false, endAnchor, foldCase);
+  }
+  return globMatch(pattern, len, text, 0, true, endAnchor, foldCase);
+}
+
+bool ruleDomainsMatch(const MatchContext& ctx, const BlobRule& rule)
+{
+  if (rule.domainsCount == 0) {
+    return true;
+  }
+
+  const BlobDomain* domains = section<BlobDomain>(ctx.data, ctx.header->domainsOffset) + rule.domainsStart;
+  const char* strings = reinterpret_cast<const char*>(ctx.data + ctx.header->stringsOffset);
+  bool hasPositive = false;
+  bool positiveHit = false;
+  for (quint32 i = 0; i < rule.domainsCount; ++i) {
+    const BlobDomain& d = domains[i];
+    const bool hit = hostMatchesDomain(ctx.sourceHost, std::string_view(strings + d.offset, d.length));
+    if (d.flags & DomainNegated) {
+      if (hit) {
+        return false;
+      }
+    } else {
+      hasPositive = true;
+      positiveHit = positiveHit || hit;
+    }
+  }
+  return !hasPositive || positiveHit;
+}
+
+// Returns true once the outcome can no longer change (an important block).
+bool considerRule(MatchContext& ctx, quint32 ruleId)
+{
+  const BlobRule& rule = section<BlobRule>(ctx.data, ctx.header->rulesOffset)[ruleId];
+  const bool exception = (rule.flags & RuleException) != 0;
+  const bool important = (rule.flags & RuleImportant) != 0;
+  if (exception ? ctx.allowed : (ctx.blocked && !important)) {
+    return false;
+  }
+  if (!(rule.typeMask & ctx.typeBit)) {
+    return false;
+  }
+  if ((rule.flags & RuleThirdParty) && !ctx.isThirdParty()) {
+    return false;
+  }
+  if ((rule.flags & RuleFirstParty) && ctx.isThirdParty()) {
+    return false;
+  }
+  if (!ruleDomainsMatch(ctx, rule) || !rulePatternMatches(ctx, rule)) {
+    return false;
+  }
+
+  if (exception) {
+    ctx.allowed = true;
+    return false;
+  }
+  ctx.blocked = true;
+  return important;
+}
+
+class TokenIndex
+{
+public:
+  explicit TokenIndex(const MatchContext& ctx)
+    : m_filter(section<quint32>(ctx.data, ctx.header->tokenFilterOffset))
+    , m_slots(section<BlobTokenSlot>(ctx.data, ctx.header->tokenSlotsOffset))
+    , m_ruleIds(section<quint32>(ctx.data, ctx.header->tokenRulesOffset))
+    , m_mask(ctx.header->tokenSlotCount - 1)
+    , m_empty(ctx.header->tokenSlotCount == 0)
+  {
+  }
+
+  bool lookup(MatchContext& ctx, quint32 hash) const
+  {
+    const quint32 bit = hash >> (32 - kTokenFilterBits);
+    if (m_empty || !(m_filter[bit >> 5] & (1u << (bit & 31)))) {
+      return false;
+    }
+    for (quint32 slot = hash & m_mask;; slot = (slot + 1) & m_mask) {
+      const BlobTokenSlot& s = m_slots[slot];
+      if (s.count == 0) {
+        return false;
+      }
+      if (s.hash != hash) {
+        continue;
+      }
+      for (quint32 r = 0; r < s.count; ++r) {
+        if (considerRule(ctx, m_ruleIds[s.start + r])) {
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+
+private:
+  const quint32* m_filter;
+  const BlobTokenSlot* m_slots;
+  const quint32* m_ruleIds;
+  quint32 m_mask;
+  bool m_empty;
+};
+
+class LiteralAutomaton
+{
+public:
+  explicit LiteralAutomaton(const MatchContext& ctx)
+    : m_root(section<quint32>(ctx.data, ctx.header->acRootOffset))
+    , m_nodes(section<BlobAcNode>(ctx.data, ctx.header->acNodesOffset))
+    , m_edges(section<BlobAcEdge>(ctx.data, ctx.header->acEdgesOffset))
+    , m_outputs(section<quint32>(ctx.data, ctx.header->acOutputsOffset))
+  {
+  }
+
+  quint32 step(quint32 node, uchar c) const
+  {
+    while (node != 0) {
+      const BlobAcNode& n = m_nodes[node];
+      const BlobAcEdge* first = m_edges + n.edgeStart;
+      const BlobAcEdge* last = first + n.edgeCount;
+      const BlobAcEdge* it = first;
+      if (n.edgeCount <= kAcLinearEdges) {
+        while (it != last && it->label < c) {
+          ++it;
+        }
+      } else {
+        it = std::lower_bound(first, last, c, [](const BlobAcEdge& e, uchar label) {
+          return e.label < label;
+        });
+      }
+      if (it != last && it->label == c) {
+        return it->target;
+      }
+      node = n.fail;
+    }
+    return m_root[c];
+  }
+
+  bool report(MatchContext& ctx, quint32 node) const
+  {
+    for (; node != kNoNode; node = m_nodes[node].dict) {
+      const BlobAcNode& n = m_nodes[node];
+      for (quint32 o = 0; o < n.outCount; ++o) {
+        if (considerRule(ctx, m_outputs[n.outStart + o])) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+private:
+  const quint32* m_root;
+  const BlobAcNode* m_nodes;
+  const BlobAcEdge* m_edges;
+  const quint32* m_outputs;
+};
+
+// One pass over the URL feeds both indexes: token hashes are looked up as
+// each alphanumeric run ends, and the automaton reports literal hits as
+// they complete.
+bool scanUrl(MatchContext& ctx)
+{
+  const TokenIndex tokens(ctx);
+  const LiteralAutomaton automaton(ctx);
+  const bool useAutomaton = ctx.header->acNodeCount > 1;
+
+  quint32 node = 0;
+  quint32 hash = kFnvOffset;
+  bool inToken = false;
+  for (char ch : ctx.url) {
+    const uchar c = lowerAscii(static_cast<uchar>(ch));
+    if (isTokenChar(c)) {
+      hash = fnv1aStep(hash, c);
+      inToken = true;
+    } else if (inToken) {
+      if (tokens.lookup(ctx, hash)) {
+        return true;
+      }
+      hash = kFnvOffset;
+      inToken = false;
+    }
+
+    if (useAutomaton) {
+      node = automaton.step(node, c);
+      if (node != 0 && automaton.report(ctx, node)) {
+        return true;
+      }
+    }
+  }
+  return inToken && tokens.lookup(ctx, hash);
+}
+
+bool scanGeneric(MatchContext& ctx)
+{
+  const quint32* ruleIds = section<quint32>(ctx.data, ctx.header->genericOffset);
+  for (quint32 i = 0; i < ctx.header->genericCount; ++i) {
+    if (considerRule(ctx, ruleIds[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+}
+
+ContentFilterEngine::ContentFilterEngine() = default;
+
+ContentFilterEngine::~ContentFilterEngine()
+{
+  unload();
+}
+
+QByteArray ContentFilterEngine::compile(const QStringList& listTexts, quint64 sourceStamp, CompileStats* stats)
+{
+  CompileStats localStats;
+  CompileStats& st = stats ? *stats : localStats;
+  st = CompileStats{};
+
+  std::vector<ParsedRule> rules;
+  std::unordered_set<std::string> seen;
+  for (const QString& text : listTexts) {
+    const QByteArray utf8 = text.toUtf8();
+    const std::string_view all(utf8.constData(), size_t(utf8.size()));
+    size_t pos = 0;
+    while (pos < all.size()) {
+      size_t nl = all.find('\n', pos);
+      if (nl == std::string_view::npos) {
+        nl = all.size();
+      }
+      const std::string_view line = trimmed(all.substr(pos, nl - pos));
+      pos = nl + 1;
+      ++st.linesRead;
+
+      if (line.empty() || !seen.emplace(line).second) {
+        continue;
+      }
+
+      ParsedRule rule;
+      switch (parseLine(line, &rule)) {
+        case ParseResult::Ignored:
+          break;
+        case ParseResult::Skipped:
+          ++st.rulesSkipped;
+          break;
+        case ParseResult::Parsed:
+          rules.push_back(std::move(rule));
+          break;
+      }
+    }
+  }
+  st.rulesCompiled = int(rules.size());
+
+  std::vector<std::vector<std::string>> candidates(rules.size());
+  std::unordered_map<std::string, int> frequency;
+  for (size_t i = 0; i < rules.size(); ++i) {
+    std::vector<std::string> tokens = tokenCandidates(toLower(rules[i].pattern), rules[i].flags);
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    for (const std::string& token : tokens) {
+      ++frequency[token];
+    }
+    candidates[i] = std::move(tokens);
+  }
+
+  std::unordered_map<quint32, std::vector<quint32>> buckets;
+  std::vector<std::pair<std::string, quint32>> literals;
+  std::vector<quint32> generic;
+  for (size_t i = 0; i < rules.size(); ++i) {
+    const std::string* best = nullptr;
+    auto score = [&frequency](const std::string& token) {
+      const bool bad = std::find(std::begin(kBadTokens), std::end(kBadTokens), token) != std::end(kBadTokens);
+      return std::make_tuple(bad ? 1 : 0, frequency[token], -int(token.size()));
+    };
+    for (const std::string& token : candidates[i]) {
+      if (!best || score(token) < score(*best)) {
+        best = &token;
+      }
+    }
+
+    const quint32 ruleId = quint32(i);
+    if (best) {
+      buckets[fnv1a(best->data(), best->size())].push_back(ruleId);
+      ++st.tokenIndexed;
+      continue;
+    }
+    const std::string literal = longestLiteral(toLower(rules[i].pattern));
+    if (!literal.empty()) {
+      literals.emplace_back(literal, ruleId);
+      ++st.literalIndexed;
+      continue;
+    }
+    generic.push_back(ruleId);
+    ++st.generic;
+  }
+
+  std::string strings;
+  std::vector<BlobRule> blobRules;
+  std::vector<BlobDomain> blobDomains;
+  blobRules.reserve(rules.size());
+  for (const ParsedRule& rule : rules) {
+    BlobRule out{};
+    out.patternOffset = quint32(strings.size());
+    out.patternLength = quint16(rule.pattern.size());
+    out.flags = rule.flags;
+    out.typeMask = rule.typeMask;
+    out.domainsStart = quint32(blobDomains.size());
+    out.domainsCount = quint32(rule.domains.size());
+    strings.append(rule.pattern);
+    for (const auto& [domain, negated] : rule.domains) {
+      blobDomains.push_back(BlobDomain{ quint32(strings.size()), quint32(domain.size()), negated ? quint32(DomainNegated) : 0u });
+      strings.append(domain);
+    }
+    blobRules.push_back(out);
+  }
+
+  quint32 slotCount = buckets.empty() ? 0 : 16;
+  while (slotCount != 0 && slotCount < buckets.size() * 2) {
+    slotCount <<= 1;
+  }
+  std::vector<BlobTokenSlot> slots(slotCount, BlobTokenSlot{ 0, 0, 0 });
+  std::vector<quint32> tokenFilter(kTokenFilterWords, 0);
+  std::vector<quint32> tokenRules;
+  for (const auto& [hash, ruleIds] : buckets) {
+    const quint32 bit = hash >> (32 - kTokenFilterBits);
+    tokenFilter[bit >> 5] |= 1u << (bit & 31);
+    quint32 slot = hash & (slotCount - 1);
+    while (slots[slot].count != 0) {
+      slot = (slot + 1) & (slotCount - 1);
+    }
+    slots[slot] = BlobTokenSlot{ hash, quint32(tokenRules.size()), quint32(ruleIds.size()) };
+    tokenRules.insert(tokenRules.end(), ruleIds.begin(), ruleIds.end());
+  }
+
+  std::vector<quint32> acRoot;
+  std::vector<BlobAcNode> acNodes;
+  std::vector<BlobAcEdge> acEdges;
+  std::vector<quint32> acOutputs;
+  buildAutomaton(literals, &acRoot, &acNodes, &acEdges, &acOutputs);
+
+  BlobHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kBlobVersion;
+  header.byteOrderMark = kByteOrderMark;
+  header.sourceStampLow = quint32(sourceStamp & 0xFFFFFFFFu);
+  header.sourceStampHigh = quint32(sourceStamp >> 32);
+
+  BlobWriter writer;
+  writer.reserveHeader();
+  header.rulesOffset = writer.append(blobRules);
+  header.ruleCount = quint32(blobRules.size());
+  header.stringsOffset = writer.appendBytes(strings);
+  header.stringsSize = quint32(strings.size());
+  header.domainsOffset = writer.append(blobDomains);
+  header.domainCount = quint32(blobDomains.size());
+  header.tokenFilterOffset = writer.append(tokenFilter);
+  header.tokenSlotsOffset = writer.append(slots);
+  header.tokenSlotCount = slotCount;
+  header.tokenRulesOffset = writer.append(tokenRules);
+  header.tokenRuleCount = quint32(tokenRules.size());
+  header.acRootOffset = writer.append(acRoot);
+  header.acNodesOffset = writer.append(acNodes);
+  header.acNodeCount = quint32(acNodes.size());
+  header.acEdgesOffset = writer.append(acEdges);
+  header.acEdgeCount = quint32(acEdges.size());
+  header.acOutputsOffset = writer.append(acOutputs);
+  header.acOutputCount = quint32(acOutputs.size());
+  header.genericOffset = writer.append(generic);
+  header.genericCount = quint32(generic.size());
+  return writer.finish(header);
+}
+
+quint64 ContentFilterEngine::fileSourceStamp(const QString& path)
+{
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return 0;
+  }
+  BlobHeader header{};
+  if (f.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))) {
+    return 0;
+  }
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kBlobVersion
+      || header.byteOrderMark != kByteOrderMark || header.totalSize != quint64(f.size())) {
+    return 0;
+  }
+  return (quint64(header.sourceStampHigh) << 32) | header.sourceStampLow;
+}
+
+ContentFilterEngine::ResourceType ContentFilterEngine::resourceTypeFromString(const QString& name)
+{
+  const QByteArray key = name.trimmed().toLower().toUtf8();
+  const std::string_view view(key.constData(), size_t(key.size()));
+  for (const TypeOption& option : kTypeOptions) {
+    if (option.name == view) {
+      return option.type;
+    }
+  }
+  if (view == "main_frame") {
+    return ResourceType::Document;
+  }
+  if (view == "sub_frame") {
+    return ResourceType::Subdocument;
+  }
+  return ResourceType::Other;
+}
+
+bool ContentFilterEngine::loadBlob(const QByteArray& blob)
+{
+  unload();
+  m_ownedBlob = blob;
+  if (!attach(reinterpret_cast<const uchar*>(m_ownedBlob.constData()), m_ownedBlob.size())) {
+    unload();
+    return false;
+  }
+  return true;
+}
+
+bool ContentFilterEngine::loadFile(const QString& path)
+{
+  unload();
+  auto file = std::make_unique<QFile>(path);
+  if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(BlobHeader))) {
+    return false;
+  }
+
+  const uchar* mapped = file->map(0, file->size());
+  if (mapped) {
+    const qint64 size = file->size();
+    m_file = std::move(file);
+    if (attach(mapped, size)) {
+      return true;
+    }
+    unload();
+    return false;
+  }
+
+  return loadBlob(file->readAll());
+}
+
+void ContentFilterEngine::unload()
+{
+  m_data = nullptr;
+  m_size = 0;
+  m_ownedBlob.clear();
+  if (m_file) {
+    m_file->close();
+    m_file.reset();
+  }
+}
+
+bool ContentFilterEngine::isLoaded() const
+{
+  return m_data != nullptr;
+}
+
+int ContentFilterEngine::ruleCount() const
+{
+  return m_data ? int(section<BlobHeader>(m_data, 0)->ruleCount) : 0;
+}
+
+quint64 ContentFilterEngine::sourceStamp() const
+{
+  if (!m_data) {
+    return 0;
+  }
+  const BlobHeader* header = section<BlobHeader>(m_data, 0);
+  return (quint64(header->sourceStampHigh) << 32) | header->sourceStampLow;
+}
+
+qint64 ContentFilterEngine::blobSize() const
+{
+  return m_size;
+}
+
+bool ContentFilterEngine::isMapped() const
+{
+  return m_data && m_file;
+}
+
+ContentFilterEngine::Decision ContentFilterEngine::match(std::string_view url, std::string_view sourceHost,
+                                                         ResourceType type) const
+{
+  if (!m_data || url.empty()) {
+    return Decision::NoMatch;
+  }
+
+  char sourceBuffer[256];
+  MatchContext ctx;
+  ctx.data = m_data;
+  ctx.header = section<BlobHeader>(m_data, 0);
+  ctx.url = url;
+  ctx.sourceHost = lowerInto(normalizeDomain(sourceHost), sourceBuffer);
+  ctx.typeBit = typeBit(type);
+
+  if (scanUrl(ctx) || scanGeneric(ctx)) {
+    return Decision::Block;
+  }
+  if (!ctx.blocked) {
+    return Decision::NoMatch;
+  }
+  return ctx.allowed ? Decision::Allow : Decision::Block;
+}
+
+ContentFilterEngine::Decision ContentFilterEngine::match(const QString& url, const QString& sourceHost,
+                                                         ResourceType type) const
+{
+  if (!m_data) {
+    return Decision::NoMatch;
+  }
+  const QByteArray urlUtf8 = url.toUtf8();
+  const QByteArray hostUtf8 = sourceHost.toUtf8();
+  return match(std::string_view(urlUtf8.constData(), size_t(urlUtf8.size())),
+               std::string_view(hostUtf8.constData(), size_t(hostUtf8.size())), type);
+}
+
+bool ContentFilterEngine::attach(const uchar* data, qint64 size)
+{
+  if (!data || size < qint64(sizeof(BlobHeader)) || (reinterpret_cast<quintptr>(data) % 4) != 0) {
+    return false;
+  }
+
+  const BlobHeader& h = *section<BlobHeader>(data, 0);
+  if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kBlobVersion || h.byteOrderMark != kByteOrderMark
+      || h.totalSize != quint64(size)) {
+    return false;
+  }
+
+  if (!sectionFits(size, h.rulesOffset, h.ruleCount, sizeof(BlobRule)) || !sectionFits(size, h.stringsOffset, h.stringsSize, 1)
+      || !sectionFits(size, h.domainsOffset, h.domainCount, sizeof(BlobDomain))
+      || !sectionFits(size, h.tokenFilterOffset, kTokenFilterWords, sizeof(quint32))
+      || !sectionFits(size, h.tokenSlotsOffset, h.tokenSlotCount, sizeof(BlobTokenSlot))
+      || !sectionFits(size, h.tokenRulesOffset, h.tokenRuleCount, sizeof(quint32))
+      || !sectionFits(size, h.acRootOffset, kAcRootFanout, sizeof(quint32))
+      || !sectionFits(size, h.acNodesOffset, h.acNodeCount, sizeof(BlobAcNode))
+      || !sectionFits(size, h.acEdgesOffset, h.acEdgeCount, sizeof(BlobAcEdge))
+      || !sectionFits(size, h.acOutputsOffset, h.acOutputCount, sizeof(quint32))
+      || !sectionFits(size, h.genericOffset, h.genericCount, sizeof(quint32))) {
+    return false;
+  }
+  if (h.tokenSlotCount != 0 && (h.tokenSlotCount & (h.tokenSlotCount - 1)) != 0) {
+    return false;
+  }
+  if (h.acNodeCount == 0) {
+    return false;
+  }
+
+  // Validate every index once so the match loops can trust the blob.
+  const BlobRule* rules = section<BlobRule>(data, h.rulesOffset);
+  for (quint32 i = 0; i < h.ruleCount; ++i) {
+    const BlobRule& r = rules[i];
+    if (quint64(r.patternOffset) + r.patternLength > h.stringsSize
+        || quint64(r.domainsStart) + r.domainsCount > h.domainCount) {
+      return false;
+    }
+  }
+  const BlobDomain* domains = section<BlobDomain>(data, h.domainsOffset);
+  for (quint32 i = 0; i < h.domainCount; ++i) {
+    if (quint64(domains[i].offset) + domains[i].length > h.stringsSize) {
+      return false;
+    }
+  }
+
+  bool hasEmptySlot = h.tokenSlotCount == 0;
+  const BlobTokenSlot* slots = section<BlobTokenSlot>(data, h.tokenSlotsOffset);
+  for (quint32 i = 0; i < h.tokenSlotCount; ++i) {
+    hasEmptySlot = hasEmptySlot || slots[i].count == 0;
+    if (quint64(slots[i].start) + slots[i].count > h.tokenRuleCount) {
+      return false;
+    }
+  }
+  if (!hasEmptySlot) {
+    return false;
+  }
+
+  auto idsValid = [&](quint32 offset, quint32 count, quint32 limit) {
+    const quint32* ids = section<quint32>(data, offset);
+    return std::all_of(ids, ids + count, [limit](quint32 id) {
+      return id < limit;
+    });
+  };
+  if (!idsValid(h.tokenRulesOffset, h.tokenRuleCount, h.ruleCount) || !idsValid(h.acOutputsOffset, h.acOutputCount, h.ruleCount)
+      || !idsValid(h.genericOffset, h.genericCount, h.ruleCount) || !idsValid(h.acRootOffset, kAcRootFanout, h.acNodeCount)) {
+    return false;
+  }
+
+  const BlobAcNode* nodes = section<BlobAcNode>(data, h.acNodesOffset);
+  for (quint32 i = 0; i < h.acNodeCount; ++i) {
+    const BlobAcNode& n = nodes[i];
+    const bool linksValid = i == 0 ? (n.fail == 0 && n.dict == kNoNode) : (n.fail < i && n.dict < i);
+    if (!linksValid || quint64(n.edgeStart) + n.edgeCount > h.acEdgeCount
+        || quint64(n.outStart) + n.outCount > h.acOutputCount) {
+      return false;
+    }
+  }
+  const BlobAcEdge* edges = section<BlobAcEdge>(data, h.acEdgesOffset);
+  for (quint32 i = 0; i < h.acEdgeCount; ++i) {
+    if (edges[i].label >= quint32(kAcRootFanout) || edges[i].target >= h.acNodeCount || edges[i].target == 0) {
+      return false;
+    }
+  }
+
+  m_data = data;
+  m_size = size;
+  return true;
+}
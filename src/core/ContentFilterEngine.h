@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+#include <string_view>
+
+class QFile;
+
+class ContentFilterEngine final
+{
+public:
+  enum class ResourceType : quint8
+  {
+    Other = 0,
+    Document,
+    Subdocument,
+    Stylesheet,
+    Script,
+    Image,
+    Font,
+    Media,
+    Object,
+    XmlHttpRequest,
+    WebSocket,
+    Ping,
+  };
+
+  enum class Decision : quint8
+  {
+    NoMatch = 0,
+    Block,
+    Allow,
+  };
+
+  struct CompileStats
+  {
+    int linesRead = 0;
+    int rulesCompiled = 0;
+    int rulesSkipped = 0;
+    int tokenIndexed = 0;
+    int literalIndexed = 0;
+    int generic = 0;
+  };
+
+  ContentFilterEngine();
+  ~ContentFilterEngine();
+
+  ContentFilterEngine(const ContentFilterEngine&) = delete;
+  ContentFilterEngine& operator=(const ContentFilterEngine&) = delete;
+
+  static QByteArray compile(const QStringList& listTexts, quint64 sourceStamp = 0, CompileStats* stats = nullptr);
+  static quint64 fileSourceStamp(const QString& path);
+  static ResourceType resourceTypeFromString(const QString& name);
+
+  bool loadBlob(const QByteArray& blob);
+  bool loadFile(const QString& path);
+  void unload();
+
+  bool isLoaded() const;
+  int ruleCount() const;
+  quint64 sourceStamp() const;
+  qint64 blobSize() const;
+  bool isMapped() const;
+
+  Decision match(std::string_view url, std::string_view sourceHost, ResourceType type) const;
+  Decision match(const QString& url, const QString& sourceHost, ResourceType type) const;
+
+private:
+  bool attach(const uchar* data, qint64 size);
+
+  QByteArray m_ownedBlob;
+  std::unique_ptr<QFile> m_file;
+  const uchar* m_data = nullptr;
+  qint64 m_size = 0;
+};
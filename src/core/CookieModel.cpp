@@ -0,0 +1,788 @@
+#include "CookieModel.h"
+
+#include "PublicSuffixList.h"
+
+#include <QSet>
+
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+// Removed cookies stay in the trigram postings until this many pile up
+// beyond the live count; lookups re-check every candidate anyway.
+constexpr int kStaleIndexSlack = 1024;
+
+// Batches with more changes than this reset the model once instead of
+// sending row signals, which also saves a row rebuild per touched site.
+constexpr int kMaxIncrementalChanges = 64;
+
+quint64 trigramAt(QStringView text, qsizetype i)
+{
+  return (quint64(text.at(i).unicode()) << 32) | (quint64(text.at(i + 1).unicode()) << 16) | text.at(i + 2).unicode();
+}
+
+QString siteKeyFor(const QString& domain)
+{
+  QStringView host(domain);
+  while (host.startsWith(QLatin1Char('.'))) {
+    host = host.mid(1);
+  }
+  return PublicSuffixList::siteKey(host);
+}
+}
+
+CookieModel::CookieModel(QObject* parent)
+  : QAbstractListModel(parent)
+{
+}
+
+int CookieModel::rowCount(const QModelIndex& parent) const
+{
+  if (parent.isValid()) {
+    return 0;
+  }
+  return m_rowCount;
+}
+
+QVariant CookieModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() < 0 || index.row() >= m_rowCount) {
+    return {};
+  }
+
+  const auto [visible, child] = locate(index.row());
+  const Site& site = m_sites.at(m_visibleSites.at(visible));
+  switch (role) {
+    case IsSiteRole:
+      return child < 0;
+    case SiteRole:
+      return site.key;
+    case CookieCountRole:
+      return child < 0 ? int(site.shown.size()) : 0;
+    case ExpandedRole:
+      return child < 0 && site.expanded;
+    default:
+      break;
+  }
+
+  // Site rows answer the cookie roles with empty values so delegates can
+  // declare them as required properties.
+  static const Cookie kNoCookie;
+  const Cookie& cookie = child < 0 ? kNoCookie : m_entries.at(site.shown.at(child)).cookie;
+  switch (role) {
+    case NameRole:
+      return cookie.name;
+    case DomainRole:
+      return cookie.domain;
+    case PathRole:
+      return cookie.path;
+    case ExpiresMsRole:
+      return cookie.expiresMs;
+    case HttpOnlyRole:
+      return cookie.httpOnly;
+    case SecureRole:
+      return cookie.secure;
+    case SessionRole:
+      return cookie.session;
+    default:
+      return {};
+  }
+}
+
+QHash<int, QByteArray> CookieModel::roleNames() const
+{
+  return {
+    {IsSiteRole, "isSite"},
+    {SiteRole, "site"},
+    {CookieCountRole, "cookieCount"},
+    {ExpandedRole, "expanded"},
+    {NameRole, "name"},
+    {DomainRole, "domain"},
+    {PathRole, "path"},
+    {ExpiresMsRole, "expiresMs"},
+    {HttpOnlyRole, "httpOnly"},
+    {SecureRole, "secure"},
+    {SessionRole, "session"},
+  };
+}
+
+CookieSource* CookieModel::source() const
+{
+  return m_source;
+}
+
+void CookieModel::setSource(CookieSource* source)
+{
+  if (m_source == source) {
+    return;
+  }
+
+  if (m_source) {
+    disconnect(m_source, nullptr, this, nullptr);
+  }
+  m_source = source;
+  if (m_source) {
+    connect(m_source, &CookieSource::cookiesLoaded, this, &CookieModel::onLoaded);
+    connect(m_source, &CookieSource::cookiesAdded, this, &CookieModel::onAdded);
+    connect(m_source, &CookieSource::cookiesRemoved, this, &CookieModel::onRemoved);
+    connect(m_source, &CookieSource::failed, this, &CookieModel::onFailed);
+  }
+  emit sourceChanged();
+
+  m_resetOnLoad = true;
+  refresh();
+}
+
+QUrl CookieModel::url() const
+{
+  return m_url;
+}
+
+void CookieModel::setUrl(const QUrl& url)
+{
+  if (m_url == url) {
+    return;
+  }
+  m_url = url;
+  emit urlChanged();
+
+  m_resetOnLoad = true;
+  refresh();
+}
+
+QString CookieModel::filterText() const
+{
+  return m_filter;
+}
+
+void CookieModel::setFilterText(const QString& text)
+{
+  const QString filter = text.trimmed().toLower();
+  if (m_filter == filter) {
+    return;
+  }
+  m_filter = filter;
+
+  beginResetModel();
+  rebuildShown();
+  endResetModel();
+
+  emit filterTextChanged();
+  emit countChanged();
+}
+
+int CookieModel::count() const
+{
+  return m_liveCount;
+}
+
+int CookieModel::siteCount() const
+{
+  return m_visibleSites.size();
+}
+
+int CookieModel::matchCount() const
+{
+  return m_matchCount;
+}
+
+bool CookieModel::loading() const
+{
+  return m_loading;
+}
+
+QString CookieModel::lastError() const
+{
+  return m_lastError;
+}
+
+void CookieModel::refresh()
+{
+  setLastError({});
+  if (!m_source) {
+    resetTo({});
+    setLoading(false);
+    return;
+  }
+
+  setLoading(true);
+  m_source->requestCookies(m_url);
+}
+
+void CookieModel::setExpanded(int row, bool expanded)
+{
+  if (row < 0 || row >= m_rowCount) {
+    return;
+  }
+
+  const auto [visible, child] = locate(row);
+  if (child >= 0) {
+    return;
+  }
+
+  Site& site = m_sites[m_visibleSites.at(visible)];
+  if (site.expanded == expanded) {
+    return;
+  }
+
+  // Children only become rows here, so a collapsed site with thousands of
+  // cookies costs the view nothing.
+  const int children = site.shown.size();
+  if (expanded) {
+    beginInsertRows({}, row + 1, row + children);
+    site.expanded = true;
+    rebuildRows();
+    endInsertRows();
+  } else {
+    beginRemoveRows({}, row + 1, row + children);
+    site.expanded = false;
+    rebuildRows();
+    endRemoveRows();
+  }
+  emit dataChanged(index(row), index(row), {ExpandedRole});
+}
+
+void CookieModel::toggleExpanded(int row)
+{
+  if (row < 0 || row >= m_rowCount) {
+    return;
+  }
+
+  const auto [visible, child] = locate(row);
+  if (child < 0) {
+    setExpanded(row, !m_sites.at(m_visibleSites.at(visible)).expanded);
+  }
+}
+
+void CookieModel::deleteAt(int row)
+{
+  if (!m_source || row < 0 || row >= m_rowCount) {
+    return;
+  }
+
+  setLastError({});
+  const auto [visible, child] = locate(row);
+  const int siteId = m_visibleSites.at(visible);
+  if (child < 0) {
+    m_source->deleteCookies(shownCookies(siteId));
+    return;
+  }
+  m_source->deleteCookies({m_entries.at(m_sites.at(siteId).shown.at(child)).cookie});
+}
+
+void CookieModel::clearAll()
+{
+  if (!m_source || m_visibleSites.isEmpty()) {
+    return;
+  }
+
+  setLastError({});
+  QVector<Cookie> cookies;
+  cookies.reserve(m_matchCount);
+  for (const int siteId : std::as_const(m_visibleSites)) {
+    cookies += shownCookies(siteId);
+  }
+  m_source->deleteCookies(cookies);
+}
+
+void CookieModel::onLoaded(const QVector<Cookie>& cookies)
+{
+  setLoading(false);
+  if (m_resetOnLoad || m_liveCount == 0) {
+    m_resetOnLoad = false;
+    resetTo(cookies);
+    return;
+  }
+
+  // A reload of the same scope only touches the rows that changed.
+  QSet<QString> incoming;
+  incoming.reserve(cookies.size());
+  int added = 0;
+  for (const Cookie& cookie : cookies) {
+    const QString key = CookieSource::cookieKey(cookie);
+    incoming.insert(key);
+    if (!m_idByKey.contains(key)) {
+      ++added;
+    }
+  }
+  QVector<int> gone;
+  for (int id = 0; id < m_entries.size(); ++id) {
+    if (m_entries.at(id).site >= 0 && !incoming.contains(m_entries.at(id).key)) {
+      gone.push_back(id);
+    }
+  }
+
+  if (gone.size() + added > kMaxIncrementalChanges) {
+    beginResetModel();
+    for (const int id : std::as_const(gone)) {
+      releaseCookie(id);
+    }
+    for (const Cookie& cookie : cookies) {
+      const int existing = m_idByKey.value(CookieSource::cookieKey(cookie), -1);
+      if (existing >= 0) {
+        m_entries[existing].cookie = cookie;
+        continue;
+      }
+      const int id = storeCookie(cookie);
+      Site& site = m_sites[m_entries.at(id).site];
+      site.cookies.insert(orderedPosition(site.cookies, id), id);
+    }
+    rebuildShown();
+    endResetModel();
+  } else {
+    removeCookies(gone);
+    for (const Cookie& cookie : cookies) {
+      insertCookie(cookie);
+    }
+  }
+  emit countChanged();
+}
+
+void CookieModel::onAdded(const QVector<Cookie>& cookies)
+{
+  for (const Cookie& cookie : cookies) {
+    if (inScope(cookie)) {
+      insertCookie(cookie);
+    }
+  }
+  emit countChanged();
+}
+
+void CookieModel::onRemoved(const QVector<Cookie>& cookies)
+{
+  QVector<int> ids;
+  ids.reserve(cookies.size());
+  for (const Cookie& cookie : cookies) {
+    const int id = m_idByKey.value(CookieSource::cookieKey(cookie), -1);
+    if (id >= 0) {
+      ids.push_back(id);
+    }
+  }
+  removeCookies(ids);
+  emit countChanged();
+}
+
+void CookieModel::onFailed(const QString& error)
+{
+  setLoading(false);
+  setLastError(error);
+}
+
+void CookieModel::resetTo(const QVector<Cookie>& cookies)
+{
+  beginResetModel();
+  clearEntries();
+
+  m_entries.reserve(cookies.size());
+  for (const Cookie& cookie : cookies) {
+    const int existing = m_idByKey.value(CookieSource::cookieKey(cookie), -1);
+    if (existing >= 0) {
+      m_entries[existing].cookie = cookie;
+      continue;
+    }
+    const int id = storeCookie(cookie);
+    m_sites[m_entries.at(id).site].cookies.push_back(id);
+  }
+
+  const auto less = [this](int a, int b) {
+    return cookieLess(a, b);
+  };
+  for (Site& site : m_sites) {
+    std::sort(site.cookies.begin(), site.cookies.end(), less);
+  }
+  rebuildShown();
+  endResetModel();
+
+  emit countChanged();
+}
+
+void CookieModel::clearEntries()
+{
+  m_entries.clear();
+  m_freeIds.clear();
+  m_idByKey.clear();
+  m_liveCount = 0;
+  m_matchCount = 0;
+  m_sites.clear();
+  m_freeSites.clear();
+  m_siteByKey.clear();
+  m_visibleSites.clear();
+  m_rowStarts.clear();
+  m_rowCount = 0;
+  m_trigrams.clear();
+  m_staleIndexEntries = 0;
+}
+
+int CookieModel::storeCookie(const Cookie& cookie)
+{
+  const int site = siteFor(cookie.domain);
+
+  int id = 0;
+  if (!m_freeIds.isEmpty()) {
+    id = m_freeIds.takeLast();
+  } else {
+    id = m_entries.size();
+    m_entries.push_back({});
+  }
+
+  Entry& entry = m_entries[id];
+  entry.cookie = cookie;
+  entry.key = CookieSource::cookieKey(cookie);
+  entry.searchText = (cookie.domain + QLatin1Char(' ') + cookie.name).toLower();
+  entry.site = site;
+  m_idByKey.insert(entry.key, id);
+  indexCookie(id);
+  ++m_liveCount;
+  return id;
+}
+
+void CookieModel::releaseCookie(int id)
+{
+  Entry& entry = m_entries[id];
+  const int siteId = entry.site;
+  Site& site = m_sites[siteId];
+  site.cookies.removeAt(orderedPosition(site.cookies, id));
+  if (site.cookies.isEmpty()) {
+    m_siteByKey.remove(site.key);
+    site = {};
+    m_freeSites.push_back(siteId);
+  }
+
+  m_idByKey.remove(entry.key);
+  entry = {};
+  m_freeIds.push_back(id);
+  --m_liveCount;
+
+  if (++m_staleIndexEntries > m_liveCount + kStaleIndexSlack) {
+    rebuildIndex();
+  }
+}
+
+void CookieModel::insertCookie(const Cookie& cookie)
+{
+  const int existing = m_idByKey.value(CookieSource::cookieKey(cookie), -1);
+  if (existing >= 0) {
+    // Same name, domain and path: only the attributes changed.
+    m_entries[existing].cookie = cookie;
+    const int siteId = m_entries.at(existing).site;
+    const Site& site = m_sites.at(siteId);
+    const int pos = orderedPosition(site.shown, existing);
+    if (site.expanded && pos < site.shown.size() && site.shown.at(pos) == existing) {
+      const int row = m_rowStarts.at(visibleIndexOf(siteId)) + 1 + pos;
+      emit dataChanged(index(row), index(row));
+    }
+    return;
+  }
+
+  const int id = storeCookie(cookie);
+  const int siteId = m_entries.at(id).site;
+  Site& site = m_sites[siteId];
+  site.cookies.insert(orderedPosition(site.cookies, id), id);
+  if (!matchesFilter(m_entries.at(id))) {
+    return;
+  }
+  ++m_matchCount;
+
+  if (site.shown.isEmpty()) {
+    const int visible = visiblePosition(site.key);
+    const int row = visible < m_rowStarts.size() ? m_rowStarts.at(visible) : m_rowCount;
+    beginInsertRows({}, row, row + (site.expanded ? 1 : 0));
+    site.shown.push_back(id);
+    m_visibleSites.insert(visible, siteId);
+    rebuildRows();
+    endInsertRows();
+    return;
+  }
+
+  const int pos = orderedPosition(site.shown, id);
+  const int siteRow = m_rowStarts.at(visibleIndexOf(siteId));
+  if (site.expanded) {
+    beginInsertRows({}, siteRow + 1 + pos, siteRow + 1 + pos);
+    site.shown.insert(pos, id);
+    rebuildRows();
+    endInsertRows();
+  } else {
+    site.shown.insert(pos, id);
+  }
+  emit dataChanged(index(siteRow), index(siteRow), {CookieCountRole});
+}
+
+void CookieModel::removeCookies(QVector<int> ids)
+{
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  if (ids.isEmpty()) {
+    return;
+  }
+
+  if (ids.size() > kMaxIncrementalChanges) {
+    beginResetModel();
+    for (const int id : std::as_const(ids)) {
+      releaseCookie(id);
+    }
+    rebuildShown();
+    endResetModel();
+    return;
+  }
+
+  // Each touched site drops its rows in contiguous runs and repaints its
+  // count once, however many of its cookies went.
+  QHash<int, QVector<int>> idsBySite;
+  for (const int id : std::as_const(ids)) {
+    idsBySite[m_entries.at(id).site].push_back(id);
+  }
+  for (auto it = idsBySite.cbegin(); it != idsBySite.cend(); ++it) {
+    const int siteId = it.key();
+    Site& site = m_sites[siteId];
+    QVector<int> positions;
+    for (const int id : it.value()) {
+      const int pos = orderedPosition(site.shown, id);
+      if (pos < site.shown.size() && site.shown.at(pos) == id) {
+        positions.push_back(pos);
+      }
+    }
+
+    if (!positions.isEmpty()) {
+      m_matchCount -= positions.size();
+      const int visible = visibleIndexOf(siteId);
+      const int siteRow = m_rowStarts.at(visible);
+      if (positions.size() == site.shown.size()) {
+        beginRemoveRows({}, siteRow, siteRow + (site.expanded ? int(site.shown.size()) : 0));
+        site.shown.clear();
+        m_visibleSites.removeAt(visible);
+        rebuildRows();
+        endRemoveRows();
+      } else {
+        // Bottom-up, so the positions still to go keep their rows.
+        std::sort(positions.begin(), positions.end(), std::greater<int>());
+        for (int i = 0; i < positions.size();) {
+          int end = i + 1;
+          while (end < positions.size() && positions.at(end) == positions.at(end - 1) - 1) {
+            ++end;
+          }
+          const int first = positions.at(end - 1);
+          const int count = end - i;
+          if (site.expanded) {
+            beginRemoveRows({}, siteRow + 1 + first, siteRow + first + count);
+            site.shown.remove(first, count);
+            rebuildRows();
+            endRemoveRows();
+          } else {
+            site.shown.remove(first, count);
+          }
+          i = end;
+        }
+        emit dataChanged(index(siteRow), index(siteRow), {CookieCountRole});
+      }
+    }
+
+    for (const int id : it.value()) {
+      releaseCookie(id);
+    }
+  }
+}
+
+int CookieModel::siteFor(const QString& domain)
+{
+  const QString key = siteKeyFor(domain);
+  const auto it = m_siteByKey.constFind(key);
+  if (it != m_siteByKey.constEnd()) {
+    return it.value();
+  }
+
+  int siteId = 0;
+  if (!m_freeSites.isEmpty()) {
+    siteId = m_freeSites.takeLast();
+  } else {
+    siteId = m_sites.size();
+    m_sites.push_back({});
+  }
+  m_sites[siteId].key = key;
+  m_siteByKey.insert(key, siteId);
+  return siteId;
+}
+
+bool CookieModel::inScope(const Cookie& cookie) const
+{
+  return m_url.isEmpty() || CookieSource::domainMatches(m_url.host(), cookie.domain);
+}
+
+bool CookieModel::cookieLess(int a, int b) const
+{
+  const Cookie& x = m_entries.at(a).cookie;
+  const Cookie& y = m_entries.at(b).cookie;
+  if (const int c = QString::compare(x.name, y.name, Qt::CaseInsensitive)) {
+    return c < 0;
+  }
+  if (const int c = QString::compare(x.name, y.name)) {
+    return c < 0;
+  }
+  if (const int c = QString::compare(x.path, y.path)) {
+    return c < 0;
+  }
+  return QString::compare(x.domain, y.domain) < 0;
+}
+
+int CookieModel::orderedPosition(const QVector<int>& ids, int id) const
+{
+  const auto it = std::lower_bound(ids.cbegin(), ids.cend(), id, [this](int a, int b) {
+    return cookieLess(a, b);
+  });
+  return int(it - ids.cbegin());
+}
+
+int CookieModel::visibleIndexOf(int siteId) const
+{
+  const int pos = visiblePosition(m_sites.at(siteId).key);
+  return pos < m_visibleSites.size() && m_visibleSites.at(pos) == siteId ? pos : -1;
+}
+
+int CookieModel::visiblePosition(const QString& siteKey) const
+{
+  const auto it = std::lower_bound(m_visibleSites.cbegin(), m_visibleSites.cend(), siteKey, [this](int siteId, const QString& key) {
+    return m_sites.at(siteId).key < key;
+  });
+  return int(it - m_visibleSites.cbegin());
+}
+
+void CookieModel::rebuildRows()
+{
+  m_rowStarts.resize(m_visibleSites.size());
+  int row = 0;
+  for (int i = 0; i < m_visibleSites.size(); ++i) {
+    m_rowStarts[i] = row;
+    const Site& site = m_sites.at(m_visibleSites.at(i));
+    row += 1 + (site.expanded ? site.shown.size() : 0);
+  }
+  m_rowCount = row;
+}
+
+void CookieModel::rebuildShown()
+{
+  const bool filtered = !m_filter.isEmpty();
+  const QVector<bool> matches = filtered ? matchingIds() : QVector<bool>();
+
+  m_visibleSites.clear();
+  m_matchCount = 0;
+  for (int siteId = 0; siteId < m_sites.size(); ++siteId) {
+    Site& site = m_sites[siteId];
+    if (!filtered) {
+      site.shown = site.cookies;
+    } else {
+      site.shown.clear();
+      for (const int id : std::as_const(site.cookies)) {
+        if (matches.at(id)) {
+          site.shown.push_back(id);
+        }
+      }
+    }
+    if (!site.shown.isEmpty()) {
+      m_visibleSites.push_back(siteId);
+      m_matchCount += site.shown.size();
+    }
+  }
+
+  std::sort(m_visibleSites.begin(), m_visibleSites.end(), [this](int a, int b) {
+    return m_sites.at(a).key < m_sites.at(b).key;
+  });
+  rebuildRows();
+}
+
+QPair<int, int> CookieModel::locate(int row) const
+{
+  const auto it = std::upper_bound(m_rowStarts.cbegin(), m_rowStarts.cend(), row);
+  const int visible = int(it - m_rowStarts.cbegin()) - 1;
+  return {visible, row - m_rowStarts.at(visible) - 1};
+}
+
+QVector<CookieModel::Cookie> CookieModel::shownCookies(int siteId) const
+{
+  QVector<Cookie> cookies;
+  const Site& site = m_sites.at(siteId);
+  cookies.reserve(site.shown.size());
+  for (const int id : site.shown) {
+    cookies.push_back(m_entries.at(id).cookie);
+  }
+  return cookies;
+}
+
+void CookieModel::indexCookie(int id)
+{
+  const QString& text = m_entries.at(id).searchText;
+  for (qsizetype i = 0; i + 2 < text.size(); ++i) {
+    QVector<int>& posting = m_trigrams[trigramAt(text, i)];
+    if (posting.isEmpty() || posting.last() != id) {
+      posting.push_back(id);
+    }
+  }
+}
+
+void CookieModel::rebuildIndex()
+{
+  m_trigrams.clear();
+  m_staleIndexEntries = 0;
+  for (int id = 0; id < m_entries.size(); ++id) {
+    if (m_entries.at(id).site >= 0) {
+      indexCookie(id);
+    }
+  }
+}
+
+QVector<bool> CookieModel::matchingIds() const
+{
+  QVector<bool> matches(m_entries.size(), false);
+
+  // Too short for a trigram: check every cookie.
+  if (m_filter.size() < 3) {
+    for (int id = 0; id < m_entries.size(); ++id) {
+      matches[id] = m_entries.at(id).site >= 0 && matchesFilter(m_entries.at(id));
+    }
+    return matches;
+  }
+
+  // Every match holds all of the filter's trigrams, so the shortest posting
+  // list is a superset of the answer.
+  const QVector<int>* candidates = nullptr;
+  for (qsizetype i = 0; i + 2 < m_filter.size(); ++i) {
+    const auto it = m_trigrams.constFind(trigramAt(m_filter, i));
+    if (it == m_trigrams.constEnd()) {
+      return matches;
+    }
+    if (!candidates || it.value().size() < candidates->size()) {
+      candidates = &it.value();
+    }
+  }
+
+  for (const int id : *candidates) {
+    const Entry& entry = m_entries.at(id);
+    if (entry.site >= 0 && matchesFilter(entry)) {
+      matches[id] = true;
+    }
+  }
+  return matches;
+}
+
+bool CookieModel::matchesFilter(const Entry& entry) const
+{
+  return m_filter.isEmpty() || entry.searchText.contains(m_filter);
+}
+
+void CookieModel::setLoading(bool loading)
+{
+  if (m_loading == loading) {
+    return;
+  }
+  m_loading = loading;
+  emit loadingChanged();
+}
+
+void CookieModel::setLastError(const QString& error)
+{
+  const QString trimmed = error.trimmed();
+  if (m_lastError == trimmed) {
+    return;
+  }
+  m_lastError = trimmed;
+  emit lastErrorChanged();
+}
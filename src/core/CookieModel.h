@@ -0,0 +1,163 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+
+#include "CookieSource.h"
+
+// Cookies grouped by site (registrable domain), as a flat list a ListView
+// can virtualize: one row per site, followed by its cookies while the site
+// is expanded. Collapsed sites cost one row however many cookies they hold.
+//
+// Loads come from a CookieSource. The first load resets the model; later
+// loads and the source's add/remove notifications are applied as row
+// inserts and removes, so deleting a cookie never reloads the list.
+// filterText matches cookie names and domains through a trigram index.
+class CookieModel final : public QAbstractListModel
+{
+  Q_OBJECT
+  Q_PROPERTY(CookieSource* source READ source WRITE setSource NOTIFY sourceChanged)
+  Q_PROPERTY(QUrl url READ url WRITE setUrl NOTIFY urlChanged)
+  Q_PROPERTY(QString filterText READ filterText WRITE setFilterText NOTIFY filterTextChanged)
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(int siteCount READ siteCount NOTIFY countChanged)
+  Q_PROPERTY(int matchCount READ matchCount NOTIFY countChanged)
+  Q_PROPERTY(bool loading READ loading NOTIFY loadingChanged)
+  Q_PROPERTY(QString lastError READ lastError NOTIFY lastErrorChanged)
+
+public:
+  enum Role
+  {
+    IsSiteRole = Qt::UserRole + 1,
+    SiteRole,
+    CookieCountRole,
+    ExpandedRole,
+    NameRole,
+    DomainRole,
+    PathRole,
+    ExpiresMsRole,
+    HttpOnlyRole,
+    SecureRole,
+    SessionRole,
+  };
+  Q_ENUM(Role)
+
+  using Cookie = CookieSource::Cookie;
+
+  explicit CookieModel(QObject* parent = nullptr);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  CookieSource* source() const;
+  void setSource(CookieSource* source);
+
+  // Empty lists every cookie the source has.
+  QUrl url() const;
+  void setUrl(const QUrl& url);
+
+  QString filterText() const;
+  void setFilterText(const QString& text);
+
+  // All cookies loaded, sites with a cookie matching the filter, and the
+  // matching cookies.
+  int count() const;
+  int siteCount() const;
+  int matchCount() const;
+  bool loading() const;
+  QString lastError() const;
+
+  Q_INVOKABLE void refresh();
+  Q_INVOKABLE void setExpanded(int row, bool expanded);
+  Q_INVOKABLE void toggleExpanded(int row);
+  // A site row deletes that site's matching cookies.
+  Q_INVOKABLE void deleteAt(int row);
+  Q_INVOKABLE void clearAll();
+
+signals:
+  void sourceChanged();
+  void urlChanged();
+  void filterTextChanged();
+  void countChanged();
+  void loadingChanged();
+  void lastErrorChanged();
+
+private:
+  struct Entry
+  {
+    Cookie cookie;
+    QString key;
+    // Lowercased "domain name", what the filter matches against.
+    QString searchText;
+    int site = -1;
+  };
+
+  struct Site
+  {
+    QString key;
+    // Cookie ids in display order; shown holds those matching the filter.
+    QVector<int> cookies;
+    QVector<int> shown;
+    bool expanded = false;
+  };
+
+  void onLoaded(const QVector<Cookie>& cookies);
+  void onAdded(const QVector<Cookie>& cookies);
+  void onRemoved(const QVector<Cookie>& cookies);
+  void onFailed(const QString& error);
+
+  void resetTo(const QVector<Cookie>& cookies);
+  void clearEntries();
+  int storeCookie(const Cookie& cookie);
+  void releaseCookie(int id);
+  void insertCookie(const Cookie& cookie);
+  void removeCookies(QVector<int> ids);
+  int siteFor(const QString& domain);
+  bool inScope(const Cookie& cookie) const;
+
+  bool cookieLess(int a, int b) const;
+  int orderedPosition(const QVector<int>& ids, int id) const;
+  int visibleIndexOf(int siteId) const;
+  int visiblePosition(const QString& siteKey) const;
+  void rebuildRows();
+  void rebuildShown();
+  // Row -> (position in m_visibleSites, child index; -1 for the site row).
+  QPair<int, int> locate(int row) const;
+  QVector<Cookie> shownCookies(int siteId) const;
+
+  void indexCookie(int id);
+  void rebuildIndex();
+  QVector<bool> matchingIds() const;
+  bool matchesFilter(const Entry& entry) const;
+
+  void setLoading(bool loading);
+  void setLastError(const QString& error);
+
+  QPointer<CookieSource> m_source;
+  QUrl m_url;
+  QString m_filter;
+  bool m_loading = false;
+  bool m_resetOnLoad = true;
+  QString m_lastError;
+
+  QVector<Entry> m_entries;
+  QVector<int> m_freeIds;
+  QHash<QString, int> m_idByKey;
+  int m_liveCount = 0;
+  int m_matchCount = 0;
+
+  QVector<Site> m_sites;
+  QVector<int> m_freeSites;
+  QHash<QString, int> m_siteByKey;
+  // Sites with a matching cookie, ordered by key, and the row each starts at.
+  QVector<int> m_visibleSites;
+  QVector<int> m_rowStarts;
+  int m_rowCount = 0;
+
+  QHash<quint64, QVector<int>> m_trigrams;
+  int m_staleIndexEntries = 0;
+};
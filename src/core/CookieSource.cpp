@@ -0,0 +1,99 @@
+#include "CookieSource.h"
+
+CookieSource::CookieSource(QObject* parent)
+  : QObject(parent)
+{
+}
+
+QString CookieSource::cookieKey(const Cookie& cookie)
+{
+  return cookie.domain + QLatin1Char('\n') + cookie.name + QLatin1Char('\n') + cookie.path;
+}
+
+bool CookieSource::domainMatches(const QString& host, const QString& cookieDomain)
+{
+  QStringView domain(cookieDomain);
+  if (domain.startsWith(QLatin1Char('.'))) {
+    domain = domain.mid(1);
+  }
+  if (domain.isEmpty() || host.isEmpty()) {
+    return false;
+  }
+  if (host.compare(domain, Qt::CaseInsensitive) == 0) {
+    return true;
+  }
+  return host.size() > domain.size() && host.endsWith(domain, Qt::CaseInsensitive)
+         && host.at(host.size() - domain.size() - 1) == QLatin1Char('.');
+}
+
+MemoryCookieSource::MemoryCookieSource(QObject* parent)
+  : CookieSource(parent)
+{
+}
+
+void MemoryCookieSource::requestCookies(const QUrl& url)
+{
+  ++m_requestCount;
+  if (url.isEmpty()) {
+    emit cookiesLoaded(m_cookies);
+    return;
+  }
+
+  QVector<Cookie> matching;
+  const QString host = url.host();
+  for (const Cookie& cookie : std::as_const(m_cookies)) {
+    if (domainMatches(host, cookie.domain)) {
+      matching.push_back(cookie);
+    }
+  }
+  emit cookiesLoaded(matching);
+}
+
+void MemoryCookieSource::deleteCookies(const QVector<Cookie>& cookies)
+{
+  QVector<Cookie> removed;
+  for (const Cookie& cookie : cookies) {
+    const auto it = m_indexByKey.constFind(cookieKey(cookie));
+    if (it == m_indexByKey.constEnd()) {
+      continue;
+    }
+
+    // Swap with the last cookie so removal stays O(1).
+    const int index = it.value();
+    removed.push_back(m_cookies.at(index));
+    m_indexByKey.erase(it);
+    if (index != m_cookies.size() - 1) {
+      m_cookies[index] = m_cookies.takeLast();
+      m_indexByKey.insert(cookieKey(m_cookies.at(index)), index);
+    } else {
+      m_cookies.removeLast();
+    }
+  }
+
+  if (!removed.isEmpty()) {
+    emit cookiesRemoved(removed);
+  }
+}
+
+void MemoryCookieSource::setCookies(const QVector<Cookie>& cookies)
+{
+  for (const Cookie& cookie : cookies) {
+    const QString key = cookieKey(cookie);
+    const auto it = m_indexByKey.constFind(key);
+    if (it != m_indexByKey.constEnd()) {
+      m_cookies[it.value()] = cookie;
+    } else {
+      m_indexByKey.insert(key, m_cookies.size());
+      m_cookies.push_back(cookie);
+    }
+  }
+
+  if (!cookies.isEmpty()) {
+    emit cookiesAdded(cookies);
+  }
+}
+
+int MemoryCookieSource::requestCount() const
+{
+  return m_requestCount;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+// Where CookieModel gets cookies from. Requests are asynchronous and answered
+// through signals on the GUI thread; a newer requestCookies supersedes one
+// still in flight. Sources that can observe changes report them through
+// cookiesAdded and cookiesRemoved, which the model applies as deltas.
+class CookieSource : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Cookie
+  {
+    QString name;
+    QString domain;
+    QString path;
+    qint64 expiresMs = 0;
+    bool httpOnly = false;
+    bool secure = false;
+    bool session = false;
+  };
+
+  explicit CookieSource(QObject* parent = nullptr);
+
+  // Cookies that would be sent to url, or every cookie when url is empty.
+  virtual void requestCookies(const QUrl& url) = 0;
+  virtual void deleteCookies(const QVector<Cookie>& cookies) = 0;
+
+  // Name, domain and path identify a cookie; setting it again replaces it.
+  static QString cookieKey(const Cookie& cookie);
+  static bool domainMatches(const QString& host, const QString& cookieDomain);
+
+signals:
+  void cookiesLoaded(const QVector<CookieSource::Cookie>& cookies);
+  void cookiesAdded(const QVector<CookieSource::Cookie>& cookies);
+  void cookiesRemoved(const QVector<CookieSource::Cookie>& cookies);
+  void failed(const QString& error);
+};
+
+// Answers synchronously from a list held in memory. Used by tests and
+// anywhere no web engine is around.
+class MemoryCookieSource final : public CookieSource
+{
+  Q_OBJECT
+
+public:
+  explicit MemoryCookieSource(QObject* parent = nullptr);
+
+  void requestCookies(const QUrl& url) override;
+  void deleteCookies(const QVector<Cookie>& cookies) override;
+
+  void setCookies(const QVector<Cookie>& cookies);
+  int requestCount() const;
+
+private:
+  QVector<Cookie> m_cookies;
+  QHash<QString, int> m_indexByKey;
+  int m_requestCount = 0;
+};
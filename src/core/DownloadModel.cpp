@@ -1,17 +1,19 @@
 #include "DownloadModel.h"
 
-#include "AppPaths.h"
+#include "UserDataStorage.h"
 
 #include <QDesktopServices>
-#include <QDir>
-#include <QFile>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QSaveFile>
 #include <QUrl>
 
+namespace
+{
+const QString kStorageName = QStringLiteral("downloads.json");
+}
+
 DownloadModel::DownloadModel(QObject* parent)
   : QAbstractListModel(parent)
 {
@@ -189,6 +191,14 @@ void DownloadModel::markFinishedById(int downloadId, bool success, const QString
   saveNow();
 }
 
+bool DownloadModel::isInProgress(int downloadId)
+{
+  ensureLoaded();
+
+  const int row = findIndexById(downloadId);
+  return row >= 0 && m_entries[row].state == State::InProgress;
+}
+
 void DownloadModel::clearFinished()
 {
   ensureLoaded();
@@ -438,12 +448,12 @@ void DownloadModel::updateActiveCount()
 
 void DownloadModel::ensureStoragePath()
 {
-  const QString nextPath = QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("downloads.json"));
-  if (nextPath == m_storagePath) {
+  const QString nextKey = xbrowser::userDataStorage().locationKey(kStorageName);
+  if (nextKey == m_storageKey) {
     return;
   }
 
-  m_storagePath = nextPath;
+  m_storageKey = nextKey;
   m_loaded = false;
   m_entries.clear();
   m_nextId = 1;
@@ -464,16 +474,17 @@ void DownloadModel::ensureLoaded()
 
 bool DownloadModel::loadNow()
 {
-  if (m_storagePath.isEmpty()) {
+  if (m_storageKey.isEmpty()) {
     return false;
   }
 
-  QFile f(m_storagePath);
-  if (!f.exists() || !f.open(QIODevice::ReadOnly)) {
+  QByteArray payload;
+  const xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (!storage.exists(kStorageName) || !storage.read(kStorageName, &payload)) {
     return true;
   }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
   if (!doc.isObject()) {
     return false;
   }
@@ -555,7 +566,7 @@ bool DownloadModel::loadNow()
 
 bool DownloadModel::saveNow() const
 {
-  if (m_storagePath.isEmpty()) {
+  if (m_storageKey.isEmpty()) {
     return false;
   }
 
@@ -582,12 +593,5 @@ bool DownloadModel::saveNow() const
   root.insert(QStringLiteral("nextId"), m_nextId);
   root.insert(QStringLiteral("downloads"), items);
 
-  QSaveFile out(m_storagePath);
-  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-    return false;
-  }
-
-  out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
-  out.write("\n");
-  return out.commit();
+  return xbrowser::userDataStorage().write(kStorageName, QJsonDocument(root).toJson(QJsonDocument::Compact) + '\n');
 }
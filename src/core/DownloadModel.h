@@ -40,6 +40,7 @@ public:
   Q_INVOKABLE void updateProgress(int downloadId, qint64 bytesReceived, qint64 totalBytes, bool paused, bool canResume, const QString& interruptReason);
   Q_INVOKABLE void markFinished(const QString& uri, const QString& filePath, bool success);
   Q_INVOKABLE void markFinishedById(int downloadId, bool success, const QString& interruptReason);
+  Q_INVOKABLE bool isInProgress(int downloadId);
   Q_INVOKABLE void clearFinished();
   Q_INVOKABLE void clearAll();
   Q_INVOKABLE void clearRange(qint64 fromMs, qint64 toMs);
@@ -88,6 +89,6 @@ private:
   QVector<Entry> m_entries;
   int m_nextId = 1;
   int m_activeCount = 0;
-  QString m_storagePath;
+  QString m_storageKey;
   bool m_loaded = false;
 };
@@ -0,0 +1,305 @@
+#include "ExtensionManifestCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+
+namespace
+{
+constexpr int kMaxWorkerThreads = 2;
+
+QStringList uniqueTrimmedStrings(const QJsonArray& arr)
+{
+  QStringList out;
+  for (const QJsonValue& v : arr) {
+    const QString s = v.toString().trimmed();
+    if (!s.isEmpty() && !out.contains(s)) {
+      out.push_back(s);
+    }
+  }
+  return out;
+}
+
+QString resolveIconPath(const QString& installPath, const QJsonObject& iconsObj)
+{
+  QStringList candidates;
+  const int preferredSizes[] = { 32, 24, 16, 48, 64, 128, 256 };
+  for (int size : preferredSizes) {
+    const QString candidate = iconsObj.value(QString::number(size)).toString().trimmed();
+    if (!candidate.isEmpty()) {
+      candidates.push_back(candidate);
+    }
+  }
+  for (auto it = iconsObj.begin(); it != iconsObj.end(); ++it) {
+    const QString candidate = it.value().toString().trimmed();
+    if (!candidate.isEmpty() && !candidates.contains(candidate)) {
+      candidates.push_back(candidate);
+    }
+  }
+
+  const QDir dir(installPath);
+  for (const QString& candidate : candidates) {
+    QString rel = candidate;
+    while (rel.startsWith('/')) {
+      rel.remove(0, 1);
+    }
+    const QString path = dir.filePath(rel);
+    if (QFileInfo::exists(path)) {
+      return path;
+    }
+  }
+  return {};
+}
+
+QVector<ExtensionManifest::Command> parseCommands(const QJsonObject& commandsObj)
+{
+  QVector<ExtensionManifest::Command> out;
+  for (auto it = commandsObj.begin(); it != commandsObj.end(); ++it) {
+    const QString commandId = it.key().trimmed();
+    if (commandId.isEmpty() || !it.value().isObject()) {
+      continue;
+    }
+
+    const QJsonObject obj = it.value().toObject();
+
+    QString shortcut;
+    const QJsonValue suggested = obj.value(QStringLiteral("suggested_key"));
+    if (suggested.isObject()) {
+      const QJsonObject suggestedObj = suggested.toObject();
+      shortcut = suggestedObj.value(QStringLiteral("windows")).toString().trimmed();
+      if (shortcut.isEmpty()) {
+        shortcut = suggestedObj.value(QStringLiteral("default")).toString().trimmed();
+      }
+    } else if (suggested.isString()) {
+      shortcut = suggested.toString().trimmed();
+    }
+
+    ExtensionManifest::Command command;
+    command.id = commandId;
+    command.description = obj.value(QStringLiteral("description")).toString().trimmed();
+    command.shortcut = shortcut;
+    out.push_back(command);
+  }
+  return out;
+}
+}
+
+ExtensionManifestCache& ExtensionManifestCache::instance()
+{
+  static ExtensionManifestCache cache;
+  return cache;
+}
+
+ExtensionManifestCache::ExtensionManifestCache(QObject* parent)
+  : QObject(parent)
+{
+  m_pool.setMaxThreadCount(kMaxWorkerThreads);
+  m_pool.setExpiryTimeout(5000);
+}
+
+ExtensionManifestCache::~ExtensionManifestCache()
+{
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
+QString ExtensionManifestCache::manifestPath(const QString& installPath)
+{
+  return QDir(installPath).filePath(QStringLiteral("manifest.json"));
+}
+
+bool ExtensionManifestCache::statManifest(const QString& installPath, qint64* size, qint64* mtimeMs)
+{
+  const QFileInfo info(manifestPath(installPath));
+  if (!info.exists() || !info.isFile()) {
+    return false;
+  }
+  if (size) {
+    *size = info.size();
+  }
+  if (mtimeMs) {
+    *mtimeMs = info.lastModified().toMSecsSinceEpoch();
+  }
+  return true;
+}
+
+ExtensionManifest ExtensionManifestCache::parse(const QString& installPath)
+{
+  ExtensionManifest manifest;
+  manifest.installPath = installPath;
+
+  QFile f(manifestPath(installPath));
+  if (!f.open(QIODevice::ReadOnly)) {
+    return manifest;
+  }
+
+  const QFileInfo info(f);
+  manifest.manifestSize = info.size();
+  manifest.manifestMtimeMs = info.lastModified().toMSecsSinceEpoch();
+
+  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  if (!doc.isObject()) {
+    return manifest;
+  }
+
+  const QJsonObject root = doc.object();
+  manifest.valid = true;
+  manifest.name = root.value(QStringLiteral("name")).toString().trimmed();
+  manifest.version = root.value(QStringLiteral("version")).toString().trimmed();
+  manifest.description = root.value(QStringLiteral("description")).toString().trimmed();
+  manifest.permissions = uniqueTrimmedStrings(root.value(QStringLiteral("permissions")).toArray());
+  manifest.hostPermissions = uniqueTrimmedStrings(root.value(QStringLiteral("host_permissions")).toArray());
+  manifest.iconPath = resolveIconPath(installPath, root.value(QStringLiteral("icons")).toObject());
+
+  QJsonObject actionObj = root.value(QStringLiteral("action")).toObject();
+  if (actionObj.isEmpty()) {
+    actionObj = root.value(QStringLiteral("browser_action")).toObject();
+  }
+  if (actionObj.isEmpty()) {
+    actionObj = root.value(QStringLiteral("page_action")).toObject();
+  }
+  manifest.popupRelPath = actionObj.value(QStringLiteral("default_popup")).toString().trimmed();
+
+  const QJsonObject optionsUiObj = root.value(QStringLiteral("options_ui")).toObject();
+  if (!optionsUiObj.isEmpty() && optionsUiObj.contains(QStringLiteral("page"))) {
+    manifest.optionsRelPath = optionsUiObj.value(QStringLiteral("page")).toString().trimmed();
+  } else {
+    manifest.optionsRelPath = root.value(QStringLiteral("options_page")).toString().trimmed();
+  }
+
+  manifest.commands = parseCommands(root.value(QStringLiteral("commands")).toObject());
+  return manifest;
+}
+
+ExtensionManifest ExtensionManifestCache::manifestFor(const QString& installPath)
+{
+  const QString path = installPath.trimmed();
+  if (path.isEmpty()) {
+    return {};
+  }
+
+  qint64 size = -1;
+  qint64 mtimeMs = 0;
+  if (!statManifest(path, &size, &mtimeMs)) {
+    m_cache.remove(path);
+    return {};
+  }
+
+  const auto it = m_cache.constFind(path);
+  if (it != m_cache.constEnd() && it->manifestSize == size && it->manifestMtimeMs == mtimeMs) {
+    return it.value();
+  }
+
+  const ExtensionManifest manifest = parse(path);
+  ++m_parseCount;
+  remember(manifest);
+  return manifest;
+}
+
+void ExtensionManifestCache::scanAsync(const QVector<ScanRequest>& requests, QObject* context,
+                                       std::function<void(const QVector<ScanResult>&)> done)
+{
+  QHash<QString, Stamp> cachedStamps;
+  for (const ScanRequest& request : requests) {
+    const auto it = m_cache.constFind(request.installPath);
+    if (it != m_cache.constEnd()) {
+      cachedStamps.insert(request.installPath, Stamp{it->manifestSize, it->manifestMtimeMs});
+    }
+  }
+
+  ++m_pendingScans;
+  QPointer<QObject> guard(context);
+  m_pool.start([this, requests, cachedStamps, guard, done] {
+    QVector<ScanResult> results;
+    results.reserve(requests.size());
+
+    for (const ScanRequest& request : requests) {
+      ScanResult result;
+      result.installPath = request.installPath;
+      result.exists = statManifest(request.installPath, &result.manifestSize, &result.manifestMtimeMs);
+      if (!result.exists) {
+        results.push_back(result);
+        continue;
+      }
+
+      const bool knownMatches = request.knownMtimeMs > 0 && request.knownMtimeMs == result.manifestMtimeMs
+                                && (request.knownSize < 0 || request.knownSize == result.manifestSize);
+      result.changed = !knownMatches;
+
+      if (result.changed) {
+        const auto cached = cachedStamps.constFind(request.installPath);
+        const bool cacheMatches = cached != cachedStamps.constEnd() && cached->size == result.manifestSize
+                                  && cached->mtimeMs == result.manifestMtimeMs;
+        if (!cacheMatches) {
+          result.manifest = parse(request.installPath);
+          result.parsed = true;
+        }
+      }
+      results.push_back(result);
+    }
+
+    QMetaObject::invokeMethod(
+      this,
+      [this, results, guard, done]() mutable {
+        m_pendingScans = qMax(0, m_pendingScans - 1);
+
+        for (ScanResult& result : results) {
+          if (result.parsed) {
+            ++m_parseCount;
+            remember(result.manifest);
+          } else if (result.changed) {
+            result.manifest = manifestFor(result.installPath);
+          }
+        }
+
+        if (guard && done) {
+          done(results);
+        }
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+void ExtensionManifestCache::clear()
+{
+  m_cache.clear();
+}
+
+bool ExtensionManifestCache::waitForIdle(int msecs)
+{
+  const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+  while (m_pendingScans > 0) {
+    if (!m_pool.waitForDone(static_cast<int>(deadline.remainingTime()))) {
+      return false;
+    }
+    QCoreApplication::sendPostedEvents(this);
+    if (deadline.hasExpired() && m_pendingScans > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ExtensionManifestCache::parseCount() const
+{
+  return m_parseCount;
+}
+
+void ExtensionManifestCache::remember(const ExtensionManifest& manifest)
+{
+  if (manifest.installPath.isEmpty()) {
+    return;
+  }
+  if (manifest.manifestMtimeMs <= 0) {
+    m_cache.remove(manifest.installPath);
+    return;
+  }
+  m_cache.insert(manifest.installPath, manifest);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
+
+struct ExtensionManifest
+{
+  struct Command
+  {
+    QString id;
+    QString description;
+    QString shortcut;
+  };
+
+  QString installPath;
+  qint64 manifestSize = -1;
+  qint64 manifestMtimeMs = 0;
+  bool valid = false;
+
+  QString name;
+  QString version;
+  QString description;
+  QStringList permissions;
+  QStringList hostPermissions;
+  QString iconPath;
+  QString popupRelPath;
+  QString optionsRelPath;
+  QVector<Command> commands;
+};
+
+class ExtensionManifestCache final : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct ScanRequest
+  {
+    QString installPath;
+    qint64 knownSize = -1;
+    qint64 knownMtimeMs = 0;
+  };
+
+  struct ScanResult
+  {
+    QString installPath;
+    bool exists = false;
+    bool changed = false;
+    bool parsed = false;
+    qint64 manifestSize = -1;
+    qint64 manifestMtimeMs = 0;
+    ExtensionManifest manifest;
+  };
+
+  static ExtensionManifestCache& instance();
+  ~ExtensionManifestCache() override;
+
+  static QString manifestPath(const QString& installPath);
+  static bool statManifest(const QString& installPath, qint64* size, qint64* mtimeMs);
+  static ExtensionManifest parse(const QString& installPath);
+
+  ExtensionManifest manifestFor(const QString& installPath);
+  void scanAsync(const QVector<ScanRequest>& requests, QObject* context,
+                 std::function<void(const QVector<ScanResult>&)> done);
+
+  void clear();
+  bool waitForIdle(int msecs = -1);
+  int parseCount() const;
+
+private:
+  explicit ExtensionManifestCache(QObject* parent = nullptr);
+
+  struct Stamp
+  {
+    qint64 size = -1;
+    qint64 mtimeMs = 0;
+  };
+
+  void remember(const ExtensionManifest& manifest);
+
+  QThreadPool m_pool;
+  QHash<QString, ExtensionManifest> m_cache;
+  int m_pendingScans = 0;
+  int m_parseCount = 0;
+};
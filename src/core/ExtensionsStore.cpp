@@ -1,6 +1,7 @@
 #include "ExtensionsStore.h"
 
 #include "AppPaths.h"
+#include "ExtensionManifestCache.h"
 
 #include <QDir>
 #include <QFile>
@@ -158,6 +159,7 @@ void ExtensionsStore::ensureLoaded()
     meta.version = obj.value(QStringLiteral("version")).toString();
     meta.description = obj.value(QStringLiteral("description")).toString();
     meta.manifestMtimeMs = static_cast<qint64>(obj.value(QStringLiteral("manifestMtimeMs")).toDouble());
+    meta.manifestSize = static_cast<qint64>(obj.value(QStringLiteral("manifestSize")).toDouble(-1));
 
     const QJsonArray permsArr = obj.value(QStringLiteral("permissions")).toArray();
     for (const QJsonValue& v : permsArr) {
@@ -230,6 +232,9 @@ bool ExtensionsStore::saveNow()
     if (meta.manifestMtimeMs > 0) {
       obj.insert(QStringLiteral("manifestMtimeMs"), static_cast<double>(meta.manifestMtimeMs));
     }
+    if (meta.manifestSize >= 0) {
+      obj.insert(QStringLiteral("manifestSize"), static_cast<double>(meta.manifestSize));
+    }
     if (!meta.permissions.isEmpty()) {
       QJsonArray arr;
       for (const QString& perm : meta.permissions) {
@@ -391,6 +396,14 @@ qint64 ExtensionsStore::manifestMtimeMsFor(const QString& extensionId)
   return it == m_meta.constEnd() ? 0 : it->manifestMtimeMs;
 }
 
+qint64 ExtensionsStore::manifestSizeFor(const QString& extensionId)
+{
+  ensureLoaded();
+  const QString id = normalizedId(extensionId);
+  const auto it = m_meta.constFind(id);
+  return it == m_meta.constEnd() ? -1 : it->manifestSize;
+}
+
 QVariantList ExtensionsStore::commandsFor(const QString& extensionId)
 {
   ensureLoaded();
@@ -406,19 +419,8 @@ QVariantList ExtensionsStore::commandsFor(const QString& extensionId)
     return {};
   }
 
-  QFile f(QDir(installPath).filePath(QStringLiteral("manifest.json")));
-  if (!f.exists() || !f.open(QIODevice::ReadOnly)) {
-    return {};
-  }
-
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
-  if (!doc.isObject()) {
-    return {};
-  }
-
-  const QJsonObject root = doc.object();
-  const QJsonObject commandsObj = root.value(QStringLiteral("commands")).toObject();
-  if (commandsObj.isEmpty()) {
+  const ExtensionManifest manifest = ExtensionManifestCache::instance().manifestFor(installPath);
+  if (manifest.commands.isEmpty()) {
     return {};
   }
 
@@ -430,33 +432,13 @@ QVariantList ExtensionsStore::commandsFor(const QString& extensionId)
   };
 
   std::vector<Entry> entries;
-  entries.reserve(static_cast<size_t>(commandsObj.size()));
-
-  for (auto it = commandsObj.begin(); it != commandsObj.end(); ++it) {
-    const QString commandId = it.key().trimmed();
-    if (commandId.isEmpty() || !it.value().isObject()) {
-      continue;
-    }
-
-    const QJsonObject obj = it.value().toObject();
-    const QString description = obj.value(QStringLiteral("description")).toString().trimmed();
-
-    QString shortcut;
-    const QJsonValue suggested = obj.value(QStringLiteral("suggested_key"));
-    if (suggested.isObject()) {
-      const QJsonObject suggestedObj = suggested.toObject();
-      shortcut = suggestedObj.value(QStringLiteral("windows")).toString().trimmed();
-      if (shortcut.isEmpty()) {
-        shortcut = suggestedObj.value(QStringLiteral("default")).toString().trimmed();
-      }
-    } else if (suggested.isString()) {
-      shortcut = suggested.toString().trimmed();
-    }
+  entries.reserve(static_cast<size_t>(manifest.commands.size()));
 
+  for (const ExtensionManifest::Command& command : manifest.commands) {
     Entry entry;
-    entry.id = commandId;
-    entry.description = description;
-    entry.shortcut = normalizeCommandShortcut(shortcut);
+    entry.id = command.id;
+    entry.description = command.description;
+    entry.shortcut = normalizeCommandShortcut(command.shortcut);
     entries.push_back(std::move(entry));
   }
 
@@ -522,7 +504,8 @@ void ExtensionsStore::setManifestMeta(
   const QString& description,
   const QStringList& permissions,
   const QStringList& hostPermissions,
-  qint64 manifestMtimeMs)
+  qint64 manifestMtimeMs,
+  qint64 manifestSize)
 {
   ensureLoaded();
 
@@ -538,11 +521,13 @@ void ExtensionsStore::setManifestMeta(
   next.permissions = permissions;
   next.hostPermissions = hostPermissions;
   next.manifestMtimeMs = manifestMtimeMs;
+  next.manifestSize = manifestSize;
 
   const auto prevIt = m_meta.constFind(id);
   if (prevIt != m_meta.constEnd() && prevIt->installPath == next.installPath && prevIt->version == next.version
       && prevIt->description == next.description && prevIt->permissions == next.permissions
-      && prevIt->hostPermissions == next.hostPermissions && prevIt->manifestMtimeMs == next.manifestMtimeMs) {
+      && prevIt->hostPermissions == next.hostPermissions && prevIt->manifestMtimeMs == next.manifestMtimeMs
+      && prevIt->manifestSize == next.manifestSize) {
     return;
   }
 
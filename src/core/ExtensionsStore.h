@@ -37,6 +37,7 @@ public:
   Q_INVOKABLE QStringList permissionsFor(const QString& extensionId);
   Q_INVOKABLE QStringList hostPermissionsFor(const QString& extensionId);
   Q_INVOKABLE qint64 manifestMtimeMsFor(const QString& extensionId);
+  Q_INVOKABLE qint64 manifestSizeFor(const QString& extensionId);
   Q_INVOKABLE QVariantList commandsFor(const QString& extensionId);
 
   Q_INVOKABLE void setMeta(
@@ -51,7 +52,8 @@ public:
     const QString& description,
     const QStringList& permissions,
     const QStringList& hostPermissions,
-    qint64 manifestMtimeMs);
+    qint64 manifestMtimeMs,
+    qint64 manifestSize = -1);
   Q_INVOKABLE void clearMeta(const QString& extensionId);
 
   Q_INVOKABLE void reload();
@@ -72,6 +74,7 @@ private:
     QStringList permissions;
     QStringList hostPermissions;
     qint64 manifestMtimeMs = 0;
+    qint64 manifestSize = -1;
   };
 
   explicit ExtensionsStore(QObject* parent = nullptr);
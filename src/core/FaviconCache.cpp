@@ -1,28 +1,54 @@
 #include "FaviconCache.h"
 
-#include "AppPaths.h"
+#include "PublicSuffixList.h"
+#include "UserDataStorage.h"
 
+#include <QBuffer>
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDir>
-#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
-#include <QSaveFile>
-#include <QUrlQuery>
+#include <QStringList>
 
 namespace
 {
-constexpr int kTransferTimeoutMs = 1500;
+constexpr int kTransferTimeoutMs = 5000;
 constexpr int kMaxConcurrentFetches = 4;
 constexpr qint64 kFailureBackoffMs = 10LL * 60LL * 1000LL;
+constexpr qint64 kMaxPayloadBytes = 1024LL * 1024LL;
+// Animated icons only need a frame or two looked at.
+constexpr int kMaxFrames = 16;
+const QString kStorageDir = QStringLiteral("favicons");
+// Inside kStorageDir, so a clear removes the saved copy; forgetDiskFiles
+// drops the in-memory one.
+const QString kIndexName = QStringLiteral("favicons/index.json");
+
+bool isHttpUrl(const QUrl& url)
+{
+  const QString scheme = url.scheme().toLower();
+  return url.isValid() && (scheme == QLatin1String("http") || scheme == QLatin1String("https"));
+}
 }
 
 FaviconCache::FaviconCache(QObject* parent)
   : QObject(parent)
+  , m_sizes({16, 32})
   , m_network(new QNetworkAccessManager(this))
 {
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(10000);
+}
+
+FaviconCache::~FaviconCache()
+{
+  m_pool.waitForDone();
 }
 
 QString FaviconCache::faviconKeyForUrl(const QUrl& pageUrl, int size) const
@@ -31,7 +57,7 @@ QString FaviconCache::faviconKeyForUrl(const QUrl& pageUrl, int size) const
   if (host.isEmpty() || size <= 0) {
     return {};
   }
-  return QStringLiteral("%1:%2").arg(host).arg(size);
+  return keyFor(host, size);
 }
 
 QUrl FaviconCache::faviconUrlFor(const QUrl& pageUrl, int size)
@@ -41,65 +67,249 @@ QUrl FaviconCache::faviconUrlFor(const QUrl& pageUrl, int size)
     return {};
   }
 
-  const QString key = QStringLiteral("%1:%2").arg(host).arg(size);
+  ensureIndexLoaded();
+  m_sizes.insert(size);
+  const QString key = keyFor(host, size);
   if (cacheEntryExists(key)) {
     return cacheUrlForKey(key);
   }
 
   const qint64 now = QDateTime::currentMSecsSinceEpoch();
-  const qint64 failedUntil = m_failedUntilMs.value(key, 0);
-  if (failedUntil > now) {
-    return {};
+  if (m_failedUntilMs.value(host, 0) <= now) {
+    // Until one of its pages declares an icon, try where browsers always look.
+    QUrl iconUrl = m_hosts.value(host).iconUrl;
+    if (!iconUrl.isValid() && isHttpUrl(pageUrl)) {
+      iconUrl.setScheme(pageUrl.scheme());
+      iconUrl.setHost(pageUrl.host());
+      iconUrl.setPort(pageUrl.port());
+      iconUrl.setPath(QStringLiteral("/favicon.ico"));
+    }
+    enqueueFetch({host, iconUrl, false});
   }
 
-  enqueueFetch(key, host, size);
+  // Meanwhile the site's own icon stands in; faviconAvailable reports the
+  // host's under its own key.
+  const QString site = PublicSuffixList::siteKey(host);
+  if (!site.isEmpty() && site != host) {
+    const QString siteKey = keyFor(site, size);
+    if (cacheEntryExists(siteKey)) {
+      return cacheUrlForKey(siteKey);
+    }
+  }
   return {};
 }
 
+void FaviconCache::setPageIcon(const QUrl& pageUrl, const QUrl& iconUrl)
+{
+  const QString host = normalizeHost(pageUrl);
+  if (host.isEmpty() || !isHttpUrl(iconUrl)) {
+    return;
+  }
+
+  ensureIndexLoaded();
+  HostIcon& icon = m_hosts[host];
+  if (icon.iconUrl != iconUrl) {
+    icon = HostIcon();
+    icon.iconUrl = iconUrl;
+    saveIndex();
+    m_failedUntilMs.remove(host);
+    enqueueFetch({host, iconUrl, false});
+    return;
+  }
+
+  const bool cached = allSizesCached(host);
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  if ((cached && now - icon.checkedAtMs < m_revalidateAfterMs) || m_failedUntilMs.value(host, 0) > now) {
+    return;
+  }
+  enqueueFetch({host, iconUrl, cached && (!icon.etag.isEmpty() || !icon.lastModified.isEmpty())});
+}
+
+void FaviconCache::forgetDiskFiles(const QStringList& paths)
+{
+  ensureIndexLoaded();
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  QSet<QString> gone;
+  gone.reserve(paths.size());
+  for (const QString& path : paths) {
+    gone.insert(QDir::cleanPath(path));
+  }
+
+  QStringList forgotten;
+  for (auto it = m_hosts.cbegin(); it != m_hosts.cend(); ++it) {
+    bool removed = false;
+    bool cached = false;
+    for (const int size : std::as_const(m_sizes)) {
+      const QString name = storageNameForKey(keyFor(it.key(), size));
+      removed = removed || gone.contains(QDir::cleanPath(storage.localPath(name)));
+      cached = cached || storage.exists(name);
+    }
+    if (removed || !cached) {
+      forgotten.push_back(it.key());
+    }
+  }
+
+  for (const QString& host : std::as_const(forgotten)) {
+    m_hosts.remove(host);
+    if (m_queued.remove(host) > 0) {
+      m_queue.removeAll(host);
+    }
+    QNetworkReply* reply = m_inflight.take(host);
+    m_inflightUrls.remove(host);
+    if (reply) {
+      disconnect(reply, nullptr, this, nullptr);
+      reply->abort();
+      reply->deleteLater();
+    }
+  }
+  // Backoffs only name hosts whose fetch failed; none is worth keeping.
+  m_failedUntilMs.clear();
+  ++m_generation;
+
+  if (m_hosts.isEmpty()) {
+    storage.remove(kIndexName);
+  } else {
+    saveIndex();
+  }
+  pumpFetchQueue();
+}
+
+qint64 FaviconCache::revalidateAfterMs() const
+{
+  return m_revalidateAfterMs;
+}
+
+void FaviconCache::setRevalidateAfterMs(qint64 ms)
+{
+  m_revalidateAfterMs = qMax<qint64>(0, ms);
+}
+
 QString FaviconCache::normalizeHost(const QUrl& pageUrl)
 {
-  const QString host = pageUrl.host().trimmed().toLower();
-  return host;
+  // Subdomains of one site often declare different icons (mail vs. docs),
+  // so icons are kept per host; the site only serves as a fallback.
+  return pageUrl.host().toLower();
 }
 
-QString FaviconCache::cacheDirPath()
+QString FaviconCache::keyFor(const QString& host, int size)
 {
-  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("favicons"));
+  return QStringLiteral("%1:%2").arg(host).arg(size);
 }
 
-QString FaviconCache::cachePathForKey(const QString& key)
+QString FaviconCache::storageNameForKey(const QString& key)
 {
   const QByteArray hash =
     QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
-  return QDir(cacheDirPath()).filePath(QString::fromLatin1(hash) + QStringLiteral(".png"));
+  return QStringLiteral("%1/%2.png").arg(kStorageDir, QString::fromLatin1(hash));
 }
 
-QUrl FaviconCache::cacheUrlForKey(const QString& key)
+QString FaviconCache::cacheDirectory()
 {
-  return QUrl::fromLocalFile(cachePathForKey(key));
+  return xbrowser::userDataStorage().localPath(kStorageDir);
+}
+
+QHash<int, QByteArray> FaviconCache::renderSizes(const QByteArray& payload, const QList<int>& sizes)
+{
+  QBuffer buffer;
+  buffer.setData(payload);
+  if (!buffer.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+
+  // ICO files carry several sizes; start from the largest.
+  QImageReader reader(&buffer);
+  QImage best;
+  for (int frame = 0; frame < kMaxFrames; ++frame) {
+    const QImage image = reader.read();
+    if (!image.isNull() && qint64(image.width()) * image.height() > qint64(best.width()) * best.height()) {
+      best = image;
+    }
+    if (!reader.jumpToNextImage()) {
+      break;
+    }
+  }
+  if (best.isNull()) {
+    return {};
+  }
+
+  QHash<int, QByteArray> rendered;
+  for (const int size : sizes) {
+    const QImage scaled = best.width() == size && best.height() == size
+                            ? best
+                            : best.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QByteArray png;
+    QBuffer out(&png);
+    out.open(QIODevice::WriteOnly);
+    if (scaled.save(&out, "PNG")) {
+      rendered.insert(size, png);
+    }
+  }
+  return rendered;
+}
+
+QUrl FaviconCache::cacheUrlForKey(const QString& key) const
+{
+  const QString name = storageNameForKey(key);
+  const xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  const QString path = storage.localPath(name);
+  if (!path.isEmpty()) {
+    QUrl url = QUrl::fromLocalFile(path);
+    const int version = m_hosts.value(key.section(QLatin1Char(':'), 0, -2)).version;
+    if (version > 0) {
+      url.setQuery(QStringLiteral("v=%1").arg(version));
+    }
+    return url;
+  }
+
+  // Nothing on disk to point QML at; hand it the bytes instead.
+  QByteArray payload;
+  if (!storage.read(name, &payload)) {
+    return {};
+  }
+  return QUrl(QStringLiteral("data:image/png;base64,") + QString::fromLatin1(payload.toBase64()));
 }
 
 bool FaviconCache::cacheEntryExists(const QString& key)
 {
-  return QFileInfo::exists(cachePathForKey(key));
+  return xbrowser::userDataStorage().exists(storageNameForKey(key));
 }
 
-void FaviconCache::enqueueFetch(const QString& key, const QString& host, int size)
+bool FaviconCache::allSizesCached(const QString& host) const
 {
-  if (key.isEmpty() || host.isEmpty() || size <= 0) {
-    return;
+  for (const int size : m_sizes) {
+    if (!cacheEntryExists(keyFor(host, size))) {
+      return false;
+    }
   }
+  return true;
+}
 
-  if (m_inflight.contains(key) || m_queuedKeys.contains(key)) {
+void FaviconCache::enqueueFetch(const FetchJob& job)
+{
+  if (job.host.isEmpty() || !job.iconUrl.isValid()) {
     return;
   }
 
-  FetchJob job;
-  job.key = key;
-  job.host = host;
-  job.size = size;
-  m_queue.enqueue(job);
-  m_queuedKeys.insert(key);
+  if (m_inflight.contains(job.host)) {
+    if (m_inflightUrls.value(job.host) == job.iconUrl) {
+      return;
+    }
+    // The page named a different icon than the one on its way; that wins.
+    QNetworkReply* reply = m_inflight.take(job.host);
+    m_inflightUrls.remove(job.host);
+    if (reply) {
+      disconnect(reply, nullptr, this, nullptr);
+      reply->abort();
+      reply->deleteLater();
+    }
+  }
+
+  if (m_queued.contains(job.host)) {
+    m_queued[job.host] = job;
+    return;
+  }
+  m_queued.insert(job.host, job);
+  m_queue.enqueue(job.host);
   pumpFetchQueue();
 }
 
@@ -110,72 +320,154 @@ void FaviconCache::pumpFetchQueue()
   }
 
   while (!m_queue.isEmpty() && m_inflight.size() < kMaxConcurrentFetches) {
-    const FetchJob job = m_queue.dequeue();
-    m_queuedKeys.remove(job.key);
-
-    if (cacheEntryExists(job.key)) {
-      emit faviconAvailable(job.key, cacheUrlForKey(job.key));
-      continue;
-    }
-
+    const FetchJob job = m_queued.take(m_queue.dequeue());
     startFetch(job);
   }
 }
 
 void FaviconCache::startFetch(const FetchJob& job)
 {
-  if (!m_network) {
-    return;
-  }
-
-  QUrl url(QStringLiteral("https://www.google.com/s2/favicons"));
-  QUrlQuery query;
-  query.addQueryItem(QStringLiteral("domain"), job.host);
-  query.addQueryItem(QStringLiteral("sz"), QString::number(job.size));
-  url.setQuery(query);
-
-  QNetworkRequest req(url);
+  QNetworkRequest req(job.iconUrl);
   req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
   req.setTransferTimeout(kTransferTimeoutMs);
+  if (job.conditional) {
+    const HostIcon icon = m_hosts.value(job.host);
+    if (!icon.etag.isEmpty()) {
+      req.setRawHeader("If-None-Match", icon.etag);
+    }
+    if (!icon.lastModified.isEmpty()) {
+      req.setRawHeader("If-Modified-Since", icon.lastModified);
+    }
+  }
 
   QNetworkReply* reply = m_network->get(req);
-  m_inflight.insert(job.key, reply);
+  m_inflight.insert(job.host, reply);
+  m_inflightUrls.insert(job.host, job.iconUrl);
 
-  connect(reply, &QNetworkReply::finished, this, [this, key = job.key, reply] {
-    m_inflight.remove(key);
+  connect(reply, &QNetworkReply::finished, this, [this, job, reply] {
+    m_inflight.remove(job.host);
+    m_inflightUrls.remove(job.host);
+    reply->deleteLater();
 
-    if (!reply) {
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (status == 304 && job.conditional) {
+      // Still current; nothing to decode.
+      m_hosts[job.host].checkedAtMs = now;
+      saveIndex();
       pumpFetchQueue();
       return;
     }
 
-    const QNetworkReply::NetworkError error = reply->error();
-    const QByteArray payload = reply->readAll();
-    reply->deleteLater();
-
-    if (error != QNetworkReply::NoError || payload.isEmpty()) {
-      const qint64 now = QDateTime::currentMSecsSinceEpoch();
-      m_failedUntilMs.insert(key, now + kFailureBackoffMs);
+    const QByteArray payload = reply->error() == QNetworkReply::NoError ? reply->read(kMaxPayloadBytes + 1) : QByteArray();
+    if (payload.isEmpty() || payload.size() > kMaxPayloadBytes) {
+      m_failedUntilMs.insert(job.host, now + kFailureBackoffMs);
       pumpFetchQueue();
       return;
     }
 
-    const QString dirPath = cacheDirPath();
-    QDir().mkpath(dirPath);
+    const QByteArray etag = reply->rawHeader("ETag");
+    const QByteArray lastModified = reply->rawHeader("Last-Modified");
+    const QList<int> sizes = m_sizes.values();
+    const int generation = m_generation;
+    m_pool.start([this, job, etag, lastModified, payload, sizes, generation] {
+      const QHash<int, QByteArray> images = renderSizes(payload, sizes);
+      QMetaObject::invokeMethod(
+        this,
+        [this, job, etag, lastModified, images, generation] {
+          if (generation == m_generation) {
+            onRendered(job, etag, lastModified, images);
+          }
+        },
+        Qt::QueuedConnection);
+    });
+    pumpFetchQueue();
+  });
+}
 
-    const QString path = cachePathForKey(key);
-    QSaveFile out(path);
-    if (!out.open(QIODevice::WriteOnly)) {
-      pumpFetchQueue();
-      return;
+void FaviconCache::onRendered(const FetchJob& job, const QByteArray& etag, const QByteArray& lastModified,
+                              const QHash<int, QByteArray>& images)
+{
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  if (images.isEmpty()) {
+    m_failedUntilMs.insert(job.host, now + kFailureBackoffMs);
+    return;
+  }
+
+  HostIcon& icon = m_hosts[job.host];
+  if (icon.iconUrl.isValid() && icon.iconUrl != job.iconUrl) {
+    // A newer declaration arrived meanwhile; its own fetch will land.
+    return;
+  }
+  icon.iconUrl = job.iconUrl;
+  icon.etag = etag;
+  icon.lastModified = lastModified;
+  icon.checkedAtMs = now;
+  ++icon.version;
+  m_failedUntilMs.remove(job.host);
+
+  QStringList written;
+  for (auto it = images.cbegin(); it != images.cend(); ++it) {
+    const QString key = keyFor(job.host, it.key());
+    if (xbrowser::userDataStorage().write(storageNameForKey(key), it.value())) {
+      written.push_back(key);
     }
-    out.write(payload);
-    if (!out.commit()) {
-      pumpFetchQueue();
-      return;
+  }
+  saveIndex();
+
+  for (const QString& key : std::as_const(written)) {
+    emit faviconAvailable(key, cacheUrlForKey(key));
+  }
+}
+
+void FaviconCache::ensureIndexLoaded()
+{
+  const QString key = xbrowser::userDataStorage().locationKey(kIndexName);
+  if (key == m_indexKey) {
+    return;
+  }
+  m_indexKey = key;
+  m_hosts.clear();
+
+  QByteArray payload;
+  if (!xbrowser::userDataStorage().read(kIndexName, &payload)) {
+    return;
+  }
+
+  // Entries saved under "sites" were keyed by registrable domain and are
+  // left to be fetched again per host.
+  const QJsonObject hosts = QJsonDocument::fromJson(payload).object().value(QStringLiteral("hosts")).toObject();
+  for (auto it = hosts.constBegin(); it != hosts.constEnd(); ++it) {
+    const QJsonObject obj = it.value().toObject();
+    HostIcon icon;
+    icon.iconUrl = QUrl(obj.value(QStringLiteral("icon")).toString());
+    icon.etag = obj.value(QStringLiteral("etag")).toString().toLatin1();
+    icon.lastModified = obj.value(QStringLiteral("lastModified")).toString().toLatin1();
+    icon.checkedAtMs = static_cast<qint64>(obj.value(QStringLiteral("checkedAtMs")).toDouble());
+    icon.version = obj.value(QStringLiteral("version")).toInt();
+    if (icon.iconUrl.isValid()) {
+      m_hosts.insert(it.key(), icon);
     }
+  }
+}
 
-    emit faviconAvailable(key, QUrl::fromLocalFile(path));
-    pumpFetchQueue();
-  });
+void FaviconCache::saveIndex() const
+{
+  QJsonObject hosts;
+  for (auto it = m_hosts.cbegin(); it != m_hosts.cend(); ++it) {
+    if (!it->iconUrl.isValid()) {
+      continue;
+    }
+    QJsonObject obj;
+    obj.insert(QStringLiteral("icon"), it->iconUrl.toString(QUrl::FullyEncoded));
+    obj.insert(QStringLiteral("etag"), QString::fromLatin1(it->etag));
+    obj.insert(QStringLiteral("lastModified"), QString::fromLatin1(it->lastModified));
+    obj.insert(QStringLiteral("checkedAtMs"), double(it->checkedAtMs));
+    obj.insert(QStringLiteral("version"), it->version);
+    hosts.insert(it.key(), obj);
+  }
+
+  QJsonObject root;
+  root.insert(QStringLiteral("hosts"), hosts);
+  xbrowser::userDataStorage().write(kIndexName, QJsonDocument(root).toJson(QJsonDocument::Compact));
 }
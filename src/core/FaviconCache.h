@@ -2,49 +2,104 @@
 
 #include <QObject>
 #include <QHash>
+#include <QList>
 #include <QPointer>
 #include <QQueue>
 #include <QSet>
 #include <QString>
+#include <QThreadPool>
 #include <QUrl>
 
 class QNetworkAccessManager;
 class QNetworkReply;
 
+// Site icons, cached per host and size. Icons come from the URL the page
+// declared (WebView2View::faviconUrl, via setPageIcon), or from the
+// origin's /favicon.ico until a page has declared one. A host with no icon
+// yet borrows its registrable domain's. A payload is decoded
+// and scaled to every size in use once, on a worker thread. Cached icons are
+// revalidated with If-None-Match / If-Modified-Since once they are older
+// than revalidateAfterMs.
 class FaviconCache final : public QObject
 {
   Q_OBJECT
 
 public:
+  static constexpr qint64 kDefaultRevalidateAfterMs = 24LL * 60LL * 60LL * 1000LL;
+
   explicit FaviconCache(QObject* parent = nullptr);
+  ~FaviconCache() override;
 
   Q_INVOKABLE QString faviconKeyForUrl(const QUrl& pageUrl, int size = 32) const;
   Q_INVOKABLE QUrl faviconUrlFor(const QUrl& pageUrl, int size = 32);
 
+  // Records the icon pageUrl declared and fetches it if it is new, missing
+  // or due for revalidation.
+  Q_INVOKABLE void setPageIcon(const QUrl& pageUrl, const QUrl& iconUrl);
+
+  qint64 revalidateAfterMs() const;
+  void setRevalidateAfterMs(qint64 ms);
+
+  // After BrowsingDataCleaner deleted paths from cacheDirectory(): forgets
+  // every host whose icon went or is no longer on disk, along with its
+  // icon URL, backoff and pending fetch, and saves the index without them.
+  void forgetDiskFiles(const QStringList& paths);
+
+  // Where cached icons are written; empty when user data is kept in memory.
+  static QString cacheDirectory();
+
+  // Decodes an icon (PNG, ICO, ...), taking the largest frame, and returns
+  // it as PNG scaled to each size. Empty if it does not decode. Thread-safe.
+  static QHash<int, QByteArray> renderSizes(const QByteArray& payload, const QList<int>& sizes);
+
 signals:
   void faviconAvailable(const QString& key, const QUrl& faviconUrl);
 
 private:
+  struct HostIcon
+  {
+    QUrl iconUrl;
+    QByteArray etag;
+    QByteArray lastModified;
+    qint64 checkedAtMs = 0;
+    // Bumped on every new image so QML does not show its cached pixmap.
+    int version = 0;
+  };
+
   struct FetchJob
   {
-    QString key;
     QString host;
-    int size = 32;
+    QUrl iconUrl;
+    bool conditional = false;
   };
 
   static QString normalizeHost(const QUrl& pageUrl);
-  static QString cacheDirPath();
-  static QString cachePathForKey(const QString& key);
-  static QUrl cacheUrlForKey(const QString& key);
+  static QString keyFor(const QString& host, int size);
+  static QString storageNameForKey(const QString& key);
   static bool cacheEntryExists(const QString& key);
+  QUrl cacheUrlForKey(const QString& key) const;
+  bool allSizesCached(const QString& host) const;
 
-  void enqueueFetch(const QString& key, const QString& host, int size);
+  void enqueueFetch(const FetchJob& job);
   void pumpFetchQueue();
   void startFetch(const FetchJob& job);
+  void onRendered(const FetchJob& job, const QByteArray& etag, const QByteArray& lastModified,
+                  const QHash<int, QByteArray>& images);
+
+  void ensureIndexLoaded();
+  void saveIndex() const;
 
-  QQueue<FetchJob> m_queue;
-  QSet<QString> m_queuedKeys;
+  QQueue<QString> m_queue;
+  QHash<QString, FetchJob> m_queued;
   QHash<QString, QPointer<QNetworkReply>> m_inflight;
+  QHash<QString, QUrl> m_inflightUrls;
   QHash<QString, qint64> m_failedUntilMs;
+  QHash<QString, HostIcon> m_hosts;
+  QSet<int> m_sizes;
+  QString m_indexKey;
+  // Bumped by forgetDiskFiles so renders already under way are dropped.
+  int m_generation = 0;
+  qint64 m_revalidateAfterMs = kDefaultRevalidateAfterMs;
   QNetworkAccessManager* m_network = nullptr;
+  QThreadPool m_pool;
 };
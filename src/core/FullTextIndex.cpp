@@ -0,0 +1,1034 @@
+#include "FullTextIndex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace
+{
+constexpr char kMagic[4] = { 'X', 'F', 'T', 'I' };
+constexpr quint32 kSegmentVersion = 1;
+constexpr quint32 kByteOrderMark = 0x01020304;
+constexpr int kInBuffer = -1;
+
+constexpr double kBm25K1 = 1.2;
+constexpr double kBm25B = 0.75;
+
+// Segment files are flat native-endian images addressed by offset, read in
+// place from a file mapping. Sections are 8-byte aligned.
+struct SegmentHeader
+{
+  char magic[4];
+  quint32 version;
+  quint32 byteOrderMark;
+  quint32 totalSize;
+  quint32 documentCount;
+  quint32 termCount;
+  quint32 postingCount;
+  quint32 documentsOffset;
+  quint32 termsOffset;
+  quint32 postingsOffset;
+  quint32 stringsOffset;
+  quint32 stringsSize;
+};
+
+struct SegmentDocument
+{
+  quint64 sequence;
+  qint64 visitedMs;
+  quint32 length;
+  quint32 keyOffset;
+  quint32 keyLength;
+  quint32 titleOffset;
+  quint32 titleLength;
+  quint32 reserved;
+};
+
+struct SegmentTerm
+{
+  quint32 textOffset;
+  quint32 textLength;
+  quint32 postingsStart;
+  quint32 postingCount;
+};
+
+struct SegmentPosting
+{
+  quint32 document;
+  quint32 frequency;
+};
+
+QString manifestPath(const QString& dir)
+{
+  return QDir(dir).filePath(QStringLiteral("manifest.json"));
+}
+
+bool isSegmentFileName(const QString& name)
+{
+  return name.startsWith(QStringLiteral("seg_")) && name.endsWith(QStringLiteral(".fti"));
+}
+
+bool sectionFits(qint64 size, quint32 offset, quint64 count, size_t elementSize)
+{
+  return offset % 8 == 0 && quint64(offset) + count * elementSize <= quint64(size);
+}
+
+bool isIdeographic(QChar ch)
+{
+  switch (ch.script()) {
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Hangul:
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::string utf8(const QString& text)
+{
+  return text.toStdString();
+}
+
+class SegmentWriter
+{
+public:
+  quint32 addDocument(quint64 sequence, qint64 visitedMs, quint32 length, const QString& key, const QString& title)
+  {
+    SegmentDocument doc {};
+    doc.sequence = sequence;
+    doc.visitedMs = visitedMs;
+    doc.length = length;
+    const QByteArray keyBytes = key.toUtf8();
+    const QByteArray titleBytes = title.toUtf8();
+    doc.keyOffset = addString(keyBytes.constData(), keyBytes.size());
+    doc.keyLength = quint32(keyBytes.size());
+    doc.titleOffset = addString(titleBytes.constData(), titleBytes.size());
+    doc.titleLength = quint32(titleBytes.size());
+    m_documents.push_back(doc);
+    return quint32(m_documents.size() - 1);
+  }
+
+  void beginTerm(std::string_view text)
+  {
+    SegmentTerm term {};
+    term.textOffset = addString(text.data(), qsizetype(text.size()));
+    term.textLength = quint32(text.size());
+    term.postingsStart = quint32(m_postings.size());
+    m_terms.push_back(term);
+  }
+
+  void addPosting(quint32 document, quint32 frequency)
+  {
+    m_postings.push_back({ document, frequency });
+    ++m_terms.back().postingCount;
+  }
+
+  // Drops a term that ended up without postings.
+  void endTerm()
+  {
+    if (!m_terms.empty() && m_terms.back().postingCount == 0) {
+      m_strings.chop(qsizetype(m_terms.back().textLength));
+      m_terms.pop_back();
+    }
+  }
+
+  int documentCount() const
+  {
+    return int(m_documents.size());
+  }
+
+  QByteArray finish() const
+  {
+    QByteArray out(sizeof(SegmentHeader), '\0');
+    SegmentHeader header {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSegmentVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.documentCount = quint32(m_documents.size());
+    header.termCount = quint32(m_terms.size());
+    header.postingCount = quint32(m_postings.size());
+    header.documentsOffset = append(out, m_documents.data(), m_documents.size() * sizeof(SegmentDocument));
+    header.termsOffset = append(out, m_terms.data(), m_terms.size() * sizeof(SegmentTerm));
+    header.postingsOffset = append(out, m_postings.data(), m_postings.size() * sizeof(SegmentPosting));
+    header.stringsOffset = append(out, m_strings.constData(), size_t(m_strings.size()));
+    header.stringsSize = quint32(m_strings.size());
+    while (out.size() % 8 != 0) {
+      out.append('\0');
+    }
+    header.totalSize = quint32(out.size());
+    std::memcpy(out.data(), &header, sizeof(header));
+    return out;
+  }
+
+private:
+  quint32 addString(const char* data, qsizetype size)
+  {
+    const quint32 at = quint32(m_strings.size());
+    m_strings.append(data, size);
+    return at;
+  }
+
+  static quint32 append(QByteArray& out, const void* data, size_t size)
+  {
+    while (out.size() % 8 != 0) {
+      out.append('\0');
+    }
+    const quint32 at = quint32(out.size());
+    if (size > 0) {
+      out.append(static_cast<const char*>(data), qsizetype(size));
+    }
+    return at;
+  }
+
+  std::vector<SegmentDocument> m_documents;
+  std::vector<SegmentTerm> m_terms;
+  std::vector<SegmentPosting> m_postings;
+  QByteArray m_strings;
+};
+}
+
+struct FullTextIndex::Segment
+{
+  QString fileName;
+  std::unique_ptr<QFile> file;
+  QByteArray owned;
+  const uchar* data = nullptr;
+  const SegmentHeader* header = nullptr;
+  const SegmentDocument* documents = nullptr;
+  const SegmentTerm* terms = nullptr;
+  const SegmentPosting* postings = nullptr;
+  const char* strings = nullptr;
+  std::vector<bool> live;
+  int liveCount = 0;
+
+  bool attach(const uchar* bytes, qint64 size)
+  {
+    if (!bytes || size < qint64(sizeof(SegmentHeader)) || (reinterpret_cast<quintptr>(bytes) % 8) != 0) {
+      return false;
+    }
+
+    const auto* h = reinterpret_cast<const SegmentHeader*>(bytes);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kSegmentVersion
+        || h->byteOrderMark != kByteOrderMark || h->totalSize != quint64(size)) {
+      return false;
+    }
+    if (!sectionFits(size, h->documentsOffset, h->documentCount, sizeof(SegmentDocument))
+        || !sectionFits(size, h->termsOffset, h->termCount, sizeof(SegmentTerm))
+        || !sectionFits(size, h->postingsOffset, h->postingCount, sizeof(SegmentPosting))
+        || !sectionFits(size, h->stringsOffset, h->stringsSize, 1)) {
+      return false;
+    }
+
+    const auto* docs = reinterpret_cast<const SegmentDocument*>(bytes + h->documentsOffset);
+    for (quint32 i = 0; i < h->documentCount; ++i) {
+      if (quint64(docs[i].keyOffset) + docs[i].keyLength > h->stringsSize
+          || quint64(docs[i].titleOffset) + docs[i].titleLength > h->stringsSize) {
+        return false;
+      }
+    }
+    const auto* termTable = reinterpret_cast<const SegmentTerm*>(bytes + h->termsOffset);
+    for (quint32 i = 0; i < h->termCount; ++i) {
+      if (quint64(termTable[i].textOffset) + termTable[i].textLength > h->stringsSize
+          || quint64(termTable[i].postingsStart) + termTable[i].postingCount > h->postingCount) {
+        return false;
+      }
+    }
+    const auto* postingTable = reinterpret_cast<const SegmentPosting*>(bytes + h->postingsOffset);
+    for (quint32 i = 0; i < h->postingCount; ++i) {
+      if (postingTable[i].document >= h->documentCount) {
+        return false;
+      }
+    }
+
+    data = bytes;
+    header = h;
+    documents = docs;
+    terms = termTable;
+    postings = postingTable;
+    strings = reinterpret_cast<const char*>(bytes + h->stringsOffset);
+    live.assign(h->documentCount, false);
+    liveCount = 0;
+    return true;
+  }
+
+  bool load(const QString& path)
+  {
+    file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+      return false;
+    }
+    const qint64 size = file->size();
+    if (const uchar* mapped = file->map(0, size)) {
+      return attach(mapped, size);
+    }
+    owned = file->readAll();
+    file.reset();
+    return attach(reinterpret_cast<const uchar*>(owned.constData()), owned.size());
+  }
+
+  int documentCount() const
+  {
+    return int(header->documentCount);
+  }
+
+  int termCount() const
+  {
+    return int(header->termCount);
+  }
+
+  QString key(int document) const
+  {
+    const SegmentDocument& d = documents[document];
+    return QString::fromUtf8(strings + d.keyOffset, qsizetype(d.keyLength));
+  }
+
+  QString title(int document) const
+  {
+    const SegmentDocument& d = documents[document];
+    return QString::fromUtf8(strings + d.titleOffset, qsizetype(d.titleLength));
+  }
+
+  std::string_view term(int index) const
+  {
+    return std::string_view(strings + terms[index].textOffset, terms[index].textLength);
+  }
+
+  int lowerBound(std::string_view text) const
+  {
+    int lo = 0;
+    int hi = termCount();
+    while (lo < hi) {
+      const int mid = lo + (hi - lo) / 2;
+      if (term(mid) < text) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+
+  int find(std::string_view text) const
+  {
+    const int at = lowerBound(text);
+    return (at < termCount() && term(at) == text) ? at : -1;
+  }
+};
+
+FullTextIndex::FullTextIndex() = default;
+
+FullTextIndex::~FullTextIndex()
+{
+  close();
+}
+
+QStringList FullTextIndex::tokenize(QStringView text)
+{
+  QStringList tokens;
+  QString current;
+  const auto emitCurrent = [&tokens, &current] {
+    if (current.size() >= 2 && current.size() <= kMaxTokenLength) {
+      tokens.push_back(current);
+    }
+    current.clear();
+  };
+
+  for (const QChar ch : text) {
+    if (tokens.size() >= kMaxTokensPerDocument) {
+      return tokens;
+    }
+    if (isIdeographic(ch)) {
+      // Scripts written without spaces are indexed one character at a time.
+      emitCurrent();
+      tokens.push_back(QString(ch));
+    } else if (ch.isLetterOrNumber() || ch.isMark() || ch.isSurrogate()) {
+      current.append(ch.toCaseFolded());
+    } else {
+      emitCurrent();
+    }
+  }
+  if (tokens.size() < kMaxTokensPerDocument) {
+    emitCurrent();
+  }
+  return tokens;
+}
+
+bool FullTextIndex::open(const QString& dirPath, QString* error)
+{
+  close();
+
+  if (!QDir().mkpath(dirPath)) {
+    if (error) {
+      *error = QStringLiteral("Cannot create %1").arg(dirPath);
+    }
+    return false;
+  }
+
+  m_dir = dirPath;
+  m_open = true;
+  const bool ok = loadManifest(error);
+  rebuildLiveness();
+  return ok;
+}
+
+void FullTextIndex::close()
+{
+  m_segments.clear();
+  m_buffer.clear();
+  m_latest.clear();
+  m_deleted.clear();
+  m_nextSequence = 1;
+  m_nextSegmentId = 1;
+  m_liveLength = 0;
+  m_open = false;
+  m_dir.clear();
+}
+
+bool FullTextIndex::isOpen() const
+{
+  return m_open;
+}
+
+bool FullTextIndex::loadManifest(QString* error)
+{
+  QFile f(manifestPath(m_dir));
+  QStringList listed;
+  if (f.open(QIODevice::ReadOnly)) {
+    const QJsonObject root = QJsonDocument::fromJson(f.readAll()).object();
+    m_nextSequence = quint64(root.value(QStringLiteral("nextSequence")).toDouble(1));
+    m_nextSegmentId = quint32(root.value(QStringLiteral("nextSegment")).toInt(1));
+    for (const QJsonValue& v : root.value(QStringLiteral("segments")).toArray()) {
+      listed.push_back(v.toString());
+    }
+    for (const QJsonValue& v : root.value(QStringLiteral("deleted")).toArray()) {
+      const QJsonArray pair = v.toArray();
+      m_deleted.insert(pair.at(0).toString(), quint64(pair.at(1).toDouble()));
+    }
+  }
+
+  bool ok = true;
+  quint64 maxSequence = 0;
+  for (const QString& name : listed) {
+    auto segment = std::make_unique<Segment>();
+    segment->fileName = name;
+    if (!isSegmentFileName(name) || !segment->load(QDir(m_dir).filePath(name))) {
+      // The index is derived data; a damaged segment costs its documents,
+      // not the whole index.
+      if (error) {
+        *error = QStringLiteral("Skipped unreadable segment %1").arg(name);
+      }
+      ok = false;
+      continue;
+    }
+    for (int d = 0; d < segment->documentCount(); ++d) {
+      maxSequence = qMax(maxSequence, segment->documents[d].sequence);
+    }
+    m_segments.push_back(std::move(segment));
+  }
+  m_nextSequence = qMax(m_nextSequence, maxSequence + 1);
+
+  // Files left behind by an interrupted flush or merge are not referenced.
+  const QStringList onDisk = QDir(m_dir).entryList({ QStringLiteral("seg_*.fti") }, QDir::Files);
+  for (const QString& name : onDisk) {
+    if (!listed.contains(name)) {
+      QFile::remove(QDir(m_dir).filePath(name));
+    }
+    const quint32 id = name.mid(4, name.size() - 8).toUInt();
+    m_nextSegmentId = qMax(m_nextSegmentId, id + 1);
+  }
+  return ok;
+}
+
+bool FullTextIndex::saveManifest(QString* error) const
+{
+  QJsonArray segments;
+  for (const auto& segment : m_segments) {
+    segments.push_back(segment->fileName);
+  }
+
+  QStringList deletedKeys = m_deleted.keys();
+  deletedKeys.sort();
+  QJsonArray deleted;
+  for (const QString& key : deletedKeys) {
+    deleted.push_back(QJsonArray { key, static_cast<double>(m_deleted.value(key)) });
+  }
+
+  QJsonObject root;
+  root.insert(QStringLiteral("version"), 1);
+  root.insert(QStringLiteral("nextSequence"), static_cast<double>(m_nextSequence));
+  root.insert(QStringLiteral("nextSegment"), static_cast<double>(m_nextSegmentId));
+  root.insert(QStringLiteral("segments"), segments);
+  root.insert(QStringLiteral("deleted"), deleted);
+
+  QSaveFile out(manifestPath(m_dir));
+  if (!out.open(QIODevice::WriteOnly)) {
+    if (error) {
+      *error = out.errorString();
+    }
+    return false;
+  }
+  out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  if (!out.commit()) {
+    if (error) {
+      *error = out.errorString();
+    }
+    return false;
+  }
+  return true;
+}
+
+void FullTextIndex::rebuildLiveness()
+{
+  m_latest.clear();
+  m_liveLength = 0;
+
+  QSet<QString> onDisk;
+  for (int s = 0; s < int(m_segments.size()); ++s) {
+    Segment& segment = *m_segments[size_t(s)];
+    segment.live.assign(size_t(segment.documentCount()), false);
+    segment.liveCount = 0;
+    for (int d = 0; d < segment.documentCount(); ++d) {
+      const QString key = segment.key(d);
+      const quint64 sequence = segment.documents[d].sequence;
+      onDisk.insert(key);
+      if (sequence <= m_deleted.value(key, 0)) {
+        continue;
+      }
+      Location& latest = m_latest[key];
+      if (sequence > latest.sequence) {
+        latest = { s, d, sequence };
+      }
+    }
+  }
+  for (int b = 0; b < m_buffer.size(); ++b) {
+    m_latest.insert(m_buffer.at(b).key, { kInBuffer, b, m_buffer.at(b).sequence });
+  }
+
+  for (const Location& loc : std::as_const(m_latest)) {
+    if (loc.segment == kInBuffer) {
+      m_liveLength += m_buffer.at(loc.document).length;
+      continue;
+    }
+    Segment& segment = *m_segments[size_t(loc.segment)];
+    segment.live[size_t(loc.document)] = true;
+    ++segment.liveCount;
+    m_liveLength += segment.documents[loc.document].length;
+  }
+
+  // A tombstone is only needed while some segment still holds the key.
+  for (auto it = m_deleted.begin(); it != m_deleted.end();) {
+    it = onDisk.contains(it.key()) ? std::next(it) : m_deleted.erase(it);
+  }
+}
+
+void FullTextIndex::markDead(const QString& key)
+{
+  const auto it = m_latest.find(key);
+  if (it == m_latest.end()) {
+    return;
+  }
+
+  const Location loc = it.value();
+  m_latest.erase(it);
+  if (loc.segment == kInBuffer) {
+    m_liveLength -= m_buffer.at(loc.document).length;
+    m_buffer.removeAt(loc.document);
+    for (Location& other : m_latest) {
+      if (other.segment == kInBuffer && other.document > loc.document) {
+        --other.document;
+      }
+    }
+    return;
+  }
+
+  Segment& segment = *m_segments[size_t(loc.segment)];
+  segment.live[size_t(loc.document)] = false;
+  --segment.liveCount;
+  m_liveLength -= segment.documents[loc.document].length;
+}
+
+void FullTextIndex::addDocument(const QString& key, const QString& title, const QString& text, qint64 visitedMs)
+{
+  if (!m_open || key.isEmpty()) {
+    return;
+  }
+
+  BufferedDocument doc;
+  doc.key = key;
+  doc.title = title;
+  doc.visitedMs = visitedMs;
+  for (const QString& token : tokenize(title)) {
+    doc.terms[token] += kTitleWeight;
+    doc.length += kTitleWeight;
+  }
+  for (const QString& token : tokenize(text)) {
+    ++doc.terms[token];
+    ++doc.length;
+  }
+  if (doc.terms.isEmpty()) {
+    return;
+  }
+
+  markDead(key);
+  doc.sequence = m_nextSequence++;
+  m_buffer.push_back(doc);
+  m_latest.insert(key, { kInBuffer, int(m_buffer.size() - 1), doc.sequence });
+  m_liveLength += doc.length;
+
+  if (m_buffer.size() >= kFlushThreshold) {
+    flush();
+  }
+}
+
+bool FullTextIndex::removeDocument(const QString& key)
+{
+  if (!m_open) {
+    return false;
+  }
+
+  const bool wasLive = m_latest.contains(key);
+  markDead(key);
+  // Older copies may still sit in segments; the tombstone keeps them dead
+  // across restarts until a merge drops them.
+  m_deleted.insert(key, m_nextSequence - 1);
+  saveManifest(nullptr);
+  return wasLive;
+}
+
+int FullTextIndex::retainOnly(const QSet<QString>& keys)
+{
+  if (!m_open) {
+    return 0;
+  }
+
+  QStringList doomed;
+  for (auto it = m_latest.cbegin(); it != m_latest.cend(); ++it) {
+    if (!keys.contains(it.key())) {
+      doomed.push_back(it.key());
+    }
+  }
+  for (const QString& key : doomed) {
+    markDead(key);
+    m_deleted.insert(key, m_nextSequence - 1);
+  }
+  if (!doomed.isEmpty()) {
+    saveManifest(nullptr);
+  }
+  return int(doomed.size());
+}
+
+bool FullTextIndex::clear(QString* error)
+{
+  if (!m_open) {
+    return false;
+  }
+
+  const QString dir = m_dir;
+  m_segments.clear();
+  const QStringList onDisk = QDir(dir).entryList({ QStringLiteral("seg_*.fti") }, QDir::Files);
+  for (const QString& name : onDisk) {
+    QFile::remove(QDir(dir).filePath(name));
+  }
+
+  const quint32 nextSegmentId = m_nextSegmentId;
+  close();
+  m_dir = dir;
+  m_open = true;
+  m_nextSegmentId = nextSegmentId;
+  return saveManifest(error);
+}
+
+bool FullTextIndex::flush(QString* error)
+{
+  if (!m_open) {
+    return false;
+  }
+  if (m_buffer.isEmpty()) {
+    return true;
+  }
+  if (!writeSegment({}, true, error)) {
+    return false;
+  }
+  return merge(false, error);
+}
+
+bool FullTextIndex::merge(bool everything, QString* error)
+{
+  if (!m_open) {
+    return false;
+  }
+
+  if (everything) {
+    std::vector<int> all;
+    for (int s = 0; s < int(m_segments.size()); ++s) {
+      all.push_back(s);
+    }
+    const bool hasDead = std::any_of(m_segments.cbegin(), m_segments.cend(), [](const auto& segment) {
+      return segment->liveCount < segment->documentCount();
+    });
+    if (all.size() < 2 && !hasDead) {
+      return true;
+    }
+    return writeSegment(all, false, error);
+  }
+
+  // Tiered policy: segments are grouped by size, kMergeFactor segments of
+  // one tier become one segment of the next, and mostly-dead segments are
+  // rewritten so deleted text leaves the disk.
+  for (;;) {
+    std::vector<int> candidates;
+    QHash<int, std::vector<int>> tiers;
+    for (int s = 0; s < int(m_segments.size()); ++s) {
+      const Segment& segment = *m_segments[size_t(s)];
+      if (segment.liveCount * 2 < segment.documentCount()) {
+        candidates = { s };
+        break;
+      }
+      int tier = 0;
+      qint64 bound = qint64(kFlushThreshold) * kMergeFactor;
+      while (segment.documentCount() >= bound) {
+        ++tier;
+        bound *= kMergeFactor;
+      }
+      tiers[tier].push_back(s);
+    }
+
+    if (candidates.empty()) {
+      QList<int> tierKeys = tiers.keys();
+      std::sort(tierKeys.begin(), tierKeys.end());
+      for (int tier : tierKeys) {
+        std::vector<int>& members = tiers[tier];
+        if (int(members.size()) >= kMergeFactor) {
+          std::sort(members.begin(), members.end(), [this](int a, int b) {
+            return m_segments[size_t(a)]->documentCount() < m_segments[size_t(b)]->documentCount();
+          });
+          candidates.assign(members.begin(), members.begin() + kMergeFactor);
+          std::sort(candidates.begin(), candidates.end());
+          break;
+        }
+      }
+    }
+
+    if (candidates.empty()) {
+      return true;
+    }
+    if (!writeSegment(candidates, false, error)) {
+      return false;
+    }
+  }
+}
+
+bool FullTextIndex::writeSegment(const std::vector<int>& sources, bool includeBuffer, QString* error)
+{
+  SegmentWriter writer;
+
+  // Documents first: live documents of every source in order, then the
+  // buffer. Old document numbers map to new ones through `remap`.
+  std::vector<std::vector<int>> remap(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    const Segment& segment = *m_segments[size_t(sources[i])];
+    remap[i].assign(size_t(segment.documentCount()), -1);
+    for (int d = 0; d < segment.documentCount(); ++d) {
+      if (segment.live[size_t(d)]) {
+        const SegmentDocument& doc = segment.documents[d];
+        remap[i][size_t(d)] =
+          int(writer.addDocument(doc.sequence, doc.visitedMs, doc.length, segment.key(d), segment.title(d)));
+      }
+    }
+  }
+
+  std::map<std::string, std::vector<SegmentPosting>> bufferTerms;
+  if (includeBuffer) {
+    for (const BufferedDocument& doc : std::as_const(m_buffer)) {
+      const quint32 id = writer.addDocument(doc.sequence, doc.visitedMs, doc.length, doc.key, doc.title);
+      for (auto it = doc.terms.cbegin(); it != doc.terms.cend(); ++it) {
+        bufferTerms[utf8(it.key())].push_back({ id, it.value() });
+      }
+    }
+  }
+
+  // K-way merge of the sorted term tables, with the buffer as one more
+  // sorted input.
+  std::vector<int> cursor(sources.size(), 0);
+  auto bufferIt = bufferTerms.cbegin();
+  for (;;) {
+    std::string_view next;
+    bool found = false;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      const Segment& segment = *m_segments[size_t(sources[i])];
+      if (cursor[i] < segment.termCount() && (!found || segment.term(cursor[i]) < next)) {
+        next = segment.term(cursor[i]);
+        found = true;
+      }
+    }
+    if (bufferIt != bufferTerms.cend() && (!found || std::string_view(bufferIt->first) < next)) {
+      next = bufferIt->first;
+      found = true;
+    }
+    if (!found) {
+      break;
+    }
+
+    // `next` points into a source that the loop below advances past.
+    const std::string text(next);
+    writer.beginTerm(text);
+    for (size_t i = 0; i < sources.size(); ++i) {
+      const Segment& segment = *m_segments[size_t(sources[i])];
+      if (cursor[i] >= segment.termCount() || segment.term(cursor[i]) != text) {
+        continue;
+      }
+      const SegmentTerm& term = segment.terms[cursor[i]];
+      for (quint32 p = 0; p < term.postingCount; ++p) {
+        const SegmentPosting& posting = segment.postings[term.postingsStart + p];
+        const int mapped = remap[i][posting.document];
+        if (mapped >= 0) {
+          writer.addPosting(quint32(mapped), posting.frequency);
+        }
+      }
+      ++cursor[i];
+    }
+    if (bufferIt != bufferTerms.cend() && bufferIt->first == text) {
+      for (const SegmentPosting& posting : bufferIt->second) {
+        writer.addPosting(posting.document, posting.frequency);
+      }
+      ++bufferIt;
+    }
+    writer.endTerm();
+  }
+
+  std::unique_ptr<Segment> written;
+  if (writer.documentCount() > 0) {
+    const QString name = QStringLiteral("seg_%1.fti").arg(m_nextSegmentId, 6, 10, QLatin1Char('0'));
+    QSaveFile out(QDir(m_dir).filePath(name));
+    if (!out.open(QIODevice::WriteOnly) || out.write(writer.finish()) < 0 || !out.commit()) {
+      if (error) {
+        *error = out.errorString();
+      }
+      return false;
+    }
+    ++m_nextSegmentId;
+
+    written = std::make_unique<Segment>();
+    written->fileName = name;
+    if (!written->load(QDir(m_dir).filePath(name))) {
+      if (error) {
+        *error = QStringLiteral("Cannot read back %1").arg(name);
+      }
+      QFile::remove(QDir(m_dir).filePath(name));
+      return false;
+    }
+  }
+
+  QStringList obsolete;
+  for (auto it = sources.crbegin(); it != sources.crend(); ++it) {
+    obsolete.push_back(m_segments[size_t(*it)]->fileName);
+    m_segments.erase(m_segments.begin() + *it);
+  }
+  if (written) {
+    const size_t at = sources.empty() ? m_segments.size() : size_t(sources.front());
+    m_segments.insert(m_segments.begin() + qsizetype(at), std::move(written));
+  }
+  if (includeBuffer) {
+    m_buffer.clear();
+  }
+
+  rebuildLiveness();
+  // The manifest switches to the new file set before old files go away, so
+  // a crash in between leaves only unreferenced files to sweep on open.
+  if (!saveManifest(error)) {
+    return false;
+  }
+  for (const QString& name : obsolete) {
+    QFile::remove(QDir(m_dir).filePath(name));
+  }
+  return true;
+}
+
+QVector<FullTextIndex::Hit> FullTextIndex::search(const QString& query, int limit, qint64 fromMs, qint64 toMs) const
+{
+  if (!m_open || limit <= 0 || m_latest.isEmpty()) {
+    return {};
+  }
+
+  QStringList tokens = tokenize(query);
+  tokens.removeDuplicates();
+  if (tokens.isEmpty()) {
+    return {};
+  }
+  const bool prefixLast = !query.isEmpty() && !query.back().isSpace();
+
+  const double documents = double(m_latest.size());
+  const double averageLength = qMax(1.0, double(m_liveLength) / documents);
+
+  // Document references pack (segment + 1) above the document number; the
+  // buffer is segment 0.
+  const auto refOf = [](int segment, int document) {
+    return (quint64(quint32(segment + 1)) << 32) | quint32(document);
+  };
+
+  struct Score
+  {
+    double score = 0.0;
+    int matched = 0;
+  };
+  QHash<quint64, Score> scores;
+
+  for (int t = 0; t < tokens.size(); ++t) {
+    const std::string token = utf8(tokens.at(t));
+    std::vector<std::string> variants { token };
+    if (prefixLast && t == tokens.size() - 1) {
+      // The lexically first completions of each segment are enough to
+      // pick the first kMaxPrefixExpansions overall.
+      std::set<std::string> expanded;
+      for (const auto& segment : m_segments) {
+        int taken = 0;
+        for (int i = segment->lowerBound(token); i < segment->termCount() && taken < kMaxPrefixExpansions; ++i, ++taken) {
+          const std::string_view candidate = segment->term(i);
+          if (candidate.substr(0, token.size()) != token) {
+            break;
+          }
+          expanded.emplace(candidate);
+        }
+      }
+      for (const BufferedDocument& doc : m_buffer) {
+        for (auto it = doc.terms.cbegin(); it != doc.terms.cend(); ++it) {
+          if (it.key().startsWith(tokens.at(t))) {
+            expanded.emplace(utf8(it.key()));
+          }
+        }
+      }
+      for (const std::string& candidate : expanded) {
+        if (int(variants.size()) >= kMaxPrefixExpansions) {
+          break;
+        }
+        if (candidate != token) {
+          variants.push_back(candidate);
+        }
+      }
+    }
+
+    // A document scores the best of the variants it contains, so a prefix
+    // does not count once per completion.
+    QHash<quint64, double> best;
+    for (const std::string& variant : variants) {
+      std::vector<std::pair<quint64, double>> matches;
+      for (int s = 0; s < int(m_segments.size()); ++s) {
+        const Segment& segment = *m_segments[size_t(s)];
+        const int termIndex = segment.find(variant);
+        if (termIndex < 0) {
+          continue;
+        }
+        const SegmentTerm& term = segment.terms[termIndex];
+        for (quint32 p = 0; p < term.postingCount; ++p) {
+          const SegmentPosting& posting = segment.postings[term.postingsStart + p];
+          if (segment.live[posting.document]) {
+            const double tf = posting.frequency;
+            const double length = segment.documents[posting.document].length;
+            matches.push_back({ refOf(s, int(posting.document)),
+                                tf * (kBm25K1 + 1.0) / (tf + kBm25K1 * (1.0 - kBm25B + kBm25B * length / averageLength)) });
+          }
+        }
+      }
+      const QString variantText = QString::fromStdString(variant);
+      for (int b = 0; b < m_buffer.size(); ++b) {
+        const quint32 frequency = m_buffer.at(b).terms.value(variantText);
+        if (frequency > 0) {
+          const double tf = frequency;
+          const double length = m_buffer.at(b).length;
+          matches.push_back({ refOf(kInBuffer, b),
+                              tf * (kBm25K1 + 1.0) / (tf + kBm25K1 * (1.0 - kBm25B + kBm25B * length / averageLength)) });
+        }
+      }
+      if (matches.empty()) {
+        continue;
+      }
+
+      const double df = double(matches.size());
+      const double idf = std::log(1.0 + (documents - df + 0.5) / (df + 0.5));
+      for (const auto& [ref, weight] : matches) {
+        double& slot = best[ref];
+        slot = qMax(slot, idf * weight);
+      }
+    }
+
+    for (auto it = best.cbegin(); it != best.cend(); ++it) {
+      Score& score = scores[it.key()];
+      score.score += it.value();
+      ++score.matched;
+    }
+  }
+
+  QVector<Hit> hits;
+  hits.reserve(scores.size());
+  for (auto it = scores.cbegin(); it != scores.cend(); ++it) {
+    const int segment = int(it.key() >> 32) - 1;
+    const int document = int(it.key() & 0xFFFFFFFFu);
+
+    Hit hit;
+    if (segment == kInBuffer) {
+      const BufferedDocument& doc = m_buffer.at(document);
+      hit.key = doc.key;
+      hit.title = doc.title;
+      hit.visitedMs = doc.visitedMs;
+    } else {
+      const Segment& seg = *m_segments[size_t(segment)];
+      hit.visitedMs = seg.documents[document].visitedMs;
+      hit.key = seg.key(document);
+      hit.title = seg.title(document);
+    }
+    if ((fromMs > 0 && hit.visitedMs < fromMs) || (toMs > 0 && hit.visitedMs > toMs)) {
+      continue;
+    }
+    hit.score = it.value().score;
+    hit.matchedTerms = it.value().matched;
+    hits.push_back(hit);
+  }
+
+  // Documents that contain every term come first, then BM25, then recency.
+  const auto better = [](const Hit& a, const Hit& b) {
+    if (a.matchedTerms != b.matchedTerms) {
+      return a.matchedTerms > b.matchedTerms;
+    }
+    if (a.score != b.score) {
+      return a.score > b.score;
+    }
+    if (a.visitedMs != b.visitedMs) {
+      return a.visitedMs > b.visitedMs;
+    }
+    return a.key < b.key;
+  };
+  const qsizetype keep = qMin<qsizetype>(limit, hits.size());
+  std::partial_sort(hits.begin(), hits.begin() + keep, hits.end(), better);
+  hits.resize(keep);
+  return hits;
+}
+
+int FullTextIndex::documentCount() const
+{
+  return int(m_latest.size());
+}
+
+int FullTextIndex::segmentCount() const
+{
+  return int(m_segments.size());
+}
+
+int FullTextIndex::bufferedCount() const
+{
+  return int(m_buffer.size());
+}
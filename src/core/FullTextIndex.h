@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+class QFile;
+
+// Segmented inverted index with BM25 ranking. New documents collect in an
+// in-memory buffer that is flushed into an immutable segment file; small
+// segments are merged into larger ones so a query touches only a handful of
+// files. Segments are memory-mapped and searched in place.
+//
+// Documents are keyed by an opaque string (the history layer uses the page
+// URL). Adding a key again supersedes the older copy; removals are recorded
+// in the manifest and dropped for good when the owning segment is merged.
+//
+// Not thread-safe: HistoryTextIndex drives one instance from a single worker.
+class FullTextIndex final
+{
+public:
+  struct Hit
+  {
+    QString key;
+    QString title;
+    qint64 visitedMs = 0;
+    double score = 0.0;
+    int matchedTerms = 0;
+  };
+
+  static constexpr int kFlushThreshold = 32;
+  static constexpr int kMergeFactor = 4;
+  static constexpr int kMaxTokenLength = 40;
+  static constexpr int kMaxTokensPerDocument = 20000;
+  static constexpr int kMaxPrefixExpansions = 16;
+  static constexpr int kTitleWeight = 3;
+
+  FullTextIndex();
+  ~FullTextIndex();
+
+  FullTextIndex(const FullTextIndex&) = delete;
+  FullTextIndex& operator=(const FullTextIndex&) = delete;
+
+  static QStringList tokenize(QStringView text);
+
+  bool open(const QString& dirPath, QString* error = nullptr);
+  void close();
+  bool isOpen() const;
+
+  void addDocument(const QString& key, const QString& title, const QString& text, qint64 visitedMs);
+  bool removeDocument(const QString& key);
+  int retainOnly(const QSet<QString>& keys);
+  bool clear(QString* error = nullptr);
+
+  bool flush(QString* error = nullptr);
+  bool merge(bool everything = false, QString* error = nullptr);
+
+  // The last query term also matches as a prefix, so results keep up while
+  // the user is still typing a word. fromMs/toMs filter by visit time when
+  // non-zero.
+  QVector<Hit> search(const QString& query, int limit, qint64 fromMs = 0, qint64 toMs = 0) const;
+
+  int documentCount() const;
+  int segmentCount() const;
+  int bufferedCount() const;
+
+private:
+  struct Segment;
+  struct BufferedDocument
+  {
+    QString key;
+    QString title;
+    qint64 visitedMs = 0;
+    quint64 sequence = 0;
+    quint32 length = 0;
+    QHash<QString, quint32> terms;
+  };
+  struct Location
+  {
+    int segment = -1;
+    int document = -1;
+    quint64 sequence = 0;
+  };
+
+  bool loadManifest(QString* error);
+  bool saveManifest(QString* error) const;
+  void rebuildLiveness();
+  void markDead(const QString& key);
+  bool writeSegment(const std::vector<int>& sources, bool includeBuffer, QString* error);
+
+  QString m_dir;
+  bool m_open = false;
+  std::vector<std::unique_ptr<Segment>> m_segments;
+  QVector<BufferedDocument> m_buffer;
+  QHash<QString, Location> m_latest;
+  QHash<QString, quint64> m_deleted;
+  quint64 m_nextSequence = 1;
+  quint32 m_nextSegmentId = 1;
+  qint64 m_liveLength = 0;
+};
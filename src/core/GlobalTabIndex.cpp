@@ -0,0 +1,332 @@
+#include "GlobalTabIndex.h"
+
+#include "TabModel.h"
+#include "WorkspaceModel.h"
+
+#include <algorithm>
+
+GlobalTabIndex::GlobalTabIndex(QObject* parent)
+  : QObject(parent)
+{
+}
+
+WorkspaceModel* GlobalTabIndex::workspaces() const
+{
+  return m_workspaces;
+}
+
+void GlobalTabIndex::setWorkspaces(WorkspaceModel* workspaces)
+{
+  if (m_workspaces == workspaces) {
+    return;
+  }
+  if (m_workspaces) {
+    disconnect(m_workspaces, nullptr, this, nullptr);
+  }
+  detachAll();
+  m_workspaces = workspaces;
+  if (!m_workspaces) {
+    return;
+  }
+
+  connect(m_workspaces, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+    for (int i = first; i <= last; ++i) {
+      attach(m_workspaces->tabsForIndex(i), m_workspaces->workspaceIdAt(i));
+    }
+  });
+  connect(m_workspaces, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+          [this](const QModelIndex&, int first, int last) {
+            for (int i = first; i <= last; ++i) {
+              detach(m_workspaces->tabsForIndex(i));
+            }
+          });
+  connect(m_workspaces, &QAbstractItemModel::modelAboutToBeReset, this, &GlobalTabIndex::detachAll);
+  connect(m_workspaces, &QAbstractItemModel::modelReset, this, &GlobalTabIndex::attachAll);
+  connect(m_workspaces, &WorkspaceModel::activeIndexChanged, this, &GlobalTabIndex::touchActiveTab);
+
+  attachAll();
+}
+
+int GlobalTabIndex::count() const
+{
+  return m_entries.size();
+}
+
+QVariantList GlobalTabIndex::search(const QString& query, int limit) const
+{
+  const QString q = query.trimmed();
+  if (q.isEmpty() || limit <= 0) {
+    return {};
+  }
+
+  const QStringList terms = q.toCaseFolded().split(QLatin1Char(' '), Qt::SkipEmptyParts);
+  QVariantList out;
+  for (const quint64 key : m_recent) {
+    const Entry& entry = m_entries.constFind(key).value();
+    const bool matches = std::all_of(terms.cbegin(), terms.cend(), [&entry](const QString& term) {
+      return entry.titleKey.contains(term) || entry.urlKey.contains(term);
+    });
+    if (!matches) {
+      continue;
+    }
+
+    out.append(toVariant(entry, q));
+    if (out.size() >= limit) {
+      break;
+    }
+  }
+  return out;
+}
+
+QVariantList GlobalTabIndex::recentTabs(int limit) const
+{
+  QVariantList out;
+  const int n = std::min<int>(limit, m_recent.size());
+  for (int i = 0; i < n; ++i) {
+    out.append(toVariant(m_entries.constFind(m_recent.at(i)).value(), {}));
+  }
+  return out;
+}
+
+QVariantMap GlobalTabIndex::recentAt(int position) const
+{
+  if (position < 0 || position >= m_recent.size()) {
+    return {};
+  }
+  return toVariant(m_entries.constFind(m_recent.at(position)).value(), {});
+}
+
+quint64 GlobalTabIndex::keyOf(int workspaceId, int tabId)
+{
+  return (static_cast<quint64>(static_cast<quint32>(workspaceId)) << 32) | static_cast<quint32>(tabId);
+}
+
+void GlobalTabIndex::attachAll()
+{
+  if (!m_workspaces) {
+    return;
+  }
+  for (int i = 0; i < m_workspaces->count(); ++i) {
+    attach(m_workspaces->tabsForIndex(i), m_workspaces->workspaceIdAt(i));
+  }
+  touchActiveTab();
+}
+
+void GlobalTabIndex::detachAll()
+{
+  const QList<TabModel*> attached = m_workspaceIds.keys();
+  for (TabModel* tabs : attached) {
+    detach(tabs);
+  }
+}
+
+void GlobalTabIndex::attach(TabModel* tabs, int workspaceId)
+{
+  if (!tabs || m_workspaceIds.contains(tabs)) {
+    return;
+  }
+  m_workspaceIds.insert(tabs, workspaceId);
+
+  connect(tabs, &QAbstractItemModel::rowsInserted, this, [this, tabs](const QModelIndex&, int first, int last) {
+    addRows(tabs, first, last);
+  });
+  connect(tabs, &QAbstractItemModel::rowsAboutToBeRemoved, this, [this, tabs](const QModelIndex&, int first, int last) {
+    removeRows(tabs, first, last);
+  });
+  connect(tabs, &QAbstractItemModel::modelReset, this, [this, tabs] {
+    resetRows(tabs);
+  });
+  connect(tabs, &QAbstractItemModel::dataChanged, this,
+          [this, tabs](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles) {
+            updateRows(tabs, topLeft.row(), bottomRight.row(), roles);
+          });
+
+  if (tabs->count() > 0) {
+    addRows(tabs, 0, tabs->count() - 1);
+  }
+}
+
+void GlobalTabIndex::detach(TabModel* tabs)
+{
+  if (!tabs || !m_workspaceIds.contains(tabs)) {
+    return;
+  }
+  const int workspaceId = m_workspaceIds.take(tabs);
+  disconnect(tabs, nullptr, this, nullptr);
+
+  const int before = m_entries.size();
+  const QVector<quint64> keys = m_recent;
+  for (const quint64 key : keys) {
+    if (static_cast<int>(key >> 32) == workspaceId) {
+      removeEntry(key);
+    }
+  }
+  if (m_entries.size() != before) {
+    emit countChanged();
+  }
+}
+
+void GlobalTabIndex::addRows(TabModel* tabs, int first, int last)
+{
+  const int workspaceId = m_workspaceIds.value(tabs);
+  for (int i = first; i <= last; ++i) {
+    Entry entry;
+    entry.workspaceId = workspaceId;
+    entry.tabId = tabs->tabIdAt(i);
+    setTitle(entry, tabs->titleAt(i));
+    setUrl(entry, tabs->urlAt(i));
+    entry.faviconUrl = tabs->faviconUrlAt(i);
+    entry.lastActivatedMs = tabs->lastActivatedMsAt(i);
+
+    const quint64 key = keyOf(workspaceId, entry.tabId);
+    removeEntry(key);
+
+    // New and restored tabs slot in by when they were last active.
+    int position = 0;
+    while (position < m_recent.size()
+           && m_entries.constFind(m_recent.at(position))->lastActivatedMs >= entry.lastActivatedMs) {
+      ++position;
+    }
+    m_recent.insert(position, key);
+    m_entries.insert(key, std::move(entry));
+  }
+  emit countChanged();
+}
+
+void GlobalTabIndex::removeRows(TabModel* tabs, int first, int last)
+{
+  const int workspaceId = m_workspaceIds.value(tabs);
+  for (int i = first; i <= last; ++i) {
+    removeEntry(keyOf(workspaceId, tabs->tabIdAt(i)));
+  }
+  emit countChanged();
+}
+
+void GlobalTabIndex::resetRows(TabModel* tabs)
+{
+  const int workspaceId = m_workspaceIds.value(tabs);
+  const QVector<quint64> keys = m_recent;
+  for (const quint64 key : keys) {
+    if (static_cast<int>(key >> 32) == workspaceId) {
+      removeEntry(key);
+    }
+  }
+  if (tabs->count() > 0) {
+    addRows(tabs, 0, tabs->count() - 1);
+  } else {
+    emit countChanged();
+  }
+}
+
+void GlobalTabIndex::updateRows(TabModel* tabs, int first, int last, const QList<int>& roles)
+{
+  const auto changed = [&roles](int role) {
+    return roles.isEmpty() || roles.contains(role);
+  };
+  if (!changed(TabModel::TitleRole) && !changed(TabModel::CustomTitleRole) && !changed(TabModel::UrlRole)
+      && !changed(TabModel::FaviconUrlRole) && !changed(TabModel::LastActivatedMsRole)) {
+    return;
+  }
+
+  const int workspaceId = m_workspaceIds.value(tabs);
+  const bool activeWorkspace = m_workspaces && m_workspaces->tabsForIndex(m_workspaces->activeIndex()) == tabs;
+  for (int i = first; i <= last; ++i) {
+    const quint64 key = keyOf(workspaceId, tabs->tabIdAt(i));
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+      continue;
+    }
+
+    if (changed(TabModel::TitleRole) || changed(TabModel::CustomTitleRole)) {
+      setTitle(it.value(), tabs->titleAt(i));
+    }
+    if (changed(TabModel::UrlRole)) {
+      setUrl(it.value(), tabs->urlAt(i));
+    }
+    if (changed(TabModel::FaviconUrlRole)) {
+      it->faviconUrl = tabs->faviconUrlAt(i);
+    }
+    if (changed(TabModel::LastActivatedMsRole)) {
+      it->lastActivatedMs = tabs->lastActivatedMsAt(i);
+      if (activeWorkspace && tabs->activeIndex() == i) {
+        touch(key);
+      }
+    }
+  }
+}
+
+void GlobalTabIndex::touchActiveTab()
+{
+  if (!m_workspaces) {
+    return;
+  }
+  const int workspaceIndex = m_workspaces->activeIndex();
+  TabModel* tabs = m_workspaces->tabsForIndex(workspaceIndex);
+  if (!tabs || tabs->activeIndex() < 0) {
+    return;
+  }
+  touch(keyOf(m_workspaces->workspaceIdAt(workspaceIndex), tabs->tabIdAt(tabs->activeIndex())));
+}
+
+void GlobalTabIndex::touch(quint64 key)
+{
+  const int position = m_recent.indexOf(key);
+  if (position > 0) {
+    m_recent.move(position, 0);
+  }
+}
+
+void GlobalTabIndex::removeEntry(quint64 key)
+{
+  if (m_entries.remove(key)) {
+    m_recent.removeOne(key);
+  }
+}
+
+void GlobalTabIndex::setTitle(Entry& entry, const QString& title)
+{
+  entry.title = title;
+  entry.titleKey = title.toCaseFolded();
+}
+
+void GlobalTabIndex::setUrl(Entry& entry, const QUrl& url)
+{
+  entry.url = url;
+  entry.urlText = url.isValid() ? url.toString() : QString();
+  entry.urlKey = entry.urlText.toCaseFolded();
+}
+
+QVariantMap GlobalTabIndex::toVariant(const Entry& entry, const QString& query) const
+{
+  QString title = entry.title.isEmpty() ? entry.urlText : entry.title;
+  if (title.isEmpty()) {
+    title = QStringLiteral("Tab %1").arg(entry.tabId);
+  }
+
+  int workspaceIndex = -1;
+  QString workspaceName;
+  if (m_workspaces) {
+    for (int i = 0; i < m_workspaces->count(); ++i) {
+      if (m_workspaces->workspaceIdAt(i) == entry.workspaceId) {
+        workspaceIndex = i;
+        workspaceName = m_workspaces->nameAt(i);
+        break;
+      }
+    }
+  }
+
+  const int matchStart = query.isEmpty() ? -1 : title.indexOf(query, 0, Qt::CaseInsensitive);
+
+  QVariantMap row;
+  row.insert(QStringLiteral("workspaceId"), entry.workspaceId);
+  row.insert(QStringLiteral("workspaceIndex"), workspaceIndex);
+  row.insert(QStringLiteral("workspaceName"), workspaceName);
+  row.insert(QStringLiteral("tabId"), entry.tabId);
+  row.insert(QStringLiteral("title"), title);
+  row.insert(QStringLiteral("subtitle"), entry.urlText);
+  row.insert(QStringLiteral("faviconUrl"), entry.faviconUrl);
+  row.insert(QStringLiteral("lastActivatedMs"), entry.lastActivatedMs);
+  row.insert(QStringLiteral("matchStart"), matchStart);
+  row.insert(QStringLiteral("matchLength"), matchStart >= 0 ? query.length() : 0);
+  return row;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+#include <QVariant>
+#include <QVector>
+
+class TabModel;
+class WorkspaceModel;
+
+// Every tab of every workspace in one table, kept current from the
+// workspaces' TabModel signals. Tab ids are only unique within a
+// workspace, so entries are keyed by (workspace id, tab id). Titles and
+// URLs are case-folded once when they change, and tabs are kept in
+// most-recently-used order, so a search walks that order and stops at the
+// limit without touching the models.
+//
+// A tab counts as used when it becomes active in the active workspace, or
+// its workspace becomes active.
+class GlobalTabIndex final : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+  explicit GlobalTabIndex(QObject* parent = nullptr);
+
+  WorkspaceModel* workspaces() const;
+  void setWorkspaces(WorkspaceModel* workspaces);
+
+  int count() const;
+
+  // Tabs whose title or URL contains every word of query, most recently
+  // used first. Rows carry workspaceId, workspaceIndex, workspaceName,
+  // tabId, title, subtitle, faviconUrl, lastActivatedMs, matchStart and
+  // matchLength.
+  Q_INVOKABLE QVariantList search(const QString& query, int limit = 8) const;
+
+  // Position 0 is the tab in use, 1 the one used before it, and so on.
+  Q_INVOKABLE QVariantList recentTabs(int limit = 10) const;
+  Q_INVOKABLE QVariantMap recentAt(int position) const;
+
+signals:
+  void countChanged();
+
+private:
+  struct Entry
+  {
+    int workspaceId = 0;
+    int tabId = 0;
+    QString title;
+    QString titleKey;
+    QUrl url;
+    QString urlText;
+    QString urlKey;
+    QUrl faviconUrl;
+    qint64 lastActivatedMs = 0;
+  };
+
+  static quint64 keyOf(int workspaceId, int tabId);
+
+  void attachAll();
+  void detachAll();
+  void attach(TabModel* tabs, int workspaceId);
+  void detach(TabModel* tabs);
+  void addRows(TabModel* tabs, int first, int last);
+  void removeRows(TabModel* tabs, int first, int last);
+  void resetRows(TabModel* tabs);
+  void updateRows(TabModel* tabs, int first, int last, const QList<int>& roles);
+  void touchActiveTab();
+  void touch(quint64 key);
+  void removeEntry(quint64 key);
+  static void setTitle(Entry& entry, const QString& title);
+  static void setUrl(Entry& entry, const QUrl& url);
+  QVariantMap toVariant(const Entry& entry, const QString& query) const;
+
+  QPointer<WorkspaceModel> m_workspaces;
+  QHash<TabModel*, int> m_workspaceIds;
+  QHash<quint64, Entry> m_entries;
+  // Keys, most recently used first.
+  QVector<quint64> m_recent;
+};
@@ -34,8 +34,52 @@ void HistoryFilterModel::setSearchText(const QString& text)
     return;
   }
   m_searchText = next;
+  m_contentMatches.clear();
   emit searchTextChanged();
   invalidateFilter();
+  refreshContentMatches();
+}
+
+HistoryTextIndex* HistoryFilterModel::textIndex() const
+{
+  return m_textIndex;
+}
+
+void HistoryFilterModel::setTextIndex(HistoryTextIndex* index)
+{
+  if (m_textIndex == index) {
+    return;
+  }
+  m_textIndex = index;
+  m_contentMatches.clear();
+  emit textIndexChanged();
+  invalidateFilter();
+  refreshContentMatches();
+}
+
+void HistoryFilterModel::refreshContentMatches()
+{
+  const int generation = ++m_contentGeneration;
+  if (!m_textIndex || m_searchText.isEmpty()) {
+    return;
+  }
+
+  m_textIndex->searchAsync(m_searchText, kMaxContentMatches, this,
+                           [this, generation](const QVector<FullTextIndex::Hit>& hits) {
+                             if (generation != m_contentGeneration) {
+                               return;
+                             }
+                             QSet<QString> matches;
+                             matches.reserve(hits.size());
+                             for (const FullTextIndex::Hit& hit : hits) {
+                               matches.insert(hit.key);
+                             }
+                             if (matches == m_contentMatches) {
+                               return;
+                             }
+                             m_contentMatches = matches;
+                             invalidateFilter();
+                           });
 }
 
 bool HistoryFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
@@ -56,6 +100,9 @@ bool HistoryFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex& sour
   const QString needle = m_searchText;
   const QString title = idx.data(HistoryStore::TitleRole).toString();
   const QString urlText = idx.data(HistoryStore::UrlRole).toUrl().toString(QUrl::FullyDecoded);
-  return title.contains(needle, Qt::CaseInsensitive) || urlText.contains(needle, Qt::CaseInsensitive);
+  if (title.contains(needle, Qt::CaseInsensitive) || urlText.contains(needle, Qt::CaseInsensitive)) {
+    return true;
+  }
+  return !m_contentMatches.isEmpty() && m_contentMatches.contains(HistoryTextIndex::urlKey(idx.data(HistoryStore::UrlRole).toUrl()));
 }
 
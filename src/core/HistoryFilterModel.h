@@ -1,14 +1,18 @@
 #pragma once
 
+#include <QPointer>
+#include <QSet>
 #include <QSortFilterProxyModel>
 
 #include "HistoryStore.h"
+#include "HistoryTextIndex.h"
 
 class HistoryFilterModel : public QSortFilterProxyModel
 {
   Q_OBJECT
   Q_PROPERTY(HistoryStore* sourceHistory READ sourceHistory WRITE setSourceHistory NOTIFY sourceHistoryChanged)
   Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY searchTextChanged)
+  Q_PROPERTY(HistoryTextIndex* textIndex READ textIndex WRITE setTextIndex NOTIFY textIndexChanged)
 
 public:
   explicit HistoryFilterModel(QObject* parent = nullptr);
@@ -19,13 +23,25 @@ public:
   QString searchText() const;
   void setSearchText(const QString& text);
 
+  // When set, entries whose page text matches the search are shown too.
+  HistoryTextIndex* textIndex() const;
+  void setTextIndex(HistoryTextIndex* index);
+
+  static constexpr int kMaxContentMatches = 200;
+
 signals:
   void sourceHistoryChanged();
   void searchTextChanged();
+  void textIndexChanged();
 
 protected:
   bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
 
 private:
+  void refreshContentMatches();
+
   QString m_searchText;
+  QPointer<HistoryTextIndex> m_textIndex;
+  QSet<QString> m_contentMatches;
+  int m_contentGeneration = 0;
 };
@@ -0,0 +1,251 @@
+#include "HistoryImporter.h"
+
+#include <QAtomicInt>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QUrl>
+
+namespace
+{
+// Chromium stores microseconds since 1601-01-01 UTC.
+constexpr qint64 kChromiumEpochOffsetMs = 11644473600000LL;
+
+HistoryImporter::Format formatOf(const QSqlDatabase& db)
+{
+  const QStringList tables = db.tables();
+  if (tables.contains(QStringLiteral("moz_places")) && tables.contains(QStringLiteral("moz_historyvisits"))) {
+    return HistoryImporter::Format::Firefox;
+  }
+  if (tables.contains(QStringLiteral("urls")) && tables.contains(QStringLiteral("visits"))) {
+    return HistoryImporter::Format::Chromium;
+  }
+  return HistoryImporter::Format::Unknown;
+}
+
+bool importable(const QUrl& url)
+{
+  const QString scheme = url.scheme();
+  return scheme == QStringLiteral("http") || scheme == QStringLiteral("https") || scheme == QStringLiteral("file");
+}
+
+bool copyDatabase(const QString& path, const QString& dir, QString* copyPath, QString* error)
+{
+  const QString target = QDir(dir).filePath(QStringLiteral("import.sqlite"));
+  if (!QFile::copy(path, target)) {
+    *error = QStringLiteral("Could not read %1").arg(QDir::toNativeSeparators(path));
+    return false;
+  }
+  QFile::setPermissions(target, QFile::ReadOwner | QFile::WriteOwner);
+
+  // A running browser keeps recent writes in its journal; SQLite replays it
+  // when the copy is opened.
+  for (const QString& suffix : {QStringLiteral("-wal"), QStringLiteral("-journal")}) {
+    if (QFileInfo::exists(path + suffix) && QFile::copy(path + suffix, target + suffix)) {
+      QFile::setPermissions(target + suffix, QFile::ReadOwner | QFile::WriteOwner);
+    }
+  }
+
+  *copyPath = target;
+  return true;
+}
+
+bool readDatabase(const QSqlDatabase& db, int chunkSize, const HistoryImporter::ChunkSink& sink, QString* error)
+{
+  const HistoryImporter::Format format = formatOf(db);
+  QString sql;
+  switch (format) {
+  case HistoryImporter::Format::Chromium:
+    sql = QStringLiteral("SELECT u.url, u.title, v.visit_time FROM visits v JOIN urls u ON u.id = v.url ORDER BY v.visit_time");
+    break;
+  case HistoryImporter::Format::Firefox:
+    sql = QStringLiteral(
+      "SELECT p.url, p.title, v.visit_date FROM moz_historyvisits v JOIN moz_places p ON p.id = v.place_id ORDER BY v.visit_date");
+    break;
+  case HistoryImporter::Format::Unknown:
+    *error = QStringLiteral("Not a Chrome, Edge or Firefox history database");
+    return false;
+  }
+
+  QSqlQuery query(db);
+  query.setForwardOnly(true);
+  if (!query.exec(sql)) {
+    *error = query.lastError().text();
+    return false;
+  }
+
+  QVector<HistoryStore::VisitRecord> chunk;
+  chunk.reserve(chunkSize);
+  while (query.next()) {
+    HistoryStore::VisitRecord record;
+    record.url = QUrl(query.value(0).toString());
+    if (!importable(record.url)) {
+      continue;
+    }
+    record.title = query.value(1).toString();
+    const qint64 time = query.value(2).toLongLong();
+    record.visitedMs = format == HistoryImporter::Format::Chromium ? time / 1000 - kChromiumEpochOffsetMs : time / 1000;
+    chunk.push_back(std::move(record));
+
+    if (chunk.size() >= chunkSize) {
+      if (!sink(std::move(chunk))) {
+        return true;
+      }
+      chunk = {};
+      chunk.reserve(chunkSize);
+    }
+  }
+  if (!chunk.isEmpty()) {
+    sink(std::move(chunk));
+  }
+  return true;
+}
+}
+
+HistoryImporter::HistoryImporter(QObject* parent)
+  : QObject(parent)
+{
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(10000);
+}
+
+HistoryImporter::~HistoryImporter()
+{
+  cancel();
+  m_pool.waitForDone();
+}
+
+HistoryStore* HistoryImporter::history() const
+{
+  return m_history;
+}
+
+void HistoryImporter::setHistory(HistoryStore* history)
+{
+  m_history = history;
+}
+
+bool HistoryImporter::running() const
+{
+  return m_running;
+}
+
+int HistoryImporter::imported() const
+{
+  return m_imported;
+}
+
+bool HistoryImporter::importFile(const QString& path)
+{
+  const QString localPath = path.trimmed();
+  if (m_running || !m_history || localPath.isEmpty()) {
+    return false;
+  }
+
+  m_cancelled = std::make_shared<std::atomic_bool>(false);
+  m_imported = 0;
+  m_running = true;
+  emit runningChanged();
+  emit progressChanged();
+
+  const std::shared_ptr<std::atomic_bool> cancelled = m_cancelled;
+  m_pool.start([this, localPath, cancelled] {
+    QString error;
+    const auto sink = [this, cancelled](QVector<HistoryStore::VisitRecord> chunk) {
+      if (*cancelled) {
+        return false;
+      }
+      QMetaObject::invokeMethod(
+        this,
+        [this, chunk = std::move(chunk)]() mutable {
+          ingest(std::move(chunk));
+        },
+        Qt::QueuedConnection);
+      return true;
+    };
+    if (readVisits(localPath, kChunkSize, sink, &error) && *cancelled) {
+      error = QStringLiteral("Import cancelled");
+    }
+    QMetaObject::invokeMethod(
+      this,
+      [this, error] {
+        finish(error);
+      },
+      Qt::QueuedConnection);
+  });
+  return true;
+}
+
+void HistoryImporter::cancel()
+{
+  if (m_cancelled) {
+    *m_cancelled = true;
+  }
+}
+
+bool HistoryImporter::readVisits(const QString& path, int chunkSize, const ChunkSink& sink, QString* error)
+{
+  const auto fail = [error](const QString& message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  if (!QSqlDatabase::isDriverAvailable(QStringLiteral("QSQLITE"))) {
+    return fail(QStringLiteral("SQLite support is not available"));
+  }
+  if (!QFileInfo(path).isFile()) {
+    return fail(QStringLiteral("%1 does not exist").arg(QDir::toNativeSeparators(path)));
+  }
+
+  QTemporaryDir scratch;
+  if (!scratch.isValid()) {
+    return fail(scratch.errorString());
+  }
+
+  QString copyPath;
+  QString message;
+  if (!copyDatabase(path, scratch.path(), &copyPath, &message)) {
+    return fail(message);
+  }
+
+  static QAtomicInt serial;
+  const QString connection = QStringLiteral("xbrowser-history-import-%1").arg(serial.fetchAndAddRelaxed(1));
+  bool ok = false;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connection);
+    db.setDatabaseName(copyPath);
+    if (!db.open()) {
+      message = db.lastError().text();
+    } else {
+      ok = readDatabase(db, qMax(1, chunkSize), sink, &message);
+      db.close();
+    }
+  }
+  QSqlDatabase::removeDatabase(connection);
+
+  return ok || fail(message);
+}
+
+void HistoryImporter::ingest(QVector<HistoryStore::VisitRecord> chunk)
+{
+  if (!m_history || (m_cancelled && *m_cancelled)) {
+    return;
+  }
+
+  m_imported += m_history->addVisits(std::move(chunk));
+  emit progressChanged();
+}
+
+void HistoryImporter::finish(const QString& error)
+{
+  m_running = false;
+  emit runningChanged();
+  emit finished(m_imported, error);
+}
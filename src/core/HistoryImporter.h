@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "HistoryStore.h"
+
+// Imports another browser's history: Chromium's "History" database (Chrome,
+// Edge, Brave, ...) or Firefox's places.sqlite. The database is copied
+// first, since a running browser keeps it locked, then read on a worker
+// thread; rows are handed to HistoryStore::addVisits in chunks on the GUI
+// thread, so the model sees one insert per chunk rather than per visit.
+class HistoryImporter final : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(bool running READ running NOTIFY runningChanged)
+  Q_PROPERTY(int imported READ imported NOTIFY progressChanged)
+
+public:
+  enum class Format
+  {
+    Unknown,
+    Chromium,
+    Firefox,
+  };
+
+  // Returns false to stop reading.
+  using ChunkSink = std::function<bool(QVector<HistoryStore::VisitRecord> chunk)>;
+
+  static constexpr int kChunkSize = 50000;
+
+  explicit HistoryImporter(QObject* parent = nullptr);
+  ~HistoryImporter() override;
+
+  HistoryStore* history() const;
+  void setHistory(HistoryStore* history);
+
+  bool running() const;
+  int imported() const;
+
+  // Starts an import unless one is already running. The outcome arrives
+  // through finished.
+  Q_INVOKABLE bool importFile(const QString& path);
+  Q_INVOKABLE void cancel();
+
+  // Synchronous; safe to call from any thread. Visits come in time order,
+  // limited to http(s) and file URLs.
+  static bool readVisits(const QString& path, int chunkSize, const ChunkSink& sink, QString* error = nullptr);
+
+signals:
+  void runningChanged();
+  void progressChanged();
+  void finished(int imported, const QString& error);
+
+private:
+  void ingest(QVector<HistoryStore::VisitRecord> chunk);
+  void finish(const QString& error);
+
+  QThreadPool m_pool;
+  QPointer<HistoryStore> m_history;
+  std::shared_ptr<std::atomic_bool> m_cancelled;
+  bool m_running = false;
+  int m_imported = 0;
+};
@@ -0,0 +1,377 @@
+#include "HistorySnapshot.h"
+
+#include "UserDataStorage.h"
+
+#include <QFile>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace
+{
+constexpr quint32 kMagic = 0x53484258; // "XBHS"
+
+// magic, version, visitCount, pageCount, nextId, reserved, heapUnits
+constexpr qint64 kHeaderBytes = 32;
+// keyOffset, keyLength, titleOffset, titleLength, lastVisitMs
+constexpr qint64 kPageEntryBytes = 24;
+
+qint64 align8(qint64 n)
+{
+  return (n + 7) & ~qint64(7);
+}
+
+template<typename T>
+T readAt(const uchar* data, qint64 offset)
+{
+  return qFromUnaligned<T>(data + offset);
+}
+
+template<typename T>
+void writeAt(QByteArray* out, qint64 offset, T value)
+{
+  qToUnaligned(value, out->data() + offset);
+}
+}
+
+int HistorySnapshot::Builder::addPage(QStringView key, QStringView title, qint64 lastVisitMs)
+{
+  m_pageStrings.push_back(static_cast<quint32>(m_heap.size()));
+  m_pageStrings.push_back(static_cast<quint32>(key.size()));
+  m_heap.append(key);
+  m_pageStrings.push_back(static_cast<quint32>(m_heap.size()));
+  m_pageStrings.push_back(static_cast<quint32>(title.size()));
+  m_heap.append(title);
+  m_pageLastVisits.push_back(lastVisitMs);
+  return static_cast<int>(m_pageLastVisits.size() - 1);
+}
+
+void HistorySnapshot::Builder::addVisit(int id, int pageIndex, qint64 visitedMs, int count, qint32 spanMs)
+{
+  m_visitTimes.push_back(visitedMs);
+  m_visitIds.push_back(id);
+  m_visitPages.push_back(pageIndex);
+  m_visitCounts.push_back(count);
+  m_visitSpans.push_back(spanMs);
+}
+
+QByteArray HistorySnapshot::Builder::finish(int nextId) const
+{
+  const qint64 visits = m_visitTimes.size();
+  const qint64 pages = m_pageLastVisits.size();
+
+  const qint64 timesOffset = kHeaderBytes;
+  const qint64 idsOffset = timesOffset + visits * 8;
+  const qint64 visitPagesOffset = idsOffset + visits * 4;
+  const qint64 countsOffset = visitPagesOffset + visits * 4;
+  const qint64 spansOffset = countsOffset + visits * 4;
+  const qint64 pagesOffset = align8(spansOffset + visits * 4);
+  const qint64 heapOffset = pagesOffset + pages * kPageEntryBytes;
+  const qint64 size = heapOffset + qint64(m_heap.size()) * 2;
+
+  QByteArray out(size, '\0');
+  writeAt<quint32>(&out, 0, kMagic);
+  writeAt<quint32>(&out, 4, kVersion);
+  writeAt<quint32>(&out, 8, static_cast<quint32>(visits));
+  writeAt<quint32>(&out, 12, static_cast<quint32>(pages));
+  writeAt<qint32>(&out, 16, nextId);
+  writeAt<quint64>(&out, 24, static_cast<quint64>(m_heap.size()));
+
+  if (visits > 0) {
+    std::memcpy(out.data() + timesOffset, m_visitTimes.constData(), visits * 8);
+    std::memcpy(out.data() + idsOffset, m_visitIds.constData(), visits * 4);
+    std::memcpy(out.data() + visitPagesOffset, m_visitPages.constData(), visits * 4);
+    std::memcpy(out.data() + countsOffset, m_visitCounts.constData(), visits * 4);
+    std::memcpy(out.data() + spansOffset, m_visitSpans.constData(), visits * 4);
+  }
+  for (qint64 i = 0; i < pages; ++i) {
+    const qint64 entry = pagesOffset + i * kPageEntryBytes;
+    for (int field = 0; field < 4; ++field) {
+      writeAt<quint32>(&out, entry + field * 4, m_pageStrings.at(i * 4 + field));
+    }
+    writeAt<qint64>(&out, entry + 16, m_pageLastVisits.at(i));
+  }
+  if (!m_heap.isEmpty()) {
+    std::memcpy(out.data() + heapOffset, m_heap.constData(), qint64(m_heap.size()) * 2);
+  }
+  return out;
+}
+
+HistorySnapshot::HistorySnapshot() = default;
+
+HistorySnapshot::~HistorySnapshot()
+{
+  close();
+}
+
+HistorySnapshot::HistorySnapshot(HistorySnapshot&& other) noexcept
+{
+  *this = std::move(other);
+}
+
+HistorySnapshot& HistorySnapshot::operator=(HistorySnapshot&& other) noexcept
+{
+  if (this == &other) {
+    return *this;
+  }
+
+  close();
+  m_file = std::move(other.m_file);
+  m_owned = std::move(other.m_owned);
+  m_data = other.m_data;
+  m_size = other.m_size;
+  m_hasVisits = other.m_hasVisits;
+  m_nextId = other.m_nextId;
+  m_visitCount = other.m_visitCount;
+  m_pageCount = other.m_pageCount;
+  m_timesOffset = other.m_timesOffset;
+  m_idsOffset = other.m_idsOffset;
+  m_visitPagesOffset = other.m_visitPagesOffset;
+  m_countsOffset = other.m_countsOffset;
+  m_spansOffset = other.m_spansOffset;
+  m_pagesOffset = other.m_pagesOffset;
+  m_heapOffset = other.m_heapOffset;
+  m_heapUnits = other.m_heapUnits;
+
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.close();
+  return *this;
+}
+
+bool HistorySnapshot::open(const QString& name, QString* error)
+{
+  close();
+
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  const QString path = storage.localPath(name);
+  if (path.isEmpty()) {
+    QByteArray data;
+    if (!storage.read(name, &data, error)) {
+      return false;
+    }
+    return openData(data, error);
+  }
+
+  auto file = std::make_unique<QFile>(path);
+  if (!file->open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = file->errorString();
+    }
+    return false;
+  }
+
+  const qint64 size = file->size();
+  uchar* mapped = size > 0 ? file->map(0, size) : nullptr;
+  if (!mapped) {
+    // Mapping can fail (e.g. on some network shares); reading still works.
+    return openData(file->readAll(), error);
+  }
+
+  m_file = std::move(file);
+  m_data = mapped;
+  m_size = size;
+  if (!parse(error)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool HistorySnapshot::openData(const QByteArray& data, QString* error)
+{
+  close();
+  m_owned = data;
+  m_data = reinterpret_cast<const uchar*>(m_owned.constData());
+  m_size = m_owned.size();
+  if (!parse(error)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void HistorySnapshot::close()
+{
+  if (m_file) {
+    m_file->close();
+    m_file.reset();
+  }
+  m_owned.clear();
+  m_data = nullptr;
+  m_size = 0;
+  m_hasVisits = false;
+  m_nextId = 1;
+  m_visitCount = 0;
+  m_pageCount = 0;
+  m_timesOffset = 0;
+  m_idsOffset = 0;
+  m_visitPagesOffset = 0;
+  m_countsOffset = 0;
+  m_spansOffset = 0;
+  m_pagesOffset = 0;
+  m_heapOffset = 0;
+  m_heapUnits = 0;
+}
+
+bool HistorySnapshot::isOpen() const
+{
+  return m_data != nullptr;
+}
+
+void HistorySnapshot::detach()
+{
+  if (!m_file) {
+    return;
+  }
+
+  m_owned = QByteArray(reinterpret_cast<const char*>(m_data + m_pagesOffset), m_size - m_pagesOffset);
+  m_file->close();
+  m_file.reset();
+
+  m_data = reinterpret_cast<const uchar*>(m_owned.constData());
+  m_size = m_owned.size();
+  m_heapOffset -= m_pagesOffset;
+  m_pagesOffset = 0;
+  m_timesOffset = 0;
+  m_idsOffset = 0;
+  m_visitPagesOffset = 0;
+  m_countsOffset = 0;
+  m_spansOffset = 0;
+  m_hasVisits = false;
+}
+
+bool HistorySnapshot::hasVisits() const
+{
+  return m_hasVisits;
+}
+
+int HistorySnapshot::nextId() const
+{
+  return m_nextId;
+}
+
+int HistorySnapshot::visitCount() const
+{
+  return m_visitCount;
+}
+
+int HistorySnapshot::pageCount() const
+{
+  return m_pageCount;
+}
+
+int HistorySnapshot::visitId(int row) const
+{
+  return readAt<qint32>(m_data, m_idsOffset + qint64(row) * 4);
+}
+
+int HistorySnapshot::visitPage(int row) const
+{
+  return readAt<qint32>(m_data, m_visitPagesOffset + qint64(row) * 4);
+}
+
+qint64 HistorySnapshot::visitTime(int row) const
+{
+  return readAt<qint64>(m_data, m_timesOffset + qint64(row) * 8);
+}
+
+int HistorySnapshot::rowVisits(int row) const
+{
+  return m_countsOffset > 0 ? readAt<qint32>(m_data, m_countsOffset + qint64(row) * 4) : 1;
+}
+
+qint32 HistorySnapshot::visitSpanMs(int row) const
+{
+  return m_spansOffset > 0 ? readAt<qint32>(m_data, m_spansOffset + qint64(row) * 4) : 0;
+}
+
+QStringView HistorySnapshot::pageKey(int pageIndex) const
+{
+  return heapString(m_pagesOffset + qint64(pageIndex) * kPageEntryBytes);
+}
+
+QStringView HistorySnapshot::pageTitle(int pageIndex) const
+{
+  return heapString(m_pagesOffset + qint64(pageIndex) * kPageEntryBytes + 8);
+}
+
+qint64 HistorySnapshot::pageLastVisitMs(int pageIndex) const
+{
+  return readAt<qint64>(m_data, m_pagesOffset + qint64(pageIndex) * kPageEntryBytes + 16);
+}
+
+QStringView HistorySnapshot::heapString(qint64 entryOffset) const
+{
+  const quint32 offset = readAt<quint32>(m_data, entryOffset);
+  const quint32 length = readAt<quint32>(m_data, entryOffset + 4);
+  const auto* chars = reinterpret_cast<const QChar*>(m_data + m_heapOffset) + offset;
+  return QStringView(chars, length);
+}
+
+bool HistorySnapshot::parse(QString* error)
+{
+  const auto fail = [error](const QString& message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  if (m_size < kHeaderBytes || readAt<quint32>(m_data, 0) != kMagic) {
+    return fail(QStringLiteral("history.bin is not a history snapshot"));
+  }
+  const quint32 version = readAt<quint32>(m_data, 4);
+  if (version != 1 && version != kVersion) {
+    return fail(QStringLiteral("history.bin has an unsupported version"));
+  }
+
+  const quint32 visits = readAt<quint32>(m_data, 8);
+  const quint32 pages = readAt<quint32>(m_data, 12);
+  const quint64 heapUnits = readAt<quint64>(m_data, 24);
+  if (visits > quint32(std::numeric_limits<int>::max() / 24) || pages > quint32(std::numeric_limits<int>::max() / kPageEntryBytes)
+      || heapUnits > quint64(m_size)) {
+    return fail(QStringLiteral("history.bin is corrupt"));
+  }
+
+  m_nextId = readAt<qint32>(m_data, 16);
+  m_visitCount = static_cast<int>(visits);
+  m_pageCount = static_cast<int>(pages);
+  m_heapUnits = static_cast<qint64>(heapUnits);
+  m_timesOffset = kHeaderBytes;
+  m_idsOffset = m_timesOffset + qint64(visits) * 8;
+  m_visitPagesOffset = m_idsOffset + qint64(visits) * 4;
+  qint64 columnsEnd = m_visitPagesOffset + qint64(visits) * 4;
+  if (version >= 2) {
+    m_countsOffset = columnsEnd;
+    m_spansOffset = m_countsOffset + qint64(visits) * 4;
+    columnsEnd = m_spansOffset + qint64(visits) * 4;
+  }
+  m_pagesOffset = align8(columnsEnd);
+  m_heapOffset = m_pagesOffset + qint64(pages) * kPageEntryBytes;
+  if (m_heapOffset + m_heapUnits * 2 != m_size) {
+    return fail(QStringLiteral("history.bin is truncated"));
+  }
+
+  // Bounds are checked once here so lookups later need no checks.
+  for (int row = 0; row < m_visitCount; ++row) {
+    const qint32 page = readAt<qint32>(m_data, m_visitPagesOffset + qint64(row) * 4);
+    if (page < 0 || page >= m_pageCount || rowVisits(row) < 1 || visitSpanMs(row) < 0) {
+      return fail(QStringLiteral("history.bin is corrupt"));
+    }
+  }
+  for (int page = 0; page < m_pageCount; ++page) {
+    const qint64 entry = m_pagesOffset + qint64(page) * kPageEntryBytes;
+    for (int field = 0; field < 4; field += 2) {
+      const quint64 offset = readAt<quint32>(m_data, entry + field * 4);
+      const quint64 length = readAt<quint32>(m_data, entry + field * 4 + 4);
+      if (offset + length > heapUnits) {
+        return fail(QStringLiteral("history.bin is corrupt"));
+      }
+    }
+  }
+
+  m_hasVisits = true;
+  return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+#include <memory>
+
+class QFile;
+
+// Binary history.bin: a header, then columns of visit timestamps, ids, page
+// indexes, visit counts and spans (rows that stand for several visits of a
+// page on one day), a page table and a UTF-16 string heap holding each page's
+// URL key and title. Opening it maps the file, checks that every index and
+// string range is in bounds and decodes nothing else; strings are read
+// straight out of the mapping when asked for.
+//
+// Numbers are stored in host byte order. A snapshot written on a machine
+// with the other byte order fails the magic check and is not loaded.
+class HistorySnapshot final
+{
+public:
+  // Version 1 had no count or span columns; it still loads, as one visit
+  // per row.
+  static constexpr quint32 kVersion = 2;
+
+  class Builder final
+  {
+  public:
+    int addPage(QStringView key, QStringView title, qint64 lastVisitMs);
+    void addVisit(int id, int pageIndex, qint64 visitedMs, int count = 1, qint32 spanMs = 0);
+    QByteArray finish(int nextId) const;
+
+  private:
+    QVector<qint64> m_visitTimes;
+    QVector<qint32> m_visitIds;
+    QVector<qint32> m_visitPages;
+    QVector<qint32> m_visitCounts;
+    QVector<qint32> m_visitSpans;
+    QVector<quint32> m_pageStrings;
+    QVector<qint64> m_pageLastVisits;
+    QString m_heap;
+  };
+
+  HistorySnapshot();
+  ~HistorySnapshot();
+  HistorySnapshot(HistorySnapshot&& other) noexcept;
+  HistorySnapshot& operator=(HistorySnapshot&& other) noexcept;
+
+  // Reads through xbrowser::userDataStorage(): mapped when the backend has
+  // a local file, copied into memory otherwise.
+  bool open(const QString& name, QString* error = nullptr);
+  bool openData(const QByteArray& data, QString* error = nullptr);
+  void close();
+  bool isOpen() const;
+
+  // Copies the page table and string heap out of the mapping and drops the
+  // rest, so the file can be replaced (Windows refuses to while it is
+  // mapped). Visit columns are unavailable afterwards.
+  void detach();
+  bool hasVisits() const;
+
+  int nextId() const;
+  int visitCount() const;
+  int pageCount() const;
+
+  int visitId(int row) const;
+  int visitPage(int row) const;
+  qint64 visitTime(int row) const;
+  int rowVisits(int row) const;
+  qint32 visitSpanMs(int row) const;
+
+  QStringView pageKey(int pageIndex) const;
+  QStringView pageTitle(int pageIndex) const;
+  qint64 pageLastVisitMs(int pageIndex) const;
+
+private:
+  bool parse(QString* error);
+  QStringView heapString(qint64 entryOffset) const;
+
+  std::unique_ptr<QFile> m_file;
+  QByteArray m_owned;
+  const uchar* m_data = nullptr;
+  qint64 m_size = 0;
+  bool m_hasVisits = false;
+
+  int m_nextId = 1;
+  int m_visitCount = 0;
+  int m_pageCount = 0;
+  qint64 m_timesOffset = 0;
+  qint64 m_idsOffset = 0;
+  qint64 m_visitPagesOffset = 0;
+  qint64 m_countsOffset = 0;
+  qint64 m_spansOffset = 0;
+  qint64 m_pagesOffset = 0;
+  qint64 m_heapOffset = 0;
+  qint64 m_heapUnits = 0;
+};
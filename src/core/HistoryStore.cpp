@@ -1,25 +1,25 @@
 #include "HistoryStore.h"
 
-#include "AppPaths.h"
+#include "PublicSuffixList.h"
+#include "UserDataStorage.h"
 
 #include <QDateTime>
-#include <QDir>
-#include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QSaveFile>
+#include <QSet>
 #include <QStringConverter>
 #include <QTextStream>
 
 #include <algorithm>
+#include <limits>
 
 namespace
 {
-QString storagePath()
-{
-  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("history.json"));
-}
+const QString kSnapshotName = QStringLiteral("history.bin");
+const QString kLegacyJsonName = QStringLiteral("history.json");
+constexpr qint64 kDayMs = 24 * 60 * 60 * 1000;
 
 QString normalizeUserFilePath(const QString& input)
 {
@@ -62,26 +62,18 @@ QString normalizeDomainKey(const QString& input)
   return trimmed.trimmed().toLower();
 }
 
-bool hostMatchesDomain(const QString& host, const QString& domain)
+bool hostMatchesDomain(QStringView host, QStringView domain)
 {
   if (domain.isEmpty()) {
     return true;
   }
 
-  const QString h = host.trimmed().toLower();
-  if (h.isEmpty()) {
+  host = host.trimmed();
+  if (host.isEmpty() || !host.endsWith(domain, Qt::CaseInsensitive)) {
     return false;
   }
 
-  if (h == domain) {
-    return true;
-  }
-
-  if (h.endsWith(domain) && h.size() > domain.size() && h.at(h.size() - domain.size() - 1) == QLatin1Char('.')) {
-    return true;
-  }
-
-  return false;
+  return host.size() == domain.size() || host.at(host.size() - domain.size() - 1) == QLatin1Char('.');
 }
 
 QString escapeCsvField(const QString& input)
@@ -101,7 +93,14 @@ HistoryStore::HistoryStore(QObject* parent)
     saveNow();
   });
 
+  m_retentionTimer.setSingleShot(true);
+  connect(&m_retentionTimer, &QTimer::timeout, this, [this] {
+    applyRetention();
+    m_retentionTimer.start(kRetentionIntervalMs);
+  });
+
   load();
+  m_retentionTimer.start(kRetentionDelayMs);
 }
 
 int HistoryStore::rowCount(const QModelIndex& parent) const
@@ -109,27 +108,31 @@ int HistoryStore::rowCount(const QModelIndex& parent) const
   if (parent.isValid()) {
     return 0;
   }
-  return m_entries.size();
+  return m_visits.size();
 }
 
 QVariant HistoryStore::data(const QModelIndex& index, int role) const
 {
-  if (!index.isValid() || index.row() < 0 || index.row() >= m_entries.size()) {
+  if (!index.isValid() || index.row() < 0 || index.row() >= m_visits.size()) {
     return {};
   }
 
-  const Entry& e = m_entries.at(index.row());
+  const Visit& v = m_visits.at(index.row());
   switch (role) {
     case HistoryIdRole:
-      return e.id;
+      return v.id;
     case TitleRole:
-      return e.title;
+      return page(v.pageId).title;
     case UrlRole:
-      return e.url;
+      return page(v.pageId).url;
     case VisitedMsRole:
-      return e.visitedMs;
+      return v.visitedMs;
     case DayKeyRole:
-      return dayKeyForMs(e.visitedMs);
+      return dayKeyForMs(v.visitedMs);
+    case VisitCountRole:
+      return v.count;
+    case FirstVisitedMsRole:
+      return v.firstVisitedMs();
     default:
       return {};
   }
@@ -143,12 +146,30 @@ QHash<int, QByteArray> HistoryStore::roleNames() const
     {UrlRole, "url"},
     {VisitedMsRole, "visitedMs"},
     {DayKeyRole, "dayKey"},
+    {VisitCountRole, "visitCount"},
+    {FirstVisitedMsRole, "firstVisitedMs"},
   };
 }
 
 int HistoryStore::count() const
 {
-  return m_entries.size();
+  return m_visits.size();
+}
+
+int HistoryStore::pageCount() const
+{
+  return m_pageCount;
+}
+
+qint64 HistoryStore::newestVisitMs() const
+{
+  if (m_newestVisitMs < 0) {
+    m_newestVisitMs = 0;
+    for (const Visit& v : m_visits) {
+      m_newestVisitMs = qMax(m_newestVisitMs, v.visitedMs);
+    }
+  }
+  return m_newestVisitMs;
 }
 
 QString HistoryStore::lastError() const
@@ -156,6 +177,36 @@ QString HistoryStore::lastError() const
   return m_lastError;
 }
 
+int HistoryStore::detailDays() const
+{
+  return m_detailDays;
+}
+
+void HistoryStore::setDetailDays(int days)
+{
+  days = qMax(0, days);
+  if (m_detailDays == days) {
+    return;
+  }
+  m_detailDays = days;
+  emit retentionChanged();
+}
+
+int HistoryStore::retentionDays() const
+{
+  return m_retentionDays;
+}
+
+void HistoryStore::setRetentionDays(int days)
+{
+  days = qMax(0, days);
+  if (m_retentionDays == days) {
+    return;
+  }
+  m_retentionDays = days;
+  emit retentionChanged();
+}
+
 QString HistoryStore::normalizeUrlKey(const QUrl& url)
 {
   if (!url.isValid() || url.scheme().isEmpty()) {
@@ -199,8 +250,8 @@ int HistoryStore::indexOfId(int historyId) const
     return -1;
   }
 
-  for (int i = 0; i < m_entries.size(); ++i) {
-    if (m_entries[i].id == historyId) {
+  for (int i = 0; i < m_visits.size(); ++i) {
+    if (m_visits[i].id == historyId) {
       return i;
     }
   }
@@ -208,6 +259,230 @@ int HistoryStore::indexOfId(int historyId) const
   return -1;
 }
 
+const HistoryStore::Page& HistoryStore::page(int pageId) const
+{
+  Page& page = m_pages[pageId];
+  if (!page.inSnapshot) {
+    return page;
+  }
+
+  if (page.key.isNull()) {
+    page.key = m_snapshot.pageKey(pageId).toString();
+  }
+  page.title = m_snapshot.pageTitle(pageId).toString();
+  page.url = QUrl(page.key);
+  page.inSnapshot = false;
+
+  // Everything the snapshot held has been copied out; let the mapping go.
+  if (--m_snapshotPages == 0) {
+    m_snapshot.close();
+  }
+  return page;
+}
+
+QStringView HistoryStore::pageKey(int pageId) const
+{
+  const Page& page = m_pages.at(pageId);
+  return page.key.isNull() ? m_snapshot.pageKey(pageId) : QStringView(page.key);
+}
+
+QStringView HistoryStore::pageTitle(int pageId) const
+{
+  const Page& page = m_pages.at(pageId);
+  return page.inSnapshot ? m_snapshot.pageTitle(pageId) : QStringView(page.title);
+}
+
+void HistoryStore::ensurePageIndex()
+{
+  if (m_pageIndexReady) {
+    return;
+  }
+
+  m_pageIdByKey.reserve(m_pageCount);
+  for (int pageId = 0; pageId < m_pages.size(); ++pageId) {
+    Page& page = m_pages[pageId];
+    if (page.visitCount <= 0) {
+      continue;
+    }
+    if (page.key.isNull()) {
+      page.key = m_snapshot.pageKey(pageId).toString();
+    }
+    m_pageIdByKey.insert(page.key, pageId);
+  }
+  m_pageIndexReady = true;
+}
+
+int HistoryStore::acquirePage(const QUrl& url, const QString& key)
+{
+  ensurePageIndex();
+
+  const auto it = m_pageIdByKey.constFind(key);
+  if (it != m_pageIdByKey.constEnd()) {
+    ++m_pages[it.value()].visitCount;
+    return it.value();
+  }
+
+  int pageId = 0;
+  if (!m_freePageIds.isEmpty()) {
+    pageId = m_freePageIds.takeLast();
+  } else {
+    pageId = m_pages.size();
+    m_pages.push_back({});
+  }
+
+  Page& page = m_pages[pageId];
+  page.url = url;
+  page.key = key;
+  page.visitCount = 1;
+  m_pageIdByKey.insert(key, pageId);
+  ++m_pageCount;
+  return pageId;
+}
+
+bool HistoryStore::touchPage(int pageId, const QString& title, qint64 visitedMs)
+{
+  // The page shows the title of its most recent visit that had one.
+  HistoryStore::page(pageId);
+  Page& page = m_pages[pageId];
+  bool titleChanged = false;
+  if (visitedMs >= page.lastVisitMs) {
+    page.lastVisitMs = visitedMs;
+    if (!title.isEmpty() && page.title != title) {
+      page.title = title;
+      titleChanged = true;
+    }
+  }
+  if (page.title.isEmpty()) {
+    page.title = normalizeTitle({}, page.url);
+    titleChanged = true;
+  }
+  return titleChanged;
+}
+
+void HistoryStore::releasePage(int pageId)
+{
+  Page& page = m_pages[pageId];
+  if (--page.visitCount > 0) {
+    return;
+  }
+
+  if (m_pageIndexReady) {
+    m_pageIdByKey.remove(page.key);
+  }
+  if (page.inSnapshot && --m_snapshotPages == 0) {
+    m_snapshot.close();
+  }
+  page = {};
+  m_freePageIds.push_back(pageId);
+  --m_pageCount;
+}
+
+void HistoryStore::resetPages()
+{
+  m_pages.clear();
+  m_pageIdByKey.clear();
+  m_freePageIds.clear();
+  m_pageCount = 0;
+  m_pageIndexReady = true;
+  m_snapshot.close();
+  m_snapshotPages = 0;
+}
+
+void HistoryStore::noteVisitTime(qint64 visitedMs)
+{
+  // Unknown stays unknown until newestVisitMs() scans again.
+  if (m_newestVisitMs >= 0) {
+    m_newestVisitMs = qMax(m_newestVisitMs, visitedMs);
+  }
+}
+
+void HistoryStore::invalidateRowCaches()
+{
+  m_newestVisitMs = -1;
+  m_pageRowsReady = false;
+  m_previousRowOfPage.clear();
+  m_lastRowByPage.clear();
+}
+
+void HistoryStore::ensurePageRows()
+{
+  if (m_pageRowsReady) {
+    return;
+  }
+
+  m_lastRowByPage.fill(-1, m_pages.size());
+  m_previousRowOfPage.resize(m_visits.size());
+  for (int row = 0; row < m_visits.size(); ++row) {
+    int& lastRow = m_lastRowByPage[m_visits.at(row).pageId];
+    m_previousRowOfPage[row] = lastRow;
+    lastRow = row;
+  }
+  m_pageRowsReady = true;
+}
+
+void HistoryStore::linkAppendedRow(int row)
+{
+  if (!m_pageRowsReady) {
+    return;
+  }
+
+  const int pageId = m_visits.at(row).pageId;
+  if (pageId >= m_lastRowByPage.size()) {
+    m_lastRowByPage.resize(m_pages.size(), -1);
+  }
+  m_previousRowOfPage.push_back(m_lastRowByPage.at(pageId));
+  m_lastRowByPage[pageId] = row;
+}
+
+void HistoryStore::emitTitleChanged(int pageId)
+{
+  ensurePageRows();
+
+  // Newest row first; adjacent rows of the page go out as one range.
+  int last = pageId < m_lastRowByPage.size() ? m_lastRowByPage.at(pageId) : -1;
+  while (last >= 0) {
+    int first = last;
+    int previous = m_previousRowOfPage.at(first);
+    while (previous >= 0 && previous == first - 1) {
+      first = previous;
+      previous = m_previousRowOfPage.at(first);
+    }
+    emit dataChanged(index(first), index(last), {TitleRole});
+    last = previous;
+  }
+}
+
+int HistoryStore::removeVisitsIf(const std::function<bool(const Visit&)>& shouldRemove)
+{
+  QVector<Visit> kept;
+  kept.reserve(m_visits.size());
+  QVector<int> released;
+
+  for (const Visit& v : m_visits) {
+    if (shouldRemove(v)) {
+      released.push_back(v.pageId);
+      continue;
+    }
+    kept.push_back(v);
+  }
+
+  if (released.isEmpty()) {
+    return 0;
+  }
+
+  beginResetModel();
+  invalidateRowCaches();
+  m_visits = std::move(kept);
+  for (const int pageId : released) {
+    releasePage(pageId);
+  }
+  endResetModel();
+
+  emit countChanged();
+  scheduleSave();
+  return released.size();
+}
+
 void HistoryStore::addVisit(const QUrl& url, const QString& title, qint64 visitedMs)
 {
   const QString key = normalizeUrlKey(url);
@@ -216,54 +491,170 @@ void HistoryStore::addVisit(const QUrl& url, const QString& title, qint64 visite
   }
 
   const qint64 now = visitedMs > 0 ? visitedMs : QDateTime::currentMSecsSinceEpoch();
-  const QString nextTitle = normalizeTitle(title, url);
-
-  if (!m_entries.isEmpty()) {
-    Entry& last = m_entries[m_entries.size() - 1];
-    const QString lastKey = normalizeUrlKey(last.url);
-    if (!lastKey.isEmpty() && lastKey == key && now - last.visitedMs < 8000) {
-      bool changed = false;
-      if (last.title != nextTitle) {
-        last.title = nextTitle;
-        changed = true;
+  const QString nextTitle = title.trimmed();
+
+  if (!m_visits.isEmpty()) {
+    Visit& last = m_visits[m_visits.size() - 1];
+    if (now - last.visitedMs < 8000 && pageKey(last.pageId) == key) {
+      const bool timeChanged = last.visitedMs != now;
+      last.visitedMs = now;
+      noteVisitTime(now);
+      const bool titleChanged = touchPage(last.pageId, nextTitle, now);
+
+      if (titleChanged) {
+        emitTitleChanged(last.pageId);
       }
-      if (last.visitedMs != now) {
-        last.visitedMs = now;
-        changed = true;
+      if (timeChanged) {
+        const QModelIndex idx = index(m_visits.size() - 1);
+        emit dataChanged(idx, idx, {VisitedMsRole, DayKeyRole});
       }
-
-      if (changed) {
-        const QModelIndex idx = index(m_entries.size() - 1);
-        emit dataChanged(idx, idx, {TitleRole, VisitedMsRole, DayKeyRole});
+      if (titleChanged || timeChanged) {
         scheduleSave();
       }
       return;
     }
   }
 
-  const int insertIndex = m_entries.size();
+  const int pageId = acquirePage(url, key);
+  if (touchPage(pageId, nextTitle, now) && m_pages.at(pageId).visitCount > 1) {
+    emitTitleChanged(pageId);
+  }
+
+  const int insertIndex = m_visits.size();
   beginInsertRows({}, insertIndex, insertIndex);
 
-  Entry entry;
-  entry.id = m_nextId++;
-  entry.url = url;
-  entry.title = nextTitle;
-  entry.visitedMs = now;
-  m_entries.push_back(entry);
+  Visit visit;
+  visit.id = m_nextId++;
+  visit.pageId = pageId;
+  visit.visitedMs = now;
+  m_visits.push_back(visit);
+  linkAppendedRow(insertIndex);
+  noteVisitTime(now);
 
   endInsertRows();
   emit countChanged();
   scheduleSave();
 }
 
+int HistoryStore::addVisits(QVector<VisitRecord> visits)
+{
+  std::stable_sort(visits.begin(), visits.end(), [](const VisitRecord& a, const VisitRecord& b) {
+    return a.visitedMs < b.visitedMs;
+  });
+  visits.erase(visits.begin(), std::partition_point(visits.begin(), visits.end(), [](const VisitRecord& record) {
+    return record.visitedMs <= 0;
+  }));
+  if (visits.isEmpty()) {
+    return 0;
+  }
+
+  ensurePageIndex();
+
+  // Visits already stored inside the batch's time span, to skip re-imports.
+  // A collapsed row covers every visit of its page between its first and
+  // last time.
+  const qint64 batchFromMs = visits.first().visitedMs;
+  const qint64 batchToMs = visits.last().visitedMs;
+  QSet<QPair<int, qint64>> existing;
+  QMultiHash<int, const Visit*> collapsed;
+  for (const Visit& v : m_visits) {
+    if (v.visitedMs < batchFromMs || v.firstVisitedMs() > batchToMs) {
+      continue;
+    }
+    if (v.count > 1) {
+      collapsed.insert(v.pageId, &v);
+    } else {
+      existing.insert(qMakePair(v.pageId, v.visitedMs));
+    }
+  }
+  const auto stored = [&existing, &collapsed](int pageId, qint64 ms) {
+    if (existing.contains(qMakePair(pageId, ms))) {
+      return true;
+    }
+    for (auto it = collapsed.constFind(pageId); it != collapsed.constEnd() && it.key() == pageId; ++it) {
+      if (ms >= it.value()->firstVisitedMs() && ms <= it.value()->visitedMs) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  const int firstNewPage = m_pages.size();
+  QSet<int> reusedPages;
+  QVector<Visit> added;
+  added.reserve(visits.size());
+  QSet<int> retitledPages;
+
+  // Sorted, so repeats within the batch share a timestamp run.
+  qint64 runMs = -1;
+  QVector<int> runPages;
+
+  for (const VisitRecord& record : std::as_const(visits)) {
+    const QString key = normalizeUrlKey(record.url);
+    if (key.isEmpty()) {
+      continue;
+    }
+
+    if (record.visitedMs != runMs) {
+      runMs = record.visitedMs;
+      runPages.clear();
+    }
+
+    const int knownPageId = m_pageIdByKey.value(key, -1);
+    if (knownPageId >= 0 && (runPages.contains(knownPageId) || stored(knownPageId, runMs))) {
+      continue;
+    }
+
+    const bool storedBefore = knownPageId >= 0 && knownPageId < firstNewPage && !reusedPages.contains(knownPageId);
+    const int pageId = acquirePage(record.url, key);
+    if (knownPageId < 0 && pageId < firstNewPage) {
+      reusedPages.insert(pageId);
+    }
+    if (touchPage(pageId, record.title.trimmed(), runMs) && storedBefore) {
+      retitledPages.insert(pageId);
+    }
+    runPages.push_back(pageId);
+
+    Visit visit;
+    visit.id = m_nextId++;
+    visit.pageId = pageId;
+    visit.visitedMs = runMs;
+    added.push_back(visit);
+  }
+
+  if (added.isEmpty()) {
+    return 0;
+  }
+
+  for (const int pageId : std::as_const(retitledPages)) {
+    emitTitleChanged(pageId);
+  }
+
+  const int first = m_visits.size();
+  beginInsertRows({}, first, first + added.size() - 1);
+  m_visits.append(added);
+  for (int row = first; row < m_visits.size(); ++row) {
+    linkAppendedRow(row);
+  }
+  noteVisitTime(added.last().visitedMs);
+  endInsertRows();
+
+  emit countChanged();
+  scheduleSave();
+  return added.size();
+}
+
 void HistoryStore::removeAt(int index)
 {
-  if (index < 0 || index >= m_entries.size()) {
+  if (index < 0 || index >= m_visits.size()) {
     return;
   }
 
   beginRemoveRows({}, index, index);
-  m_entries.removeAt(index);
+  invalidateRowCaches();
+  const int pageId = m_visits.at(index).pageId;
+  m_visits.removeAt(index);
+  releasePage(pageId);
   endRemoveRows();
 
   emit countChanged();
@@ -280,12 +671,14 @@ void HistoryStore::removeById(int historyId)
 
 void HistoryStore::clearAll()
 {
-  if (m_entries.isEmpty() && m_nextId == 1) {
+  if (m_visits.isEmpty() && m_nextId == 1) {
     return;
   }
 
   beginResetModel();
-  m_entries.clear();
+  invalidateRowCaches();
+  m_visits.clear();
+  resetPages();
   m_nextId = 1;
   endResetModel();
 
@@ -299,89 +692,71 @@ void HistoryStore::clearRange(qint64 fromMs, qint64 toMs)
     return;
   }
 
-  QVector<Entry> kept;
-  kept.reserve(m_entries.size());
-
-  for (const Entry& e : m_entries) {
-    const qint64 ms = e.visitedMs;
-    if (ms >= fromMs && ms < toMs) {
-      continue;
-    }
-    kept.push_back(e);
-  }
-
-  if (kept.size() == m_entries.size()) {
-    return;
-  }
-
-  beginResetModel();
-  m_entries = std::move(kept);
-  endResetModel();
-
-  emit countChanged();
-  scheduleSave();
+  // A collapsed row goes as soon as any part of it falls in the range.
+  removeVisitsIf([fromMs, toMs](const Visit& v) {
+    return v.visitedMs >= fromMs && v.firstVisitedMs() < toMs;
+  });
 }
 
 int HistoryStore::deleteByDomain(const QString& domain)
 {
-  const QString domainKey = normalizeDomainKey(domain);
+  // Forgetting a site covers its whole registrable domain, so deleting
+  // mail.example.co.uk also drops www.example.co.uk but not other co.uk sites.
+  const QString domainKey = PublicSuffixList::siteKey(normalizeDomainKey(domain));
   if (domainKey.isEmpty()) {
     return 0;
   }
 
-  QVector<Entry> kept;
-  kept.reserve(m_entries.size());
-
-  int removed = 0;
-  for (const Entry& e : m_entries) {
-    const QString host = e.url.host();
-    if (hostMatchesDomain(host, domainKey)) {
-      ++removed;
-      continue;
-    }
-    kept.push_back(e);
-  }
+  const QVector<bool> matches = pagesMatchingDomain(domainKey);
+  return removeVisitsIf([&matches](const Visit& v) {
+    return matches.at(v.pageId);
+  });
+}
 
-  if (removed <= 0) {
-    return 0;
+QVector<bool> HistoryStore::pagesMatchingDomain(const QString& domainKey) const
+{
+  QVector<bool> matches(m_pages.size(), false);
+  for (int i = 0; i < m_pages.size(); ++i) {
+    matches[i] = m_pages.at(i).visitCount > 0 && hostMatchesDomain(page(i).url.host(), domainKey);
   }
-
-  beginResetModel();
-  m_entries = std::move(kept);
-  endResetModel();
-
-  emit countChanged();
-  scheduleSave();
-  return removed;
+  return matches;
 }
 
-QVariantList HistoryStore::query(const QString& domain, qint64 fromMs, qint64 toMs, int limit) const
+QVector<const HistoryStore::Visit*> HistoryStore::visitsInRange(qint64 fromMs, qint64 toMs) const
 {
-  const QString domainKey = normalizeDomainKey(domain);
-  const int resolvedLimit = qMax(0, limit);
-
-  QVector<const Entry*> matches;
-  matches.reserve(m_entries.size());
-
-  for (const Entry& e : m_entries) {
-    if (fromMs > 0 && e.visitedMs < fromMs) {
+  QVector<const Visit*> visits;
+  visits.reserve(m_visits.size());
+  for (const Visit& v : m_visits) {
+    if (fromMs > 0 && v.visitedMs < fromMs) {
       continue;
     }
-    if (toMs > 0 && e.visitedMs >= toMs) {
+    if (toMs > 0 && v.visitedMs >= toMs) {
       continue;
     }
-    if (!domainKey.isEmpty() && !hostMatchesDomain(e.url.host(), domainKey)) {
-      continue;
-    }
-    matches.push_back(&e);
+    visits.push_back(&v);
   }
 
-  std::sort(matches.begin(), matches.end(), [](const Entry* a, const Entry* b) {
+  std::sort(visits.begin(), visits.end(), [](const Visit* a, const Visit* b) {
     if (a->visitedMs != b->visitedMs) {
       return a->visitedMs > b->visitedMs;
     }
     return a->id > b->id;
   });
+  return visits;
+}
+
+QVariantList HistoryStore::query(const QString& domain, qint64 fromMs, qint64 toMs, int limit) const
+{
+  const QString domainKey = normalizeDomainKey(domain);
+  const int resolvedLimit = qMax(0, limit);
+
+  QVector<const Visit*> matches = visitsInRange(fromMs, toMs);
+  if (!domainKey.isEmpty()) {
+    const QVector<bool> pageMatches = pagesMatchingDomain(domainKey);
+    matches.erase(std::remove_if(matches.begin(), matches.end(), [&pageMatches](const Visit* v) {
+      return !pageMatches.at(v->pageId);
+    }), matches.end());
+  }
 
   if (resolvedLimit > 0 && matches.size() > resolvedLimit) {
     matches.resize(resolvedLimit);
@@ -390,14 +765,17 @@ QVariantList HistoryStore::query(const QString& domain, qint64 fromMs, qint64 to
   QVariantList out;
   out.reserve(matches.size());
 
-  for (const Entry* e : matches) {
+  for (const Visit* v : matches) {
+    const Page& page = HistoryStore::page(v->pageId);
     QVariantMap item;
-    item.insert(QStringLiteral("id"), e->id);
-    item.insert(QStringLiteral("title"), e->title);
-    item.insert(QStringLiteral("url"), e->url);
-    item.insert(QStringLiteral("visitedMs"), e->visitedMs);
-    item.insert(QStringLiteral("dayKey"), dayKeyForMs(e->visitedMs));
-    item.insert(QStringLiteral("host"), e->url.host());
+    item.insert(QStringLiteral("id"), v->id);
+    item.insert(QStringLiteral("title"), page.title);
+    item.insert(QStringLiteral("url"), page.url);
+    item.insert(QStringLiteral("visitedMs"), v->visitedMs);
+    item.insert(QStringLiteral("dayKey"), dayKeyForMs(v->visitedMs));
+    item.insert(QStringLiteral("visitCount"), v->count);
+    item.insert(QStringLiteral("firstVisitedMs"), v->firstVisitedMs());
+    item.insert(QStringLiteral("host"), page.url.host());
     out.push_back(item);
   }
 
@@ -414,24 +792,7 @@ bool HistoryStore::exportToCsv(const QString& filePath, qint64 fromMs, qint64 to
     return false;
   }
 
-  QVector<const Entry*> entries;
-  entries.reserve(m_entries.size());
-  for (const Entry& e : m_entries) {
-    if (fromMs > 0 && e.visitedMs < fromMs) {
-      continue;
-    }
-    if (toMs > 0 && e.visitedMs >= toMs) {
-      continue;
-    }
-    entries.push_back(&e);
-  }
-
-  std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b) {
-    if (a->visitedMs != b->visitedMs) {
-      return a->visitedMs > b->visitedMs;
-    }
-    return a->id > b->id;
-  });
+  const QVector<const Visit*> visits = visitsInRange(fromMs, toMs);
 
   QSaveFile out(path);
   if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) {
@@ -444,10 +805,10 @@ bool HistoryStore::exportToCsv(const QString& filePath, qint64 fromMs, qint64 to
   stream.setEncoding(QStringConverter::Utf8);
 #endif
 
-  stream << "visitedMs,title,url\n";
-  for (const Entry* e : entries) {
-    const QString urlText = e->url.toString(QUrl::FullyEncoded);
-    stream << e->visitedMs << ',' << escapeCsvField(e->title) << ',' << escapeCsvField(urlText) << '\n';
+  stream << "visitedMs,title,url,visitCount\n";
+  for (const Visit* v : visits) {
+    stream << v->visitedMs << ',' << escapeCsvField(pageTitle(v->pageId).toString()) << ',' << escapeCsvField(pageKey(v->pageId).toString())
+           << ',' << v->count << '\n';
   }
   stream.flush();
 
@@ -465,6 +826,105 @@ bool HistoryStore::exportToCsv(const QString& filePath, qint64 fromMs, qint64 to
   return true;
 }
 
+bool HistoryStore::exportToJson(const QString& filePath)
+{
+  setLastError({});
+
+  const QString path = normalizeUserFilePath(filePath);
+  if (path.isEmpty()) {
+    setLastError(QStringLiteral("No file path specified"));
+    return false;
+  }
+
+  QSaveFile out(path);
+  if (!out.open(QIODevice::WriteOnly)) {
+    setLastError(out.errorString());
+    return false;
+  }
+
+  out.write(toJson());
+  if (!out.commit()) {
+    setLastError(out.errorString());
+    return false;
+  }
+
+  return true;
+}
+
+int HistoryStore::applyRetention(qint64 nowMs)
+{
+  if (m_detailDays <= 0 && m_retentionDays <= 0) {
+    return 0;
+  }
+
+  const qint64 now = nowMs > 0 ? nowMs : QDateTime::currentMSecsSinceEpoch();
+  const qint64 detailCutoff = m_detailDays > 0 ? now - m_detailDays * kDayMs : std::numeric_limits<qint64>::min();
+  const qint64 pruneCutoff = m_retentionDays > 0 ? now - m_retentionDays * kDayMs : std::numeric_limits<qint64>::min();
+
+  // Rows are mostly in time order, so the local day of the previous row
+  // usually answers for the next one too.
+  qint64 dayStartMs = 0;
+  qint64 dayEndMs = 0;
+  qint64 day = 0;
+  const auto dayOf = [&](qint64 ms) {
+    if (ms < dayStartMs || ms >= dayEndMs) {
+      const QDate date = QDateTime::fromMSecsSinceEpoch(ms).date();
+      dayStartMs = date.startOfDay().toMSecsSinceEpoch();
+      dayEndMs = date.addDays(1).startOfDay().toMSecsSinceEpoch();
+      day = date.toJulianDay();
+    }
+    return day;
+  };
+
+  QVector<Visit> kept;
+  kept.reserve(m_visits.size());
+  QHash<QPair<int, qint64>, int> rowByPageDay;
+  QVector<int> released;
+
+  for (const Visit& v : std::as_const(m_visits)) {
+    if (v.visitedMs < pruneCutoff) {
+      released.push_back(v.pageId);
+      continue;
+    }
+    if (v.visitedMs >= detailCutoff) {
+      kept.push_back(v);
+      continue;
+    }
+
+    const QPair<int, qint64> pageDay(v.pageId, dayOf(v.visitedMs));
+    const auto it = rowByPageDay.constFind(pageDay);
+    if (it == rowByPageDay.constEnd()) {
+      rowByPageDay.insert(pageDay, kept.size());
+      kept.push_back(v);
+      continue;
+    }
+
+    // Folded into the page's first row of that day, which keeps its id.
+    Visit& row = kept[it.value()];
+    const qint64 firstMs = qMin(row.firstVisitedMs(), v.firstVisitedMs());
+    row.visitedMs = qMax(row.visitedMs, v.visitedMs);
+    row.spanMs = static_cast<qint32>(row.visitedMs - firstMs);
+    row.count += v.count;
+    released.push_back(v.pageId);
+  }
+
+  if (released.isEmpty()) {
+    return 0;
+  }
+
+  beginResetModel();
+  invalidateRowCaches();
+  m_visits = std::move(kept);
+  for (const int pageId : released) {
+    releasePage(pageId);
+  }
+  endResetModel();
+
+  emit countChanged();
+  scheduleSave();
+  return released.size();
+}
+
 void HistoryStore::reload()
 {
   load();
@@ -485,16 +945,20 @@ void HistoryStore::setLastError(const QString& error)
   emit lastErrorChanged();
 }
 
-bool HistoryStore::saveNow(QString* error) const
+QByteArray HistoryStore::toJson() const
 {
   QJsonArray arr;
 
-  for (const Entry& e : m_entries) {
+  for (const Visit& v : m_visits) {
     QJsonObject obj;
-    obj.insert(QStringLiteral("id"), e.id);
-    obj.insert(QStringLiteral("title"), e.title);
-    obj.insert(QStringLiteral("url"), e.url.toString(QUrl::FullyEncoded));
-    obj.insert(QStringLiteral("visitedMs"), static_cast<double>(e.visitedMs));
+    obj.insert(QStringLiteral("id"), v.id);
+    obj.insert(QStringLiteral("title"), pageTitle(v.pageId).toString());
+    obj.insert(QStringLiteral("url"), pageKey(v.pageId).toString());
+    obj.insert(QStringLiteral("visitedMs"), static_cast<double>(v.visitedMs));
+    if (v.count > 1) {
+      obj.insert(QStringLiteral("visitCount"), v.count);
+      obj.insert(QStringLiteral("firstVisitedMs"), static_cast<double>(v.firstVisitedMs()));
+    }
     arr.push_back(obj);
   }
 
@@ -502,39 +966,122 @@ bool HistoryStore::saveNow(QString* error) const
   root.insert(QStringLiteral("version"), 1);
   root.insert(QStringLiteral("nextId"), m_nextId);
   root.insert(QStringLiteral("history"), arr);
+  return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
 
-  QSaveFile out(storagePath());
-  if (!out.open(QIODevice::WriteOnly)) {
-    if (error) {
-      *error = out.errorString();
+bool HistoryStore::saveNow(QString* error) const
+{
+  // Pages are written in first-visit order, so the snapshot has no gaps
+  // where freed pages were.
+  HistorySnapshot::Builder builder;
+  QVector<int> snapshotPages(m_pages.size(), -1);
+  for (const Visit& v : m_visits) {
+    int& snapshotPage = snapshotPages[v.pageId];
+    if (snapshotPage < 0) {
+      snapshotPage = builder.addPage(pageKey(v.pageId), pageTitle(v.pageId), m_pages.at(v.pageId).lastVisitMs);
     }
-    return false;
+    builder.addVisit(v.id, snapshotPage, v.visitedMs, v.count, v.spanMs);
   }
 
-  out.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
-  if (!out.commit()) {
-    if (error) {
-      *error = out.errorString();
-    }
+  // The loaded snapshot may still map the file about to be replaced.
+  m_snapshot.detach();
+
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (!storage.write(kSnapshotName, builder.finish(m_nextId), error)) {
     return false;
   }
-
+  // Once imported, a leftover history.json would bring back deleted visits
+  // if the snapshot were ever lost.
+  if (storage.exists(kLegacyJsonName)) {
+    storage.remove(kLegacyJsonName);
+  }
   return true;
 }
 
 void HistoryStore::load()
 {
-  QFile f(storagePath());
-  if (!f.exists()) {
-    setLastError({});
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (storage.exists(kSnapshotName)) {
+    loadSnapshot();
     return;
   }
-  if (!f.open(QIODevice::ReadOnly)) {
-    setLastError(f.errorString());
+  if (storage.exists(kLegacyJsonName)) {
+    importLegacyJson();
     return;
   }
+  setLastError({});
+}
+
+bool HistoryStore::loadSnapshot()
+{
+  HistorySnapshot snapshot;
+  QString openError;
+  if (!snapshot.open(kSnapshotName, &openError)) {
+    setLastError(openError);
+    return false;
+  }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  beginResetModel();
+  invalidateRowCaches();
+  m_visits.clear();
+  resetPages();
+
+  const int visitCount = snapshot.visitCount();
+  const int pageCount = snapshot.pageCount();
+  m_visits.resize(visitCount);
+  m_pages.resize(pageCount);
+
+  int maxId = 0;
+  for (int row = 0; row < visitCount; ++row) {
+    Visit& visit = m_visits[row];
+    visit.id = snapshot.visitId(row);
+    visit.pageId = snapshot.visitPage(row);
+    visit.visitedMs = snapshot.visitTime(row);
+    visit.count = snapshot.rowVisits(row);
+    visit.spanMs = snapshot.visitSpanMs(row);
+    ++m_pages[visit.pageId].visitCount;
+    maxId = qMax(maxId, visit.id);
+  }
+
+  for (int pageId = 0; pageId < pageCount; ++pageId) {
+    Page& page = m_pages[pageId];
+    if (page.visitCount <= 0) {
+      m_freePageIds.push_back(pageId);
+      continue;
+    }
+    page.lastVisitMs = snapshot.pageLastVisitMs(pageId);
+    page.inSnapshot = true;
+    ++m_pageCount;
+  }
+
+  int nextId = snapshot.nextId();
+  m_snapshotPages = m_pageCount;
+  m_pageIndexReady = m_pageCount == 0;
+  if (m_snapshotPages > 0) {
+    m_snapshot = std::move(snapshot);
+  }
+
+  if (nextId <= maxId) {
+    nextId = maxId + 1;
+  }
+  m_nextId = qMax(1, nextId);
+  endResetModel();
+
+  emit countChanged();
+  setLastError({});
+  return true;
+}
+
+void HistoryStore::importLegacyJson()
+{
+  QByteArray payload;
+  QString readError;
+  if (!xbrowser::userDataStorage().read(kLegacyJsonName, &payload, &readError)) {
+    setLastError(readError);
+    return;
+  }
+
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
   if (!doc.isObject()) {
     setLastError(QStringLiteral("history.json is not a JSON object"));
     return;
@@ -543,8 +1090,11 @@ void HistoryStore::load()
   const QJsonObject root = doc.object();
   const QJsonArray arr = root.value(QStringLiteral("history")).toArray();
 
-  QVector<Entry> loaded;
-  loaded.reserve(arr.size());
+  beginResetModel();
+  invalidateRowCaches();
+  m_visits.clear();
+  resetPages();
+  m_visits.reserve(arr.size());
 
   int maxId = 0;
   for (const QJsonValue& v : arr) {
@@ -556,12 +1106,22 @@ void HistoryStore::load()
       continue;
     }
 
-    Entry e;
-    e.id = id;
-    e.url = url;
-    e.title = normalizeTitle(obj.value(QStringLiteral("title")).toString(), url);
-    e.visitedMs = static_cast<qint64>(obj.value(QStringLiteral("visitedMs")).toDouble());
-    loaded.push_back(e);
+    QString key = normalizeUrlKey(url);
+    if (key.isEmpty()) {
+      key = url.toString(QUrl::FullyEncoded);
+    }
+
+    Visit visit;
+    visit.id = id;
+    visit.pageId = acquirePage(url, key);
+    visit.visitedMs = static_cast<qint64>(obj.value(QStringLiteral("visitedMs")).toDouble());
+    visit.count = qMax(1, obj.value(QStringLiteral("visitCount")).toInt(1));
+    if (visit.count > 1) {
+      const qint64 firstMs = static_cast<qint64>(obj.value(QStringLiteral("firstVisitedMs")).toDouble());
+      visit.spanMs = static_cast<qint32>(qBound<qint64>(0, visit.visitedMs - firstMs, kDayMs));
+    }
+    touchPage(visit.pageId, normalizeTitle(obj.value(QStringLiteral("title")).toString(), url), visit.visitedMs);
+    m_visits.push_back(visit);
     maxId = qMax(maxId, id);
   }
 
@@ -569,12 +1129,12 @@ void HistoryStore::load()
   if (nextId <= maxId) {
     nextId = maxId + 1;
   }
-
-  beginResetModel();
-  m_entries = std::move(loaded);
   m_nextId = qMax(1, nextId);
   endResetModel();
 
   emit countChanged();
   setLastError({});
+
+  // Writes history.bin and drops history.json.
+  scheduleSave();
 }
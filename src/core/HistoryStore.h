@@ -1,16 +1,41 @@
 #pragma once
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QTimer>
 #include <QUrl>
 #include <QVariant>
 #include <QVector>
 
+#include <functional>
+
+#include "HistorySnapshot.h"
+
+// Browsing history as a list of visits. A visit only holds its timestamp
+// and the id of an interned page record, which owns the URL, its key and
+// the page's latest title, so revisiting a page does not copy them again.
+//
+// Saved as a HistorySnapshot. Loading one copies the visit columns and
+// leaves page strings in the mapped file until a row's title or URL is
+// first read; the key index is built on the first change. history.json
+// is only read to import a profile saved before snapshots existed.
+//
+// Rows are in the order visits were added. Browsing appends them in time
+// order, but an import appends older visits after newer ones, so the last
+// row is not necessarily the newest; newestVisitMs() is.
+//
+// Retention keeps the list bounded by recent activity: visits older than
+// detailDays collapse into one row per page and day, which carries the
+// number of visits and the first and last visit time, and rows older than
+// retentionDays are dropped. It runs shortly after loading and then a few
+// times a day.
 class HistoryStore final : public QAbstractListModel
 {
   Q_OBJECT
   Q_PROPERTY(int count READ count NOTIFY countChanged)
   Q_PROPERTY(QString lastError READ lastError NOTIFY lastErrorChanged)
+  Q_PROPERTY(int detailDays READ detailDays WRITE setDetailDays NOTIFY retentionChanged)
+  Q_PROPERTY(int retentionDays READ retentionDays WRITE setRetentionDays NOTIFY retentionChanged)
 
 public:
   enum Role
@@ -20,9 +45,23 @@ public:
     UrlRole,
     VisitedMsRole,
     DayKeyRole,
+    VisitCountRole,
+    FirstVisitedMsRole,
   };
   Q_ENUM(Role)
 
+  struct VisitRecord
+  {
+    QUrl url;
+    QString title;
+    qint64 visitedMs = 0;
+  };
+
+  static constexpr int kDefaultDetailDays = 90;
+  static constexpr int kDefaultRetentionDays = 730;
+  static constexpr int kRetentionDelayMs = 60 * 1000;
+  static constexpr int kRetentionIntervalMs = 6 * 60 * 60 * 1000;
+
   explicit HistoryStore(QObject* parent = nullptr);
 
   int rowCount(const QModelIndex& parent = QModelIndex()) const override;
@@ -30,9 +69,25 @@ public:
   QHash<int, QByteArray> roleNames() const override;
 
   int count() const;
+  // Distinct pages that still have at least one visit.
+  int pageCount() const;
+  // Latest visitedMs of any row, 0 when empty.
+  qint64 newestVisitMs() const;
   QString lastError() const;
 
+  // 0 turns the step off.
+  int detailDays() const;
+  void setDetailDays(int days);
+  int retentionDays() const;
+  void setRetentionDays(int days);
+
   Q_INVOKABLE void addVisit(const QUrl& url, const QString& title = {}, qint64 visitedMs = 0);
+  // Appends a batch, sorted by time, after the existing rows with one
+  // rowsInserted, one countChanged
+  // and one save. Visits without a time, repeats within the batch and
+  // visits already in history (same page and time) are skipped. Returns
+  // how many were added.
+  int addVisits(QVector<VisitRecord> visits);
   Q_INVOKABLE void removeAt(int index);
   Q_INVOKABLE void removeById(int historyId);
   Q_INVOKABLE int deleteByDomain(const QString& domain);
@@ -41,6 +96,11 @@ public:
 
   Q_INVOKABLE QVariantList query(const QString& domain, qint64 fromMs, qint64 toMs, int limit) const;
   Q_INVOKABLE bool exportToCsv(const QString& filePath, qint64 fromMs, qint64 toMs);
+  Q_INVOKABLE bool exportToJson(const QString& filePath);
+
+  // Collapses and prunes aged rows as of nowMs (now when 0). Returns how
+  // many rows went away.
+  Q_INVOKABLE int applyRetention(qint64 nowMs = 0);
 
   Q_INVOKABLE void reload();
   bool saveNow(QString* error = nullptr) const;
@@ -48,27 +108,82 @@ public:
 signals:
   void countChanged();
   void lastErrorChanged();
+  void retentionChanged();
 
 private:
-  struct Entry
+  struct Page
   {
-    int id = 0;
-    QString title;
     QUrl url;
+    QString key;
+    QString title;
+    qint64 lastVisitMs = 0;
+    int visitCount = 0;
+    // Strings still only in m_snapshot; key may already be filled in.
+    bool inSnapshot = false;
+  };
+
+  // A collapsed row has count > 1; visitedMs is its last visit and spanMs
+  // the distance back to its first, less than a day.
+  struct Visit
+  {
+    int id = 0;
+    int pageId = -1;
     qint64 visitedMs = 0;
+    int count = 1;
+    qint32 spanMs = 0;
+
+    qint64 firstVisitedMs() const { return visitedMs - spanMs; }
   };
 
   void scheduleSave();
   void load();
+  bool loadSnapshot();
+  void importLegacyJson();
+  QByteArray toJson() const;
   void setLastError(const QString& error);
 
+  const Page& page(int pageId) const;
+  QStringView pageKey(int pageId) const;
+  QStringView pageTitle(int pageId) const;
+  void ensurePageIndex();
+  int acquirePage(const QUrl& url, const QString& key);
+  bool touchPage(int pageId, const QString& title, qint64 visitedMs);
+  void releasePage(int pageId);
+  void resetPages();
+  void invalidateRowCaches();
+  void noteVisitTime(qint64 visitedMs);
+  void ensurePageRows();
+  void linkAppendedRow(int row);
+  void emitTitleChanged(int pageId);
+  int removeVisitsIf(const std::function<bool(const Visit&)>& shouldRemove);
+  QVector<bool> pagesMatchingDomain(const QString& domainKey) const;
+  QVector<const Visit*> visitsInRange(qint64 fromMs, qint64 toMs) const;
+
   int indexOfId(int historyId) const;
   static QString normalizeUrlKey(const QUrl& url);
   static QString normalizeTitle(const QString& title, const QUrl& url);
   static QString dayKeyForMs(qint64 ms);
 
-  QVector<Entry> m_entries;
+  QVector<Visit> m_visits;
+  mutable QVector<Page> m_pages;
+  QHash<QString, int> m_pageIdByKey;
+  QVector<int> m_freePageIds;
+  int m_pageCount = 0;
+  bool m_pageIndexReady = true;
+  mutable HistorySnapshot m_snapshot;
+  mutable int m_snapshotPages = 0;
+  // -1 until newestVisitMs() scans after rows went away.
+  mutable qint64 m_newestVisitMs = -1;
+  // Each page's rows linked newest to oldest, so a retitled page finds its
+  // rows without a scan. Appends extend it; removals drop it until the
+  // next title change rebuilds it.
+  QVector<int> m_previousRowOfPage;
+  QVector<int> m_lastRowByPage;
+  bool m_pageRowsReady = false;
   int m_nextId = 1;
+  int m_detailDays = kDefaultDetailDays;
+  int m_retentionDays = kDefaultRetentionDays;
   QString m_lastError;
   QTimer m_saveTimer;
+  QTimer m_retentionTimer;
 };
@@ -0,0 +1,228 @@
+#include "HistoryTextIndex.h"
+
+#include "HistoryStore.h"
+#include "UserDataStorage.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QVariantMap>
+
+HistoryTextIndex::HistoryTextIndex(QObject* parent)
+  : QObject(parent)
+  , m_index(std::make_shared<FullTextIndex>())
+{
+  // One worker keeps tasks in submission order, so an add is always visible
+  // to a search queued after it.
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(10000);
+
+  m_flushTimer.setSingleShot(true);
+  m_flushTimer.setInterval(kFlushDelayMs);
+  connect(&m_flushTimer, &QTimer::timeout, this, &HistoryTextIndex::flush);
+
+  m_pruneTimer.setSingleShot(true);
+  m_pruneTimer.setInterval(0);
+  connect(&m_pruneTimer, &QTimer::timeout, this, &HistoryTextIndex::pruneToHistory);
+
+  // Segments are files the index maps and merges itself, so a backend with
+  // nothing on disk leaves the index closed and page text is not kept.
+  const QString dir = indexDir();
+  if (!dir.isEmpty()) {
+    post([dir](FullTextIndex& index) {
+      index.open(dir);
+    });
+  }
+}
+
+HistoryTextIndex::~HistoryTextIndex()
+{
+  m_flushTimer.stop();
+  post([](FullTextIndex& index) {
+    index.flush();
+  });
+  m_pool.waitForDone();
+}
+
+QString HistoryTextIndex::indexDir()
+{
+  return xbrowser::userDataStorage().localPath(QStringLiteral("history_text"));
+}
+
+QString HistoryTextIndex::urlKey(const QUrl& url)
+{
+  const QString scheme = url.scheme();
+  if ((scheme != QStringLiteral("http") && scheme != QStringLiteral("https")) || url.host().isEmpty()) {
+    return {};
+  }
+
+  QUrl normalized = url.adjusted(QUrl::RemoveFragment | QUrl::NormalizePathSegments);
+  if (normalized.path().isEmpty()) {
+    normalized.setPath(QStringLiteral("/"));
+  }
+  return normalized.toString(QUrl::FullyEncoded);
+}
+
+HistoryStore* HistoryTextIndex::history() const
+{
+  return m_history;
+}
+
+void HistoryTextIndex::setHistory(HistoryStore* history)
+{
+  if (m_history == history) {
+    return;
+  }
+
+  if (m_history) {
+    disconnect(m_history, nullptr, this, nullptr);
+  }
+  m_history = history;
+  if (m_history) {
+    connect(m_history, &QAbstractItemModel::modelReset, this, [this] {
+      m_pruneTimer.start();
+    });
+    connect(m_history, &QAbstractItemModel::rowsRemoved, this, [this] {
+      m_pruneTimer.start();
+    });
+  }
+}
+
+int HistoryTextIndex::maxCaptureChars() const
+{
+  return kMaxCaptureChars;
+}
+
+void HistoryTextIndex::addPage(const QUrl& url, const QString& title, const QString& text, qint64 visitedMs)
+{
+  const QString key = urlKey(url);
+  if (key.isEmpty() || (title.trimmed().isEmpty() && text.trimmed().isEmpty())) {
+    return;
+  }
+
+  const QString body = text.left(kMaxCaptureChars);
+  const qint64 when = visitedMs > 0 ? visitedMs : QDateTime::currentMSecsSinceEpoch();
+  post([key, title, body, when](FullTextIndex& index) {
+    index.addDocument(key, title, body, when);
+  });
+  m_flushTimer.start();
+}
+
+void HistoryTextIndex::removePage(const QUrl& url)
+{
+  const QString key = urlKey(url);
+  if (key.isEmpty()) {
+    return;
+  }
+  post([key](FullTextIndex& index) {
+    index.removeDocument(key);
+  });
+}
+
+void HistoryTextIndex::clear()
+{
+  m_flushTimer.stop();
+  post([](FullTextIndex& index) {
+    index.clear();
+  });
+}
+
+void HistoryTextIndex::pruneToHistory()
+{
+  if (!m_history) {
+    return;
+  }
+
+  const int rows = m_history->rowCount();
+  if (rows == 0) {
+    clear();
+    return;
+  }
+
+  QSet<QString> keys;
+  keys.reserve(rows);
+  for (int row = 0; row < rows; ++row) {
+    const QString key = urlKey(m_history->index(row, 0).data(HistoryStore::UrlRole).toUrl());
+    if (!key.isEmpty()) {
+      keys.insert(key);
+    }
+  }
+  post([keys](FullTextIndex& index) {
+    index.retainOnly(keys);
+  });
+}
+
+int HistoryTextIndex::search(const QString& query, int limit)
+{
+  const int requestId = ++m_nextRequestId;
+  searchAsync(query, limit, this, [this, requestId, query](const QVector<FullTextIndex::Hit>& hits) {
+    QVariantList results;
+    results.reserve(hits.size());
+    for (const FullTextIndex::Hit& hit : hits) {
+      QVariantMap item;
+      item.insert(QStringLiteral("url"), QUrl(hit.key));
+      item.insert(QStringLiteral("title"), hit.title);
+      item.insert(QStringLiteral("visitedMs"), hit.visitedMs);
+      item.insert(QStringLiteral("score"), hit.score);
+      results.push_back(item);
+    }
+    emit searchFinished(requestId, query, results);
+  });
+  return requestId;
+}
+
+void HistoryTextIndex::searchAsync(const QString& query, int limit, QObject* context, SearchCallback callback)
+{
+  ++m_pending;
+  const std::shared_ptr<FullTextIndex> index = m_index;
+  m_pool.start([this, index, query, limit, context = QPointer<QObject>(context), callback = std::move(callback)] {
+    const QVector<FullTextIndex::Hit> hits = index->search(query, limit);
+    QMetaObject::invokeMethod(
+      this,
+      [this, hits, context, callback] {
+        m_pending = qMax(0, m_pending - 1);
+        if (context && callback) {
+          callback(hits);
+        }
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+void HistoryTextIndex::flush()
+{
+  m_flushTimer.stop();
+  post([](FullTextIndex& index) {
+    index.flush();
+  });
+}
+
+bool HistoryTextIndex::waitForIdle(int msecs)
+{
+  const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+  while (m_pending > 0) {
+    if (!m_pool.waitForDone(static_cast<int>(deadline.remainingTime()))) {
+      return false;
+    }
+    QCoreApplication::sendPostedEvents(this);
+    if (deadline.hasExpired() && m_pending > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HistoryTextIndex::post(std::function<void(FullTextIndex&)> task)
+{
+  ++m_pending;
+  const std::shared_ptr<FullTextIndex> index = m_index;
+  m_pool.start([this, index, task = std::move(task)] {
+    task(*index);
+    QMetaObject::invokeMethod(
+      this,
+      [this] {
+        m_pending = qMax(0, m_pending - 1);
+      },
+      Qt::QueuedConnection);
+  });
+}
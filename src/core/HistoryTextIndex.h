@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVariant>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+#include "FullTextIndex.h"
+
+class HistoryStore;
+
+// Full-text search over the text of visited pages. The index lives on a
+// single worker thread; every call here only queues work, and results come
+// back through searchFinished or a searchAsync callback on the GUI thread.
+// Pages are keyed by normalized URL, and deleting history drops the text of
+// every URL that no longer has a visit.
+// Segments live under the user-data storage's local path; with the
+// in-memory (incognito) backend nothing is indexed.
+class HistoryTextIndex final : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int maxCaptureChars READ maxCaptureChars CONSTANT)
+
+public:
+  using SearchCallback = std::function<void(const QVector<FullTextIndex::Hit>&)>;
+
+  static constexpr int kMaxCaptureChars = 64 * 1024;
+  static constexpr int kFlushDelayMs = 5000;
+
+  explicit HistoryTextIndex(QObject* parent = nullptr);
+  ~HistoryTextIndex() override;
+
+  static QString indexDir();
+  static QString urlKey(const QUrl& url);
+
+  HistoryStore* history() const;
+  void setHistory(HistoryStore* history);
+
+  int maxCaptureChars() const;
+
+  Q_INVOKABLE void addPage(const QUrl& url, const QString& title, const QString& text, qint64 visitedMs = 0);
+  Q_INVOKABLE void removePage(const QUrl& url);
+  Q_INVOKABLE void clear();
+  Q_INVOKABLE void pruneToHistory();
+
+  // Returns a request id that the matching searchFinished carries. Each
+  // result has url, title, visitedMs and score.
+  Q_INVOKABLE int search(const QString& query, int limit = 6);
+  void searchAsync(const QString& query, int limit, QObject* context, SearchCallback callback);
+
+  void flush();
+  bool waitForIdle(int msecs = -1);
+
+signals:
+  void searchFinished(int requestId, const QString& query, const QVariantList& results);
+
+private:
+  void post(std::function<void(FullTextIndex&)> task);
+
+  QThreadPool m_pool;
+  std::shared_ptr<FullTextIndex> m_index;
+  QPointer<HistoryStore> m_history;
+  QTimer m_flushTimer;
+  QTimer m_pruneTimer;
+  int m_pending = 0;
+  int m_nextRequestId = 0;
+};
@@ -0,0 +1,67 @@
+#include "HostPreresolver.h"
+
+#include <QDateTime>
+#include <QHostAddress>
+#include <QHostInfo>
+
+namespace
+{
+// Past this many remembered hosts the table is dropped and relearned.
+constexpr int kMaxRemembered = 512;
+}
+
+HostPreresolver::HostPreresolver(QObject* parent)
+  : QObject(parent)
+{
+}
+
+void HostPreresolver::preresolve(const QUrl& url)
+{
+  const QString scheme = url.scheme().toLower();
+  if (!url.isValid() || (scheme != QLatin1String("http") && scheme != QLatin1String("https"))) {
+    return;
+  }
+  const QString host = url.host().toLower();
+  if (host.isEmpty() || !QHostAddress(host).isNull() || m_queued.contains(host)) {
+    return;
+  }
+
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  const auto it = m_lookedUpAtMs.constFind(host);
+  if (it != m_lookedUpAtMs.constEnd() && now - it.value() < kRefreshMs) {
+    return;
+  }
+
+  // Predictions go stale as the user types; keep only the newest ones.
+  if (m_queue.size() >= kMaxQueued) {
+    m_queued.remove(m_queue.dequeue());
+  }
+  m_queue.enqueue(host);
+  m_queued.insert(host);
+  pump();
+}
+
+int HostPreresolver::lookupCount() const
+{
+  return m_lookupCount;
+}
+
+void HostPreresolver::pump()
+{
+  while (m_inFlight < kMaxInFlight && !m_queue.isEmpty()) {
+    const QString host = m_queue.dequeue();
+    m_queued.remove(host);
+
+    if (m_lookedUpAtMs.size() >= kMaxRemembered) {
+      m_lookedUpAtMs.clear();
+    }
+    m_lookedUpAtMs.insert(host, QDateTime::currentMSecsSinceEpoch());
+
+    ++m_inFlight;
+    ++m_lookupCount;
+    QHostInfo::lookupHost(host, this, [this](const QHostInfo&) {
+      --m_inFlight;
+      pump();
+    });
+  }
+}
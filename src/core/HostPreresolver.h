@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QUrl>
+
+// Looks up the hosts of predicted destinations before the user commits, so
+// the navigation finds them in the system and upstream resolver caches.
+// Runs in the browser process only: nothing reaches page content and no
+// request is sent to the destination. A host is looked up at most once
+// per kRefreshMs, with a few lookups in flight at a time.
+class HostPreresolver final : public QObject
+{
+  Q_OBJECT
+
+public:
+  static constexpr int kMaxInFlight = 4;
+  static constexpr int kMaxQueued = 16;
+  static constexpr qint64 kRefreshMs = 60LL * 1000LL;
+
+  explicit HostPreresolver(QObject* parent = nullptr);
+
+  Q_INVOKABLE void preresolve(const QUrl& url);
+
+  // Lookups started since construction.
+  int lookupCount() const;
+
+private:
+  void pump();
+
+  QQueue<QString> m_queue;
+  QSet<QString> m_queued;
+  QHash<QString, qint64> m_lookedUpAtMs;
+  int m_inFlight = 0;
+  int m_lookupCount = 0;
+};
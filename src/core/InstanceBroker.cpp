@@ -0,0 +1,177 @@
+#include "InstanceBroker.h"
+
+#include <QCryptographicHash>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QTimer>
+
+InstanceBroker::InstanceBroker(const QString& dataDir, QObject* parent)
+  : QObject(parent)
+  , m_serverName(serverNameFor(dataDir))
+{
+  m_server.setSocketOptions(QLocalServer::UserAccessOption);
+  connect(&m_server, &QLocalServer::newConnection, this, [this] {
+    while (QLocalSocket* socket = m_server.nextPendingConnection()) {
+      connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+      connect(socket, &QLocalSocket::readyRead, this, [this, socket] {
+        readRequest(socket);
+      });
+      // A client that never finishes its request is dropped.
+      QTimer::singleShot(kReplyTimeoutMs, socket, [socket] {
+        socket->abort();
+      });
+      readRequest(socket);
+    }
+  });
+}
+
+InstanceBroker::~InstanceBroker()
+{
+  m_server.close();
+}
+
+QString InstanceBroker::serverNameFor(const QString& dataDir)
+{
+  // Hashed so the name stays short and valid on every platform; on Unix it
+  // becomes a socket path under the temp dir.
+  QString canonical = QDir(dataDir).absolutePath();
+#if defined(Q_OS_WIN)
+  canonical = canonical.toLower();
+#endif
+  const QByteArray digest = QCryptographicHash::hash(canonical.toUtf8(), QCryptographicHash::Sha1).toHex().left(24);
+  return QStringLiteral("xbrowser-%1").arg(QString::fromLatin1(digest));
+}
+
+QString InstanceBroker::serverName() const
+{
+  return m_serverName;
+}
+
+bool InstanceBroker::listen(QString* error)
+{
+  if (m_server.isListening()) {
+    return true;
+  }
+
+  QLocalServer::removeServer(m_serverName);
+  if (!m_server.listen(m_serverName)) {
+    if (error) {
+      *error = m_server.errorString();
+    }
+    return false;
+  }
+  return true;
+}
+
+bool InstanceBroker::isListening() const
+{
+  return m_server.isListening();
+}
+
+bool InstanceBroker::forward(const QString& dataDir, const Request& request, QString* error)
+{
+  QLocalSocket socket;
+  socket.connectToServer(serverNameFor(dataDir));
+  if (!socket.waitForConnected(kConnectTimeoutMs)) {
+    if (error) {
+      *error = socket.errorString();
+    }
+    return false;
+  }
+
+  // The running instance may still be starting up, so allow it a moment to
+  // get to its event loop.
+  const QDeadlineTimer deadline(kReplyTimeoutMs);
+  socket.write(encodeRequest(request));
+  while (socket.bytesToWrite() > 0) {
+    if (!socket.waitForBytesWritten(static_cast<int>(deadline.remainingTime()))) {
+      if (error) {
+        *error = socket.errorString();
+      }
+      return false;
+    }
+  }
+
+  while (!socket.canReadLine()) {
+    if (deadline.hasExpired() || !socket.waitForReadyRead(static_cast<int>(deadline.remainingTime()))) {
+      if (error) {
+        *error = QStringLiteral("The running instance did not answer.");
+      }
+      return false;
+    }
+  }
+
+  const QByteArray reply = socket.readLine().trimmed();
+  if (reply != "ok") {
+    if (error) {
+      *error = QStringLiteral("The running instance rejected the request.");
+    }
+    return false;
+  }
+  return true;
+}
+
+QByteArray InstanceBroker::encodeRequest(const Request& request)
+{
+  QJsonObject root;
+  root.insert("version", kProtocolVersion);
+  root.insert("urls", QJsonArray::fromStringList(request.urls.mid(0, kMaxUrls)));
+  root.insert("newWindow", request.newWindow);
+  return QJsonDocument(root).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool InstanceBroker::decodeRequest(const QByteArray& line, Request* request)
+{
+  QJsonParseError parseError{};
+  const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+  if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+    return false;
+  }
+
+  const QJsonObject root = doc.object();
+  if (root.value("version").toInt() != kProtocolVersion) {
+    return false;
+  }
+
+  Request out;
+  const QJsonArray urls = root.value("urls").toArray();
+  for (const QJsonValue& value : urls) {
+    const QString url = value.toString().trimmed();
+    if (!url.isEmpty() && out.urls.size() < kMaxUrls) {
+      out.urls.push_back(url);
+    }
+  }
+  out.newWindow = root.value("newWindow").toBool(false);
+
+  if (request) {
+    *request = out;
+  }
+  return true;
+}
+
+void InstanceBroker::readRequest(QLocalSocket* socket)
+{
+  // One request per connection; anything after it is ignored.
+  if (socket->state() != QLocalSocket::ConnectedState) {
+    return;
+  }
+  if (!socket->canReadLine()) {
+    if (socket->bytesAvailable() > kMaxRequestBytes) {
+      socket->abort();
+    }
+    return;
+  }
+
+  Request request;
+  const bool accepted = decodeRequest(socket->readLine(kMaxRequestBytes + 1).trimmed(), &request);
+  socket->write(accepted ? "ok\n" : "error\n");
+  socket->disconnectFromServer();
+
+  if (accepted) {
+    emit requestReceived(request.urls, request.newWindow);
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QByteArray>
+#include <QLocalServer>
+#include <QObject>
+#include <QStringList>
+
+class QLocalSocket;
+
+// Single-instance handoff for one profile. The instance holding the profile
+// lock listens on a local socket named after the data dir; a second launch
+// on the same profile forwards its URLs over it and exits instead of
+// starting a browser of its own.
+//
+// The wire format is one JSON object per connection, terminated by a
+// newline, answered with "ok\n" once the running instance has accepted it.
+class InstanceBroker final : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Request
+  {
+    QStringList urls;
+    bool newWindow = false;
+  };
+
+  static constexpr int kProtocolVersion = 1;
+  static constexpr int kConnectTimeoutMs = 250;
+  static constexpr int kReplyTimeoutMs = 3000;
+  static constexpr int kMaxRequestBytes = 256 * 1024;
+  static constexpr int kMaxUrls = 100;
+
+  explicit InstanceBroker(const QString& dataDir, QObject* parent = nullptr);
+  ~InstanceBroker() override;
+
+  static QString serverNameFor(const QString& dataDir);
+  QString serverName() const;
+
+  // Only call this while holding the profile lock: a leftover socket from a
+  // crashed instance is removed first.
+  bool listen(QString* error = nullptr);
+  bool isListening() const;
+
+  // Client side. Returns true once a running instance acknowledged the
+  // request; false when nobody is listening or it did not answer in time.
+  static bool forward(const QString& dataDir, const Request& request, QString* error = nullptr);
+
+  static QByteArray encodeRequest(const Request& request);
+  static bool decodeRequest(const QByteArray& line, Request* request);
+
+signals:
+  void requestReceived(const QStringList& urls, bool newWindow);
+
+private:
+  void readRequest(QLocalSocket* socket);
+
+  QString m_serverName;
+  QLocalServer m_server;
+};
@@ -22,11 +22,18 @@ void LayoutController::setSettings(AppSettings* settings)
     disconnect(m_settings, nullptr, this, nullptr);
   }
 
+  cancelSidebarResize();
   m_settings = settings;
   emit settingsChanged();
+  emit sidebarWidthChanged();
 
   if (m_settings) {
-    connect(m_settings, &AppSettings::sidebarWidthChanged, this, &LayoutController::recompute);
+    connect(m_settings, &AppSettings::sidebarWidthChanged, this, [this] {
+      if (!m_sidebarResizing) {
+        emit sidebarWidthChanged();
+      }
+      recompute();
+    });
     connect(m_settings, &AppSettings::sidebarExpandedChanged, this, &LayoutController::recompute);
     connect(m_settings, &AppSettings::addressBarVisibleChanged, this, &LayoutController::recompute);
     connect(m_settings, &AppSettings::compactModeChanged, this, &LayoutController::recompute);
@@ -173,13 +180,79 @@ bool LayoutController::sidebarIconOnly() const
   return m_sidebarIconOnly;
 }
 
+int LayoutController::sidebarWidth() const
+{
+  if (m_sidebarResizing) {
+    return m_liveSidebarWidth;
+  }
+  return m_settings ? m_settings->sidebarWidth() : 260;
+}
+
+bool LayoutController::sidebarResizing() const
+{
+  return m_sidebarResizing;
+}
+
+void LayoutController::beginSidebarResize()
+{
+  if (m_sidebarResizing) {
+    return;
+  }
+  m_liveSidebarWidth = sidebarWidth();
+  m_sidebarResizing = true;
+  emit sidebarResizingChanged();
+}
+
+void LayoutController::updateSidebarResize(int width)
+{
+  if (!m_sidebarResizing) {
+    return;
+  }
+
+  const int next = qBound(AppSettings::kMinSidebarWidth, width, AppSettings::kMaxSidebarWidth);
+  if (m_liveSidebarWidth == next) {
+    return;
+  }
+  m_liveSidebarWidth = next;
+  emit sidebarWidthChanged();
+  recompute();
+}
+
+void LayoutController::commitSidebarResize()
+{
+  if (!m_sidebarResizing) {
+    return;
+  }
+
+  m_sidebarResizing = false;
+  emit sidebarResizingChanged();
+  if (m_settings && m_settings->sidebarWidth() != m_liveSidebarWidth) {
+    m_settings->setSidebarWidth(m_liveSidebarWidth);
+  }
+}
+
+void LayoutController::cancelSidebarResize()
+{
+  if (!m_sidebarResizing) {
+    return;
+  }
+
+  m_sidebarResizing = false;
+  const bool moved = m_liveSidebarWidth != sidebarWidth();
+  emit sidebarResizingChanged();
+  if (moved) {
+    emit sidebarWidthChanged();
+    recompute();
+  }
+}
+
 void LayoutController::recompute()
 {
   const bool addressBarVisible = m_settings ? m_settings->addressBarVisible() : true;
   const bool sidebarExpanded = m_settings ? m_settings->sidebarExpanded() : true;
   const bool useSingleToolbar = m_settings ? m_settings->useSingleToolbar() : false;
   const bool compactMode = m_settings ? m_settings->compactMode() : false;
-  const int sidebarWidth = m_settings ? m_settings->sidebarWidth() : 260;
+  const int sidebarWidth = this->sidebarWidth();
 
   const bool effectiveCompact = compactMode || m_fullscreen;
   const bool nextSidebarIconOnly = sidebarExpanded && sidebarWidth <= 200;
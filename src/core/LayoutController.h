@@ -23,6 +23,12 @@ class LayoutController final : public QObject
   Q_PROPERTY(bool showSidebar READ showSidebar NOTIFY showSidebarChanged)
   Q_PROPERTY(bool sidebarIconOnly READ sidebarIconOnly NOTIFY sidebarIconOnlyChanged)
 
+  // The width the sidebar is laid out at. Follows the pointer while a resize
+  // is in progress; AppSettings (and through it the workspace and session)
+  // only sees the final width.
+  Q_PROPERTY(int sidebarWidth READ sidebarWidth NOTIFY sidebarWidthChanged)
+  Q_PROPERTY(bool sidebarResizing READ sidebarResizing NOTIFY sidebarResizingChanged)
+
 public:
   explicit LayoutController(QObject* parent = nullptr);
 
@@ -57,6 +63,14 @@ public:
   bool showSidebar() const;
   bool sidebarIconOnly() const;
 
+  int sidebarWidth() const;
+  bool sidebarResizing() const;
+
+  Q_INVOKABLE void beginSidebarResize();
+  Q_INVOKABLE void updateSidebarResize(int width);
+  Q_INVOKABLE void commitSidebarResize();
+  Q_INVOKABLE void cancelSidebarResize();
+
 signals:
   void settingsChanged();
 
@@ -72,6 +86,8 @@ signals:
   void showTopBarChanged();
   void showSidebarChanged();
   void sidebarIconOnlyChanged();
+  void sidebarWidthChanged();
+  void sidebarResizingChanged();
 
 private:
   void recompute();
@@ -89,4 +105,7 @@ private:
   bool m_showTopBar = true;
   bool m_showSidebar = true;
   bool m_sidebarIconOnly = false;
+
+  bool m_sidebarResizing = false;
+  int m_liveSidebarWidth = 260;
 };
@@ -8,6 +8,10 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QSaveFile>
+#include <QSet>
+#include <QVariantMap>
+
+#include <algorithm>
 
 namespace
 {
@@ -36,7 +40,6 @@ ModsModel::ModsModel(QObject* parent)
   });
 
   load();
-  rebuildCombinedCss();
 }
 
 int ModsModel::rowCount(const QModelIndex& parent) const
@@ -78,11 +81,6 @@ QHash<int, QByteArray> ModsModel::roleNames() const
   };
 }
 
-QString ModsModel::combinedCss() const
-{
-  return m_combinedCss;
-}
-
 QString ModsModel::lastError() const
 {
   return m_lastError;
@@ -103,11 +101,12 @@ int ModsModel::addMod(const QString& name, const QString& css)
   entry.name = normalizeName(name);
   entry.enabled = true;
   entry.css = css;
+  entry.compiled = UserCssCompiler::compile(css);
   m_entries.push_back(entry);
 
   endInsertRows();
 
-  rebuildCombinedCss();
+  notifyStylesChanged({}, entry.compiled);
   scheduleSave();
   return index;
 }
@@ -118,11 +117,15 @@ void ModsModel::removeMod(int index)
     return;
   }
 
+  const Entry removed = m_entries.at(index);
+
   beginRemoveRows({}, index, index);
   m_entries.removeAt(index);
   endRemoveRows();
 
-  rebuildCombinedCss();
+  if (removed.enabled) {
+    notifyStylesChanged(removed.compiled, {});
+  }
   scheduleSave();
 }
 
@@ -189,7 +192,11 @@ void ModsModel::setEnabledAt(int index, bool enabled)
   entry.enabled = enabled;
   emit dataChanged(this->index(index), this->index(index), {EnabledRole});
 
-  rebuildCombinedCss();
+  if (enabled) {
+    notifyStylesChanged({}, entry.compiled);
+  } else {
+    notifyStylesChanged(entry.compiled, {});
+  }
   scheduleSave();
 }
 
@@ -204,13 +211,85 @@ void ModsModel::setCssAt(int index, const QString& css)
     return;
   }
 
+  const UserCssCompiler::CompiledMod before = entry.compiled;
   entry.css = css;
+  entry.compiled = UserCssCompiler::compile(css);
   emit dataChanged(this->index(index), this->index(index), {CssRole});
 
-  rebuildCombinedCss();
+  if (entry.enabled) {
+    notifyStylesChanged(before, entry.compiled);
+  }
   scheduleSave();
 }
 
+QVariantList ModsModel::sheetsForUrl(const QUrl& url) const
+{
+  QVariantList out;
+  const QStringList suffixes = UserCssCompiler::hostSuffixes(url.host());
+
+  for (const Entry& entry : m_entries) {
+    if (!entry.enabled) {
+      continue;
+    }
+
+    const UserCssCompiler::CompiledMod& mod = entry.compiled;
+    QVector<int> matched;
+    for (const QString& host : suffixes) {
+      const auto it = mod.hostIndex.constFind(host);
+      if (it == mod.hostIndex.constEnd()) {
+        continue;
+      }
+      for (int idx : it.value()) {
+        if (!matched.contains(idx) && UserCssCompiler::blockMatches(mod.blocks.at(idx), url)) {
+          matched.push_back(idx);
+        }
+      }
+    }
+    for (int idx : mod.unindexedBlocks) {
+      if (UserCssCompiler::blockMatches(mod.blocks.at(idx), url)) {
+        matched.push_back(idx);
+      }
+    }
+
+    if (mod.globalCss.isEmpty() && matched.isEmpty()) {
+      continue;
+    }
+    std::sort(matched.begin(), matched.end());
+
+    QString css = mod.globalCss;
+    QByteArray digest = mod.globalHash;
+    for (int idx : matched) {
+      const UserCssCompiler::Block& block = mod.blocks.at(idx);
+      css.append(block.css);
+      digest.append(',');
+      digest.append(block.hash);
+    }
+
+    QVariantMap sheet;
+    sheet.insert("id", QStringLiteral("mod-%1").arg(entry.id));
+    sheet.insert("hash", QString::fromLatin1(matched.isEmpty() ? mod.globalHash : UserCssCompiler::contentHash(QString::fromLatin1(digest))));
+    sheet.insert("css", css);
+    out.push_back(sheet);
+  }
+
+  return out;
+}
+
+bool ModsModel::urlMatchesHosts(const QUrl& url, const QStringList& hosts) const
+{
+  if (hosts.isEmpty()) {
+    return false;
+  }
+
+  const QStringList suffixes = UserCssCompiler::hostSuffixes(url.host());
+  for (const QString& suffix : suffixes) {
+    if (hosts.contains(suffix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ModsModel::load()
 {
   QFile f(storagePath());
@@ -246,6 +325,7 @@ void ModsModel::load()
     entry.name = normalizeName(obj.value("name").toString());
     entry.enabled = obj.value("enabled").toBool(false);
     entry.css = obj.value("css").toString();
+    entry.compiled = UserCssCompiler::compile(entry.css);
     loaded.push_back(entry);
     maxId = qMax(maxId, id);
   }
@@ -301,29 +381,32 @@ bool ModsModel::saveNow(QString* error)
   return true;
 }
 
-void ModsModel::rebuildCombinedCss()
+void ModsModel::notifyStylesChanged(const UserCssCompiler::CompiledMod& before,
+                                    const UserCssCompiler::CompiledMod& after)
 {
-  QString combined;
-  for (const Entry& entry : m_entries) {
-    if (!entry.enabled) {
-      continue;
-    }
-    const QString css = entry.css.trimmed();
-    if (css.isEmpty()) {
-      continue;
-    }
-    if (!combined.isEmpty()) {
-      combined.append(QStringLiteral("\n\n"));
+  const bool allHosts = before.globalDigest() != after.globalDigest();
+
+  QSet<QString> candidates;
+  for (const QString& host : before.hosts()) {
+    candidates.insert(host);
+  }
+  for (const QString& host : after.hosts()) {
+    candidates.insert(host);
+  }
+
+  QStringList hosts;
+  for (const QString& host : candidates) {
+    if (before.digestForHost(host) != after.digestForHost(host)) {
+      hosts.push_back(host);
     }
-    combined.append(css);
   }
 
-  if (m_combinedCss == combined) {
+  if (!allHosts && hosts.isEmpty()) {
     return;
   }
 
-  m_combinedCss = combined;
-  emit combinedCssChanged();
+  hosts.sort();
+  emit stylesChanged(hosts, allHosts);
 }
 
 void ModsModel::setLastError(const QString& error)
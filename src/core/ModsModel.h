@@ -1,12 +1,15 @@
 #pragma once
 
+#include "UserCssCompiler.h"
+
 #include <QAbstractListModel>
 #include <QTimer>
+#include <QUrl>
+#include <QVariantList>
 
 class ModsModel : public QAbstractListModel
 {
   Q_OBJECT
-  Q_PROPERTY(QString combinedCss READ combinedCss NOTIFY combinedCssChanged)
   Q_PROPERTY(QString lastError READ lastError NOTIFY lastErrorChanged)
 
 public:
@@ -25,7 +28,6 @@ public:
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
   QHash<int, QByteArray> roleNames() const override;
 
-  QString combinedCss() const;
   QString lastError() const;
 
   Q_INVOKABLE int count() const;
@@ -41,8 +43,11 @@ public:
   Q_INVOKABLE void setEnabledAt(int index, bool enabled);
   Q_INVOKABLE void setCssAt(int index, const QString& css);
 
+  Q_INVOKABLE QVariantList sheetsForUrl(const QUrl& url) const;
+  Q_INVOKABLE bool urlMatchesHosts(const QUrl& url, const QStringList& hosts) const;
+
 signals:
-  void combinedCssChanged();
+  void stylesChanged(const QStringList& hosts, bool allHosts);
   void lastErrorChanged();
 
 private:
@@ -52,20 +57,21 @@ private:
     QString name;
     bool enabled = false;
     QString css;
+    UserCssCompiler::CompiledMod compiled;
   };
 
   void load();
   void scheduleSave();
   bool saveNow(QString* error = nullptr);
 
-  void rebuildCombinedCss();
+  void notifyStylesChanged(const UserCssCompiler::CompiledMod& before,
+                           const UserCssCompiler::CompiledMod& after);
   void setLastError(const QString& error);
 
   QVector<Entry> m_entries;
   int m_nextId = 1;
 
   QTimer m_saveTimer;
-  QString m_combinedCss;
   QString m_lastError;
 };
 
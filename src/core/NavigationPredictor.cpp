@@ -0,0 +1,417 @@
+#include "NavigationPredictor.h"
+
+#include "HistoryStore.h"
+#include "UserDataStorage.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace
+{
+constexpr int kPreconnectMinHits = 2;
+constexpr double kPreconnectMinConfidence = 0.25;
+constexpr int kPrerenderMinHits = 4;
+constexpr double kPrerenderMinConfidence = 0.6;
+
+const QString kStorageName = QStringLiteral("navigation_predictions.json");
+
+QString pageKey(const QUrl& url)
+{
+  const QString scheme = url.scheme();
+  if ((scheme != QStringLiteral("http") && scheme != QStringLiteral("https")) || url.host().isEmpty()) {
+    return {};
+  }
+
+  QUrl normalized = url.adjusted(QUrl::RemoveFragment | QUrl::NormalizePathSegments);
+  if (normalized.path().isEmpty()) {
+    normalized.setPath(QStringLiteral("/"));
+  }
+  return normalized.toString(QUrl::FullyEncoded);
+}
+
+QString typedKey(const QString& text)
+{
+  QString key = text.trimmed().toLower();
+  for (const QLatin1StringView scheme : { QLatin1StringView("https://"), QLatin1StringView("http://") }) {
+    if (key.startsWith(scheme)) {
+      key.remove(0, scheme.size());
+      break;
+    }
+  }
+  if (key.startsWith(QLatin1StringView("www."))) {
+    key.remove(0, 4);
+  }
+  return key.left(NavigationPredictor::kMaxTypedPrefixLength);
+}
+}
+
+NavigationPredictor::NavigationPredictor(QObject* parent)
+  : QObject(parent)
+{
+  m_saveTimer.setSingleShot(true);
+  m_saveTimer.setInterval(1000);
+  connect(&m_saveTimer, &QTimer::timeout, this, [this] {
+    saveNow();
+  });
+
+  m_pruneTimer.setSingleShot(true);
+  m_pruneTimer.setInterval(0);
+  connect(&m_pruneTimer, &QTimer::timeout, this, &NavigationPredictor::pruneToHistory);
+
+  load();
+}
+
+HistoryStore* NavigationPredictor::history() const
+{
+  return m_history;
+}
+
+void NavigationPredictor::setHistory(HistoryStore* history)
+{
+  if (m_history == history) {
+    return;
+  }
+
+  if (m_history) {
+    disconnect(m_history, nullptr, this, nullptr);
+  }
+  m_history = history;
+  if (m_history) {
+    // Deleting history must also forget the transitions learned from it.
+    // Removals often come in bursts, so the prune is coalesced.
+    connect(m_history, &QAbstractItemModel::modelReset, this, [this] {
+      m_pruneTimer.start();
+    });
+    connect(m_history, &QAbstractItemModel::rowsRemoved, this, [this] {
+      m_pruneTimer.start();
+    });
+  }
+}
+
+void NavigationPredictor::recordNavigation(const QUrl& from, const QUrl& to)
+{
+  const QString sourceKey = pageKey(from);
+  const QString targetKey = pageKey(to);
+  if (sourceKey.isEmpty() || targetKey.isEmpty() || sourceKey == targetKey) {
+    return;
+  }
+
+  ++m_tick;
+  record(m_next, sourceKey, targetKey);
+  evictStaleSources(m_next);
+  scheduleSave();
+}
+
+void NavigationPredictor::recordTypedNavigation(const QString& typed, const QUrl& to)
+{
+  const QString key = typedKey(typed);
+  const QString targetKey = pageKey(to);
+  if (key.isEmpty() || targetKey.isEmpty()) {
+    return;
+  }
+
+  // Every prefix of what was typed leads to the destination, so the
+  // prediction is available from the first keystroke next time.
+  ++m_tick;
+  for (int length = 1; length <= key.size(); ++length) {
+    record(m_typed, key.left(length), targetKey);
+  }
+  evictStaleSources(m_typed);
+  scheduleSave();
+}
+
+void NavigationPredictor::record(Table& table, const QString& sourceKey, const QString& targetKey)
+{
+  Source& source = table[sourceKey];
+  source.lastTick = m_tick;
+  ++source.observations;
+
+  auto it = std::find_if(source.targets.begin(), source.targets.end(),
+                         [&targetKey](const Target& t) { return t.url == targetKey; });
+  if (it != source.targets.end()) {
+    ++it->hits;
+    it->lastTick = m_tick;
+  } else if (source.targets.size() < kMaxTargetsPerSource) {
+    source.targets.push_back({ targetKey, 1, m_tick });
+  } else {
+    // The weakest (then oldest) destination makes room. Its hits stay in
+    // `observations`, so confidences keep reflecting what was evicted.
+    auto weakest = std::min_element(source.targets.begin(), source.targets.end(), [](const Target& a, const Target& b) {
+      return a.hits != b.hits ? a.hits < b.hits : a.lastTick < b.lastTick;
+    });
+    *weakest = { targetKey, 1, m_tick };
+  }
+
+  // Halving keeps old habits from outweighing new ones forever.
+  if (source.observations >= kDecayObservations) {
+    int remaining = 0;
+    for (Target& t : source.targets) {
+      t.hits /= 2;
+      remaining += t.hits;
+    }
+    source.targets.erase(std::remove_if(source.targets.begin(), source.targets.end(),
+                                        [](const Target& t) { return t.hits <= 0; }),
+                         source.targets.end());
+    source.observations = qMax(remaining, source.observations / 2);
+  }
+}
+
+void NavigationPredictor::evictStaleSources(Table& table)
+{
+  if (table.size() <= kMaxSources) {
+    return;
+  }
+
+  // Evict in batches so a full table does not pay for a sort per visit.
+  QVector<QPair<quint64, QString>> ages;
+  ages.reserve(table.size());
+  for (auto it = table.cbegin(); it != table.cend(); ++it) {
+    ages.push_back({ it.value().lastTick, it.key() });
+  }
+  std::sort(ages.begin(), ages.end());
+
+  const int excess = table.size() - kMaxSources + kMaxSources / 8;
+  for (int i = 0; i < excess && i < ages.size(); ++i) {
+    table.remove(ages.at(i).second);
+  }
+}
+
+QVector<NavigationPredictor::Prediction> NavigationPredictor::predict(const Table& table, const QString& sourceKey,
+                                                                      int limit) const
+{
+  if (sourceKey.isEmpty() || limit <= 0) {
+    return {};
+  }
+
+  const auto it = table.constFind(sourceKey);
+  if (it == table.cend() || it.value().observations <= 0) {
+    return {};
+  }
+
+  QVector<Target> targets = it.value().targets;
+  std::sort(targets.begin(), targets.end(), [](const Target& a, const Target& b) {
+    if (a.hits != b.hits) {
+      return a.hits > b.hits;
+    }
+    if (a.lastTick != b.lastTick) {
+      return a.lastTick > b.lastTick;
+    }
+    return a.url < b.url;
+  });
+
+  QVector<Prediction> out;
+  const double observations = it.value().observations;
+  for (int i = 0; i < targets.size() && i < limit; ++i) {
+    Prediction p;
+    p.url = QUrl(targets.at(i).url);
+    p.hits = targets.at(i).hits;
+    p.confidence = qMin(1.0, p.hits / observations);
+    out.push_back(p);
+  }
+  return out;
+}
+
+QVector<NavigationPredictor::Prediction> NavigationPredictor::predictionsAfter(const QUrl& url, int limit) const
+{
+  return predict(m_next, pageKey(url), limit);
+}
+
+QVector<NavigationPredictor::Prediction> NavigationPredictor::predictionsForInput(const QString& text, int limit) const
+{
+  return predict(m_typed, typedKey(text), limit);
+}
+
+QString NavigationPredictor::warmUpHint(const Prediction& prediction)
+{
+  if (prediction.hits >= kPrerenderMinHits && prediction.confidence >= kPrerenderMinConfidence) {
+    return QStringLiteral("prerender");
+  }
+  if (prediction.hits >= kPreconnectMinHits && prediction.confidence >= kPreconnectMinConfidence) {
+    return QStringLiteral("preconnect");
+  }
+  return {};
+}
+
+QVariantList NavigationPredictor::toVariantList(const QVector<Prediction>& predictions)
+{
+  QVariantList out;
+  out.reserve(predictions.size());
+  for (const Prediction& p : predictions) {
+    out.push_back(QVariantMap {
+      { QStringLiteral("url"), p.url },
+      { QStringLiteral("confidence"), p.confidence },
+      { QStringLiteral("hits"), p.hits },
+      { QStringLiteral("hint"), warmUpHint(p) },
+    });
+  }
+  return out;
+}
+
+QVariantList NavigationPredictor::predictNext(const QUrl& url, int limit) const
+{
+  return toVariantList(predictionsAfter(url, limit));
+}
+
+QVariantList NavigationPredictor::predictForInput(const QString& text, int limit) const
+{
+  return toVariantList(predictionsForInput(text, limit));
+}
+
+void NavigationPredictor::clear()
+{
+  if (m_next.isEmpty() && m_typed.isEmpty()) {
+    return;
+  }
+
+  m_next.clear();
+  m_typed.clear();
+  m_tick = 0;
+  scheduleSave();
+}
+
+void NavigationPredictor::pruneTable(Table& table, const QSet<QString>& known, bool pruneSources)
+{
+  for (auto it = table.begin(); it != table.end();) {
+    if (pruneSources && !known.contains(it.key())) {
+      it = table.erase(it);
+      continue;
+    }
+
+    Source& source = it.value();
+    for (int i = source.targets.size() - 1; i >= 0; --i) {
+      if (!known.contains(source.targets.at(i).url)) {
+        source.observations -= source.targets.at(i).hits;
+        source.targets.removeAt(i);
+      }
+    }
+
+    if (source.targets.isEmpty()) {
+      it = table.erase(it);
+    } else {
+      source.observations = qMax(source.observations, 1);
+      ++it;
+    }
+  }
+}
+
+void NavigationPredictor::pruneToHistory()
+{
+  m_pruneTimer.stop();
+  if (!m_history) {
+    return;
+  }
+
+  const int rows = m_history->rowCount();
+  if (rows == 0) {
+    clear();
+    return;
+  }
+
+  QSet<QString> known;
+  known.reserve(rows);
+  for (int row = 0; row < rows; ++row) {
+    const QString key = pageKey(m_history->index(row, 0).data(HistoryStore::UrlRole).toUrl());
+    if (!key.isEmpty()) {
+      known.insert(key);
+    }
+  }
+
+  const int before = sourceCount();
+  pruneTable(m_next, known, true);
+  pruneTable(m_typed, known, false);
+  if (sourceCount() != before) {
+    scheduleSave();
+  }
+}
+
+int NavigationPredictor::sourceCount() const
+{
+  return m_next.size() + m_typed.size();
+}
+
+void NavigationPredictor::scheduleSave()
+{
+  m_saveTimer.start();
+}
+
+bool NavigationPredictor::saveNow(QString* error) const
+{
+  // Sorted so the same model always serializes to the same bytes.
+  const auto serialize = [](const Table& table) {
+    QStringList keys = table.keys();
+    keys.sort();
+
+    QJsonArray arr;
+    for (const QString& key : keys) {
+      const Source& source = table.value(key);
+      if (source.targets.isEmpty()) {
+        continue;
+      }
+      QJsonArray targets;
+      for (const Target& t : source.targets) {
+        targets.push_back(QJsonArray { t.url, t.hits, static_cast<double>(t.lastTick) });
+      }
+      arr.push_back(QJsonArray { key, source.observations, static_cast<double>(source.lastTick), targets });
+    }
+    return arr;
+  };
+
+  QJsonObject root;
+  root.insert(QStringLiteral("version"), 1);
+  root.insert(QStringLiteral("tick"), static_cast<double>(m_tick));
+  root.insert(QStringLiteral("next"), serialize(m_next));
+  root.insert(QStringLiteral("typed"), serialize(m_typed));
+
+  return xbrowser::userDataStorage().write(kStorageName, QJsonDocument(root).toJson(QJsonDocument::Compact), error);
+}
+
+void NavigationPredictor::load()
+{
+  QByteArray payload;
+  if (!xbrowser::userDataStorage().read(kStorageName, &payload)) {
+    return;
+  }
+
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
+  if (!doc.isObject()) {
+    return;
+  }
+
+  const QJsonObject root = doc.object();
+  const auto deserialize = [](const QJsonArray& arr, Table& table) {
+    for (const QJsonValue& v : arr) {
+      const QJsonArray entry = v.toArray();
+      const QString key = entry.at(0).toString();
+      if (key.isEmpty()) {
+        continue;
+      }
+
+      Source source;
+      source.observations = entry.at(1).toInt();
+      source.lastTick = static_cast<quint64>(entry.at(2).toDouble());
+      int hits = 0;
+      for (const QJsonValue& tv : entry.at(3).toArray()) {
+        const QJsonArray t = tv.toArray();
+        const QString url = t.at(0).toString();
+        if (url.isEmpty() || t.at(1).toInt() <= 0 || source.targets.size() >= kMaxTargetsPerSource) {
+          continue;
+        }
+        source.targets.push_back({ url, t.at(1).toInt(), static_cast<quint64>(t.at(2).toDouble()) });
+        hits += t.at(1).toInt();
+      }
+      if (source.targets.isEmpty()) {
+        continue;
+      }
+      source.observations = qMax(source.observations, hits);
+      table.insert(key, source);
+    }
+  };
+
+  deserialize(root.value(QStringLiteral("next")).toArray(), m_next);
+  deserialize(root.value(QStringLiteral("typed")).toArray(), m_typed);
+  m_tick = static_cast<quint64>(root.value(QStringLiteral("tick")).toDouble());
+}
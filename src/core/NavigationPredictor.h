@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+#include <QVariant>
+#include <QVector>
+
+class HistoryStore;
+
+// Learns which page tends to follow another (referrer -> destination) and
+// which page a typed omnibox prefix usually ends at. Each source keeps a
+// small top-N table of destinations, so predictions stay cheap and the model
+// stays bounded no matter how much history accumulates. Everything is driven
+// by an internal tick counter rather than wall time, so replaying the same
+// navigations always yields the same predictions.
+class NavigationPredictor final : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Prediction
+  {
+    QUrl url;
+    double confidence = 0.0;
+    int hits = 0;
+  };
+
+  static constexpr int kMaxTargetsPerSource = 5;
+  static constexpr int kMaxSources = 4096;
+  static constexpr int kMaxTypedPrefixLength = 16;
+  static constexpr int kDecayObservations = 64;
+
+  explicit NavigationPredictor(QObject* parent = nullptr);
+
+  HistoryStore* history() const;
+  void setHistory(HistoryStore* history);
+
+  Q_INVOKABLE void recordNavigation(const QUrl& from, const QUrl& to);
+  Q_INVOKABLE void recordTypedNavigation(const QString& typed, const QUrl& to);
+
+  QVector<Prediction> predictionsAfter(const QUrl& url, int limit = 3) const;
+  QVector<Prediction> predictionsForInput(const QString& text, int limit = 3) const;
+
+  // Each entry carries url, confidence, hits and a warm-up hint: "prerender",
+  // "preconnect" or an empty string when the prediction is too weak to act on.
+  Q_INVOKABLE QVariantList predictNext(const QUrl& url, int limit = 3) const;
+  Q_INVOKABLE QVariantList predictForInput(const QString& text, int limit = 3) const;
+
+  Q_INVOKABLE void clear();
+  Q_INVOKABLE void pruneToHistory();
+
+  int sourceCount() const;
+  bool saveNow(QString* error = nullptr) const;
+
+  static QString warmUpHint(const Prediction& prediction);
+
+private:
+  struct Target
+  {
+    QString url;
+    int hits = 0;
+    quint64 lastTick = 0;
+  };
+
+  struct Source
+  {
+    QVector<Target> targets;
+    int observations = 0;
+    quint64 lastTick = 0;
+  };
+
+  using Table = QHash<QString, Source>;
+
+  void record(Table& table, const QString& sourceKey, const QString& targetKey);
+  void evictStaleSources(Table& table);
+  QVector<Prediction> predict(const Table& table, const QString& sourceKey, int limit) const;
+  static QVariantList toVariantList(const QVector<Prediction>& predictions);
+  static void pruneTable(Table& table, const QSet<QString>& known, bool pruneSources);
+
+  void scheduleSave();
+  void load();
+
+  QPointer<HistoryStore> m_history;
+  Table m_next;
+  Table m_typed;
+  quint64 m_tick = 0;
+  QTimer m_saveTimer;
+  QTimer m_pruneTimer;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+// Hashing shared by PublicSuffixList and the build-time table generator
+// (tools/psl_compile.cpp). Suffixes are hashed right to left, one UTF-16
+// unit at a time, so a lookup extends the hash of "com" into the hash of
+// "example.com" instead of rehashing every candidate suffix.
+namespace xbrowser::psl
+{
+constexpr std::uint64_t kHashBasis = 1469598103934665603ULL;
+
+// Slot layout of the generated table.
+constexpr std::uint64_t kLabelOffsetMask = (1ULL << 20) - 1;
+constexpr int kLabelLengthShift = 20;
+constexpr std::uint64_t kLabelLengthMask = 0x3F;
+constexpr int kFlagsShift = 26;
+constexpr int kParentShift = 32;
+
+enum SlotFlag : std::uint32_t
+{
+  Interior = 0,
+  Rule = 1,
+  Wildcard = 2,
+  Exception = 4,
+};
+
+constexpr std::uint64_t hashUnit(std::uint64_t h, char16_t unit)
+{
+  if (unit >= u'A' && unit <= u'Z') {
+    unit = static_cast<char16_t>(unit + (u'a' - u'A'));
+  }
+  h ^= unit;
+  h *= 1099511628211ULL;
+  return h;
+}
+
+constexpr std::uint64_t mix(std::uint64_t h)
+{
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBULL;
+  h ^= h >> 31;
+  return h;
+}
+
+constexpr std::uint32_t bucketFor(std::uint64_t h, std::uint32_t bucketCount)
+{
+  return static_cast<std::uint32_t>((mix(h) >> 32) % bucketCount);
+}
+
+constexpr std::uint32_t slotFor(std::uint64_t h, std::uint32_t displacement, std::uint32_t slotCount)
+{
+  return static_cast<std::uint32_t>(mix(h ^ (displacement * 0x9E3779B97F4A7C15ULL)) % slotCount);
+}
+}
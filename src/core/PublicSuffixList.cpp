@@ -0,0 +1,233 @@
+#include "PublicSuffixList.h"
+
+#include "PublicSuffixHash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "PublicSuffixTable.inc"
+
+namespace
+{
+namespace psl = xbrowser::psl;
+namespace table = xbrowser::psl::table;
+
+template <typename Char>
+char16_t unitAt(const Char* units, qsizetype i)
+{
+  return static_cast<char16_t>(static_cast<std::make_unsigned_t<Char>>(units[i]));
+}
+
+char16_t foldAscii(char16_t unit)
+{
+  return unit >= u'A' && unit <= u'Z' ? static_cast<char16_t>(unit + (u'a' - u'A')) : unit;
+}
+
+template <typename Char>
+bool labelEquals(std::uint64_t slot, const Char* units, qsizetype start, qsizetype end)
+{
+  const unsigned char* stored = table::kLabels + (slot & psl::kLabelOffsetMask);
+  const int storedLength = static_cast<int>((slot >> psl::kLabelLengthShift) & psl::kLabelLengthMask);
+
+  int s = 0;
+  qsizetype i = start;
+  while (s < storedLength && i < end) {
+    char32_t cp = stored[s++];
+    if (cp >= 0x80) {
+      const int extra = cp >= 0xF0 ? 3 : (cp >= 0xE0 ? 2 : 1);
+      cp &= 0x3F >> extra;
+      for (int k = 0; k < extra && s < storedLength; ++k) {
+        cp = (cp << 6) | (stored[s++] & 0x3F);
+      }
+    }
+
+    if (cp >= 0x10000) {
+      cp -= 0x10000;
+      if (i + 1 >= end || unitAt(units, i) != 0xD800 + (cp >> 10) || unitAt(units, i + 1) != 0xDC00 + (cp & 0x3FF)) {
+        return false;
+      }
+      i += 2;
+    } else if (foldAscii(unitAt(units, i++)) != cp) {
+      return false;
+    }
+  }
+  return s == storedLength && i == end;
+}
+
+template <typename Char>
+bool isIpLiteral(const Char* units, qsizetype size)
+{
+  qsizetype lastLabel = size;
+  while (lastLabel > 0 && unitAt(units, lastLabel - 1) != u'.') {
+    --lastLabel;
+  }
+
+  bool numeric = lastLabel < size;
+  for (qsizetype i = 0; i < size; ++i) {
+    const char16_t unit = unitAt(units, i);
+    if (unit == u':' || unit == u'[') {
+      return true;
+    }
+    if (i >= lastLabel && (unit < u'0' || unit > u'9')) {
+      numeric = false;
+    }
+  }
+  return numeric;
+}
+
+// Walks the host right to left, extending the suffix hash one label at a
+// time. Each hit must also name the previous hit as its parent, so the walk
+// stops at the first suffix the list does not know.
+template <typename Char>
+int suffixLabelCount(const Char* units, qsizetype size)
+{
+  if (size == 0 || isIpLiteral(units, size)) {
+    return 0;
+  }
+
+  int labels = 0;
+  int result = 1;
+  std::uint64_t hash = psl::kHashBasis;
+  std::uint64_t parent = 0;
+  qsizetype end = size;
+  for (qsizetype i = size - 1; i >= -1; --i) {
+    if (i >= 0 && unitAt(units, i) != u'.') {
+      hash = psl::hashUnit(hash, unitAt(units, i));
+      continue;
+    }
+    if (i + 1 == end) {
+      return 0;
+    }
+    ++labels;
+
+    const std::uint32_t bucket = psl::bucketFor(hash, table::kBucketCount);
+    const std::uint32_t index = psl::slotFor(hash, table::kDisplacements[bucket], table::kSlotCount);
+    const std::uint64_t slot = table::kSlots[index];
+    if (slot == 0 || (slot >> psl::kParentShift) != parent || !labelEquals(slot, units, i + 1, end)) {
+      break;
+    }
+
+    const std::uint32_t flags = static_cast<std::uint32_t>(slot >> psl::kFlagsShift) & 0x7;
+    if (flags & psl::Exception) {
+      return labels - 1;
+    }
+    if (flags & psl::Rule) {
+      result = labels;
+    }
+    if ((flags & psl::Wildcard) && i > 0 && unitAt(units, i - 1) != u'.') {
+      result = labels + 1;
+    }
+
+    parent = index + 1;
+    end = i;
+    hash = psl::hashUnit(hash, u'.');
+  }
+  return result;
+}
+
+// Start of the last `count` labels, or -1 when the host has fewer labels.
+template <typename Char>
+qsizetype trailingLabelsStart(const Char* units, qsizetype size, int count)
+{
+  qsizetype start = size + 1;
+  for (int k = 0; k < count; ++k) {
+    if (start == 0) {
+      return -1;
+    }
+    qsizetype dot = start - 2;
+    while (dot >= 0 && unitAt(units, dot) != u'.') {
+      --dot;
+    }
+    start = dot + 1;
+  }
+  return start;
+}
+
+QStringView withoutTrailingDot(QStringView host)
+{
+  return host.endsWith(u'.') ? host.chopped(1) : host;
+}
+
+std::string_view withoutTrailingDot(std::string_view host)
+{
+  if (!host.empty() && host.back() == '.') {
+    host.remove_suffix(1);
+  }
+  return host;
+}
+
+QStringView siteOf(QStringView host)
+{
+  const QStringView domain = PublicSuffixList::registrableDomain(host);
+  return domain.isEmpty() ? withoutTrailingDot(host.trimmed()) : domain;
+}
+}
+
+int PublicSuffixList::publicSuffixLabelCount(QStringView host)
+{
+  host = withoutTrailingDot(host);
+  return suffixLabelCount(host.utf16(), host.size());
+}
+
+QStringView PublicSuffixList::publicSuffix(QStringView host)
+{
+  host = withoutTrailingDot(host);
+  const int labels = suffixLabelCount(host.utf16(), host.size());
+  if (labels == 0) {
+    return {};
+  }
+  const qsizetype start = trailingLabelsStart(host.utf16(), host.size(), labels);
+  return start < 0 ? QStringView() : host.sliced(start);
+}
+
+QStringView PublicSuffixList::registrableDomain(QStringView host)
+{
+  host = withoutTrailingDot(host);
+  const int labels = suffixLabelCount(host.utf16(), host.size());
+  if (labels == 0) {
+    return {};
+  }
+  const qsizetype start = trailingLabelsStart(host.utf16(), host.size(), labels + 1);
+  return start < 0 ? QStringView() : host.sliced(start);
+}
+
+std::string_view PublicSuffixList::registrableDomain(std::string_view host)
+{
+  host = withoutTrailingDot(host);
+  const qsizetype size = static_cast<qsizetype>(host.size());
+  const bool ascii = std::all_of(host.begin(), host.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+
+  // Labels are separated by ASCII dots in either encoding, so a label count
+  // taken from the UTF-16 form still indexes the UTF-8 bytes.
+  const int labels =
+    ascii ? suffixLabelCount(host.data(), size) : publicSuffixLabelCount(QString::fromUtf8(host.data(), size));
+  if (labels == 0) {
+    return {};
+  }
+  const qsizetype start = trailingLabelsStart(host.data(), size, labels + 1);
+  return start < 0 ? std::string_view() : host.substr(static_cast<size_t>(start));
+}
+
+bool PublicSuffixList::isPublicSuffix(QStringView host)
+{
+  host = withoutTrailingDot(host);
+  const int labels = suffixLabelCount(host.utf16(), host.size());
+  return labels > 0 && trailingLabelsStart(host.utf16(), host.size(), labels) == 0;
+}
+
+QString PublicSuffixList::siteKey(QStringView host)
+{
+  return siteOf(host).toString().toLower();
+}
+
+bool PublicSuffixList::isSameSite(QStringView a, QStringView b)
+{
+  const QStringView siteA = siteOf(a);
+  return !siteA.isEmpty() && siteA.compare(siteOf(b), Qt::CaseInsensitive) == 0;
+}
+
+int PublicSuffixList::ruleCount()
+{
+  return table::kRuleCount;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+
+#include <string_view>
+
+// eTLD+1 lookups against the Public Suffix List compiled into the binary
+// (see cmake/PublicSuffixList.cmake). Lookups fold ASCII case, never
+// allocate for QStringView or ASCII input, and return views into the
+// argument. IP literals have no registrable domain.
+class PublicSuffixList final
+{
+public:
+  PublicSuffixList() = delete;
+
+  // Number of trailing labels forming the public suffix of host, or 0 for
+  // empty, malformed and IP hosts. Unknown TLDs count as one-label suffixes.
+  static int publicSuffixLabelCount(QStringView host);
+
+  static QStringView publicSuffix(QStringView host);
+  static QStringView registrableDomain(QStringView host);
+  static std::string_view registrableDomain(std::string_view host);
+  static bool isPublicSuffix(QStringView host);
+
+  // Lowercased registrable domain, falling back to the host itself for IP
+  // literals, single-label hosts and bare public suffixes.
+  static QString siteKey(QStringView host);
+  static bool isSameSite(QStringView a, QStringView b);
+
+  static int ruleCount();
+};
@@ -0,0 +1,822 @@
+#include "SegmentedDownloader.h"
+
+#include "DownloadModel.h"
+#include "UserDataStorage.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QHttp1Configuration>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+namespace
+{
+constexpr int kTransferTimeoutMs = 30000;
+constexpr int kProgressIntervalMs = 200;
+constexpr int kSaveDelayMs = 1000;
+constexpr int kMaxAttempts = 3;
+constexpr int kRetryDelayMs = 1000;
+constexpr int kMaxRedirects = 10;
+const QString kStateName = QStringLiteral("partial-downloads.json");
+
+int httpStatus(const QNetworkReply* reply)
+{
+  return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+bool isHttpScheme(const QString& scheme)
+{
+  return scheme == QLatin1String("http") || scheme == QLatin1String("https");
+}
+
+bool sameOrigin(const QUrl& a, const QUrl& b)
+{
+  const QString scheme = a.scheme().toLower();
+  const int defaultPort = scheme == QLatin1String("https") ? 443 : 80;
+  return scheme == b.scheme().toLower() && a.host().compare(b.host(), Qt::CaseInsensitive) == 0
+         && a.port(defaultPort) == b.port(defaultPort);
+}
+
+// "bytes 0-0/1234"; total is -1 for "*".
+bool parseContentRange(const QByteArray& value, qint64* first, qint64* total)
+{
+  const QByteArray trimmed = value.trimmed();
+  if (!trimmed.startsWith("bytes ")) {
+    return false;
+  }
+  const int dash = trimmed.indexOf('-');
+  const int slash = trimmed.indexOf('/');
+  if (dash < 0 || slash < dash) {
+    return false;
+  }
+
+  bool ok = false;
+  *first = trimmed.mid(6, dash - 6).trimmed().toLongLong(&ok);
+  if (!ok) {
+    return false;
+  }
+  const QByteArray size = trimmed.mid(slash + 1).trimmed();
+  *total = size == "*" ? -1 : size.toLongLong(&ok);
+  return ok;
+}
+
+void dropReply(QNetworkReply* reply, QObject* receiver)
+{
+  if (!reply) {
+    return;
+  }
+  // Disconnect first: abort() emits finished synchronously.
+  QObject::disconnect(reply, nullptr, receiver, nullptr);
+  reply->abort();
+  reply->deleteLater();
+}
+}
+
+qint64 SegmentedDownloader::Segment::length() const
+{
+  return end >= 0 ? end - start + 1 : -1;
+}
+
+bool SegmentedDownloader::Segment::done() const
+{
+  return end >= 0 ? received >= length() : finished;
+}
+
+qint64 SegmentedDownloader::Job::received() const
+{
+  qint64 sum = 0;
+  for (const Segment& segment : segments) {
+    sum += segment.received;
+  }
+  return sum;
+}
+
+SegmentedDownloader::SegmentedDownloader(QObject* parent)
+  : QObject(parent)
+  , m_network(new QNetworkAccessManager(this))
+{
+  m_saveTimer.setSingleShot(true);
+  m_saveTimer.setInterval(kSaveDelayMs);
+  connect(&m_saveTimer, &QTimer::timeout, this, &SegmentedDownloader::saveState);
+
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(10000);
+}
+
+SegmentedDownloader::~SegmentedDownloader()
+{
+  // Whatever is still running is picked up by restorePending() next time.
+  for (const std::shared_ptr<Job>& job : std::as_const(m_jobs)) {
+    stopReplies(*job);
+  }
+  saveState();
+  m_pool.waitForDone();
+}
+
+DownloadModel* SegmentedDownloader::downloads() const
+{
+  return m_downloads;
+}
+
+void SegmentedDownloader::setDownloads(DownloadModel* downloads)
+{
+  m_downloads = downloads;
+}
+
+int SegmentedDownloader::segmentCount() const
+{
+  return m_segmentCount;
+}
+
+void SegmentedDownloader::setSegmentCount(int count)
+{
+  count = qBound(1, count, kMaxSegmentCount);
+  if (m_segmentCount == count) {
+    return;
+  }
+  m_segmentCount = count;
+  emit segmentCountChanged();
+}
+
+qint64 SegmentedDownloader::minSegmentBytes() const
+{
+  return m_minSegmentBytes;
+}
+
+void SegmentedDownloader::setMinSegmentBytes(qint64 bytes)
+{
+  m_minSegmentBytes = qMax<qint64>(1, bytes);
+}
+
+int SegmentedDownloader::start(const QUrl& url, const QString& filePath, const QString& cookieHeader,
+                               const QString& expectedSha256)
+{
+  if (!m_downloads || filePath.trimmed().isEmpty() || !isHttpScheme(url.scheme().toLower())) {
+    return 0;
+  }
+
+  const int id = m_downloads->addStarted(url.toString(), filePath);
+  if (id <= 0) {
+    return 0;
+  }
+
+  auto job = std::make_shared<Job>();
+  job->id = id;
+  job->url = url;
+  job->filePath = filePath;
+  job->cookieHeader = cookieHeader;
+  job->expectedSha256 = expectedSha256.trimmed().toLower();
+  m_jobs.insert(id, job);
+
+  probe(*job);
+  reportProgress(*job, true);
+  return id;
+}
+
+bool SegmentedDownloader::handles(int downloadId) const
+{
+  return m_jobs.contains(downloadId);
+}
+
+bool SegmentedDownloader::pause(int downloadId)
+{
+  const std::shared_ptr<Job> job = find(downloadId);
+  if (!job || (job->phase != Phase::Probing && job->phase != Phase::Fetching)) {
+    return false;
+  }
+
+  stopReplies(*job);
+  job->phase = Phase::Paused;
+  saveState();
+  job->file.close();
+  reportProgress(*job, true);
+  return true;
+}
+
+bool SegmentedDownloader::resume(int downloadId)
+{
+  const std::shared_ptr<Job> job = find(downloadId);
+  if (!job || (job->phase != Phase::Paused && job->phase != Phase::Failed)) {
+    return false;
+  }
+
+  job->error.clear();
+  if (job->segments.isEmpty()) {
+    probe(*job);
+    reportProgress(*job, true);
+    return true;
+  }
+  if (!job->ranged) {
+    // Nothing to resume from; start the stream over.
+    plan(*job);
+    return true;
+  }
+
+  if (!openPartFile(*job, false)) {
+    fail(*job, QStringLiteral("Could not open %1").arg(partPath(*job)));
+    return true;
+  }
+
+  job->phase = Phase::Fetching;
+  for (int i = 0; i < job->segments.size(); ++i) {
+    job->segments[i].attempts = 0;
+    startSegment(*job, i);
+  }
+  reportProgress(*job, true);
+  checkComplete(*job);
+  return true;
+}
+
+bool SegmentedDownloader::cancel(int downloadId)
+{
+  const std::shared_ptr<Job> job = find(downloadId);
+  if (!job) {
+    return false;
+  }
+
+  stopReplies(*job);
+  job->file.close();
+  QFile::remove(partPath(*job));
+  finish(downloadId, false, QStringLiteral("Cancelled"));
+  return true;
+}
+
+int SegmentedDownloader::restorePending()
+{
+  QByteArray payload;
+  if (!m_downloads || !xbrowser::userDataStorage().read(kStateName, &payload)) {
+    return 0;
+  }
+
+  int restored = 0;
+  const QJsonArray items = QJsonDocument::fromJson(payload).object().value(QStringLiteral("jobs")).toArray();
+  for (const QJsonValue& value : items) {
+    const QJsonObject obj = value.toObject();
+    const int id = obj.value(QStringLiteral("id")).toInt();
+    const QUrl url(obj.value(QStringLiteral("url")).toString());
+    const QString filePath = obj.value(QStringLiteral("filePath")).toString();
+    if (id <= 0 || m_jobs.contains(id) || !url.isValid() || filePath.isEmpty() || !m_downloads->isInProgress(id)) {
+      continue;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->id = id;
+    job->url = url;
+    job->filePath = filePath;
+    job->expectedSha256 = obj.value(QStringLiteral("expectedSha256")).toString();
+    job->total = static_cast<qint64>(obj.value(QStringLiteral("total")).toDouble(-1));
+    job->ranged = obj.value(QStringLiteral("ranged")).toBool();
+    job->validator = obj.value(QStringLiteral("validator")).toString().toLatin1();
+    job->phase = Phase::Paused;
+
+    const bool partExists = QFileInfo::exists(partPath(*job));
+    for (const QJsonValue& range : obj.value(QStringLiteral("segments")).toArray()) {
+      const QJsonArray fields = range.toArray();
+      if (fields.size() != 3) {
+        continue;
+      }
+      Segment segment;
+      segment.start = static_cast<qint64>(fields.at(0).toDouble());
+      segment.end = static_cast<qint64>(fields.at(1).toDouble());
+      segment.received = partExists ? static_cast<qint64>(fields.at(2).toDouble()) : 0;
+      job->segments.push_back(segment);
+    }
+
+    m_jobs.insert(id, job);
+    reportProgress(*job, true);
+    ++restored;
+  }
+
+  // Drops entries whose download is gone from the list.
+  saveState();
+  return restored;
+}
+
+void SegmentedDownloader::probe(Job& job)
+{
+  job.phase = Phase::Probing;
+  job.segments.clear();
+  job.fetchUrl = job.url;
+  job.redirects = 0;
+  sendProbe(job);
+}
+
+void SegmentedDownloader::sendProbe(Job& job)
+{
+  // One byte is enough to learn whether ranges work and how big the file is.
+  // Redirects are followed in onProbeFinished, one hop at a time, so each
+  // hop gets the cookies only if it is still the original origin.
+  QNetworkRequest req = request(job);
+  req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+  req.setRawHeader("Range", "bytes=0-0");
+
+  QNetworkReply* reply = m_network->get(req);
+  job.probe = reply;
+  const int id = job.id;
+  connect(reply, &QNetworkReply::metaDataChanged, this, [this, id] {
+    onProbeHeaders(id);
+  });
+  connect(reply, &QNetworkReply::finished, this, [this, id] {
+    onProbeFinished(id);
+  });
+}
+
+void SegmentedDownloader::onProbeHeaders(int id)
+{
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || !job->probe) {
+    return;
+  }
+
+  QNetworkReply* reply = job->probe;
+  const int status = httpStatus(reply);
+  if (status == 206) {
+    qint64 first = 0;
+    qint64 total = -1;
+    job->ranged = parseContentRange(reply->rawHeader("Content-Range"), &first, &total) && first == 0 && total > 0;
+    job->total = job->ranged ? total : -1;
+
+    // Weak ETags are not allowed in If-Range.
+    const QByteArray etag = reply->rawHeader("ETag");
+    job->validator = !etag.isEmpty() && !etag.startsWith("W/") ? etag : reply->rawHeader("Last-Modified");
+  } else if (status == 200) {
+    job->ranged = false;
+    const QVariant length = reply->header(QNetworkRequest::ContentLengthHeader);
+    job->total = length.isValid() ? length.toLongLong() : -1;
+    job->validator.clear();
+  } else {
+    // Errors are reported from finished.
+    return;
+  }
+
+  job->fetchUrl = reply->url();
+  job->probe = nullptr;
+  dropReply(reply, this);
+  plan(*job);
+}
+
+void SegmentedDownloader::onProbeFinished(int id)
+{
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || !job->probe) {
+    return;
+  }
+
+  QNetworkReply* reply = job->probe;
+  const int status = httpStatus(reply);
+  if (reply->error() == QNetworkReply::NoError && (status == 200 || status == 206)) {
+    onProbeHeaders(id);
+    return;
+  }
+
+  const QUrl location = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+  if (status >= 300 && status < 400 && location.isValid()) {
+    const QUrl target = reply->url().resolved(location);
+    job->probe = nullptr;
+    dropReply(reply, this);
+    if (++job->redirects > kMaxRedirects) {
+      fail(*job, QStringLiteral("Too many redirects"));
+    } else if (!isHttpScheme(target.scheme().toLower())
+               || (job->fetchUrl.scheme().toLower() == QLatin1String("https")
+                   && target.scheme().toLower() != QLatin1String("https"))) {
+      fail(*job, QStringLiteral("Refused redirect to %1").arg(target.toDisplayString()));
+    } else {
+      job->fetchUrl = target;
+      sendProbe(*job);
+    }
+    return;
+  }
+
+  const QString error = status >= 400 ? QStringLiteral("HTTP %1").arg(status) : reply->errorString();
+  job->probe = nullptr;
+  dropReply(reply, this);
+  fail(*job, error);
+}
+
+void SegmentedDownloader::plan(Job& job)
+{
+  if (!openPartFile(job, true)) {
+    fail(job, QStringLiteral("Could not create %1").arg(partPath(job)));
+    return;
+  }
+
+  job.segments.clear();
+  if (job.ranged) {
+    const int count = int(qBound<qint64>(1, job.total / m_minSegmentBytes, m_segmentCount));
+    const qint64 size = job.total / count;
+    for (int i = 0; i < count; ++i) {
+      Segment segment;
+      segment.start = i * size;
+      segment.end = i == count - 1 ? job.total - 1 : segment.start + size - 1;
+      job.segments.push_back(segment);
+    }
+  } else {
+    Segment segment;
+    segment.end = job.total > 0 ? job.total - 1 : -1;
+    job.segments.push_back(segment);
+  }
+
+  job.phase = Phase::Fetching;
+  for (int i = 0; i < job.segments.size(); ++i) {
+    startSegment(job, i);
+  }
+  scheduleSave();
+  reportProgress(job, true);
+}
+
+bool SegmentedDownloader::openPartFile(Job& job, bool truncate)
+{
+  job.file.close();
+  const QString path = partPath(job);
+  QDir().mkpath(QFileInfo(path).absolutePath());
+
+  const bool existed = QFileInfo::exists(path);
+  job.file.setFileName(path);
+  if (!job.file.open(truncate ? QIODevice::ReadWrite | QIODevice::Truncate : QIODevice::ReadWrite)) {
+    return false;
+  }
+
+  // A part file that is missing or the wrong size cannot be trusted.
+  bool reset = !existed;
+  if (job.total > 0 && job.file.size() != job.total) {
+    reset = true;
+    // Reserve the whole file up front so the ranges never race to extend it.
+    if (!job.file.resize(job.total)) {
+      job.file.close();
+      return false;
+    }
+  }
+  if (reset) {
+    for (Segment& segment : job.segments) {
+      segment.received = 0;
+      segment.finished = false;
+    }
+  }
+  return true;
+}
+
+void SegmentedDownloader::startSegment(Job& job, int index)
+{
+  Segment& segment = job.segments[index];
+  if (segment.done() || segment.reply) {
+    return;
+  }
+
+  QNetworkRequest req = request(job);
+  if (job.ranged) {
+    const qint64 from = segment.start + segment.received;
+    req.setRawHeader("Range", QStringLiteral("bytes=%1-%2").arg(from).arg(segment.end).toLatin1());
+    if (!job.validator.isEmpty()) {
+      req.setRawHeader("If-Range", job.validator);
+    }
+  }
+
+  QNetworkReply* reply = m_network->get(req);
+  segment.reply = reply;
+  const int id = job.id;
+  connect(reply, &QNetworkReply::metaDataChanged, this, [this, id, index] {
+    onSegmentHeaders(id, index);
+  });
+  connect(reply, &QNetworkReply::readyRead, this, [this, id, index] {
+    onSegmentData(id, index);
+  });
+  connect(reply, &QNetworkReply::finished, this, [this, id, index] {
+    onSegmentFinished(id, index);
+  });
+}
+
+void SegmentedDownloader::onSegmentHeaders(int id, int index)
+{
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || !job->ranged || index >= job->segments.size() || !job->segments.at(index).reply) {
+    return;
+  }
+
+  const Segment& segment = job->segments.at(index);
+  const int status = httpStatus(segment.reply);
+  if (status == 200) {
+    // The range was ignored, or If-Range saw a changed file.
+    restartWithoutRanges(*job);
+    return;
+  }
+  if (status != 206) {
+    return;
+  }
+
+  qint64 first = 0;
+  qint64 total = -1;
+  if (!parseContentRange(segment.reply->rawHeader("Content-Range"), &first, &total)
+      || first != segment.start + segment.received || (total >= 0 && total != job->total)) {
+    restartWithoutRanges(*job);
+  }
+}
+
+void SegmentedDownloader::onSegmentData(int id, int index)
+{
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || job->phase != Phase::Fetching || index >= job->segments.size()) {
+    return;
+  }
+
+  Segment& segment = job->segments[index];
+  QNetworkReply* reply = segment.reply;
+  const int status = reply ? httpStatus(reply) : 0;
+  if (status < 200 || status >= 300) {
+    return;
+  }
+
+  QByteArray data = reply->readAll();
+  if (segment.end >= 0) {
+    data.truncate(qMin<qint64>(data.size(), segment.length() - segment.received));
+  }
+  if (data.isEmpty()) {
+    return;
+  }
+
+  if (!job->file.seek(segment.start + segment.received) || job->file.write(data) != data.size()) {
+    fail(*job, QStringLiteral("Could not write %1: %2").arg(partPath(*job), job->file.errorString()));
+    return;
+  }
+  segment.received += data.size();
+  segment.attempts = 0;
+
+  reportProgress(*job, false);
+  scheduleSave();
+}
+
+void SegmentedDownloader::onSegmentFinished(int id, int index)
+{
+  onSegmentData(id, index);
+
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || job->phase != Phase::Fetching || index >= job->segments.size() || !job->segments.at(index).reply) {
+    return;
+  }
+
+  Segment& segment = job->segments[index];
+  QNetworkReply* reply = segment.reply;
+  segment.reply = nullptr;
+  reply->deleteLater();
+
+  const int status = httpStatus(reply);
+  if (reply->error() == QNetworkReply::NoError && status >= 200 && status < 300) {
+    if (segment.end < 0) {
+      segment.finished = true;
+      job->total = segment.received;
+    }
+    if (segment.done()) {
+      checkComplete(*job);
+      return;
+    }
+  }
+
+  const QString error = status >= 400 ? QStringLiteral("HTTP %1").arg(status)
+                        : reply->error() != QNetworkReply::NoError
+                          ? reply->errorString()
+                          : QStringLiteral("Connection closed early");
+  const bool retryable = status < 400 || status == 408 || status == 429 || status >= 500;
+  if (!retryable || ++segment.attempts >= kMaxAttempts) {
+    fail(*job, error);
+    return;
+  }
+
+  if (!job->ranged) {
+    // A plain stream can only start again from the top.
+    segment.received = 0;
+  }
+  QTimer::singleShot(kRetryDelayMs * segment.attempts, this, [this, id, index] {
+    const std::shared_ptr<Job> retry = find(id);
+    if (retry && retry->phase == Phase::Fetching && index < retry->segments.size()) {
+      startSegment(*retry, index);
+    }
+  });
+}
+
+void SegmentedDownloader::restartWithoutRanges(Job& job)
+{
+  stopReplies(job);
+  job.ranged = false;
+  job.total = -1;
+  job.validator.clear();
+  plan(job);
+}
+
+void SegmentedDownloader::stopReplies(Job& job)
+{
+  dropReply(job.probe, this);
+  job.probe = nullptr;
+  for (Segment& segment : job.segments) {
+    dropReply(segment.reply, this);
+    segment.reply = nullptr;
+  }
+}
+
+void SegmentedDownloader::checkComplete(Job& job)
+{
+  for (const Segment& segment : std::as_const(job.segments)) {
+    if (!segment.done()) {
+      return;
+    }
+  }
+  verify(job);
+}
+
+void SegmentedDownloader::verify(Job& job)
+{
+  job.phase = Phase::Verifying;
+  const qint64 size = job.file.size();
+  job.file.close();
+  reportProgress(job, true);
+
+  if (job.total >= 0 && (size != job.total || job.received() != job.total)) {
+    QFile::remove(partPath(job));
+    finish(job.id, false, QStringLiteral("Expected %1 bytes, got %2").arg(job.total).arg(job.received()));
+    return;
+  }
+  if (job.expectedSha256.isEmpty()) {
+    onVerified(job.id, {});
+    return;
+  }
+
+  // Hashing a large file takes a while; keep it off the GUI thread.
+  const int id = job.id;
+  const QString path = partPath(job);
+  const QString expected = job.expectedSha256;
+  m_pool.start([this, id, path, expected] {
+    QString error;
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+      error = QStringLiteral("Could not read %1").arg(path);
+    } else if (QString::fromLatin1(hash.result().toHex()) != expected) {
+      error = QStringLiteral("Checksum mismatch");
+    }
+
+    QMetaObject::invokeMethod(
+      this,
+      [this, id, error] {
+        onVerified(id, error);
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+void SegmentedDownloader::onVerified(int id, const QString& error)
+{
+  const std::shared_ptr<Job> job = find(id);
+  if (!job || job->phase != Phase::Verifying) {
+    return;
+  }
+
+  const QString part = partPath(*job);
+  if (!error.isEmpty()) {
+    QFile::remove(part);
+    finish(id, false, error);
+    return;
+  }
+
+  if (QFileInfo::exists(job->filePath)) {
+    QFile::remove(job->filePath);
+  }
+  if (!QFile::rename(part, job->filePath)) {
+    finish(id, false, QStringLiteral("Could not move the download to %1").arg(job->filePath));
+    return;
+  }
+  finish(id, true, {});
+}
+
+void SegmentedDownloader::fail(Job& job, const QString& error)
+{
+  stopReplies(job);
+  job.error = error;
+
+  // Ranged downloads keep their part file and can pick up where they were.
+  if (job.ranged && !job.segments.isEmpty()) {
+    job.phase = Phase::Failed;
+    saveState();
+    job.file.close();
+    reportProgress(job, true);
+    return;
+  }
+
+  job.file.close();
+  QFile::remove(partPath(job));
+  finish(job.id, false, error);
+}
+
+void SegmentedDownloader::finish(int id, bool success, const QString& error)
+{
+  const std::shared_ptr<Job> job = m_jobs.take(id);
+  if (!job) {
+    return;
+  }
+
+  if (m_downloads) {
+    if (success) {
+      m_downloads->updateProgress(id, job->received(), job->received(), false, false, {});
+    }
+    m_downloads->markFinishedById(id, success, error);
+  }
+  saveState();
+  emit finished(id, success, error);
+}
+
+void SegmentedDownloader::reportProgress(Job& job, bool force)
+{
+  if (!m_downloads) {
+    return;
+  }
+  if (!force && job.lastReport.isValid() && job.lastReport.elapsed() < kProgressIntervalMs) {
+    return;
+  }
+  job.lastReport.start();
+
+  const bool paused = job.phase == Phase::Paused;
+  const bool failed = job.phase == Phase::Failed;
+  m_downloads->updateProgress(job.id, job.received(), qMax<qint64>(0, job.total), paused, paused || failed,
+                              failed ? job.error : QString());
+}
+
+QNetworkRequest SegmentedDownloader::request(const Job& job) const
+{
+  const QUrl url = job.fetchUrl.isValid() ? job.fetchUrl : job.url;
+  // The cookies were read for job.url and may include HttpOnly session
+  // cookies; a redirect elsewhere (usually a CDN) must not see them, and a
+  // request that carries them must not be redirected on.
+  const bool withCookies = !job.cookieHeader.isEmpty() && sameOrigin(url, job.url);
+  QNetworkRequest req(url);
+  req.setAttribute(QNetworkRequest::RedirectPolicyAttribute, withCookies ? QNetworkRequest::ManualRedirectPolicy
+                                                                         : QNetworkRequest::NoLessSafeRedirectPolicy);
+  // Separate connections are the point; HTTP/2 would put every range on one.
+  req.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+  QHttp1Configuration http1;
+  http1.setNumberOfConnectionsPerHost(qMax(m_segmentCount, 6));
+  req.setHttp1Configuration(http1);
+  req.setTransferTimeout(kTransferTimeoutMs);
+  // Offsets are into the bytes on disk, so no transfer compression.
+  req.setRawHeader("Accept-Encoding", "identity");
+  if (withCookies) {
+    req.setRawHeader("Cookie", job.cookieHeader.toUtf8());
+  }
+  return req;
+}
+
+std::shared_ptr<SegmentedDownloader::Job> SegmentedDownloader::find(int id) const
+{
+  return m_jobs.value(id);
+}
+
+void SegmentedDownloader::scheduleSave()
+{
+  if (!m_saveTimer.isActive()) {
+    m_saveTimer.start();
+  }
+}
+
+void SegmentedDownloader::saveState()
+{
+  m_saveTimer.stop();
+
+  QJsonArray items;
+  for (const std::shared_ptr<Job>& job : std::as_const(m_jobs)) {
+    // Saved progress must never run ahead of what reached the file.
+    if (job->file.isOpen()) {
+      job->file.flush();
+    }
+
+    QJsonArray segments;
+    for (const Segment& segment : std::as_const(job->segments)) {
+      segments.append(QJsonArray{double(segment.start), double(segment.end), double(segment.received)});
+    }
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("id"), job->id);
+    obj.insert(QStringLiteral("url"), job->url.toString(QUrl::FullyEncoded));
+    obj.insert(QStringLiteral("filePath"), job->filePath);
+    obj.insert(QStringLiteral("expectedSha256"), job->expectedSha256);
+    obj.insert(QStringLiteral("total"), double(job->total));
+    obj.insert(QStringLiteral("ranged"), job->ranged);
+    obj.insert(QStringLiteral("validator"), QString::fromLatin1(job->validator));
+    obj.insert(QStringLiteral("segments"), segments);
+    items.append(obj);
+  }
+
+  if (items.isEmpty()) {
+    xbrowser::userDataStorage().remove(kStateName);
+    return;
+  }
+
+  QJsonObject root;
+  root.insert(QStringLiteral("jobs"), items);
+  xbrowser::userDataStorage().write(kStateName, QJsonDocument(root).toJson(QJsonDocument::Compact) + '\n');
+}
+
+QString SegmentedDownloader::partPath(const Job& job) const
+{
+  return job.filePath + QStringLiteral(".part");
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include <memory>
+
+class DownloadModel;
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Downloads a URL over several connections at once. A one-byte range
+// request probes for Accept-Ranges and the size; the file is then
+// preallocated as "<path>.part" and split into byte ranges fetched in
+// parallel, each written at its own offset. Servers without range support
+// get a single stream. The ranges' progress is saved to user data, so a
+// paused, failed or crashed download resumes where each range stopped
+// (guarded by If-Range). A finished file is checked against the expected
+// size, and optionally a SHA-256, before it replaces "<path>".
+//
+// Progress and results go through DownloadModel's usual roles.
+class SegmentedDownloader final : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int segmentCount READ segmentCount WRITE setSegmentCount NOTIFY segmentCountChanged)
+
+public:
+  static constexpr int kDefaultSegmentCount = 4;
+  static constexpr int kMaxSegmentCount = 16;
+  static constexpr qint64 kDefaultMinSegmentBytes = 1024LL * 1024LL;
+
+  explicit SegmentedDownloader(QObject* parent = nullptr);
+  ~SegmentedDownloader() override;
+
+  DownloadModel* downloads() const;
+  void setDownloads(DownloadModel* downloads);
+
+  int segmentCount() const;
+  void setSegmentCount(int count);
+
+  // Files smaller than twice this stay on one connection.
+  qint64 minSegmentBytes() const;
+  void setMinSegmentBytes(qint64 bytes);
+
+  // Returns the DownloadModel id, or 0 if the download could not start.
+  // cookieHeader is sent with requests to url's origin only, and never saved.
+  Q_INVOKABLE int start(const QUrl& url, const QString& filePath, const QString& cookieHeader = {},
+                        const QString& expectedSha256 = {});
+  Q_INVOKABLE bool handles(int downloadId) const;
+  Q_INVOKABLE bool pause(int downloadId);
+  Q_INVOKABLE bool resume(int downloadId);
+  Q_INVOKABLE bool cancel(int downloadId);
+
+  // Brings back downloads an earlier run left unfinished, paused. Returns
+  // how many there were.
+  int restorePending();
+
+signals:
+  void segmentCountChanged();
+  void finished(int downloadId, bool success, const QString& error);
+
+private:
+  enum class Phase
+  {
+    Probing,
+    Fetching,
+    Verifying,
+    Paused,
+    Failed,
+  };
+
+  struct Segment
+  {
+    qint64 start = 0;
+    // Inclusive; -1 while the size is unknown.
+    qint64 end = -1;
+    qint64 received = 0;
+    int attempts = 0;
+    // Set when a stream of unknown length ends cleanly.
+    bool finished = false;
+    QPointer<QNetworkReply> reply;
+
+    qint64 length() const;
+    bool done() const;
+  };
+
+  struct Job
+  {
+    int id = 0;
+    QUrl url;
+    // Where redirects led; not saved, since signed CDN links expire.
+    QUrl fetchUrl;
+    QString filePath;
+    QString cookieHeader;
+    int redirects = 0;
+    QString expectedSha256;
+    qint64 total = -1;
+    bool ranged = false;
+    // ETag or Last-Modified from the probe, sent as If-Range on resume.
+    QByteArray validator;
+    QVector<Segment> segments;
+    Phase phase = Phase::Probing;
+    QString error;
+    QFile file;
+    QPointer<QNetworkReply> probe;
+    QElapsedTimer lastReport;
+
+    qint64 received() const;
+  };
+
+  void probe(Job& job);
+  void sendProbe(Job& job);
+  void onProbeHeaders(int id);
+  void onProbeFinished(int id);
+  void plan(Job& job);
+  bool openPartFile(Job& job, bool truncate);
+  void startSegment(Job& job, int index);
+  void onSegmentHeaders(int id, int index);
+  void onSegmentData(int id, int index);
+  void onSegmentFinished(int id, int index);
+  void restartWithoutRanges(Job& job);
+  void stopReplies(Job& job);
+  void checkComplete(Job& job);
+  void verify(Job& job);
+  void onVerified(int id, const QString& error);
+  void fail(Job& job, const QString& error);
+  void finish(int id, bool success, const QString& error);
+  void reportProgress(Job& job, bool force);
+
+  QNetworkRequest request(const Job& job) const;
+  std::shared_ptr<Job> find(int id) const;
+  void scheduleSave();
+  void saveState();
+  QString partPath(const Job& job) const;
+
+  QNetworkAccessManager* m_network = nullptr;
+  QPointer<DownloadModel> m_downloads;
+  QHash<int, std::shared_ptr<Job>> m_jobs;
+  int m_segmentCount = kDefaultSegmentCount;
+  qint64 m_minSegmentBytes = kDefaultMinSegmentBytes;
+  QTimer m_saveTimer;
+  QThreadPool m_pool;
+};
@@ -1,27 +1,31 @@
 #include "SessionStore.h"
 
-#include "AppPaths.h"
 #include "BrowserController.h"
 #include "SplitViewController.h"
 #include "TabGroupModel.h"
 #include "TabModel.h"
+#include "UserDataStorage.h"
+#include "WindowManager.h"
 #include "WorkspaceModel.h"
 
-#include <QDir>
 #include <QDateTime>
-#include <QFile>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QSaveFile>
 
 namespace
 {
-constexpr int kSessionVersion = 3;
+constexpr int kSessionVersion = 5;
+constexpr int kFirstJournalSessionVersion = 4;
+constexpr int kFirstMultiWindowSessionVersion = 5;
 
-QString sessionPath()
+const QString kSessionName = QStringLiteral("session.json");
+
+// The journal appends to a file; without one (in-memory storage) it only
+// keeps its ring.
+QString closedTabsJournalPath()
 {
-  return QDir(xbrowser::appDataRoot()).filePath("session.json");
+  return xbrowser::userDataStorage().localPath(QStringLiteral("closed_tabs.jsonl"));
 }
 
 QColor parseColor(const QJsonValue& value)
@@ -47,56 +51,97 @@ void SessionStore::attach(BrowserController* browser, SplitViewController* split
   m_browser = browser;
   m_splitView = splitView;
 
+  if (m_browser) {
+    m_browser->closedTabJournal()->setStoragePath(closedTabsJournalPath());
+  }
+
+  restoreNow();
+  connectWindow(m_browser, m_splitView);
+}
+
+void SessionStore::attach(WindowManager* windows)
+{
+  m_windows = windows;
+  m_browser = nullptr;
+  m_splitView = nullptr;
+  if (!m_windows) {
+    return;
+  }
+
+  m_windows->closedTabJournal()->setStoragePath(closedTabsJournalPath());
   restoreNow();
-  connectWorkspaceModels();
 
-  if (m_browser && !m_connected.contains(m_browser)) {
-    m_connected.insert(m_browser);
-    connect(m_browser, &BrowserController::recentlyClosedChanged, this, &SessionStore::scheduleSave);
+  for (const int windowId : m_windows->windowIds()) {
+    connectWindow(m_windows->browser(windowId), m_windows->splitView(windowId));
   }
 
-  if (m_splitView && !m_connected.contains(m_splitView)) {
-    m_connected.insert(m_splitView);
-    connect(m_splitView, &SplitViewController::enabledChanged, this, &SessionStore::scheduleSave);
-    connect(m_splitView, &SplitViewController::tabsChanged, this, &SessionStore::scheduleSave);
-    connect(m_splitView, &SplitViewController::focusedPaneChanged, this, &SessionStore::scheduleSave);
-    connect(m_splitView, &SplitViewController::splitRatioChanged, this, &SessionStore::scheduleSave);
-    connect(m_splitView, &SplitViewController::gridSplitRatioXChanged, this, &SessionStore::scheduleSave);
-    connect(m_splitView, &SplitViewController::gridSplitRatioYChanged, this, &SessionStore::scheduleSave);
+  if (track(m_windows)) {
+    connect(m_windows, &WindowManager::windowCreated, this, [this](int windowId) {
+      connectWindow(m_windows->browser(windowId), m_windows->splitView(windowId));
+      scheduleSave();
+    });
+    connect(m_windows, &WindowManager::windowClosed, this, &SessionStore::scheduleSave);
+    connect(m_windows, &WindowManager::activeWindowChanged, this, &SessionStore::scheduleSave);
   }
 }
 
-void SessionStore::connectWorkspaceModels()
+bool SessionStore::track(const QObject* object)
 {
-  if (!m_browser) {
+  if (!object || m_connected.contains(object)) {
+    return false;
+  }
+  m_connected.insert(object);
+  // Windows come and go; a recycled address must not look connected.
+  connect(object, &QObject::destroyed, this, [this, object] {
+    m_connected.remove(object);
+  });
+  return true;
+}
+
+void SessionStore::connectWindow(BrowserController* browser, SplitViewController* splitView)
+{
+  connectWorkspaceModels(browser);
+
+  if (track(splitView)) {
+    connect(splitView, &SplitViewController::enabledChanged, this, &SessionStore::scheduleSave);
+    connect(splitView, &SplitViewController::tabsChanged, this, &SessionStore::scheduleSave);
+    connect(splitView, &SplitViewController::focusedPaneChanged, this, &SessionStore::scheduleSave);
+    connect(splitView, &SplitViewController::splitRatioChanged, this, &SessionStore::scheduleSave);
+    connect(splitView, &SplitViewController::gridSplitRatioXChanged, this, &SessionStore::scheduleSave);
+    connect(splitView, &SplitViewController::gridSplitRatioYChanged, this, &SessionStore::scheduleSave);
+  }
+}
+
+void SessionStore::connectWorkspaceModels(BrowserController* browser)
+{
+  if (!browser) {
     return;
   }
 
-  WorkspaceModel* workspaces = m_browser->workspaces();
+  WorkspaceModel* workspaces = browser->workspaces();
   if (!workspaces) {
     return;
   }
 
-  if (!m_connected.contains(workspaces)) {
-    m_connected.insert(workspaces);
+  if (track(workspaces)) {
+    const QPointer<BrowserController> owner(browser);
     connect(workspaces, &WorkspaceModel::activeIndexChanged, this, &SessionStore::scheduleSave);
     connect(workspaces, &QAbstractItemModel::dataChanged, this, &SessionStore::scheduleSave);
-    connect(workspaces, &QAbstractItemModel::rowsInserted, this, [this] {
-      connectWorkspaceModels();
+    connect(workspaces, &QAbstractItemModel::rowsInserted, this, [this, owner] {
+      connectWorkspaceModels(owner);
       scheduleSave();
     });
     connect(workspaces, &QAbstractItemModel::rowsRemoved, this, &SessionStore::scheduleSave);
     connect(workspaces, &QAbstractItemModel::rowsMoved, this, &SessionStore::scheduleSave);
-    connect(workspaces, &QAbstractItemModel::modelReset, this, [this] {
-      connectWorkspaceModels();
+    connect(workspaces, &QAbstractItemModel::modelReset, this, [this, owner] {
+      connectWorkspaceModels(owner);
       scheduleSave();
     });
   }
 
   for (int i = 0; i < workspaces->count(); ++i) {
     TabModel* tabs = workspaces->tabsForIndex(i);
-    if (tabs && !m_connected.contains(tabs)) {
-      m_connected.insert(tabs);
+    if (track(tabs)) {
       connect(tabs, &QAbstractItemModel::dataChanged, this, &SessionStore::scheduleSave);
       connect(tabs, &QAbstractItemModel::rowsInserted, this, &SessionStore::scheduleSave);
       connect(tabs, &QAbstractItemModel::rowsRemoved, this, &SessionStore::scheduleSave);
@@ -106,8 +151,7 @@ void SessionStore::connectWorkspaceModels()
     }
 
     TabGroupModel* groups = workspaces->groupsForIndex(i);
-    if (groups && !m_connected.contains(groups)) {
-      m_connected.insert(groups);
+    if (track(groups)) {
       connect(groups, &QAbstractItemModel::dataChanged, this, &SessionStore::scheduleSave);
       connect(groups, &QAbstractItemModel::rowsInserted, this, &SessionStore::scheduleSave);
       connect(groups, &QAbstractItemModel::rowsRemoved, this, &SessionStore::scheduleSave);
@@ -126,22 +170,21 @@ void SessionStore::scheduleSave()
 
 bool SessionStore::restoreNow(QString* error)
 {
-  if (!m_browser) {
+  if (!m_browser && !m_windows) {
     return false;
   }
 
-  QFile f(sessionPath());
-  if (!f.exists()) {
+  xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (!storage.exists(kSessionName)) {
     return true;
   }
-  if (!f.open(QIODevice::ReadOnly)) {
-    if (error) {
-      *error = f.errorString();
-    }
+
+  QByteArray payload;
+  if (!storage.read(kSessionName, &payload, error)) {
     return false;
   }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
   if (!doc.isObject()) {
     if (error) {
       *error = QStringLiteral("Session file is not a JSON object.");
@@ -161,10 +204,78 @@ bool SessionStore::restoreNow(QString* error)
 
   m_restoring = true;
 
-  WorkspaceModel* workspaces = m_browser->workspaces();
+  // Before multi-window sessions the root itself was the only window.
+  QJsonArray windowsArr;
+  if (version >= kFirstMultiWindowSessionVersion) {
+    windowsArr = root.value("windows").toArray();
+  } else {
+    windowsArr.push_back(root);
+  }
+
+  BrowserController* firstBrowser = m_browser;
+  if (m_windows) {
+    if (m_windows->count() == 0) {
+      m_windows->createWindow();
+    }
+
+    const QVector<int> ids = m_windows->windowIds();
+    const int activeWindowIndex = root.value("activeWindowIndex").toInt(0);
+    int activeWindowId = ids.first();
+    for (int i = 0; i < windowsArr.size(); ++i) {
+      const int windowId = i < ids.size() ? ids.at(i) : m_windows->createWindow();
+      restoreWindow(windowsArr.at(i).toObject(), m_windows->browser(windowId), m_windows->splitView(windowId));
+      if (i == activeWindowIndex) {
+        activeWindowId = windowId;
+      }
+    }
+    m_windows->setActiveWindowId(activeWindowId);
+    firstBrowser = m_windows->browser(ids.first());
+  } else if (!windowsArr.isEmpty()) {
+    // A single-window host gets the first saved window.
+    restoreWindow(windowsArr.first().toObject(), m_browser, m_splitView);
+  }
+
+  if (version < kFirstJournalSessionVersion && firstBrowser && firstBrowser->closedTabJournal()->isEmpty()) {
+    QVector<BrowserController::RecentlyClosedTab> recentlyClosed;
+    const QJsonArray closedArr = root.value("recentlyClosedTabs").toArray();
+    recentlyClosed.reserve(closedArr.size());
+
+    for (const QJsonValue& closedVal : closedArr) {
+      const QJsonObject obj = closedVal.toObject();
+
+      BrowserController::RecentlyClosedTab entry;
+      entry.workspaceId = obj.value("workspaceId").toInt(0);
+      entry.url = QUrl(obj.value("url").toString());
+      entry.initialUrl = QUrl(obj.value("initialUrl").toString());
+      entry.pageTitle = obj.value("pageTitle").toString();
+      entry.customTitle = obj.value("customTitle").toString();
+      entry.essential = obj.value("essential").toBool(false);
+      entry.groupId = obj.value("groupId").toInt(0);
+      entry.faviconUrl = QUrl(obj.value("faviconUrl").toString());
+      entry.closedAtMs = static_cast<qint64>(obj.value("closedAtMs").toDouble(0));
+      recentlyClosed.push_back(entry);
+    }
+
+    firstBrowser->setRecentlyClosedTabs(recentlyClosed);
+  }
+
+  m_restoring = false;
+  if (needsUpgrade) {
+    scheduleSave();
+  }
+  return true;
+}
+
+void SessionStore::restoreWindow(const QJsonObject& obj, BrowserController* browser, SplitViewController* splitView)
+{
+  if (!browser) {
+    return;
+  }
+
+  WorkspaceModel* workspaces = browser->workspaces();
   workspaces->clear();
 
-  const QJsonArray workspacesArr = root.value("workspaces").toArray();
+  const QJsonArray workspacesArr = obj.value("workspaces").toArray();
   for (const QJsonValue& wsVal : workspacesArr) {
     const QJsonObject wsObj = wsVal.toObject();
     const int wsId = wsObj.value("id").toInt();
@@ -235,7 +346,7 @@ bool SessionStore::restoreNow(QString* error)
     workspaces->addWorkspace(QStringLiteral("Default"));
   }
 
-  const int activeWorkspaceId = root.value("activeWorkspaceId").toInt(0);
+  const int activeWorkspaceId = obj.value("activeWorkspaceId").toInt(0);
   int activeWorkspaceIndex = -1;
   for (int i = 0; i < workspaces->count(); ++i) {
     if (workspaces->workspaceIdAt(i) == activeWorkspaceId) {
@@ -249,32 +360,8 @@ bool SessionStore::restoreNow(QString* error)
     workspaces->setActiveIndex(0);
   }
 
-  {
-    QVector<BrowserController::RecentlyClosedTab> recentlyClosed;
-    const QJsonArray closedArr = root.value("recentlyClosedTabs").toArray();
-    recentlyClosed.reserve(closedArr.size());
-
-    for (const QJsonValue& closedVal : closedArr) {
-      const QJsonObject obj = closedVal.toObject();
-
-      BrowserController::RecentlyClosedTab entry;
-      entry.workspaceId = obj.value("workspaceId").toInt(0);
-      entry.url = QUrl(obj.value("url").toString());
-      entry.initialUrl = QUrl(obj.value("initialUrl").toString());
-      entry.pageTitle = obj.value("pageTitle").toString();
-      entry.customTitle = obj.value("customTitle").toString();
-      entry.essential = obj.value("essential").toBool(false);
-      entry.groupId = obj.value("groupId").toInt(0);
-      entry.faviconUrl = QUrl(obj.value("faviconUrl").toString());
-      entry.closedAtMs = static_cast<qint64>(obj.value("closedAtMs").toDouble(0));
-      recentlyClosed.push_back(entry);
-    }
-
-    m_browser->setRecentlyClosedTabs(recentlyClosed);
-  }
-
-  if (m_splitView) {
-    const QJsonObject splitObj = root.value("splitView").toObject();
+  if (splitView) {
+    const QJsonObject splitObj = obj.value("splitView").toObject();
     const bool enabled = splitObj.value("enabled").toBool(false);
     const int primaryTabId = splitObj.value("primaryTabId").toInt(0);
     const int secondaryTabId = splitObj.value("secondaryTabId").toInt(0);
@@ -287,39 +374,58 @@ bool SessionStore::restoreNow(QString* error)
 
     if (!paneIds.isEmpty()) {
       const int restoredCount = qBound(2, qMax(paneCount, paneIds.size()), 4);
-      m_splitView->setPaneCount(restoredCount);
+      splitView->setPaneCount(restoredCount);
       for (int i = 0; i < restoredCount && i < paneIds.size(); ++i) {
-        m_splitView->setTabIdForPane(i, paneIds.at(i).toInt(0));
+        splitView->setTabIdForPane(i, paneIds.at(i).toInt(0));
       }
     } else {
-      m_splitView->setPaneCount(qBound(2, paneCount, 4));
-      m_splitView->setPrimaryTabId(primaryTabId);
-      m_splitView->setSecondaryTabId(secondaryTabId);
+      splitView->setPaneCount(qBound(2, paneCount, 4));
+      splitView->setPrimaryTabId(primaryTabId);
+      splitView->setSecondaryTabId(secondaryTabId);
     }
 
-    m_splitView->setSplitRatio(splitRatio);
-    m_splitView->setGridSplitRatioX(gridSplitRatioX);
-    m_splitView->setGridSplitRatioY(gridSplitRatioY);
-    m_splitView->setEnabled(enabled);
-    m_splitView->setFocusedPane(focusedPane);
+    splitView->setSplitRatio(splitRatio);
+    splitView->setGridSplitRatioX(gridSplitRatioX);
+    splitView->setGridSplitRatioY(gridSplitRatioY);
+    splitView->setEnabled(enabled);
+    splitView->setFocusedPane(focusedPane);
   }
-
-  m_restoring = false;
-  if (needsUpgrade) {
-    scheduleSave();
-  }
-  return true;
 }
 
 bool SessionStore::saveNow(QString* error) const
 {
-  if (!m_browser) {
+  QJsonArray windowsArr;
+  int activeWindowIndex = 0;
+  if (m_windows) {
+    const QVector<int> ids = m_windows->windowIds();
+    for (int i = 0; i < ids.size(); ++i) {
+      if (ids.at(i) == m_windows->activeWindowId()) {
+        activeWindowIndex = i;
+      }
+      windowsArr.push_back(saveWindow(m_windows->browser(ids.at(i)), m_windows->splitView(ids.at(i))));
+    }
+  } else if (m_browser) {
+    windowsArr.push_back(saveWindow(m_browser, m_splitView));
+  }
+  if (windowsArr.isEmpty()) {
     return false;
   }
 
-  WorkspaceModel* workspaces = m_browser->workspaces();
+  QJsonObject root;
+  root.insert("version", kSessionVersion);
+  root.insert("savedAtMs", QDateTime::currentMSecsSinceEpoch());
+  root.insert("activeWindowIndex", activeWindowIndex);
+  root.insert("windows", windowsArr);
+
+  return xbrowser::userDataStorage().write(kSessionName, QJsonDocument(root).toJson(QJsonDocument::Compact), error);
+}
+
+QJsonObject SessionStore::saveWindow(BrowserController* browser, SplitViewController* splitView) const
+{
+  QJsonObject obj;
+  WorkspaceModel* workspaces = browser ? browser->workspaces() : nullptr;
   if (!workspaces) {
-    return false;
+    return obj;
   }
 
   QJsonArray workspacesArr;
@@ -375,69 +481,29 @@ bool SessionStore::saveNow(QString* error) const
     workspacesArr.push_back(wsObj);
   }
 
-  QJsonObject root;
-  root.insert("version", kSessionVersion);
-  root.insert("savedAtMs", QDateTime::currentMSecsSinceEpoch());
-  root.insert("activeWorkspaceId", workspaces->activeWorkspaceId());
-  root.insert("workspaces", workspacesArr);
-
-  {
-    QJsonArray closedArr;
-    const QVector<BrowserController::RecentlyClosedTab> recentlyClosed = m_browser->recentlyClosedTabs();
-
-    for (const BrowserController::RecentlyClosedTab& entry : recentlyClosed) {
-      QJsonObject obj;
-      obj.insert("workspaceId", entry.workspaceId);
-      obj.insert("url", entry.url.toString(QUrl::FullyEncoded));
-      obj.insert("initialUrl", entry.initialUrl.toString(QUrl::FullyEncoded));
-      obj.insert("pageTitle", entry.pageTitle);
-      obj.insert("customTitle", entry.customTitle);
-      obj.insert("essential", entry.essential);
-      obj.insert("groupId", entry.groupId);
-      obj.insert("faviconUrl", entry.faviconUrl.toString(QUrl::FullyEncoded));
-      obj.insert("closedAtMs", static_cast<double>(entry.closedAtMs));
-      closedArr.push_back(obj);
-    }
-
-    root.insert("recentlyClosedTabs", closedArr);
-  }
+  obj.insert("activeWorkspaceId", workspaces->activeWorkspaceId());
+  obj.insert("workspaces", workspacesArr);
 
-  if (m_splitView) {
+  if (splitView) {
     QJsonObject splitObj;
-    splitObj.insert("enabled", m_splitView->enabled());
-    splitObj.insert("primaryTabId", m_splitView->primaryTabId());
-    splitObj.insert("secondaryTabId", m_splitView->secondaryTabId());
-    splitObj.insert("paneCount", m_splitView->paneCount());
+    splitObj.insert("enabled", splitView->enabled());
+    splitObj.insert("primaryTabId", splitView->primaryTabId());
+    splitObj.insert("secondaryTabId", splitView->secondaryTabId());
+    splitObj.insert("paneCount", splitView->paneCount());
 
     QJsonArray paneIds;
-    const int paneCount = m_splitView->paneCount();
+    const int paneCount = splitView->paneCount();
     for (int i = 0; i < paneCount; ++i) {
-      paneIds.push_back(m_splitView->tabIdForPane(i));
+      paneIds.push_back(splitView->tabIdForPane(i));
     }
     splitObj.insert("paneTabIds", paneIds);
 
-    splitObj.insert("focusedPane", m_splitView->focusedPane());
-    splitObj.insert("splitRatio", m_splitView->splitRatio());
-    splitObj.insert("gridSplitRatioX", m_splitView->gridSplitRatioX());
-    splitObj.insert("gridSplitRatioY", m_splitView->gridSplitRatioY());
-    root.insert("splitView", splitObj);
+    splitObj.insert("focusedPane", splitView->focusedPane());
+    splitObj.insert("splitRatio", splitView->splitRatio());
+    splitObj.insert("gridSplitRatioX", splitView->gridSplitRatioX());
+    splitObj.insert("gridSplitRatioY", splitView->gridSplitRatioY());
+    obj.insert("splitView", splitObj);
   }
 
-  QSaveFile out(sessionPath());
-  if (!out.open(QIODevice::WriteOnly)) {
-    if (error) {
-      *error = out.errorString();
-    }
-    return false;
-  }
-
-  out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
-  if (!out.commit()) {
-    if (error) {
-      *error = out.errorString();
-    }
-    return false;
-  }
-
-  return true;
+  return obj;
 }
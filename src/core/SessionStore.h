@@ -1,11 +1,14 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
 #include <QSet>
 #include <QTimer>
 
 class BrowserController;
+class QJsonObject;
 class SplitViewController;
+class WindowManager;
 
 class SessionStore : public QObject
 {
@@ -15,16 +18,25 @@ public:
   explicit SessionStore(QObject* parent = nullptr);
 
   void attach(BrowserController* browser, SplitViewController* splitView);
+  // Saves and restores every window; the manager should already have the
+  // window the first saved one is restored into.
+  void attach(WindowManager* windows);
 
   bool restoreNow(QString* error = nullptr);
   bool saveNow(QString* error = nullptr) const;
 
 private:
-  void connectWorkspaceModels();
+  void connectWindow(BrowserController* browser, SplitViewController* splitView);
+  void connectWorkspaceModels(BrowserController* browser);
+  bool track(const QObject* object);
   void scheduleSave();
 
+  void restoreWindow(const QJsonObject& obj, BrowserController* browser, SplitViewController* splitView);
+  QJsonObject saveWindow(BrowserController* browser, SplitViewController* splitView) const;
+
   BrowserController* m_browser = nullptr;
   SplitViewController* m_splitView = nullptr;
+  QPointer<WindowManager> m_windows;
   mutable QTimer m_saveTimer;
   mutable bool m_restoring = false;
   QSet<const QObject*> m_connected;
@@ -390,6 +390,7 @@ QVector<ShortcutStore::Entry> ShortcutStore::buildDefaults() const
 
   add(QStringLiteral("next-tab"), QStringLiteral("Tabs"), QStringLiteral("Next Tab"), QStringLiteral("next-tab"), QStringLiteral("Ctrl+Tab"));
   add(QStringLiteral("prev-tab"), QStringLiteral("Tabs"), QStringLiteral("Previous Tab"), QStringLiteral("prev-tab"), QStringLiteral("Ctrl+Shift+Tab"));
+  add(QStringLiteral("recent-tab"), QStringLiteral("Tabs"), QStringLiteral("Switch to Last Used Tab"), QStringLiteral("recent-tab"), QStringLiteral("Ctrl+`"));
 
   add(QStringLiteral("open-downloads"), QStringLiteral("Tools"), QStringLiteral("Downloads"), QStringLiteral("open-downloads"), QStringLiteral("Ctrl+J"));
   add(QStringLiteral("open-history"), QStringLiteral("Tools"), QStringLiteral("History"), QStringLiteral("open-history"), QStringLiteral("Ctrl+H"));
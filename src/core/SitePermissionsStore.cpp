@@ -1,12 +1,10 @@
 #include "SitePermissionsStore.h"
 
-#include "AppPaths.h"
+#include "PublicSuffixList.h"
+#include "UserDataStorage.h"
 
-#include <QDir>
-#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QSaveFile>
 #include <QUrl>
 
 namespace
@@ -14,6 +12,8 @@ namespace
 constexpr int kStateDefault = 0;
 constexpr int kStateAllow = 1;
 constexpr int kStateDeny = 2;
+
+const QString kStorageName = QStringLiteral("permissions.json");
 }
 
 SitePermissionsStore& SitePermissionsStore::instance()
@@ -51,14 +51,23 @@ QString SitePermissionsStore::normalizeOrigin(const QString& uriOrOrigin)
   return origin;
 }
 
+QString SitePermissionsStore::siteForOrigin(const QString& uriOrOrigin)
+{
+  const QUrl url(normalizeOrigin(uriOrOrigin));
+  if (!url.isValid() || url.host().isEmpty()) {
+    return {};
+  }
+  return PublicSuffixList::siteKey(url.host());
+}
+
 void SitePermissionsStore::ensureStoragePath()
 {
-  const QString nextPath = QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("permissions.json"));
-  if (nextPath == m_storagePath) {
+  const QString nextKey = xbrowser::userDataStorage().locationKey(kStorageName);
+  if (nextKey == m_storageKey) {
     return;
   }
 
-  m_storagePath = nextPath;
+  m_storageKey = nextKey;
   m_loaded = false;
   m_decisions.clear();
 }
@@ -72,12 +81,13 @@ void SitePermissionsStore::ensureLoaded()
   }
   m_loaded = true;
 
-  QFile f(m_storagePath);
-  if (!f.exists() || !f.open(QIODevice::ReadOnly)) {
+  QByteArray payload;
+  const xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+  if (!storage.exists(kStorageName) || !storage.read(kStorageName, &payload)) {
     return;
   }
 
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  const QJsonDocument doc = QJsonDocument::fromJson(payload);
   if (!doc.isObject()) {
     return;
   }
@@ -112,7 +122,7 @@ void SitePermissionsStore::ensureLoaded()
 bool SitePermissionsStore::saveNow()
 {
   ensureStoragePath();
-  if (m_storagePath.isEmpty()) {
+  if (m_storageKey.isEmpty()) {
     return false;
   }
 
@@ -138,12 +148,7 @@ bool SitePermissionsStore::saveNow()
   root.insert(QStringLiteral("version"), 1);
   root.insert(QStringLiteral("origins"), originsObj);
 
-  QSaveFile out(m_storagePath);
-  if (!out.open(QIODevice::WriteOnly)) {
-    return false;
-  }
-  out.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
-  return out.commit();
+  return xbrowser::userDataStorage().write(kStorageName, QJsonDocument(root).toJson(QJsonDocument::Compact));
 }
 
 void SitePermissionsStore::bumpRevision()
@@ -248,6 +253,36 @@ void SitePermissionsStore::clearOrigin(const QString& origin)
   bumpRevision();
 }
 
+int SitePermissionsStore::clearSite(const QString& origin)
+{
+  ensureLoaded();
+
+  const QString key = normalizeOrigin(origin);
+  const QString site = siteForOrigin(key);
+  if (key.isEmpty()) {
+    return 0;
+  }
+
+  // Origins without a host (e.g. file://) only match themselves.
+  int removed = 0;
+  for (auto it = m_decisions.begin(); it != m_decisions.end();) {
+    if (site.isEmpty() ? it.key() == key : siteForOrigin(it.key()) == site) {
+      it = m_decisions.erase(it);
+      ++removed;
+    } else {
+      ++it;
+    }
+  }
+
+  if (removed == 0) {
+    return 0;
+  }
+
+  saveNow();
+  bumpRevision();
+  return removed;
+}
+
 void SitePermissionsStore::clearAll()
 {
   ensureLoaded();
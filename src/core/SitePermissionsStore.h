@@ -19,11 +19,13 @@ public:
   Q_INVOKABLE int decision(const QString& origin, int permissionKind);
   Q_INVOKABLE void setDecision(const QString& origin, int permissionKind, int state);
   Q_INVOKABLE void clearOrigin(const QString& origin);
+  Q_INVOKABLE int clearSite(const QString& origin);
   Q_INVOKABLE void clearAll();
   Q_INVOKABLE void reload();
   Q_INVOKABLE QStringList origins();
 
   static QString normalizeOrigin(const QString& uriOrOrigin);
+  static QString siteForOrigin(const QString& uriOrOrigin);
 
 signals:
   void revisionChanged();
@@ -36,7 +38,7 @@ private:
   bool saveNow();
   void bumpRevision();
 
-  QString m_storagePath;
+  QString m_storageKey;
   bool m_loaded = false;
   QHash<QString, QHash<int, int>> m_decisions;
   int m_revision = 0;
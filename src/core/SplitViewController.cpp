@@ -358,12 +358,15 @@ double SplitViewController::splitRatio() const
 
 void SplitViewController::setSplitRatio(double ratio)
 {
-  const double next = qBound(0.1, ratio, 0.9);
+  const double next = clampRatio(ratio);
   if (qFuzzyCompare(m_splitRatio, next)) {
     return;
   }
   m_splitRatio = next;
   emit splitRatioChanged();
+  if (m_dragDivider != SplitDivider) {
+    emit liveSplitRatioChanged();
+  }
 }
 
 double SplitViewController::gridSplitRatioX() const
@@ -373,12 +376,15 @@ double SplitViewController::gridSplitRatioX() const
 
 void SplitViewController::setGridSplitRatioX(double ratio)
 {
-  const double next = qBound(0.1, ratio, 0.9);
+  const double next = clampRatio(ratio);
   if (qFuzzyCompare(m_gridSplitRatioX, next)) {
     return;
   }
   m_gridSplitRatioX = next;
   emit gridSplitRatioXChanged();
+  if (m_dragDivider != GridXDivider) {
+    emit liveGridSplitRatioXChanged();
+  }
 }
 
 double SplitViewController::gridSplitRatioY() const
@@ -388,12 +394,116 @@ double SplitViewController::gridSplitRatioY() const
 
 void SplitViewController::setGridSplitRatioY(double ratio)
 {
-  const double next = qBound(0.1, ratio, 0.9);
+  const double next = clampRatio(ratio);
   if (qFuzzyCompare(m_gridSplitRatioY, next)) {
     return;
   }
   m_gridSplitRatioY = next;
   emit gridSplitRatioYChanged();
+  if (m_dragDivider != GridYDivider) {
+    emit liveGridSplitRatioYChanged();
+  }
+}
+
+double SplitViewController::liveSplitRatio() const
+{
+  return m_dragDivider == SplitDivider ? m_dragRatio : m_splitRatio;
+}
+
+double SplitViewController::liveGridSplitRatioX() const
+{
+  return m_dragDivider == GridXDivider ? m_dragRatio : m_gridSplitRatioX;
+}
+
+double SplitViewController::liveGridSplitRatioY() const
+{
+  return m_dragDivider == GridYDivider ? m_dragRatio : m_gridSplitRatioY;
+}
+
+bool SplitViewController::dividerDragActive() const
+{
+  return m_dragDivider >= 0;
+}
+
+void SplitViewController::beginDividerDrag(int divider)
+{
+  if (divider < SplitDivider || divider > GridYDivider) {
+    return;
+  }
+  if (m_dragDivider >= 0) {
+    commitDividerDrag();
+  }
+
+  m_dragDivider = divider;
+  m_dragRatio = divider == SplitDivider ? m_splitRatio : (divider == GridXDivider ? m_gridSplitRatioX : m_gridSplitRatioY);
+  emit dividerDragActiveChanged();
+}
+
+void SplitViewController::updateDividerDrag(double ratio)
+{
+  if (m_dragDivider < 0) {
+    return;
+  }
+
+  const double next = clampRatio(ratio);
+  if (qFuzzyCompare(m_dragRatio, next)) {
+    return;
+  }
+  m_dragRatio = next;
+  emitLiveRatioChanged(m_dragDivider);
+}
+
+void SplitViewController::commitDividerDrag()
+{
+  if (m_dragDivider < 0) {
+    return;
+  }
+
+  const int divider = std::exchange(m_dragDivider, -1);
+  emit dividerDragActiveChanged();
+
+  switch (divider) {
+    case SplitDivider:
+      setSplitRatio(m_dragRatio);
+      break;
+    case GridXDivider:
+      setGridSplitRatioX(m_dragRatio);
+      break;
+    case GridYDivider:
+      setGridSplitRatioY(m_dragRatio);
+      break;
+  }
+}
+
+void SplitViewController::cancelDividerDrag()
+{
+  if (m_dragDivider < 0) {
+    return;
+  }
+
+  const int divider = std::exchange(m_dragDivider, -1);
+  emit dividerDragActiveChanged();
+  emitLiveRatioChanged(divider);
+}
+
+double SplitViewController::clampRatio(double ratio)
+{
+  return qBound(0.1, ratio, 0.9);
+}
+
+void SplitViewController::emitLiveRatioChanged(int divider)
+{
+  switch (divider) {
+    case SplitDivider:
+      emit liveSplitRatioChanged();
+      break;
+    case GridXDivider:
+      emit liveGridSplitRatioXChanged();
+      break;
+    case GridYDivider:
+      emit liveGridSplitRatioYChanged();
+      break;
+  }
 }
 
 void SplitViewController::connectTabsModel()
@@ -23,7 +23,22 @@ class SplitViewController : public QObject
   Q_PROPERTY(double gridSplitRatioX READ gridSplitRatioX WRITE setGridSplitRatioX NOTIFY gridSplitRatioXChanged)
   Q_PROPERTY(double gridSplitRatioY READ gridSplitRatioY WRITE setGridSplitRatioY NOTIFY gridSplitRatioYChanged)
 
+  // What the panes are laid out with: the committed ratios, except for the
+  // divider being dragged, which follows the pointer until the drag commits.
+  Q_PROPERTY(double liveSplitRatio READ liveSplitRatio NOTIFY liveSplitRatioChanged)
+  Q_PROPERTY(double liveGridSplitRatioX READ liveGridSplitRatioX NOTIFY liveGridSplitRatioXChanged)
+  Q_PROPERTY(double liveGridSplitRatioY READ liveGridSplitRatioY NOTIFY liveGridSplitRatioYChanged)
+  Q_PROPERTY(bool dividerDragActive READ dividerDragActive NOTIFY dividerDragActiveChanged)
+
 public:
+  enum Divider
+  {
+    SplitDivider,
+    GridXDivider,
+    GridYDivider,
+  };
+  Q_ENUM(Divider)
+
   explicit SplitViewController(QObject* parent = nullptr);
 
   void setBrowser(BrowserController* browser);
@@ -61,6 +76,18 @@ public:
   double gridSplitRatioY() const;
   void setGridSplitRatioY(double ratio);
 
+  double liveSplitRatio() const;
+  double liveGridSplitRatioX() const;
+  double liveGridSplitRatioY() const;
+  bool dividerDragActive() const;
+
+  // Dragging a divider only moves the live ratio; the committed ratio, its
+  // change signal and with it the session save are updated once, on commit.
+  Q_INVOKABLE void beginDividerDrag(int divider);
+  Q_INVOKABLE void updateDividerDrag(double ratio);
+  Q_INVOKABLE void commitDividerDrag();
+  Q_INVOKABLE void cancelDividerDrag();
+
 signals:
   void enabledChanged();
   void tabsChanged();
@@ -68,8 +95,15 @@ signals:
   void splitRatioChanged();
   void gridSplitRatioXChanged();
   void gridSplitRatioYChanged();
+  void liveSplitRatioChanged();
+  void liveGridSplitRatioXChanged();
+  void liveGridSplitRatioYChanged();
+  void dividerDragActiveChanged();
 
 private:
+  static double clampRatio(double ratio);
+  void emitLiveRatioChanged(int divider);
+
   void connectTabsModel();
   bool ensureTabs();
   int ensureTabExists();
@@ -85,4 +119,6 @@ private:
   double m_splitRatio = 0.5;
   double m_gridSplitRatioX = 0.5;
   double m_gridSplitRatioY = 0.5;
+  int m_dragDivider = -1;
+  double m_dragRatio = 0.5;
 };
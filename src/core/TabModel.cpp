@@ -1,62 +1,31 @@
 #include "TabModel.h"
 
-#include "AppPaths.h"
+#include "ThumbnailStore.h"
 
 #include <QDateTime>
-#include <QDir>
-#include <QFile>
-#include <QFileInfo>
-#include <QUrlQuery>
-
-#include <algorithm>
 
 namespace
 {
-bool isUnderDataRoot(const QString& absoluteFilePath)
-{
-  if (absoluteFilePath.trimmed().isEmpty()) {
-    return false;
-  }
-
-  const QString rootPath = QDir::fromNativeSeparators(QDir(xbrowser::appDataRoot()).absolutePath());
-  QString root = QDir::cleanPath(rootPath);
-  if (!root.endsWith('/')) {
-    root += '/';
-  }
-
-  const QString candidate =
-    QDir::cleanPath(QDir::fromNativeSeparators(QFileInfo(absoluteFilePath).absoluteFilePath()));
-  return candidate.startsWith(root, Qt::CaseInsensitive);
-}
-
-void removeFileIfSafe(const QString& path)
-{
-  if (path.trimmed().isEmpty()) {
-    return;
-  }
-  if (!isUnderDataRoot(path)) {
-    return;
-  }
-  QFile::remove(path);
-}
+constexpr int kMaxLocalClosedTabs = 20;
+constexpr qint64 kLocalClosedTabsByteBudget = 32LL * 1024LL;
 
-QUrl thumbnailUrlFor(const QString& path, int version)
+int nextThumbnailOwnerId()
 {
-  if (path.trimmed().isEmpty()) {
-    return {};
-  }
-
-  QUrl url = QUrl::fromLocalFile(path);
-  QUrlQuery query;
-  query.addQueryItem(QStringLiteral("t"), QString::number(qMax(0, version)));
-  url.setQuery(query);
-  return url;
+  static int nextId = 1;
+  return nextId++;
 }
 }
 
 TabModel::TabModel(QObject* parent)
   : QAbstractListModel(parent)
+  , m_thumbnailOwnerId(nextThumbnailOwnerId())
+{
+  connect(&ThumbnailStore::instance(), &ThumbnailStore::thumbnailChanged, this, &TabModel::handleThumbnailChanged);
+}
+
+TabModel::~TabModel()
 {
+  ThumbnailStore::instance().removeOwner(m_thumbnailOwnerId);
 }
 
 int TabModel::rowCount(const QModelIndex& parent) const
@@ -97,7 +66,7 @@ QVariant TabModel::data(const QModelIndex& index, int role) const
     case FaviconUrlRole:
       return tab.faviconUrl;
     case ThumbnailUrlRole:
-      return thumbnailUrlFor(tab.thumbnailPath, tab.thumbnailVersion);
+      return ThumbnailStore::instance().urlFor(thumbnailKey(tab.id));
     case IsLoadingRole:
       return tab.isLoading;
     case IsAudioPlayingRole:
@@ -229,14 +198,11 @@ void TabModel::clear()
   const bool hadSelection = !m_selectedTabIds.isEmpty();
 
   beginResetModel();
-  for (const auto& tab : m_tabs) {
-    removeFileIfSafe(tab.thumbnailPath);
-  }
-  for (const auto& tab : m_closedTabs) {
-    removeFileIfSafe(tab.thumbnailPath);
-  }
+  ThumbnailStore::instance().removeOwner(m_thumbnailOwnerId);
   m_tabs.clear();
-  m_closedTabs.clear();
+  if (m_closedTabJournal && m_closedTabJournal->parent() == this) {
+    m_closedTabJournal->clear();
+  }
   m_selectedTabIds.clear();
   m_activeIndex = -1;
   m_nextId = 1;
@@ -534,57 +500,32 @@ QUrl TabModel::thumbnailUrlAt(int index) const
     return {};
   }
 
-  const auto& tab = m_tabs[index];
-  return thumbnailUrlFor(tab.thumbnailPath, tab.thumbnailVersion);
+  return ThumbnailStore::instance().urlFor(thumbnailKey(m_tabs[index].id));
 }
 
 void TabModel::setThumbnailPathById(int tabId, const QString& filePath)
 {
-  if (tabId <= 0) {
-    return;
-  }
-
-  const int index = indexOfTabId(tabId);
-  if (index < 0 || index >= m_tabs.size()) {
+  if (tabId <= 0 || indexOfTabId(tabId) < 0) {
     return;
   }
 
-  auto& tab = m_tabs[index];
+  ThumbnailStore& store = ThumbnailStore::instance();
   const QString trimmed = filePath.trimmed();
-
-  if (!trimmed.isEmpty() && tab.thumbnailPath != trimmed) {
-    removeFileIfSafe(tab.thumbnailPath);
-    tab.thumbnailPath = trimmed;
-  } else if (trimmed.isEmpty() && !tab.thumbnailPath.isEmpty()) {
-    removeFileIfSafe(tab.thumbnailPath);
-    tab.thumbnailPath.clear();
+  if (trimmed.isEmpty()) {
+    store.remove(thumbnailKey(tabId));
+    return;
   }
 
-  tab.thumbnailVersion++;
-  tab.thumbnailLastUsedMs = QDateTime::currentMSecsSinceEpoch();
-
-  enforceThumbnailLimit(tabId);
-  emit dataChanged(this->index(index), this->index(index), {ThumbnailUrlRole});
+  store.submit(thumbnailKey(tabId), trimmed);
 }
 
 void TabModel::markThumbnailUsedById(int tabId)
 {
-  if (tabId <= 0) {
-    return;
-  }
-
-  const int index = indexOfTabId(tabId);
-  if (index < 0 || index >= m_tabs.size()) {
-    return;
-  }
-
-  auto& tab = m_tabs[index];
-  if (tab.thumbnailPath.isEmpty()) {
+  if (tabId <= 0 || indexOfTabId(tabId) < 0) {
     return;
   }
 
-  tab.thumbnailLastUsedMs = QDateTime::currentMSecsSinceEpoch();
-  enforceThumbnailLimit(tabId);
+  ThumbnailStore::instance().touch(thumbnailKey(tabId));
 }
 
 bool TabModel::isLoadingAt(int index) const
@@ -731,25 +672,67 @@ void TabModel::setCustomTitleAt(int index, const QString& title)
 
 bool TabModel::canRestoreLastClosedTab() const
 {
-  return !m_closedTabs.isEmpty();
+  return m_closedTabJournal && m_closedTabJournal->newestIndexForWorkspace(m_workspaceId) >= 0;
 }
 
 int TabModel::restoreLastClosedTab()
 {
-  if (m_closedTabs.isEmpty()) {
+  if (!m_closedTabJournal) {
+    return -1;
+  }
+
+  const int journalIndex = m_closedTabJournal->newestIndexForWorkspace(m_workspaceId);
+  if (journalIndex < 0) {
+    return -1;
+  }
+
+  const ClosedTabJournal::Record record = m_closedTabJournal->takeAt(journalIndex);
+  if (record.tabs.isEmpty()) {
     return -1;
   }
+  return addClosedTab(record.tabs.first(), true);
+}
+
+void TabModel::setClosedTabJournal(ClosedTabJournal* journal, int workspaceId)
+{
+  if (m_closedTabJournal && m_closedTabJournal != journal && m_closedTabJournal->parent() == this) {
+    delete m_closedTabJournal;
+  }
+  m_closedTabJournal = journal;
+  m_workspaceId = workspaceId;
+}
+
+ClosedTabJournal::TabRecord TabModel::closedTabRecordAt(int index) const
+{
+  ClosedTabJournal::TabRecord record;
+  if (index < 0 || index >= m_tabs.size()) {
+    return record;
+  }
 
-  const TabEntry entry = m_closedTabs.takeLast();
-  const int idx = addTabWithId(0, entry.url, entry.pageTitle, true);
-  setInitialUrlAt(idx, entry.initialUrl.isValid() ? entry.initialUrl : entry.url);
-  setCustomTitleAt(idx, entry.customTitle);
-  setEssentialAt(idx, entry.essential);
-  setGroupIdAt(idx, entry.groupId);
-  setFaviconUrlAt(idx, entry.faviconUrl);
-  setLoadingAt(idx, false);
-  setAudioPlayingAt(idx, false);
-  setMutedAt(idx, false);
+  const auto& tab = m_tabs[index];
+  record.workspaceId = m_workspaceId;
+  record.groupId = tab.groupId;
+  record.essential = tab.essential;
+  record.url = tab.url.toString(QUrl::FullyEncoded);
+  record.initialUrl = tab.initialUrl.toString(QUrl::FullyEncoded);
+  record.pageTitle = tab.pageTitle;
+  record.customTitle = tab.customTitle;
+  record.faviconUrl = tab.faviconUrl.toString(QUrl::FullyEncoded);
+  return record;
+}
+
+int TabModel::addClosedTab(const ClosedTabJournal::TabRecord& record, bool makeActive, int tabId)
+{
+  const QUrl parsedUrl(record.url);
+  const QUrl url = parsedUrl.isValid() && !parsedUrl.isEmpty() ? parsedUrl : QUrl("about:blank");
+  const QUrl initialUrl(record.initialUrl);
+
+  const int idx = addTabWithId(tabId, url, record.pageTitle, makeActive);
+  setInitialUrlAt(idx, initialUrl.isValid() && !initialUrl.isEmpty() ? initialUrl : url);
+  setCustomTitleAt(idx, record.customTitle);
+  setEssentialAt(idx, record.essential);
+  setGroupIdAt(idx, record.groupId);
+  setFaviconUrlAt(idx, QUrl(record.faviconUrl));
   return idx;
 }
 
@@ -759,17 +742,14 @@ void TabModel::removeTabInternal(int index, bool recordClosed)
     return;
   }
 
-  removeFileIfSafe(m_tabs[index].thumbnailPath);
+  ThumbnailStore::instance().remove(thumbnailKey(m_tabs[index].id));
 
   const int removedTabId = m_tabs[index].id;
   const bool selectionWasChanged = m_selectedTabIds.contains(removedTabId);
   m_selectedTabIds.remove(removedTabId);
 
   if (recordClosed) {
-    if (m_closedTabs.size() >= 20) {
-      m_closedTabs.removeFirst();
-    }
-    m_closedTabs.push_back(m_tabs[index]);
+    ensureClosedTabJournal()->push(ClosedTabJournal::Kind::Tab, {closedTabRecordAt(index)});
   }
 
   beginRemoveRows(QModelIndex(), index, index);
@@ -800,49 +780,28 @@ void TabModel::updateActiveIndexAfterClose(int closedIndex)
   }
 }
 
-void TabModel::enforceThumbnailLimit(int keepTabId)
+ClosedTabJournal* TabModel::ensureClosedTabJournal()
 {
-  QVector<int> withThumb;
-  withThumb.reserve(m_tabs.size());
-
-  for (int i = 0; i < m_tabs.size(); ++i) {
-    if (!m_tabs[i].thumbnailPath.isEmpty()) {
-      withThumb.push_back(i);
-    }
+  if (!m_closedTabJournal) {
+    m_closedTabJournal = new ClosedTabJournal(kMaxLocalClosedTabs, kLocalClosedTabsByteBudget, this);
   }
+  return m_closedTabJournal;
+}
+
+quint64 TabModel::thumbnailKey(int tabId) const
+{
+  return ThumbnailStore::makeKey(m_thumbnailOwnerId, tabId);
+}
 
-  if (withThumb.size() <= kMaxThumbnails) {
+void TabModel::handleThumbnailChanged(quint64 key)
+{
+  if (ThumbnailStore::ownerIdForKey(key) != m_thumbnailOwnerId) {
     return;
   }
 
-  std::sort(withThumb.begin(), withThumb.end(), [this, keepTabId](int a, int b) {
-    const auto& ta = m_tabs[a];
-    const auto& tb = m_tabs[b];
-
-    const bool aKeep = keepTabId > 0 && ta.id == keepTabId;
-    const bool bKeep = keepTabId > 0 && tb.id == keepTabId;
-    if (aKeep != bKeep) {
-      return !aKeep;
-    }
-
-    if (ta.thumbnailLastUsedMs != tb.thumbnailLastUsedMs) {
-      return ta.thumbnailLastUsedMs < tb.thumbnailLastUsedMs;
-    }
-    return ta.id < tb.id;
-  });
-
-  const int toEvict = withThumb.size() - kMaxThumbnails;
-  for (int i = 0; i < toEvict; ++i) {
-    const int index = withThumb[i];
-    auto& tab = m_tabs[index];
-    if (keepTabId > 0 && tab.id == keepTabId) {
-      continue;
-    }
-
-    removeFileIfSafe(tab.thumbnailPath);
-    tab.thumbnailPath.clear();
-    tab.thumbnailVersion++;
-    tab.thumbnailLastUsedMs = 0;
-    emit dataChanged(this->index(index), this->index(index), {ThumbnailUrlRole});
+  const int row = indexOfTabId(ThumbnailStore::tabIdForKey(key));
+  if (row < 0) {
+    return;
   }
+  emit dataChanged(index(row), index(row), {ThumbnailUrlRole});
 }
@@ -7,6 +7,8 @@
 #include <QVariant>
 #include <QVector>
 
+#include "ClosedTabJournal.h"
+
 class TabModel : public QAbstractListModel
 {
   Q_OBJECT
@@ -35,6 +37,7 @@ public:
   Q_ENUM(Role)
 
   explicit TabModel(QObject* parent = nullptr);
+  ~TabModel() override;
 
   int rowCount(const QModelIndex& parent = QModelIndex()) const override;
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
@@ -102,6 +105,10 @@ public:
   Q_INVOKABLE bool canRestoreLastClosedTab() const;
   Q_INVOKABLE int restoreLastClosedTab();
 
+  void setClosedTabJournal(ClosedTabJournal* journal, int workspaceId);
+  ClosedTabJournal::TabRecord closedTabRecordAt(int index) const;
+  int addClosedTab(const ClosedTabJournal::TabRecord& record, bool makeActive = true, int tabId = 0);
+
 signals:
   void activeIndexChanged();
   void selectionChanged();
@@ -117,9 +124,6 @@ private:
     bool essential = false;
     int groupId = 0;
     QUrl faviconUrl;
-    QString thumbnailPath;
-    int thumbnailVersion = 0;
-    qint64 thumbnailLastUsedMs = 0;
     bool isLoading = false;
     bool isAudioPlaying = false;
     bool isMuted = false;
@@ -127,14 +131,16 @@ private:
   };
 
   QVector<TabEntry> m_tabs;
-  QVector<TabEntry> m_closedTabs;
+  ClosedTabJournal* m_closedTabJournal = nullptr;
+  int m_workspaceId = 0;
   QSet<int> m_selectedTabIds;
   int m_activeIndex = -1;
   int m_nextId = 1;
+  int m_thumbnailOwnerId = 0;
 
-  static constexpr int kMaxThumbnails = 30;
-
+  ClosedTabJournal* ensureClosedTabJournal();
+  quint64 thumbnailKey(int tabId) const;
+  void handleThumbnailChanged(quint64 key);
   void removeTabInternal(int index, bool recordClosed);
   void updateActiveIndexAfterClose(int closedIndex);
-  void enforceThumbnailLimit(int keepTabId = 0);
 };
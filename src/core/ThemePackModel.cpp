@@ -2,15 +2,23 @@
 
 #include "AppPaths.h"
 
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDeadlineTimer>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkReply>
 #include <QSaveFile>
+#include <QSet>
 
 namespace
 {
+constexpr int kCatalogIndexVersion = 1;
+
 QColor parseColor(const QJsonValue& value)
 {
   const QString s = value.toString().trimmed();
@@ -46,9 +54,17 @@ bool isSafeThemeId(const QString& id)
 ThemePackModel::ThemePackModel(QObject* parent)
   : QAbstractListModel(parent)
 {
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(5000);
   refresh();
 }
 
+ThemePackModel::~ThemePackModel()
+{
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
 int ThemePackModel::rowCount(const QModelIndex& parent) const
 {
   if (parent.isValid()) {
@@ -105,6 +121,11 @@ bool ThemePackModel::busy() const
   return m_busy;
 }
 
+bool ThemePackModel::scanning() const
+{
+  return m_scanning;
+}
+
 QString ThemePackModel::lastError() const
 {
   return m_lastError;
@@ -117,12 +138,23 @@ int ThemePackModel::count() const
 
 void ThemePackModel::refresh()
 {
-  beginResetModel();
-  m_themeById.clear();
-  m_themeOrder.clear();
-  addBuiltInThemes();
-  loadThemesFromDisk();
-  endResetModel();
+  if (m_themeOrder.isEmpty()) {
+    const QVector<CatalogRecord> cached = readCatalogIndex(catalogIndexPath());
+
+    beginResetModel();
+    m_themeById.clear();
+    m_loadedTokens.clear();
+    addBuiltInThemes();
+    addCatalogEntries(cached);
+    endResetModel();
+
+    m_catalog.clear();
+    for (const CatalogRecord& record : cached) {
+      m_catalog.insert(record.fileName, record);
+    }
+  }
+
+  startScan();
 }
 
 void ThemePackModel::installFromUrl(const QUrl& url)
@@ -203,6 +235,7 @@ void ThemePackModel::uninstallTheme(const QString& themeId)
   }
 
   QFile::remove(it.value().filePath);
+  removeEntryAt(m_themeOrder.indexOf(trimmed));
   refresh();
 }
 
@@ -297,15 +330,54 @@ bool ThemePackModel::tokensForThemeId(const QString& themeId, xbrowser::ThemeTok
     return false;
   }
 
-  const auto it = m_themeById.constFind(themeId.trimmed());
+  const QString id = themeId.trimmed();
+  const auto it = m_themeById.constFind(id);
   if (it == m_themeById.constEnd()) {
+    // The background scan may not have reached a freshly installed pack yet.
+    return isSafeThemeId(id) && loadTokensFromFile(filePathForThemeId(id), id, out);
+  }
+
+  const ThemePackEntry& entry = it.value();
+  if (entry.tokens.builtIn) {
+    *out = entry.tokens;
+    return true;
+  }
+
+  const auto cached = m_loadedTokens.constFind(id);
+  if (cached != m_loadedTokens.constEnd()) {
+    *out = cached.value();
+    return true;
+  }
+
+  xbrowser::ThemeTokens tokens;
+  if (!loadTokensFromFile(entry.filePath, id, &tokens)) {
     return false;
   }
+  m_loadedTokens.insert(id, tokens);
+  *out = tokens;
+  return true;
+}
 
-  *out = it.value().tokens;
+bool ThemePackModel::waitForScan(int msecs)
+{
+  const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+  while (m_pendingScans > 0) {
+    if (!m_pool.waitForDone(static_cast<int>(deadline.remainingTime()))) {
+      return false;
+    }
+    QCoreApplication::sendPostedEvents(this);
+    if (deadline.hasExpired() && m_pendingScans > 0) {
+      return false;
+    }
+  }
   return true;
 }
 
+int ThemePackModel::lastScanParsedCount() const
+{
+  return m_lastScanParsedCount;
+}
+
 void ThemePackModel::setBusy(bool busy)
 {
   if (m_busy == busy) {
@@ -315,6 +387,15 @@ void ThemePackModel::setBusy(bool busy)
   emit busyChanged();
 }
 
+void ThemePackModel::setScanning(bool scanning)
+{
+  if (m_scanning == scanning) {
+    return;
+  }
+  m_scanning = scanning;
+  emit scanningChanged();
+}
+
 void ThemePackModel::setLastError(const QString& error)
 {
   const QString trimmed = error.trimmed();
@@ -356,29 +437,269 @@ void ThemePackModel::addBuiltInThemes()
   }
 }
 
-void ThemePackModel::loadThemesFromDisk()
+void ThemePackModel::addCatalogEntries(const QVector<CatalogRecord>& records)
 {
-  QDir dir(themesDir());
-  const QStringList files = dir.entryList({ "*.json" }, QDir::Files, QDir::Name);
-  for (const QString& fileName : files) {
-    QFile f(dir.filePath(fileName));
-    if (!f.open(QIODevice::ReadOnly)) {
+  const QString dir = themesDir();
+  for (const CatalogRecord& record : records) {
+    if (record.id.isEmpty() || m_themeById.contains(record.id)) {
       continue;
     }
+    m_themeById.insert(record.id, entryFromRecord(record, dir));
+    m_themeOrder.push_back(record.id);
+  }
+}
 
-    ThemePackEntry parsed;
-    QString error;
-    if (!parseThemeJson(f.readAll(), &parsed, &error)) {
+void ThemePackModel::startScan()
+{
+  const int generation = ++m_scanGeneration;
+  ++m_pendingScans;
+  setScanning(true);
+
+  const QString dir = themesDir();
+  const QString indexPath = catalogIndexPath();
+  const QHash<QString, CatalogRecord> cached = m_catalog;
+
+  m_pool.start([this, generation, dir, indexPath, cached] {
+    const ScanResult result = scanCatalog(generation, dir, indexPath, cached);
+    QMetaObject::invokeMethod(this, [this, result] { applyScan(result); }, Qt::QueuedConnection);
+  });
+}
+
+void ThemePackModel::applyScan(const ScanResult& result)
+{
+  m_pendingScans = qMax(0, m_pendingScans - 1);
+  if (result.generation != m_scanGeneration) {
+    return;
+  }
+
+  m_catalog.clear();
+  for (const CatalogRecord& record : result.records) {
+    m_catalog.insert(record.fileName, record);
+  }
+  m_lastScanParsedCount = result.parsedCount;
+
+  int firstFileRow = 0;
+  while (firstFileRow < m_themeOrder.size() && m_themeById.value(m_themeOrder.at(firstFileRow)).tokens.builtIn) {
+    ++firstFileRow;
+  }
+
+  const QString dir = themesDir();
+  QVector<ThemePackEntry> next;
+  QSet<QString> nextIds;
+  for (int row = 0; row < firstFileRow; ++row) {
+    nextIds.insert(m_themeOrder.at(row));
+  }
+  for (const CatalogRecord& record : result.records) {
+    if (record.id.isEmpty() || nextIds.contains(record.id)) {
       continue;
     }
+    nextIds.insert(record.id);
+    next.push_back(entryFromRecord(record, dir));
+  }
+
+  for (int row = m_themeOrder.size() - 1; row >= firstFileRow; --row) {
+    if (!nextIds.contains(m_themeOrder.at(row))) {
+      removeEntryAt(row);
+    }
+  }
 
-    if (m_themeById.contains(parsed.id)) {
+  bool needsReset = false;
+  int row = firstFileRow;
+  for (const ThemePackEntry& entry : next) {
+    if (row < m_themeOrder.size() && m_themeOrder.at(row) == entry.id) {
+      ThemePackEntry& current = m_themeById[entry.id];
+      const bool fileChanged = current.filePath != entry.filePath || current.fileSize != entry.fileSize
+                               || current.fileModifiedMs != entry.fileModifiedMs;
+      if (fileChanged) {
+        current = entry;
+        m_loadedTokens.remove(entry.id);
+        emit dataChanged(index(row), index(row));
+      }
+    } else if (m_themeById.contains(entry.id)) {
+      needsReset = true;
+      break;
+    } else {
+      beginInsertRows({}, row, row);
+      m_themeOrder.insert(row, entry.id);
+      m_themeById.insert(entry.id, entry);
+      endInsertRows();
+    }
+    ++row;
+  }
+
+  if (needsReset) {
+    beginResetModel();
+    m_themeById.clear();
+    m_themeOrder.clear();
+    m_loadedTokens.clear();
+    addBuiltInThemes();
+    for (const ThemePackEntry& entry : next) {
+      m_themeById.insert(entry.id, entry);
+      m_themeOrder.push_back(entry.id);
+    }
+    endResetModel();
+  }
+
+  if (m_pendingScans == 0) {
+    setScanning(false);
+  }
+  emit scanFinished();
+}
+
+void ThemePackModel::removeEntryAt(int row)
+{
+  if (row < 0 || row >= m_themeOrder.size()) {
+    return;
+  }
+
+  const QString id = m_themeOrder.at(row);
+  beginRemoveRows({}, row, row);
+  m_themeOrder.removeAt(row);
+  m_themeById.remove(id);
+  m_loadedTokens.remove(id);
+  endRemoveRows();
+}
+
+QString ThemePackModel::catalogIndexPath()
+{
+  return QDir(xbrowser::appDataRoot()).filePath("theme_catalog.json");
+}
+
+QVector<ThemePackModel::CatalogRecord> ThemePackModel::readCatalogIndex(const QString& path)
+{
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return {};
+  }
+
+  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+  if (!doc.isObject() || doc.object().value("version").toInt() != kCatalogIndexVersion) {
+    return {};
+  }
+
+  const QJsonArray arr = doc.object().value("themes").toArray();
+  QVector<CatalogRecord> out;
+  out.reserve(arr.size());
+  for (const QJsonValue& v : arr) {
+    const QJsonObject obj = v.toObject();
+    CatalogRecord record;
+    record.fileName = obj.value("file").toString();
+    if (record.fileName.isEmpty()) {
+      continue;
+    }
+    record.size = obj.value("size").toInteger(-1);
+    record.modifiedMs = obj.value("modified").toInteger();
+    record.id = obj.value("id").toString();
+    record.name = obj.value("name").toString();
+    record.version = obj.value("version").toString();
+    record.description = obj.value("description").toString();
+    record.updateUrl = obj.value("updateUrl").toString();
+    out.push_back(record);
+  }
+  return out;
+}
+
+bool ThemePackModel::writeCatalogIndex(const QString& path, const QVector<CatalogRecord>& records)
+{
+  QJsonArray arr;
+  for (const CatalogRecord& record : records) {
+    QJsonObject obj;
+    obj.insert("file", record.fileName);
+    obj.insert("size", record.size);
+    obj.insert("modified", record.modifiedMs);
+    if (!record.id.isEmpty()) {
+      obj.insert("id", record.id);
+      obj.insert("name", record.name);
+      obj.insert("version", record.version);
+      obj.insert("description", record.description);
+      obj.insert("updateUrl", record.updateUrl);
+    }
+    arr.push_back(obj);
+  }
+
+  QJsonObject root;
+  root.insert("version", kCatalogIndexVersion);
+  root.insert("themes", arr);
+
+  QSaveFile f(path);
+  if (!f.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+  return f.commit();
+}
+
+ThemePackModel::ScanResult ThemePackModel::scanCatalog(int generation, const QString& dir, const QString& indexPath,
+                                                       const QHash<QString, CatalogRecord>& cached)
+{
+  ScanResult result;
+  result.generation = generation;
+
+  const QFileInfoList files = QDir(dir).entryInfoList({ "*.json" }, QDir::Files, QDir::Name);
+  result.records.reserve(files.size());
+
+  bool dirty = files.size() != cached.size();
+  for (const QFileInfo& info : files) {
+    CatalogRecord record;
+    record.fileName = info.fileName();
+    record.size = info.size();
+    record.modifiedMs = info.lastModified().toMSecsSinceEpoch();
+
+    const auto it = cached.constFind(record.fileName);
+    if (it != cached.constEnd() && it.value().size == record.size && it.value().modifiedMs == record.modifiedMs) {
+      result.records.push_back(it.value());
       continue;
     }
-    parsed.filePath = f.fileName();
-    m_themeById.insert(parsed.id, parsed);
-    m_themeOrder.push_back(parsed.id);
+
+    dirty = true;
+    ++result.parsedCount;
+
+    QFile f(info.filePath());
+    ThemePackEntry parsed;
+    if (f.open(QIODevice::ReadOnly) && parseThemeJson(f.readAll(), &parsed, nullptr)) {
+      record.id = parsed.id;
+      record.name = parsed.tokens.name;
+      record.version = parsed.tokens.version;
+      record.description = parsed.tokens.description;
+      record.updateUrl = parsed.tokens.updateUrl.toString(QUrl::FullyEncoded);
+    }
+    result.records.push_back(record);
+  }
+
+  if (dirty) {
+    writeCatalogIndex(indexPath, result.records);
   }
+  return result;
+}
+
+ThemePackModel::ThemePackEntry ThemePackModel::entryFromRecord(const CatalogRecord& record, const QString& dir)
+{
+  ThemePackEntry entry;
+  entry.id = record.id;
+  entry.filePath = QDir(dir).filePath(record.fileName);
+  entry.fileSize = record.size;
+  entry.fileModifiedMs = record.modifiedMs;
+  entry.tokens.name = record.name;
+  entry.tokens.version = record.version;
+  entry.tokens.description = record.description;
+  entry.tokens.updateUrl = QUrl(record.updateUrl);
+  return entry;
+}
+
+bool ThemePackModel::loadTokensFromFile(const QString& path, const QString& expectedId, xbrowser::ThemeTokens* out)
+{
+  QFile f(path);
+  if (!f.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  ThemePackEntry parsed;
+  if (!parseThemeJson(f.readAll(), &parsed, nullptr) || parsed.id != expectedId) {
+    return false;
+  }
+
+  *out = parsed.tokens;
+  return true;
 }
 
 QString ThemePackModel::themesDir() const
@@ -394,7 +715,7 @@ QString ThemePackModel::filePathForThemeId(const QString& themeId) const
   return QDir(themesDir()).filePath(QStringLiteral("%1.json").arg(safe));
 }
 
-bool ThemePackModel::parseThemeJson(const QByteArray& bytes, ThemePackEntry* out, QString* error) const
+bool ThemePackModel::parseThemeJson(const QByteArray& bytes, ThemePackEntry* out, QString* error)
 {
   if (!out) {
     return false;
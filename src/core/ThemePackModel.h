@@ -4,6 +4,7 @@
 #include <QColor>
 #include <QNetworkAccessManager>
 #include <QPointer>
+#include <QThreadPool>
 #include <QUrl>
 
 namespace xbrowser
@@ -28,6 +29,7 @@ class ThemePackModel : public QAbstractListModel
 {
   Q_OBJECT
   Q_PROPERTY(bool busy READ busy NOTIFY busyChanged)
+  Q_PROPERTY(bool scanning READ scanning NOTIFY scanningChanged)
   Q_PROPERTY(QString lastError READ lastError NOTIFY lastErrorChanged)
 
 public:
@@ -43,12 +45,14 @@ public:
   Q_ENUM(Role)
 
   explicit ThemePackModel(QObject* parent = nullptr);
+  ~ThemePackModel() override;
 
   int rowCount(const QModelIndex& parent = QModelIndex()) const override;
   QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
   QHash<int, QByteArray> roleNames() const override;
 
   bool busy() const;
+  bool scanning() const;
   QString lastError() const;
 
   Q_INVOKABLE int count() const;
@@ -60,8 +64,13 @@ public:
 
   bool tokensForThemeId(const QString& themeId, xbrowser::ThemeTokens* out) const;
 
+  bool waitForScan(int msecs = -1);
+  int lastScanParsedCount() const;
+
 signals:
   void busyChanged();
+  void scanningChanged();
+  void scanFinished();
   void lastErrorChanged();
 
   void installSucceeded(const QString& themeId);
@@ -76,23 +85,63 @@ private:
     QString id;
     xbrowser::ThemeTokens tokens;
     QString filePath;
+    qint64 fileSize = -1;
+    qint64 fileModifiedMs = 0;
+  };
+
+  struct CatalogRecord
+  {
+    QString fileName;
+    qint64 size = -1;
+    qint64 modifiedMs = 0;
+    QString id;
+    QString name;
+    QString version;
+    QString description;
+    QString updateUrl;
+  };
+
+  struct ScanResult
+  {
+    int generation = 0;
+    QVector<CatalogRecord> records;
+    int parsedCount = 0;
   };
 
   void setBusy(bool busy);
+  void setScanning(bool scanning);
   void setLastError(const QString& error);
   void addBuiltInThemes();
-  void loadThemesFromDisk();
+  void addCatalogEntries(const QVector<CatalogRecord>& records);
+  void startScan();
+  void applyScan(const ScanResult& result);
+  void removeEntryAt(int row);
   QString themesDir() const;
   QString filePathForThemeId(const QString& themeId) const;
-  bool parseThemeJson(const QByteArray& bytes, ThemePackEntry* out, QString* error) const;
+  static QString catalogIndexPath();
+  static QVector<CatalogRecord> readCatalogIndex(const QString& path);
+  static bool writeCatalogIndex(const QString& path, const QVector<CatalogRecord>& records);
+  static ScanResult scanCatalog(int generation, const QString& dir, const QString& indexPath,
+                                const QHash<QString, CatalogRecord>& cached);
+  static ThemePackEntry entryFromRecord(const CatalogRecord& record, const QString& dir);
+  static bool loadTokensFromFile(const QString& path, const QString& expectedId, xbrowser::ThemeTokens* out);
+  static bool parseThemeJson(const QByteArray& bytes, ThemePackEntry* out, QString* error);
   static int compareVersions(const QString& a, const QString& b);
 
   bool m_busy = false;
+  bool m_scanning = false;
   QString m_lastError;
 
   QNetworkAccessManager m_network;
   QHash<QString, ThemePackEntry> m_themeById;
   QVector<QString> m_themeOrder;
+  mutable QHash<QString, xbrowser::ThemeTokens> m_loadedTokens;
+
+  QThreadPool m_pool;
+  QHash<QString, CatalogRecord> m_catalog;
+  int m_scanGeneration = 0;
+  int m_pendingScans = 0;
+  int m_lastScanParsedCount = 0;
 
   struct PendingUpdate
   {
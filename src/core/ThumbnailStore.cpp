@@ -0,0 +1,486 @@
+#include "ThumbnailStore.h"
+
+#include "AppPaths.h"
+
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QSet>
+#include <QUrlQuery>
+
+namespace
+{
+constexpr qint64 kDefaultByteBudget = 24LL * 1024LL * 1024LL;
+constexpr qint64 kPlaceholderByteBudget = 512LL * 1024LL;
+constexpr int kMaxThumbnailWidth = 640;
+constexpr int kMaxThumbnailHeight = 360;
+constexpr int kPlaceholderWidth = 32;
+constexpr int kPlaceholderHeight = 18;
+constexpr int kThumbnailQuality = 72;
+constexpr int kPlaceholderQuality = 50;
+constexpr int kMaxWorkerThreads = 2;
+
+bool isUnderRoot(const QString& absoluteFilePath, const QString& rootPath)
+{
+  if (absoluteFilePath.trimmed().isEmpty() || rootPath.trimmed().isEmpty()) {
+    return false;
+  }
+
+  QString root = QDir::cleanPath(QDir::fromNativeSeparators(rootPath));
+  if (!root.endsWith('/')) {
+    root += '/';
+  }
+
+  const QString candidate =
+    QDir::cleanPath(QDir::fromNativeSeparators(QFileInfo(absoluteFilePath).absoluteFilePath()));
+  return candidate.startsWith(root, Qt::CaseInsensitive);
+}
+
+void removeFileIfSafe(const QString& path)
+{
+  if (path.trimmed().isEmpty()) {
+    return;
+  }
+  if (!isUnderRoot(path, xbrowser::appDataRoot())) {
+    return;
+  }
+  QFile::remove(path);
+}
+
+const QByteArray& encodedFormat()
+{
+  static const QByteArray format =
+    QImageWriter::supportedImageFormats().contains("jpeg") ? QByteArrayLiteral("jpeg") : QByteArrayLiteral("png");
+  return format;
+}
+
+QString encodedSuffix()
+{
+  return encodedFormat() == "jpeg" ? QStringLiteral("jpg") : QStringLiteral("png");
+}
+
+QString encodedMimeType()
+{
+  return encodedFormat() == "jpeg" ? QStringLiteral("image/jpeg") : QStringLiteral("image/png");
+}
+}
+
+ThumbnailStore& ThumbnailStore::instance()
+{
+  static ThumbnailStore store;
+  return store;
+}
+
+ThumbnailStore::ThumbnailStore(QObject* parent)
+  : QObject(parent)
+  , m_byteBudget(kDefaultByteBudget)
+{
+  m_pool.setMaxThreadCount(kMaxWorkerThreads);
+  m_pool.setExpiryTimeout(5000);
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+  m_pool.clear();
+  m_pool.waitForDone();
+}
+
+quint64 ThumbnailStore::makeKey(int ownerId, int tabId)
+{
+  return (static_cast<quint64>(static_cast<quint32>(ownerId)) << 32) | static_cast<quint32>(tabId);
+}
+
+int ThumbnailStore::ownerIdForKey(quint64 key)
+{
+  return static_cast<int>(static_cast<quint32>(key >> 32));
+}
+
+int ThumbnailStore::tabIdForKey(quint64 key)
+{
+  return static_cast<int>(static_cast<quint32>(key & 0xffffffffULL));
+}
+
+qint64 ThumbnailStore::byteBudget() const
+{
+  return m_byteBudget;
+}
+
+void ThumbnailStore::setByteBudget(qint64 bytes)
+{
+  const qint64 next = qMax<qint64>(0, bytes);
+  if (m_byteBudget == next) {
+    return;
+  }
+  m_byteBudget = next;
+  enforceBudgets(0);
+}
+
+qint64 ThumbnailStore::bytesUsed() const
+{
+  return m_bytesUsed;
+}
+
+bool ThumbnailStore::placeholdersEnabled() const
+{
+  return m_placeholdersEnabled;
+}
+
+void ThumbnailStore::setPlaceholdersEnabled(bool enabled)
+{
+  if (m_placeholdersEnabled == enabled) {
+    return;
+  }
+  m_placeholdersEnabled = enabled;
+
+  if (!enabled) {
+    const LruList keys = m_placeholderLru;
+    for (const quint64 key : keys) {
+      auto it = m_entries.find(key);
+      if (it == m_entries.end()) {
+        continue;
+      }
+      dropPlaceholderTier(*it);
+      eraseIfEmpty(key);
+      emit thumbnailChanged(key);
+    }
+  }
+}
+
+qint64 ThumbnailStore::placeholderBytesUsed() const
+{
+  return m_placeholderBytesUsed;
+}
+
+int ThumbnailStore::diskCount() const
+{
+  return static_cast<int>(m_diskLru.size());
+}
+
+int ThumbnailStore::placeholderCount() const
+{
+  return static_cast<int>(m_placeholderLru.size());
+}
+
+void ThumbnailStore::submit(quint64 key, const QString& sourcePath)
+{
+  const QString trimmed = sourcePath.trimmed();
+  if (key == 0 || trimmed.isEmpty()) {
+    return;
+  }
+
+  const int generation = ++m_nextGeneration;
+  m_pendingGenerations.insert(key, generation);
+
+  const QString dataRoot = xbrowser::appDataRoot();
+  const QString outputDir = directory();
+  const bool withPlaceholder = m_placeholdersEnabled;
+
+  m_pendingJobs++;
+  m_pool.start([this, key, generation, trimmed, outputDir, dataRoot, withPlaceholder] {
+    const EncodeResult result = encode(key, generation, trimmed, outputDir, dataRoot, withPlaceholder);
+    QMetaObject::invokeMethod(this, [this, result] { applyResult(result); }, Qt::QueuedConnection);
+  });
+}
+
+QUrl ThumbnailStore::urlFor(quint64 key) const
+{
+  const auto it = m_entries.constFind(key);
+  if (it == m_entries.constEnd()) {
+    return {};
+  }
+
+  if (it->onDisk && !it->path.isEmpty()) {
+    QUrl url = QUrl::fromLocalFile(it->path);
+    QUrlQuery query;
+    query.addQueryItem(QStringLiteral("t"), QString::number(qMax(0, it->version)));
+    url.setQuery(query);
+    return url;
+  }
+
+  if (it->inPlaceholders && !it->placeholder.isEmpty()) {
+    return QUrl(QStringLiteral("data:%1;base64,%2")
+                  .arg(encodedMimeType(), QString::fromLatin1(it->placeholder.toBase64())));
+  }
+
+  return {};
+}
+
+bool ThumbnailStore::hasDiskThumbnail(quint64 key) const
+{
+  const auto it = m_entries.constFind(key);
+  return it != m_entries.constEnd() && it->onDisk;
+}
+
+bool ThumbnailStore::hasPlaceholder(quint64 key) const
+{
+  const auto it = m_entries.constFind(key);
+  return it != m_entries.constEnd() && it->inPlaceholders;
+}
+
+void ThumbnailStore::touch(quint64 key)
+{
+  auto it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    return;
+  }
+
+  if (it->onDisk) {
+    m_diskLru.splice(m_diskLru.begin(), m_diskLru, it->diskPos);
+  }
+  if (it->inPlaceholders) {
+    m_placeholderLru.splice(m_placeholderLru.begin(), m_placeholderLru, it->placeholderPos);
+  }
+}
+
+void ThumbnailStore::remove(quint64 key)
+{
+  m_pendingGenerations.remove(key);
+
+  auto it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    return;
+  }
+
+  dropDiskTier(*it);
+  dropPlaceholderTier(*it);
+  m_entries.erase(it);
+  emit thumbnailChanged(key);
+}
+
+void ThumbnailStore::removeOwner(int ownerId)
+{
+  QVector<quint64> keys;
+  for (auto it = m_pendingGenerations.cbegin(); it != m_pendingGenerations.cend(); ++it) {
+    if (ownerIdForKey(it.key()) == ownerId) {
+      keys.push_back(it.key());
+    }
+  }
+  for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+    if (ownerIdForKey(it.key()) == ownerId && !m_pendingGenerations.contains(it.key())) {
+      keys.push_back(it.key());
+    }
+  }
+
+  for (const quint64 key : keys) {
+    remove(key);
+  }
+}
+
+void ThumbnailStore::forgetDiskFiles(const QStringList& paths)
+{
+  QSet<QString> gone;
+  gone.reserve(paths.size());
+  for (const QString& path : paths) {
+    gone.insert(QDir::cleanPath(path));
+  }
+
+  QVector<quint64> changed;
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    if (!it->onDisk || !gone.contains(QDir::cleanPath(it->path))) {
+      continue;
+    }
+    m_diskLru.erase(it->diskPos);
+    m_bytesUsed -= it->bytes;
+    it->path.clear();
+    it->bytes = 0;
+    it->onDisk = false;
+    changed.push_back(it.key());
+  }
+
+  for (const quint64 key : changed) {
+    eraseIfEmpty(key);
+    emit thumbnailChanged(key);
+  }
+}
+
+QString ThumbnailStore::directory()
+{
+  return QDir(xbrowser::appDataRoot()).filePath(QStringLiteral("thumbnails"));
+}
+
+bool ThumbnailStore::waitForIdle(int msecs)
+{
+  const QDeadlineTimer deadline = msecs < 0 ? QDeadlineTimer(QDeadlineTimer::Forever) : QDeadlineTimer(msecs);
+  while (m_pendingJobs > 0) {
+    if (!m_pool.waitForDone(static_cast<int>(deadline.remainingTime()))) {
+      return false;
+    }
+    QCoreApplication::sendPostedEvents(this);
+    if (deadline.hasExpired() && m_pendingJobs > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ThumbnailStore::EncodeResult ThumbnailStore::encode(quint64 key, int generation, const QString& sourcePath,
+                                                    const QString& outputDir, const QString& dataRoot,
+                                                    bool withPlaceholder)
+{
+  EncodeResult result;
+  result.key = key;
+  result.generation = generation;
+
+  QImage image;
+  const bool loaded = image.load(sourcePath);
+  if (isUnderRoot(sourcePath, dataRoot)) {
+    QFile::remove(sourcePath);
+  }
+  if (!loaded || image.isNull()) {
+    return result;
+  }
+
+  if (image.width() > kMaxThumbnailWidth || image.height() > kMaxThumbnailHeight) {
+    image = image.scaled(kMaxThumbnailWidth, kMaxThumbnailHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
+  if (encodedFormat() == "jpeg" && image.hasAlphaChannel()) {
+    image = image.convertToFormat(QImage::Format_RGB32);
+  }
+
+  QDir().mkpath(outputDir);
+  const QString path = QDir(outputDir).filePath(
+    QStringLiteral("thumb_%1_%2_%3.%4")
+      .arg(ownerIdForKey(key))
+      .arg(tabIdForKey(key))
+      .arg(generation)
+      .arg(encodedSuffix()));
+
+  QSaveFile out(path);
+  if (!out.open(QIODevice::WriteOnly)) {
+    return result;
+  }
+  QImageWriter writer(&out, encodedFormat());
+  writer.setQuality(kThumbnailQuality);
+  if (!writer.write(image) || !out.commit()) {
+    return result;
+  }
+
+  result.path = path;
+  result.bytes = QFileInfo(path).size();
+  result.ok = true;
+
+  if (withPlaceholder) {
+    const QImage tiny =
+      image.scaled(kPlaceholderWidth, kPlaceholderHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QBuffer buffer(&result.placeholder);
+    if (buffer.open(QIODevice::WriteOnly)) {
+      QImageWriter tinyWriter(&buffer, encodedFormat());
+      tinyWriter.setQuality(kPlaceholderQuality);
+      if (!tinyWriter.write(tiny)) {
+        result.placeholder.clear();
+      }
+    }
+  }
+
+  return result;
+}
+
+void ThumbnailStore::applyResult(const EncodeResult& result)
+{
+  m_pendingJobs = qMax(0, m_pendingJobs - 1);
+
+  const bool current = m_pendingGenerations.value(result.key, 0) == result.generation;
+  if (!current || !result.ok) {
+    if (!result.path.isEmpty()) {
+      removeFileIfSafe(result.path);
+    }
+    return;
+  }
+  m_pendingGenerations.remove(result.key);
+
+  Entry& entry = m_entries[result.key];
+  dropDiskTier(entry);
+  dropPlaceholderTier(entry);
+
+  entry.path = result.path;
+  entry.bytes = result.bytes;
+  entry.version++;
+  entry.onDisk = true;
+  m_diskLru.push_front(result.key);
+  entry.diskPos = m_diskLru.begin();
+  m_bytesUsed += entry.bytes;
+
+  if (m_placeholdersEnabled && !result.placeholder.isEmpty()) {
+    entry.placeholder = result.placeholder;
+    entry.inPlaceholders = true;
+    m_placeholderLru.push_front(result.key);
+    entry.placeholderPos = m_placeholderLru.begin();
+    m_placeholderBytesUsed += entry.placeholder.size();
+  }
+
+  enforceBudgets(result.key);
+  emit thumbnailChanged(result.key);
+}
+
+void ThumbnailStore::dropDiskTier(Entry& entry)
+{
+  if (!entry.onDisk) {
+    return;
+  }
+  m_diskLru.erase(entry.diskPos);
+  m_bytesUsed -= entry.bytes;
+  removeFileIfSafe(entry.path);
+  entry.path.clear();
+  entry.bytes = 0;
+  entry.onDisk = false;
+}
+
+void ThumbnailStore::dropPlaceholderTier(Entry& entry)
+{
+  if (!entry.inPlaceholders) {
+    return;
+  }
+  m_placeholderLru.erase(entry.placeholderPos);
+  m_placeholderBytesUsed -= entry.placeholder.size();
+  entry.placeholder.clear();
+  entry.inPlaceholders = false;
+}
+
+void ThumbnailStore::eraseIfEmpty(quint64 key)
+{
+  const auto it = m_entries.constFind(key);
+  if (it != m_entries.constEnd() && !it->onDisk && !it->inPlaceholders) {
+    m_entries.erase(it);
+  }
+}
+
+void ThumbnailStore::enforceBudgets(quint64 keepKey)
+{
+  while (m_bytesUsed > m_byteBudget && !m_diskLru.empty()) {
+    const quint64 victim = m_diskLru.back();
+    if (victim == keepKey && m_diskLru.size() == 1) {
+      break;
+    }
+    if (victim == keepKey) {
+      m_diskLru.splice(m_diskLru.begin(), m_diskLru, std::prev(m_diskLru.end()));
+      continue;
+    }
+
+    auto it = m_entries.find(victim);
+    if (it == m_entries.end()) {
+      m_diskLru.pop_back();
+      continue;
+    }
+    dropDiskTier(*it);
+    eraseIfEmpty(victim);
+    emit thumbnailChanged(victim);
+  }
+
+  while (m_placeholderBytesUsed > kPlaceholderByteBudget && m_placeholderLru.size() > 1) {
+    const quint64 victim = m_placeholderLru.back();
+    auto it = m_entries.find(victim);
+    if (it == m_entries.end()) {
+      m_placeholderLru.pop_back();
+      continue;
+    }
+    dropPlaceholderTier(*it);
+    eraseIfEmpty(victim);
+    emit thumbnailChanged(victim);
+  }
+}
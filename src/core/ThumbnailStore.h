@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QUrl>
+
+#include <list>
+
+class ThumbnailStore final : public QObject
+{
+  Q_OBJECT
+
+public:
+  static ThumbnailStore& instance();
+  ~ThumbnailStore() override;
+
+  static quint64 makeKey(int ownerId, int tabId);
+  static int ownerIdForKey(quint64 key);
+  static int tabIdForKey(quint64 key);
+
+  qint64 byteBudget() const;
+  void setByteBudget(qint64 bytes);
+  qint64 bytesUsed() const;
+
+  bool placeholdersEnabled() const;
+  void setPlaceholdersEnabled(bool enabled);
+  qint64 placeholderBytesUsed() const;
+
+  int diskCount() const;
+  int placeholderCount() const;
+
+  void submit(quint64 key, const QString& sourcePath);
+  QUrl urlFor(quint64 key) const;
+  bool hasDiskThumbnail(quint64 key) const;
+  bool hasPlaceholder(quint64 key) const;
+  void touch(quint64 key);
+  void remove(quint64 key);
+  void removeOwner(int ownerId);
+  // Drops the disk tier of entries whose files someone else deleted.
+  void forgetDiskFiles(const QStringList& paths);
+
+  static QString directory();
+
+  bool waitForIdle(int msecs = -1);
+
+signals:
+  void thumbnailChanged(quint64 key);
+
+private:
+  using LruList = std::list<quint64>;
+
+  struct Entry
+  {
+    QString path;
+    qint64 bytes = 0;
+    QByteArray placeholder;
+    int version = 0;
+    bool onDisk = false;
+    bool inPlaceholders = false;
+    LruList::iterator diskPos;
+    LruList::iterator placeholderPos;
+  };
+
+  struct EncodeResult
+  {
+    quint64 key = 0;
+    int generation = 0;
+    bool ok = false;
+    QString path;
+    qint64 bytes = 0;
+    QByteArray placeholder;
+  };
+
+  explicit ThumbnailStore(QObject* parent = nullptr);
+
+  static EncodeResult encode(quint64 key, int generation, const QString& sourcePath, const QString& outputDir,
+                             const QString& dataRoot, bool withPlaceholder);
+
+  void applyResult(const EncodeResult& result);
+  void dropDiskTier(Entry& entry);
+  void dropPlaceholderTier(Entry& entry);
+  void eraseIfEmpty(quint64 key);
+  void enforceBudgets(quint64 keepKey);
+
+  QThreadPool m_pool;
+  QHash<quint64, Entry> m_entries;
+  QHash<quint64, int> m_pendingGenerations;
+  LruList m_diskLru;
+  LruList m_placeholderLru;
+  qint64 m_byteBudget = 0;
+  qint64 m_bytesUsed = 0;
+  qint64 m_placeholderBytesUsed = 0;
+  bool m_placeholdersEnabled = true;
+  int m_pendingJobs = 0;
+  int m_nextGeneration = 0;
+};
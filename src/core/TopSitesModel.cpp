@@ -0,0 +1,639 @@
+#include "TopSitesModel.h"
+
+#include "FaviconCache.h"
+#include "HistoryStore.h"
+#include "PublicSuffixList.h"
+#include "UserDataStorage.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+constexpr int kMaxRows = 48;
+// Sites far below the shown ones are not worth the bytes; they come back
+// from history on the next rebuild.
+constexpr int kMaxSavedSites = 500;
+constexpr int kFaviconSize = 32;
+constexpr qint64 kThumbnailRefreshMs = 10LL * 60LL * 1000LL;
+const QSize kThumbnailSize(320, 200);
+const QString kStorageName = QStringLiteral("top-sites.json");
+const QString kThumbnailDir = QStringLiteral("thumbnails/top-sites");
+
+bool isRootPage(const QUrl& url)
+{
+  const QString path = url.path();
+  return (path.isEmpty() || path == QLatin1String("/")) && !url.hasQuery();
+}
+
+QUrl originRoot(const QUrl& url)
+{
+  QUrl root;
+  root.setScheme(url.scheme().toLower());
+  root.setHost(url.host());
+  root.setPort(url.port());
+  root.setPath(QStringLiteral("/"));
+  return root;
+}
+}
+
+TopSitesModel::TopSitesModel(QObject* parent)
+  : QAbstractListModel(parent)
+{
+  m_pool.setMaxThreadCount(1);
+  m_pool.setExpiryTimeout(10000);
+
+  m_saveTimer.setSingleShot(true);
+  m_saveTimer.setInterval(2000);
+  connect(&m_saveTimer, &QTimer::timeout, this, [this] {
+    saveNow();
+  });
+
+  m_rebuildTimer.setSingleShot(true);
+  m_rebuildTimer.setInterval(0);
+  connect(&m_rebuildTimer, &QTimer::timeout, this, &TopSitesModel::rebuild);
+
+  load();
+}
+
+TopSitesModel::~TopSitesModel()
+{
+  if (m_saveTimer.isActive()) {
+    saveNow();
+  }
+  m_pool.waitForDone();
+}
+
+int TopSitesModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant TopSitesModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size()) {
+    return {};
+  }
+
+  const Row& row = m_rows.at(index.row());
+  const auto it = m_sites.constFind(row.site);
+  if (it == m_sites.constEnd()) {
+    return {};
+  }
+
+  const Site& site = it.value();
+  switch (role) {
+    case SiteRole:
+      return site.site;
+    case TitleRole: {
+      if (!site.title.isEmpty()) {
+        return site.title;
+      }
+      const QString host = site.url.host();
+      return host.startsWith(QLatin1String("www.")) ? host.mid(4) : host;
+    }
+    case UrlRole:
+      return site.url;
+    case VisitCountRole:
+      return site.visitCount;
+    case LastVisitedMsRole:
+      return site.lastVisitMs;
+    case FaviconUrlRole:
+      return row.faviconUrl;
+    case ThumbnailUrlRole:
+      return row.thumbnailUrl;
+    default:
+      return {};
+  }
+}
+
+QHash<int, QByteArray> TopSitesModel::roleNames() const
+{
+  return {
+    {SiteRole, "site"},
+    {TitleRole, "title"},
+    {UrlRole, "url"},
+    {VisitCountRole, "visitCount"},
+    {LastVisitedMsRole, "lastVisitedMs"},
+    {FaviconUrlRole, "faviconUrl"},
+    {ThumbnailUrlRole, "thumbnailUrl"},
+  };
+}
+
+void TopSitesModel::setHistory(HistoryStore* history)
+{
+  if (m_history == history) {
+    return;
+  }
+  if (m_history) {
+    disconnect(m_history, nullptr, this, nullptr);
+  }
+  m_history = history;
+  if (!m_history) {
+    return;
+  }
+
+  connect(m_history, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex&, int first, int last) {
+    addRows(first, last);
+  });
+  connect(m_history, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+          [this](const QModelIndex&, int first, int last) {
+            removeRows(first, last);
+          });
+  connect(m_history, &QAbstractItemModel::modelReset, this, [this] {
+    m_rebuildTimer.start();
+  });
+  connect(m_history, &QAbstractItemModel::dataChanged, this,
+          [this](const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles) {
+            const bool titleChanged = roles.isEmpty() || roles.contains(HistoryStore::TitleRole);
+            const bool timeChanged = roles.isEmpty() || roles.contains(HistoryStore::VisitedMsRole);
+            if (!titleChanged && !timeChanged) {
+              return;
+            }
+
+            // History only sends ranges of rows that actually changed, and
+            // imported rows are not in time order, so every row counts.
+            bool changed = false;
+            for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+              const QModelIndex idx = m_history->index(row);
+              const QUrl url = idx.data(HistoryStore::UrlRole).toUrl();
+              const auto it = m_sites.find(siteKeyFor(url));
+              if (it == m_sites.end()) {
+                continue;
+              }
+              if (titleChanged && isRootPage(url)) {
+                it->title = idx.data(HistoryStore::TitleRole).toString();
+              }
+              if (timeChanged) {
+                it->lastVisitMs = std::max(it->lastVisitMs, idx.data(HistoryStore::VisitedMsRole).toLongLong());
+              }
+              changed = true;
+            }
+            if (changed) {
+              refreshRows();
+              scheduleSave();
+            }
+          });
+
+  if (m_history->count() == m_savedHistoryCount && newestVisitMs() == m_savedNewestMs) {
+    refreshRows();
+  } else {
+    rebuild();
+  }
+}
+
+void TopSitesModel::setFavicons(FaviconCache* favicons)
+{
+  if (m_favicons == favicons) {
+    return;
+  }
+  if (m_favicons) {
+    disconnect(m_favicons, nullptr, this, nullptr);
+  }
+  m_favicons = favicons;
+  if (m_favicons) {
+    connect(m_favicons, &FaviconCache::faviconAvailable, this, &TopSitesModel::onFaviconAvailable);
+  }
+
+  for (int i = 0; i < m_rows.size(); ++i) {
+    m_rows[i] = makeRow(m_sites.value(m_rows.at(i).site));
+  }
+  if (!m_rows.isEmpty()) {
+    emit dataChanged(index(0), index(m_rows.size() - 1), {FaviconUrlRole});
+  }
+}
+
+int TopSitesModel::count() const
+{
+  return m_rows.size();
+}
+
+int TopSitesModel::maxCount() const
+{
+  return m_maxCount;
+}
+
+void TopSitesModel::setMaxCount(int count)
+{
+  count = qBound(0, count, kMaxRows);
+  if (m_maxCount == count) {
+    return;
+  }
+  m_maxCount = count;
+  emit maxCountChanged();
+  refreshRows();
+}
+
+int TopSitesModel::siteCount() const
+{
+  return m_sites.size();
+}
+
+void TopSitesModel::block(const QUrl& url)
+{
+  QString site = siteKeyFor(url);
+  if (site.isEmpty()) {
+    // A bare site name, as blockedSites() returns them.
+    site = siteKeyFor(QUrl::fromUserInput(url.toString()));
+  }
+  if (site.isEmpty() || m_blocked.contains(site)) {
+    return;
+  }
+
+  m_blocked.insert(site);
+  refreshRows();
+  scheduleSave();
+}
+
+void TopSitesModel::unblock(const QString& site)
+{
+  if (!m_blocked.remove(site.trimmed().toLower())) {
+    return;
+  }
+  refreshRows();
+  scheduleSave();
+}
+
+void TopSitesModel::clearBlocklist()
+{
+  if (m_blocked.isEmpty()) {
+    return;
+  }
+  m_blocked.clear();
+  refreshRows();
+  scheduleSave();
+}
+
+QStringList TopSitesModel::blockedSites() const
+{
+  QStringList sites(m_blocked.cbegin(), m_blocked.cend());
+  sites.sort();
+  return sites;
+}
+
+void TopSitesModel::setThumbnail(const QUrl& pageUrl, const QString& imagePath)
+{
+  const QString key = siteKeyFor(pageUrl);
+  if (key.isEmpty() || imagePath.isEmpty()) {
+    return;
+  }
+  const bool shown = std::any_of(m_rows.cbegin(), m_rows.cend(), [&key](const Row& row) {
+    return row.site == key;
+  });
+  if (!shown) {
+    return;
+  }
+
+  Site& site = m_sites[key];
+  const qint64 now = QDateTime::currentMSecsSinceEpoch();
+  if (site.thumbnailAtMs > 0 && now - site.thumbnailAtMs < kThumbnailRefreshMs) {
+    return;
+  }
+  const QString target = thumbnailPath(key);
+  if (target.isEmpty()) {
+    return;
+  }
+  site.thumbnailAtMs = now;
+
+  m_pool.start([this, key, source = imagePath, target] {
+    bool ok = false;
+    const QImage image(source);
+    if (!image.isNull()) {
+      QDir().mkpath(QFileInfo(target).absolutePath());
+      const QImage scaled = image.scaled(kThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+      QSaveFile file(target);
+      ok = file.open(QIODevice::WriteOnly) && scaled.save(&file, "JPEG", 80) && file.commit();
+    }
+
+    QMetaObject::invokeMethod(
+      this,
+      [this, key, ok] {
+        const auto it = m_sites.find(key);
+        if (!ok || it == m_sites.end()) {
+          return;
+        }
+        ++it->thumbnailVersion;
+        for (int i = 0; i < m_rows.size(); ++i) {
+          if (m_rows.at(i).site == key) {
+            m_rows[i].thumbnailUrl = makeRow(it.value()).thumbnailUrl;
+            emit dataChanged(index(i), index(i), {ThumbnailUrlRole});
+          }
+        }
+        scheduleSave();
+      },
+      Qt::QueuedConnection);
+  });
+}
+
+double TopSitesModel::rank(double score, qint64 scoreMs)
+{
+  if (score <= 0.0) {
+    return -std::numeric_limits<double>::infinity();
+  }
+  return std::log2(score) + static_cast<double>(scoreMs) / static_cast<double>(kHalfLifeMs);
+}
+
+bool TopSitesModel::saveNow() const
+{
+  QVector<const Site*> sites;
+  sites.reserve(m_sites.size());
+  for (const Site& site : m_sites) {
+    sites.push_back(&site);
+  }
+  const auto byRank = [](const Site* a, const Site* b) {
+    return rank(a->score, a->scoreMs) > rank(b->score, b->scoreMs);
+  };
+  if (sites.size() > kMaxSavedSites) {
+    std::nth_element(sites.begin(), sites.begin() + kMaxSavedSites, sites.end(), byRank);
+    sites.resize(kMaxSavedSites);
+  }
+
+  QJsonArray siteRows;
+  for (const Site* site : sites) {
+    siteRows.append(QJsonArray{
+      site->site,
+      site->url.toString(),
+      site->title,
+      site->score,
+      static_cast<double>(site->scoreMs),
+      site->visitCount,
+      static_cast<double>(site->lastVisitMs),
+      site->thumbnailVersion,
+    });
+  }
+
+  QJsonObject root;
+  root.insert(QStringLiteral("historyCount"), m_history ? m_history->count() : -1);
+  root.insert(QStringLiteral("newestVisitMs"), static_cast<double>(newestVisitMs()));
+  root.insert(QStringLiteral("blocked"), QJsonArray::fromStringList(blockedSites()));
+  root.insert(QStringLiteral("sites"), siteRows);
+  return xbrowser::userDataStorage().write(kStorageName, QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+bool TopSitesModel::waitForIdle(int msecs)
+{
+  return m_pool.waitForDone(msecs);
+}
+
+QString TopSitesModel::siteKeyFor(const QUrl& url)
+{
+  const QString scheme = url.scheme().toLower();
+  if (!url.isValid() || (scheme != QLatin1String("http") && scheme != QLatin1String("https"))) {
+    return {};
+  }
+  const QString host = url.host().toLower();
+  if (host.isEmpty()) {
+    return {};
+  }
+  const QString site = PublicSuffixList::siteKey(host);
+  return site.isEmpty() ? host : site;
+}
+
+void TopSitesModel::addScore(Site& site, qint64 visitedMs, int count)
+{
+  // Scores are kept as of their newest visit; older visits are weighed
+  // down to it, a newer one decays the score up to itself.
+  if (site.score <= 0.0 && count > 0) {
+    site.score = count;
+    site.scoreMs = visitedMs;
+  } else if (visitedMs > site.scoreMs) {
+    const double decay = std::exp2(static_cast<double>(site.scoreMs - visitedMs) / kHalfLifeMs);
+    site.score = site.score * decay + count;
+    site.scoreMs = visitedMs;
+  } else {
+    site.score += count * std::exp2(static_cast<double>(visitedMs - site.scoreMs) / kHalfLifeMs);
+  }
+  site.score = std::max(0.0, site.score);
+}
+
+void TopSitesModel::addRows(int first, int last)
+{
+  for (int i = first; i <= last; ++i) {
+    const QModelIndex idx = m_history->index(i);
+    addVisit(idx.data(HistoryStore::UrlRole).toUrl(), idx.data(HistoryStore::TitleRole).toString(),
+             idx.data(HistoryStore::VisitedMsRole).toLongLong(), idx.data(HistoryStore::VisitCountRole).toInt());
+  }
+  refreshRows();
+  scheduleSave();
+}
+
+void TopSitesModel::removeRows(int first, int last)
+{
+  for (int i = first; i <= last; ++i) {
+    const QModelIndex idx = m_history->index(i);
+    const auto it = m_sites.find(siteKeyFor(idx.data(HistoryStore::UrlRole).toUrl()));
+    if (it == m_sites.end()) {
+      continue;
+    }
+    const int count = std::max(1, idx.data(HistoryStore::VisitCountRole).toInt());
+    addScore(it.value(), idx.data(HistoryStore::VisitedMsRole).toLongLong(), -count);
+    it->visitCount -= count;
+    if (it->visitCount <= 0) {
+      m_sites.erase(it);
+    }
+  }
+  refreshRows();
+  scheduleSave();
+}
+
+void TopSitesModel::addVisit(const QUrl& url, const QString& title, qint64 visitedMs, int count)
+{
+  const QString key = siteKeyFor(url);
+  if (key.isEmpty()) {
+    return;
+  }
+
+  count = std::max(1, count);
+  Site& site = m_sites[key];
+  site.site = key;
+  addScore(site, visitedMs, count);
+  site.visitCount += count;
+  site.lastVisitMs = std::max(site.lastVisitMs, visitedMs);
+  if (isRootPage(url)) {
+    site.url = originRoot(url);
+    site.title = title;
+  } else if (!site.url.isValid()) {
+    site.url = originRoot(url);
+  }
+}
+
+void TopSitesModel::rebuild()
+{
+  m_rebuildTimer.stop();
+
+  QHash<QString, Site> previous;
+  previous.swap(m_sites);
+  if (m_history) {
+    const int rows = m_history->count();
+    for (int i = 0; i < rows; ++i) {
+      const QModelIndex idx = m_history->index(i);
+      addVisit(idx.data(HistoryStore::UrlRole).toUrl(), idx.data(HistoryStore::TitleRole).toString(),
+               idx.data(HistoryStore::VisitedMsRole).toLongLong(), idx.data(HistoryStore::VisitCountRole).toInt());
+    }
+  }
+
+  // Thumbnails outlive the counts they were taken for.
+  for (auto it = m_sites.begin(); it != m_sites.end(); ++it) {
+    const auto old = previous.constFind(it.key());
+    if (old != previous.constEnd()) {
+      it->thumbnailVersion = old->thumbnailVersion;
+      it->thumbnailAtMs = old->thumbnailAtMs;
+    }
+  }
+
+  refreshRows();
+  scheduleSave();
+}
+
+void TopSitesModel::refreshRows()
+{
+  QVector<const Site*> candidates;
+  candidates.reserve(m_sites.size());
+  for (const Site& site : m_sites) {
+    if (site.visitCount > 0 && !m_blocked.contains(site.site)) {
+      candidates.push_back(&site);
+    }
+  }
+
+  const int shown = std::min<int>(m_maxCount, candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + shown, candidates.end(),
+                    [](const Site* a, const Site* b) {
+                      const double rankA = rank(a->score, a->scoreMs);
+                      const double rankB = rank(b->score, b->scoreMs);
+                      if (rankA != rankB) {
+                        return rankA > rankB;
+                      }
+                      if (a->lastVisitMs != b->lastVisitMs) {
+                        return a->lastVisitMs > b->lastVisitMs;
+                      }
+                      return a->site < b->site;
+                    });
+
+  bool sameOrder = m_rows.size() == shown;
+  for (int i = 0; sameOrder && i < shown; ++i) {
+    sameOrder = m_rows.at(i).site == candidates.at(i)->site;
+  }
+  if (sameOrder) {
+    if (shown > 0) {
+      emit dataChanged(index(0), index(shown - 1), {TitleRole, UrlRole, VisitCountRole, LastVisitedMsRole});
+    }
+    return;
+  }
+
+  QHash<QString, Row> previous;
+  for (const Row& row : m_rows) {
+    previous.insert(row.site, row);
+  }
+  QVector<Row> rows;
+  rows.reserve(shown);
+  for (int i = 0; i < shown; ++i) {
+    const Site* site = candidates.at(i);
+    const auto old = previous.constFind(site->site);
+    rows.push_back(old != previous.constEnd() ? old.value() : makeRow(*site));
+  }
+
+  const int oldCount = m_rows.size();
+  beginResetModel();
+  m_rows = std::move(rows);
+  endResetModel();
+  if (m_rows.size() != oldCount) {
+    emit countChanged();
+  }
+}
+
+TopSitesModel::Row TopSitesModel::makeRow(const Site& site) const
+{
+  Row row;
+  row.site = site.site;
+  if (m_favicons) {
+    row.faviconUrl = m_favicons->faviconUrlFor(site.url, kFaviconSize);
+  }
+  if (site.thumbnailVersion > 0) {
+    const QString path = thumbnailPath(site.site);
+    if (!path.isEmpty() && QFileInfo::exists(path)) {
+      row.thumbnailUrl = QUrl::fromLocalFile(path);
+      row.thumbnailUrl.setQuery(QStringLiteral("v=%1").arg(site.thumbnailVersion));
+    }
+  }
+  return row;
+}
+
+void TopSitesModel::onFaviconAvailable(const QString& key, const QUrl& faviconUrl)
+{
+  for (int i = 0; i < m_rows.size(); ++i) {
+    const QUrl siteUrl = m_sites.value(m_rows.at(i).site).url;
+    if (m_favicons->faviconKeyForUrl(siteUrl, kFaviconSize) == key) {
+      m_rows[i].faviconUrl = faviconUrl;
+      emit dataChanged(index(i), index(i), {FaviconUrlRole});
+    }
+  }
+}
+
+QString TopSitesModel::thumbnailPath(const QString& site) const
+{
+  const QByteArray hash = QCryptographicHash::hash(site.toUtf8(), QCryptographicHash::Sha1).toHex();
+  return xbrowser::userDataStorage().localPath(kThumbnailDir + QLatin1Char('/') + QString::fromLatin1(hash)
+                                               + QStringLiteral(".jpg"));
+}
+
+void TopSitesModel::load()
+{
+  QByteArray data;
+  if (!xbrowser::userDataStorage().exists(kStorageName) || !xbrowser::userDataStorage().read(kStorageName, &data)) {
+    return;
+  }
+  const QJsonDocument doc = QJsonDocument::fromJson(data);
+  if (!doc.isObject()) {
+    return;
+  }
+
+  const QJsonObject root = doc.object();
+  for (const QJsonValue& value : root.value(QStringLiteral("blocked")).toArray()) {
+    const QString site = value.toString().trimmed().toLower();
+    if (!site.isEmpty()) {
+      m_blocked.insert(site);
+    }
+  }
+
+  for (const QJsonValue& value : root.value(QStringLiteral("sites")).toArray()) {
+    const QJsonArray row = value.toArray();
+    Site site;
+    site.site = row.at(0).toString();
+    site.url = QUrl(row.at(1).toString());
+    site.title = row.at(2).toString();
+    site.score = row.at(3).toDouble();
+    site.scoreMs = static_cast<qint64>(row.at(4).toDouble());
+    site.visitCount = row.at(5).toInt();
+    site.lastVisitMs = static_cast<qint64>(row.at(6).toDouble());
+    site.thumbnailVersion = row.at(7).toInt();
+    if (site.site.isEmpty() || !site.url.isValid() || site.visitCount <= 0) {
+      continue;
+    }
+    m_sites.insert(site.site, site);
+  }
+
+  m_savedHistoryCount = static_cast<qint64>(root.value(QStringLiteral("historyCount")).toDouble(-1));
+  m_savedNewestMs = static_cast<qint64>(root.value(QStringLiteral("newestVisitMs")).toDouble());
+}
+
+void TopSitesModel::scheduleSave()
+{
+  m_saveTimer.start();
+}
+
+qint64 TopSitesModel::newestVisitMs() const
+{
+  return m_history ? m_history->newestVisitMs() : 0;
+}
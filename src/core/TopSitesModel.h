@@ -0,0 +1,133 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+class FaviconCache;
+class HistoryStore;
+
+// The most visited sites, one row per registrable domain, ranked by
+// frecency: every visit counts 1, halving every kHalfLifeMs. The aggregate
+// follows HistoryStore row by row (inserted visits add, removed ones
+// subtract) and is only rebuilt from scratch when history resets. It is
+// saved with the history's size and newest visit, so a restart that finds
+// history unchanged loads it instead of scanning.
+//
+// Rows carry their favicon and thumbnail URLs already resolved, so tiles
+// paint in their first frame. Blocked sites keep counting but are not
+// shown.
+class TopSitesModel final : public QAbstractListModel
+{
+  Q_OBJECT
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(int maxCount READ maxCount WRITE setMaxCount NOTIFY maxCountChanged)
+
+public:
+  enum Role
+  {
+    SiteRole = Qt::UserRole + 1,
+    TitleRole,
+    UrlRole,
+    VisitCountRole,
+    LastVisitedMsRole,
+    FaviconUrlRole,
+    ThumbnailUrlRole,
+  };
+  Q_ENUM(Role)
+
+  static constexpr int kDefaultMaxCount = 8;
+  static constexpr qint64 kHalfLifeMs = 14LL * 24LL * 60LL * 60LL * 1000LL;
+
+  explicit TopSitesModel(QObject* parent = nullptr);
+  ~TopSitesModel() override;
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  void setHistory(HistoryStore* history);
+  void setFavicons(FaviconCache* favicons);
+
+  int count() const;
+  int maxCount() const;
+  void setMaxCount(int count);
+
+  // Sites tracked, shown or not.
+  int siteCount() const;
+
+  Q_INVOKABLE void block(const QUrl& url);
+  Q_INVOKABLE void unblock(const QString& site);
+  Q_INVOKABLE void clearBlocklist();
+  Q_INVOKABLE QStringList blockedSites() const;
+
+  // Keeps a scaled copy of imagePath as the tile picture of pageUrl's site,
+  // if that site is shown.
+  Q_INVOKABLE void setThumbnail(const QUrl& pageUrl, const QString& imagePath);
+
+  // Orders sites by score decayed to a common moment.
+  static double rank(double score, qint64 scoreMs);
+
+  bool saveNow() const;
+  bool waitForIdle(int msecs = -1);
+
+signals:
+  void countChanged();
+  void maxCountChanged();
+
+private:
+  struct Site
+  {
+    QString site;
+    QUrl url;
+    QString title;
+    // Decayed visit count as of scoreMs.
+    double score = 0.0;
+    qint64 scoreMs = 0;
+    int visitCount = 0;
+    qint64 lastVisitMs = 0;
+    int thumbnailVersion = 0;
+    qint64 thumbnailAtMs = 0;
+  };
+
+  struct Row
+  {
+    QString site;
+    QUrl faviconUrl;
+    QUrl thumbnailUrl;
+  };
+
+  static QString siteKeyFor(const QUrl& url);
+  static void addScore(Site& site, qint64 visitedMs, int count);
+
+  void addRows(int first, int last);
+  void removeRows(int first, int last);
+  void addVisit(const QUrl& url, const QString& title, qint64 visitedMs, int count);
+  void rebuild();
+  void refreshRows();
+  Row makeRow(const Site& site) const;
+  void onFaviconAvailable(const QString& key, const QUrl& faviconUrl);
+  QString thumbnailPath(const QString& site) const;
+
+  void load();
+  void scheduleSave();
+  qint64 newestVisitMs() const;
+
+  QPointer<HistoryStore> m_history;
+  QPointer<FaviconCache> m_favicons;
+  QHash<QString, Site> m_sites;
+  QSet<QString> m_blocked;
+  QVector<Row> m_rows;
+  int m_maxCount = kDefaultMaxCount;
+  // The history the saved aggregate was built from.
+  qint64 m_savedHistoryCount = -1;
+  qint64 m_savedNewestMs = 0;
+  QTimer m_saveTimer;
+  QTimer m_rebuildTimer;
+  QThreadPool m_pool;
+};
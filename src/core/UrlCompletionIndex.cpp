@@ -0,0 +1,450 @@
+#include "UrlCompletionIndex.h"
+
+#include "BookmarksStore.h"
+#include "HistoryStore.h"
+
+#include <QStringList>
+
+#include <algorithm>
+
+namespace
+{
+constexpr int kMaxPathDepth = 4;
+
+struct KeyedUrl
+{
+  QString text;
+  QUrl url;
+};
+
+// Keys drop the scheme and a leading "www." so "git" reaches github.com
+// however it was visited. Each URL contributes its host and up to
+// kMaxPathDepth path prefixes; query and fragment are ignored.
+QVector<KeyedUrl> completionKeys(const QUrl& url)
+{
+  const QString scheme = url.scheme();
+  if (scheme != QStringLiteral("http") && scheme != QStringLiteral("https")) {
+    return {};
+  }
+
+  const QString host = url.host().toLower();
+  if (host.isEmpty()) {
+    return {};
+  }
+
+  QString displayHost = host;
+  if (displayHost.startsWith(QStringLiteral("www.")) && displayHost.size() > 4) {
+    displayHost.remove(0, 4);
+  }
+  if (url.port() > 0) {
+    displayHost += QStringLiteral(":%1").arg(url.port());
+  }
+
+  QUrl base;
+  base.setScheme(scheme);
+  base.setHost(host);
+  base.setPort(url.port());
+  base.setPath(QStringLiteral("/"));
+
+  QVector<KeyedUrl> keys;
+  keys.push_back({ displayHost + QLatin1Char('/'), base });
+
+  const QString path = url.path(QUrl::FullyDecoded);
+  const QStringList segments = path.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+  const bool trailingSlash = path.endsWith(QLatin1Char('/'));
+
+  QString prefix = QStringLiteral("/");
+  for (int i = 0; i < segments.size() && i < kMaxPathDepth; ++i) {
+    prefix += segments.at(i);
+    if (i + 1 < segments.size() || trailingSlash) {
+      prefix += QLatin1Char('/');
+    }
+
+    QUrl prefixUrl = base;
+    prefixUrl.setPath(prefix);
+    keys.push_back({ displayHost + prefix, prefixUrl });
+  }
+  return keys;
+}
+
+qsizetype commonPrefixLength(QStringView a, QStringView b)
+{
+  const qsizetype limit = qMin(a.size(), b.size());
+  qsizetype i = 0;
+  while (i < limit && a.at(i) == b.at(i)) {
+    ++i;
+  }
+  return i;
+}
+}
+
+UrlCompletionIndex::UrlCompletionIndex(QObject* parent)
+  : QObject(parent)
+{
+}
+
+HistoryStore* UrlCompletionIndex::history() const
+{
+  return m_history;
+}
+
+void UrlCompletionIndex::setHistory(HistoryStore* history)
+{
+  if (m_history == history) {
+    return;
+  }
+
+  if (m_history) {
+    disconnect(m_history, nullptr, this, nullptr);
+  }
+  m_history = history;
+  if (m_history) {
+    watch(m_history, HistoryStore::UrlRole, -1, HistoryStore::VisitCountRole, 1);
+  }
+  invalidate();
+}
+
+BookmarksStore* UrlCompletionIndex::bookmarks() const
+{
+  return m_bookmarks;
+}
+
+void UrlCompletionIndex::setBookmarks(BookmarksStore* bookmarks)
+{
+  if (m_bookmarks == bookmarks) {
+    return;
+  }
+
+  if (m_bookmarks) {
+    disconnect(m_bookmarks, nullptr, this, nullptr);
+  }
+  m_bookmarks = bookmarks;
+  if (m_bookmarks) {
+    watch(m_bookmarks, BookmarksStore::UrlRole, BookmarksStore::IsFolderRole, -1, kBookmarkWeight);
+  }
+  invalidate();
+}
+
+void UrlCompletionIndex::watch(QAbstractItemModel* model, int urlRole, int folderRole, int countRole, int weight)
+{
+  connect(model, &QAbstractItemModel::rowsInserted, this,
+          [this, model, urlRole, folderRole, countRole, weight](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid() && !m_dirty) {
+              addModelRows(model, first, last, urlRole, folderRole, countRole, weight);
+            }
+          });
+  connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this,
+          [this, model, urlRole, folderRole, countRole, weight](const QModelIndex& parent, int first, int last) {
+            if (!parent.isValid() && !m_dirty) {
+              addModelRows(model, first, last, urlRole, folderRole, countRole, -weight);
+            }
+          });
+  connect(model, &QAbstractItemModel::modelReset, this, &UrlCompletionIndex::invalidate);
+  connect(model, &QObject::destroyed, this, &UrlCompletionIndex::invalidate);
+}
+
+void UrlCompletionIndex::invalidate()
+{
+  m_dirty = true;
+}
+
+void UrlCompletionIndex::addUrl(const QUrl& url, int weight)
+{
+  ensureBuilt();
+  if (weight > 0) {
+    adjust(url, weight, true);
+  }
+}
+
+void UrlCompletionIndex::removeUrl(const QUrl& url, int weight)
+{
+  ensureBuilt();
+  if (weight > 0) {
+    adjust(url, -weight, true);
+  }
+}
+
+void UrlCompletionIndex::clear()
+{
+  m_nodes.clear();
+  m_entries.clear();
+  m_nodes.push_back(Node());
+  m_dirty = false;
+}
+
+void UrlCompletionIndex::ensureBuilt()
+{
+  if (!m_dirty) {
+    return;
+  }
+
+  clear();
+  if (m_history) {
+    const int rows = m_history->rowCount();
+    for (int row = 0; row < rows; ++row) {
+      // A collapsed history row weighs as much as the visits it stands for.
+      const QModelIndex idx = m_history->index(row, 0);
+      adjust(idx.data(HistoryStore::UrlRole).toUrl(), qMax(1, idx.data(HistoryStore::VisitCountRole).toInt()), false);
+    }
+  }
+  if (m_bookmarks) {
+    const int rows = m_bookmarks->rowCount();
+    for (int row = 0; row < rows; ++row) {
+      const QModelIndex idx = m_bookmarks->index(row, 0);
+      if (!idx.data(BookmarksStore::IsFolderRole).toBool()) {
+        adjust(idx.data(BookmarksStore::UrlRole).toUrl(), kBookmarkWeight, false);
+      }
+    }
+  }
+
+  // Bulk builds skip per-insert propagation and settle every node's best
+  // completion once, children before parents.
+  QVector<int> order;
+  order.reserve(m_nodes.size());
+  order.push_back(0);
+  for (int i = 0; i < order.size(); ++i) {
+    order += m_nodes.at(order.at(i)).children;
+  }
+  for (auto it = order.crbegin(); it != order.crend(); ++it) {
+    settleBest(*it);
+  }
+}
+
+void UrlCompletionIndex::addModelRows(QAbstractItemModel* model, int first, int last, int urlRole, int folderRole,
+                                      int countRole, int delta)
+{
+  for (int row = first; row <= last; ++row) {
+    const QModelIndex idx = model->index(row, 0);
+    if (folderRole >= 0 && idx.data(folderRole).toBool()) {
+      continue;
+    }
+    const int count = countRole >= 0 ? qMax(1, idx.data(countRole).toInt()) : 1;
+    adjust(idx.data(urlRole).toUrl(), delta * count, true);
+  }
+}
+
+void UrlCompletionIndex::adjust(const QUrl& url, int delta, bool propagate)
+{
+  for (const KeyedUrl& keyed : completionKeys(url)) {
+    const QString key = keyed.text.toLower();
+    const int nodeId = delta > 0 ? insertKey(key) : findExact(key);
+    if (nodeId < 0) {
+      continue;
+    }
+
+    Node& node = m_nodes[nodeId];
+    if (node.entry < 0) {
+      if (delta <= 0) {
+        continue;
+      }
+      node.entry = m_entries.size();
+      m_entries.push_back(Entry());
+    }
+
+    Entry& entry = m_entries[node.entry];
+    entry.weight = qMax(0, entry.weight + delta);
+    if (delta > 0) {
+      entry.text = keyed.text;
+      entry.url = keyed.url;
+    }
+
+    if (propagate) {
+      for (int id = nodeId; id >= 0; id = m_nodes.at(id).parent) {
+        settleBest(id);
+      }
+    }
+  }
+}
+
+int UrlCompletionIndex::insertKey(const QString& key)
+{
+  int nodeId = 0;
+  QStringView rest(key);
+  while (!rest.isEmpty()) {
+    int childId = -1;
+    for (int candidate : m_nodes.at(nodeId).children) {
+      if (m_nodes.at(candidate).edge.at(0) == rest.at(0)) {
+        childId = candidate;
+        break;
+      }
+    }
+
+    if (childId < 0) {
+      Node leaf;
+      leaf.edge = rest.toString();
+      leaf.parent = nodeId;
+      m_nodes.push_back(leaf);
+      m_nodes[nodeId].children.push_back(m_nodes.size() - 1);
+      return m_nodes.size() - 1;
+    }
+
+    const QString edge = m_nodes.at(childId).edge;
+    const qsizetype shared = commonPrefixLength(edge, rest);
+    if (shared < edge.size()) {
+      Node split;
+      split.edge = edge.left(shared);
+      split.parent = nodeId;
+      split.children.push_back(childId);
+      split.best = m_nodes.at(childId).best;
+      m_nodes.push_back(split);
+      const int splitId = m_nodes.size() - 1;
+
+      QVector<int>& siblings = m_nodes[nodeId].children;
+      siblings[siblings.indexOf(childId)] = splitId;
+      m_nodes[childId].edge = edge.mid(shared);
+      m_nodes[childId].parent = splitId;
+      childId = splitId;
+    }
+
+    nodeId = childId;
+    rest = rest.sliced(shared);
+  }
+  return nodeId;
+}
+
+int UrlCompletionIndex::descend(QStringView prefix, bool exact) const
+{
+  int nodeId = 0;
+  QStringView rest = prefix;
+  while (!rest.isEmpty()) {
+    int childId = -1;
+    for (int candidate : m_nodes.at(nodeId).children) {
+      if (m_nodes.at(candidate).edge.at(0) == rest.at(0)) {
+        childId = candidate;
+        break;
+      }
+    }
+    if (childId < 0) {
+      return -1;
+    }
+
+    const QString& edge = m_nodes.at(childId).edge;
+    const qsizetype shared = commonPrefixLength(edge, rest);
+    if (shared == rest.size()) {
+      return (exact && shared != edge.size()) ? -1 : childId;
+    }
+    if (shared < edge.size()) {
+      return -1;
+    }
+
+    nodeId = childId;
+    rest = rest.sliced(shared);
+  }
+  return nodeId;
+}
+
+int UrlCompletionIndex::findExact(const QString& key) const
+{
+  return descend(key, true);
+}
+
+void UrlCompletionIndex::settleBest(int nodeId)
+{
+  Node& node = m_nodes[nodeId];
+  int best = (node.entry >= 0 && m_entries.at(node.entry).weight > 0) ? node.entry : -1;
+  for (int childId : node.children) {
+    const int candidate = m_nodes.at(childId).best;
+    if (betterEntry(candidate, best)) {
+      best = candidate;
+    }
+  }
+  node.best = best;
+}
+
+bool UrlCompletionIndex::betterEntry(int candidate, int current) const
+{
+  if (candidate < 0 || m_entries.at(candidate).weight <= 0) {
+    return false;
+  }
+  if (current < 0) {
+    return true;
+  }
+
+  const Entry& a = m_entries.at(candidate);
+  const Entry& b = m_entries.at(current);
+  if (a.weight != b.weight) {
+    return a.weight > b.weight;
+  }
+  if (a.text.size() != b.text.size()) {
+    return a.text.size() < b.text.size();
+  }
+  return a.text < b.text;
+}
+
+UrlCompletionIndex::Completion UrlCompletionIndex::complete(const QString& typed)
+{
+  ensureBuilt();
+
+  if (typed.isEmpty() || typed.contains(QLatin1Char(' '))) {
+    return {};
+  }
+
+  QStringView lookup(typed);
+  for (const QLatin1StringView scheme : { QLatin1StringView("https://"), QLatin1StringView("http://") }) {
+    if (lookup.startsWith(scheme, Qt::CaseInsensitive)) {
+      lookup = lookup.sliced(scheme.size());
+      break;
+    }
+  }
+  if (lookup.startsWith(QLatin1StringView("www."), Qt::CaseInsensitive)) {
+    lookup = lookup.sliced(4);
+  }
+  if (lookup.isEmpty()) {
+    return {};
+  }
+
+  const QString key = lookup.toString().toLower();
+  const int nodeId = descend(key, false);
+  if (nodeId < 0) {
+    return {};
+  }
+
+  // A fully typed key can only be extended, so its own entry competes with
+  // nothing and the best completion comes from the children.
+  const Node& node = m_nodes.at(nodeId);
+  int best = node.best;
+  if (best >= 0 && m_entries.at(best).text.size() <= key.size()) {
+    best = -1;
+    for (int childId : node.children) {
+      if (betterEntry(m_nodes.at(childId).best, best)) {
+        best = m_nodes.at(childId).best;
+      }
+    }
+  }
+  if (best < 0) {
+    return {};
+  }
+
+  const Entry& entry = m_entries.at(best);
+  if (entry.weight < kMinimumInlineWeight) {
+    return {};
+  }
+
+  Completion completion;
+  completion.remainder = entry.text.mid(key.size());
+  completion.text = typed + completion.remainder;
+  completion.url = entry.url;
+  completion.weight = entry.weight;
+  return completion;
+}
+
+QVariantMap UrlCompletionIndex::inlineCompletion(const QString& typed)
+{
+  const Completion completion = complete(typed);
+  if (!completion.isValid()) {
+    return {};
+  }
+
+  return {
+    { QStringLiteral("text"), completion.text },
+    { QStringLiteral("remainder"), completion.remainder },
+    { QStringLiteral("url"), completion.url },
+    { QStringLiteral("weight"), completion.weight },
+  };
+}
+
+int UrlCompletionIndex::entryCount()
+{
+  ensureBuilt();
+  return int(std::count_if(m_entries.cbegin(), m_entries.cend(), [](const Entry& e) { return e.weight > 0; }));
+}
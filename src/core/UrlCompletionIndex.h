@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QUrl>
+#include <QVariantMap>
+#include <QVector>
+
+class BookmarksStore;
+class HistoryStore;
+class QAbstractItemModel;
+
+// Radix trie over "host/" and "host/path/" prefixes of visited and
+// bookmarked URLs. Every node caches its heaviest completion, so the inline
+// omnibox completion for a typed prefix costs one walk down the trie.
+class UrlCompletionIndex final : public QObject
+{
+  Q_OBJECT
+
+public:
+  struct Completion
+  {
+    QString text;
+    QString remainder;
+    QUrl url;
+    int weight = 0;
+
+    bool isValid() const { return !remainder.isEmpty(); }
+  };
+
+  static constexpr int kBookmarkWeight = 4;
+  static constexpr int kMinimumInlineWeight = 2;
+
+  explicit UrlCompletionIndex(QObject* parent = nullptr);
+
+  HistoryStore* history() const;
+  void setHistory(HistoryStore* history);
+  BookmarksStore* bookmarks() const;
+  void setBookmarks(BookmarksStore* bookmarks);
+
+  void addUrl(const QUrl& url, int weight = 1);
+  void removeUrl(const QUrl& url, int weight = 1);
+  void clear();
+
+  Completion complete(const QString& typed);
+  Q_INVOKABLE QVariantMap inlineCompletion(const QString& typed);
+
+  int entryCount();
+
+private:
+  struct Node
+  {
+    QString edge;
+    QVector<int> children;
+    int parent = -1;
+    int entry = -1;
+    int best = -1;
+  };
+
+  struct Entry
+  {
+    QString text;
+    QUrl url;
+    int weight = 0;
+  };
+
+  void watch(QAbstractItemModel* model, int urlRole, int folderRole, int countRole, int weight);
+  void invalidate();
+  void ensureBuilt();
+  void addModelRows(QAbstractItemModel* model, int first, int last, int urlRole, int folderRole, int countRole, int delta);
+  void adjust(const QUrl& url, int delta, bool propagate);
+  int insertKey(const QString& key);
+  int descend(QStringView prefix, bool exact) const;
+  int findExact(const QString& key) const;
+  void settleBest(int nodeId);
+  bool betterEntry(int candidate, int current) const;
+
+  QPointer<HistoryStore> m_history;
+  QPointer<BookmarksStore> m_bookmarks;
+  QVector<Node> m_nodes;
+  QVector<Entry> m_entries;
+  bool m_dirty = true;
+};
@@ -0,0 +1,433 @@
+#include "UserCssCompiler.h"
+
+#include <QCryptographicHash>
+#include <QRegularExpression>
+
+namespace
+{
+const QString kMozDocument = QStringLiteral("@-moz-document");
+
+bool isTightBefore(QChar c)
+{
+  return c == '{' || c == '}' || c == ';' || c == ',' || c == '>';
+}
+
+bool isTightAfter(QChar c)
+{
+  return isTightBefore(c) || c == ':';
+}
+
+int skipComment(const QString& css, int i)
+{
+  const int end = css.indexOf(QStringLiteral("*/"), i + 2);
+  return end < 0 ? css.size() : end + 2;
+}
+
+int skipString(const QString& css, int i)
+{
+  const QChar quote = css.at(i);
+  int j = i + 1;
+  while (j < css.size()) {
+    const QChar c = css.at(j);
+    if (c == '\\') {
+      j += 2;
+      continue;
+    }
+    ++j;
+    if (c == quote) {
+      break;
+    }
+  }
+  return qMin(j, int(css.size()));
+}
+
+bool startsComment(const QString& css, int i)
+{
+  return css.at(i) == '/' && i + 1 < css.size() && css.at(i + 1) == '*';
+}
+
+int findMatchingBrace(const QString& css, int open)
+{
+  int depth = 0;
+  int i = open;
+  while (i < css.size()) {
+    const QChar c = css.at(i);
+    if (startsComment(css, i)) {
+      i = skipComment(css, i);
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      i = skipString(css, i);
+      continue;
+    }
+    if (c == '{') {
+      ++depth;
+    } else if (c == '}') {
+      --depth;
+      if (depth == 0) {
+        return i;
+      }
+    }
+    ++i;
+  }
+  return -1;
+}
+
+int findPreludeEnd(const QString& css, int i)
+{
+  while (i < css.size()) {
+    const QChar c = css.at(i);
+    if (startsComment(css, i)) {
+      i = skipComment(css, i);
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      i = skipString(css, i);
+      continue;
+    }
+    if (c == '{' || c == ';') {
+      return i;
+    }
+    ++i;
+  }
+  return -1;
+}
+
+QString unescapeCssString(const QString& value)
+{
+  QString out;
+  out.reserve(value.size());
+  for (int i = 0; i < value.size(); ++i) {
+    if (value.at(i) == '\\' && i + 1 < value.size()) {
+      ++i;
+    }
+    out.append(value.at(i));
+  }
+  return out;
+}
+
+QVector<UserCssCompiler::Condition> parseConditions(const QString& prelude, bool* matchesAll)
+{
+  static const QRegularExpression re(
+    QStringLiteral(R"((url-prefix|domain|url|regexp)\s*\(\s*(?:"((?:[^"\\]|\\.)*)"|'((?:[^'\\]|\\.)*)'|([^)]*?))\s*\))"),
+    QRegularExpression::CaseInsensitiveOption);
+
+  QVector<UserCssCompiler::Condition> out;
+  *matchesAll = false;
+
+  auto it = re.globalMatch(prelude);
+  while (it.hasNext()) {
+    const QRegularExpressionMatch m = it.next();
+    const QString fn = m.captured(1).toLower();
+    QString value = m.captured(2);
+    if (value.isNull()) {
+      value = m.captured(3);
+    }
+    if (!value.isNull()) {
+      value = unescapeCssString(value);
+    } else {
+      value = m.captured(4).trimmed();
+    }
+
+    UserCssCompiler::Condition condition;
+    if (fn == QStringLiteral("domain")) {
+      condition.kind = UserCssCompiler::MatchKind::Domain;
+      value = UserCssCompiler::normalizeHost(value);
+    } else if (fn == QStringLiteral("url-prefix")) {
+      condition.kind = UserCssCompiler::MatchKind::UrlPrefix;
+      if (value.isEmpty()) {
+        *matchesAll = true;
+        continue;
+      }
+    } else if (fn == QStringLiteral("url")) {
+      condition.kind = UserCssCompiler::MatchKind::Url;
+    } else {
+      condition.kind = UserCssCompiler::MatchKind::Regexp;
+    }
+
+    if (value.isEmpty()) {
+      continue;
+    }
+    condition.value = value;
+    if (condition.kind == UserCssCompiler::MatchKind::Regexp) {
+      condition.regexp.setPattern(QRegularExpression::anchoredPattern(value));
+      condition.regexp.optimize();
+    }
+    out.push_back(condition);
+  }
+
+  return out;
+}
+
+QString hostForCondition(const UserCssCompiler::Condition& condition)
+{
+  switch (condition.kind) {
+    case UserCssCompiler::MatchKind::Domain:
+      return condition.value;
+    case UserCssCompiler::MatchKind::UrlPrefix:
+    case UserCssCompiler::MatchKind::Url:
+      return UserCssCompiler::normalizeHost(QUrl(condition.value).host());
+    case UserCssCompiler::MatchKind::Regexp:
+      break;
+  }
+  return {};
+}
+}
+
+bool UserCssCompiler::CompiledMod::isEmpty() const
+{
+  return globalCss.isEmpty() && blocks.isEmpty();
+}
+
+QStringList UserCssCompiler::CompiledMod::hosts() const
+{
+  return hostIndex.keys();
+}
+
+QByteArray UserCssCompiler::CompiledMod::digestForHost(const QString& host) const
+{
+  QByteArray digest;
+  const auto it = hostIndex.constFind(host);
+  if (it == hostIndex.constEnd()) {
+    return digest;
+  }
+  for (int idx : it.value()) {
+    digest.append(blocks.at(idx).hash);
+    digest.append(',');
+  }
+  return digest;
+}
+
+QByteArray UserCssCompiler::CompiledMod::globalDigest() const
+{
+  QByteArray digest = globalHash;
+  for (int idx : unindexedBlocks) {
+    digest.append(',');
+    digest.append(blocks.at(idx).hash);
+  }
+  return digest;
+}
+
+QString UserCssCompiler::minify(const QString& css)
+{
+  QString out;
+  out.reserve(css.size());
+
+  bool pendingSpace = false;
+  int i = 0;
+  while (i < css.size()) {
+    const QChar c = css.at(i);
+
+    if (startsComment(css, i)) {
+      i = skipComment(css, i);
+      pendingSpace = true;
+      continue;
+    }
+
+    if (c.isSpace()) {
+      pendingSpace = true;
+      ++i;
+      continue;
+    }
+
+    if (pendingSpace && !out.isEmpty() && !isTightAfter(out.back()) && !isTightBefore(c)) {
+      out.append(QLatin1Char(' '));
+    }
+    pendingSpace = false;
+
+    if (c == '"' || c == '\'') {
+      const int end = skipString(css, i);
+      out.append(QStringView(css).mid(i, end - i));
+      i = end;
+      continue;
+    }
+
+    if (c == '}' && out.endsWith(QLatin1Char(';'))) {
+      out.chop(1);
+    }
+    if (c == ';' && (out.isEmpty() || out.endsWith(QLatin1Char(';')) || out.endsWith(QLatin1Char('{')))) {
+      ++i;
+      continue;
+    }
+
+    out.append(c);
+    ++i;
+  }
+
+  return out;
+}
+
+QByteArray UserCssCompiler::contentHash(const QString& text)
+{
+  return QCryptographicHash::hash(text.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+}
+
+UserCssCompiler::CompiledMod UserCssCompiler::compile(const QString& css)
+{
+  CompiledMod mod;
+  mod.sourceHash = contentHash(css);
+
+  QString global;
+  global.reserve(css.size());
+
+  int i = 0;
+  int depth = 0;
+  while (i < css.size()) {
+    const QChar c = css.at(i);
+
+    if (startsComment(css, i)) {
+      i = skipComment(css, i);
+      global.append(QLatin1Char(' '));
+      continue;
+    }
+
+    if (c == '"' || c == '\'') {
+      const int end = skipString(css, i);
+      global.append(QStringView(css).mid(i, end - i));
+      i = end;
+      continue;
+    }
+
+    if (depth == 0 && c == '@' && QStringView(css).mid(i).startsWith(kMozDocument, Qt::CaseInsensitive)) {
+      const int preludeStart = i + kMozDocument.size();
+      const int open = findPreludeEnd(css, preludeStart);
+      if (open < 0 || css.at(open) != '{') {
+        i = open < 0 ? css.size() : open + 1;
+        continue;
+      }
+      const int close = findMatchingBrace(css, open);
+      const int bodyEnd = close < 0 ? css.size() : close;
+      const QString body = css.mid(open + 1, bodyEnd - open - 1);
+      i = close < 0 ? css.size() : close + 1;
+
+      bool matchesAll = false;
+      const QVector<Condition> conditions = parseConditions(css.mid(preludeStart, open - preludeStart), &matchesAll);
+      if (matchesAll) {
+        global.append(QLatin1Char('\n'));
+        global.append(body);
+        global.append(QLatin1Char('\n'));
+        continue;
+      }
+      if (conditions.isEmpty()) {
+        continue;
+      }
+
+      Block block;
+      block.conditions = conditions;
+      block.css = minify(body);
+      if (block.css.isEmpty()) {
+        continue;
+      }
+      block.hash = contentHash(block.css);
+
+      const int blockIndex = mod.blocks.size();
+      mod.blocks.push_back(block);
+
+      QStringList hosts;
+      bool indexable = true;
+      for (const Condition& condition : conditions) {
+        const QString host = hostForCondition(condition);
+        if (host.isEmpty()) {
+          indexable = false;
+          break;
+        }
+        if (!hosts.contains(host)) {
+          hosts.push_back(host);
+        }
+      }
+
+      if (!indexable) {
+        mod.unindexedBlocks.push_back(blockIndex);
+        continue;
+      }
+      for (const QString& host : hosts) {
+        mod.hostIndex[host].push_back(blockIndex);
+      }
+      continue;
+    }
+
+    if (c == '{') {
+      ++depth;
+    } else if (c == '}') {
+      depth = qMax(0, depth - 1);
+    }
+    global.append(c);
+    ++i;
+  }
+
+  mod.globalCss = minify(global);
+  if (!mod.globalCss.isEmpty()) {
+    mod.globalHash = contentHash(mod.globalCss);
+  }
+  return mod;
+}
+
+QString UserCssCompiler::normalizeHost(const QString& host)
+{
+  QString out = host.trimmed().toLower();
+  while (out.startsWith(QLatin1Char('.'))) {
+    out.remove(0, 1);
+  }
+  while (out.endsWith(QLatin1Char('.'))) {
+    out.chop(1);
+  }
+  return out;
+}
+
+bool UserCssCompiler::hostMatches(const QString& host, const QString& domain)
+{
+  if (host.isEmpty() || domain.isEmpty()) {
+    return false;
+  }
+  if (host == domain) {
+    return true;
+  }
+  return host.size() > domain.size() && host.endsWith(domain) && host.at(host.size() - domain.size() - 1) == '.';
+}
+
+bool UserCssCompiler::blockMatches(const Block& block, const QUrl& url)
+{
+  const QString host = normalizeHost(url.host());
+  const QString href = url.adjusted(QUrl::RemoveFragment).toString(QUrl::FullyEncoded);
+
+  for (const Condition& condition : block.conditions) {
+    switch (condition.kind) {
+      case MatchKind::Domain:
+        if (hostMatches(host, condition.value)) {
+          return true;
+        }
+        break;
+      case MatchKind::UrlPrefix:
+        if (href.startsWith(condition.value)) {
+          return true;
+        }
+        break;
+      case MatchKind::Url:
+        if (href == condition.value) {
+          return true;
+        }
+        break;
+      case MatchKind::Regexp:
+        if (condition.regexp.isValid() && condition.regexp.match(href).hasMatch()) {
+          return true;
+        }
+        break;
+    }
+  }
+  return false;
+}
+
+QStringList UserCssCompiler::hostSuffixes(const QString& host)
+{
+  QStringList out;
+  QString current = normalizeHost(host);
+  while (!current.isEmpty()) {
+    out.push_back(current);
+    const int dot = current.indexOf(QLatin1Char('.'));
+    if (dot < 0) {
+      break;
+    }
+    current = current.mid(dot + 1);
+  }
+  return out;
+}
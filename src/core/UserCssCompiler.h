@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+
+class UserCssCompiler
+{
+public:
+  enum class MatchKind
+  {
+    Domain,
+    UrlPrefix,
+    Url,
+    Regexp,
+  };
+
+  struct Condition
+  {
+    MatchKind kind = MatchKind::Domain;
+    QString value;
+    // Compiled once when the mod is, for Regexp conditions.
+    QRegularExpression regexp;
+  };
+
+  struct Block
+  {
+    QVector<Condition> conditions;
+    QString css;
+    QByteArray hash;
+  };
+
+  struct CompiledMod
+  {
+    QByteArray sourceHash;
+    QString globalCss;
+    QByteArray globalHash;
+    QVector<Block> blocks;
+
+    // Host -> indices into blocks. Blocks that cannot be keyed by host
+    // (regexp, host-less url-prefix) land in unindexedBlocks.
+    QHash<QString, QVector<int>> hostIndex;
+    QVector<int> unindexedBlocks;
+
+    bool isEmpty() const;
+    QStringList hosts() const;
+    QByteArray digestForHost(const QString& host) const;
+    QByteArray globalDigest() const;
+  };
+
+  static QString minify(const QString& css);
+  static QByteArray contentHash(const QString& text);
+  static CompiledMod compile(const QString& css);
+
+  static QString normalizeHost(const QString& host);
+  static bool hostMatches(const QString& host, const QString& domain);
+  static bool blockMatches(const Block& block, const QUrl& url);
+  static QStringList hostSuffixes(const QString& host);
+};
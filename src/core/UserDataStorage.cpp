@@ -0,0 +1,134 @@
+#include "UserDataStorage.h"
+
+#include "AppPaths.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace xbrowser
+{
+namespace
+{
+std::unique_ptr<UserDataStorage>& currentStorage()
+{
+  static std::unique_ptr<UserDataStorage> storage = std::make_unique<FileUserDataStorage>();
+  return storage;
+}
+}
+
+QString FileUserDataStorage::locationKey(const QString& name) const
+{
+  return localPath(name);
+}
+
+QString FileUserDataStorage::localPath(const QString& name) const
+{
+  return QDir(appDataRoot()).filePath(name);
+}
+
+bool FileUserDataStorage::exists(const QString& name) const
+{
+  return QFileInfo::exists(localPath(name));
+}
+
+bool FileUserDataStorage::read(const QString& name, QByteArray* data, QString* error) const
+{
+  QFile f(localPath(name));
+  if (!f.open(QIODevice::ReadOnly)) {
+    if (error) {
+      *error = f.errorString();
+    }
+    return false;
+  }
+
+  if (data) {
+    *data = f.readAll();
+  }
+  return true;
+}
+
+bool FileUserDataStorage::write(const QString& name, const QByteArray& data, QString* error)
+{
+  const QString path = localPath(name);
+  QDir().mkpath(QFileInfo(path).absolutePath());
+
+  QSaveFile out(path);
+  if (!out.open(QIODevice::WriteOnly)) {
+    if (error) {
+      *error = out.errorString();
+    }
+    return false;
+  }
+
+  out.write(data);
+  if (!out.commit()) {
+    if (error) {
+      *error = out.errorString();
+    }
+    return false;
+  }
+  return true;
+}
+
+bool FileUserDataStorage::remove(const QString& name)
+{
+  const QString path = localPath(name);
+  return !QFileInfo::exists(path) || QFile::remove(path);
+}
+
+QString MemoryUserDataStorage::locationKey(const QString& name) const
+{
+  // Per instance, so swapping in a fresh backend reads as a new location.
+  return QStringLiteral("memory:%1/%2").arg(reinterpret_cast<quintptr>(this), 0, 16).arg(name);
+}
+
+QString MemoryUserDataStorage::localPath(const QString&) const
+{
+  return {};
+}
+
+bool MemoryUserDataStorage::exists(const QString& name) const
+{
+  return m_blobs.contains(name);
+}
+
+bool MemoryUserDataStorage::read(const QString& name, QByteArray* data, QString* error) const
+{
+  const auto it = m_blobs.constFind(name);
+  if (it == m_blobs.constEnd()) {
+    if (error) {
+      *error = QStringLiteral("%1 does not exist").arg(name);
+    }
+    return false;
+  }
+
+  if (data) {
+    *data = it.value();
+  }
+  return true;
+}
+
+bool MemoryUserDataStorage::write(const QString& name, const QByteArray& data, QString*)
+{
+  m_blobs.insert(name, data);
+  return true;
+}
+
+bool MemoryUserDataStorage::remove(const QString& name)
+{
+  m_blobs.remove(name);
+  return true;
+}
+
+UserDataStorage& userDataStorage()
+{
+  return *currentStorage();
+}
+
+void setUserDataStorage(std::unique_ptr<UserDataStorage> storage)
+{
+  currentStorage() = storage ? std::move(storage) : std::make_unique<FileUserDataStorage>();
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+#include <memory>
+
+namespace xbrowser
+{
+// Named blobs the user-data stores (history, bookmarks, downloads, session,
+// favicons, site permissions) serialize into. Normally files under
+// appDataRoot(); incognito switches to an in-memory backend so a private
+// session never writes user data to disk and ends by freeing memory.
+// Used from the GUI thread only.
+class UserDataStorage
+{
+public:
+  virtual ~UserDataStorage() = default;
+
+  // Changes whenever the backing location does, so stores that cache what
+  // they loaded know to load again.
+  virtual QString locationKey(const QString& name) const = 0;
+
+  // A file on disk for callers that need one (append-only logs, URLs handed
+  // to QML); empty when the backend keeps nothing on disk.
+  virtual QString localPath(const QString& name) const = 0;
+
+  virtual bool exists(const QString& name) const = 0;
+  virtual bool read(const QString& name, QByteArray* data, QString* error = nullptr) const = 0;
+  virtual bool write(const QString& name, const QByteArray& data, QString* error = nullptr) = 0;
+  virtual bool remove(const QString& name) = 0;
+};
+
+// Resolves appDataRoot() on every call so XBROWSER_DATA_DIR changes apply.
+class FileUserDataStorage final : public UserDataStorage
+{
+public:
+  QString locationKey(const QString& name) const override;
+  QString localPath(const QString& name) const override;
+  bool exists(const QString& name) const override;
+  bool read(const QString& name, QByteArray* data, QString* error = nullptr) const override;
+  bool write(const QString& name, const QByteArray& data, QString* error = nullptr) override;
+  bool remove(const QString& name) override;
+};
+
+class MemoryUserDataStorage final : public UserDataStorage
+{
+public:
+  QString locationKey(const QString& name) const override;
+  QString localPath(const QString& name) const override;
+  bool exists(const QString& name) const override;
+  bool read(const QString& name, QByteArray* data, QString* error = nullptr) const override;
+  bool write(const QString& name, const QByteArray& data, QString* error = nullptr) override;
+  bool remove(const QString& name) override;
+
+private:
+  QHash<QString, QByteArray> m_blobs;
+};
+
+UserDataStorage& userDataStorage();
+
+// Call before the stores are created. nullptr goes back to files.
+void setUserDataStorage(std::unique_ptr<UserDataStorage> storage);
+}
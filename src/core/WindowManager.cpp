@@ -0,0 +1,257 @@
+#include "WindowManager.h"
+
+#include "BrowserController.h"
+#include "LayoutController.h"
+#include "SplitViewController.h"
+#include "TabModel.h"
+#include "WorkspaceModel.h"
+
+namespace
+{
+QVector<ClosedTabJournal::TabRecord> tabRecords(BrowserController* browser)
+{
+  QVector<ClosedTabJournal::TabRecord> records;
+  WorkspaceModel* workspaces = browser ? browser->workspaces() : nullptr;
+  for (int i = 0; workspaces && i < workspaces->count(); ++i) {
+    TabModel* tabs = workspaces->tabsForIndex(i);
+    for (int t = 0; tabs && t < tabs->count(); ++t) {
+      records.push_back(tabs->closedTabRecordAt(t));
+    }
+  }
+  return records;
+}
+}
+
+WindowManager::WindowManager(QObject* parent)
+  : QObject(parent)
+{
+}
+
+WindowManager::~WindowManager()
+{
+  // Window controllers, including those of closed windows still waiting for
+  // deleteLater, point at the shared settings and journal members, so they
+  // have to go before those do.
+  const QList<QObject*> children = findChildren<QObject*>(Qt::FindDirectChildrenOnly);
+  for (auto it = children.crbegin(); it != children.crend(); ++it) {
+    delete *it;
+  }
+}
+
+int WindowManager::count() const
+{
+  return m_windows.size();
+}
+
+QVector<int> WindowManager::windowIds() const
+{
+  QVector<int> ids;
+  ids.reserve(m_windows.size());
+  for (const Window& window : m_windows) {
+    ids.push_back(window.id);
+  }
+  return ids;
+}
+
+bool WindowManager::hasWindow(int windowId) const
+{
+  return indexOfWindow(windowId) >= 0;
+}
+
+BrowserController* WindowManager::browser(int windowId) const
+{
+  const int index = indexOfWindow(windowId);
+  return index >= 0 ? m_windows.at(index).browser.data() : nullptr;
+}
+
+SplitViewController* WindowManager::splitView(int windowId) const
+{
+  const int index = indexOfWindow(windowId);
+  return index >= 0 ? m_windows.at(index).splitView.data() : nullptr;
+}
+
+LayoutController* WindowManager::layout(int windowId) const
+{
+  const int index = indexOfWindow(windowId);
+  return index >= 0 ? m_windows.at(index).layout.data() : nullptr;
+}
+
+AppSettings* WindowManager::settings()
+{
+  return &m_settings;
+}
+
+ClosedTabJournal* WindowManager::closedTabJournal()
+{
+  return &m_closedTabs;
+}
+
+int WindowManager::activeWindowId() const
+{
+  return m_activeWindowId;
+}
+
+void WindowManager::setActiveWindowId(int windowId)
+{
+  if (m_activeWindowId == windowId || !hasWindow(windowId)) {
+    return;
+  }
+  m_activeWindowId = windowId;
+  emit activeWindowChanged();
+}
+
+BrowserController* WindowManager::activeBrowser() const
+{
+  return browser(m_activeWindowId);
+}
+
+SplitViewController* WindowManager::activeSplitView() const
+{
+  return splitView(m_activeWindowId);
+}
+
+int WindowManager::createWindow()
+{
+  Window window;
+  window.id = m_nextWindowId++;
+  window.browser = new BrowserController(&m_settings, &m_closedTabs, this);
+
+  window.splitView = new SplitViewController(this);
+  window.splitView->setBrowser(window.browser);
+
+  window.layout = new LayoutController(this);
+  window.layout->setSettings(&m_settings);
+
+  m_windows.push_back(window);
+  emit countChanged();
+
+  if (m_activeWindowId == 0) {
+    m_activeWindowId = window.id;
+    emit activeWindowChanged();
+  }
+
+  emit windowCreated(window.id);
+  return window.id;
+}
+
+int WindowManager::openWindow(const QUrl& url)
+{
+  const int windowId = createWindow();
+  if (BrowserController* target = browser(windowId)) {
+    if (url.isValid() && !url.isEmpty()) {
+      target->newTab(url);
+    } else {
+      target->newTab();
+    }
+  }
+  setActiveWindowId(windowId);
+  return windowId;
+}
+
+bool WindowManager::closeWindow(int windowId)
+{
+  const int index = indexOfWindow(windowId);
+  if (index < 0 || m_windows.size() <= 1) {
+    return false;
+  }
+
+  const Window window = m_windows.at(index);
+
+  m_closedTabs.push(ClosedTabJournal::Kind::Window, tabRecords(window.browser));
+
+  // Move focus first so nothing that follows the active window is left
+  // pointing at controllers that are about to be deleted.
+  if (m_activeWindowId == windowId) {
+    m_activeWindowId = m_windows.at(index == 0 ? 1 : index - 1).id;
+    emit activeWindowChanged();
+  }
+
+  m_windows.removeAt(index);
+  for (auto it = m_handoffs.begin(); it != m_handoffs.end();) {
+    it = it.key().first == windowId ? m_handoffs.erase(it) : std::next(it);
+  }
+  emit countChanged();
+  emit windowClosed(windowId);
+
+  if (window.layout) {
+    window.layout->deleteLater();
+  }
+  if (window.splitView) {
+    window.splitView->deleteLater();
+  }
+  if (window.browser) {
+    window.browser->deleteLater();
+  }
+  return true;
+}
+
+int WindowManager::moveTabToWindow(int fromWindowId, int tabId, int toWindowId)
+{
+  BrowserController* source = browser(fromWindowId);
+  BrowserController* target = browser(toWindowId);
+  if (!source || !target || source == target) {
+    return -1;
+  }
+
+  TabModel* sourceTabs = source->tabs();
+  TabModel* targetTabs = target->tabs();
+  const int sourceIndex = sourceTabs ? sourceTabs->indexOfTabId(tabId) : -1;
+  if (sourceIndex < 0 || !targetTabs) {
+    return -1;
+  }
+
+  ClosedTabJournal::TabRecord record = sourceTabs->closedTabRecordAt(sourceIndex);
+  // Group ids are per window.
+  record.groupId = 0;
+
+  const int token = ++m_nextHandoffToken;
+  emit tabHandoffRequested(fromWindowId, tabId, token);
+  sourceTabs->removeTab(sourceIndex);
+
+  // Tab ids are per tab model; keep the id if the target has it free.
+  int targetTabId = tabId;
+  if (targetTabs->indexOfTabId(targetTabId) >= 0) {
+    targetTabId = 1;
+    for (int i = 0; i < targetTabs->count(); ++i) {
+      targetTabId = qMax(targetTabId, targetTabs->tabIdAt(i) + 1);
+    }
+  }
+
+  // Registered before the insert: the target view is created from the
+  // rowsInserted handler and claims the token right away.
+  m_handoffs.insert(qMakePair(toWindowId, targetTabId), token);
+  targetTabs->addClosedTab(record, true, targetTabId);
+
+  if (sourceTabs->count() == 0 && tabRecords(source).isEmpty()) {
+    closeWindow(fromWindowId);
+  }
+  return targetTabId;
+}
+
+int WindowManager::moveTabToNewWindow(int fromWindowId, int tabId)
+{
+  BrowserController* source = browser(fromWindowId);
+  if (!source || !source->tabs() || source->tabs()->indexOfTabId(tabId) < 0) {
+    return -1;
+  }
+
+  const int windowId = createWindow();
+  const int movedId = moveTabToWindow(fromWindowId, tabId, windowId);
+  setActiveWindowId(windowId);
+  return movedId;
+}
+
+int WindowManager::takeHandoffToken(int windowId, int tabId)
+{
+  return m_handoffs.take(qMakePair(windowId, tabId));
+}
+
+int WindowManager::indexOfWindow(int windowId) const
+{
+  for (int i = 0; i < m_windows.size(); ++i) {
+    if (m_windows.at(i).id == windowId) {
+      return i;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QUrl>
+#include <QVector>
+
+#include "AppSettings.h"
+#include "ClosedTabJournal.h"
+
+class BrowserController;
+class LayoutController;
+class SplitViewController;
+
+// Every browser window of a profile lives in this process. Each window has
+// its own tabs, workspaces and split view; settings and the recently-closed
+// journal are shared. Opening a window is a QML component instance, not a
+// new process, so windows reuse the already-created WebView2 environment.
+class WindowManager final : public QObject
+{
+  Q_OBJECT
+  Q_PROPERTY(int count READ count NOTIFY countChanged)
+  Q_PROPERTY(int activeWindowId READ activeWindowId WRITE setActiveWindowId NOTIFY activeWindowChanged)
+  Q_PROPERTY(AppSettings* settings READ settings CONSTANT)
+
+public:
+  explicit WindowManager(QObject* parent = nullptr);
+  ~WindowManager() override;
+
+  int count() const;
+  QVector<int> windowIds() const;
+  bool hasWindow(int windowId) const;
+
+  BrowserController* browser(int windowId) const;
+  SplitViewController* splitView(int windowId) const;
+  LayoutController* layout(int windowId) const;
+
+  AppSettings* settings();
+  ClosedTabJournal* closedTabJournal();
+
+  int activeWindowId() const;
+  void setActiveWindowId(int windowId);
+  BrowserController* activeBrowser() const;
+  SplitViewController* activeSplitView() const;
+
+  // An empty window; callers that show it to the user add a tab first.
+  int createWindow();
+  Q_INVOKABLE int openWindow(const QUrl& url = {});
+
+  // Closing the last window is the app quitting: it stays in the session
+  // instead of the recently-closed list, so this returns false.
+  Q_INVOKABLE bool closeWindow(int windowId);
+
+  // Moves a tab without reloading it. tabHandoffRequested lets the source
+  // view park its live web view under a token, which the target claims with
+  // takeHandoffToken when it creates the view for the new tab id. Returns
+  // the tab id in the target window, or -1.
+  Q_INVOKABLE int moveTabToWindow(int fromWindowId, int tabId, int toWindowId);
+  Q_INVOKABLE int moveTabToNewWindow(int fromWindowId, int tabId);
+  Q_INVOKABLE int takeHandoffToken(int windowId, int tabId);
+
+signals:
+  void countChanged();
+  void activeWindowChanged();
+  void windowCreated(int windowId);
+  void windowClosed(int windowId);
+  void tabHandoffRequested(int windowId, int tabId, int token);
+
+private:
+  struct Window
+  {
+    int id = 0;
+    QPointer<BrowserController> browser;
+    QPointer<SplitViewController> splitView;
+    QPointer<LayoutController> layout;
+  };
+
+  int indexOfWindow(int windowId) const;
+
+  AppSettings m_settings;
+  ClosedTabJournal m_closedTabs;
+  QVector<Window> m_windows;
+  QHash<QPair<int, int>, int> m_handoffs;
+  int m_activeWindowId = 0;
+  int m_nextWindowId = 1;
+  int m_nextHandoffToken = 0;
+};
@@ -135,6 +135,9 @@ int WorkspaceModel::addWorkspaceWithId(int workspaceId, const QString& name, con
   entry.accentColor = accentColor.isValid() ? accentColor : defaultWorkspaceAccentColor(entry.id);
   entry.tabs = new TabModel(this);
   entry.groups = new TabGroupModel(this);
+  if (m_closedTabJournal) {
+    entry.tabs->setClosedTabJournal(m_closedTabJournal, entry.id);
+  }
   m_workspaces.push_back(entry);
 
   if (entry.id >= m_nextId) {
@@ -495,6 +498,16 @@ TabGroupModel* WorkspaceModel::groupsForIndex(int index) const
   return m_workspaces[index].groups;
 }
 
+void WorkspaceModel::setClosedTabJournal(ClosedTabJournal* journal)
+{
+  m_closedTabJournal = journal;
+  for (const auto& entry : m_workspaces) {
+    if (entry.tabs) {
+      entry.tabs->setClosedTabJournal(journal, entry.id);
+    }
+  }
+}
+
 void WorkspaceModel::updateActiveIndexAfterClose(int closedIndex)
 {
   if (m_workspaces.isEmpty()) {
@@ -3,6 +3,7 @@
 #include <QAbstractListModel>
 #include <QColor>
 
+class ClosedTabJournal;
 class TabModel;
 class TabGroupModel;
 
@@ -64,6 +65,8 @@ public:
   TabModel* tabsForIndex(int index) const;
   TabGroupModel* groupsForIndex(int index) const;
 
+  void setClosedTabJournal(ClosedTabJournal* journal);
+
 signals:
   void activeIndexChanged();
 
@@ -84,6 +87,7 @@ private:
   QVector<WorkspaceEntry> m_workspaces;
   int m_activeIndex = -1;
   int m_nextId = 1;
+  ClosedTabJournal* m_closedTabJournal = nullptr;
 
   void updateActiveIndexAfterClose(int closedIndex);
 };
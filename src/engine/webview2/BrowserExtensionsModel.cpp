@@ -5,12 +5,8 @@
 
 #include <Windows.h>
 
-#include <QFile>
 #include <QDir>
 #include <QFileInfo>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QMetaObject>
 
 using Microsoft::WRL::Callback;
@@ -63,96 +59,10 @@ QString normalizeUrlPath(QString relPath)
   return out;
 }
 
-struct ManifestMeta
+QString extensionUrl(const QString& extensionId, const QString& relPath)
 {
-  QString iconPath;
-  QString popupRelPath;
-  QString optionsRelPath;
-  QString version;
-  QString description;
-  QStringList permissions;
-  QStringList hostPermissions;
-};
-
-QString pickIconRelPath(const QJsonObject& iconsObj)
-{
-  const int preferredSizes[] = { 32, 24, 16, 48, 64, 128, 256 };
-  for (int size : preferredSizes) {
-    const QString candidate = iconsObj.value(QString::number(size)).toString().trimmed();
-    if (!candidate.isEmpty()) {
-      return candidate;
-    }
-  }
-
-  for (auto it = iconsObj.begin(); it != iconsObj.end(); ++it) {
-    const QString candidate = it.value().toString().trimmed();
-    if (!candidate.isEmpty()) {
-      return candidate;
-    }
-  }
-
-  return {};
-}
-
-ManifestMeta parseManifestMeta(const QString& folderPath)
-{
-  ManifestMeta meta;
-
-  const QString manifestPath = QDir(folderPath).filePath(QStringLiteral("manifest.json"));
-  QFile f(manifestPath);
-  if (!f.exists() || !f.open(QIODevice::ReadOnly)) {
-    return meta;
-  }
-
-  const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
-  if (!doc.isObject()) {
-    return meta;
-  }
-
-  const QJsonObject root = doc.object();
-
-  meta.version = root.value(QStringLiteral("version")).toString().trimmed();
-  meta.description = root.value(QStringLiteral("description")).toString().trimmed();
-
-  const QJsonArray permsArr = root.value(QStringLiteral("permissions")).toArray();
-  for (const QJsonValue& v : permsArr) {
-    const QString perm = v.toString().trimmed();
-    if (!perm.isEmpty() && !meta.permissions.contains(perm)) {
-      meta.permissions.push_back(perm);
-    }
-  }
-
-  const QJsonArray hostPermsArr = root.value(QStringLiteral("host_permissions")).toArray();
-  for (const QJsonValue& v : hostPermsArr) {
-    const QString perm = v.toString().trimmed();
-    if (!perm.isEmpty() && !meta.hostPermissions.contains(perm)) {
-      meta.hostPermissions.push_back(perm);
-    }
-  }
-
-  const QJsonObject iconsObj = root.value(QStringLiteral("icons")).toObject();
-  const QString iconRel = pickIconRelPath(iconsObj);
-  if (!iconRel.isEmpty()) {
-    meta.iconPath = QDir(folderPath).filePath(iconRel);
-  }
-
-  QJsonObject actionObj = root.value(QStringLiteral("action")).toObject();
-  if (actionObj.isEmpty()) {
-    actionObj = root.value(QStringLiteral("browser_action")).toObject();
-  }
-  if (actionObj.isEmpty()) {
-    actionObj = root.value(QStringLiteral("page_action")).toObject();
-  }
-  meta.popupRelPath = actionObj.value(QStringLiteral("default_popup")).toString().trimmed();
-
-  const QJsonObject optionsUiObj = root.value(QStringLiteral("options_ui")).toObject();
-  if (!optionsUiObj.isEmpty() && optionsUiObj.contains(QStringLiteral("page"))) {
-    meta.optionsRelPath = optionsUiObj.value(QStringLiteral("page")).toString().trimmed();
-  } else {
-    meta.optionsRelPath = root.value(QStringLiteral("options_page")).toString().trimmed();
-  }
-
-  return meta;
+  const QString rel = normalizeUrlPath(relPath);
+  return rel.isEmpty() ? QString() : QStringLiteral("chrome-extension://%1/%2").arg(extensionId, rel);
 }
 }
 
@@ -418,6 +328,7 @@ void BrowserExtensionsModel::refresh()
             }
 
             ExtensionsStore& store = ExtensionsStore::instance();
+            QVector<ExtensionManifestCache::ScanRequest> requests;
             for (auto& entry : entries) {
               entry.pinned = store.isPinned(entry.id);
               const QString iconPath = store.iconPathFor(entry.id);
@@ -433,15 +344,11 @@ void BrowserExtensionsModel::refresh()
               entry.hostPermissions = store.hostPermissionsFor(entry.id);
               entry.updateAvailable = false;
               if (!entry.installPath.trimmed().isEmpty()) {
-                const QString manifestPath = QDir(entry.installPath).filePath(QStringLiteral("manifest.json"));
-                const QFileInfo manifestInfo(manifestPath);
-                if (manifestInfo.exists()) {
-                  const qint64 stored = store.manifestMtimeMsFor(entry.id);
-                  const qint64 current = manifestInfo.lastModified().toMSecsSinceEpoch();
-                  if (stored > 0 && current > stored) {
-                    entry.updateAvailable = true;
-                  }
-                }
+                ExtensionManifestCache::ScanRequest request;
+                request.installPath = entry.installPath;
+                request.knownSize = store.manifestSizeFor(entry.id);
+                request.knownMtimeMs = store.manifestMtimeMsFor(entry.id);
+                requests.push_back(request);
               }
             }
 
@@ -449,6 +356,13 @@ void BrowserExtensionsModel::refresh()
             beginResetModel();
             m_extensions = std::move(entries);
             endResetModel();
+
+            if (!requests.isEmpty()) {
+              ExtensionManifestCache::instance().scanAsync(
+                requests, this, [this](const QVector<ExtensionManifestCache::ScanResult>& results) {
+                  applyManifestScan(results);
+                });
+            }
           },
           Qt::QueuedConnection);
 
@@ -488,14 +402,28 @@ void BrowserExtensionsModel::installFromFolder(const QString& folderPath)
     return;
   }
 
-  const ManifestMeta meta = parseManifestMeta(path);
-  const QString manifestPath = QDir(path).filePath(QStringLiteral("manifest.json"));
-  const qint64 manifestMtimeMs = QFileInfo(manifestPath).exists() ? QFileInfo(manifestPath).lastModified().toMSecsSinceEpoch() : 0;
+  ExtensionManifestCache::ScanRequest request;
+  request.installPath = path;
+  ExtensionManifestCache::instance().scanAsync(
+    {request}, this, [this, path](const QVector<ExtensionManifestCache::ScanResult>& results) {
+      if (results.isEmpty() || !results.first().exists) {
+        setError(QStringLiteral("manifest.json not found in: %1").arg(path));
+        return;
+      }
+      addBrowserExtension(path, results.first().manifest);
+    });
+}
+
+void BrowserExtensionsModel::addBrowserExtension(const QString& path, const ExtensionManifest& manifest)
+{
+  if (!m_profile) {
+    return;
+  }
 
   const HRESULT hr = m_profile->AddBrowserExtension(
     toWide(path).c_str(),
     Callback<ICoreWebView2ProfileAddBrowserExtensionCompletedHandler>(
-      [this, meta, path, manifestMtimeMs](HRESULT errorCode, ICoreWebView2BrowserExtension* extension) -> HRESULT {
+      [this, manifest, path](HRESULT errorCode, ICoreWebView2BrowserExtension* extension) -> HRESULT {
         QString installedId;
         if (SUCCEEDED(errorCode) && extension) {
           LPWSTR idRaw = nullptr;
@@ -505,34 +433,26 @@ void BrowserExtensionsModel::installFromFolder(const QString& folderPath)
         }
         QMetaObject::invokeMethod(
           this,
-          [this, meta, path, manifestMtimeMs, installedId, errorCode]() {
+          [this, manifest, path, installedId, errorCode]() {
             if (FAILED(errorCode)) {
               setError(QStringLiteral("Failed to install extension: %1").arg(hresultMessage(errorCode)));
               return;
             }
 
             if (!installedId.trimmed().isEmpty()) {
-              const QString popupRel = normalizeUrlPath(meta.popupRelPath);
-              const QString optionsRel = normalizeUrlPath(meta.optionsRelPath);
-              const QString popupUrl =
-                popupRel.isEmpty() ? QString() : QStringLiteral("chrome-extension://%1/%2").arg(installedId, popupRel);
-              const QString optionsUrl = optionsRel.isEmpty() ? QString()
-                                                             : QStringLiteral("chrome-extension://%1/%2").arg(installedId, optionsRel);
-
-              QString iconPath = meta.iconPath.trimmed();
-              if (!iconPath.isEmpty() && !QFileInfo::exists(iconPath)) {
-                iconPath.clear();
-              }
-
-              ExtensionsStore::instance().setMeta(installedId, iconPath, popupUrl, optionsUrl);
+              ExtensionsStore::instance().setMeta(installedId,
+                                                  manifest.iconPath,
+                                                  extensionUrl(installedId, manifest.popupRelPath),
+                                                  extensionUrl(installedId, manifest.optionsRelPath));
               ExtensionsStore::instance().setManifestMeta(
                 installedId,
                 path,
-                meta.version,
-                meta.description,
-                meta.permissions,
-                meta.hostPermissions,
-                manifestMtimeMs);
+                manifest.version,
+                manifest.description,
+                manifest.permissions,
+                manifest.hostPermissions,
+                manifest.manifestMtimeMs,
+                manifest.manifestSize);
             }
 
             clearError();
@@ -548,6 +468,59 @@ void BrowserExtensionsModel::installFromFolder(const QString& folderPath)
   }
 }
 
+void BrowserExtensionsModel::applyManifestScan(const QVector<ExtensionManifestCache::ScanResult>& results)
+{
+  ExtensionsStore& store = ExtensionsStore::instance();
+
+  for (const ExtensionManifestCache::ScanResult& result : results) {
+    if (!result.exists) {
+      continue;
+    }
+
+    for (int row = 0; row < m_extensions.size(); ++row) {
+      ExtensionEntry& entry = m_extensions[row];
+      if (entry.installPath != result.installPath) {
+        continue;
+      }
+
+      const qint64 storedMtimeMs = store.manifestMtimeMsFor(entry.id);
+      if (!result.changed) {
+        if (store.manifestSizeFor(entry.id) < 0) {
+          store.setManifestMeta(entry.id, entry.installPath, entry.version, entry.description, entry.permissions,
+                                entry.hostPermissions, storedMtimeMs, result.manifestSize);
+        }
+        continue;
+      }
+
+      if (storedMtimeMs > 0) {
+        const bool updateAvailable = result.manifestMtimeMs > storedMtimeMs;
+        if (entry.updateAvailable != updateAvailable) {
+          entry.updateAvailable = updateAvailable;
+          emit dataChanged(index(row), index(row), {UpdateAvailableRole});
+        }
+        continue;
+      }
+
+      const ExtensionManifest& manifest = result.manifest;
+      if (!manifest.valid) {
+        continue;
+      }
+
+      // Nothing was recorded for this install yet: adopt the on-disk manifest.
+      entry.version = manifest.version;
+      entry.description = manifest.description;
+      entry.permissions = manifest.permissions;
+      entry.hostPermissions = manifest.hostPermissions;
+      if (entry.iconUrl.isEmpty() && !manifest.iconPath.isEmpty()) {
+        entry.iconUrl = QUrl::fromLocalFile(manifest.iconPath);
+      }
+      store.setManifestMeta(entry.id, entry.installPath, manifest.version, manifest.description, manifest.permissions,
+                            manifest.hostPermissions, manifest.manifestMtimeMs, manifest.manifestSize);
+      emit dataChanged(index(row), index(row));
+    }
+  }
+}
+
 void BrowserExtensionsModel::removeExtension(const QString& extensionId)
 {
   if (!m_profile) {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/ExtensionManifestCache.h"
+
 #include <QAbstractListModel>
 #include <QPointer>
 #include <QString>
@@ -87,6 +89,8 @@ private:
   void setError(const QString& message);
   void clearError();
   void tryBindProfile();
+  void applyManifestScan(const QVector<ExtensionManifestCache::ScanResult>& results);
+  void addBrowserExtension(const QString& path, const ExtensionManifest& manifest);
 
   QPointer<WebView2View> m_view;
   Microsoft::WRL::ComPtr<ICoreWebView2Profile7> m_profile;
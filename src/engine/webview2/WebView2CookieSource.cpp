@@ -1,4 +1,4 @@
-#include "WebView2CookieModel.h"
+#include "WebView2CookieSource.h"
 
 #include "WebView2View.h"
 
@@ -72,17 +72,17 @@ qint64 expiresToMs(double expiresSeconds)
 }
 }
 
-WebView2CookieModel::WebView2CookieModel(QObject* parent)
-  : QAbstractListModel(parent)
+WebView2CookieSource::WebView2CookieSource(QObject* parent)
+  : CookieSource(parent)
 {
 }
 
-WebView2View* WebView2CookieModel::view() const
+WebView2View* WebView2CookieSource::view() const
 {
   return m_view;
 }
 
-void WebView2CookieModel::setView(WebView2View* view)
+void WebView2CookieSource::setView(WebView2View* view)
 {
   if (m_view == view) {
     return;
@@ -90,88 +90,9 @@ void WebView2CookieModel::setView(WebView2View* view)
 
   m_view = view;
   emit viewChanged();
-  refresh();
 }
 
-QUrl WebView2CookieModel::url() const
-{
-  return m_url;
-}
-
-void WebView2CookieModel::setUrl(const QUrl& url)
-{
-  if (m_url == url) {
-    return;
-  }
-  m_url = url;
-  emit urlChanged();
-  refresh();
-}
-
-int WebView2CookieModel::rowCount(const QModelIndex& parent) const
-{
-  if (parent.isValid()) {
-    return 0;
-  }
-  return m_entries.size();
-}
-
-QVariant WebView2CookieModel::data(const QModelIndex& index, int role) const
-{
-  if (!index.isValid() || index.row() < 0 || index.row() >= m_entries.size()) {
-    return {};
-  }
-
-  const Entry& entry = m_entries.at(index.row());
-  switch (role) {
-    case NameRole:
-      return entry.name;
-    case DomainRole:
-      return entry.domain;
-    case PathRole:
-      return entry.path;
-    case ExpiresMsRole:
-      return entry.expiresMs;
-    case HttpOnlyRole:
-      return entry.httpOnly;
-    case SecureRole:
-      return entry.secure;
-    case SessionRole:
-      return entry.session;
-    default:
-      return {};
-  }
-}
-
-QHash<int, QByteArray> WebView2CookieModel::roleNames() const
-{
-  return {
-    {NameRole, "name"},
-    {DomainRole, "domain"},
-    {PathRole, "path"},
-    {ExpiresMsRole, "expiresMs"},
-    {HttpOnlyRole, "httpOnly"},
-    {SecureRole, "secure"},
-    {SessionRole, "session"},
-  };
-}
-
-int WebView2CookieModel::count() const
-{
-  return m_entries.size();
-}
-
-bool WebView2CookieModel::loading() const
-{
-  return m_loading;
-}
-
-QString WebView2CookieModel::lastError() const
-{
-  return m_lastError;
-}
-
-QString WebView2CookieModel::normalizeCookieUri(const QUrl& url)
+QString WebView2CookieSource::normalizeCookieUri(const QUrl& url)
 {
   if (!url.isValid()) {
     return {};
@@ -199,39 +120,7 @@ QString WebView2CookieModel::normalizeCookieUri(const QUrl& url)
   return encoded;
 }
 
-void WebView2CookieModel::setLoading(bool loading)
-{
-  if (m_loading == loading) {
-    return;
-  }
-  m_loading = loading;
-  emit loadingChanged();
-}
-
-void WebView2CookieModel::setLastError(const QString& error)
-{
-  const QString trimmed = error.trimmed();
-  if (m_lastError == trimmed) {
-    return;
-  }
-  m_lastError = trimmed;
-  emit lastErrorChanged();
-}
-
-void WebView2CookieModel::setEntries(QVector<Entry> entries)
-{
-  const int before = m_entries.size();
-
-  beginResetModel();
-  m_entries = std::move(entries);
-  endResetModel();
-
-  if (before != m_entries.size()) {
-    emit countChanged();
-  }
-}
-
-bool WebView2CookieModel::withCookieManager(const std::function<void(ICoreWebView2CookieManager*)>& fn, QString* error)
+bool WebView2CookieSource::withCookieManager(const std::function<void(ICoreWebView2CookieManager*)>& fn, QString* error)
 {
   if (!m_view) {
     if (error) {
@@ -270,23 +159,30 @@ bool WebView2CookieModel::withCookieManager(const std::function<void(ICoreWebVie
   return true;
 }
 
-void WebView2CookieModel::refresh()
+void WebView2CookieSource::requestCookies(const QUrl& url)
 {
-  setLastError({});
+  const int requestId = m_nextRequestId++;
+  m_activeRequestId = requestId;
 
-  const QString uri = normalizeCookieUri(m_url);
-  if (uri.isEmpty()) {
-    setEntries({});
-    setLoading(false);
-    return;
+  // An empty uri asks the manager for every cookie in the profile.
+  QString uri;
+  if (!url.isEmpty()) {
+    uri = normalizeCookieUri(url);
+    if (uri.isEmpty()) {
+      QMetaObject::invokeMethod(
+        this,
+        [this, requestId] {
+          if (m_activeRequestId == requestId) {
+            emit cookiesLoaded({});
+          }
+        },
+        Qt::QueuedConnection);
+      return;
+    }
   }
 
   QString managerError;
-  const int requestId = m_nextRequestId++;
-  m_activeRequestId = requestId;
-  setLoading(true);
-
-  const QPointer<WebView2CookieModel> self(this);
+  const QPointer<WebView2CookieSource> self(this);
 
   const bool ok = withCookieManager(
     [self, requestId, uri](ICoreWebView2CookieManager* manager) {
@@ -299,14 +195,14 @@ void WebView2CookieModel::refresh()
         wUri.c_str(),
         Callback<ICoreWebView2GetCookiesCompletedHandler>(
           [self, requestId](HRESULT errorCode, ICoreWebView2CookieList* result) -> HRESULT {
-            QVector<Entry> entries;
+            QVector<Cookie> cookies;
             QString err;
             bool success = SUCCEEDED(errorCode);
 
             if (success && result) {
               UINT32 count = 0;
               if (SUCCEEDED(result->get_Count(&count)) && count > 0) {
-                entries.reserve(static_cast<int>(count));
+                cookies.reserve(static_cast<int>(count));
                 for (UINT32 i = 0; i < count; ++i) {
                   Microsoft::WRL::ComPtr<ICoreWebView2Cookie> cookie;
                   if (FAILED(result->GetValueAtIndex(i, &cookie)) || !cookie) {
@@ -333,7 +229,7 @@ void WebView2CookieModel::refresh()
                   BOOL isSession = FALSE;
                   cookie->get_IsSession(&isSession);
 
-                  Entry entry;
+                  Cookie entry;
                   entry.name = takeCoTaskString(name);
                   entry.domain = takeCoTaskString(domain);
                   entry.path = takeCoTaskString(path);
@@ -346,7 +242,7 @@ void WebView2CookieModel::refresh()
                     continue;
                   }
 
-                  entries.push_back(entry);
+                  cookies.push_back(entry);
                 }
               }
             } else if (!success) {
@@ -355,20 +251,14 @@ void WebView2CookieModel::refresh()
 
             QMetaObject::invokeMethod(
               self,
-              [self, requestId, success, err, entries = std::move(entries)]() mutable {
-                if (!self) {
+              [self, requestId, success, err, cookies = std::move(cookies)] {
+                if (!self || self->m_activeRequestId != requestId) {
                   return;
                 }
-                if (self->m_activeRequestId != requestId) {
-                  return;
-                }
-
-                self->setLoading(false);
                 if (success) {
-                  self->setEntries(std::move(entries));
+                  emit self->cookiesLoaded(cookies);
                 } else {
-                  self->setEntries({});
-                  self->setLastError(err);
+                  emit self->failed(err);
                 }
               },
               Qt::QueuedConnection);
@@ -381,15 +271,10 @@ void WebView2CookieModel::refresh()
         QMetaObject::invokeMethod(
           self,
           [self, requestId, err = hresultMessage(hr)] {
-            if (!self) {
+            if (!self || self->m_activeRequestId != requestId) {
               return;
             }
-            if (self->m_activeRequestId != requestId) {
-              return;
-            }
-            self->setLoading(false);
-            self->setEntries({});
-            self->setLastError(err);
+            emit self->failed(err);
           },
           Qt::QueuedConnection);
       }
@@ -397,72 +282,33 @@ void WebView2CookieModel::refresh()
     &managerError);
 
   if (!ok) {
-    setLoading(false);
-    setEntries({});
-    setLastError(managerError);
-  }
-}
-
-void WebView2CookieModel::deleteCookie(const QString& domain, const QString& name, const QString& path)
-{
-  setLastError({});
-
-  const QString trimmedName = name.trimmed();
-  const QString trimmedDomain = domain.trimmed();
-  const QString trimmedPath = path.trimmed();
-  if (trimmedName.isEmpty() || trimmedDomain.isEmpty() || trimmedPath.isEmpty()) {
-    return;
-  }
-
-  QString error;
-  HRESULT deleteResult = E_FAIL;
-  const bool ok = withCookieManager(
-    [trimmedName, trimmedDomain, trimmedPath, &deleteResult](ICoreWebView2CookieManager* manager) {
-      const std::wstring wName = toWide(trimmedName);
-      const std::wstring wDomain = toWide(trimmedDomain);
-      const std::wstring wPath = toWide(trimmedPath);
-      deleteResult = manager->DeleteCookiesWithDomainAndPath(wName.c_str(), wDomain.c_str(), wPath.c_str());
-    },
-    &error);
-
-  if (!ok) {
-    setLastError(error);
-    return;
-  }
-  if (FAILED(deleteResult)) {
-    setLastError(hresultMessage(deleteResult));
-    return;
-  }
-
-  refresh();
-}
-
-void WebView2CookieModel::deleteAt(int index)
-{
-  if (index < 0 || index >= m_entries.size()) {
-    return;
+    QMetaObject::invokeMethod(
+      this,
+      [this, requestId, managerError] {
+        if (m_activeRequestId == requestId) {
+          emit failed(managerError);
+        }
+      },
+      Qt::QueuedConnection);
   }
-
-  const Entry entry = m_entries.at(index);
-  deleteCookie(entry.domain, entry.name, entry.path);
 }
 
-void WebView2CookieModel::clearAll()
+void WebView2CookieSource::deleteCookies(const QVector<Cookie>& cookies)
 {
-  setLastError({});
-
-  if (m_entries.isEmpty()) {
+  if (cookies.isEmpty()) {
     return;
   }
 
   QString error;
+  QVector<Cookie> removed;
   HRESULT deleteResult = S_OK;
   const bool ok = withCookieManager(
-    [entries = m_entries, &deleteResult](ICoreWebView2CookieManager* manager) {
-      for (const Entry& entry : entries) {
-        const QString name = entry.name.trimmed();
-        const QString domain = entry.domain.trimmed();
-        const QString path = entry.path.trimmed();
+    [&cookies, &removed, &deleteResult](ICoreWebView2CookieManager* manager) {
+      removed.reserve(cookies.size());
+      for (const Cookie& cookie : cookies) {
+        const QString name = cookie.name.trimmed();
+        const QString domain = cookie.domain.trimmed();
+        const QString path = cookie.path.trimmed();
         if (name.isEmpty() || domain.isEmpty() || path.isEmpty()) {
           continue;
         }
@@ -470,21 +316,25 @@ void WebView2CookieModel::clearAll()
         const std::wstring wDomain = toWide(domain);
         const std::wstring wPath = toWide(path);
         const HRESULT hr = manager->DeleteCookiesWithDomainAndPath(wName.c_str(), wDomain.c_str(), wPath.c_str());
-        if (FAILED(hr) && SUCCEEDED(deleteResult)) {
-          deleteResult = hr;
+        if (FAILED(hr)) {
+          if (SUCCEEDED(deleteResult)) {
+            deleteResult = hr;
+          }
+          continue;
         }
+        removed.push_back(cookie);
       }
     },
     &error);
 
   if (!ok) {
-    setLastError(error);
+    emit failed(error);
     return;
   }
+  if (!removed.isEmpty()) {
+    emit cookiesRemoved(removed);
+  }
   if (FAILED(deleteResult)) {
-    setLastError(hresultMessage(deleteResult));
-    return;
+    emit failed(hresultMessage(deleteResult));
   }
-
-  refresh();
 }
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QPointer>
+#include <QUrl>
+#include <functional>
+
+#include "../../core/CookieSource.h"
+#include "WebView2View.h"
+
+struct ICoreWebView2CookieManager;
+
+// Reads and deletes cookies through the WebView2 profile's cookie manager.
+// WebView2 has no cookie change events, so only deletions made through this
+// source are reported as deltas; everything else shows up on the next load.
+class WebView2CookieSource final : public CookieSource
+{
+  Q_OBJECT
+
+  Q_PROPERTY(WebView2View* view READ view WRITE setView NOTIFY viewChanged)
+
+public:
+  explicit WebView2CookieSource(QObject* parent = nullptr);
+
+  WebView2View* view() const;
+  void setView(WebView2View* view);
+
+  void requestCookies(const QUrl& url) override;
+  void deleteCookies(const QVector<Cookie>& cookies) override;
+
+signals:
+  void viewChanged();
+
+private:
+  bool withCookieManager(const std::function<void(ICoreWebView2CookieManager*)>& fn, QString* error);
+  static QString normalizeCookieUri(const QUrl& url);
+
+  QPointer<WebView2View> m_view;
+  int m_activeRequestId = 0;
+  int m_nextRequestId = 1;
+};
@@ -3,6 +3,7 @@
 #include <Windows.h>
 
 #include "core/AppPaths.h"
+#include "core/ContentBlocker.h"
 #include "core/SitePermissionsStore.h"
 
 #if defined(__has_attribute)
@@ -11,15 +12,19 @@
 #include <WebView2EnvironmentOptions.h>
 
 #include <QByteArray>
+#include <QCoreApplication>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMetaObject>
 #include <QPointer>
 #include <QQuickWindow>
 #include <QSaveFile>
+#include <QSet>
+#include <QTimer>
 #include <QUrl>
 #include <QtGlobal>
 
@@ -79,6 +84,36 @@ double msToUnixSeconds(qint64 ms)
   return static_cast<double>(ms) / 1000.0;
 }
 
+ContentFilterEngine::ResourceType resourceTypeForContext(COREWEBVIEW2_WEB_RESOURCE_CONTEXT context)
+{
+  using Type = ContentFilterEngine::ResourceType;
+  switch (context) {
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT:
+      return Type::Subdocument;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_STYLESHEET:
+      return Type::Stylesheet;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_IMAGE:
+      return Type::Image;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_MEDIA:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_TEXT_TRACK:
+      return Type::Media;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FONT:
+      return Type::Font;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_SCRIPT:
+      return Type::Script;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_XML_HTTP_REQUEST:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_FETCH:
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_EVENT_SOURCE:
+      return Type::XmlHttpRequest;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_WEBSOCKET:
+      return Type::WebSocket;
+    case COREWEBVIEW2_WEB_RESOURCE_CONTEXT_PING:
+      return Type::Ping;
+    default:
+      return Type::Other;
+  }
+}
+
 struct SharedWebView2EnvironmentState
 {
   Microsoft::WRL::ComPtr<ICoreWebView2Environment> environment;
@@ -99,6 +134,23 @@ QString webView2UserDataDir()
   return QDir(xbrowser::appDataRoot()).filePath("webview2");
 }
 
+// A page moving between windows, kept alive off-screen until the view in the
+// target window adopts it.
+struct ParkedWebView
+{
+  Microsoft::WRL::ComPtr<ICoreWebView2Controller> controller;
+  QStringList installedScripts;
+  bool contentFilterRegistered = false;
+};
+
+constexpr int kParkedWebViewTimeoutMs = 10000;
+
+QHash<int, ParkedWebView>& parkedWebViews()
+{
+  static QHash<int, ParkedWebView> parked;
+  return parked;
+}
+
 constexpr const char* kUserCssBootstrapScript = R"JS(
 (() => {
   if (window.__xbrowserModsInstalled) return;
@@ -108,15 +160,42 @@ constexpr const char* kUserCssBootstrapScript = R"JS(
   function ensureStyle() {
     let el = document.getElementById(styleId);
     if (el) return el;
-    el = document.createElement("style");
+    el = document.createElement("div");
     el.id = styleId;
+    el.hidden = true;
     (document.head || document.documentElement).appendChild(el);
     return el;
   }
 
-  const styleEl = ensureStyle();
-  function apply(css) {
-    styleEl.textContent = css || "";
+  const sheets = new Map();
+  function styleFor(id) {
+    let el = sheets.get(id);
+    if (el) return el;
+    el = document.createElement("style");
+    el.dataset.xbrowserMod = id;
+    ensureStyle().appendChild(el);
+    sheets.set(id, el);
+    return el;
+  }
+
+  function apply(data) {
+    const remove = Array.isArray(data.remove) ? data.remove : [];
+    for (const id of remove) {
+      const el = sheets.get(id);
+      if (el) el.remove();
+      sheets.delete(id);
+    }
+    const upsert = data.upsert || {};
+    for (const id of Object.keys(upsert)) {
+      styleFor(id).textContent = String(upsert[id] || "");
+    }
+    if (Array.isArray(data.order)) {
+      const root = ensureStyle();
+      for (const id of data.order) {
+        const el = sheets.get(id);
+        if (el) root.appendChild(el);
+      }
+    }
   }
 
   try {
@@ -125,9 +204,9 @@ constexpr const char* kUserCssBootstrapScript = R"JS(
       wv.addEventListener("message", (ev) => {
         const data = ev && ev.data;
         if (!data || data.type !== "xbrowser-mods-css") return;
-        apply(String(data.css || ""));
+        apply(data);
       });
-      wv.postMessage({ type: "xbrowser-mods-ready" });
+      wv.postMessage({ type: "xbrowser-mods-ready", url: String(location.href) });
     }
   } catch (_) {}
 })();
@@ -282,6 +361,7 @@ WebView2View::WebView2View(QQuickItem* parent)
   connect(this, &QQuickItem::widthChanged, this, &WebView2View::updateBounds);
   connect(this, &QQuickItem::heightChanged, this, &WebView2View::updateBounds);
   connect(this, &QQuickItem::visibleChanged, this, &WebView2View::updateVisibility);
+  connect(&ContentBlocker::instance(), &ContentBlocker::rulesReloaded, this, &WebView2View::updateContentFilterRegistration);
 }
 
 WebView2View::~WebView2View()
@@ -296,51 +376,8 @@ WebView2View::~WebView2View()
   }
   m_pendingPermissions.clear();
 
-  if (m_webView) {
-    m_webView->remove_DocumentTitleChanged(m_titleChangedToken);
-    m_webView->remove_SourceChanged(m_sourceChangedToken);
-    m_webView->remove_ContainsFullScreenElementChanged(m_containsFullScreenElementChangedToken);
-    m_webView->remove_NavigationStarting(m_navigationStartingToken);
-    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
-    m_webView->remove_HistoryChanged(m_historyChangedToken);
-    m_webView->remove_WebMessageReceived(m_webMessageReceivedToken);
-
-    Microsoft::WRL::ComPtr<ICoreWebView2_11> webView11;
-    if (SUCCEEDED(m_webView.As(&webView11)) && webView11) {
-      webView11->remove_ContextMenuRequested(m_contextMenuRequestedToken);
-    }
-
-    Microsoft::WRL::ComPtr<ICoreWebView2_4> webView4;
-    if (SUCCEEDED(m_webView.As(&webView4)) && webView4) {
-      webView4->remove_DownloadStarting(m_downloadStartingToken);
-    }
-
-    Microsoft::WRL::ComPtr<ICoreWebView2_3> webView3;
-    if (SUCCEEDED(m_webView.As(&webView3)) && webView3) {
-      webView3->remove_PermissionRequested(m_permissionRequestedToken);
-    }
-
-    Microsoft::WRL::ComPtr<ICoreWebView2_15> webView15;
-    if (SUCCEEDED(m_webView.As(&webView15)) && webView15) {
-      webView15->remove_FaviconChanged(m_faviconChangedToken);
-    }
-
-    Microsoft::WRL::ComPtr<ICoreWebView2_8> webView8;
-    if (SUCCEEDED(m_webView.As(&webView8)) && webView8) {
-      webView8->remove_IsDocumentPlayingAudioChanged(m_audioChangedToken);
-      webView8->remove_IsMutedChanged(m_mutedChangedToken);
-    }
-
-    for (auto& sub : m_downloadSubscriptions) {
-      if (sub.operation) {
-        sub.operation->remove_StateChanged(sub.stateChangedToken);
-        sub.operation->remove_BytesReceivedChanged(sub.bytesReceivedChangedToken);
-      }
-    }
-  }
+  detachEventHandlers();
   if (m_controller) {
-    m_controller->remove_GotFocus(m_gotFocusToken);
-    m_controller->remove_ZoomFactorChanged(m_zoomFactorChangedToken);
     m_controller->Close();
   }
 }
@@ -410,6 +447,34 @@ qreal WebView2View::zoomFactor() const
   return m_zoomFactor;
 }
 
+int WebView2View::handoffToken() const
+{
+  return m_handoffToken;
+}
+
+void WebView2View::setHandoffToken(int token)
+{
+  if (m_handoffToken == token) {
+    return;
+  }
+  m_handoffToken = token;
+  emit handoffTokenChanged();
+}
+
+bool WebView2View::interceptDownloads() const
+{
+  return m_interceptDownloads;
+}
+
+void WebView2View::setInterceptDownloads(bool intercept)
+{
+  if (m_interceptDownloads == intercept) {
+    return;
+  }
+  m_interceptDownloads = intercept;
+  emit interceptDownloadsChanged();
+}
+
 Microsoft::WRL::ComPtr<ICoreWebView2> WebView2View::coreWebView() const
 {
   return m_webView;
@@ -821,6 +886,48 @@ void WebView2View::retryInitialize()
   tryInitialize();
 }
 
+bool WebView2View::parkForHandoff(int token)
+{
+  if (token <= 0 || !m_controller || !m_webView) {
+    return false;
+  }
+
+  detachEventHandlers();
+  m_controller->put_IsVisible(FALSE);
+  // Off the source window, which may be closed before the target adopts it.
+  m_controller->put_ParentWindow(HWND_MESSAGE);
+
+  ParkedWebView parked;
+  parked.controller = m_controller;
+  parked.installedScripts = m_installedScripts;
+  parked.contentFilterRegistered = m_contentFilterRegistered;
+  parkedWebViews().insert(token, parked);
+
+  m_controller.Reset();
+  m_webView.Reset();
+  m_installedScripts.clear();
+  m_contentFilterRegistered = false;
+  m_initialized = false;
+  emit initializedChanged();
+
+  // Nothing claims the page if the target window never shows up.
+  QTimer::singleShot(kParkedWebViewTimeoutMs, QCoreApplication::instance(), [token] {
+    const ParkedWebView abandoned = parkedWebViews().take(token);
+    if (abandoned.controller) {
+      abandoned.controller->Close();
+    }
+  });
+  return true;
+}
+
+void WebView2View::componentComplete()
+{
+  QQuickItem::componentComplete();
+  // Deferred so initial properties and Component.onCompleted (which queues
+  // the first navigate) are in place before a handed-off page is adopted.
+  QMetaObject::invokeMethod(this, &WebView2View::tryInitialize, Qt::QueuedConnection);
+}
+
 void WebView2View::addScriptOnDocumentCreated(const QString& script)
 {
   const QString trimmed = script.trimmed();
@@ -832,6 +939,10 @@ void WebView2View::addScriptOnDocumentCreated(const QString& script)
     m_pendingScripts.push_back(trimmed);
     return;
   }
+  if (m_installedScripts.contains(trimmed)) {
+    return;
+  }
+  m_installedScripts.push_back(trimmed);
 
   m_webView->AddScriptToExecuteOnDocumentCreated(
     toWide(trimmed).c_str(),
@@ -866,6 +977,40 @@ void WebView2View::executeScript(const QString& script)
       .Get());
 }
 
+// Reads the rendered text of the current document for the history text
+// index. innerText skips scripts, styles and hidden nodes, so no HTML
+// parsing is needed on our side.
+void WebView2View::capturePageText(int maxChars)
+{
+  if (!m_webView || maxChars <= 0) {
+    return;
+  }
+
+  const QString script = QStringLiteral(R"JS((() => {
+  const body = document.body;
+  return { url: location.href, title: document.title, text: body ? body.innerText.slice(0, %1) : '' };
+})();)JS")
+                           .arg(maxChars);
+
+  const QPointer<WebView2View> self(this);
+  m_webView->ExecuteScript(toWide(script).c_str(),
+                           Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
+                             [self](HRESULT errorCode, LPCWSTR resultObjectAsJson) -> HRESULT {
+                               if (!self || FAILED(errorCode) || !resultObjectAsJson) {
+                                 return S_OK;
+                               }
+                               const QJsonObject result =
+                                 QJsonDocument::fromJson(QString::fromWCharArray(resultObjectAsJson).toUtf8()).object();
+                               const QUrl url(result.value(QStringLiteral("url")).toString());
+                               if (url.isValid()) {
+                                 emit self->pageTextCaptured(url, result.value(QStringLiteral("title")).toString(),
+                                                             result.value(QStringLiteral("text")).toString());
+                               }
+                               return S_OK;
+                             })
+                             .Get());
+}
+
 void WebView2View::postWebMessageAsJson(const QString& json)
 {
   const QString trimmed = json.trimmed();
@@ -880,13 +1025,40 @@ void WebView2View::postWebMessageAsJson(const QString& json)
 }
 
 void WebView2View::setUserCss(const QString& css)
+{
+  QVariantList sheets;
+  if (!css.isEmpty()) {
+    QVariantMap sheet;
+    sheet.insert(QStringLiteral("id"), QStringLiteral("user"));
+    sheet.insert(QStringLiteral("hash"), QString::number(qHash(css), 16));
+    sheet.insert(QStringLiteral("css"), css);
+    sheets.push_back(sheet);
+  }
+  setUserCssSheets(sheets);
+}
+
+void WebView2View::setUserCssSheets(const QVariantList& sheets)
 {
   ensureUserCssBootstrapScript();
-  if (m_userCss == css) {
-    return;
+
+  QVector<UserCssSheet> next;
+  next.reserve(sheets.size());
+  for (const QVariant& v : sheets) {
+    const QVariantMap map = v.toMap();
+    UserCssSheet sheet;
+    sheet.id = map.value(QStringLiteral("id")).toString();
+    if (sheet.id.isEmpty()) {
+      continue;
+    }
+    sheet.css = map.value(QStringLiteral("css")).toString();
+    sheet.hash = map.value(QStringLiteral("hash")).toString();
+    if (sheet.hash.isEmpty()) {
+      sheet.hash = QString::number(qHash(sheet.css), 16);
+    }
+    next.push_back(sheet);
   }
 
-  m_userCss = css;
+  m_userCssSheets = std::move(next);
   postUserCssMessage();
 }
 
@@ -939,7 +1111,7 @@ void WebView2View::tryInitialize()
   if (m_initializing || m_initialized) {
     return;
   }
-  if (!window()) {
+  if (!window() || !isComponentComplete()) {
     return;
   }
 
@@ -1058,6 +1230,20 @@ void WebView2View::startControllerCreation(ICoreWebView2Environment* env)
   const HWND parentHwnd = reinterpret_cast<HWND>(window()->winId());
   m_environment = env;
 
+  if (m_handoffToken > 0) {
+    const ParkedWebView parked = parkedWebViews().take(m_handoffToken);
+    if (parked.controller && SUCCEEDED(parked.controller->put_ParentWindow(parentHwnd))) {
+      m_initializing = false;
+      m_installedScripts = parked.installedScripts;
+      m_contentFilterRegistered = parked.contentFilterRegistered;
+      attachController(parked.controller.Get(), true);
+      return;
+    }
+    if (parked.controller) {
+      parked.controller->Close();
+    }
+  }
+
   env->CreateCoreWebView2Controller(
     parentHwnd,
     Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
@@ -1069,423 +1255,515 @@ void WebView2View::startControllerCreation(ICoreWebView2Environment* env)
           return S_OK;
         }
 
-        m_controller = controller;
-        m_controller->get_CoreWebView2(&m_webView);
-        if (!m_webView) {
-          setInitError(E_FAIL, QStringLiteral("Failed to obtain WebView2 instance."));
+        attachController(controller, false);
+        return S_OK;
+      })
+      .Get());
+}
+
+void WebView2View::attachController(ICoreWebView2Controller* controller, bool adopted)
+{
+  m_controller = controller;
+  m_controller->get_CoreWebView2(&m_webView);
+  if (!m_webView) {
+    setInitError(E_FAIL, QStringLiteral("Failed to obtain WebView2 instance."));
+    return;
+  }
+
+  setInitError(S_OK, {});
+
+  const qreal requestedZoomFactor = clampZoomFactor(m_zoomFactor);
+
+  double initialZoom = 1.0;
+  if (SUCCEEDED(m_controller->get_ZoomFactor(&initialZoom))) {
+    setZoomFactorValue(clampZoomFactor(static_cast<qreal>(initialZoom)));
+  }
+
+  m_controller->add_ZoomFactorChanged(
+    Callback<ICoreWebView2ZoomFactorChangedEventHandler>(
+      [this](ICoreWebView2Controller* sender, IUnknown*) -> HRESULT {
+        if (!sender) {
           return S_OK;
         }
 
-        setInitError(S_OK, {});
+        double zoom = 1.0;
+        if (FAILED(sender->get_ZoomFactor(&zoom))) {
+          return S_OK;
+        }
 
-        const qreal requestedZoomFactor = clampZoomFactor(m_zoomFactor);
+        const qreal next = clampZoomFactor(static_cast<qreal>(zoom));
+        QMetaObject::invokeMethod(
+          this,
+          [this, next] {
+            setZoomFactorValue(next);
+          },
+          Qt::QueuedConnection);
+        return S_OK;
+      })
+      .Get(),
+    &m_zoomFactorChangedToken);
 
-        double initialZoom = 1.0;
-        if (SUCCEEDED(m_controller->get_ZoomFactor(&initialZoom))) {
-          setZoomFactorValue(clampZoomFactor(static_cast<qreal>(initialZoom)));
+  const HRESULT zoomHr = m_controller->put_ZoomFactor(static_cast<double>(requestedZoomFactor));
+  if (SUCCEEDED(zoomHr)) {
+    setZoomFactorValue(requestedZoomFactor);
+  }
+
+  m_controller->add_GotFocus(
+    Callback<ICoreWebView2FocusChangedEventHandler>(
+      [this](ICoreWebView2Controller*, IUnknown*) -> HRESULT {
+        emit focusReceived();
+        return S_OK;
+      })
+      .Get(),
+    &m_gotFocusToken);
+
+  m_webView->add_DocumentTitleChanged(
+    Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
+      [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
+        LPWSTR title = nullptr;
+        if (sender && SUCCEEDED(sender->get_DocumentTitle(&title)) && title) {
+          setTitle(QString::fromWCharArray(title));
+          CoTaskMemFree(title);
+        }
+        return S_OK;
+      })
+      .Get(),
+    &m_titleChangedToken);
+
+  m_webView->add_SourceChanged(
+    Callback<ICoreWebView2SourceChangedEventHandler>(
+      [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs*) -> HRESULT {
+        LPWSTR uri = nullptr;
+        if (sender && SUCCEEDED(sender->get_Source(&uri)) && uri) {
+          setCurrentUrl(QUrl(QString::fromWCharArray(uri)));
+          CoTaskMemFree(uri);
+        }
+        return S_OK;
+      })
+      .Get(),
+    &m_sourceChangedToken);
+
+  BOOL containsFullScreen = FALSE;
+  if (SUCCEEDED(m_webView->get_ContainsFullScreenElement(&containsFullScreen))) {
+    setContainsFullScreenElementValue(containsFullScreen == TRUE);
+  }
+
+  m_webView->add_ContainsFullScreenElementChanged(
+    Callback<ICoreWebView2ContainsFullScreenElementChangedEventHandler>(
+      [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
+        BOOL contains = FALSE;
+        if (sender && SUCCEEDED(sender->get_ContainsFullScreenElement(&contains))) {
+          const bool next = (contains == TRUE);
+          QMetaObject::invokeMethod(
+            this,
+            [this, next] {
+              setContainsFullScreenElementValue(next);
+            },
+            Qt::QueuedConnection);
+        }
+        return S_OK;
+      })
+      .Get(),
+    &m_containsFullScreenElementChangedToken);
+
+  m_webView->add_NavigationStarting(
+    Callback<ICoreWebView2NavigationStartingEventHandler>(
+      [this](ICoreWebView2*, ICoreWebView2NavigationStartingEventArgs* args) -> HRESULT {
+        LPWSTR uri = nullptr;
+        if (args && SUCCEEDED(args->get_Uri(&uri)) && uri) {
+          m_mainFrameNavigationUri = QString::fromWCharArray(uri);
+          CoTaskMemFree(uri);
+        }
+        setIsLoading(true);
+        return S_OK;
+      })
+      .Get(),
+    &m_navigationStartingToken);
+
+  m_webView->add_NavigationCompleted(
+    Callback<ICoreWebView2NavigationCompletedEventHandler>(
+      [this](ICoreWebView2*, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
+        bool success = true;
+        if (args) {
+          BOOL isSuccess = TRUE;
+          if (SUCCEEDED(args->get_IsSuccess(&isSuccess))) {
+            success = (isSuccess == TRUE);
+          }
         }
 
-        m_controller->add_ZoomFactorChanged(
-          Callback<ICoreWebView2ZoomFactorChangedEventHandler>(
-            [this](ICoreWebView2Controller* sender, IUnknown*) -> HRESULT {
-              if (!sender) {
-                return S_OK;
-              }
+        setIsLoading(false);
+        updateNavigationState();
+        emit navigationCommitted(success);
+        return S_OK;
+      })
+      .Get(),
+    &m_navigationCompletedToken);
 
-              double zoom = 1.0;
-              if (FAILED(sender->get_ZoomFactor(&zoom))) {
-                return S_OK;
-              }
-
-              const qreal next = clampZoomFactor(static_cast<qreal>(zoom));
-              QMetaObject::invokeMethod(
-                this,
-                [this, next] {
-                  setZoomFactorValue(next);
-                },
-                Qt::QueuedConnection);
-              return S_OK;
-            })
-            .Get(),
-          &m_zoomFactorChangedToken);
-
-        const HRESULT zoomHr = m_controller->put_ZoomFactor(static_cast<double>(requestedZoomFactor));
-        if (SUCCEEDED(zoomHr)) {
-          setZoomFactorValue(requestedZoomFactor);
-        }
+  m_webView->add_HistoryChanged(
+    Callback<ICoreWebView2HistoryChangedEventHandler>(
+      [this](ICoreWebView2*, IUnknown*) -> HRESULT {
+        updateNavigationState();
+        return S_OK;
+      })
+      .Get(),
+    &m_historyChangedToken);
 
-        m_controller->add_GotFocus(
-          Callback<ICoreWebView2FocusChangedEventHandler>(
-            [this](ICoreWebView2Controller*, IUnknown*) -> HRESULT {
-              emit focusReceived();
-              return S_OK;
-            })
-            .Get(),
-          &m_gotFocusToken);
-
-        m_webView->add_DocumentTitleChanged(
-          Callback<ICoreWebView2DocumentTitleChangedEventHandler>(
-            [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
-              LPWSTR title = nullptr;
-              if (sender && SUCCEEDED(sender->get_DocumentTitle(&title)) && title) {
-                setTitle(QString::fromWCharArray(title));
-                CoTaskMemFree(title);
-              }
-              return S_OK;
-            })
-            .Get(),
-          &m_titleChangedToken);
-
-        m_webView->add_SourceChanged(
-          Callback<ICoreWebView2SourceChangedEventHandler>(
-            [this](ICoreWebView2* sender, ICoreWebView2SourceChangedEventArgs*) -> HRESULT {
-              LPWSTR uri = nullptr;
-              if (sender && SUCCEEDED(sender->get_Source(&uri)) && uri) {
-                setCurrentUrl(QUrl(QString::fromWCharArray(uri)));
-                CoTaskMemFree(uri);
-              }
-              return S_OK;
-            })
-            .Get(),
-          &m_sourceChangedToken);
-
-        BOOL containsFullScreen = FALSE;
-        if (SUCCEEDED(m_webView->get_ContainsFullScreenElement(&containsFullScreen))) {
-          setContainsFullScreenElementValue(containsFullScreen == TRUE);
-        }
+  m_webView->add_WebResourceRequested(
+    Callback<ICoreWebView2WebResourceRequestedEventHandler>(
+      [this](ICoreWebView2*, ICoreWebView2WebResourceRequestedEventArgs* args) -> HRESULT {
+        handleWebResourceRequested(args);
+        return S_OK;
+      })
+      .Get(),
+    &m_webResourceRequestedToken);
+  updateContentFilterRegistration();
+
+  Microsoft::WRL::ComPtr<ICoreWebView2_15> webView15;
+  if (SUCCEEDED(m_webView.As(&webView15)) && webView15) {
+    webView15->add_FaviconChanged(
+      Callback<ICoreWebView2FaviconChangedEventHandler>(
+        [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
+          if (!sender) {
+            return S_OK;
+          }
 
-        m_webView->add_ContainsFullScreenElementChanged(
-          Callback<ICoreWebView2ContainsFullScreenElementChangedEventHandler>(
-            [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
-              BOOL contains = FALSE;
-              if (sender && SUCCEEDED(sender->get_ContainsFullScreenElement(&contains))) {
-                const bool next = (contains == TRUE);
-                QMetaObject::invokeMethod(
-                  this,
-                  [this, next] {
-                    setContainsFullScreenElementValue(next);
-                  },
-                  Qt::QueuedConnection);
-              }
-              return S_OK;
-            })
-            .Get(),
-          &m_containsFullScreenElementChangedToken);
-
-        m_webView->add_NavigationStarting(
-          Callback<ICoreWebView2NavigationStartingEventHandler>(
-            [this](ICoreWebView2*, ICoreWebView2NavigationStartingEventArgs*) -> HRESULT {
-              setIsLoading(true);
-              return S_OK;
-            })
-            .Get(),
-          &m_navigationStartingToken);
-
-        m_webView->add_NavigationCompleted(
-          Callback<ICoreWebView2NavigationCompletedEventHandler>(
-            [this](ICoreWebView2*, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
-              bool success = true;
-              if (args) {
-                BOOL isSuccess = TRUE;
-                if (SUCCEEDED(args->get_IsSuccess(&isSuccess))) {
-                  success = (isSuccess == TRUE);
-                }
-              }
-
-              setIsLoading(false);
-              updateNavigationState();
-              emit navigationCommitted(success);
-              return S_OK;
-            })
-            .Get(),
-          &m_navigationCompletedToken);
-
-        m_webView->add_HistoryChanged(
-          Callback<ICoreWebView2HistoryChangedEventHandler>(
-            [this](ICoreWebView2*, IUnknown*) -> HRESULT {
-              updateNavigationState();
-              return S_OK;
-            })
-            .Get(),
-          &m_historyChangedToken);
-
-        Microsoft::WRL::ComPtr<ICoreWebView2_15> webView15;
-        if (SUCCEEDED(m_webView.As(&webView15)) && webView15) {
-          webView15->add_FaviconChanged(
-            Callback<ICoreWebView2FaviconChangedEventHandler>(
-              [this](ICoreWebView2* sender, IUnknown*) -> HRESULT {
-                if (!sender) {
+          Microsoft::WRL::ComPtr<ICoreWebView2_15> sender15;
+          if (FAILED(sender->QueryInterface(IID_PPV_ARGS(&sender15))) || !sender15) {
+            return S_OK;
+          }
+
+          sender15->GetFavicon(
+            COREWEBVIEW2_FAVICON_IMAGE_FORMAT_PNG,
+            Callback<ICoreWebView2GetFaviconCompletedHandler>(
+              [this, sender15](HRESULT error, IStream* result) -> HRESULT {
+                if (FAILED(error) || !result) {
+                  LPWSTR uri = nullptr;
+                  if (SUCCEEDED(sender15->get_FaviconUri(&uri)) && uri) {
+                    setFaviconUrl(QUrl(QString::fromWCharArray(uri)));
+                    CoTaskMemFree(uri);
+                  }
                   return S_OK;
                 }
 
-                Microsoft::WRL::ComPtr<ICoreWebView2_15> sender15;
-                if (FAILED(sender->QueryInterface(IID_PPV_ARGS(&sender15))) || !sender15) {
+                const QByteArray bytes = readStream(result);
+                if (bytes.isEmpty()) {
                   return S_OK;
                 }
 
-                sender15->GetFavicon(
-                  COREWEBVIEW2_FAVICON_IMAGE_FORMAT_PNG,
-                  Callback<ICoreWebView2GetFaviconCompletedHandler>(
-                    [this, sender15](HRESULT error, IStream* result) -> HRESULT {
-                      if (FAILED(error) || !result) {
-                        LPWSTR uri = nullptr;
-                        if (SUCCEEDED(sender15->get_FaviconUri(&uri)) && uri) {
-                          setFaviconUrl(QUrl(QString::fromWCharArray(uri)));
-                          CoTaskMemFree(uri);
-                        }
-                        return S_OK;
-                      }
-
-                      const QByteArray bytes = readStream(result);
-                      if (bytes.isEmpty()) {
-                        return S_OK;
-                      }
-
-                      const QString dataUrl = QStringLiteral("data:image/png;base64,%1")
-                                                .arg(QString::fromLatin1(bytes.toBase64()));
-                      setFaviconUrl(QUrl(dataUrl));
-                      return S_OK;
-                    })
-                    .Get());
-
+                const QString dataUrl = QStringLiteral("data:image/png;base64,%1")
+                                          .arg(QString::fromLatin1(bytes.toBase64()));
+                setFaviconUrl(QUrl(dataUrl));
                 return S_OK;
               })
-              .Get(),
-            &m_faviconChangedToken);
+              .Get());
 
-          LPWSTR uri = nullptr;
-          if (SUCCEEDED(webView15->get_FaviconUri(&uri)) && uri) {
-            setFaviconUrl(QUrl(QString::fromWCharArray(uri)));
-            CoTaskMemFree(uri);
-          }
-        }
+          return S_OK;
+        })
+        .Get(),
+      &m_faviconChangedToken);
+
+    LPWSTR uri = nullptr;
+    if (SUCCEEDED(webView15->get_FaviconUri(&uri)) && uri) {
+      setFaviconUrl(QUrl(QString::fromWCharArray(uri)));
+      CoTaskMemFree(uri);
+    }
+  }
 
-        Microsoft::WRL::ComPtr<ICoreWebView2_8> webView8;
-        if (SUCCEEDED(m_webView.As(&webView8)) && webView8) {
-          webView8->add_IsDocumentPlayingAudioChanged(
-            Callback<ICoreWebView2IsDocumentPlayingAudioChangedEventHandler>(
-              [this](ICoreWebView2*, IUnknown*) -> HRESULT {
-                updateAudioState();
-                return S_OK;
-              })
-              .Get(),
-            &m_audioChangedToken);
+  Microsoft::WRL::ComPtr<ICoreWebView2_8> webView8;
+  if (SUCCEEDED(m_webView.As(&webView8)) && webView8) {
+    webView8->add_IsDocumentPlayingAudioChanged(
+      Callback<ICoreWebView2IsDocumentPlayingAudioChangedEventHandler>(
+        [this](ICoreWebView2*, IUnknown*) -> HRESULT {
+          updateAudioState();
+          return S_OK;
+        })
+        .Get(),
+      &m_audioChangedToken);
+
+    webView8->add_IsMutedChanged(
+      Callback<ICoreWebView2IsMutedChangedEventHandler>(
+        [this](ICoreWebView2*, IUnknown*) -> HRESULT {
+          updateAudioState();
+          return S_OK;
+        })
+        .Get(),
+      &m_mutedChangedToken);
+  }
 
-          webView8->add_IsMutedChanged(
-            Callback<ICoreWebView2IsMutedChangedEventHandler>(
-              [this](ICoreWebView2*, IUnknown*) -> HRESULT {
-                updateAudioState();
-                return S_OK;
-              })
-              .Get(),
-            &m_mutedChangedToken);
+  m_webView->add_WebMessageReceived(
+    Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+      [this](ICoreWebView2*, ICoreWebView2WebMessageReceivedEventArgs* args) -> HRESULT {
+        if (!args) {
+          return S_OK;
         }
 
-        m_webView->add_WebMessageReceived(
-          Callback<ICoreWebView2WebMessageReceivedEventHandler>(
-            [this](ICoreWebView2*, ICoreWebView2WebMessageReceivedEventArgs* args) -> HRESULT {
-              if (!args) {
-                return S_OK;
-              }
+        LPWSTR json = nullptr;
+        if (SUCCEEDED(args->get_WebMessageAsJson(&json)) && json) {
+          const QString message = QString::fromWCharArray(json);
+          if (!handleInternalWebMessage(message)) {
+            emit webMessageReceived(message);
+          }
+          CoTaskMemFree(json);
+        }
 
-              LPWSTR json = nullptr;
-              if (SUCCEEDED(args->get_WebMessageAsJson(&json)) && json) {
-                const QString message = QString::fromWCharArray(json);
-                if (!handleInternalWebMessage(message)) {
-                  emit webMessageReceived(message);
-                }
-                CoTaskMemFree(json);
-              }
-
-              return S_OK;
-            })
-            .Get(),
-          &m_webMessageReceivedToken);
-
-        Microsoft::WRL::ComPtr<ICoreWebView2_11> webView11;
-        if (SUCCEEDED(m_webView.As(&webView11)) && webView11) {
-          webView11->add_ContextMenuRequested(
-            Callback<ICoreWebView2ContextMenuRequestedEventHandler>(
-              [this](ICoreWebView2*, ICoreWebView2ContextMenuRequestedEventArgs* args) -> HRESULT {
-                if (!args || !window()) {
-                  return S_OK;
-                }
+        return S_OK;
+      })
+      .Get(),
+    &m_webMessageReceivedToken);
+
+  Microsoft::WRL::ComPtr<ICoreWebView2_11> webView11;
+  if (SUCCEEDED(m_webView.As(&webView11)) && webView11) {
+    webView11->add_ContextMenuRequested(
+      Callback<ICoreWebView2ContextMenuRequestedEventHandler>(
+        [this](ICoreWebView2*, ICoreWebView2ContextMenuRequestedEventArgs* args) -> HRESULT {
+          if (!args || !window()) {
+            return S_OK;
+          }
 
-                POINT point{};
-                if (FAILED(args->get_Location(&point))) {
-                  return S_OK;
-                }
+          POINT point{};
+          if (FAILED(args->get_Location(&point))) {
+            return S_OK;
+          }
 
-                const qreal dpr = window()->devicePixelRatio();
-                const QPointF scenePos = mapToScene(QPointF(point.x / dpr, point.y / dpr));
+          const qreal dpr = window()->devicePixelRatio();
+          const QPointF scenePos = mapToScene(QPointF(point.x / dpr, point.y / dpr));
 
-                QVariantMap info;
-                info.insert("x", scenePos.x());
-                info.insert("y", scenePos.y());
+          QVariantMap info;
+          info.insert("x", scenePos.x());
+          info.insert("y", scenePos.y());
 
-                Microsoft::WRL::ComPtr<ICoreWebView2ContextMenuTarget> target;
-                if (SUCCEEDED(args->get_ContextMenuTarget(&target)) && target) {
-                  COREWEBVIEW2_CONTEXT_MENU_TARGET_KIND kind{};
-                  if (SUCCEEDED(target->get_Kind(&kind))) {
-                    info.insert("targetKind", static_cast<int>(kind));
-                  }
+          Microsoft::WRL::ComPtr<ICoreWebView2ContextMenuTarget> target;
+          if (SUCCEEDED(args->get_ContextMenuTarget(&target)) && target) {
+            COREWEBVIEW2_CONTEXT_MENU_TARGET_KIND kind{};
+            if (SUCCEEDED(target->get_Kind(&kind))) {
+              info.insert("targetKind", static_cast<int>(kind));
+            }
 
-                  LPWSTR linkUri = nullptr;
-                  if (SUCCEEDED(target->get_LinkUri(&linkUri)) && linkUri) {
-                    info.insert("linkUri", QString::fromWCharArray(linkUri));
-                    CoTaskMemFree(linkUri);
-                  }
+            LPWSTR linkUri = nullptr;
+            if (SUCCEEDED(target->get_LinkUri(&linkUri)) && linkUri) {
+              info.insert("linkUri", QString::fromWCharArray(linkUri));
+              CoTaskMemFree(linkUri);
+            }
 
-                  LPWSTR srcUri = nullptr;
-                  if (SUCCEEDED(target->get_SourceUri(&srcUri)) && srcUri) {
-                    info.insert("sourceUri", QString::fromWCharArray(srcUri));
-                    CoTaskMemFree(srcUri);
-                  }
-                }
+            LPWSTR srcUri = nullptr;
+            if (SUCCEEDED(target->get_SourceUri(&srcUri)) && srcUri) {
+              info.insert("sourceUri", QString::fromWCharArray(srcUri));
+              CoTaskMemFree(srcUri);
+            }
+          }
 
-                args->put_Handled(TRUE);
-                emit contextMenuRequested(info);
-                return S_OK;
-              })
-              .Get(),
-            &m_contextMenuRequestedToken);
-        }
+          args->put_Handled(TRUE);
+          emit contextMenuRequested(info);
+          return S_OK;
+        })
+        .Get(),
+      &m_contextMenuRequestedToken);
+  }
+
+  Microsoft::WRL::ComPtr<ICoreWebView2_3> webView3;
+  if (SUCCEEDED(m_webView.As(&webView3)) && webView3) {
+    webView3->add_PermissionRequested(
+      Callback<ICoreWebView2PermissionRequestedEventHandler>(
+        [this](ICoreWebView2*, ICoreWebView2PermissionRequestedEventArgs* args) -> HRESULT {
+          if (!args) {
+            return S_OK;
+          }
 
-        Microsoft::WRL::ComPtr<ICoreWebView2_3> webView3;
-        if (SUCCEEDED(m_webView.As(&webView3)) && webView3) {
-          webView3->add_PermissionRequested(
-            Callback<ICoreWebView2PermissionRequestedEventHandler>(
-              [this](ICoreWebView2*, ICoreWebView2PermissionRequestedEventArgs* args) -> HRESULT {
-                if (!args) {
-                  return S_OK;
-                }
+          COREWEBVIEW2_PERMISSION_KIND kind{};
+          args->get_PermissionKind(&kind);
 
-                COREWEBVIEW2_PERMISSION_KIND kind{};
-                args->get_PermissionKind(&kind);
+          BOOL userInitiated = FALSE;
+          args->get_IsUserInitiated(&userInitiated);
 
-                BOOL userInitiated = FALSE;
-                args->get_IsUserInitiated(&userInitiated);
+          QString uriStr;
+          LPWSTR uri = nullptr;
+          if (SUCCEEDED(args->get_Uri(&uri)) && uri) {
+            uriStr = QString::fromWCharArray(uri);
+            CoTaskMemFree(uri);
+          }
+          const QString origin = SitePermissionsStore::normalizeOrigin(uriStr);
 
-                QString uriStr;
-                LPWSTR uri = nullptr;
-                if (SUCCEEDED(args->get_Uri(&uri)) && uri) {
-                  uriStr = QString::fromWCharArray(uri);
-                  CoTaskMemFree(uri);
-                }
-                const QString origin = SitePermissionsStore::normalizeOrigin(uriStr);
+          const int remembered = SitePermissionsStore::instance().decision(origin, static_cast<int>(kind));
+          if (remembered == COREWEBVIEW2_PERMISSION_STATE_ALLOW || remembered == COREWEBVIEW2_PERMISSION_STATE_DENY) {
+            args->put_State(static_cast<COREWEBVIEW2_PERMISSION_STATE>(remembered));
+            return S_OK;
+          }
 
-                const int remembered = SitePermissionsStore::instance().decision(origin, static_cast<int>(kind));
-                if (remembered == COREWEBVIEW2_PERMISSION_STATE_ALLOW || remembered == COREWEBVIEW2_PERMISSION_STATE_DENY) {
-                  args->put_State(static_cast<COREWEBVIEW2_PERMISSION_STATE>(remembered));
-                  return S_OK;
-                }
+          Microsoft::WRL::ComPtr<ICoreWebView2Deferral> deferral;
+          args->GetDeferral(&deferral);
 
-                Microsoft::WRL::ComPtr<ICoreWebView2Deferral> deferral;
-                args->GetDeferral(&deferral);
+          const int requestId = m_nextPermissionRequestId++;
+          PendingPermissionRequest pending;
+          pending.id = requestId;
+          pending.origin = origin;
+          pending.kind = kind;
+          pending.args = args;
+          pending.deferral = deferral;
+          m_pendingPermissions.push_back(pending);
 
-                const int requestId = m_nextPermissionRequestId++;
-                PendingPermissionRequest pending;
-                pending.id = requestId;
-                pending.origin = origin;
-                pending.kind = kind;
-                pending.args = args;
-                pending.deferral = deferral;
-                m_pendingPermissions.push_back(pending);
+          emit permissionRequested(requestId, origin, static_cast<int>(kind), userInitiated == TRUE);
+          return S_OK;
+        })
+        .Get(),
+      &m_permissionRequestedToken);
+  }
+
+  Microsoft::WRL::ComPtr<ICoreWebView2_4> webView4;
+  if (SUCCEEDED(m_webView.As(&webView4)) && webView4) {
+    webView4->add_DownloadStarting(
+      Callback<ICoreWebView2DownloadStartingEventHandler>(
+        [this](ICoreWebView2*, ICoreWebView2DownloadStartingEventArgs* args) -> HRESULT {
+          if (!args) {
+            return S_OK;
+          }
 
-                emit permissionRequested(requestId, origin, static_cast<int>(kind), userInitiated == TRUE);
-                return S_OK;
-              })
-              .Get(),
-            &m_permissionRequestedToken);
-        }
+          Microsoft::WRL::ComPtr<ICoreWebView2DownloadOperation> download;
+          args->get_DownloadOperation(&download);
+          if (!download) {
+            return S_OK;
+          }
 
-        Microsoft::WRL::ComPtr<ICoreWebView2_4> webView4;
-        if (SUCCEEDED(m_webView.As(&webView4)) && webView4) {
-          webView4->add_DownloadStarting(
-            Callback<ICoreWebView2DownloadStartingEventHandler>(
-              [this](ICoreWebView2*, ICoreWebView2DownloadStartingEventArgs* args) -> HRESULT {
-                if (!args) {
-                  return S_OK;
-                }
+          QString uriStr;
+          LPWSTR uri = nullptr;
+          if (SUCCEEDED(download->get_Uri(&uri)) && uri) {
+            uriStr = QString::fromWCharArray(uri);
+            CoTaskMemFree(uri);
+          }
 
-                Microsoft::WRL::ComPtr<ICoreWebView2DownloadOperation> download;
-                args->get_DownloadOperation(&download);
-                if (!download) {
-                  return S_OK;
-                }
+          QString filePathStr;
+          LPWSTR filePath = nullptr;
+          if (SUCCEEDED(args->get_ResultFilePath(&filePath)) && filePath) {
+            filePathStr = QString::fromWCharArray(filePath);
+            CoTaskMemFree(filePath);
+          }
 
-                QString uriStr;
-                LPWSTR uri = nullptr;
-                if (SUCCEEDED(download->get_Uri(&uri)) && uri) {
-                  uriStr = QString::fromWCharArray(uri);
-                  CoTaskMemFree(uri);
-                }
+          const QUrl downloadUrl(uriStr);
+          const QString scheme = downloadUrl.scheme().toLower();
+          if (m_interceptDownloads && !filePathStr.isEmpty() && (scheme == QLatin1String("http") || scheme == QLatin1String("https"))) {
+            args->put_Cancel(TRUE);
+            interceptDownload(downloadUrl, filePathStr);
+            return S_OK;
+          }
 
-                QString filePathStr;
-                LPWSTR filePath = nullptr;
-                if (SUCCEEDED(args->get_ResultFilePath(&filePath)) && filePath) {
-                  filePathStr = QString::fromWCharArray(filePath);
-                  CoTaskMemFree(filePath);
-                }
+          const int subscriptionId = m_nextDownloadSubscriptionId++;
+          DownloadSubscription sub;
+          sub.id = subscriptionId;
+          sub.operation = download;
+          sub.uri = uriStr;
+          sub.filePath = filePathStr;
+
+          INT64 totalBytes = 0;
+          download->get_TotalBytesToReceive(&totalBytes);
 
-                const int subscriptionId = m_nextDownloadSubscriptionId++;
-                DownloadSubscription sub;
-                sub.id = subscriptionId;
-                sub.operation = download;
-                sub.uri = uriStr;
-                sub.filePath = filePathStr;
-
-                INT64 totalBytes = 0;
-                download->get_TotalBytesToReceive(&totalBytes);
-
-                emit downloadStarted(subscriptionId, uriStr, filePathStr, static_cast<qint64>(totalBytes));
-                emit downloadProgress(subscriptionId, 0, static_cast<qint64>(totalBytes), false, false, QString());
-
-                download->add_StateChanged(
-                  Callback<ICoreWebView2StateChangedEventHandler>(
-                    [this, subscriptionId](ICoreWebView2DownloadOperation* sender, IUnknown*) -> HRESULT {
-                      handleDownloadStateChanged(subscriptionId, sender);
-                      return S_OK;
-                    })
-                    .Get(),
-                  &sub.stateChangedToken);
-
-                download->add_BytesReceivedChanged(
-                  Callback<ICoreWebView2BytesReceivedChangedEventHandler>(
-                    [this, subscriptionId](ICoreWebView2DownloadOperation* sender, IUnknown*) -> HRESULT {
-                      handleDownloadBytesReceivedChanged(subscriptionId, sender);
-                      return S_OK;
-                    })
-                    .Get(),
-                  &sub.bytesReceivedChangedToken);
-
-                m_downloadSubscriptions.push_back(sub);
+          emit downloadStarted(subscriptionId, uriStr, filePathStr, static_cast<qint64>(totalBytes));
+          emit downloadProgress(subscriptionId, 0, static_cast<qint64>(totalBytes), false, false, QString());
 
+          download->add_StateChanged(
+            Callback<ICoreWebView2StateChangedEventHandler>(
+              [this, subscriptionId](ICoreWebView2DownloadOperation* sender, IUnknown*) -> HRESULT {
+                handleDownloadStateChanged(subscriptionId, sender);
                 return S_OK;
               })
               .Get(),
-            &m_downloadStartingToken);
-        }
+            &sub.stateChangedToken);
 
-        updateBounds();
-        updateVisibility();
-        updateNavigationState();
-        updateAudioState();
+          download->add_BytesReceivedChanged(
+            Callback<ICoreWebView2BytesReceivedChangedEventHandler>(
+              [this, subscriptionId](ICoreWebView2DownloadOperation* sender, IUnknown*) -> HRESULT {
+                handleDownloadBytesReceivedChanged(subscriptionId, sender);
+                return S_OK;
+              })
+              .Get(),
+            &sub.bytesReceivedChangedToken);
 
-        m_initialized = true;
-        emit initializedChanged();
+          m_downloadSubscriptions.push_back(sub);
 
-        flushPendingScripts();
+          return S_OK;
+        })
+        .Get(),
+      &m_downloadStartingToken);
+  }
+
+  updateBounds();
+  updateVisibility();
+  updateNavigationState();
+  updateAudioState();
+
+  m_initialized = true;
+  emit initializedChanged();
+
+  flushPendingScripts();
+
+  const QUrl pending = m_pendingNavigate;
+  m_pendingNavigate = {};
+  if (adopted) {
+    // The page came over from another window as it was. Pick up its state
+    // and leave it alone; the owner's initial navigate() would reload it.
+    LPWSTR source = nullptr;
+    if (SUCCEEDED(m_webView->get_Source(&source)) && source) {
+      setCurrentUrl(QUrl(QString::fromWCharArray(source)));
+      CoTaskMemFree(source);
+    }
+    LPWSTR title = nullptr;
+    if (SUCCEEDED(m_webView->get_DocumentTitle(&title)) && title) {
+      setTitle(QString::fromWCharArray(title));
+      CoTaskMemFree(title);
+    }
+  } else if (pending.isValid()) {
+    navigate(pending);
+  }
+}
 
-        const QUrl pending = m_pendingNavigate;
-        m_pendingNavigate = {};
-        if (pending.isValid()) {
-          navigate(pending);
-        }
+void WebView2View::detachEventHandlers()
+{
+  if (m_webView) {
+    m_webView->remove_DocumentTitleChanged(m_titleChangedToken);
+    m_webView->remove_SourceChanged(m_sourceChangedToken);
+    m_webView->remove_ContainsFullScreenElementChanged(m_containsFullScreenElementChangedToken);
+    m_webView->remove_NavigationStarting(m_navigationStartingToken);
+    m_webView->remove_NavigationCompleted(m_navigationCompletedToken);
+    m_webView->remove_HistoryChanged(m_historyChangedToken);
+    m_webView->remove_WebMessageReceived(m_webMessageReceivedToken);
+    m_webView->remove_WebResourceRequested(m_webResourceRequestedToken);
 
-        return S_OK;
-      })
-      .Get());
+    Microsoft::WRL::ComPtr<ICoreWebView2_11> webView11;
+    if (SUCCEEDED(m_webView.As(&webView11)) && webView11) {
+      webView11->remove_ContextMenuRequested(m_contextMenuRequestedToken);
+    }
+
+    Microsoft::WRL::ComPtr<ICoreWebView2_4> webView4;
+    if (SUCCEEDED(m_webView.As(&webView4)) && webView4) {
+      webView4->remove_DownloadStarting(m_downloadStartingToken);
+    }
+
+    Microsoft::WRL::ComPtr<ICoreWebView2_3> webView3;
+    if (SUCCEEDED(m_webView.As(&webView3)) && webView3) {
+      webView3->remove_PermissionRequested(m_permissionRequestedToken);
+    }
+
+    Microsoft::WRL::ComPtr<ICoreWebView2_15> webView15;
+    if (SUCCEEDED(m_webView.As(&webView15)) && webView15) {
+      webView15->remove_FaviconChanged(m_faviconChangedToken);
+    }
+
+    Microsoft::WRL::ComPtr<ICoreWebView2_8> webView8;
+    if (SUCCEEDED(m_webView.As(&webView8)) && webView8) {
+      webView8->remove_IsDocumentPlayingAudioChanged(m_audioChangedToken);
+      webView8->remove_IsMutedChanged(m_mutedChangedToken);
+    }
+
+    for (auto& sub : m_downloadSubscriptions) {
+      if (sub.operation) {
+        sub.operation->remove_StateChanged(sub.stateChangedToken);
+        sub.operation->remove_BytesReceivedChanged(sub.bytesReceivedChangedToken);
+      }
+    }
+    m_downloadSubscriptions.clear();
+  }
+  if (m_controller) {
+    m_controller->remove_GotFocus(m_gotFocusToken);
+    m_controller->remove_ZoomFactorChanged(m_zoomFactorChangedToken);
+  }
 }
 
 void WebView2View::flushPendingScripts()
@@ -1526,7 +1804,14 @@ bool WebView2View::handleInternalWebMessage(const QString& json)
   const QJsonObject obj = doc.object();
   const QString type = obj.value(QStringLiteral("type")).toString();
   if (type == QStringLiteral("xbrowser-mods-ready")) {
-    postUserCssMessage();
+    // A fresh document has no mod styles yet; let the owner pick the sheets
+    // for the page's URL and fall back to whatever was last set.
+    m_postedUserCssOrder.clear();
+    m_postedUserCssHashes.clear();
+    emit userCssRequested(QUrl(obj.value(QStringLiteral("url")).toString()));
+    if (m_postedUserCssHashes.isEmpty()) {
+      postUserCssMessage();
+    }
     return true;
   }
 
@@ -1539,14 +1824,171 @@ void WebView2View::postUserCssMessage()
     return;
   }
 
+  QStringList order;
+  order.reserve(m_userCssSheets.size());
+  QJsonObject upsert;
+  QSet<QString> keep;
+  for (const UserCssSheet& sheet : m_userCssSheets) {
+    order.push_back(sheet.id);
+    keep.insert(sheet.id);
+    if (m_postedUserCssHashes.value(sheet.id) != sheet.hash) {
+      upsert.insert(sheet.id, sheet.css);
+    }
+  }
+
+  QJsonArray remove;
+  for (auto it = m_postedUserCssHashes.constBegin(); it != m_postedUserCssHashes.constEnd(); ++it) {
+    if (!keep.contains(it.key())) {
+      remove.push_back(it.key());
+    }
+  }
+
+  const bool reorder = order != m_postedUserCssOrder;
+  if (upsert.isEmpty() && remove.isEmpty() && !reorder) {
+    return;
+  }
+
+  m_postedUserCssHashes.clear();
+  for (const UserCssSheet& sheet : m_userCssSheets) {
+    m_postedUserCssHashes.insert(sheet.id, sheet.hash);
+  }
+  m_postedUserCssOrder = order;
+
   QJsonObject obj;
   obj.insert(QStringLiteral("type"), QStringLiteral("xbrowser-mods-css"));
-  obj.insert(QStringLiteral("css"), m_userCss);
+  obj.insert(QStringLiteral("upsert"), upsert);
+  obj.insert(QStringLiteral("remove"), remove);
+  if (reorder) {
+    obj.insert(QStringLiteral("order"), QJsonArray::fromStringList(order));
+  }
 
   const QString payload = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
   m_webView->PostWebMessageAsJson(toWide(payload).c_str());
 }
 
+void WebView2View::handleWebResourceRequested(ICoreWebView2WebResourceRequestedEventArgs* args)
+{
+  if (!args || !m_environment) {
+    return;
+  }
+
+  Microsoft::WRL::ComPtr<ICoreWebView2WebResourceRequest> request;
+  if (FAILED(args->get_Request(&request)) || !request) {
+    return;
+  }
+
+  LPWSTR uri = nullptr;
+  if (FAILED(request->get_Uri(&uri)) || !uri) {
+    return;
+  }
+  const QString url = QString::fromWCharArray(uri);
+  CoTaskMemFree(uri);
+
+  COREWEBVIEW2_WEB_RESOURCE_CONTEXT context = COREWEBVIEW2_WEB_RESOURCE_CONTEXT_OTHER;
+  args->get_ResourceContext(&context);
+
+  // Document requests cover both the main frame and iframes; only the one
+  // NavigationStarting announced is the top-level document, and that one is
+  // first-party to itself.
+  ContentFilterEngine::ResourceType type = resourceTypeForContext(context);
+  QString sourceHost = m_currentUrl.host();
+  if (context == COREWEBVIEW2_WEB_RESOURCE_CONTEXT_DOCUMENT && url == m_mainFrameNavigationUri) {
+    type = ContentFilterEngine::ResourceType::Document;
+    sourceHost = QUrl(url).host();
+  }
+
+  if (!ContentBlocker::instance().shouldBlock(url, sourceHost, type)) {
+    return;
+  }
+
+  Microsoft::WRL::ComPtr<ICoreWebView2WebResourceResponse> response;
+  if (SUCCEEDED(m_environment->CreateWebResourceResponse(nullptr, 403, L"Blocked by content filter", L"", &response))
+      && response) {
+    args->put_Response(response.Get());
+  }
+}
+
+void WebView2View::updateContentFilterRegistration()
+{
+  if (!m_webView) {
+    return;
+  }
+
+  const bool wanted = ContentBlocker::instance().isReady();
+  if (wanted == m_contentFilterRegistered) {
+    return;
+  }
+
+  HRESULT hr = E_FAIL;
+  Microsoft::WRL::ComPtr<ICoreWebView2_22> webView22;
+  if (SUCCEEDED(m_webView.As(&webView22)) && webView22) {
+    // Include iframe-originated requests, which the legacy filter misses.
+    const auto kinds = COREWEBVIEW2_WEB_RESOURCE_REQUEST_SOURCE_KINDS_DOCUMENT;
+    hr = wanted ? webView22->AddWebResourceRequestedFilterWithRequestSourceKinds(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL, kinds)
+                : webView22->RemoveWebResourceRequestedFilterWithRequestSourceKinds(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL, kinds);
+  } else {
+    hr = wanted ? m_webView->AddWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL)
+                : m_webView->RemoveWebResourceRequestedFilter(L"*", COREWEBVIEW2_WEB_RESOURCE_CONTEXT_ALL);
+  }
+  if (SUCCEEDED(hr)) {
+    m_contentFilterRegistered = wanted;
+  }
+}
+
+void WebView2View::interceptDownload(const QUrl& uri, const QString& resultFilePath)
+{
+  // The engine would have sent the profile's cookies; look them up so the
+  // download still works behind a login.
+  Microsoft::WRL::ComPtr<ICoreWebView2_2> webView2;
+  Microsoft::WRL::ComPtr<ICoreWebView2CookieManager> manager;
+  if (!m_webView || FAILED(m_webView.As(&webView2)) || !webView2 || FAILED(webView2->get_CookieManager(&manager)) || !manager) {
+    emit downloadIntercepted(uri, resultFilePath, QString());
+    return;
+  }
+
+  const QPointer<WebView2View> self(this);
+  const std::wstring wUri = toWide(uri.toString());
+  const HRESULT hr = manager->GetCookies(
+    wUri.c_str(),
+    Callback<ICoreWebView2GetCookiesCompletedHandler>(
+      [self, uri, resultFilePath](HRESULT errorCode, ICoreWebView2CookieList* result) -> HRESULT {
+        if (!self) {
+          return S_OK;
+        }
+
+        QStringList pairs;
+        UINT32 count = 0;
+        if (SUCCEEDED(errorCode) && result && SUCCEEDED(result->get_Count(&count))) {
+          for (UINT32 i = 0; i < count; ++i) {
+            Microsoft::WRL::ComPtr<ICoreWebView2Cookie> cookie;
+            if (FAILED(result->GetValueAtIndex(i, &cookie)) || !cookie) {
+              continue;
+            }
+
+            LPWSTR name = nullptr;
+            LPWSTR value = nullptr;
+            cookie->get_Name(&name);
+            cookie->get_Value(&value);
+            const QString nameStr = name ? QString::fromWCharArray(name) : QString();
+            const QString valueStr = value ? QString::fromWCharArray(value) : QString();
+            CoTaskMemFree(name);
+            CoTaskMemFree(value);
+            if (!nameStr.isEmpty()) {
+              pairs.push_back(nameStr + QLatin1Char('=') + valueStr);
+            }
+          }
+        }
+
+        emit self->downloadIntercepted(uri, resultFilePath, pairs.join(QStringLiteral("; ")));
+        return S_OK;
+      })
+      .Get());
+
+  if (FAILED(hr)) {
+    emit downloadIntercepted(uri, resultFilePath, QString());
+  }
+}
+
 void WebView2View::handleDownloadStateChanged(int subscriptionId, ICoreWebView2DownloadOperation* download)
 {
   if (!download) {
@@ -2,10 +2,12 @@
 
 #include <Windows.h>
 
+#include <QHash>
 #include <QPointer>
 #include <QQuickItem>
 #include <QUrl>
 #include <QStringList>
+#include <QVariantList>
 #include <QVariantMap>
 #include <QVector>
 
@@ -30,6 +32,10 @@ class WebView2View : public QQuickItem
   Q_PROPERTY(bool documentPlayingAudio READ documentPlayingAudio NOTIFY documentPlayingAudioChanged)
   Q_PROPERTY(bool muted READ muted WRITE setMuted NOTIFY mutedChanged)
   Q_PROPERTY(qreal zoomFactor READ zoomFactor WRITE setZoomFactor NOTIFY zoomFactorChanged)
+  Q_PROPERTY(int handoffToken READ handoffToken WRITE setHandoffToken NOTIFY handoffTokenChanged)
+  // Hands http(s) downloads to downloadIntercepted instead of letting the
+  // engine fetch them.
+  Q_PROPERTY(bool interceptDownloads READ interceptDownloads WRITE setInterceptDownloads NOTIFY interceptDownloadsChanged)
 
 public:
   explicit WebView2View(QQuickItem* parent = nullptr);
@@ -48,6 +54,10 @@ public:
   bool documentPlayingAudio() const;
   bool muted() const;
   qreal zoomFactor() const;
+  int handoffToken() const;
+  void setHandoffToken(int token);
+  bool interceptDownloads() const;
+  void setInterceptDownloads(bool intercept);
 
   Microsoft::WRL::ComPtr<ICoreWebView2> coreWebView() const;
 
@@ -67,10 +77,16 @@ public:
   Q_INVOKABLE void zoomReset();
   Q_INVOKABLE void retryInitialize();
 
+  // Detaches the live page so a view in another window created with the
+  // same handoffToken adopts it instead of loading the URL again.
+  Q_INVOKABLE bool parkForHandoff(int token);
+
   Q_INVOKABLE void addScriptOnDocumentCreated(const QString& script);
   Q_INVOKABLE void executeScript(const QString& script);
+  Q_INVOKABLE void capturePageText(int maxChars);
   Q_INVOKABLE void postWebMessageAsJson(const QString& json);
   Q_INVOKABLE void setUserCss(const QString& css);
+  Q_INVOKABLE void setUserCssSheets(const QVariantList& sheets);
   Q_INVOKABLE void respondToPermissionRequest(int requestId, int state, bool remember);
   Q_INVOKABLE void clearBrowsingData(int dataKinds, qint64 fromMs, qint64 toMs);
 
@@ -91,14 +107,20 @@ signals:
   void documentPlayingAudioChanged();
   void mutedChanged();
   void zoomFactorChanged();
+  void handoffTokenChanged();
+  void interceptDownloadsChanged();
   void navigationCommitted(bool success);
 
   void webMessageReceived(const QString& json);
+  void userCssRequested(const QUrl& url);
   void scriptExecuted(const QString& resultJson);
+  void pageTextCaptured(const QUrl& url, const QString& title, const QString& text);
 
   void downloadStarted(int downloadOperationId, const QString& uri, const QString& resultFilePath, qint64 totalBytes);
   void downloadProgress(int downloadOperationId, qint64 bytesReceived, qint64 totalBytes, bool paused, bool canResume, const QString& interruptReason);
   void downloadFinished(int downloadOperationId, const QString& uri, const QString& resultFilePath, bool success, const QString& interruptReason);
+  // cookieHeader holds the profile's cookies for uri, ready for a Cookie header.
+  void downloadIntercepted(const QUrl& uri, const QString& resultFilePath, const QString& cookieHeader);
 
   void contextMenuRequested(const QVariantMap& info);
   void permissionRequested(int requestId, const QString& origin, int kind, bool userInitiated);
@@ -107,10 +129,15 @@ signals:
   void capturePreviewFinished(const QString& filePath, bool success, const QString& error);
   void browsingDataCleared(int dataKinds, bool success, const QString& error);
 
+protected:
+  void componentComplete() override;
+
 private:
   void handleWindowChanged(QQuickWindow* window);
   void tryInitialize();
   void startControllerCreation(ICoreWebView2Environment* env);
+  void attachController(ICoreWebView2Controller* controller, bool adopted);
+  void detachEventHandlers();
   void updateBounds();
   void updateVisibility();
   void updateNavigationState();
@@ -119,7 +146,10 @@ private:
   void ensureUserCssBootstrapScript();
   bool handleInternalWebMessage(const QString& json);
   void postUserCssMessage();
+  void handleWebResourceRequested(ICoreWebView2WebResourceRequestedEventArgs* args);
+  void updateContentFilterRegistration();
   void handleDownloadStateChanged(int subscriptionId, ICoreWebView2DownloadOperation* download);
+  void interceptDownload(const QUrl& uri, const QString& resultFilePath);
   void handleDownloadBytesReceivedChanged(int subscriptionId, ICoreWebView2DownloadOperation* download);
   void setIsLoading(bool loading);
   void setCurrentUrl(const QUrl& url);
@@ -150,6 +180,7 @@ private:
   EventRegistrationToken m_permissionRequestedToken{};
   EventRegistrationToken m_gotFocusToken{};
   EventRegistrationToken m_zoomFactorChangedToken{};
+  EventRegistrationToken m_webResourceRequestedToken{};
 
   bool m_initializing = false;
   bool m_initialized = false;
@@ -168,8 +199,22 @@ private:
   bool m_capturePreviewInProgress = false;
   QUrl m_pendingNavigate;
   QStringList m_pendingScripts;
-  QString m_userCss;
+  QStringList m_installedScripts;
+  int m_handoffToken = 0;
+  bool m_interceptDownloads = false;
   bool m_userCssBootstrapInstalled = false;
+  bool m_contentFilterRegistered = false;
+  QString m_mainFrameNavigationUri;
+
+  struct UserCssSheet
+  {
+    QString id;
+    QString hash;
+    QString css;
+  };
+  QVector<UserCssSheet> m_userCssSheets;
+  QStringList m_postedUserCssOrder;
+  QHash<QString, QString> m_postedUserCssHashes;
 
   struct DownloadSubscription
   {
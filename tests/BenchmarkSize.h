@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Benchmarks run at full size only under the xbrowser_benchmarks target,
+// which sets XBROWSER_BENCHMARKS; the ordinary test run uses the small size
+// and keeps only their functional checks.
+inline bool benchmarksEnabled()
+{
+  return qEnvironmentVariableIsSet("XBROWSER_BENCHMARKS");
+}
+
+inline int benchmarkSize(int full, int quick)
+{
+  return benchmarksEnabled() ? full : quick;
+}
@@ -0,0 +1,32 @@
+#include <QCoreApplication>
+#include <QTextStream>
+
+#include "core/InstanceBroker.h"
+
+// Stand-in for a second browser launch in TestInstanceBroker:
+//   xbrowser_test_instance_client <data-dir> [--new-window] [urls...]
+// Exits 0 once the listening instance accepted the URLs.
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  QStringList args = app.arguments().mid(1);
+  if (args.isEmpty()) {
+    return 2;
+  }
+
+  const QString dataDir = args.takeFirst();
+  InstanceBroker::Request request;
+  if (!args.isEmpty() && args.first() == QStringLiteral("--new-window")) {
+    request.newWindow = true;
+    args.removeFirst();
+  }
+  request.urls = args;
+
+  QString error;
+  if (!InstanceBroker::forward(dataDir, request, &error)) {
+    QTextStream(stderr) << error << '\n';
+    return 1;
+  }
+  return 0;
+}
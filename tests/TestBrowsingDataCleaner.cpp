@@ -0,0 +1,212 @@
+#include <QtTest/QtTest>
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "core/BrowsingDataCleaner.h"
+#include "core/FaviconCache.h"
+#include "core/HistoryStore.h"
+#include "core/SitePermissionsStore.h"
+
+namespace
+{
+constexpr qint64 kHourMs = 60LL * 60LL * 1000LL;
+
+bool writeFile(const QString& path, const QDateTime& modified)
+{
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly) || file.write("x") != 1) {
+    return false;
+  }
+  return file.setFileTime(modified, QFileDevice::FileModificationTime);
+}
+}
+
+// Stands in for WebView2View: answers clearBrowsingData when told to.
+class FakeEngineView final : public QObject
+{
+  Q_OBJECT
+
+public:
+  Q_INVOKABLE void clearBrowsingData(int dataKinds, qint64 fromMs, qint64 toMs)
+  {
+    calls.push_back({dataKinds, fromMs, toMs});
+    if (!failWith.isEmpty()) {
+      emit browsingDataCleared(dataKinds, false, failWith);
+    }
+  }
+
+  struct Call
+  {
+    int kinds = 0;
+    qint64 fromMs = 0;
+    qint64 toMs = 0;
+  };
+  QVector<Call> calls;
+  // Answers synchronously with this error when set.
+  QString failWith;
+
+signals:
+  void browsingDataCleared(int dataKinds, bool success, const QString& error);
+};
+
+class TestBrowsingDataCleaner final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void clear_fansOutAcrossStoresFilesAndEngine()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    HistoryStore history;
+    history.addVisit(QUrl("https://old.example/"), "Old", now - 48 * kHourMs);
+    history.addVisit(QUrl("https://new.example/"), "New", now - kHourMs / 2);
+
+    SitePermissionsStore& permissions = SitePermissionsStore::instance();
+    permissions.clearAll();
+    permissions.setDecision(QStringLiteral("https://new.example"), 1, 1);
+
+    const QDir root(dir.path());
+    const QDateTime recent = QDateTime::currentDateTime().addSecs(-60);
+    const QDateTime stale = QDateTime::currentDateTime().addDays(-3);
+    QVERIFY(writeFile(root.filePath("favicons/recent.png"), recent));
+    QVERIFY(writeFile(root.filePath("favicons/stale.png"), stale));
+    QVERIFY(writeFile(root.filePath("thumbnails/recent.jpg"), recent));
+
+    FakeEngineView view;
+    BrowsingDataCleaner cleaner;
+    cleaner.setHistory(&history);
+    cleaner.setSitePermissions(&permissions);
+    cleaner.setView(&view);
+    QSignalSpy finished(&cleaner, &BrowsingDataCleaner::finished);
+
+    const int kinds = BrowsingDataCleaner::History | BrowsingDataCleaner::Cookies | BrowsingDataCleaner::Cache
+                      | BrowsingDataCleaner::SitePermissions;
+    QVERIFY(cleaner.clear(kinds, now - 24 * kHourMs, now + 1));
+    QVERIFY(cleaner.running());
+    QVERIFY(!cleaner.clear(kinds, 0, 0));
+
+    // The engine was asked straight away; the stores wait for the event loop.
+    QCOMPARE(view.calls.size(), 1);
+    QCOMPARE(view.calls.at(0).kinds, BrowsingDataCleaner::engineKinds(kinds));
+    QCOMPARE(view.calls.at(0).fromMs, now - 24 * kHourMs);
+    QCOMPARE(history.count(), 2);
+
+    // Everything but the engine finishes; the run waits for it.
+    QTRY_COMPARE(history.count(), 1);
+    QTRY_VERIFY(!QFileInfo::exists(root.filePath("thumbnails/recent.jpg")));
+    QVERIFY(!QFileInfo::exists(root.filePath("favicons/recent.png")));
+    QVERIFY(QFileInfo::exists(root.filePath("favicons/stale.png")));
+    QVERIFY(permissions.origins().isEmpty());
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(cleaner.progress() < 1.0);
+
+    // Reports for clears someone else asked for are not ours.
+    emit view.browsingDataCleared(0x40, true, {});
+    QCOMPARE(finished.count(), 0);
+
+    emit view.browsingDataCleared(view.calls.at(0).kinds, true, {});
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(finished.at(0).at(0).toBool());
+    QVERIFY(!cleaner.running());
+    QCOMPARE(cleaner.progress(), 1.0);
+  }
+
+  void clear_reportsMissingEngine()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    history.addVisit(QUrl("https://a.example/"), "A", QDateTime::currentMSecsSinceEpoch());
+
+    BrowsingDataCleaner cleaner;
+    cleaner.setHistory(&history);
+    QSignalSpy finished(&cleaner, &BrowsingDataCleaner::finished);
+
+    // All time, no view: history still goes, cookies cannot.
+    QVERIFY(cleaner.clear(BrowsingDataCleaner::History | BrowsingDataCleaner::Cookies, 0, 0));
+    QCOMPARE(finished.count(), 0);
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(history.count(), 0);
+    QVERIFY(!finished.at(0).at(0).toBool());
+    QVERIFY(!finished.at(0).at(1).toString().isEmpty());
+
+    // A view that answers synchronously still finishes after clear() returns.
+    FakeEngineView view;
+    view.failWith = QStringLiteral("denied");
+    cleaner.setView(&view);
+    QVERIFY(cleaner.clear(BrowsingDataCleaner::Cookies, 0, 0));
+    QCOMPARE(finished.count(), 1);
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.at(1).at(1).toString(), QStringLiteral("denied"));
+  }
+
+  void clear_forgetsFaviconHosts()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+    const QString index = QDir(dir.path()).filePath("favicons/index.json");
+    const auto indexText = [&index] {
+      QFile file(index);
+      return file.open(QIODevice::ReadOnly) ? QString::fromUtf8(file.readAll()) : QString();
+    };
+
+    // Declaring an icon records the host before any fetch lands; nothing
+    // listens on port 1, so none does.
+    FaviconCache favicons;
+    favicons.setPageIcon(QUrl("https://visited.example/"), QUrl("http://127.0.0.1:1/icon.png"));
+    QVERIFY(indexText().contains("visited.example"));
+
+    BrowsingDataCleaner cleaner;
+    cleaner.setFavicons(&favicons);
+    QSignalSpy finished(&cleaner, &BrowsingDataCleaner::finished);
+    QVERIFY(cleaner.clear(BrowsingDataCleaner::Cache, 0, 0));
+    QVERIFY(finished.wait(5000));
+    QVERIFY(!QFileInfo::exists(index));
+
+    // The next save writes only what came after the clear.
+    favicons.setPageIcon(QUrl("https://later.example/"), QUrl("http://127.0.0.1:1/other.png"));
+    QVERIFY(indexText().contains("later.example"));
+    QVERIFY(!indexText().contains("visited.example"));
+  }
+
+  void removeFiles_honoursRange()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    const QDateTime now = QDateTime::currentDateTime();
+    QVERIFY(writeFile(root.filePath("a"), now.addSecs(-10)));
+    QVERIFY(writeFile(root.filePath("nested/b"), now.addSecs(-20)));
+    QVERIFY(writeFile(root.filePath("c"), now.addDays(-10)));
+
+    int lastDone = 0;
+    int lastTotal = 0;
+    const QStringList removed = BrowsingDataCleaner::removeFiles(
+      dir.path(), now.addDays(-1).toMSecsSinceEpoch(), now.toMSecsSinceEpoch(), [&](int done, int total) {
+        lastDone = done;
+        lastTotal = total;
+      });
+    QCOMPARE(removed.size(), 2);
+    QCOMPARE(lastDone, 2);
+    QCOMPARE(lastTotal, 2);
+    QVERIFY(QFileInfo::exists(root.filePath("c")));
+
+    QCOMPARE(BrowsingDataCleaner::removeFiles(dir.path(), 0, 0).size(), 1);
+    QVERIFY(!QFileInfo::exists(root.filePath("c")));
+  }
+};
+
+QTEST_GUILESS_MAIN(TestBrowsingDataCleaner)
+#include "TestBrowsingDataCleaner.moc"
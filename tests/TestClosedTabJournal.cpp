@@ -0,0 +1,235 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "core/BrowserController.h"
+#include "core/ClosedTabJournal.h"
+
+class TestClosedTabJournal final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static ClosedTabJournal::TabRecord tab(int workspaceId, const QString& url, const QString& title = {})
+  {
+    ClosedTabJournal::TabRecord record;
+    record.workspaceId = workspaceId;
+    record.url = url;
+    record.initialUrl = url;
+    record.pageTitle = title;
+    return record;
+  }
+
+  static int lineCount(const QString& path)
+  {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+      return -1;
+    }
+    int lines = 0;
+    while (!f.atEnd()) {
+      if (!f.readLine().trimmed().isEmpty()) {
+        ++lines;
+      }
+    }
+    return lines;
+  }
+
+private slots:
+  void push_wrapsRingAtCapacity()
+  {
+    ClosedTabJournal journal(4, 1024 * 1024);
+    for (int i = 0; i < 10; ++i) {
+      journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://t%1.example").arg(i))});
+    }
+
+    QCOMPARE(journal.count(), 4);
+    QCOMPARE(journal.at(0).tabs.first().url, QStringLiteral("https://t9.example"));
+    QCOMPARE(journal.at(3).tabs.first().url, QStringLiteral("https://t6.example"));
+    QVERIFY(journal.at(0).tabs.first().initialUrl.isEmpty());
+
+    const ClosedTabJournal::Record middle = journal.takeAt(1);
+    QCOMPARE(middle.tabs.first().url, QStringLiteral("https://t8.example"));
+    QCOMPARE(journal.count(), 3);
+
+    journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://t10.example"))});
+    journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://t11.example"))});
+    QCOMPARE(journal.count(), 4);
+    QCOMPARE(journal.at(0).tabs.first().url, QStringLiteral("https://t11.example"));
+    QCOMPARE(journal.at(1).tabs.first().url, QStringLiteral("https://t10.example"));
+    QCOMPARE(journal.at(2).tabs.first().url, QStringLiteral("https://t9.example"));
+    QCOMPARE(journal.at(3).tabs.first().url, QStringLiteral("https://t7.example"));
+
+    QCOMPARE(journal.takeNewest().tabs.first().url, QStringLiteral("https://t11.example"));
+    QCOMPARE(journal.count(), 3);
+  }
+
+  void push_evictsOldestOverByteBudget()
+  {
+    ClosedTabJournal probe;
+    probe.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://a.example/%1").arg(QString(200, 'x')))});
+    const qint64 perRecord = probe.bytesUsed();
+    QVERIFY(perRecord > 400);
+
+    ClosedTabJournal journal(1000, perRecord * 3);
+    for (int i = 0; i < 20; ++i) {
+      journal.push(ClosedTabJournal::Kind::Tab,
+                   {tab(1, QStringLiteral("https://a.example/%1").arg(QString(200, QChar('a' + i))))});
+    }
+
+    QCOMPARE(journal.count(), 3);
+    QVERIFY(journal.bytesUsed() <= journal.byteBudget());
+
+    journal.setByteBudget(perRecord);
+    QCOMPARE(journal.count(), 1);
+  }
+
+  void storage_replaysIncrementalLogAndCompacts()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = QDir(dir.path()).filePath("closed_tabs.jsonl");
+
+    {
+      ClosedTabJournal journal;
+      journal.setStoragePath(path);
+      journal.push(ClosedTabJournal::Kind::Tab, {tab(1, "https://a.example", "A")});
+      journal.push(ClosedTabJournal::Kind::Window, {tab(2, "https://b.example", "B"), tab(2, "https://c.example", "C")});
+      journal.push(ClosedTabJournal::Kind::Tab, {tab(1, "https://d.example", "D")});
+      journal.takeAt(2);
+      QCOMPARE(lineCount(path), 4);
+    }
+
+    {
+      ClosedTabJournal journal;
+      journal.setStoragePath(path);
+      QCOMPARE(journal.count(), 2);
+      QCOMPARE(journal.at(0).tabs.first().pageTitle, QStringLiteral("D"));
+      QCOMPARE(journal.at(1).kind, ClosedTabJournal::Kind::Window);
+      QCOMPARE(journal.at(1).tabs.size(), 2);
+      QCOMPARE(journal.newestIndexForWorkspace(2, ClosedTabJournal::Kind::Window), 1);
+
+      for (int i = 0; i < 100; ++i) {
+        journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://n%1.example").arg(i))});
+        journal.takeNewest();
+      }
+      QVERIFY(lineCount(path) <= 64);
+    }
+
+    {
+      ClosedTabJournal journal;
+      journal.setStoragePath(path);
+      QCOMPARE(journal.count(), 2);
+      journal.clear();
+    }
+
+    {
+      ClosedTabJournal journal;
+      journal.setStoragePath(path);
+      QCOMPARE(journal.count(), 0);
+    }
+  }
+
+  void takeRange_logsAndNotifiesOnce()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = QDir(dir.path()).filePath("closed_tabs.jsonl");
+
+    {
+      // A small ring wraps, so the range straddles its end.
+      ClosedTabJournal journal(4, 1024 * 1024);
+      journal.setStoragePath(path);
+      for (int i = 0; i < 6; ++i) {
+        journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://t%1.example").arg(i))});
+      }
+      const int linesBefore = lineCount(path);
+
+      QSignalSpy changed(&journal, &ClosedTabJournal::changed);
+      const qint64 bytesBefore = journal.bytesUsed();
+      const QVector<ClosedTabJournal::Record> taken = journal.takeRange(1, 2);
+      QCOMPARE(changed.count(), 1);
+      QCOMPARE(lineCount(path), linesBefore + 1);
+      QCOMPARE(taken.size(), 2);
+      QCOMPARE(taken.at(0).tabs.first().url, QStringLiteral("https://t4.example"));
+      QCOMPARE(taken.at(1).tabs.first().url, QStringLiteral("https://t3.example"));
+      QCOMPARE(journal.bytesUsed(), bytesBefore - ClosedTabJournal::recordBytes(taken.at(0))
+                                      - ClosedTabJournal::recordBytes(taken.at(1)));
+
+      QCOMPARE(journal.count(), 2);
+      QCOMPARE(journal.at(0).tabs.first().url, QStringLiteral("https://t5.example"));
+      QCOMPARE(journal.at(1).tabs.first().url, QStringLiteral("https://t2.example"));
+
+      journal.push(ClosedTabJournal::Kind::Tab, {tab(1, QStringLiteral("https://t6.example"))});
+      QCOMPARE(journal.at(2).tabs.first().url, QStringLiteral("https://t2.example"));
+    }
+
+    ClosedTabJournal journal(4, 1024 * 1024);
+    journal.setStoragePath(path);
+    QCOMPARE(journal.count(), 3);
+    QCOMPARE(journal.at(0).tabs.first().url, QStringLiteral("https://t6.example"));
+    QCOMPARE(journal.at(1).tabs.first().url, QStringLiteral("https://t5.example"));
+    QCOMPARE(journal.at(2).tabs.first().url, QStringLiteral("https://t2.example"));
+  }
+
+  void browser_restoresRangeAcrossWorkspaces()
+  {
+    BrowserController browser;
+    browser.workspaces()->clear();
+    const int ws0 = browser.workspaces()->addWorkspaceWithId(1, "One");
+    const int ws1 = browser.workspaces()->addWorkspaceWithId(2, "Two");
+
+    TabModel* tabs0 = browser.workspaces()->tabsForIndex(ws0);
+    TabModel* tabs1 = browser.workspaces()->tabsForIndex(ws1);
+    tabs0->addTabWithId(10, QUrl("https://a.example"), "A", false);
+    tabs0->addTabWithId(11, QUrl("https://b.example"), "B", false);
+    tabs1->addTabWithId(20, QUrl("https://c.example"), "C", false);
+
+    browser.workspaces()->setActiveIndex(ws0);
+    browser.closeTab(0);
+    browser.closeTab(0);
+    browser.workspaces()->setActiveIndex(ws1);
+    browser.closeTab(0);
+    QCOMPARE(browser.recentlyClosedCount(), 3);
+
+    QCOMPARE(browser.restoreRecentlyClosedRange(0, 3), 3);
+    QCOMPARE(browser.recentlyClosedCount(), 0);
+
+    QCOMPARE(tabs0->count(), 2);
+    QCOMPARE(tabs0->urlAt(0), QUrl("https://a.example"));
+    QCOMPARE(tabs0->urlAt(1), QUrl("https://b.example"));
+    QCOMPARE(tabs1->count(), 1);
+    QCOMPARE(browser.workspaces()->activeWorkspaceId(), 2);
+  }
+
+  void tabModel_restoresOnlyItsWorkspace()
+  {
+    BrowserController browser;
+    browser.workspaces()->clear();
+    const int ws0 = browser.workspaces()->addWorkspaceWithId(1, "One");
+    const int ws1 = browser.workspaces()->addWorkspaceWithId(2, "Two");
+
+    TabModel* tabs0 = browser.workspaces()->tabsForIndex(ws0);
+    TabModel* tabs1 = browser.workspaces()->tabsForIndex(ws1);
+    tabs0->addTabWithId(10, QUrl("https://a.example"), "A", false);
+    tabs1->addTabWithId(20, QUrl("https://c.example"), "C", false);
+
+    tabs0->closeTab(0);
+    tabs1->closeTab(0);
+    QCOMPARE(browser.recentlyClosedCount(), 2);
+
+    QVERIFY(tabs0->canRestoreLastClosedTab());
+    const int idx = tabs0->restoreLastClosedTab();
+    QCOMPARE(tabs0->urlAt(idx), QUrl("https://a.example"));
+    QCOMPARE(browser.recentlyClosedCount(), 1);
+    QVERIFY(!tabs0->canRestoreLastClosedTab());
+    QVERIFY(tabs1->canRestoreLastClosedTab());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestClosedTabJournal)
+
+#include "TestClosedTabJournal.moc"
@@ -0,0 +1,152 @@
+#include <QtTest/QtTest>
+
+#include <QSignalSpy>
+
+#include "core/CommandBus.h"
+
+class TestCommandBus final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void dispatchesToRegisteredHandler()
+  {
+    CommandBus bus;
+    QVariantMap received;
+    int calls = 0;
+    const int id = bus.registerCommand({ "new-tab", "New Tab", "Tabs", "Ctrl+T" }, [&](const QVariantMap& args) {
+      received = args;
+      ++calls;
+    });
+    QVERIFY(id >= 0);
+    QCOMPARE(bus.commandId("new-tab"), id);
+    QVERIFY(bus.hasCommand("new-tab"));
+
+    QSignalSpy invoked(&bus, &CommandBus::commandInvoked);
+    QVERIFY(bus.invoke("new-tab", { { "url", "https://example.com" } }));
+    QCOMPARE(calls, 1);
+    QCOMPARE(received.value("url").toString(), QStringLiteral("https://example.com"));
+    QCOMPARE(invoked.count(), 0);
+
+    QVERIFY(bus.invoke(id));
+    QCOMPARE(calls, 2);
+  }
+
+  void unknownCommandIsRejected()
+  {
+    CommandBus bus;
+    bus.registerCommand({ "new-tab", "New Tab", "Tabs", {} }, [](const QVariantMap&) {});
+
+    QSignalSpy invoked(&bus, &CommandBus::commandInvoked);
+    QVERIFY(!bus.hasCommand("no-such-command"));
+    QVERIFY(!bus.invoke("no-such-command"));
+    QVERIFY(!bus.invoke(42));
+    QVERIFY(!bus.invoke(-1));
+    QCOMPARE(invoked.count(), 0);
+    QCOMPARE(bus.registerCommand({ "  ", "Blank", {}, {} }), -1);
+  }
+
+  void commandsWithoutHandlerAreBroadcast()
+  {
+    CommandBus bus;
+    bus.registerCommand({ "nav-reload", "Reload", "Navigation", "Ctrl+R" });
+
+    QSignalSpy invoked(&bus, &CommandBus::commandInvoked);
+    QVERIFY(bus.invoke(" nav-reload ", { { "tabId", 7 } }));
+    QCOMPARE(invoked.count(), 1);
+    QCOMPARE(invoked.at(0).at(0).toString(), QStringLiteral("nav-reload"));
+    QCOMPARE(invoked.at(0).at(1).toMap().value("tabId").toInt(), 7);
+  }
+
+  void reregisteringKeepsIdAndStats()
+  {
+    CommandBus bus;
+    int first = 0;
+    int second = 0;
+    const int id = bus.registerCommand({ "copy-url", "Copy URL", "Tabs", {} }, [&](const QVariantMap&) { ++first; });
+    bus.registerCommand({ "other", "Other", "Tools", {} });
+    QVERIFY(bus.invoke("copy-url"));
+
+    QCOMPARE(bus.registerCommand({ "copy-url", "Copy Link", "Tabs", {} }, [&](const QVariantMap&) { ++second; }), id);
+    QCOMPARE(bus.commandCount(), 2);
+    QVERIFY(bus.invoke("copy-url"));
+    QCOMPARE(first, 1);
+    QCOMPARE(second, 1);
+    QCOMPARE(bus.stats("copy-url").invocations, quint64(2));
+
+    const QVariantList rows = bus.searchCommands("link");
+    QCOMPARE(rows.size(), 1);
+    QCOMPARE(rows.at(0).toMap().value("title").toString(), QStringLiteral("Copy Link"));
+  }
+
+  void recordsLatency()
+  {
+    CommandBus bus;
+    bus.registerCommand({ "fast", "Fast", {}, {} }, [](const QVariantMap&) {});
+    bus.registerCommand({ "slow", "Slow", {}, {} }, [](const QVariantMap&) { QThread::msleep(5); });
+
+    for (int i = 0; i < 3; ++i) {
+      QVERIFY(bus.invoke("fast"));
+    }
+    QVERIFY(bus.invoke("slow"));
+
+    const CommandBus::Stats fast = bus.stats("fast");
+    QCOMPARE(fast.invocations, quint64(3));
+    quint64 bucketed = 0;
+    for (const quint32 count : fast.histogram) {
+      bucketed += count;
+    }
+    QCOMPARE(bucketed, quint64(3));
+
+    const CommandBus::Stats slow = bus.stats("slow");
+    QCOMPARE(slow.invocations, quint64(1));
+    QVERIFY(slow.maxNs >= 5 * 1000 * 1000);
+    // 5ms is 5000us, which has a bit width of 13.
+    QVERIFY(slow.histogram[13] + slow.histogram[14] + slow.histogram[15] == 1);
+
+    const QVariantMap exported = bus.commandStats("slow");
+    QCOMPARE(exported.value("invocations").toInt(), 1);
+    QVERIFY(exported.value("maxUs").toDouble() >= 5000.0);
+    QCOMPARE(exported.value("histogram").toList().size(), CommandBus::kLatencyBuckets);
+
+    bus.resetStats();
+    QCOMPARE(bus.stats("slow").invocations, quint64(0));
+    QCOMPARE(bus.stats("missing").invocations, quint64(0));
+  }
+
+  void searchRanksListedCommands()
+  {
+    CommandBus bus;
+    bus.registerCommand({ "new-tab", "New Tab", "Tabs", "Ctrl+T" });
+    bus.registerCommand({ "new-window", "New Window", "Windows", "Ctrl+N" });
+    bus.registerCommand({ "open-history", "History", "Tools", "Ctrl+H" });
+    bus.registerCommand({ "navigate", {}, "Navigation", {} });
+
+    QVariantList rows = bus.searchCommands("new t");
+    QCOMPARE(rows.size(), 1);
+    QVariantMap top = rows.at(0).toMap();
+    QCOMPARE(top.value("command").toString(), QStringLiteral("new-tab"));
+    QCOMPARE(top.value("group").toString(), QStringLiteral("Tabs"));
+    QCOMPARE(top.value("shortcut").toString(), QStringLiteral("Ctrl+T"));
+
+    // Untitled commands never show up, even for an empty query.
+    rows = bus.searchCommands({});
+    QCOMPARE(rows.size(), 3);
+    for (const QVariant& row : rows) {
+      QVERIFY(row.toMap().value("command").toString() != QStringLiteral("navigate"));
+    }
+
+    // Equal scores: the more used command comes first.
+    QVERIFY(bus.invoke("new-window"));
+    rows = bus.searchCommands("new");
+    QCOMPARE(rows.size(), 2);
+    QCOMPARE(rows.at(0).toMap().value("command").toString(), QStringLiteral("new-window"));
+    QCOMPARE(rows.at(0).toMap().value("invocations").toInt(), 1);
+
+    QCOMPARE(bus.searchCommands("new", 1).size(), 1);
+    QVERIFY(bus.searchCommands("zzz").isEmpty());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestCommandBus)
+#include "TestCommandBus.moc"
@@ -0,0 +1,445 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "BenchmarkSize.h"
+#include "core/ContentBlocker.h"
+#include "core/ContentFilterEngine.h"
+
+using Decision = ContentFilterEngine::Decision;
+using Type = ContentFilterEngine::ResourceType;
+
+class TestContentFilterEngine final : public QObject
+{
+  Q_OBJECT
+
+private:
+  struct Request
+  {
+    Type type = Type::Other;
+    QByteArray sourceHost;
+    QByteArray url;
+  };
+
+  static QString fixturePath(const QString& name)
+  {
+    return QDir(QStringLiteral(XBROWSER_TEST_FIXTURES_DIR)).filePath(QStringLiteral("content_filter/%1").arg(name));
+  }
+
+  static QString readFixture(const QString& name)
+  {
+    QFile f(fixturePath(name));
+    if (!f.open(QIODevice::ReadOnly)) {
+      return {};
+    }
+    return QString::fromUtf8(f.readAll());
+  }
+
+  static QVector<Request> loadCorpus()
+  {
+    QVector<Request> out;
+    QFile f(fixturePath("requests.tsv"));
+    if (!f.open(QIODevice::ReadOnly)) {
+      return out;
+    }
+    while (!f.atEnd()) {
+      const QByteArray line = f.readLine().trimmed();
+      if (line.isEmpty() || line.startsWith('#')) {
+        continue;
+      }
+      const QList<QByteArray> fields = line.split('\t');
+      if (fields.size() != 3) {
+        continue;
+      }
+      Request request;
+      request.type = ContentFilterEngine::resourceTypeFromString(QString::fromUtf8(fields.at(0)));
+      request.sourceHost = fields.at(1);
+      request.url = fields.at(2);
+      out.push_back(request);
+    }
+    return out;
+  }
+
+  static Decision match(const ContentFilterEngine& engine, const Request& request)
+  {
+    return engine.match(std::string_view(request.url.constData(), size_t(request.url.size())),
+                        std::string_view(request.sourceHost.constData(), size_t(request.sourceHost.size())), request.type);
+  }
+
+  static Decision match(const ContentFilterEngine& engine, const char* url, const char* sourceHost, Type type)
+  {
+    return engine.match(std::string_view(url), std::string_view(sourceHost), type);
+  }
+
+  static bool load(ContentFilterEngine* engine, const QString& rules, ContentFilterEngine::CompileStats* stats = nullptr)
+  {
+    return engine->loadBlob(ContentFilterEngine::compile({ rules }, 0, stats));
+  }
+
+  // Deterministic stand-in for a large subscription: mostly host rules, plus
+  // path, option-heavy, exception and untokenizable rules in fixed ratios.
+  static QString syntheticList(int ruleCount, QVector<Request>* expectedBlocks)
+  {
+    static const char* const kWords[] = { "adserve", "pixel",  "metrics", "banner", "promo",  "beacon",
+                                          "trk",     "stat",   "click",   "popunder", "widget", "affiliate" };
+    constexpr int kWordCount = int(sizeof(kWords) / sizeof(kWords[0]));
+
+    QString out;
+    out.reserve(ruleCount * 32);
+    for (int i = 0; i < ruleCount; ++i) {
+      const QString word = QString::fromLatin1(kWords[i % kWordCount]);
+      switch (i % 10) {
+        case 5:
+          out += QStringLiteral("@@||sx%1-%2.com/allowed/^\n").arg(i - 5).arg(QString::fromLatin1(kWords[(i - 5) % kWordCount]));
+          break;
+        case 6:
+          out += QStringLiteral("/%1%2/ads/*\n").arg(word).arg(i);
+          if (i % 50 == 6) {
+            expectedBlocks->push_back(
+              { Type::Script, "cdn.example.org", QStringLiteral("https://cdn.example.org/%1%2/ads/x.js").arg(word).arg(i).toUtf8() });
+          }
+          break;
+        case 7:
+          out += QStringLiteral("||cdn%1.%2.net/*.js$script,domain=site%3.com\n").arg(i).arg(word).arg(i % 500);
+          break;
+        case 8:
+          out += QStringLiteral("*%1_%2*\n").arg(word).arg(i);
+          if (i % 50 == 8) {
+            expectedBlocks->push_back(
+              { Type::Image, "x.example", QStringLiteral("https://x.example/q?a%1_%2b=1").arg(word).arg(i).toUtf8() });
+          }
+          break;
+        case 9:
+          out += QStringLiteral("&%1%2=$image,third-party\n").arg(word).arg(i);
+          break;
+        default:
+          out += QStringLiteral("||sx%1-%2.com^%3\n").arg(i).arg(word).arg(i % 3 == 0 ? QStringLiteral("$third-party") : QString());
+          if (i % 50 == 0) {
+            expectedBlocks->push_back(
+              { Type::Image, "news.example", QStringLiteral("https://sub.sx%1-%2.com/p.gif?i=%1").arg(i).arg(word).toUtf8() });
+          }
+          break;
+      }
+    }
+    return out;
+  }
+
+private slots:
+  void compile_skipsCommentsCosmeticAndUnsupportedRules()
+  {
+    ContentFilterEngine::CompileStats stats;
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine,
+                 "[Adblock Plus 2.0]\n"
+                 "! Title: comments are ignored\n"
+                 "example.org##.ad\n"
+                 "example.org#@#.ad\n"
+                 "||ads.example^\n"
+                 "||ads.example^\n"
+                 "/^https?:\\/\\/ads\\./\n"
+                 "||x.example^$redirect=noop.js\n"
+                 "||y.example^$third-party,first-party\n"
+                 "0.0.0.0 sinkhole.example\n"
+                 "0.0.0.0 localhost\n"
+                 "*\n",
+                 &stats));
+
+    QCOMPARE(stats.rulesCompiled, 2);
+    QCOMPARE(stats.rulesSkipped, 4);
+    QCOMPARE(engine.ruleCount(), 2);
+    QCOMPARE(match(engine, "http://sinkhole.example:8080/x", "a.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://x.example/", "a.example", Type::Script), Decision::NoMatch);
+  }
+
+  void match_honoursAnchorsAndSeparators()
+  {
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine,
+                 "||ads.example.com^\n"
+                 "/banner/*/img^\n"
+                 "|https://exact.example/path|\n"
+                 "||MixedCase.example/Path$match-case\n"));
+
+    QCOMPARE(match(engine, "https://ads.example.com/x.js", "site.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://sub.ads.example.com/x", "site.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://ADS.Example.com/x", "site.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://notads.example.com/", "site.example", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://ads.example.company/", "site.example", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://ads.example.com/", "", Type::Document), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://cdn.example/banner/a/b/img?x=1", "cdn.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.example/banner/a/img", "cdn.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.example/banner/a/img.png", "cdn.example", Type::Image), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://exact.example/path", "a.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://exact.example/path2", "a.example", Type::Script), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://MixedCase.example/Path", "a.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://mixedcase.example/path", "a.example", Type::Script), Decision::NoMatch);
+  }
+
+  void match_appliesPartyTypeAndDomainOptions()
+  {
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine,
+                 "||tracker.example^$third-party\n"
+                 "||cdn.site.example/script.js$script,domain=news.example|~sports.news.example\n"
+                 "||widgets.example^$~image\n"
+                 "||shop.co.uk^$third-party\n"));
+
+    QCOMPARE(match(engine, "https://tracker.example/p", "tracker.example", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://cdn.tracker.example/p", "www.tracker.example", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://tracker.example/p", "other.example", Type::Image), Decision::Block);
+
+    QCOMPARE(match(engine, "https://cdn.site.example/script.js", "news.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.site.example/script.js", "www.news.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.site.example/script.js", "sports.news.example", Type::Script), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://cdn.site.example/script.js", "news.example", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://cdn.site.example/script.js", "other.example", Type::Script), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://widgets.example/w.js", "a.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://widgets.example/w.png", "a.example", Type::Image), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://img.shop.co.uk/a.png", "www.shop.co.uk", Type::Image), Decision::NoMatch);
+    QCOMPARE(match(engine, "https://img.shop.co.uk/a.png", "www.other.co.uk", Type::Image), Decision::Block);
+  }
+
+  void match_exceptionsYieldToImportantRules()
+  {
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine,
+                 "||ads.example^\n"
+                 "@@||ads.example/allowed/\n"
+                 "||important.example^$important\n"
+                 "@@||important.example^\n"
+                 "@@||unused.example^\n"));
+
+    QCOMPARE(match(engine, "https://ads.example/x", "a.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://ads.example/allowed/x", "a.example", Type::Image), Decision::Allow);
+    QCOMPARE(match(engine, "https://important.example/a", "a.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://unused.example/a", "a.example", Type::Script), Decision::NoMatch);
+  }
+
+  void compile_indexesUntokenizableRulesInAutomaton()
+  {
+    ContentFilterEngine::CompileStats stats;
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine,
+                 "*sponsor*\n"
+                 "*-ad-unit*\n"
+                 "||plain.example^\n"
+                 "$script,third-party,domain=only.example\n",
+                 &stats));
+
+    QCOMPARE(stats.tokenIndexed, 2);
+    QCOMPARE(stats.literalIndexed, 1);
+    QCOMPARE(stats.generic, 1);
+
+    QCOMPARE(match(engine, "https://x.example/sponsored.js", "x.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://x.example/SPONSORED.js", "x.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://x.example/page-ad-unit-3", "x.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://x.example/page-ad-units", "x.example", Type::Image), Decision::Block);
+    QCOMPARE(match(engine, "https://x.example/spons", "x.example", Type::Image), Decision::NoMatch);
+
+    QCOMPARE(match(engine, "https://cdn.example/lib.js", "only.example", Type::Script), Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.example/lib.js", "other.example", Type::Script), Decision::NoMatch);
+  }
+
+  void blob_loadsFromMappedFileAndRejectsCorruption()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QByteArray blob = ContentFilterEngine::compile({ QStringLiteral("||ads.example^\n*sponsor*\n") }, 42);
+    const QString path = dir.filePath("filter.bin");
+    {
+      QFile f(path);
+      QVERIFY(f.open(QIODevice::WriteOnly));
+      QCOMPARE(f.write(blob), blob.size());
+    }
+
+    QCOMPARE(ContentFilterEngine::fileSourceStamp(path), quint64(42));
+
+    ContentFilterEngine mapped;
+    QVERIFY(mapped.loadFile(path));
+    QVERIFY(mapped.isMapped());
+    QCOMPARE(mapped.sourceStamp(), quint64(42));
+    QCOMPARE(mapped.blobSize(), qint64(blob.size()));
+    QCOMPARE(match(mapped, "https://ads.example/x", "a.example", Type::Image), Decision::Block);
+
+    ContentFilterEngine engine;
+    QVERIFY(!engine.loadBlob(blob.left(blob.size() - 4)));
+    QVERIFY(!engine.loadBlob(QByteArray("XBCF garbage")));
+
+    QByteArray badMagic = blob;
+    badMagic[0] = 'Y';
+    QVERIFY(!engine.loadBlob(badMagic));
+    QVERIFY(!engine.isLoaded());
+    QCOMPARE(match(engine, "https://ads.example/x", "a.example", Type::Image), Decision::NoMatch);
+  }
+
+  void corpus_excerptDecisions()
+  {
+    const QString excerpt = readFixture("easylist_excerpt.txt");
+    QVERIFY(!excerpt.isEmpty());
+    const QVector<Request> corpus = loadCorpus();
+    QVERIFY(corpus.size() > 500);
+
+    ContentFilterEngine::CompileStats stats;
+    ContentFilterEngine engine;
+    QVERIFY(load(&engine, excerpt, &stats));
+    QCOMPARE(stats.rulesSkipped, 2);
+
+    int counts[3] = {};
+    for (const Request& request : corpus) {
+      ++counts[int(match(engine, request))];
+    }
+    QCOMPARE(counts[int(Decision::NoMatch)], 377);
+    QCOMPARE(counts[int(Decision::Block)], 451);
+    QCOMPARE(counts[int(Decision::Allow)], 25);
+
+    QCOMPARE(match(engine, "https://www.googletagmanager.com/gtag/js?id=G-1", "shop.megamart.example", Type::Script),
+             Decision::Allow);
+    QCOMPARE(match(engine, "https://www.googletagmanager.com/gtag/js?id=G-1", "www.dailynews.example", Type::Script),
+             Decision::Block);
+    QCOMPARE(match(engine, "https://cdn.jsdelivr.net/npm/jquery@3.7.1/dist/jquery.min.js", "forum.techtalk.example",
+                   Type::Script),
+             Decision::Allow);
+    QCOMPARE(match(engine, "wss://ws.hotjar.com/api/v2/client/ws", "www.dailynews.example", Type::WebSocket), Decision::Block);
+    QCOMPARE(match(engine, "https://api.dailynews.example/track/pageview?ref=home", "www.dailynews.example",
+                   Type::XmlHttpRequest),
+             Decision::Block);
+    QCOMPARE(match(engine, "https://media.streamhub.example/track/pageview?ref=home", "video.streamhub.example",
+                   Type::XmlHttpRequest),
+             Decision::NoMatch);
+  }
+
+  void blocker_reusesCompiledBlobUntilListsChange()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    ContentBlocker& blocker = ContentBlocker::instance();
+    blocker.reloadAsync();
+    QVERIFY(blocker.waitForIdle(10000));
+    QVERIFY(!blocker.isReady());
+    QVERIFY(!blocker.shouldBlock("https://ads.example/x", "a.example", Type::Image));
+
+    QVERIFY(QDir().mkpath(ContentBlocker::filterListsDir()));
+    {
+      QFile f(QDir(ContentBlocker::filterListsDir()).filePath("custom.txt"));
+      QVERIFY(f.open(QIODevice::WriteOnly));
+      f.write("||ads.example^\n");
+    }
+
+    QSignalSpy spy(&blocker, &ContentBlocker::rulesReloaded);
+    blocker.reloadAsync();
+    QVERIFY(blocker.waitForIdle(10000));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toInt(), 1);
+    QVERIFY(blocker.lastReloadCompiled());
+    QVERIFY(QFile::exists(ContentBlocker::compiledPath()));
+    QVERIFY(blocker.shouldBlock("https://ads.example/x", "a.example", Type::Image));
+
+    blocker.reloadAsync();
+    QVERIFY(blocker.waitForIdle(10000));
+    QVERIFY(!blocker.lastReloadCompiled());
+    QVERIFY(blocker.shouldBlock("https://ads.example/x", "a.example", Type::Image));
+
+    {
+      QFile f(QDir(ContentBlocker::filterListsDir()).filePath("more.txt"));
+      QVERIFY(f.open(QIODevice::WriteOnly));
+      f.write("||tracker.example^\n");
+    }
+    blocker.reloadAsync();
+    QVERIFY(blocker.waitForIdle(10000));
+    QVERIFY(blocker.lastReloadCompiled());
+    QCOMPARE(blocker.ruleCount(), 2);
+    QVERIFY(blocker.shouldBlock("https://tracker.example/t", "a.example", Type::Script));
+
+    QVERIFY(QFile::remove(QDir(ContentBlocker::filterListsDir()).filePath("custom.txt")));
+    QVERIFY(QFile::remove(QDir(ContentBlocker::filterListsDir()).filePath("more.txt")));
+    blocker.reloadAsync();
+    QVERIFY(blocker.waitForIdle(10000));
+    QVERIFY(!blocker.isReady());
+  }
+
+  void benchmark_syntheticListAgainstCorpus()
+  {
+    const int kSyntheticRules = benchmarkSize(50000, 2000);
+    const int kPasses = benchmarkSize(50, 1);
+
+    const QString excerpt = readFixture("easylist_excerpt.txt");
+    const QVector<Request> corpus = loadCorpus();
+    QVERIFY(!excerpt.isEmpty());
+    QVERIFY(!corpus.isEmpty());
+
+    QVector<Request> expectedBlocks;
+    const QString synthetic = syntheticList(kSyntheticRules, &expectedBlocks);
+
+    QElapsedTimer timer;
+    timer.start();
+    ContentFilterEngine::CompileStats stats;
+    const QByteArray blob = ContentFilterEngine::compile({ synthetic, excerpt }, 1, &stats);
+    const qint64 compileMs = timer.elapsed();
+    QVERIFY(stats.rulesCompiled >= kSyntheticRules);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("filter.bin");
+    {
+      QFile f(path);
+      QVERIFY(f.open(QIODevice::WriteOnly));
+      QCOMPARE(f.write(blob), blob.size());
+    }
+
+    timer.restart();
+    ContentFilterEngine large;
+    QVERIFY(large.loadFile(path));
+    const qint64 loadUs = timer.nsecsElapsed() / 1000;
+
+    // The synthetic rules never target corpus hosts, so a bigger index must
+    // not change any decision the excerpt alone makes.
+    ContentFilterEngine small;
+    QVERIFY(load(&small, excerpt));
+    for (const Request& request : corpus) {
+      QCOMPARE(match(large, request), match(small, request));
+    }
+    for (const Request& request : expectedBlocks) {
+      QCOMPARE(match(large, request), Decision::Block);
+    }
+
+    int blocked = 0;
+    timer.restart();
+    for (int pass = 0; pass < kPasses; ++pass) {
+      for (const Request& request : corpus) {
+        blocked += match(large, request) == Decision::Block ? 1 : 0;
+      }
+    }
+    const qint64 matchNs = timer.nsecsElapsed();
+    QVERIFY(blocked > 0);
+
+    const double nsPerRequest = double(matchNs) / double(kPasses * corpus.size());
+    qInfo().noquote() << QStringLiteral(
+                           "%1 rules (%2 token, %3 literal, %4 generic): compile %5 ms, blob %6 KiB, map+validate %7 us, "
+                           "%8 ns/request over %9 requests")
+                           .arg(stats.rulesCompiled)
+                           .arg(stats.tokenIndexed)
+                           .arg(stats.literalIndexed)
+                           .arg(stats.generic)
+                           .arg(compileMs)
+                           .arg(blob.size() / 1024)
+                           .arg(loadUs)
+                           .arg(nsPerRequest, 0, 'f', 1)
+                           .arg(corpus.size());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestContentFilterEngine)
+
+#include "TestContentFilterEngine.moc"
@@ -0,0 +1,258 @@
+#include <QtTest/QtTest>
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+
+#include "BenchmarkSize.h"
+#include "core/CookieModel.h"
+
+namespace
+{
+CookieSource::Cookie cookie(const QString& name, const QString& domain, const QString& path = QStringLiteral("/"))
+{
+  CookieSource::Cookie c;
+  c.name = name;
+  c.domain = domain;
+  c.path = path;
+  return c;
+}
+
+QVariant roleAt(const CookieModel& model, int row, int role)
+{
+  return model.data(model.index(row), role);
+}
+
+void fillSource(MemoryCookieSource& source)
+{
+  source.setCookies({
+    cookie("sid", "sub.example.com"),
+    cookie("Analytics", ".example.com"),
+    cookie("pref", "example.com", "/app"),
+    cookie("token", "other.org"),
+  });
+}
+}
+
+class TestCookieModel final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void groupsBySiteAndExpandsLazily()
+  {
+    MemoryCookieSource source;
+    fillSource(source);
+    CookieModel model;
+    model.setSource(&source);
+
+    QCOMPARE(model.count(), 4);
+    QCOMPARE(model.siteCount(), 2);
+    QCOMPARE(model.rowCount(), 2);
+    QVERIFY(roleAt(model, 0, CookieModel::IsSiteRole).toBool());
+    QCOMPARE(roleAt(model, 0, CookieModel::SiteRole).toString(), QStringLiteral("example.com"));
+    QCOMPARE(roleAt(model, 0, CookieModel::CookieCountRole).toInt(), 3);
+    QCOMPARE(roleAt(model, 1, CookieModel::SiteRole).toString(), QStringLiteral("other.org"));
+
+    QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+    model.toggleExpanded(0);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(model.rowCount(), 5);
+    QVERIFY(roleAt(model, 0, CookieModel::ExpandedRole).toBool());
+    QCOMPARE(roleAt(model, 1, CookieModel::NameRole).toString(), QStringLiteral("Analytics"));
+    QCOMPARE(roleAt(model, 2, CookieModel::NameRole).toString(), QStringLiteral("pref"));
+    QCOMPARE(roleAt(model, 3, CookieModel::NameRole).toString(), QStringLiteral("sid"));
+    QVERIFY(!roleAt(model, 3, CookieModel::IsSiteRole).toBool());
+    QCOMPARE(roleAt(model, 3, CookieModel::SiteRole).toString(), QStringLiteral("example.com"));
+    QVERIFY(roleAt(model, 4, CookieModel::IsSiteRole).toBool());
+
+    QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+    model.setExpanded(0, false);
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(model.rowCount(), 2);
+  }
+
+  void deltasDoNotReload()
+  {
+    MemoryCookieSource source;
+    fillSource(source);
+    CookieModel model;
+    model.setSource(&source);
+    model.setExpanded(0, true);
+    QCOMPARE(source.requestCount(), 1);
+
+    QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+
+    // A cookie for a new site adds its group row in key order.
+    source.setCookies({cookie("a", "fable.net")});
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(model.rowCount(), 6);
+    QCOMPARE(roleAt(model, 4, CookieModel::SiteRole).toString(), QStringLiteral("fable.net"));
+    QCOMPARE(roleAt(model, 4, CookieModel::CookieCountRole).toInt(), 1);
+
+    // One for an expanded site lands in name order inside it.
+    source.setCookies({cookie("bucket", "www.example.com")});
+    QCOMPARE(model.rowCount(), 7);
+    QCOMPARE(roleAt(model, 0, CookieModel::CookieCountRole).toInt(), 4);
+    QCOMPARE(roleAt(model, 2, CookieModel::NameRole).toString(), QStringLiteral("bucket"));
+
+    // Setting the same cookie again only updates it.
+    CookieSource::Cookie updated = cookie("bucket", "www.example.com");
+    updated.secure = true;
+    source.setCookies({updated});
+    QCOMPARE(model.rowCount(), 7);
+    QVERIFY(roleAt(model, 2, CookieModel::SecureRole).toBool());
+
+    model.deleteAt(2);
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(model.rowCount(), 6);
+    QCOMPARE(roleAt(model, 0, CookieModel::CookieCountRole).toInt(), 3);
+
+    // Deleting a site row takes the whole group with it.
+    model.deleteAt(4);
+    QCOMPARE(model.rowCount(), 5);
+    QCOMPARE(model.count(), 4);
+    QCOMPARE(model.siteCount(), 2);
+
+    // Reloading an unchanged source touches no rows.
+    const int insertsBefore = inserted.count();
+    const int removesBefore = removed.count();
+    model.refresh();
+    QCOMPARE(inserted.count(), insertsBefore);
+    QCOMPARE(removed.count(), removesBefore);
+
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(source.requestCount(), 2);
+
+    // A small batch goes out as one removal per site, expanded or not.
+    const int removesBeforeClear = removed.count();
+    model.clearAll();
+    QCOMPARE(model.count(), 0);
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(removed.count(), removesBeforeClear + 2);
+    QCOMPARE(reset.count(), 0);
+  }
+
+  void filterMatchesNamesAndDomains()
+  {
+    MemoryCookieSource source;
+    fillSource(source);
+    CookieModel model;
+    model.setSource(&source);
+
+    model.setFilterText(QStringLiteral("  OTHER "));
+    QCOMPARE(model.filterText(), QStringLiteral("other"));
+    QCOMPARE(model.siteCount(), 1);
+    QCOMPARE(model.matchCount(), 1);
+    QCOMPARE(roleAt(model, 0, CookieModel::SiteRole).toString(), QStringLiteral("other.org"));
+
+    model.setFilterText(QStringLiteral("sid"));
+    QCOMPARE(model.matchCount(), 1);
+    QCOMPARE(roleAt(model, 0, CookieModel::CookieCountRole).toInt(), 1);
+
+    // Shorter than a trigram falls back to a scan.
+    model.setFilterText(QStringLiteral("e"));
+    QCOMPARE(model.matchCount(), 4);
+
+    model.setFilterText(QStringLiteral("nothing here"));
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(model.count(), 4);
+
+    // Deltas respect the filter.
+    model.setFilterText(QStringLiteral("cart"));
+    source.setCookies({cookie("session", "shop.example"), cookie("cart", "shop.example")});
+    QCOMPARE(model.matchCount(), 1);
+    QCOMPARE(model.rowCount(), 1);
+    model.setExpanded(0, true);
+    QCOMPARE(roleAt(model, 1, CookieModel::NameRole).toString(), QStringLiteral("cart"));
+
+    // A site row deletes only its matching cookies.
+    model.deleteAt(0);
+    QCOMPARE(model.count(), 5);
+    model.setFilterText({});
+    QCOMPARE(model.matchCount(), 5);
+  }
+
+  void urlScopesTheList()
+  {
+    MemoryCookieSource source;
+    fillSource(source);
+    CookieModel model;
+    model.setSource(&source);
+    model.setUrl(QUrl("https://sub.example.com/page"));
+
+    QCOMPARE(source.requestCount(), 2);
+    QCOMPARE(model.count(), 3);
+    QCOMPARE(model.siteCount(), 1);
+
+    // Cookies the page would not receive stay out.
+    source.setCookies({cookie("x", "elsewhere.com"), cookie("y", "example.com")});
+    QCOMPARE(model.count(), 4);
+
+    model.setUrl({});
+    QCOMPARE(model.count(), 6);
+    QCOMPARE(model.siteCount(), 3);
+  }
+
+  void benchmark_largeProfile()
+  {
+    const int kSites = benchmarkSize(5000, 500);
+    const int kDeletes = kSites / 5;
+    constexpr int kPerSite = 10;
+    QVector<CookieSource::Cookie> cookies;
+    cookies.reserve(kSites * kPerSite);
+    for (int i = 0; i < kSites * kPerSite; ++i) {
+      cookies.push_back(cookie(QStringLiteral("cookie_%1").arg(i), QStringLiteral("www.site%1.example").arg(i % kSites)));
+    }
+    MemoryCookieSource source;
+    source.setCookies(cookies);
+
+    QElapsedTimer timer;
+    timer.start();
+    CookieModel model;
+    model.setSource(&source);
+    const qint64 loadMs = timer.elapsed();
+    QCOMPARE(model.count(), kSites * kPerSite);
+    QCOMPARE(model.rowCount(), kSites);
+
+    timer.restart();
+    model.setFilterText(QStringLiteral("site42.exa"));
+    const qint64 filterMs = timer.elapsed();
+    QCOMPARE(model.siteCount(), 1);
+    model.setFilterText({});
+
+    QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+    timer.restart();
+    for (int i = 0; i < kDeletes; ++i) {
+      model.deleteAt(0);
+    }
+    const qint64 deleteMs = timer.elapsed();
+    QCOMPARE(model.rowCount(), kSites - kDeletes);
+    QCOMPARE(reset.count(), 0);
+
+    // Deleting everything left is one batch and one reset, not a row
+    // signal per cookie.
+    QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+    timer.restart();
+    model.clearAll();
+    const qint64 clearMs = timer.elapsed();
+    QCOMPARE(model.count(), 0);
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(reset.count(), 1);
+    QCOMPARE(removed.count(), 0);
+
+    qInfo().noquote() << QStringLiteral("cookie model: %1 cookies over %2 sites loaded in %3 ms, filtered in %4 ms, %5 site deletes in %6 ms, cleared %7 in %8 ms")
+                           .arg(kSites * kPerSite)
+                           .arg(kSites)
+                           .arg(loadMs)
+                           .arg(filterMs)
+                           .arg(kDeletes)
+                           .arg(deleteMs)
+                           .arg((kSites - kDeletes) * kPerSite)
+                           .arg(clearMs);
+  }
+};
+
+QTEST_GUILESS_MAIN(TestCookieModel)
+#include "TestCookieModel.moc"
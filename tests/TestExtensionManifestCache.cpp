@@ -0,0 +1,198 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+#include "core/ExtensionManifestCache.h"
+#include "core/ExtensionsStore.h"
+
+class TestExtensionManifestCache final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static QString fixturePath(const QString& name)
+  {
+    return QDir(QStringLiteral(XBROWSER_TEST_FIXTURES_DIR)).filePath(QStringLiteral("extensions/%1").arg(name));
+  }
+
+  static bool copyTree(const QString& from, const QString& to)
+  {
+    if (!QDir().mkpath(to)) {
+      return false;
+    }
+    const QDir src(from);
+    for (const QFileInfo& info : src.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+      const QString target = QDir(to).filePath(info.fileName());
+      if (info.isDir()) {
+        if (!copyTree(info.filePath(), target)) {
+          return false;
+        }
+      } else if (!QFile::copy(info.filePath(), target)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void rewriteManifest(const QString& installPath, const QByteArray& bytes)
+  {
+    QFile f(ExtensionManifestCache::manifestPath(installPath));
+    QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    f.write(bytes);
+  }
+
+private slots:
+  void init()
+  {
+    ExtensionManifestCache::instance().clear();
+  }
+
+  void parse_readsMetadataAndResolvesIcon()
+  {
+    const QString path = fixturePath("basic-mv3");
+    const ExtensionManifest manifest = ExtensionManifestCache::parse(path);
+
+    QVERIFY(manifest.valid);
+    QVERIFY(manifest.manifestSize > 0);
+    QVERIFY(manifest.manifestMtimeMs > 0);
+    QCOMPARE(manifest.name, QStringLiteral("Basic Fixture"));
+    QCOMPARE(manifest.version, QStringLiteral("1.4.0"));
+    QCOMPARE(manifest.permissions, QStringList({"storage", "tabs"}));
+    QCOMPARE(manifest.hostPermissions, QStringList({"https://example.com/*"}));
+    QCOMPARE(manifest.iconPath, QDir(path).filePath("icons/icon16.png"));
+    QCOMPARE(manifest.popupRelPath, QStringLiteral("popup/index.html"));
+    QCOMPARE(manifest.optionsRelPath, QStringLiteral("options.html"));
+    QCOMPARE(manifest.commands.size(), 1);
+    QCOMPARE(manifest.commands.first().id, QStringLiteral("toggle"));
+    QCOMPARE(manifest.commands.first().shortcut, QStringLiteral("Ctrl+Shift+Y"));
+  }
+
+  void parse_handlesLegacyAndBrokenManifests()
+  {
+    const QString legacyPath = fixturePath("legacy-mv2");
+    const ExtensionManifest legacy = ExtensionManifestCache::parse(legacyPath);
+    QVERIFY(legacy.valid);
+    QCOMPARE(legacy.permissions, QStringList({"storage", "cookies"}));
+    QCOMPARE(legacy.iconPath, QDir(legacyPath).filePath("icon48.png"));
+    QCOMPARE(legacy.popupRelPath, QStringLiteral("/popup.html"));
+    QCOMPARE(legacy.optionsRelPath, QStringLiteral("settings.html"));
+
+    const ExtensionManifest broken = ExtensionManifestCache::parse(fixturePath("broken"));
+    QVERIFY(!broken.valid);
+    QVERIFY(broken.manifestSize > 0);
+
+    const ExtensionManifest missing = ExtensionManifestCache::parse(fixturePath("does-not-exist"));
+    QVERIFY(!missing.valid);
+    QCOMPARE(missing.manifestMtimeMs, 0);
+  }
+
+  void manifestFor_reparsesOnlyWhenManifestChanges()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString installPath = dir.filePath("basic");
+    QVERIFY(copyTree(fixturePath("basic-mv3"), installPath));
+
+    ExtensionManifestCache& cache = ExtensionManifestCache::instance();
+    const int before = cache.parseCount();
+
+    QCOMPARE(cache.manifestFor(installPath).version, QStringLiteral("1.4.0"));
+    QCOMPARE(cache.manifestFor(installPath).version, QStringLiteral("1.4.0"));
+    QCOMPARE(cache.parseCount(), before + 1);
+
+    rewriteManifest(installPath, R"({"manifest_version": 3, "name": "Basic Fixture", "version": "1.5.0"})");
+    QCOMPARE(cache.manifestFor(installPath).version, QStringLiteral("1.5.0"));
+    QCOMPARE(cache.parseCount(), before + 2);
+  }
+
+  void scanAsync_skipsManifestsMatchingStoredStamp()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString unchangedPath = dir.filePath("unchanged");
+    const QString freshPath = dir.filePath("fresh");
+    QVERIFY(copyTree(fixturePath("basic-mv3"), unchangedPath));
+    QVERIFY(copyTree(fixturePath("legacy-mv2"), freshPath));
+
+    qint64 size = -1;
+    qint64 mtimeMs = 0;
+    QVERIFY(ExtensionManifestCache::statManifest(unchangedPath, &size, &mtimeMs));
+
+    ExtensionManifestCache::ScanRequest unchanged;
+    unchanged.installPath = unchangedPath;
+    unchanged.knownSize = size;
+    unchanged.knownMtimeMs = mtimeMs;
+
+    ExtensionManifestCache::ScanRequest fresh;
+    fresh.installPath = freshPath;
+
+    ExtensionManifestCache::ScanRequest missing;
+    missing.installPath = dir.filePath("missing");
+
+    ExtensionManifestCache& cache = ExtensionManifestCache::instance();
+    const int before = cache.parseCount();
+
+    QVector<ExtensionManifestCache::ScanResult> results;
+    cache.scanAsync({unchanged, fresh, missing}, this, [&results](const QVector<ExtensionManifestCache::ScanResult>& r) {
+      results = r;
+    });
+    QVERIFY(cache.waitForIdle(10000));
+
+    QCOMPARE(results.size(), 3);
+    QVERIFY(results.at(0).exists);
+    QVERIFY(!results.at(0).changed);
+    QVERIFY(!results.at(0).parsed);
+
+    QVERIFY(results.at(1).changed);
+    QVERIFY(results.at(1).parsed);
+    QCOMPARE(results.at(1).manifest.name, QStringLiteral("Legacy Fixture"));
+
+    QVERIFY(!results.at(2).exists);
+    QCOMPARE(cache.parseCount(), before + 1);
+
+    results.clear();
+    cache.scanAsync({fresh}, this, [&results](const QVector<ExtensionManifestCache::ScanResult>& r) {
+      results = r;
+    });
+    QVERIFY(cache.waitForIdle(10000));
+    QCOMPARE(results.size(), 1);
+    QVERIFY(!results.at(0).parsed);
+    QCOMPARE(results.at(0).manifest.name, QStringLiteral("Legacy Fixture"));
+    QCOMPARE(cache.parseCount(), before + 1);
+  }
+
+  void extensionsStore_commandsForUsesCache()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const QString installPath = dir.filePath("basic");
+    QVERIFY(copyTree(fixturePath("basic-mv3"), installPath));
+
+    ExtensionsStore& store = ExtensionsStore::instance();
+    store.clearAll();
+    store.setManifestMeta(QStringLiteral("ext"), installPath, QStringLiteral("1.4.0"), QString(), {}, {}, 1, 10);
+    QCOMPARE(store.manifestSizeFor(QStringLiteral("ext")), 10);
+
+    ExtensionManifestCache& cache = ExtensionManifestCache::instance();
+    const int before = cache.parseCount();
+
+    for (int i = 0; i < 3; ++i) {
+      const QVariantList commands = store.commandsFor(QStringLiteral("ext"));
+      QCOMPARE(commands.size(), 1);
+      QCOMPARE(commands.first().toMap().value("commandId").toString(), QStringLiteral("toggle"));
+    }
+    QCOMPARE(cache.parseCount(), before + 1);
+
+    store.reload();
+    QCOMPARE(store.manifestSizeFor(QStringLiteral("ext")), 10);
+  }
+};
+
+QTEST_GUILESS_MAIN(TestExtensionManifestCache)
+
+#include "TestExtensionManifestCache.moc"
@@ -0,0 +1,248 @@
+#include <QtTest/QtTest>
+
+#include <QBuffer>
+#include <QImage>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+#include "core/FaviconCache.h"
+
+namespace
+{
+QByteArray pngOf(const QColor& color, int size)
+{
+  QImage image(size, size, QImage::Format_ARGB32);
+  image.fill(color);
+  QByteArray png;
+  QBuffer buffer(&png);
+  buffer.open(QIODevice::WriteOnly);
+  image.save(&buffer, "PNG");
+  return png;
+}
+}
+
+// Serves one icon at every path (or the one set for that path), answering
+// If-None-Match with 304.
+class IconServer final : public QObject
+{
+  Q_OBJECT
+
+public:
+  IconServer()
+  {
+    connect(&m_server, &QTcpServer::newConnection, this, [this] {
+      while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+          onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+      }
+    });
+    m_server.listen(QHostAddress::LocalHost);
+  }
+
+  QUrl url(const QString& path) const
+  {
+    return QUrl(QStringLiteral("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path));
+  }
+
+  QByteArray payload;
+  QHash<QString, QByteArray> payloads;
+  QByteArray etag;
+  QStringList paths;
+  QStringList ifNoneMatch;
+
+private:
+  void onReadyRead(QTcpSocket* socket)
+  {
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+    const int end = buffer.indexOf("\r\n\r\n");
+    if (end < 0) {
+      return;
+    }
+
+    const QList<QByteArray> lines = buffer.left(end).split('\n');
+    m_buffers.remove(socket);
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    QByteArray condition;
+    for (const QByteArray& line : lines) {
+      const QByteArray trimmed = line.trimmed();
+      if (trimmed.toLower().startsWith("if-none-match:")) {
+        condition = trimmed.mid(14).trimmed();
+      }
+    }
+    const QString path = QString::fromLatin1(requestLine.value(1));
+    paths.push_back(path);
+    ifNoneMatch.push_back(QString::fromLatin1(condition));
+    const QByteArray body = payloads.value(path, payload);
+
+    QByteArray response;
+    if (!condition.isEmpty() && condition == etag) {
+      response = "HTTP/1.1 304 Not Modified\r\nETag: " + etag + "\r\nConnection: close\r\n\r\n";
+    } else {
+      response = "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nETag: " + etag + "\r\nContent-Length: "
+                 + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    }
+    socket->write(response);
+    socket->disconnectFromHost();
+  }
+
+  QTcpServer m_server;
+  QHash<QTcpSocket*, QByteArray> m_buffers;
+};
+
+class TestFaviconCache final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void setPageIcon_fetchesDeclaredIconOnceForEverySize()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    IconServer server;
+    server.payload = pngOf(Qt::red, 64);
+    server.etag = "\"a\"";
+
+    FaviconCache cache;
+    QSignalSpy available(&cache, &FaviconCache::faviconAvailable);
+    const QUrl page = server.url(QStringLiteral("/page"));
+    cache.setPageIcon(page, server.url(QStringLiteral("/static/icon.png")));
+
+    QTRY_COMPARE(available.count(), 2);
+    QCOMPARE(server.paths, QStringList{QStringLiteral("/static/icon.png")});
+
+    const QUrl small = cache.faviconUrlFor(page, 16);
+    QVERIFY(small.isLocalFile());
+    const QImage image(small.toLocalFile());
+    QCOMPARE(image.size(), QSize(16, 16));
+    QCOMPARE(image.pixelColor(8, 8), QColor(Qt::red));
+
+    // Fresh icons are not asked for again.
+    cache.setPageIcon(page, server.url(QStringLiteral("/static/icon.png")));
+    QTest::qWait(100);
+    QCOMPARE(server.paths.size(), 1);
+  }
+
+  void setPageIcon_revalidatesWithValidators()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    IconServer server;
+    server.payload = pngOf(Qt::red, 32);
+    server.etag = "\"a\"";
+    const QUrl page = server.url(QStringLiteral("/"));
+    const QUrl icon = server.url(QStringLiteral("/icon.png"));
+
+    {
+      FaviconCache cache;
+      QSignalSpy available(&cache, &FaviconCache::faviconAvailable);
+      cache.setPageIcon(page, icon);
+      QTRY_COMPARE(available.count(), 2);
+    }
+
+    // A later run remembers the validators; an unchanged icon costs a 304.
+    FaviconCache cache;
+    cache.setRevalidateAfterMs(0);
+    QSignalSpy available(&cache, &FaviconCache::faviconAvailable);
+    const QUrl before = cache.faviconUrlFor(page, 32);
+    QVERIFY(!before.isEmpty());
+    cache.setPageIcon(page, icon);
+    QTRY_COMPARE(server.paths.size(), 2);
+    QCOMPARE(server.ifNoneMatch.at(1), QStringLiteral("\"a\""));
+    QTest::qWait(100);
+    QCOMPARE(available.count(), 0);
+
+    // A changed icon is decoded again and gets a new URL.
+    server.payload = pngOf(Qt::blue, 32);
+    server.etag = "\"b\"";
+    cache.setPageIcon(page, icon);
+    QTRY_COMPARE(available.count(), 2);
+    const QUrl after = cache.faviconUrlFor(page, 32);
+    QVERIFY(after != before);
+    QCOMPARE(QImage(after.toLocalFile()).pixelColor(4, 4), QColor(Qt::blue));
+  }
+
+  void faviconUrlFor_fallsBackToOriginFavicon()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    IconServer server;
+    server.payload = pngOf(Qt::green, 48);
+    server.etag = "\"g\"";
+
+    FaviconCache cache;
+    QSignalSpy available(&cache, &FaviconCache::faviconAvailable);
+    const QUrl page = server.url(QStringLiteral("/some/page?q=1"));
+    QVERIFY(cache.faviconUrlFor(page, 32).isEmpty());
+    QTRY_VERIFY(available.count() >= 1);
+    QCOMPARE(server.paths, QStringList{QStringLiteral("/favicon.ico")});
+    QVERIFY(!cache.faviconUrlFor(page, 32).isEmpty());
+  }
+
+  void setPageIcon_keepsSubdomainIconsApart()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    IconServer server;
+    server.payloads.insert(QStringLiteral("/mail.png"), pngOf(Qt::red, 16));
+    server.payloads.insert(QStringLiteral("/docs.png"), pngOf(Qt::blue, 16));
+    server.payloads.insert(QStringLiteral("/home.png"), pngOf(Qt::green, 16));
+    server.etag = "\"s\"";
+
+    // Only the icon URLs are fetched, so the page hosts need not resolve.
+    const QUrl mail(QStringLiteral("https://mail.example.test/inbox"));
+    const QUrl docs(QStringLiteral("https://docs.example.test/"));
+    const QUrl home(QStringLiteral("https://example.test/"));
+
+    FaviconCache cache;
+    QSignalSpy available(&cache, &FaviconCache::faviconAvailable);
+    cache.setPageIcon(mail, server.url(QStringLiteral("/mail.png")));
+    cache.setPageIcon(docs, server.url(QStringLiteral("/docs.png")));
+    QTRY_COMPARE(available.count(), 4);
+
+    const auto colorOf = [&cache](const QUrl& page) {
+      const QUrl icon = cache.faviconUrlFor(page, 16);
+      return icon.isLocalFile() ? QImage(icon.toLocalFile()).pixelColor(8, 8) : QColor();
+    };
+    QCOMPARE(colorOf(mail), QColor(Qt::red));
+    QCOMPARE(colorOf(docs), QColor(Qt::blue));
+
+    // Neither declaration replaces the other's icon.
+    cache.setPageIcon(mail, server.url(QStringLiteral("/mail.png")));
+    cache.setPageIcon(docs, server.url(QStringLiteral("/docs.png")));
+    QTest::qWait(100);
+    QCOMPARE(server.paths.size(), 2);
+    QCOMPARE(colorOf(mail), QColor(Qt::red));
+
+    // A subdomain with no icon of its own borrows the site's.
+    const QUrl news(QStringLiteral("https://news.example.test/"));
+    QVERIFY(cache.faviconUrlFor(news, 16).isEmpty());
+    cache.setPageIcon(home, server.url(QStringLiteral("/home.png")));
+    QTRY_VERIFY(cache.faviconUrlFor(home, 16).isLocalFile());
+    QCOMPARE(colorOf(news), QColor(Qt::green));
+    QCOMPARE(colorOf(mail), QColor(Qt::red));
+  }
+
+  void renderSizes_scalesAndRejectsGarbage()
+  {
+    const QHash<int, QByteArray> rendered = FaviconCache::renderSizes(pngOf(Qt::red, 128), {16, 32});
+    QCOMPARE(rendered.size(), 2);
+    QCOMPARE(QImage::fromData(rendered.value(32)).size(), QSize(32, 32));
+    QVERIFY(FaviconCache::renderSizes("not an image", {16}).isEmpty());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestFaviconCache)
+#include "TestFaviconCache.moc"
@@ -0,0 +1,105 @@
+#include <QtTest/QtTest>
+
+#include "core/BrowserController.h"
+
+class TestGlobalTabIndex final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void search_findsTabsInEveryWorkspace()
+  {
+    BrowserController browser;
+    GlobalTabIndex* index = browser.tabIndex();
+    WorkspaceModel* workspaces = browser.workspaces();
+    TabModel* tabs = browser.tabs();
+
+    const int news = browser.newTab(QUrl("https://news.example.com/"));
+    tabs->setTitleAt(news, QStringLiteral("Morning News"));
+
+    const int work = workspaces->addWorkspace(QStringLiteral("Work"));
+    TabModel* workTabs = workspaces->tabsForIndex(work);
+    const int spec = workTabs->addTab(QUrl("https://docs.example.org/spec"));
+    workTabs->setTitleAt(spec, QStringLiteral("Project Spec"));
+    QCOMPARE(index->count(), 2);
+
+    QVariantList hits = index->search(QStringLiteral("SPEC docs"), 8);
+    QCOMPARE(hits.size(), 1);
+    QVariantMap hit = hits.first().toMap();
+    QCOMPARE(hit.value("workspaceId").toInt(), workspaces->workspaceIdAt(work));
+    QCOMPARE(hit.value("workspaceIndex").toInt(), work);
+    QCOMPARE(hit.value("workspaceName").toString(), QStringLiteral("Work"));
+    QCOMPARE(hit.value("tabId").toInt(), workTabs->tabIdAt(spec));
+    QCOMPARE(hit.value("title").toString(), QStringLiteral("Project Spec"));
+
+    QCOMPARE(index->search(QStringLiteral("example"), 8).size(), 2);
+    QCOMPARE(index->search(QStringLiteral("example"), 1).size(), 1);
+
+    // Titles and URLs follow the tabs.
+    workTabs->setUrlAt(spec, QUrl("https://wiki.example.org/"));
+    QVERIFY(index->search(QStringLiteral("docs"), 8).isEmpty());
+    QCOMPARE(index->search(QStringLiteral("wiki"), 8).size(), 1);
+    tabs->setCustomTitleAt(news, QStringLiteral("Headlines"));
+    hits = index->search(QStringLiteral("head"), 8);
+    QCOMPARE(hits.size(), 1);
+    QCOMPARE(hits.first().toMap().value("matchStart").toInt(), 0);
+
+    // Closing a workspace moves its tabs into another one.
+    workspaces->closeWorkspace(work);
+    QCOMPARE(index->count(), 2);
+    hit = index->search(QStringLiteral("wiki"), 8).value(0).toMap();
+    QCOMPARE(hit.value("workspaceId").toInt(), workspaces->workspaceIdAt(0));
+
+    tabs->closeTab(tabs->indexOfTabId(hit.value("tabId").toInt()));
+    QCOMPARE(index->count(), 1);
+    QVERIFY(index->search(QStringLiteral("wiki"), 8).isEmpty());
+  }
+
+  void recentTabs_switchAcrossWorkspaces()
+  {
+    BrowserController browser;
+    GlobalTabIndex* index = browser.tabIndex();
+    WorkspaceModel* workspaces = browser.workspaces();
+    TabModel* tabs = browser.tabs();
+
+    const int a = browser.newTab(QUrl("https://a.example"));
+    const int b = browser.newTab(QUrl("https://b.example"));
+    const int tabA = tabs->tabIdAt(a);
+    const int tabB = tabs->tabIdAt(b);
+
+    const int work = workspaces->addWorkspace(QStringLiteral("Work"));
+    TabModel* workTabs = workspaces->tabsForIndex(work);
+    const int tabC = workTabs->tabIdAt(workTabs->addTab(QUrl("https://c.example")));
+    workspaces->setActiveIndex(work);
+
+    const auto recentIds = [index] {
+      QList<int> ids;
+      for (const QVariant& row : index->recentTabs(10)) {
+        ids.push_back(row.toMap().value("tabId").toInt());
+      }
+      return ids;
+    };
+    QCOMPARE(recentIds(), (QList<int>{tabC, tabB, tabA}));
+
+    QVERIFY(browser.activateRecentTab());
+    QCOMPARE(workspaces->activeIndex(), 0);
+    QCOMPARE(tabs->activeIndex(), b);
+    QCOMPARE(recentIds(), (QList<int>{tabB, tabC, tabA}));
+
+    // Switching back and forth toggles between the last two.
+    QVERIFY(browser.activateRecentTab());
+    QCOMPARE(workspaces->activeIndex(), work);
+    QCOMPARE(recentIds(), (QList<int>{tabC, tabB, tabA}));
+
+    QVERIFY(browser.activateRecentTab(2));
+    QCOMPARE(workspaces->activeIndex(), 0);
+    QCOMPARE(tabs->activeIndex(), a);
+    QCOMPARE(recentIds(), (QList<int>{tabA, tabC, tabB}));
+
+    QVERIFY(!browser.activateRecentTab(5));
+    QVERIFY(index->recentAt(5).isEmpty());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestGlobalTabIndex)
+#include "TestGlobalTabIndex.moc"
@@ -0,0 +1,194 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+
+#include "core/HistoryImporter.h"
+#include "core/HistoryStore.h"
+
+namespace
+{
+constexpr qint64 kChromiumEpochOffsetUs = 11644473600000000LL;
+
+bool writeDatabase(const QString& path, const QStringList& statements)
+{
+  bool ok = true;
+  {
+    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("fixture"));
+    db.setDatabaseName(path);
+    ok = db.open();
+    QSqlQuery query(db);
+    for (const QString& statement : statements) {
+      ok = ok && query.exec(statement);
+    }
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(QStringLiteral("fixture"));
+  return ok;
+}
+
+QString chromiumHistory(const QString& dir)
+{
+  const QString path = QDir(dir).filePath(QStringLiteral("History"));
+  const auto visit = [](int id, int url, qint64 unixMs) {
+    return QStringLiteral("INSERT INTO visits (id, url, visit_time) VALUES (%1, %2, %3)")
+      .arg(id)
+      .arg(url)
+      .arg(unixMs * 1000 + kChromiumEpochOffsetUs);
+  };
+  const bool ok = writeDatabase(path,
+                                {
+                                  "CREATE TABLE urls (id INTEGER PRIMARY KEY, url LONGVARCHAR, title LONGVARCHAR)",
+                                  "CREATE TABLE visits (id INTEGER PRIMARY KEY, url INTEGER NOT NULL, visit_time INTEGER NOT NULL)",
+                                  "INSERT INTO urls VALUES (1, 'https://one.example/', 'One')",
+                                  "INSERT INTO urls VALUES (2, 'https://two.example/', 'Two')",
+                                  "INSERT INTO urls VALUES (3, 'chrome://settings/', 'Settings')",
+                                  visit(1, 2, 1700000002000),
+                                  visit(2, 1, 1700000001000),
+                                  visit(3, 3, 1700000003000),
+                                  visit(4, 1, 1700000004000),
+                                });
+  return ok ? path : QString();
+}
+
+QString firefoxPlaces(const QString& dir)
+{
+  const QString path = QDir(dir).filePath(QStringLiteral("places.sqlite"));
+  const bool ok = writeDatabase(path,
+                                {
+                                  "CREATE TABLE moz_places (id INTEGER PRIMARY KEY, url LONGVARCHAR, title LONGVARCHAR)",
+                                  "CREATE TABLE moz_historyvisits (id INTEGER PRIMARY KEY, place_id INTEGER, visit_date INTEGER)",
+                                  "INSERT INTO moz_places VALUES (1, 'https://fox.example/', 'Fox')",
+                                  "INSERT INTO moz_places VALUES (2, 'place:sort=8', NULL)",
+                                  "INSERT INTO moz_historyvisits VALUES (1, 1, 1700000005000000)",
+                                  "INSERT INTO moz_historyvisits VALUES (2, 2, 1700000006000000)",
+                                  "INSERT INTO moz_historyvisits VALUES (3, 1, 1700000007000000)",
+                                });
+  return ok ? path : QString();
+}
+}
+
+class TestHistoryImporter final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase()
+  {
+    if (!QSqlDatabase::isDriverAvailable(QStringLiteral("QSQLITE"))) {
+      QSKIP("QSQLITE driver not available");
+    }
+  }
+
+  void readVisits_chromium()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = chromiumHistory(dir.path());
+    QVERIFY(!path.isEmpty());
+
+    QVector<QVector<HistoryStore::VisitRecord>> chunks;
+    QString error;
+    QVERIFY(HistoryImporter::readVisits(
+      path,
+      2,
+      [&](QVector<HistoryStore::VisitRecord> chunk) {
+        chunks.push_back(std::move(chunk));
+        return true;
+      },
+      &error));
+    QVERIFY2(error.isEmpty(), qPrintable(error));
+
+    // chrome:// pages are dropped; the rest arrive in time order.
+    QCOMPARE(chunks.size(), 2);
+    QCOMPARE(chunks.at(0).size(), 2);
+    QCOMPARE(chunks.at(1).size(), 1);
+    QCOMPARE(chunks.at(0).at(0).url, QUrl("https://one.example/"));
+    QCOMPARE(chunks.at(0).at(0).visitedMs, qint64(1700000001000));
+    QCOMPARE(chunks.at(0).at(1).title, QStringLiteral("Two"));
+    QCOMPARE(chunks.at(1).at(0).visitedMs, qint64(1700000004000));
+  }
+
+  void readVisits_firefoxStopsWhenAsked()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = firefoxPlaces(dir.path());
+    QVERIFY(!path.isEmpty());
+
+    int calls = 0;
+    QVector<HistoryStore::VisitRecord> first;
+    QVERIFY(HistoryImporter::readVisits(path, 1, [&](QVector<HistoryStore::VisitRecord> chunk) {
+      if (++calls == 1) {
+        first = chunk;
+      }
+      return false;
+    }));
+    QCOMPARE(calls, 1);
+    QCOMPARE(first.size(), 1);
+    QCOMPARE(first.at(0).url, QUrl("https://fox.example/"));
+    QCOMPARE(first.at(0).visitedMs, qint64(1700000005000));
+  }
+
+  void readVisits_rejectsOtherFiles()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("other.sqlite");
+    QVERIFY(writeDatabase(path, {"CREATE TABLE notes (id INTEGER PRIMARY KEY, body TEXT)"}));
+
+    const auto sink = [](QVector<HistoryStore::VisitRecord>) {
+      return true;
+    };
+    QString error;
+    QVERIFY(!HistoryImporter::readVisits(path, 10, sink, &error));
+    QVERIFY(!error.isEmpty());
+
+    error.clear();
+    QVERIFY(!HistoryImporter::readVisits(dir.filePath("missing"), 10, sink, &error));
+    QVERIFY(!error.isEmpty());
+  }
+
+  void importFile_addsVisitsToHistory()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+    const QString chromium = chromiumHistory(dir.path());
+    const QString firefox = firefoxPlaces(dir.path());
+    QVERIFY(!chromium.isEmpty());
+    QVERIFY(!firefox.isEmpty());
+
+    HistoryStore history;
+    HistoryImporter importer;
+    importer.setHistory(&history);
+    QSignalSpy finished(&importer, &HistoryImporter::finished);
+
+    QVERIFY(importer.importFile(chromium));
+    QVERIFY(importer.running());
+    QVERIFY(!importer.importFile(firefox));
+    QVERIFY(finished.wait(10000));
+    QVERIFY(!importer.running());
+    QCOMPARE(finished.at(0).at(0).toInt(), 3);
+    QVERIFY(finished.at(0).at(1).toString().isEmpty());
+    QCOMPARE(history.count(), 3);
+    QCOMPARE(history.pageCount(), 2);
+
+    QVERIFY(importer.importFile(firefox));
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.at(1).at(0).toInt(), 2);
+    QCOMPARE(history.count(), 5);
+
+    // Running the same import again finds nothing new.
+    QVERIFY(importer.importFile(chromium));
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.at(2).at(0).toInt(), 0);
+    QCOMPARE(history.count(), 5);
+  }
+};
+
+QTEST_GUILESS_MAIN(TestHistoryImporter)
+#include "TestHistoryImporter.moc"
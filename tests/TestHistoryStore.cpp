@@ -1,15 +1,50 @@
 #include <QtTest/QtTest>
 
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QSignalSpy>
 #include <QTemporaryDir>
+#include <QtEndian>
 
+#include "BenchmarkSize.h"
 #include "core/HistoryFilterModel.h"
+#include "core/HistorySnapshot.h"
 #include "core/HistoryStore.h"
 
+#if defined(Q_OS_WIN)
+#include <Windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
 class TestHistoryStore final : public QObject
 {
   Q_OBJECT
 
+private:
+  // Private bytes on Windows, resident set elsewhere; -1 when unknown.
+  static qint64 processMemoryBytes()
+  {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return -1;
+    }
+    return static_cast<qint64>(counters.PagefileUsage);
+#elif defined(Q_OS_LINUX)
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+      return -1;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : -1;
+#else
+    return -1;
+#endif
+  }
+
 private slots:
   void visits_roundTrip()
   {
@@ -185,6 +220,459 @@ private slots:
       QCOMPARE(store.index(0, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("Other"));
     }
   }
+
+  void deleteByDomain_coversRegistrableDomain()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore store;
+    store.addVisit(QUrl("https://mail.example.co.uk/inbox"), "Mail", 1000);
+    store.addVisit(QUrl("https://www.example.co.uk/"), "Home", 2000);
+    store.addVisit(QUrl("https://other.co.uk/"), "Other", 3000);
+    store.addVisit(QUrl("https://alice.github.io/"), "Alice", 4000);
+    store.addVisit(QUrl("https://bob.github.io/"), "Bob", 5000);
+
+    QCOMPARE(store.query("mail.example.co.uk", 0, 0, 0).size(), 1);
+
+    QCOMPARE(store.deleteByDomain("MAIL.example.co.uk"), 2);
+    QCOMPARE(store.deleteByDomain("https://alice.github.io/blog"), 1);
+    QCOMPARE(store.count(), 2);
+
+    const QVariantList remaining = store.query(QString(), 0, 0, 0);
+    QCOMPARE(remaining.at(0).toMap().value("title").toString(), QStringLiteral("Bob"));
+    QCOMPARE(remaining.at(1).toMap().value("title").toString(), QStringLiteral("Other"));
+  }
+
+  void pages_sharedAcrossVisits()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    {
+      HistoryStore store;
+      store.addVisit(QUrl("https://one.example/path"), "One", 10000);
+      store.addVisit(QUrl("https://two.example/path"), "Two", 20000);
+      store.addVisit(QUrl("https://one.example/path"), QString(), 30000);
+      QCOMPARE(store.count(), 3);
+      QCOMPARE(store.pageCount(), 2);
+
+      // A visit without a title keeps the page's last known title.
+      QCOMPARE(store.index(2, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("One"));
+
+      QSignalSpy changed(&store, &QAbstractItemModel::dataChanged);
+      store.addVisit(QUrl("https://one.example/path"), "One renamed", 40000);
+      QCOMPARE(store.count(), 4);
+      // Only the page's own rows change, not the other page's row between.
+      QCOMPARE(changed.count(), 2);
+      QCOMPARE(changed.at(0).at(0).toModelIndex().row(), 2);
+      QCOMPARE(changed.at(0).at(1).toModelIndex().row(), 2);
+      QCOMPARE(changed.at(1).at(0).toModelIndex().row(), 0);
+      QCOMPARE(changed.at(1).at(1).toModelIndex().row(), 0);
+
+      QCOMPARE(store.index(0, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("One renamed"));
+      QCOMPARE(store.index(0, 0).data(HistoryStore::UrlRole).toUrl(), QUrl("https://one.example/path"));
+      QCOMPARE(store.index(0, 0).data(HistoryStore::VisitedMsRole).toLongLong(), qint64(10000));
+
+      // Adjacent rows of a page go out as one range; the merged visit's
+      // time change follows.
+      changed.clear();
+      store.addVisit(QUrl("https://one.example/path"), "One again", 45000);
+      QCOMPARE(store.count(), 4);
+      QCOMPARE(changed.count(), 3);
+      QCOMPARE(changed.at(0).at(0).toModelIndex().row(), 2);
+      QCOMPARE(changed.at(0).at(1).toModelIndex().row(), 3);
+      QCOMPARE(changed.at(1).at(0).toModelIndex().row(), 0);
+      QCOMPARE(changed.at(1).at(1).toModelIndex().row(), 0);
+
+      QString error;
+      QVERIFY(store.saveNow(&error));
+    }
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.count(), 4);
+      QCOMPARE(store.pageCount(), 2);
+      QCOMPARE(store.query("one.example", 0, 0, 0).size(), 3);
+
+      store.removeAt(1);
+      QCOMPARE(store.pageCount(), 1);
+      QCOMPARE(store.deleteByDomain("one.example"), 3);
+      QCOMPARE(store.pageCount(), 0);
+
+      // Freed page slots are reused.
+      store.addVisit(QUrl("https://three.example/"), "Three", 50000);
+      QCOMPARE(store.pageCount(), 1);
+      QCOMPARE(store.index(0, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("Three"));
+    }
+  }
+
+  void addVisits_batchesAndSkipsDuplicates()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore store;
+    store.addVisit(QUrl("https://one.example/"), "One", 20000);
+
+    QSignalSpy inserted(&store, &QAbstractItemModel::rowsInserted);
+    QSignalSpy counted(&store, &HistoryStore::countChanged);
+    QSignalSpy changed(&store, &QAbstractItemModel::dataChanged);
+    const QVector<HistoryStore::VisitRecord> batch = {
+      {QUrl("https://two.example/"), "Two", 30000},
+      {QUrl("https://one.example/"), "One renamed", 40000},
+      {QUrl("https://one.example/"), "One", 20000},
+      {QUrl("https://two.example/"), "Two", 30000},
+      {QUrl("https://three.example/"), "Three", 10000},
+      {QUrl("https://undated.example/"), "Undated", 0},
+      {QUrl("not a url"), "Broken", 50000},
+    };
+    QCOMPARE(store.addVisits(batch), 3);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(counted.count(), 1);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(store.count(), 4);
+    QCOMPARE(store.pageCount(), 3);
+
+    // Appended in time order after what was already there.
+    QCOMPARE(store.index(1, 0).data(HistoryStore::UrlRole).toUrl(), QUrl("https://three.example/"));
+    QCOMPARE(store.index(3, 0).data(HistoryStore::VisitedMsRole).toLongLong(), qint64(40000));
+    QCOMPARE(store.index(0, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("One renamed"));
+
+    // Importing the same history again adds nothing.
+    QCOMPARE(store.addVisits(batch), 0);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(store.count(), 4);
+
+    QString error;
+    QVERIFY(store.saveNow(&error));
+    HistoryStore reloaded;
+    QCOMPARE(reloaded.count(), 4);
+    QCOMPARE(reloaded.query("two.example", 0, 0, 0).size(), 1);
+  }
+
+  void retention_collapsesAndPrunesAgedVisits()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    constexpr qint64 kHourMs = 60 * 60 * 1000;
+    constexpr qint64 kDayMs = 24 * kHourMs;
+    const qint64 now = QDateTime(QDate(2026, 6, 15), QTime(12, 0)).toMSecsSinceEpoch();
+    const qint64 aged = now - 200 * kDayMs;
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.detailDays(), HistoryStore::kDefaultDetailDays);
+      QCOMPARE(store.retentionDays(), HistoryStore::kDefaultRetentionDays);
+
+      store.addVisit(QUrl("https://three.example/"), "Three", now - 800 * kDayMs);
+      store.addVisit(QUrl("https://one.example/"), "One", aged - kDayMs);
+      store.addVisit(QUrl("https://one.example/"), "One", aged + kHourMs);
+      store.addVisit(QUrl("https://two.example/"), "Two", aged + kHourMs + kHourMs / 2);
+      store.addVisit(QUrl("https://one.example/"), "One", aged + 2 * kHourMs);
+      store.addVisit(QUrl("https://one.example/"), "One today", aged + 3 * kHourMs);
+      store.addVisit(QUrl("https://one.example/"), "One", now - kDayMs);
+      QCOMPARE(store.count(), 7);
+
+      QSignalSpy reset(&store, &QAbstractItemModel::modelReset);
+      QCOMPARE(store.applyRetention(now), 3);
+      QCOMPARE(reset.count(), 1);
+      QCOMPARE(store.count(), 4);
+      QCOMPARE(store.pageCount(), 2);
+
+      const QModelIndex collapsed = store.index(1, 0);
+      QCOMPARE(collapsed.data(HistoryStore::VisitCountRole).toInt(), 3);
+      QCOMPARE(collapsed.data(HistoryStore::FirstVisitedMsRole).toLongLong(), aged + kHourMs);
+      QCOMPARE(collapsed.data(HistoryStore::VisitedMsRole).toLongLong(), aged + 3 * kHourMs);
+      QCOMPARE(collapsed.data(HistoryStore::DayKeyRole).toString(), QDateTime::fromMSecsSinceEpoch(aged).date().toString(Qt::ISODate));
+      QCOMPARE(store.index(0, 0).data(HistoryStore::VisitCountRole).toInt(), 1);
+      QCOMPARE(store.index(3, 0).data(HistoryStore::VisitCountRole).toInt(), 1);
+      QCOMPARE(store.query("one.example", 0, 0, 0).at(1).toMap().value("visitCount").toInt(), 3);
+
+      QCOMPARE(store.applyRetention(now), 0);
+
+      QString error;
+      QVERIFY(store.saveNow(&error));
+    }
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.count(), 4);
+      QCOMPARE(store.index(1, 0).data(HistoryStore::VisitCountRole).toInt(), 3);
+      QCOMPARE(store.index(1, 0).data(HistoryStore::FirstVisitedMsRole).toLongLong(), aged + kHourMs);
+
+      // Re-importing visits a collapsed row already covers adds nothing.
+      const QVector<HistoryStore::VisitRecord> again = {
+        {QUrl("https://one.example/"), "One", aged + kHourMs},
+        {QUrl("https://one.example/"), "One", aged + 2 * kHourMs},
+      };
+      QCOMPARE(store.addVisits(again), 0);
+
+      // Clearing part of a collapsed row's span removes the whole row.
+      store.clearRange(aged + 2 * kHourMs, aged + 2 * kHourMs + 1);
+      QCOMPARE(store.count(), 3);
+      QCOMPARE(store.index(1, 0).data(HistoryStore::UrlRole).toUrl(), QUrl("https://two.example/"));
+
+      store.setDetailDays(0);
+      store.setRetentionDays(0);
+      store.addVisit(QUrl("https://four.example/"), "Four", now - 5000 * kDayMs);
+      QCOMPARE(store.applyRetention(now), 0);
+      QCOMPARE(store.count(), 4);
+    }
+  }
+
+  void snapshot_roundTripsAndReplacesJson()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    {
+      QFile legacy(QDir(dir.path()).filePath("history.json"));
+      QVERIFY(legacy.open(QIODevice::WriteOnly));
+      legacy.write(R"({"version":1,"nextId":9,"history":[
+        {"id":3,"title":"One","url":"https://one.example/a%20b","visitedMs":1000},
+        {"id":5,"title":"Two","url":"https://two.example/","visitedMs":2000},
+        {"id":7,"title":"One again","url":"https://one.example/a%20b","visitedMs":3000}]})");
+    }
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.count(), 3);
+      QCOMPARE(store.pageCount(), 2);
+      QCOMPARE(store.index(0, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("One again"));
+
+      QString error;
+      QVERIFY(store.saveNow(&error));
+      QVERIFY(QFile::exists(QDir(dir.path()).filePath("history.bin")));
+      QVERIFY(!QFile::exists(QDir(dir.path()).filePath("history.json")));
+    }
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.count(), 3);
+      QCOMPARE(store.pageCount(), 2);
+      QCOMPARE(store.index(1, 0).data(HistoryStore::HistoryIdRole).toInt(), 5);
+      QCOMPARE(store.index(1, 0).data(HistoryStore::VisitedMsRole).toLongLong(), qint64(2000));
+      QCOMPARE(store.index(2, 0).data(HistoryStore::UrlRole).toUrl(), QUrl("https://one.example/a%20b"));
+      QCOMPARE(store.index(2, 0).data(HistoryStore::TitleRole).toString(), QStringLiteral("One again"));
+
+      // Saving while the loaded snapshot is still mapped replaces the file.
+      store.addVisit(QUrl("https://three.example/"), "Three", 4000);
+      QString error;
+      QVERIFY(store.saveNow(&error));
+      QCOMPARE(error, QString());
+
+      const QVariantList rows = store.query(QString(), 0, 0, 0);
+      QCOMPARE(rows.size(), 4);
+      QCOMPARE(rows.at(0).toMap().value("id").toInt(), 9);
+      QCOMPARE(rows.at(3).toMap().value("title").toString(), QStringLiteral("One again"));
+    }
+
+    {
+      HistoryStore store;
+      QCOMPARE(store.count(), 4);
+      QCOMPARE(store.pageCount(), 3);
+
+      const QString exported = QDir(dir.path()).filePath("export.json");
+      QVERIFY(store.exportToJson(exported));
+      QFile file(exported);
+      QVERIFY(file.open(QIODevice::ReadOnly));
+      const QByteArray json = file.readAll();
+      QVERIFY(json.contains("https://three.example/"));
+      QVERIFY(json.contains("\"nextId\": 10"));
+    }
+  }
+
+  void snapshot_rejectsCorruptData()
+  {
+    HistorySnapshot::Builder builder;
+    const int page = builder.addPage(u"https://one.example/", u"One", 1000);
+    builder.addVisit(1, page, 1000);
+    const QByteArray valid = builder.finish(2);
+
+    HistorySnapshot snapshot;
+    QVERIFY(snapshot.openData(valid));
+    QCOMPARE(snapshot.visitCount(), 1);
+    QCOMPARE(snapshot.pageKey(0).toString(), QStringLiteral("https://one.example/"));
+    QCOMPARE(snapshot.pageTitle(0).toString(), QStringLiteral("One"));
+
+    QString error;
+    QVERIFY(!snapshot.openData(valid.left(valid.size() - 2), &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!snapshot.isOpen());
+
+    QByteArray badPage = valid;
+    qToUnaligned<qint32>(5, badPage.data() + 32 + 8 + 4);
+    QVERIFY(!snapshot.openData(badPage));
+
+    QVERIFY(!snapshot.openData(QByteArray("not a snapshot")));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+    {
+      QFile file(QDir(dir.path()).filePath("history.bin"));
+      QVERIFY(file.open(QIODevice::WriteOnly));
+      file.write(badPage);
+    }
+
+    HistoryStore store;
+    QCOMPARE(store.count(), 0);
+    QVERIFY(!store.lastError().isEmpty());
+  }
+
+  void benchmark_snapshotLoad()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const int kVisits = benchmarkSize(1000000, 20000);
+    const int kPages = benchmarkSize(100000, 2000);
+    {
+      HistorySnapshot::Builder builder;
+      for (int i = 0; i < kPages; ++i) {
+        builder.addPage(QStringLiteral("https://site%1.example/article-%2").arg(i % 1000).arg(i),
+                        QStringLiteral("Article %1").arg(i),
+                        1000 + qint64(kVisits) * 1000);
+      }
+      for (int i = 0; i < kVisits; ++i) {
+        builder.addVisit(i + 1, i % kPages, 1000 + qint64(i) * 1000);
+      }
+      QFile file(QDir(dir.path()).filePath("history.bin"));
+      QVERIFY(file.open(QIODevice::WriteOnly));
+      file.write(builder.finish(kVisits + 1));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    HistoryStore store;
+    const qint64 loadMs = timer.elapsed();
+    QCOMPARE(store.count(), kVisits);
+    QCOMPARE(store.pageCount(), kPages);
+
+    timer.restart();
+    for (int row = 0; row < 100; ++row) {
+      QVERIFY(!store.index(row, 0).data(HistoryStore::TitleRole).toString().isEmpty());
+    }
+    const qint64 firstRowsUs = timer.nsecsElapsed() / 1000;
+
+    timer.restart();
+    store.addVisit(QUrl("https://new.example/"), "New", 2000 + qint64(kVisits) * 1000);
+    const qint64 firstAddMs = timer.elapsed();
+    QCOMPARE(store.count(), kVisits + 1);
+
+    qInfo().noquote() << QStringLiteral("history snapshot: %1 visits over %2 pages opened in %3 ms, first 100 rows in %4 us, first visit added in %5 ms")
+                           .arg(kVisits)
+                           .arg(kPages)
+                           .arg(loadMs)
+                           .arg(firstRowsUs)
+                           .arg(firstAddMs);
+  }
+
+  void benchmark_bulkIngest()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const int kVisits = benchmarkSize(1000000, 20000);
+    const int kPages = benchmarkSize(100000, 2000);
+    const int kChunk = benchmarkSize(50000, 1000);
+    QVector<HistoryStore::VisitRecord> visits;
+    visits.reserve(kVisits);
+    for (int i = 0; i < kVisits; ++i) {
+      const int page = (i * 7919) % kPages;
+      visits.push_back({QUrl(QStringLiteral("https://site%1.example/article-%2").arg(page % 1000).arg(page)),
+                        QStringLiteral("Article %1").arg(page),
+                        1000 + qint64(i) * 1000});
+    }
+
+    HistoryStore store;
+    QSignalSpy inserted(&store, &QAbstractItemModel::rowsInserted);
+    QElapsedTimer timer;
+    timer.start();
+    int added = 0;
+    for (int from = 0; from < kVisits; from += kChunk) {
+      added += store.addVisits(visits.mid(from, kChunk));
+    }
+    const qint64 ingestMs = timer.elapsed();
+    QCOMPARE(added, kVisits);
+    QCOMPARE(store.count(), kVisits);
+    QCOMPARE(store.pageCount(), kPages);
+    QCOMPARE(inserted.count(), kVisits / kChunk);
+
+    timer.restart();
+    QString error;
+    QVERIFY(store.saveNow(&error));
+    const qint64 saveMs = timer.elapsed();
+
+    qInfo().noquote() << QStringLiteral("history ingest: %1 visits over %2 pages in %3 ms (%4 chunks), saved in %5 ms")
+                           .arg(kVisits)
+                           .arg(kPages)
+                           .arg(ingestMs)
+                           .arg(kVisits / kChunk)
+                           .arg(saveMs);
+  }
+
+  void benchmark_visitMemory()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const int kVisits = benchmarkSize(200000, 20000);
+    constexpr int kPages = 2000;
+    const auto urlFor = [](int i) {
+      return QUrl(QStringLiteral("https://site%1.example/section/article-%2?ref=feed").arg(i % 200).arg(i % kPages));
+    };
+    const auto titleFor = [](int i) {
+      return QStringLiteral("Article %1 - Site %2").arg(i % kPages).arg(i % 200);
+    };
+
+    const qint64 before = processMemoryBytes();
+    if (before < 0) {
+      QSKIP("Process memory is not measurable on this platform");
+    }
+
+    HistoryStore store;
+    for (int i = 0; i < kVisits; ++i) {
+      store.addVisit(urlFor(i), titleFor(i), 1000 + qint64(i) * 10000);
+    }
+    QCOMPARE(store.count(), kVisits);
+    QCOMPARE(store.pageCount(), kPages);
+    const qint64 afterStore = processMemoryBytes();
+
+    // The layout the store used before: every visit owning its URL and title.
+    struct VisitCopy
+    {
+      int id = 0;
+      QString title;
+      QUrl url;
+      qint64 visitedMs = 0;
+    };
+    QVector<VisitCopy> copies;
+    for (int i = 0; i < kVisits; ++i) {
+      copies.push_back({ i + 1, titleFor(i), urlFor(i), 1000 + qint64(i) * 10000 });
+    }
+    const qint64 afterCopies = processMemoryBytes();
+
+    // Resident size moves with the allocator and whatever else the process
+    // touched, so the numbers are reported rather than asserted.
+    const qint64 storeBytes = afterStore - before;
+    const qint64 copyBytes = afterCopies - afterStore;
+    qInfo().noquote() << QStringLiteral("history memory: %1 visits over %2 pages, %3 bytes/visit interned vs %4 bytes/visit per-visit copies")
+                           .arg(kVisits)
+                           .arg(kPages)
+                           .arg(double(storeBytes) / kVisits, 0, 'f', 1)
+                           .arg(double(copyBytes) / kVisits, 0, 'f', 1);
+  }
 };
 
 QTEST_GUILESS_MAIN(TestHistoryStore)
@@ -0,0 +1,455 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+
+#include "BenchmarkSize.h"
+#include "core/FullTextIndex.h"
+#include "core/HistoryFilterModel.h"
+#include "core/HistoryStore.h"
+#include "core/HistoryTextIndex.h"
+
+#include <memory>
+
+namespace
+{
+struct Page
+{
+  QString key;
+  QString title;
+  QString text;
+};
+
+// Crude tag stripper standing in for the innerText the browser captures.
+QVector<Page> loadFixturePages()
+{
+  QVector<Page> pages;
+  const QDir dir(QStringLiteral(XBROWSER_TEST_FIXTURES_DIR "/history_text"));
+  const QFileInfoList files = dir.entryInfoList({ QStringLiteral("*.html") }, QDir::Files, QDir::Name);
+  for (const QFileInfo& info : files) {
+    QFile f(info.filePath());
+    if (!f.open(QIODevice::ReadOnly)) {
+      continue;
+    }
+    QString html = QString::fromUtf8(f.readAll());
+
+    static const QRegularExpression titleRe(QStringLiteral("<title>(.*?)</title>"),
+                                            QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression hiddenRe(QStringLiteral("<(script|style|title)[^>]*>.*?</\\1>"),
+                                             QRegularExpression::DotMatchesEverythingOption
+                                               | QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression tagRe(QStringLiteral("<[^>]+>"));
+
+    Page page;
+    page.key = info.completeBaseName();
+    page.title = titleRe.match(html).captured(1).trimmed();
+    html.remove(hiddenRe);
+    html.replace(tagRe, QStringLiteral(" "));
+    page.text = html.simplified();
+    pages.push_back(page);
+  }
+  return pages;
+}
+
+QStringList keysOf(const QVector<FullTextIndex::Hit>& hits)
+{
+  QStringList keys;
+  for (const FullTextIndex::Hit& hit : hits) {
+    keys.push_back(hit.key);
+  }
+  return keys;
+}
+
+QUrl fixtureUrl(const QString& key)
+{
+  return QUrl(QStringLiteral("https://fixtures.example/%1").arg(key));
+}
+
+QVector<FullTextIndex::Hit> searchNow(HistoryTextIndex& index, const QString& query, int limit = 10)
+{
+  QVector<FullTextIndex::Hit> result;
+  index.searchAsync(query, limit, &index, [&result](const QVector<FullTextIndex::Hit>& hits) {
+    result = hits;
+  });
+  index.waitForIdle(5000);
+  return result;
+}
+}
+
+class TestHistoryTextIndex final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void init()
+  {
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+    qputenv("XBROWSER_DATA_DIR", m_dir->path().toUtf8());
+    m_pages = loadFixturePages();
+    QCOMPARE(m_pages.size(), 8);
+  }
+
+  void tokenize_foldsCaseAndSplitsIdeographs()
+  {
+    QCOMPARE(FullTextIndex::tokenize(u"Hello, WORLD! a x2 it's"),
+             QStringList({ "hello", "world", "x2", "it" }));
+    QCOMPARE(FullTextIndex::tokenize(u"\u6771\u4eac tower"),
+             QStringList({ QString(QChar(0x6771)), QString(QChar(0x4eac)), QStringLiteral("tower") }));
+    QVERIFY(FullTextIndex::tokenize(QString(FullTextIndex::kMaxTokenLength + 1, QLatin1Char('z'))).isEmpty());
+  }
+
+  void search_ranksByBm25()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    addFixtures(index);
+
+    const QVector<FullTextIndex::Hit> fermentation = index.search("fermentation", 10);
+    QCOMPARE(keysOf(fermentation), QStringList({ "sourdough", "kimchi" }));
+    QVERIFY(fermentation.at(0).score > fermentation.at(1).score);
+    QCOMPARE(fermentation.at(0).title, QStringLiteral("Sourdough Bread for Beginners"));
+
+    // The title counts more than body text.
+    QCOMPARE(keysOf(index.search("borrow", 10)), QStringList({ "library-card", "rust-ownership" }));
+    QCOMPARE(keysOf(index.search("Pods", 10)), QStringList({ "kubernetes" }));
+    QCOMPARE(index.search("pods", 10).at(0).matchedTerms, 1);
+    QVERIFY(index.search("zeppelin", 10).isEmpty());
+    QCOMPARE(index.search("borrow", 1).size(), 1);
+  }
+
+  void search_prefersDocumentsMatchingEveryTerm()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    addFixtures(index);
+
+    // library-card scores higher for "borrow" alone, but only the Rust
+    // page contains both words.
+    const QVector<FullTextIndex::Hit> hits = index.search("rust borrow ", 10);
+    QCOMPARE(keysOf(hits), QStringList({ "rust-ownership", "library-card" }));
+    QCOMPARE(hits.at(0).matchedTerms, 2);
+    QCOMPARE(hits.at(1).matchedTerms, 1);
+  }
+
+  void search_expandsTheLastTermAsPrefix()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    addFixtures(index);
+
+    QCOMPARE(keysOf(index.search("kuber", 10)), QStringList({ "kubernetes" }));
+    QCOMPARE(keysOf(index.search("ferment", 10)), QStringList({ "sourdough", "kimchi" }));
+    // A trailing space means the word is finished.
+    QVERIFY(index.search("kuber ", 10).isEmpty());
+    // Only the last term is a prefix.
+    QCOMPARE(index.search("kuber pods", 10).at(0).matchedTerms, 1);
+
+    // Prefix matching also covers documents still in the write buffer.
+    QVERIFY(index.flush());
+    index.addDocument("late", "Fermenter notes", "airlock", 1);
+    QCOMPARE(index.bufferedCount(), 1);
+    QVERIFY(keysOf(index.search("fermente", 10)).contains("late"));
+  }
+
+  void flush_persistsAcrossReopen()
+  {
+    QStringList before;
+    {
+      FullTextIndex index;
+      QVERIFY(index.open(indexPath()));
+      addFixtures(index);
+      QCOMPARE(index.bufferedCount(), m_pages.size());
+      QVERIFY(index.flush());
+      QCOMPARE(index.bufferedCount(), 0);
+      QCOMPARE(index.segmentCount(), 1);
+      before = keysOf(index.search("the", 10));
+    }
+
+    FullTextIndex reopened;
+    QVERIFY(reopened.open(indexPath()));
+    QCOMPARE(reopened.documentCount(), m_pages.size());
+    QCOMPARE(keysOf(reopened.search("the", 10)), before);
+    QCOMPARE(keysOf(reopened.search("fermentation", 10)), QStringList({ "sourdough", "kimchi" }));
+  }
+
+  void merge_keepsResultsAndBoundsSegmentCount()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    for (const Page& page : std::as_const(m_pages)) {
+      index.addDocument(page.key, page.title, page.text, 1000);
+      QVERIFY(index.flush());
+      QVERIFY(index.segmentCount() < FullTextIndex::kMergeFactor);
+    }
+    QVERIFY(index.segmentCount() > 1);
+
+    const QStringList queries { "fermentation", "rust borrow", "memory", "the", "gr" };
+    QVector<QStringList> before;
+    for (const QString& q : queries) {
+      before.push_back(keysOf(index.search(q, 10)));
+    }
+
+    QVERIFY(index.merge(true));
+    QCOMPARE(index.segmentCount(), 1);
+    for (int i = 0; i < queries.size(); ++i) {
+      QCOMPARE(keysOf(index.search(queries.at(i), 10)), before.at(i));
+    }
+    QCOMPARE(QDir(indexPath()).entryList({ "seg_*.fti" }, QDir::Files).size(), 1);
+  }
+
+  void addDocument_supersedesOlderCopy()
+  {
+    {
+      FullTextIndex index;
+      QVERIFY(index.open(indexPath()));
+      index.addDocument("page", "Old", "alpha bravo", 1000);
+      QVERIFY(index.flush());
+      index.addDocument("page", "New", "charlie", 2000);
+      QCOMPARE(index.documentCount(), 1);
+      QVERIFY(index.search("alpha", 10).isEmpty());
+      QCOMPARE(index.search("charlie", 10).at(0).title, QStringLiteral("New"));
+      QVERIFY(index.flush());
+    }
+
+    FullTextIndex reopened;
+    QVERIFY(reopened.open(indexPath()));
+    QCOMPARE(reopened.documentCount(), 1);
+    QVERIFY(reopened.search("alpha", 10).isEmpty());
+    QCOMPARE(reopened.search("charlie", 10).at(0).visitedMs, 2000);
+  }
+
+  void removeDocument_survivesReopenUntilReadded()
+  {
+    {
+      FullTextIndex index;
+      QVERIFY(index.open(indexPath()));
+      addFixtures(index);
+      QVERIFY(index.flush());
+      QVERIFY(index.removeDocument("sourdough"));
+      QVERIFY(!index.removeDocument("sourdough"));
+      QCOMPARE(keysOf(index.search("fermentation", 10)), QStringList({ "kimchi" }));
+    }
+
+    {
+      FullTextIndex index;
+      QVERIFY(index.open(indexPath()));
+      QCOMPARE(index.documentCount(), m_pages.size() - 1);
+      QCOMPARE(keysOf(index.search("fermentation", 10)), QStringList({ "kimchi" }));
+
+      index.addDocument("sourdough", "Sourdough again", "fermentation", 5000);
+      QVERIFY(index.flush());
+      QVERIFY(index.merge(true));
+    }
+
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    QCOMPARE(index.documentCount(), m_pages.size());
+    QCOMPARE(index.search("sourdough", 10).at(0).title, QStringLiteral("Sourdough again"));
+  }
+
+  void retainOnly_andClear()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    addFixtures(index);
+    QVERIFY(index.flush());
+
+    QCOMPARE(index.retainOnly({ "kimchi", "espresso", "unknown" }), m_pages.size() - 2);
+    QCOMPARE(index.documentCount(), 2);
+    QCOMPARE(keysOf(index.search("fermentation", 10)), QStringList({ "kimchi" }));
+
+    QVERIFY(index.clear());
+    QCOMPARE(index.documentCount(), 0);
+    QVERIFY(index.search("grind", 10).isEmpty());
+    QVERIFY(QDir(indexPath()).entryList({ "seg_*.fti" }, QDir::Files).isEmpty());
+  }
+
+  void search_filtersByVisitTime()
+  {
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+    for (int i = 0; i < m_pages.size(); ++i) {
+      index.addDocument(m_pages.at(i).key, m_pages.at(i).title, m_pages.at(i).text, 1000 * (i + 1));
+    }
+    const qint64 kimchiMs = index.search("kimchi", 1).at(0).visitedMs;
+
+    QCOMPARE(keysOf(index.search("fermentation", 10)), QStringList({ "sourdough", "kimchi" }));
+    QCOMPARE(keysOf(index.search("fermentation", 10, kimchiMs, kimchiMs)), QStringList({ "kimchi" }));
+    QCOMPARE(keysOf(index.search("fermentation", 10, 0, kimchiMs)), QStringList({ "kimchi" }));
+    QCOMPARE(keysOf(index.search("fermentation", 10, kimchiMs + 1, 0)), QStringList({ "sourdough" }));
+  }
+
+  void wrapper_searchesOnWorkerAndFollowsHistory()
+  {
+    HistoryStore history;
+    HistoryTextIndex index;
+    index.setHistory(&history);
+
+    for (int i = 0; i < m_pages.size(); ++i) {
+      const Page& page = m_pages.at(i);
+      history.addVisit(fixtureUrl(page.key), page.title, 10000 * (i + 1));
+      index.addPage(fixtureUrl(page.key), page.title, page.text, 10000 * (i + 1));
+    }
+    index.addPage(QUrl("file:///tmp/notes.txt"), "Notes", "fermentation");
+    index.addPage(fixtureUrl("long"), "Long", QString(HistoryTextIndex::kMaxCaptureChars, QLatin1Char(' ')) + "zeppelin");
+
+    QSignalSpy spy(&index, &HistoryTextIndex::searchFinished);
+    const int requestId = index.search("fermentation#", 5);
+    QVERIFY(index.waitForIdle(5000));
+    QCOMPARE(spy.size(), 1);
+    QCOMPARE(spy.at(0).at(0).toInt(), requestId);
+    const QVariantList results = spy.at(0).at(2).toList();
+    QCOMPARE(results.size(), 2);
+    QCOMPARE(results.at(0).toMap().value("url").toUrl(), fixtureUrl("sourdough"));
+    QVERIFY(searchNow(index, "zeppelin").isEmpty());
+
+    // Fragments do not create separate pages.
+    index.addPage(QUrl(fixtureUrl("espresso").toString() + "#crema"), "Dialing In Espresso at Home", "tamp", 2000);
+    QCOMPARE(searchNow(index, "tamp").size(), 1);
+    QVERIFY(searchNow(index, "eighteen").isEmpty());
+
+    // Deleting a visit drops the page text; the remaining pages stay.
+    int sourdoughRow = -1;
+    for (int row = 0; row < history.count(); ++row) {
+      if (history.index(row, 0).data(HistoryStore::UrlRole).toUrl() == fixtureUrl("sourdough")) {
+        sourdoughRow = row;
+      }
+    }
+    QVERIFY(sourdoughRow >= 0);
+    history.removeAt(sourdoughRow);
+    QTRY_VERIFY(searchNow(index, "sourdough").isEmpty());
+    QCOMPARE(searchNow(index, "fermentation").size(), 1);
+    QCOMPARE(searchNow(index, "pods").size(), 1);
+
+    history.clearAll();
+    QTRY_VERIFY(searchNow(index, "the").isEmpty());
+  }
+
+  void wrapper_persistsAfterDestruction()
+  {
+    {
+      HistoryTextIndex index;
+      index.addPage(fixtureUrl("espresso"), "Dialing In Espresso", "crema grind", 1000);
+    }
+
+    HistoryTextIndex index;
+    const QVector<FullTextIndex::Hit> hits = searchNow(index, "crema");
+    QCOMPARE(hits.size(), 1);
+    QCOMPARE(hits.at(0).key, HistoryTextIndex::urlKey(fixtureUrl("espresso")));
+  }
+
+  void filterModel_matchesPageContent()
+  {
+    HistoryStore history;
+    for (const Page& page : std::as_const(m_pages)) {
+      history.addVisit(fixtureUrl(page.key), QStringLiteral("Visited page"), 1000);
+    }
+
+    HistoryTextIndex index;
+    for (const Page& page : std::as_const(m_pages)) {
+      index.addPage(fixtureUrl(page.key), page.title, page.text, 1000);
+    }
+
+    HistoryFilterModel filter;
+    filter.setSourceHistory(&history);
+    filter.setTextIndex(&index);
+    filter.setSearchText("fermentation");
+    QCOMPARE(filter.rowCount(), 0);
+    QVERIFY(index.waitForIdle(5000));
+    QCOMPARE(filter.rowCount(), 2);
+
+    // Title and URL matches still work on their own.
+    filter.setSearchText("kubernetes");
+    QCOMPARE(filter.rowCount(), 1);
+    filter.setSearchText("visited");
+    QCOMPARE(filter.rowCount(), m_pages.size());
+    filter.setSearchText("");
+    QCOMPARE(filter.rowCount(), m_pages.size());
+  }
+
+  void benchmark_indexAndQuery()
+  {
+    const QStringList vocabulary = [] {
+      QStringList words;
+      for (int i = 0; i < 5000; ++i) {
+        words.push_back(QStringLiteral("w%1x").arg(i, 4, 36, QLatin1Char('0')));
+      }
+      return words;
+    }();
+
+    const int kDocuments = benchmarkSize(2000, 200);
+    constexpr int kWordsPerDocument = 400;
+    quint32 seed = 12345;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 8;
+    };
+
+    FullTextIndex index;
+    QVERIFY(index.open(indexPath()));
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int d = 0; d < kDocuments; ++d) {
+      QString text;
+      for (int w = 0; w < kWordsPerDocument; ++w) {
+        // Skewed towards the start of the vocabulary, like real text.
+        const quint32 r = next() % quint32(vocabulary.size());
+        text += vocabulary.at(int((r * r) / quint32(vocabulary.size()))) + QLatin1Char(' ');
+      }
+      index.addDocument(QStringLiteral("doc%1").arg(d), QStringLiteral("Document %1").arg(d), text, d + 1);
+    }
+    QVERIFY(index.flush());
+    const qint64 indexMs = timer.elapsed();
+    const int segments = index.segmentCount();
+
+    timer.restart();
+    QVERIFY(index.merge(true));
+    const qint64 mergeMs = timer.elapsed();
+    QCOMPARE(index.documentCount(), kDocuments);
+
+    const int kQueries = benchmarkSize(200, 20);
+    int totalHits = 0;
+    timer.restart();
+    for (int q = 0; q < kQueries; ++q) {
+      const QString query = vocabulary.at(int(next() % 300)) + QLatin1Char(' ') + vocabulary.at(int(next() % 3000)).left(3);
+      totalHits += int(index.search(query, 10).size());
+    }
+    const qint64 queryMs = timer.elapsed();
+    QVERIFY(totalHits > 0);
+
+    qInfo().noquote() << QStringLiteral("full-text index: %1 docs indexed in %2 ms (%3 segments before merge), merged in %4 ms, "
+                                        "%5 queries in %6 ms")
+                           .arg(kDocuments)
+                           .arg(indexMs)
+                           .arg(segments)
+                           .arg(mergeMs)
+                           .arg(kQueries)
+                           .arg(queryMs);
+  }
+
+private:
+  QString indexPath() const
+  {
+    return QDir(m_dir->path()).filePath(QStringLiteral("index"));
+  }
+
+  void addFixtures(FullTextIndex& index) const
+  {
+    for (const Page& page : m_pages) {
+      index.addDocument(page.key, page.title, page.text, 1000);
+    }
+  }
+
+  std::unique_ptr<QTemporaryDir> m_dir;
+  QVector<Page> m_pages;
+};
+
+QTEST_GUILESS_MAIN(TestHistoryTextIndex)
+
+#include "TestHistoryTextIndex.moc"
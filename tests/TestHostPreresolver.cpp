@@ -0,0 +1,35 @@
+#include <QtTest/QtTest>
+
+#include "core/HostPreresolver.h"
+
+class TestHostPreresolver final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void preresolve_looksUpEachHostOnce()
+  {
+    HostPreresolver resolver;
+    resolver.preresolve(QUrl("https://localhost/a"));
+    resolver.preresolve(QUrl("http://LOCALHOST/b?q=1"));
+    QCOMPARE(resolver.lookupCount(), 1);
+
+    // Nothing to resolve for addresses and non-web schemes.
+    resolver.preresolve(QUrl("https://127.0.0.1/"));
+    resolver.preresolve(QUrl("file:///tmp/page.html"));
+    resolver.preresolve(QUrl("about:blank"));
+    QCOMPARE(resolver.lookupCount(), 1);
+  }
+
+  void preresolve_limitsLookupsInFlight()
+  {
+    HostPreresolver resolver;
+    for (int i = 0; i < 40; ++i) {
+      resolver.preresolve(QUrl(QStringLiteral("https://host%1.invalid/").arg(i)));
+    }
+    QCOMPARE(resolver.lookupCount(), HostPreresolver::kMaxInFlight);
+  }
+};
+
+QTEST_GUILESS_MAIN(TestHostPreresolver)
+#include "TestHostPreresolver.moc"
@@ -0,0 +1,139 @@
+#include <QtTest/QtTest>
+
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "core/InstanceBroker.h"
+
+class TestInstanceBroker final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void init()
+  {
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+  }
+
+  void serverName_isStablePerDataDir()
+  {
+    const QString name = InstanceBroker::serverNameFor(m_dir->path());
+    QCOMPARE(InstanceBroker::serverNameFor(m_dir->path() + QStringLiteral("/")), name);
+    QCOMPARE(InstanceBroker::serverNameFor(m_dir->path() + QStringLiteral("/sub/..")), name);
+    QVERIFY(InstanceBroker::serverNameFor(m_dir->filePath(QStringLiteral("other"))) != name);
+    QVERIFY(name.size() < 40);
+  }
+
+  void request_roundTripsAndRejectsGarbage()
+  {
+    InstanceBroker::Request request;
+    request.urls = { QStringLiteral("https://a.example/"), QStringLiteral("file:///tmp/page%20one.html") };
+    request.newWindow = true;
+
+    const QByteArray encoded = InstanceBroker::encodeRequest(request);
+    QVERIFY(encoded.endsWith('\n'));
+    QCOMPARE(encoded.count('\n'), 1);
+
+    InstanceBroker::Request decoded;
+    QVERIFY(InstanceBroker::decodeRequest(encoded.trimmed(), &decoded));
+    QCOMPARE(decoded.urls, request.urls);
+    QVERIFY(decoded.newWindow);
+
+    QVERIFY(!InstanceBroker::decodeRequest("not json", nullptr));
+    QVERIFY(!InstanceBroker::decodeRequest("[1,2]", nullptr));
+    QVERIFY(!InstanceBroker::decodeRequest(R"({"version":99,"urls":[]})", nullptr));
+  }
+
+  void forward_failsFastWithoutRunningInstance()
+  {
+    InstanceBroker::Request request;
+    request.urls = { QStringLiteral("https://nobody.example/") };
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    QVERIFY(!InstanceBroker::forward(m_dir->path(), request, &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(timer.elapsed() < InstanceBroker::kReplyTimeoutMs);
+  }
+
+  void forward_deliversUrlsFromSecondProcess()
+  {
+    InstanceBroker broker(m_dir->path());
+    QString error;
+    QVERIFY2(broker.listen(&error), qPrintable(error));
+    QSignalSpy received(&broker, &InstanceBroker::requestReceived);
+
+    QProcess client;
+    client.start(QStringLiteral(XBROWSER_TEST_INSTANCE_CLIENT),
+                 { m_dir->path(), QStringLiteral("--new-window"), QStringLiteral("https://a.example/"),
+                   QStringLiteral("https://b.example/x?y=1") });
+    QVERIFY2(client.waitForStarted(5000), qPrintable(client.errorString()));
+
+    QVERIFY(received.wait(5000));
+    QCOMPARE(received.count(), 1);
+    QCOMPARE(received.at(0).at(0).toStringList(),
+             QStringList({ QStringLiteral("https://a.example/"), QStringLiteral("https://b.example/x?y=1") }));
+    QVERIFY(received.at(0).at(1).toBool());
+
+    QVERIFY(client.waitForFinished(5000));
+    QCOMPARE(client.exitStatus(), QProcess::NormalExit);
+    QCOMPARE(client.exitCode(), 0);
+  }
+
+  void forward_withoutUrlsStillReachesInstance()
+  {
+    InstanceBroker broker(m_dir->path());
+    QVERIFY(broker.listen());
+    QSignalSpy received(&broker, &InstanceBroker::requestReceived);
+
+    QProcess client;
+    client.start(QStringLiteral(XBROWSER_TEST_INSTANCE_CLIENT), { m_dir->path() });
+    QVERIFY(received.wait(5000));
+    QVERIFY(received.at(0).at(0).toStringList().isEmpty());
+    QVERIFY(!received.at(0).at(1).toBool());
+    QVERIFY(client.waitForFinished(5000));
+    QCOMPARE(client.exitCode(), 0);
+  }
+
+  void malformedRequest_isAnsweredWithError()
+  {
+    InstanceBroker broker(m_dir->path());
+    QVERIFY(broker.listen());
+    QSignalSpy received(&broker, &InstanceBroker::requestReceived);
+
+    QLocalSocket socket;
+    socket.connectToServer(broker.serverName());
+    QVERIFY(socket.waitForConnected(1000));
+    socket.write("{\"version\":1,\n");
+
+    QTRY_VERIFY_WITH_TIMEOUT(socket.canReadLine(), 5000);
+    QCOMPARE(socket.readLine().trimmed(), QByteArray("error"));
+    QCOMPARE(received.count(), 0);
+  }
+
+  void listen_replacesLeftoverServer()
+  {
+    // A crashed instance leaves its socket behind; the next lock holder
+    // takes the name over.
+    auto stale = std::make_unique<InstanceBroker>(m_dir->path());
+    QVERIFY(stale->listen());
+
+    InstanceBroker broker(m_dir->path());
+    QString error;
+    QVERIFY2(broker.listen(&error), qPrintable(error));
+    QVERIFY(broker.isListening());
+  }
+
+private:
+  std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+QTEST_GUILESS_MAIN(TestInstanceBroker)
+
+#include "TestInstanceBroker.moc"
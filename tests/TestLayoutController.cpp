@@ -4,7 +4,9 @@
 #include <QTemporaryDir>
 
 #include "core/AppSettings.h"
+#include "core/BrowserController.h"
 #include "core/LayoutController.h"
+#include "core/WorkspaceModel.h"
 
 class TestLayoutController final : public QObject
 {
@@ -217,6 +219,73 @@ private slots:
     QVERIFY(!layout.sidebarIconOnly());
   }
 
+  void sidebarResize_commitsWidthOnce()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    AppSettings settings;
+    settings.setSidebarWidth(260);
+    BrowserController browser(&settings, nullptr);
+    LayoutController layout;
+    layout.setSettings(&settings);
+
+    QSignalSpy settingsSpy(&settings, &AppSettings::sidebarWidthChanged);
+    QSignalSpy workspaceSpy(browser.workspaces(), &QAbstractItemModel::dataChanged);
+    QSignalSpy liveSpy(&layout, &LayoutController::sidebarWidthChanged);
+
+    layout.beginSidebarResize();
+    QVERIFY(layout.sidebarResizing());
+    for (int width = 262; width <= 320; width += 2) {
+      layout.updateSidebarResize(width);
+    }
+    layout.updateSidebarResize(190);
+    QCOMPARE(layout.sidebarWidth(), 190);
+    QVERIFY(layout.sidebarIconOnly());
+    QCOMPARE(liveSpy.count(), 31);
+    QCOMPARE(settingsSpy.count(), 0);
+    QCOMPARE(workspaceSpy.count(), 0);
+    QCOMPARE(settings.sidebarWidth(), 260);
+
+    layout.updateSidebarResize(300);
+    layout.commitSidebarResize();
+    QVERIFY(!layout.sidebarResizing());
+    QCOMPARE(settingsSpy.count(), 1);
+    QCOMPARE(workspaceSpy.count(), 1);
+    QCOMPARE(settings.sidebarWidth(), 300);
+    QCOMPARE(browser.workspaces()->sidebarWidthAt(browser.workspaces()->activeIndex()), 300);
+    QCOMPARE(layout.sidebarWidth(), 300);
+  }
+
+  void sidebarResize_cancelRestoresWidth()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    AppSettings settings;
+    settings.setSidebarWidth(260);
+    LayoutController layout;
+    layout.setSettings(&settings);
+    QSignalSpy settingsSpy(&settings, &AppSettings::sidebarWidthChanged);
+
+    layout.beginSidebarResize();
+    layout.updateSidebarResize(1000);
+    QCOMPARE(layout.sidebarWidth(), AppSettings::kMaxSidebarWidth);
+
+    QSignalSpy liveSpy(&layout, &LayoutController::sidebarWidthChanged);
+    layout.cancelSidebarResize();
+    QCOMPARE(layout.sidebarWidth(), 260);
+    QCOMPARE(liveSpy.count(), 1);
+    QCOMPARE(settingsSpy.count(), 0);
+
+    // Outside a gesture updates are ignored.
+    layout.updateSidebarResize(400);
+    layout.commitSidebarResize();
+    QCOMPARE(settings.sidebarWidth(), 260);
+  }
+
   void emitsSignalsWhenComputedFlagsChange()
   {
     QTemporaryDir dir;
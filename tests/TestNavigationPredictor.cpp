@@ -0,0 +1,207 @@
+#include <QtTest/QtTest>
+
+#include <QTemporaryDir>
+
+#include "core/HistoryStore.h"
+#include "core/NavigationPredictor.h"
+
+#include <memory>
+
+class TestNavigationPredictor final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void init()
+  {
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+    qputenv("XBROWSER_DATA_DIR", m_dir->path().toUtf8());
+  }
+
+  void predictNext_ranksDestinationsByFrequency()
+  {
+    NavigationPredictor predictor;
+    const QUrl inbox("https://mail.example/inbox");
+    for (int i = 0; i < 3; ++i) {
+      predictor.recordNavigation(inbox, QUrl("https://mail.example/compose"));
+    }
+    predictor.recordNavigation(inbox, QUrl("https://mail.example/settings#privacy"));
+
+    const QVector<NavigationPredictor::Prediction> next = predictor.predictionsAfter(QUrl("https://mail.example/inbox#top"));
+    QCOMPARE(next.size(), 2);
+    QCOMPARE(next.at(0).url, QUrl("https://mail.example/compose"));
+    QCOMPARE(next.at(0).hits, 3);
+    QCOMPARE(next.at(0).confidence, 0.75);
+    QCOMPARE(next.at(1).url, QUrl("https://mail.example/settings"));
+    QCOMPARE(next.at(1).confidence, 0.25);
+
+    QCOMPARE(predictor.predictionsAfter(inbox, 1).size(), 1);
+    QVERIFY(predictor.predictionsAfter(QUrl("https://other.example/")).isEmpty());
+  }
+
+  void record_ignoresReloadsAndNonWebUrls()
+  {
+    NavigationPredictor predictor;
+    predictor.recordNavigation(QUrl("https://a.example/"), QUrl("https://a.example/#again"));
+    predictor.recordNavigation(QUrl("about:blank"), QUrl("https://a.example/"));
+    predictor.recordNavigation(QUrl(), QUrl("https://a.example/"));
+    predictor.recordNavigation(QUrl("https://a.example/"), QUrl("file:///tmp/x.html"));
+    predictor.recordTypedNavigation(QStringLiteral("   "), QUrl("https://a.example/"));
+    QCOMPARE(predictor.sourceCount(), 0);
+  }
+
+  void predictForInput_learnsEveryTypedPrefix()
+  {
+    NavigationPredictor predictor;
+    predictor.recordTypedNavigation(QStringLiteral("https://www.GitHub.com"), QUrl("https://github.com/"));
+    predictor.recordTypedNavigation(QStringLiteral("gi"), QUrl("https://github.com/"));
+    predictor.recordTypedNavigation(QStringLiteral("gmail"), QUrl("https://mail.example/"));
+
+    const QVector<NavigationPredictor::Prediction> g = predictor.predictionsForInput(QStringLiteral("g"));
+    QCOMPARE(g.size(), 2);
+    QCOMPARE(g.at(0).url, QUrl("https://github.com/"));
+    QCOMPARE(g.at(0).hits, 2);
+
+    QCOMPARE(predictor.predictionsForInput(QStringLiteral("GITH")).at(0).confidence, 1.0);
+    QCOMPARE(predictor.predictionsForInput(QStringLiteral("gm")).at(0).url, QUrl("https://mail.example/"));
+    QVERIFY(predictor.predictionsForInput(QStringLiteral("gx")).isEmpty());
+  }
+
+  void targets_stayBoundedPerSource()
+  {
+    NavigationPredictor predictor;
+    const QUrl hub("https://hub.example/");
+    for (int i = 0; i < 4; ++i) {
+      predictor.recordNavigation(hub, QUrl("https://hub.example/favourite"));
+    }
+    for (int i = 0; i < 20; ++i) {
+      predictor.recordNavigation(hub, QUrl(QStringLiteral("https://hub.example/item%1").arg(i)));
+    }
+
+    const QVector<NavigationPredictor::Prediction> next = predictor.predictionsAfter(hub, 100);
+    QCOMPARE(next.size(), NavigationPredictor::kMaxTargetsPerSource);
+    QCOMPARE(next.at(0).url, QUrl("https://hub.example/favourite"));
+    QCOMPARE(next.at(0).confidence, 4.0 / 24.0);
+    // Among equally weak targets the most recent ranks first.
+    QCOMPARE(next.at(1).url, QUrl("https://hub.example/item19"));
+  }
+
+  void record_decaysOldHabits()
+  {
+    NavigationPredictor predictor;
+    const QUrl from("https://news.example/");
+    for (int i = 0; i < 40; ++i) {
+      predictor.recordNavigation(from, QUrl("https://news.example/old"));
+    }
+    for (int i = 0; i < NavigationPredictor::kDecayObservations * 2; ++i) {
+      predictor.recordNavigation(from, QUrl("https://news.example/new"));
+    }
+
+    const QVector<NavigationPredictor::Prediction> next = predictor.predictionsAfter(from);
+    QCOMPARE(next.at(0).url, QUrl("https://news.example/new"));
+    QVERIFY(next.size() == 1 || next.at(1).hits < 10);
+  }
+
+  void warmUpHint_scalesWithEvidence()
+  {
+    NavigationPredictor::Prediction p;
+    p.hits = 1;
+    p.confidence = 1.0;
+    QCOMPARE(NavigationPredictor::warmUpHint(p), QString());
+    p.hits = 2;
+    QCOMPARE(NavigationPredictor::warmUpHint(p), QStringLiteral("preconnect"));
+    p.hits = 4;
+    QCOMPARE(NavigationPredictor::warmUpHint(p), QStringLiteral("prerender"));
+    p.confidence = 0.3;
+    QCOMPARE(NavigationPredictor::warmUpHint(p), QStringLiteral("preconnect"));
+    p.confidence = 0.1;
+    QCOMPARE(NavigationPredictor::warmUpHint(p), QString());
+
+    NavigationPredictor predictor;
+    for (int i = 0; i < 4; ++i) {
+      predictor.recordNavigation(QUrl("https://a.example/"), QUrl("https://a.example/next"));
+    }
+    const QVariantList list = predictor.predictNext(QUrl("https://a.example/"));
+    QCOMPARE(list.size(), 1);
+    const QVariantMap first = list.at(0).toMap();
+    QCOMPARE(first.value("url").toUrl(), QUrl("https://a.example/next"));
+    QCOMPARE(first.value("hits").toInt(), 4);
+    QCOMPARE(first.value("hint").toString(), QStringLiteral("prerender"));
+  }
+
+  void model_roundTripsAndReplaysDeterministically()
+  {
+    const auto replay = [](NavigationPredictor& predictor) {
+      for (int i = 0; i < 200; ++i) {
+        predictor.recordNavigation(QUrl(QStringLiteral("https://site.example/p%1").arg(i % 7)),
+                                   QUrl(QStringLiteral("https://site.example/p%1").arg((i * 3) % 11)));
+        predictor.recordTypedNavigation(QStringLiteral("site%1").arg(i % 5), QUrl(QStringLiteral("https://site.example/p%1").arg(i % 3)));
+      }
+    };
+
+    QByteArray first;
+    {
+      NavigationPredictor predictor;
+      replay(predictor);
+      QString error;
+      QVERIFY(predictor.saveNow(&error));
+      QFile f(QDir(m_dir->path()).filePath("navigation_predictions.json"));
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      first = f.readAll();
+    }
+
+    {
+      NavigationPredictor loaded;
+      QVERIFY(loaded.sourceCount() > 0);
+      QVERIFY(loaded.saveNow());
+      QFile f(QDir(m_dir->path()).filePath("navigation_predictions.json"));
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      QCOMPARE(f.readAll(), first);
+
+      loaded.clear();
+      QVERIFY(loaded.saveNow());
+    }
+
+    {
+      NavigationPredictor fresh;
+      QCOMPARE(fresh.sourceCount(), 0);
+      replay(fresh);
+      QVERIFY(fresh.saveNow());
+      QFile f(QDir(m_dir->path()).filePath("navigation_predictions.json"));
+      QVERIFY(f.open(QIODevice::ReadOnly));
+      QCOMPARE(f.readAll(), first);
+    }
+  }
+
+  void history_deletionsForgetTransitions()
+  {
+    HistoryStore history;
+    history.addVisit(QUrl("https://a.example/"), "A", 10000);
+    history.addVisit(QUrl("https://b.example/"), "B", 20000);
+    history.addVisit(QUrl("https://c.example/"), "C", 30000);
+
+    NavigationPredictor predictor;
+    predictor.setHistory(&history);
+    predictor.recordNavigation(QUrl("https://a.example/"), QUrl("https://b.example/"));
+    predictor.recordNavigation(QUrl("https://a.example/"), QUrl("https://c.example/"));
+    predictor.recordNavigation(QUrl("https://b.example/"), QUrl("https://c.example/"));
+    predictor.recordTypedNavigation(QStringLiteral("c"), QUrl("https://c.example/"));
+
+    history.removeAt(2);
+    QTRY_COMPARE(predictor.predictionsAfter(QUrl("https://a.example/")).size(), 1);
+    QCOMPARE(predictor.predictionsAfter(QUrl("https://a.example/")).at(0).confidence, 1.0);
+    QVERIFY(predictor.predictionsAfter(QUrl("https://b.example/")).isEmpty());
+    QVERIFY(predictor.predictionsForInput(QStringLiteral("c")).isEmpty());
+
+    history.clearAll();
+    QTRY_COMPARE(predictor.sourceCount(), 0);
+  }
+
+private:
+  std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+QTEST_GUILESS_MAIN(TestNavigationPredictor)
+
+#include "TestNavigationPredictor.moc"
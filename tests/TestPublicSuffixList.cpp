@@ -0,0 +1,99 @@
+#include <QtTest/QtTest>
+
+#include "core/PublicSuffixList.h"
+
+class TestPublicSuffixList final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static QString domainOf(const QString& host)
+  {
+    return PublicSuffixList::registrableDomain(host).toString();
+  }
+
+private slots:
+  void table_isCompiledIn()
+  {
+    QVERIFY(PublicSuffixList::ruleCount() > 5000);
+  }
+
+  void registrableDomain_followsIcannRules()
+  {
+    QCOMPARE(domainOf("www.example.com"), QStringLiteral("example.com"));
+    QCOMPARE(domainOf("example.com"), QStringLiteral("example.com"));
+    QCOMPARE(domainOf("a.b.example.co.uk"), QStringLiteral("example.co.uk"));
+    QCOMPARE(domainOf("www.test.k12.ak.us"), QStringLiteral("test.k12.ak.us"));
+    QCOMPARE(domainOf("com"), QString());
+    QCOMPARE(domainOf("co.uk"), QString());
+    QCOMPARE(PublicSuffixList::publicSuffix(u"a.b.example.co.uk").toString(), QStringLiteral("co.uk"));
+    QCOMPARE(PublicSuffixList::publicSuffixLabelCount(u"a.b.example.co.uk"), 2);
+  }
+
+  void registrableDomain_appliesWildcardAndExceptionRules()
+  {
+    QCOMPARE(domainOf("a.b.ck"), QStringLiteral("a.b.ck"));
+    QCOMPARE(PublicSuffixList::publicSuffix(u"a.b.ck").toString(), QStringLiteral("b.ck"));
+    QCOMPARE(domainOf("b.ck"), QString());
+    QCOMPARE(domainOf("www.ck"), QStringLiteral("www.ck"));
+    QCOMPARE(domainOf("x.www.ck"), QStringLiteral("www.ck"));
+    QCOMPARE(domainOf("a.city.kawasaki.jp"), QStringLiteral("city.kawasaki.jp"));
+    QCOMPARE(domainOf("x.y.kawasaki.jp"), QStringLiteral("x.y.kawasaki.jp"));
+  }
+
+  void registrableDomain_includesPrivateSuffixes()
+  {
+    QCOMPARE(domainOf("alice.github.io"), QStringLiteral("alice.github.io"));
+    QCOMPARE(domainOf("github.io"), QString());
+    QVERIFY(PublicSuffixList::isPublicSuffix(u"github.io"));
+    QVERIFY(!PublicSuffixList::isPublicSuffix(u"alice.github.io"));
+    QVERIFY(!PublicSuffixList::isSameSite(u"alice.github.io", u"bob.github.io"));
+  }
+
+  void registrableDomain_handlesUnknownAndMalformedHosts()
+  {
+    QCOMPARE(domainOf("a.b.unknowntld"), QStringLiteral("b.unknowntld"));
+    QCOMPARE(domainOf("localhost"), QString());
+    QCOMPARE(domainOf("192.168.0.1"), QString());
+    QCOMPARE(domainOf("[::1]"), QString());
+    QCOMPARE(domainOf("www.example.com."), QStringLiteral("example.com"));
+    QCOMPARE(domainOf("example..com"), QString());
+    QCOMPARE(domainOf(QString()), QString());
+  }
+
+  void registrableDomain_matchesUnicodeAndPunycodeForms()
+  {
+    // Spelled with escapes so the test does not depend on the source charset.
+    const QString shishiChina = QStringView(u"\u98df\u72ee.\u4e2d\u56fd").toString();
+    const QString companyCn = QStringView(u"\u516c\u53f8.cn").toString();
+
+    QCOMPARE(domainOf("www." + shishiChina), shishiChina);
+    QCOMPARE(domainOf("www.xn--85x722f.xn--fiqs8s"), QStringLiteral("xn--85x722f.xn--fiqs8s"));
+    QCOMPARE(domainOf("shishi." + companyCn), "shishi." + companyCn);
+    QCOMPARE(domainOf(companyCn), QString());
+
+    const QByteArray utf8 = ("cdn." + shishiChina).toUtf8();
+    const std::string_view domain = PublicSuffixList::registrableDomain(std::string_view(utf8.constData(), utf8.size()));
+    QCOMPARE(QString::fromUtf8(domain.data(), qsizetype(domain.size())), shishiChina);
+  }
+
+  void lookups_foldAsciiCaseAndReturnViews()
+  {
+    const QString host = QStringLiteral("Mail.Example.CO.UK");
+    const QStringView domain = PublicSuffixList::registrableDomain(host);
+    QCOMPARE(domain.toString(), QStringLiteral("Example.CO.UK"));
+    QCOMPARE(domain.data(), host.constData() + 5);
+
+    QCOMPARE(PublicSuffixList::siteKey(host), QStringLiteral("example.co.uk"));
+    QCOMPARE(PublicSuffixList::siteKey(u"10.0.0.1"), QStringLiteral("10.0.0.1"));
+    QCOMPARE(PublicSuffixList::siteKey(u"github.io"), QStringLiteral("github.io"));
+    QVERIFY(PublicSuffixList::isSameSite(u"docs.example.com", u"WWW.EXAMPLE.COM"));
+
+    const std::string_view ascii = PublicSuffixList::registrableDomain(std::string_view("ads.tracker.co.uk"));
+    QCOMPARE(QByteArray(ascii.data(), qsizetype(ascii.size())), QByteArray("tracker.co.uk"));
+  }
+};
+
+QTEST_GUILESS_MAIN(TestPublicSuffixList)
+
+#include "TestPublicSuffixList.moc"
@@ -0,0 +1,324 @@
+#include <QtTest/QtTest>
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+
+#include "core/DownloadModel.h"
+#include "core/SegmentedDownloader.h"
+
+namespace
+{
+QByteArray makePayload(int size)
+{
+  QByteArray payload(size, Qt::Uninitialized);
+  for (int i = 0; i < size; ++i) {
+    payload[i] = char((i * 31 + i / 977) & 0xff);
+  }
+  return payload;
+}
+
+QByteArray readFile(const QString& path)
+{
+  QFile file(path);
+  return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+}
+
+// A small HTTP/1.1 server that serves one payload, with or without ranges,
+// or redirects every request elsewhere.
+class RangeServer final : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit RangeServer(const QByteArray& payload)
+    : m_payload(payload)
+  {
+    connect(&m_server, &QTcpServer::newConnection, this, [this] {
+      while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket] {
+          onReadyRead(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+      }
+    });
+    m_server.listen(QHostAddress::LocalHost);
+  }
+
+  QUrl url() const
+  {
+    return QUrl(QStringLiteral("http://127.0.0.1:%1/file.bin").arg(m_server.serverPort()));
+  }
+
+  bool ignoreRanges = false;
+  // Sends only this much of each body and then goes quiet; -1 sends it all.
+  qint64 stallAfter = -1;
+  // Holds each response back so the segment requests overlap.
+  int delayMs = 50;
+  QUrl redirectTo;
+
+  QStringList ranges;
+  QStringList cookies;
+  QStringList ifRanges;
+  int stalled = 0;
+  int active = 0;
+  int maxActive = 0;
+
+private:
+  void onReadyRead(QTcpSocket* socket)
+  {
+    QByteArray& buffer = m_buffers[socket];
+    buffer += socket->readAll();
+    const int end = buffer.indexOf("\r\n\r\n");
+    if (end < 0) {
+      return;
+    }
+
+    QByteArray range;
+    QByteArray ifRange;
+    QByteArray cookie;
+    for (const QByteArray& line : buffer.left(end).split('\n')) {
+      const QByteArray trimmed = line.trimmed();
+      if (trimmed.toLower().startsWith("range:")) {
+        range = trimmed.mid(6).trimmed();
+      } else if (trimmed.toLower().startsWith("if-range:")) {
+        ifRange = trimmed.mid(9).trimmed();
+      } else if (trimmed.toLower().startsWith("cookie:")) {
+        cookie = trimmed.mid(7).trimmed();
+      }
+    }
+    m_buffers.remove(socket);
+    ranges.push_back(QString::fromLatin1(range));
+    ifRanges.push_back(QString::fromLatin1(ifRange));
+    cookies.push_back(QString::fromLatin1(cookie));
+
+    maxActive = qMax(maxActive, ++active);
+    QTimer::singleShot(delayMs, socket, [this, socket, range] {
+      respond(socket, range);
+    });
+  }
+
+  void respond(QTcpSocket* socket, const QByteArray& range)
+  {
+    if (redirectTo.isValid()) {
+      socket->write("HTTP/1.1 302 Found\r\nLocation: " + redirectTo.toEncoded()
+                    + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      socket->disconnectFromHost();
+      --active;
+      return;
+    }
+
+    const qint64 total = m_payload.size();
+    qint64 first = 0;
+    qint64 last = total - 1;
+    QByteArray head;
+    if (!range.isEmpty() && !ignoreRanges) {
+      const QByteArray spec = range.mid(range.indexOf('=') + 1);
+      first = spec.left(spec.indexOf('-')).toLongLong();
+      const QByteArray tail = spec.mid(spec.indexOf('-') + 1);
+      last = tail.isEmpty() ? total - 1 : qMin(total - 1, tail.toLongLong());
+      head = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + QByteArray::number(first) + '-'
+             + QByteArray::number(last) + '/' + QByteArray::number(total) + "\r\n";
+    } else {
+      head = "HTTP/1.1 200 OK\r\n";
+    }
+    const QByteArray body = m_payload.mid(first, last - first + 1);
+    head += "ETag: \"v1\"\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\nConnection: close\r\n\r\n";
+
+    if (stallAfter >= 0 && body.size() > stallAfter) {
+      socket->write(head + body.left(stallAfter));
+      ++stalled;
+      return;
+    }
+    socket->write(head + body);
+    socket->disconnectFromHost();
+    --active;
+  }
+
+  QTcpServer m_server;
+  QByteArray m_payload;
+  QHash<QTcpSocket*, QByteArray> m_buffers;
+};
+
+class TestSegmentedDownloader final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void start_fetchesRangesInParallel()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const QByteArray payload = makePayload(1024 * 1024);
+    RangeServer server(payload);
+    DownloadModel downloads;
+    SegmentedDownloader downloader;
+    downloader.setDownloads(&downloads);
+    downloader.setMinSegmentBytes(64 * 1024);
+    QSignalSpy finished(&downloader, &SegmentedDownloader::finished);
+
+    const QString path = dir.filePath("file.bin");
+    const QString sha = QString::fromLatin1(QCryptographicHash::hash(payload, QCryptographicHash::Sha256).toHex());
+    const int id = downloader.start(server.url(), path, {}, sha);
+    QVERIFY(id > 0);
+    QVERIFY(downloader.handles(id));
+
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.at(0).at(0).toInt(), id);
+    QVERIFY2(finished.at(0).at(1).toBool(), qPrintable(finished.at(0).at(2).toString()));
+    QVERIFY(!downloader.handles(id));
+
+    QCOMPARE(readFile(path), payload);
+    QVERIFY(!QFile::exists(path + ".part"));
+
+    // The probe, then one request per quarter.
+    QCOMPARE(server.ranges.size(), 5);
+    QCOMPARE(server.ranges.at(0), QStringLiteral("bytes=0-0"));
+    QVERIFY(server.ranges.contains(QStringLiteral("bytes=0-262143")));
+    QVERIFY(server.ranges.contains(QStringLiteral("bytes=786432-1048575")));
+    QVERIFY(server.maxActive >= 2);
+
+    const QModelIndex idx = downloads.index(0, 0);
+    QCOMPARE(downloads.data(idx, DownloadModel::StateRole).toString(), QStringLiteral("completed"));
+    QCOMPARE(downloads.data(idx, DownloadModel::BytesReceivedRole).toLongLong(), qint64(payload.size()));
+  }
+
+  void start_keepsCookiesFromRedirectTarget()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    // Another port is another origin, like a site handing off to its CDN.
+    const QByteArray payload = makePayload(256 * 1024);
+    RangeServer cdn(payload);
+    RangeServer site(payload);
+    site.redirectTo = cdn.url();
+    DownloadModel downloads;
+    SegmentedDownloader downloader;
+    downloader.setDownloads(&downloads);
+    downloader.setMinSegmentBytes(64 * 1024);
+    QSignalSpy finished(&downloader, &SegmentedDownloader::finished);
+
+    const QString path = dir.filePath("cdn.bin");
+    QVERIFY(downloader.start(site.url(), path, QStringLiteral("session=secret")) > 0);
+    QVERIFY(finished.wait(10000));
+    QVERIFY2(finished.at(0).at(1).toBool(), qPrintable(finished.at(0).at(2).toString()));
+    QCOMPARE(readFile(path), payload);
+
+    QCOMPARE(site.cookies, QStringList{QStringLiteral("session=secret")});
+    QCOMPARE(cdn.cookies.size(), 5);
+    for (const QString& cookie : std::as_const(cdn.cookies)) {
+      QVERIFY2(cookie.isEmpty(), qPrintable(cookie));
+    }
+  }
+
+  void start_fallsBackToOneStreamWithoutRanges()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const QByteArray payload = makePayload(300 * 1024);
+    RangeServer server(payload);
+    server.ignoreRanges = true;
+    DownloadModel downloads;
+    SegmentedDownloader downloader;
+    downloader.setDownloads(&downloads);
+    downloader.setMinSegmentBytes(16 * 1024);
+    QSignalSpy finished(&downloader, &SegmentedDownloader::finished);
+
+    const QString path = dir.filePath("plain.bin");
+    QVERIFY(downloader.start(server.url(), path) > 0);
+    QVERIFY(finished.wait(10000));
+    QVERIFY(finished.at(0).at(1).toBool());
+    QCOMPARE(readFile(path), payload);
+
+    QCOMPARE(server.ranges.size(), 2);
+    QVERIFY(server.ranges.at(1).isEmpty());
+  }
+
+  void restorePending_resumesEachRangeWhereItStopped()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const QByteArray payload = makePayload(512 * 1024);
+    RangeServer server(payload);
+    server.stallAfter = 20000;
+    DownloadModel downloads;
+    const QString path = dir.filePath("resume.bin");
+
+    int id = 0;
+    {
+      SegmentedDownloader downloader;
+      downloader.setDownloads(&downloads);
+      downloader.setMinSegmentBytes(64 * 1024);
+      id = downloader.start(server.url(), path);
+      QVERIFY(id > 0);
+
+      QTRY_COMPARE_WITH_TIMEOUT(server.stalled, 4, 10000);
+      // Let the stalled bytes reach the file; pausing reports exact progress.
+      QTest::qWait(500);
+      QVERIFY(downloader.pause(id));
+      const QModelIndex idx = downloads.index(0, 0);
+      QVERIFY(downloads.data(idx, DownloadModel::PausedRole).toBool());
+      QCOMPARE(downloads.data(idx, DownloadModel::BytesReceivedRole).toLongLong(), qint64(4 * 20000));
+    }
+    QVERIFY(QFile::exists(path + ".part"));
+
+    const int requestsBefore = server.ranges.size();
+    server.stallAfter = -1;
+    SegmentedDownloader downloader;
+    downloader.setDownloads(&downloads);
+    QCOMPARE(downloader.restorePending(), 1);
+    QVERIFY(downloader.handles(id));
+
+    QSignalSpy finished(&downloader, &SegmentedDownloader::finished);
+    QVERIFY(downloader.resume(id));
+    QVERIFY(finished.wait(10000));
+    QVERIFY2(finished.at(0).at(1).toBool(), qPrintable(finished.at(0).at(2).toString()));
+    QCOMPARE(readFile(path), payload);
+
+    // No probe this time, and every range picks up after its first 20000 bytes.
+    const QStringList resumed = server.ranges.mid(requestsBefore);
+    QCOMPARE(resumed.size(), 4);
+    QVERIFY(resumed.contains(QStringLiteral("bytes=20000-131071")));
+    QVERIFY(resumed.contains(QStringLiteral("bytes=413216-524287")));
+    for (const QString& ifRange : server.ifRanges.mid(requestsBefore)) {
+      QCOMPARE(ifRange, QStringLiteral("\"v1\""));
+    }
+  }
+
+  void start_rejectsChecksumMismatch()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    RangeServer server(makePayload(10 * 1024));
+    DownloadModel downloads;
+    SegmentedDownloader downloader;
+    downloader.setDownloads(&downloads);
+    QSignalSpy finished(&downloader, &SegmentedDownloader::finished);
+
+    const QString path = dir.filePath("bad.bin");
+    QVERIFY(downloader.start(server.url(), path, {}, QString(64, QLatin1Char('0'))) > 0);
+    QVERIFY(finished.wait(10000));
+    QVERIFY(!finished.at(0).at(1).toBool());
+    QCOMPARE(finished.at(0).at(2).toString(), QStringLiteral("Checksum mismatch"));
+    QVERIFY(!QFile::exists(path));
+    QVERIFY(!QFile::exists(path + ".part"));
+    QCOMPARE(downloads.data(downloads.index(0, 0), DownloadModel::StateRole).toString(), QStringLiteral("failed"));
+  }
+};
+
+QTEST_GUILESS_MAIN(TestSegmentedDownloader)
+#include "TestSegmentedDownloader.moc"
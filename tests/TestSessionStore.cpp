@@ -5,6 +5,7 @@
 #include "core/BrowserController.h"
 #include "core/SessionStore.h"
 #include "core/SplitViewController.h"
+#include "core/WindowManager.h"
 
 class TestSessionStore final : public QObject
 {
@@ -247,6 +248,68 @@ private slots:
     }
   }
 
+  void saveAndRestore_roundTripsEveryWindow()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    {
+      WindowManager windows;
+      windows.createWindow();
+
+      SessionStore store;
+      store.attach(&windows);
+      QCOMPARE(windows.count(), 1);
+
+      const int first = windows.windowIds().first();
+      windows.browser(first)->newTab(QUrl("https://first.example"));
+
+      const int second = windows.openWindow(QUrl("https://second.example"));
+      windows.browser(second)->newTab(QUrl("https://third.example"));
+      windows.splitView(second)->setEnabled(true);
+      windows.setActiveWindowId(second);
+
+      QString error;
+      QVERIFY(store.saveNow(&error));
+      QCOMPARE(error, QString());
+    }
+
+    {
+      WindowManager windows;
+      windows.createWindow();
+
+      SessionStore store;
+      store.attach(&windows);
+      QCOMPARE(windows.count(), 2);
+
+      const QVector<int> ids = windows.windowIds();
+      TabModel* firstTabs = windows.browser(ids.at(0))->tabs();
+      QCOMPARE(firstTabs->count(), 1);
+      QCOMPARE(firstTabs->urlAt(0), QUrl("https://first.example"));
+      QVERIFY(!windows.splitView(ids.at(0))->enabled());
+
+      TabModel* secondTabs = windows.browser(ids.at(1))->tabs();
+      QCOMPARE(secondTabs->count(), 2);
+      QCOMPARE(secondTabs->urlAt(0), QUrl("https://second.example"));
+      QCOMPARE(secondTabs->urlAt(1), QUrl("https://third.example"));
+      QVERIFY(windows.splitView(ids.at(1))->enabled());
+      QCOMPARE(windows.activeWindowId(), ids.at(1));
+    }
+
+    // A single-window host still reads the first window.
+    {
+      BrowserController browser;
+      SplitViewController split;
+      split.setBrowser(&browser);
+
+      SessionStore store;
+      store.attach(&browser, &split);
+      QCOMPARE(browser.tabs()->count(), 1);
+      QCOMPARE(browser.tabs()->urlAt(0), QUrl("https://first.example"));
+    }
+  }
+
   void recentlyClosed_enforcesLimitAndOrder()
   {
     QTemporaryDir dir;
@@ -62,6 +62,34 @@ private slots:
     QCOMPARE(store.decision(QStringLiteral("https://b.example"), 2), 1);
   }
 
+  void clearSite_removesEveryOriginOfTheRegistrableDomain()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    SitePermissionsStore& store = SitePermissionsStore::instance();
+    store.reload();
+    store.clearAll();
+
+    QCOMPARE(SitePermissionsStore::siteForOrigin(QStringLiteral("https://mail.example.co.uk:8443/inbox")),
+             QStringLiteral("example.co.uk"));
+
+    store.setDecision(QStringLiteral("https://www.example.co.uk/"), 1, 1);
+    store.setDecision(QStringLiteral("https://mail.example.co.uk:8443/"), 2, 2);
+    store.setDecision(QStringLiteral("https://other.co.uk/"), 1, 1);
+    store.setDecision(QStringLiteral("https://alice.github.io/"), 1, 1);
+    store.setDecision(QStringLiteral("https://bob.github.io/"), 1, 2);
+
+    QCOMPARE(store.clearSite(QStringLiteral("https://example.co.uk/settings")), 2);
+    QCOMPARE(store.decision(QStringLiteral("https://www.example.co.uk"), 1), 0);
+    QCOMPARE(store.decision(QStringLiteral("https://mail.example.co.uk:8443"), 2), 0);
+    QCOMPARE(store.decision(QStringLiteral("https://other.co.uk"), 1), 1);
+
+    QCOMPARE(store.clearSite(QStringLiteral("https://alice.github.io")), 1);
+    QCOMPARE(store.decision(QStringLiteral("https://bob.github.io"), 1), 2);
+  }
+
   void clearAll_removesAllOrigins()
   {
     QTemporaryDir dir;
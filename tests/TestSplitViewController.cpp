@@ -20,6 +20,52 @@ private slots:
     QVERIFY(qAbs(split.gridSplitRatioY() - 0.1) < 0.0001);
   }
 
+  void dividerDrag_movesLiveRatioUntilCommit()
+  {
+    SplitViewController split;
+    QSignalSpy committedSpy(&split, &SplitViewController::gridSplitRatioXChanged);
+    QSignalSpy liveSpy(&split, &SplitViewController::liveGridSplitRatioXChanged);
+
+    split.beginDividerDrag(SplitViewController::GridXDivider);
+    QVERIFY(split.dividerDragActive());
+    for (int i = 1; i <= 20; ++i) {
+      split.updateDividerDrag(0.5 + i * 0.01);
+    }
+    QVERIFY(qAbs(split.liveGridSplitRatioX() - 0.7) < 0.0001);
+    QVERIFY(qAbs(split.gridSplitRatioX() - 0.5) < 0.0001);
+    QVERIFY(qAbs(split.liveSplitRatio() - 0.5) < 0.0001);
+    QCOMPARE(liveSpy.count(), 20);
+    QCOMPARE(committedSpy.count(), 0);
+
+    split.commitDividerDrag();
+    QVERIFY(!split.dividerDragActive());
+    QCOMPARE(committedSpy.count(), 1);
+    QVERIFY(qAbs(split.gridSplitRatioX() - 0.7) < 0.0001);
+    QVERIFY(qAbs(split.liveGridSplitRatioX() - 0.7) < 0.0001);
+  }
+
+  void dividerDrag_cancelKeepsCommittedRatio()
+  {
+    SplitViewController split;
+    split.setSplitRatio(0.4);
+    QSignalSpy committedSpy(&split, &SplitViewController::splitRatioChanged);
+    QSignalSpy liveSpy(&split, &SplitViewController::liveSplitRatioChanged);
+
+    split.beginDividerDrag(SplitViewController::SplitDivider);
+    split.updateDividerDrag(5.0);
+    QVERIFY(qAbs(split.liveSplitRatio() - 0.9) < 0.0001);
+
+    split.cancelDividerDrag();
+    QCOMPARE(committedSpy.count(), 0);
+    QCOMPARE(liveSpy.count(), 2);
+    QVERIFY(qAbs(split.liveSplitRatio() - 0.4) < 0.0001);
+
+    // Direct writes, e.g. a double-click reset, still go straight through.
+    split.setSplitRatio(0.5);
+    QCOMPARE(committedSpy.count(), 1);
+    QCOMPARE(liveSpy.count(), 3);
+  }
+
   void enableWithPaneCount_createsUniqueTabs()
   {
     BrowserController browser;
@@ -2,10 +2,12 @@
 
 #include <QDir>
 #include <QFile>
+#include <QImage>
 #include <QTemporaryDir>
 
 #include "core/BrowserController.h"
 #include "core/TabModel.h"
+#include "core/ThumbnailStore.h"
 
 class TestTabModel final : public QObject
 {
@@ -292,7 +294,7 @@ private slots:
     QCOMPARE(browser.tabs()->groupIdAt(tabIndex), 0);
   }
 
-  void thumbnailCache_evictsLeastRecentlyUsedAndDeletesFiles()
+  void thumbnailCache_evictsLeastRecentlyUsedWithinByteBudget()
   {
     QTemporaryDir dir;
     QVERIFY(dir.isValid());
@@ -301,33 +303,58 @@ private slots:
     QDir base(dir.path());
     QVERIFY(base.mkpath("thumbnails"));
 
+    ThumbnailStore& store = ThumbnailStore::instance();
+    const qint64 previousBudget = store.byteBudget();
+
     TabModel model;
-    for (int i = 0; i < 40; ++i) {
+    const auto captureFor = [&base](int tabId) {
+      QImage image(1280, 720, QImage::Format_RGB32);
+      image.fill(QColor::fromHsv((tabId * 37) % 360, 200, 200));
+      const QString path = base.filePath(QStringLiteral("thumbnails/tab_%1.png").arg(tabId));
+      return image.save(path) ? path : QString();
+    };
+
+    const int firstIdx = model.addTab(QUrl(QStringLiteral("https://example.com/first")));
+    const int firstTabId = model.tabIdAt(firstIdx);
+    const QString firstCapture = captureFor(firstTabId);
+    QVERIFY(!firstCapture.isEmpty());
+    model.setThumbnailPathById(firstTabId, firstCapture);
+    QVERIFY(store.waitForIdle(10000));
+
+    QVERIFY(!model.thumbnailUrlAt(firstIdx).isEmpty());
+    QVERIFY(!QFile::exists(firstCapture));
+    QVERIFY(store.bytesUsed() > 0);
+
+    store.setByteBudget(store.bytesUsed() * 3);
+
+    QSignalSpy dataChangedSpy(&model, &QAbstractItemModel::dataChanged);
+    for (int i = 0; i < 6; ++i) {
       const int idx = model.addTab(QUrl(QStringLiteral("https://example.com/%1").arg(i)));
-      QVERIFY(idx >= 0);
       const int tabId = model.tabIdAt(idx);
-      QVERIFY(tabId > 0);
+      const QString capture = captureFor(tabId);
+      QVERIFY(!capture.isEmpty());
+      model.setThumbnailPathById(tabId, capture);
+      QVERIFY(store.waitForIdle(10000));
+      model.markThumbnailUsedById(firstTabId);
+    }
 
-      const QString path = base.filePath(QStringLiteral("thumbnails/tab_%1.png").arg(tabId));
-      QFile f(path);
-      QVERIFY(f.open(QIODevice::WriteOnly));
-      QVERIFY(f.write("x") > 0);
-      f.close();
+    QVERIFY(store.bytesUsed() <= store.byteBudget());
+    QVERIFY(dataChangedSpy.count() > 0);
 
-      model.setThumbnailPathById(tabId, path);
-    }
+    const QUrl firstUrl = model.data(model.index(firstIdx, 0), TabModel::ThumbnailUrlRole).toUrl();
+    QVERIFY(firstUrl.isLocalFile());
 
-    int withThumb = 0;
-    for (int i = 0; i < model.count(); ++i) {
-      const QUrl url = model.data(model.index(i, 0), TabModel::ThumbnailUrlRole).toUrl();
-      if (!url.isEmpty()) {
-        ++withThumb;
-      }
-    }
-    QCOMPARE(withThumb, 30);
+    const QUrl evictedUrl = model.data(model.index(1, 0), TabModel::ThumbnailUrlRole).toUrl();
+    QVERIFY(!evictedUrl.isLocalFile());
+
+    const QUrl newestUrl = model.data(model.index(model.count() - 1, 0), TabModel::ThumbnailUrlRole).toUrl();
+    QVERIFY(newestUrl.isLocalFile());
+    QVERIFY(QFile::exists(newestUrl.toLocalFile()));
+
+    model.closeTab(model.count() - 1);
+    QVERIFY(!QFile::exists(newestUrl.toLocalFile()));
 
-    QVERIFY(!QFile::exists(base.filePath(QStringLiteral("thumbnails/tab_1.png"))));
-    QVERIFY(QFile::exists(base.filePath(QStringLiteral("thumbnails/tab_40.png"))));
+    store.setByteBudget(previousBudget);
   }
 };
 
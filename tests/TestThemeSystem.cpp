@@ -1,11 +1,13 @@
 #include <QtTest/QtTest>
 
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QTemporaryDir>
 
+#include "BenchmarkSize.h"
 #include "core/AppSettings.h"
 #include "core/ThemeController.h"
 #include "core/ThemePackModel.h"
@@ -53,6 +55,87 @@ private slots:
     QCOMPARE(tokens.spacing, 11);
   }
 
+  void themePacks_catalogIndexSkipsUnchangedPacks()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    QDir().mkpath(dir.filePath("themes"));
+
+    const int kThemeCount = benchmarkSize(500, 20);
+    for (int i = 0; i < kThemeCount; ++i) {
+      QJsonObject obj;
+      obj.insert("id", QStringLiteral("bench-%1").arg(i, 3, 10, QLatin1Char('0')));
+      obj.insert("name", QStringLiteral("Bench %1").arg(i));
+      obj.insert("version", "1.0.0");
+      obj.insert("description", QString(256, QLatin1Char('x')));
+      obj.insert("accentColor", "#336699");
+      obj.insert("backgroundFrom", "#111111");
+      obj.insert("backgroundTo", "#222222");
+
+      QFile out(dir.filePath(QStringLiteral("themes/bench-%1.json").arg(i, 3, 10, QLatin1Char('0'))));
+      QVERIFY(out.open(QIODevice::WriteOnly));
+      out.write(QJsonDocument(obj).toJson(QJsonDocument::Indented));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 coldConstructMs = 0;
+    {
+      ThemePackModel cold;
+      coldConstructMs = timer.elapsed();
+      QVERIFY(cold.waitForScan(60000));
+      QCOMPARE(cold.lastScanParsedCount(), kThemeCount);
+      QCOMPARE(cold.count(), kThemeCount + 2);
+    }
+    const qint64 coldMs = timer.elapsed();
+
+    timer.restart();
+    ThemePackModel warm;
+    const qint64 warmConstructMs = timer.elapsed();
+    QCOMPARE(warm.count(), kThemeCount + 2);
+    QVERIFY(warm.waitForScan(60000));
+    const qint64 warmMs = timer.elapsed();
+    QCOMPARE(warm.lastScanParsedCount(), 0);
+
+    qInfo().noquote() << QStringLiteral("%1 theme packs: cold %2 ms (constructor %3 ms), warm %4 ms (constructor %5 ms)")
+                           .arg(kThemeCount)
+                           .arg(coldMs)
+                           .arg(coldConstructMs)
+                           .arg(warmMs)
+                           .arg(warmConstructMs);
+
+    xbrowser::ThemeTokens before;
+    QVERIFY(warm.tokensForThemeId("bench-007", &before));
+    QCOMPARE(before.accentColor, QColor("#336699"));
+
+    QJsonObject changed;
+    changed.insert("id", "bench-007");
+    changed.insert("name", "Renamed Bench");
+    changed.insert("version", "2.0.0");
+    changed.insert("accentColor", "#ff00ff");
+    QFile out(dir.filePath("themes/bench-007.json"));
+    QVERIFY(out.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    out.write(QJsonDocument(changed).toJson(QJsonDocument::Compact));
+    out.close();
+
+    warm.refresh();
+    QVERIFY(warm.waitForScan(60000));
+    QCOMPARE(warm.lastScanParsedCount(), 1);
+
+    xbrowser::ThemeTokens after;
+    QVERIFY(warm.tokensForThemeId("bench-007", &after));
+    QCOMPARE(after.name, QStringLiteral("Renamed Bench"));
+    QCOMPARE(after.accentColor, QColor("#ff00ff"));
+
+    QVERIFY(QFile::remove(dir.filePath("themes/bench-000.json")));
+    warm.refresh();
+    QVERIFY(warm.waitForScan(60000));
+    QCOMPARE(warm.count(), kThemeCount + 1);
+    QVERIFY(!warm.tokensForThemeId("bench-000", &after));
+  }
+
   void themeController_appliesSelectedTheme()
   {
     QTemporaryDir dir;
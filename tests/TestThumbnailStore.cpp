@@ -0,0 +1,123 @@
+#include <QtTest/QtTest>
+
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "core/ThumbnailStore.h"
+
+class TestThumbnailStore final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static QString writeCapture(const QDir& base, int tabId, int width = 1600, int height = 900)
+  {
+    QImage image(width, height, QImage::Format_ARGB32);
+    image.fill(QColor::fromHsv((tabId * 53) % 360, 180, 220));
+    const QString path = base.filePath(QStringLiteral("thumbnails/capture_%1.png").arg(tabId));
+    return image.save(path) ? path : QString();
+  }
+
+private slots:
+  void init()
+  {
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    qputenv("XBROWSER_DATA_DIR", m_dir->path().toUtf8());
+    QVERIFY(QDir(m_dir->path()).mkpath("thumbnails"));
+  }
+
+  void cleanup()
+  {
+    ThumbnailStore& store = ThumbnailStore::instance();
+    store.waitForIdle(10000);
+    store.removeOwner(1);
+    store.setByteBudget(24LL * 1024LL * 1024LL);
+    store.setPlaceholdersEnabled(true);
+    m_dir.reset();
+  }
+
+  void submit_downscalesAndRemovesCapture()
+  {
+    ThumbnailStore& store = ThumbnailStore::instance();
+    const QDir base(m_dir->path());
+
+    const QString capture = writeCapture(base, 1);
+    QVERIFY(!capture.isEmpty());
+
+    const quint64 key = ThumbnailStore::makeKey(1, 1);
+    QSignalSpy changedSpy(&store, &ThumbnailStore::thumbnailChanged);
+    store.submit(key, capture);
+    QVERIFY(store.waitForIdle(10000));
+
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.at(0).at(0).toULongLong(), key);
+    QVERIFY(!QFile::exists(capture));
+    QVERIFY(store.hasDiskThumbnail(key));
+    QVERIFY(store.hasPlaceholder(key));
+
+    const QUrl url = store.urlFor(key);
+    QVERIFY(url.isLocalFile());
+    const QImage stored(url.toLocalFile());
+    QVERIFY(!stored.isNull());
+    QVERIFY(stored.width() <= 640);
+    QVERIFY(stored.height() <= 360);
+  }
+
+  void budget_evictsLeastRecentlyUsedToPlaceholderTier()
+  {
+    ThumbnailStore& store = ThumbnailStore::instance();
+    const QDir base(m_dir->path());
+
+    store.submit(ThumbnailStore::makeKey(1, 1), writeCapture(base, 1));
+    QVERIFY(store.waitForIdle(10000));
+    const qint64 perThumbnail = store.bytesUsed();
+    QVERIFY(perThumbnail > 0);
+
+    store.setByteBudget(perThumbnail * 3 + perThumbnail / 2);
+
+    for (int tabId = 2; tabId <= 5; ++tabId) {
+      store.submit(ThumbnailStore::makeKey(1, tabId), writeCapture(base, tabId));
+      QVERIFY(store.waitForIdle(10000));
+      store.touch(ThumbnailStore::makeKey(1, 1));
+    }
+
+    QVERIFY(store.bytesUsed() <= store.byteBudget());
+    QVERIFY(store.hasDiskThumbnail(ThumbnailStore::makeKey(1, 1)));
+    QVERIFY(store.hasDiskThumbnail(ThumbnailStore::makeKey(1, 5)));
+    QVERIFY(!store.hasDiskThumbnail(ThumbnailStore::makeKey(1, 2)));
+
+    QVERIFY(store.hasPlaceholder(ThumbnailStore::makeKey(1, 2)));
+    QVERIFY(store.urlFor(ThumbnailStore::makeKey(1, 2)).scheme() == QStringLiteral("data"));
+
+    store.setPlaceholdersEnabled(false);
+    QVERIFY(store.urlFor(ThumbnailStore::makeKey(1, 2)).isEmpty());
+    QCOMPARE(store.placeholderCount(), 0);
+  }
+
+  void remove_discardsPendingResultAndDeletesFile()
+  {
+    ThumbnailStore& store = ThumbnailStore::instance();
+    const QDir base(m_dir->path());
+    const quint64 key = ThumbnailStore::makeKey(1, 7);
+
+    store.submit(key, writeCapture(base, 7));
+    store.remove(key);
+    QVERIFY(store.waitForIdle(10000));
+
+    QVERIFY(!store.hasDiskThumbnail(key));
+    QVERIFY(store.urlFor(key).isEmpty());
+    QCOMPARE(QDir(base.filePath("thumbnails")).entryList(QDir::Files).size(), 0);
+  }
+
+private:
+  std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+QTEST_GUILESS_MAIN(TestThumbnailStore)
+
+#include "TestThumbnailStore.moc"
@@ -0,0 +1,189 @@
+#include <QtTest/QtTest>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QImage>
+#include <QTemporaryDir>
+
+#include "core/HistoryStore.h"
+#include "core/TopSitesModel.h"
+
+namespace
+{
+constexpr qint64 kDayMs = 24LL * 60LL * 60LL * 1000LL;
+
+void addVisits(HistoryStore& history, const QUrl& url, const QString& title, qint64 fromMs, int count)
+{
+  for (int i = 0; i < count; ++i) {
+    history.addVisit(url, title, fromMs + i * 60000LL);
+  }
+}
+
+QStringList sitesOf(const TopSitesModel& model)
+{
+  QStringList sites;
+  for (int i = 0; i < model.rowCount(); ++i) {
+    sites.push_back(model.index(i).data(TopSitesModel::SiteRole).toString());
+  }
+  return sites;
+}
+}
+
+class TestTopSitesModel final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void visits_rankByDecayedFrequency()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    TopSitesModel model;
+    model.setHistory(&history);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    addVisits(history, QUrl("https://www.oldsite.com/"), "Old", now - 60 * kDayMs, 10);
+    addVisits(history, QUrl("https://mid.example.net/"), "Mid", now - 7 * kDayMs, 5);
+    addVisits(history, QUrl("https://news.example.org/a"), "A story", now - 10 * 60000LL, 2);
+    history.addVisit(QUrl("about:blank"), {}, now);
+
+    QCOMPARE(sitesOf(model), (QStringList{"example.net", "example.org", "oldsite.com"}));
+    QCOMPARE(model.count(), 3);
+
+    const QModelIndex mid = model.index(0);
+    QCOMPARE(mid.data(TopSitesModel::TitleRole).toString(), QStringLiteral("Mid"));
+    QCOMPARE(mid.data(TopSitesModel::UrlRole).toUrl(), QUrl("https://mid.example.net/"));
+    QCOMPARE(mid.data(TopSitesModel::VisitCountRole).toInt(), 5);
+
+    // Sites only seen on inner pages open at their origin.
+    const QModelIndex news = model.index(1);
+    QCOMPARE(news.data(TopSitesModel::UrlRole).toUrl(), QUrl("https://news.example.org/"));
+    QCOMPARE(news.data(TopSitesModel::TitleRole).toString(), QStringLiteral("news.example.org"));
+
+    model.setMaxCount(2);
+    QCOMPARE(sitesOf(model), (QStringList{"example.net", "example.org"}));
+    QCOMPARE(model.siteCount(), 3);
+  }
+
+  void historyRemovals_updateIncrementally()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    TopSitesModel model;
+    model.setHistory(&history);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    addVisits(history, QUrl("https://a.com/"), "A", now - 3600000LL, 3);
+    addVisits(history, QUrl("https://b.com/"), "B", now - 1800000LL, 2);
+    QCOMPARE(sitesOf(model), (QStringList{"a.com", "b.com"}));
+
+    history.removeAt(0);
+    history.removeAt(0);
+    QCOMPARE(sitesOf(model), (QStringList{"b.com", "a.com"}));
+    QCOMPARE(model.index(1).data(TopSitesModel::VisitCountRole).toInt(), 1);
+
+    history.removeAt(0);
+    QCOMPARE(sitesOf(model), QStringList{"b.com"});
+
+    history.clearAll();
+    QTRY_COMPARE(model.count(), 0);
+    QCOMPARE(model.siteCount(), 0);
+  }
+
+  void importedVisits_retitleStoredSites()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    TopSitesModel model;
+    model.setHistory(&history);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    addVisits(history, QUrl("https://a.com/"), "A", now - 3600000LL, 3);
+    addVisits(history, QUrl("https://b.com/"), "B", now - 1800000LL, 2);
+    const qint64 newestMs = now - 1800000LL + 60000LL;
+
+    // Newer than a.com's stored visits, so it renames the page, but older
+    // than b.com's, which it still lands after.
+    const qint64 importedMs = now - 3000000LL;
+    QCOMPARE(history.addVisits({{QUrl("https://a.com/"), "A renamed", importedMs}}), 1);
+    QCOMPARE(history.index(history.count() - 1).data(HistoryStore::VisitedMsRole).toLongLong(), importedMs);
+    QCOMPARE(history.newestVisitMs(), newestMs);
+
+    QCOMPARE(sitesOf(model), (QStringList{"a.com", "b.com"}));
+    QCOMPARE(model.index(0).data(TopSitesModel::TitleRole).toString(), QStringLiteral("A renamed"));
+    QCOMPARE(model.index(0).data(TopSitesModel::VisitCountRole).toInt(), 4);
+  }
+
+  void aggregateAndBlocklist_persist()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    addVisits(history, QUrl("https://a.com/"), "A", now - 3600000LL, 3);
+    addVisits(history, QUrl("https://b.com/"), "B", now - 1800000LL, 2);
+
+    {
+      TopSitesModel model;
+      model.setHistory(&history);
+      QCOMPARE(model.count(), 2);
+      model.block(QUrl("https://www.a.com/some/page"));
+      QCOMPARE(sitesOf(model), QStringList{"b.com"});
+      QCOMPARE(model.blockedSites(), QStringList{"a.com"});
+      QVERIFY(model.saveNow());
+    }
+
+    TopSitesModel model;
+    QCOMPARE(model.siteCount(), 2);
+    model.setHistory(&history);
+    QCOMPARE(sitesOf(model), QStringList{"b.com"});
+
+    // Blocked sites keep counting.
+    history.addVisit(QUrl("https://a.com/x"), "X", now);
+    QCOMPARE(sitesOf(model), QStringList{"b.com"});
+    model.unblock(QStringLiteral("a.com"));
+    QCOMPARE(sitesOf(model), (QStringList{"a.com", "b.com"}));
+    QCOMPARE(model.index(0).data(TopSitesModel::VisitCountRole).toInt(), 4);
+  }
+
+  void setThumbnail_keepsScaledCopyForShownSites()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    const QString capture = dir.filePath(QStringLiteral("capture.png"));
+    QImage image(1280, 800, QImage::Format_RGB32);
+    image.fill(Qt::darkGreen);
+    QVERIFY(image.save(capture));
+
+    HistoryStore history;
+    TopSitesModel model;
+    model.setHistory(&history);
+    history.addVisit(QUrl("https://a.com/"), "A", QDateTime::currentMSecsSinceEpoch());
+
+    model.setThumbnail(QUrl("https://b.com/"), capture);
+    model.setThumbnail(QUrl("https://a.com/page"), capture);
+    QVERIFY(model.waitForIdle(5000));
+    QTRY_VERIFY(!model.index(0).data(TopSitesModel::ThumbnailUrlRole).toUrl().isEmpty());
+
+    const QUrl thumbnail = model.index(0).data(TopSitesModel::ThumbnailUrlRole).toUrl();
+    QVERIFY(thumbnail.isLocalFile());
+    const QImage stored(thumbnail.toLocalFile());
+    QCOMPARE(stored.size(), QSize(320, 200));
+  }
+};
+
+QTEST_GUILESS_MAIN(TestTopSitesModel)
+#include "TestTopSitesModel.moc"
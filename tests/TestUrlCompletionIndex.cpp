@@ -0,0 +1,198 @@
+#include <QtTest/QtTest>
+
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include "BenchmarkSize.h"
+#include "core/BookmarksStore.h"
+#include "core/HistoryStore.h"
+#include "core/UrlCompletionIndex.h"
+
+class TestUrlCompletionIndex final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static void visit(HistoryStore& store, const QString& url, int times)
+  {
+    // Visits to the same URL within a few seconds collapse into one row.
+    static qint64 clockMs = 1000;
+    for (int i = 0; i < times; ++i) {
+      clockMs += 10000;
+      store.addVisit(QUrl(url), QString(), clockMs);
+    }
+  }
+
+private slots:
+  void complete_prefersTheMostVisitedHost()
+  {
+    UrlCompletionIndex index;
+    index.addUrl(QUrl("https://github.com/anthropics/repo"), 5);
+    index.addUrl(QUrl("https://gitlab.com/"), 2);
+
+    const UrlCompletionIndex::Completion completion = index.complete("git");
+    QVERIFY(completion.isValid());
+    QCOMPARE(completion.text, QStringLiteral("github.com/"));
+    QCOMPARE(completion.remainder, QStringLiteral("hub.com/"));
+    QCOMPARE(completion.url, QUrl("https://github.com/"));
+    QCOMPARE(completion.weight, 5);
+
+    QCOMPARE(index.complete("gitl").text, QStringLiteral("gitlab.com/"));
+  }
+
+  void complete_extendsPathSegments()
+  {
+    UrlCompletionIndex index;
+    index.addUrl(QUrl("https://github.com/anthropics/repo/issues?q=open#top"), 3);
+    index.addUrl(QUrl("https://github.com/another/"), 2);
+
+    QCOMPARE(index.complete("github.com/").text, QStringLiteral("github.com/anthropics/"));
+    QCOMPARE(index.complete("github.com/ano").text, QStringLiteral("github.com/another/"));
+    QCOMPARE(index.complete("github.com/anthropics/repo/").text, QStringLiteral("github.com/anthropics/repo/issues"));
+    QCOMPARE(index.complete("github.com/anthropics/repo/issues?").isValid(), false);
+  }
+
+  void complete_keepsTypedSchemeAndCase()
+  {
+    UrlCompletionIndex index;
+    index.addUrl(QUrl("https://www.Example.com/docs"), 2);
+
+    QCOMPARE(index.complete("exa").text, QStringLiteral("example.com/"));
+    QCOMPARE(index.complete("EXA").text, QStringLiteral("EXAmple.com/"));
+    QCOMPARE(index.complete("https://www.exa").text, QStringLiteral("https://www.example.com/"));
+    QCOMPARE(index.complete("example.com/").text, QStringLiteral("example.com/docs"));
+    QVERIFY(!index.complete("example.com/docs").isValid());
+    QVERIFY(!index.complete("exa mple").isValid());
+  }
+
+  void complete_requiresMinimumWeight()
+  {
+    UrlCompletionIndex index;
+    index.addUrl(QUrl("https://once.example/"));
+    QVERIFY(!index.complete("on").isValid());
+
+    index.addUrl(QUrl("https://once.example/"));
+    QCOMPARE(index.complete("on").text, QStringLiteral("once.example/"));
+
+    index.removeUrl(QUrl("https://once.example/"));
+    QVERIFY(!index.complete("on").isValid());
+    QVERIFY(index.inlineCompletion("on").isEmpty());
+
+    index.addUrl(QUrl("ftp://files.example/"), 10);
+    QVERIFY(!index.complete("fi").isValid());
+  }
+
+  void history_updatesIncrementallyAndOnReset()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    UrlCompletionIndex index;
+    index.setHistory(&history);
+
+    visit(history, "https://news.example/a", 2);
+    QCOMPARE(index.complete("ne").text, QStringLiteral("news.example/"));
+
+    visit(history, "https://netflix.example/", 3);
+    QCOMPARE(index.complete("ne").text, QStringLiteral("netflix.example/"));
+
+    history.removeAt(history.count() - 1);
+    history.removeAt(history.count() - 1);
+    QCOMPARE(index.complete("ne").text, QStringLiteral("news.example/"));
+
+    history.clearAll();
+    QVERIFY(!index.complete("ne").isValid());
+    QCOMPARE(index.entryCount(), 0);
+  }
+
+  void history_collapsedVisitsKeepTheirWeight()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    history.setRetentionDays(0);
+    visit(history, "https://news.example/a", 3);
+    visit(history, "https://netflix.example/", 2);
+
+    UrlCompletionIndex index;
+    index.setHistory(&history);
+    QCOMPARE(index.inlineCompletion("ne").value("weight").toInt(), 3);
+
+    // The visits are decades old, so each page collapses into one row.
+    QCOMPARE(history.applyRetention(), 3);
+    QCOMPARE(history.count(), 2);
+    QCOMPARE(index.complete("ne").text, QStringLiteral("news.example/"));
+    QCOMPARE(index.inlineCompletion("ne").value("weight").toInt(), 3);
+  }
+
+  void bookmarks_countAsSeveralVisits()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    BookmarksStore bookmarks;
+    bookmarks.addBookmark(QUrl("https://docs.example/guide"), "Guide");
+
+    HistoryStore history;
+    visit(history, "https://dev.example/", 3);
+
+    UrlCompletionIndex index;
+    index.setHistory(&history);
+    index.setBookmarks(&bookmarks);
+
+    QCOMPARE(index.complete("d").text, QStringLiteral("docs.example/"));
+    QCOMPARE(index.inlineCompletion("do").value("weight").toInt(), UrlCompletionIndex::kBookmarkWeight);
+
+    bookmarks.removeByUrl(QUrl("https://docs.example/guide"));
+    QCOMPARE(index.complete("d").text, QStringLiteral("dev.example/"));
+  }
+
+  void benchmark_buildAndComplete()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    HistoryStore history;
+    const int visits = benchmarkSize(10000, 1000);
+    for (int i = 0; i < visits; ++i) {
+      history.addVisit(QUrl(QStringLiteral("https://site%1.example/section%2/page%3").arg(i % 500).arg(i % 7).arg(i)),
+                       QString(), 1000 + qint64(i) * 10000);
+    }
+
+    UrlCompletionIndex index;
+    index.setHistory(&history);
+
+    QElapsedTimer timer;
+    timer.start();
+    const int entries = index.entryCount();
+    const qint64 buildMs = timer.elapsed();
+    QVERIFY(entries > 500);
+
+    const QStringList prefixes = { "s", "site1", "site42.ex", "site499.example/sec", "nothing" };
+    const int kRounds = benchmarkSize(2000, 50);
+    int hits = 0;
+    timer.restart();
+    for (int round = 0; round < kRounds; ++round) {
+      for (const QString& prefix : prefixes) {
+        hits += index.complete(prefix).isValid() ? 1 : 0;
+      }
+    }
+    const qint64 completeNs = timer.nsecsElapsed() / (kRounds * prefixes.size());
+    QCOMPARE(hits, kRounds * 4);
+
+    qInfo().noquote() << QStringLiteral("url completion: %1 entries built in %2 ms, %3 us per lookup")
+                           .arg(entries)
+                           .arg(buildMs)
+                           .arg(double(completeNs) / 1000.0, 0, 'f', 2);
+  }
+};
+
+QTEST_GUILESS_MAIN(TestUrlCompletionIndex)
+
+#include "TestUrlCompletionIndex.moc"
@@ -0,0 +1,144 @@
+#include <QtTest/QtTest>
+
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include "core/ModsModel.h"
+#include "core/UserCssCompiler.h"
+
+class TestUserCssCompiler final : public QObject
+{
+  Q_OBJECT
+
+private:
+  static QString sheetCss(const QVariantList& sheets, int index)
+  {
+    return sheets.at(index).toMap().value("css").toString();
+  }
+
+  static QString sheetHash(const QVariantList& sheets, int index)
+  {
+    return sheets.at(index).toMap().value("hash").toString();
+  }
+
+private slots:
+  void minify_stripsCommentsAndWhitespace()
+  {
+    const QString css = QStringLiteral(
+      "/* header */\n"
+      "body  >  main ,\n  nav {\n  color : red ;\n  content: \"a  /* b */  c\";\n}\n\n"
+      "a :hover { margin: 0 auto; }\n");
+
+    QCOMPARE(UserCssCompiler::minify(css),
+             QStringLiteral("body>main,nav{color :red;content:\"a  /* b */  c\"}a :hover{margin:0 auto}"));
+    QCOMPARE(UserCssCompiler::minify(QStringLiteral("  \n /* only */ ")), QString());
+  }
+
+  void compile_splitsGlobalAndDomainBlocks()
+  {
+    const QString css = QStringLiteral(
+      "body { background: black; }\n"
+      "@-moz-document domain(\"example.com\"), domain(other.org) {\n"
+      "  h1 { color: red; }\n"
+      "}\n"
+      "@-moz-document url-prefix(\"https://news.site/world\") { p { margin: 0; } }\n"
+      "@-moz-document regexp('https://.*\\\\.wiki/.*') { nav { display: none; } }\n"
+      "@-moz-document url-prefix(\"\") { a { color: blue; } }\n");
+
+    const UserCssCompiler::CompiledMod mod = UserCssCompiler::compile(css);
+    QCOMPARE(mod.globalCss, QStringLiteral("body{background:black}a{color:blue}"));
+    QCOMPARE(mod.blocks.size(), 3);
+
+    QStringList hosts = mod.hosts();
+    hosts.sort();
+    QCOMPARE(hosts, QStringList({"example.com", "news.site", "other.org"}));
+    QCOMPARE(mod.unindexedBlocks, QVector<int>({2}));
+
+    const UserCssCompiler::Block& domainBlock = mod.blocks.at(0);
+    QVERIFY(UserCssCompiler::blockMatches(domainBlock, QUrl("https://www.example.com/a")));
+    QVERIFY(UserCssCompiler::blockMatches(domainBlock, QUrl("https://other.org/")));
+    QVERIFY(!UserCssCompiler::blockMatches(domainBlock, QUrl("https://notexample.com/")));
+
+    const UserCssCompiler::Block& prefixBlock = mod.blocks.at(1);
+    QVERIFY(UserCssCompiler::blockMatches(prefixBlock, QUrl("https://news.site/world/today")));
+    QVERIFY(!UserCssCompiler::blockMatches(prefixBlock, QUrl("https://news.site/sports")));
+
+    QVERIFY(UserCssCompiler::blockMatches(mod.blocks.at(2), QUrl("https://docs.wiki/page")));
+  }
+
+  void compile_hashIsStableAcrossFormatting()
+  {
+    const UserCssCompiler::CompiledMod a =
+      UserCssCompiler::compile(QStringLiteral("@-moz-document domain(a.test) { h1 { color: red; } }"));
+    const UserCssCompiler::CompiledMod b =
+      UserCssCompiler::compile(QStringLiteral("@-moz-document domain(a.test) {\n  h1 {\n    color: red\n  }\n}\n"));
+
+    QVERIFY(a.sourceHash != b.sourceHash);
+    QCOMPARE(a.digestForHost("a.test"), b.digestForHost("a.test"));
+    QCOMPARE(a.globalDigest(), b.globalDigest());
+  }
+
+  void mods_sheetsForUrlOnlyIncludeRelevantRules()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    ModsModel mods;
+    mods.addMod("Global", "html { filter: none; }");
+    mods.addMod("Sites",
+                "@-moz-document domain(a.test) { h1 { color: red; } }\n"
+                "@-moz-document domain(b.test) { h2 { color: blue; } }");
+
+    const QVariantList onA = mods.sheetsForUrl(QUrl("https://www.a.test/"));
+    QCOMPARE(onA.size(), 2);
+    QCOMPARE(sheetCss(onA, 0), QStringLiteral("html{filter:none}"));
+    QCOMPARE(sheetCss(onA, 1), QStringLiteral("h1{color:red}"));
+
+    const QVariantList onC = mods.sheetsForUrl(QUrl("https://c.test/"));
+    QCOMPARE(onC.size(), 1);
+
+    const QVariantList onB = mods.sheetsForUrl(QUrl("https://b.test/"));
+    QCOMPARE(sheetCss(onB, 1), QStringLiteral("h2{color:blue}"));
+    QVERIFY(sheetHash(onA, 1) != sheetHash(onB, 1));
+  }
+
+  void mods_editReportsOnlyChangedHosts()
+  {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    qputenv("XBROWSER_DATA_DIR", dir.path().toUtf8());
+
+    ModsModel mods;
+    const int row = mods.addMod("Sites",
+                                "@-moz-document domain(a.test) { h1 { color: red; } }\n"
+                                "@-moz-document domain(b.test) { h2 { color: blue; } }");
+
+    const QString hashB = sheetHash(mods.sheetsForUrl(QUrl("https://b.test/")), 0);
+
+    QSignalSpy spy(&mods, &ModsModel::stylesChanged);
+    mods.setCssAt(row,
+                  "@-moz-document domain(a.test) { h1 { color: green; } }\n"
+                  "@-moz-document domain(b.test) {\n  h2 { color: blue }\n}");
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList({"a.test"}));
+    QCOMPARE(spy.at(0).at(1).toBool(), false);
+    QCOMPARE(sheetHash(mods.sheetsForUrl(QUrl("https://b.test/")), 0), hashB);
+
+    QVERIFY(mods.urlMatchesHosts(QUrl("https://sub.a.test/x"), {"a.test"}));
+    QVERIFY(!mods.urlMatchesHosts(QUrl("https://b.test/"), {"a.test"}));
+
+    mods.setCssAt(row, mods.cssAt(row) + "\nbody { margin: 0; }");
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(1).toBool(), true);
+
+    mods.setEnabledAt(row, false);
+    QCOMPARE(spy.count(), 3);
+    QVERIFY(mods.sheetsForUrl(QUrl("https://a.test/")).isEmpty());
+  }
+};
+
+QTEST_GUILESS_MAIN(TestUserCssCompiler)
+
+#include "TestUserCssCompiler.moc"
@@ -0,0 +1,138 @@
+#include <QtTest/QtTest>
+
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "core/BookmarksStore.h"
+#include "core/BrowserController.h"
+#include "core/DownloadModel.h"
+#include "core/HistoryStore.h"
+#include "core/HistoryTextIndex.h"
+#include "core/NavigationPredictor.h"
+#include "core/SessionStore.h"
+#include "core/SitePermissionsStore.h"
+#include "core/UserDataStorage.h"
+#include "core/WindowManager.h"
+
+class TestUserDataStorage final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void init()
+  {
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    qputenv("XBROWSER_DATA_DIR", m_dir->path().toUtf8());
+  }
+
+  void cleanup()
+  {
+    xbrowser::setUserDataStorage(nullptr);
+  }
+
+  void fileStorage_writesUnderDataDir()
+  {
+    xbrowser::UserDataStorage& storage = xbrowser::userDataStorage();
+    QVERIFY(!storage.exists(QStringLiteral("nested/blob.bin")));
+
+    QVERIFY(storage.write(QStringLiteral("nested/blob.bin"), QByteArray("payload")));
+    const QString path = QDir(m_dir->path()).filePath(QStringLiteral("nested/blob.bin"));
+    QCOMPARE(storage.localPath(QStringLiteral("nested/blob.bin")), path);
+    QVERIFY(QFileInfo::exists(path));
+
+    QByteArray data;
+    QVERIFY(storage.read(QStringLiteral("nested/blob.bin"), &data));
+    QCOMPARE(data, QByteArray("payload"));
+
+    QVERIFY(storage.remove(QStringLiteral("nested/blob.bin")));
+    QVERIFY(!QFileInfo::exists(path));
+  }
+
+  void memoryStorage_keepsStoresOffDisk()
+  {
+    xbrowser::setUserDataStorage(std::make_unique<xbrowser::MemoryUserDataStorage>());
+    QVERIFY(xbrowser::userDataStorage().localPath(QStringLiteral("history.json")).isEmpty());
+
+    {
+      HistoryStore history;
+      history.addVisit(QUrl("https://private.example/a"), QStringLiteral("A"));
+      QVERIFY(history.saveNow());
+
+      BookmarksStore bookmarks;
+      bookmarks.addBookmark(QUrl("https://private.example/b"), QStringLiteral("B"));
+      QVERIFY(bookmarks.saveNow());
+
+      DownloadModel downloads;
+      downloads.addStarted(QStringLiteral("https://private.example/file.zip"), QStringLiteral("C:/file.zip"));
+
+      SitePermissionsStore::instance().setDecision(QStringLiteral("https://private.example"), 1, 1);
+
+      WindowManager windows;
+      windows.openWindow(QUrl("https://private.example/c"));
+      SessionStore session;
+      session.attach(&windows);
+      QVERIFY(session.saveNow());
+      QVERIFY(windows.closedTabJournal()->storagePath().isEmpty());
+      windows.activeBrowser()->closeTab(0);
+    }
+
+    const QStringList written = QDir(m_dir->path()).entryList(
+      { QStringLiteral("*.json"), QStringLiteral("*.jsonl"), QStringLiteral("*.bin"), QStringLiteral("favicons") }, QDir::AllEntries);
+    QVERIFY2(written.isEmpty(), qPrintable(written.join(QStringLiteral(", "))));
+
+    // What the stores saved lives for the rest of the process.
+    HistoryStore history;
+    QCOMPARE(history.count(), 1);
+    BookmarksStore bookmarks;
+    QVERIFY(bookmarks.isBookmarked(QUrl("https://private.example/b")));
+    DownloadModel downloads;
+    QCOMPARE(downloads.count(), 1);
+    QCOMPARE(SitePermissionsStore::instance().decision(QStringLiteral("https://private.example"), 1), 1);
+  }
+
+  void memoryStorage_keepsDerivedIndexesOffDisk()
+  {
+    xbrowser::setUserDataStorage(std::make_unique<xbrowser::MemoryUserDataStorage>());
+
+    {
+      HistoryTextIndex text;
+      text.addPage(QUrl("https://private.example/a"), QStringLiteral("A"), QStringLiteral("private words"));
+
+      NavigationPredictor predictor;
+      predictor.recordNavigation(QUrl("https://private.example/a"), QUrl("https://private.example/b"));
+      QVERIFY(predictor.saveNow());
+    }
+
+    const QStringList written = QDir(m_dir->path()).entryList(QDir::AllEntries | QDir::NoDotAndDotDot);
+    QVERIFY2(written.isEmpty(), qPrintable(written.join(QStringLiteral(", "))));
+
+    // The predictions still last for the rest of the process.
+    NavigationPredictor predictor;
+    QCOMPARE(predictor.predictNext(QUrl("https://private.example/a")).size(), 1);
+  }
+
+  void memoryStorage_swapStartsEmpty()
+  {
+    xbrowser::setUserDataStorage(std::make_unique<xbrowser::MemoryUserDataStorage>());
+    SitePermissionsStore::instance().setDecision(QStringLiteral("https://gone.example"), 1, 2);
+    {
+      HistoryStore history;
+      history.addVisit(QUrl("https://gone.example/"));
+      QVERIFY(history.saveNow());
+    }
+
+    xbrowser::setUserDataStorage(std::make_unique<xbrowser::MemoryUserDataStorage>());
+    HistoryStore history;
+    QCOMPARE(history.count(), 0);
+    QCOMPARE(SitePermissionsStore::instance().decision(QStringLiteral("https://gone.example"), 1), 0);
+  }
+
+private:
+  std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+QTEST_GUILESS_MAIN(TestUserDataStorage)
+
+#include "TestUserDataStorage.moc"
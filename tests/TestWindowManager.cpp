@@ -0,0 +1,173 @@
+#include <QtTest/QtTest>
+
+#include <QTemporaryDir>
+
+#include <memory>
+
+#include "core/BrowserController.h"
+#include "core/SplitViewController.h"
+#include "core/WindowManager.h"
+
+class TestWindowManager final : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void init()
+  {
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    qputenv("XBROWSER_DATA_DIR", m_dir->path().toUtf8());
+  }
+
+  void windowsShareSettingsAndClosedTabs()
+  {
+    WindowManager windows;
+    const int first = windows.openWindow(QUrl("https://a.example"));
+    const int second = windows.openWindow(QUrl("https://b.example"));
+    QCOMPARE(windows.count(), 2);
+    QVERIFY(first != second);
+
+    BrowserController* a = windows.browser(first);
+    BrowserController* b = windows.browser(second);
+    QVERIFY(a && b && a != b);
+    QCOMPARE(a->settings(), windows.settings());
+    QCOMPARE(b->settings(), windows.settings());
+    QCOMPARE(a->closedTabJournal(), windows.closedTabJournal());
+    QVERIFY(a->workspaces() != b->workspaces());
+    QVERIFY(windows.splitView(first) != windows.splitView(second));
+
+    a->closeTab(0);
+    QCOMPARE(b->recentlyClosedCount(), 1);
+    QVERIFY(b->restoreLastClosedTab());
+    QCOMPARE(b->tabs()->count(), 2);
+    QCOMPARE(a->recentlyClosedCount(), 0);
+  }
+
+  void moveTabKeepsStateAndHandsOffView()
+  {
+    WindowManager windows;
+    const int source = windows.openWindow(QUrl("https://keep.example"));
+    const int target = windows.openWindow(QUrl("https://other.example"));
+
+    TabModel* sourceTabs = windows.browser(source)->tabs();
+    const int movedIndex = sourceTabs->addTab(QUrl("https://moved.example/page"));
+    sourceTabs->setTitleAt(movedIndex, QStringLiteral("Moved"));
+    sourceTabs->setCustomTitleAt(movedIndex, QStringLiteral("Pinned name"));
+    const int movedId = sourceTabs->tabIdAt(movedIndex);
+
+    QSignalSpy handoff(&windows, &WindowManager::tabHandoffRequested);
+    const int newId = windows.moveTabToWindow(source, movedId, target);
+    QVERIFY(newId > 0);
+
+    QCOMPARE(handoff.count(), 1);
+    QCOMPARE(handoff.at(0).at(0).toInt(), source);
+    QCOMPARE(handoff.at(0).at(1).toInt(), movedId);
+    const int token = handoff.at(0).at(2).toInt();
+    QVERIFY(token > 0);
+
+    QCOMPARE(sourceTabs->indexOfTabId(movedId), -1);
+    QCOMPARE(windows.browser(source)->recentlyClosedCount(), 0);
+
+    TabModel* targetTabs = windows.browser(target)->tabs();
+    const int index = targetTabs->indexOfTabId(newId);
+    QVERIFY(index >= 0);
+    QCOMPARE(targetTabs->activeIndex(), index);
+    QCOMPARE(targetTabs->urlAt(index), QUrl("https://moved.example/page"));
+    QCOMPARE(targetTabs->pageTitleAt(index), QStringLiteral("Moved"));
+    QCOMPARE(targetTabs->customTitleAt(index), QStringLiteral("Pinned name"));
+
+    // The target view claims the parked page exactly once.
+    QCOMPARE(windows.takeHandoffToken(target, newId), token);
+    QCOMPARE(windows.takeHandoffToken(target, newId), 0);
+  }
+
+  void moveTabAvoidsTabIdCollision()
+  {
+    WindowManager windows;
+    const int source = windows.openWindow(QUrl("https://one.example"));
+    const int target = windows.openWindow(QUrl("https://two.example"));
+    windows.browser(source)->newTab(QUrl("https://three.example"));
+
+    const int sourceId = windows.browser(source)->tabs()->tabIdAt(0);
+    QCOMPARE(windows.browser(target)->tabs()->tabIdAt(0), sourceId);
+
+    const int newId = windows.moveTabToWindow(source, sourceId, target);
+    QVERIFY(newId > 0);
+    QVERIFY(newId != sourceId);
+    QCOMPARE(windows.browser(target)->tabs()->count(), 2);
+    QVERIFY(windows.takeHandoffToken(target, newId) > 0);
+  }
+
+  void moveLastTabClosesSourceWindow()
+  {
+    WindowManager windows;
+    const int source = windows.openWindow(QUrl("https://only.example"));
+    const int tabId = windows.browser(source)->tabs()->tabIdAt(0);
+
+    QSignalSpy closed(&windows, &WindowManager::windowClosed);
+    const int newId = windows.moveTabToNewWindow(source, tabId);
+    QVERIFY(newId > 0);
+
+    QCOMPARE(closed.count(), 1);
+    QCOMPARE(closed.at(0).at(0).toInt(), source);
+    QCOMPARE(windows.count(), 1);
+    QVERIFY(!windows.hasWindow(source));
+    QCOMPARE(windows.activeBrowser()->tabs()->count(), 1);
+    QCOMPARE(windows.activeBrowser()->tabs()->urlAt(0), QUrl("https://only.example"));
+    QCOMPARE(windows.closedTabJournal()->count(), 0);
+  }
+
+  void closeWindowRecordsItsTabs()
+  {
+    WindowManager windows;
+    const int first = windows.openWindow(QUrl("https://stay.example"));
+    const int second = windows.openWindow(QUrl("https://x.example"));
+    windows.browser(second)->newTab(QUrl("https://y.example"));
+    QCOMPARE(windows.activeWindowId(), second);
+
+    QSignalSpy active(&windows, &WindowManager::activeWindowChanged);
+    QVERIFY(windows.closeWindow(second));
+    QCOMPARE(windows.count(), 1);
+    QCOMPARE(windows.activeWindowId(), first);
+    QCOMPARE(active.count(), 1);
+
+    QCOMPARE(windows.closedTabJournal()->count(), 1);
+    const ClosedTabJournal::Record& record = windows.closedTabJournal()->at(0);
+    QCOMPARE(record.kind, ClosedTabJournal::Kind::Window);
+    QCOMPARE(record.tabs.size(), 2);
+    QCOMPARE(record.tabs.at(0).url, QStringLiteral("https://x.example"));
+    QCOMPARE(record.tabs.at(1).url, QStringLiteral("https://y.example"));
+
+    // The last window is the app quitting, not a closed window.
+    QVERIFY(!windows.closeWindow(first));
+    QCOMPARE(windows.count(), 1);
+    QCOMPARE(windows.closedTabJournal()->count(), 1);
+  }
+
+  void activeWindowFollowsFocus()
+  {
+    WindowManager windows;
+    const int first = windows.createWindow();
+    QCOMPARE(windows.activeWindowId(), first);
+
+    const int second = windows.createWindow();
+    QCOMPARE(windows.activeWindowId(), first);
+
+    QSignalSpy active(&windows, &WindowManager::activeWindowChanged);
+    windows.setActiveWindowId(second);
+    QCOMPARE(windows.activeBrowser(), windows.browser(second));
+    QCOMPARE(windows.activeSplitView(), windows.splitView(second));
+    windows.setActiveWindowId(second);
+    windows.setActiveWindowId(999);
+    QCOMPARE(active.count(), 1);
+    QCOMPARE(windows.activeWindowId(), second);
+  }
+
+private:
+  std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+QTEST_GUILESS_MAIN(TestWindowManager)
+
+#include "TestWindowManager.moc"
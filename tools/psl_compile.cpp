@@ -0,0 +1,380 @@
+// Compiles public_suffix_list.dat into the perfect-hash table consumed by
+// src/core/PublicSuffixList.cpp. Runs on the build host, so it only uses the
+// standard library.
+//
+// Every rule and every suffix of a rule becomes one slot keyed by the hash
+// of that suffix. A slot stores its own label and the slot of its parent
+// suffix, so a lookup can verify a hit exactly without storing whole names
+// and can stop at the first suffix that is not in the table.
+//
+// Usage: psl_compile <public_suffix_list.dat> <output.inc>
+
+#include "core/PublicSuffixHash.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+namespace psl = xbrowser::psl;
+
+struct Node
+{
+  std::string parent;
+  std::string label;
+  std::uint32_t flags = psl::Interior;
+  std::uint64_t hash = 0;
+  std::uint32_t slot = 0;
+};
+
+std::vector<char32_t> decodeUtf8(const std::string& text)
+{
+  std::vector<char32_t> out;
+  for (size_t i = 0; i < text.size();) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    int extra = 0;
+    char32_t cp = c;
+    if (c >= 0xF0) {
+      extra = 3;
+      cp = c & 0x07;
+    } else if (c >= 0xE0) {
+      extra = 2;
+      cp = c & 0x0F;
+    } else if (c >= 0xC0) {
+      extra = 1;
+      cp = c & 0x1F;
+    }
+    ++i;
+    for (int k = 0; k < extra && i < text.size(); ++k, ++i) {
+      cp = (cp << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+    }
+    out.push_back(cp);
+  }
+  return out;
+}
+
+std::u16string toUtf16(const std::string& text)
+{
+  std::u16string out;
+  for (char32_t cp : decodeUtf8(text)) {
+    if (cp >= 0x10000) {
+      cp -= 0x10000;
+      out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+      out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+    } else {
+      out.push_back(static_cast<char16_t>(cp));
+    }
+  }
+  return out;
+}
+
+// RFC 3492 encoder for a single label.
+std::string punycodeLabel(const std::string& label)
+{
+  constexpr std::uint32_t base = 36, tMin = 1, tMax = 26, skew = 38, damp = 700;
+  const std::vector<char32_t> input = decodeUtf8(label);
+
+  auto adapt = [&](std::uint32_t delta, std::uint32_t points, bool first) {
+    delta = first ? delta / damp : delta / 2;
+    delta += delta / points;
+    std::uint32_t k = 0;
+    while (delta > ((base - tMin) * tMax) / 2) {
+      delta /= base - tMin;
+      k += base;
+    }
+    return k + (((base - tMin + 1) * delta) / (delta + skew));
+  };
+  auto digit = [](std::uint32_t d) { return static_cast<char>(d < 26 ? 'a' + d : '0' + (d - 26)); };
+
+  std::string out;
+  for (char32_t cp : input) {
+    if (cp < 0x80) {
+      out.push_back(static_cast<char>(cp));
+    }
+  }
+  const std::uint32_t basicCount = static_cast<std::uint32_t>(out.size());
+  if (basicCount > 0) {
+    out.push_back('-');
+  }
+
+  std::uint32_t n = 0x80, delta = 0, bias = 72, handled = basicCount;
+  while (handled < input.size()) {
+    std::uint32_t m = 0xFFFFFFFF;
+    for (char32_t cp : input) {
+      if (cp >= n && cp < m) {
+        m = cp;
+      }
+    }
+    delta += (m - n) * (handled + 1);
+    n = m;
+    for (char32_t cp : input) {
+      if (cp < n) {
+        ++delta;
+      }
+      if (cp != n) {
+        continue;
+      }
+      std::uint32_t q = delta;
+      for (std::uint32_t k = base;; k += base) {
+        const std::uint32_t t = k <= bias ? tMin : (k >= bias + tMax ? tMax : k - bias);
+        if (q < t) {
+          break;
+        }
+        out.push_back(digit(t + (q - t) % (base - t)));
+        q = (q - t) / (base - t);
+      }
+      out.push_back(digit(q));
+      bias = adapt(delta, handled + 1, handled == basicCount);
+      delta = 0;
+      ++handled;
+    }
+    ++delta;
+    ++n;
+  }
+  return "xn--" + out;
+}
+
+std::vector<std::string> splitLabels(const std::string& name)
+{
+  std::vector<std::string> labels;
+  std::stringstream stream(name);
+  std::string label;
+  while (std::getline(stream, label, '.')) {
+    labels.push_back(label);
+  }
+  return labels;
+}
+
+bool isAscii(const std::string& text)
+{
+  return std::all_of(text.begin(), text.end(), [](char c) { return static_cast<unsigned char>(c) < 0x80; });
+}
+
+std::string toLowerAscii(std::string text)
+{
+  for (char& c : text) {
+    if (c >= 'A' && c <= 'Z') {
+      c = static_cast<char>(c - 'A' + 'a');
+    }
+  }
+  return text;
+}
+
+bool addName(std::map<std::string, Node>& nodes, const std::vector<std::string>& labels, std::uint32_t flags)
+{
+  std::string parent;
+  for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+    if (it->empty() || it->size() > psl::kLabelLengthMask) {
+      return false;
+    }
+    const std::string key = parent.empty() ? *it : *it + "." + parent;
+    Node& node = nodes[key];
+    node.parent = parent;
+    node.label = *it;
+    parent = key;
+  }
+  nodes[parent].flags |= flags;
+  return true;
+}
+
+std::uint64_t hashName(const std::string& name)
+{
+  const std::u16string units = toUtf16(name);
+  std::uint64_t h = psl::kHashBasis;
+  for (auto it = units.rbegin(); it != units.rend(); ++it) {
+    h = psl::hashUnit(h, *it);
+  }
+  return h;
+}
+}
+
+int main(int argc, char** argv)
+{
+  if (argc != 3) {
+    std::cerr << "usage: psl_compile <public_suffix_list.dat> <output.inc>\n";
+    return 2;
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) {
+    std::cerr << "psl_compile: cannot read " << argv[1] << "\n";
+    return 1;
+  }
+
+  std::map<std::string, Node> nodes;
+  std::uint32_t ruleCount = 0;
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string::npos || line.compare(start, 2, "//") == 0) {
+      continue;
+    }
+    std::string rule = toLowerAscii(line.substr(start, line.find_first_of(" \t\r", start) - start));
+
+    std::uint32_t flags = psl::Rule;
+    if (rule.front() == '!') {
+      flags = psl::Exception;
+      rule.erase(0, 1);
+    } else if (rule.compare(0, 2, "*.") == 0) {
+      flags = psl::Wildcard;
+      rule.erase(0, 2);
+    }
+    if (rule.empty() || rule.find('*') != std::string::npos) {
+      std::cerr << "psl_compile: unsupported rule '" << line << "'\n";
+      return 1;
+    }
+
+    std::vector<std::string> labels = splitLabels(rule);
+    if (!addName(nodes, labels, flags)) {
+      std::cerr << "psl_compile: invalid rule '" << line << "'\n";
+      return 1;
+    }
+    if (!isAscii(rule)) {
+      // Hosts reach us either IDNA-encoded or as Unicode, so index both.
+      for (std::string& label : labels) {
+        if (!isAscii(label)) {
+          label = punycodeLabel(label);
+        }
+      }
+      addName(nodes, labels, flags);
+    }
+    ++ruleCount;
+  }
+
+  if (nodes.empty()) {
+    std::cerr << "psl_compile: no rules in " << argv[1] << "\n";
+    return 1;
+  }
+
+  std::vector<Node*> keys;
+  keys.reserve(nodes.size());
+  for (auto& [name, node] : nodes) {
+    node.hash = hashName(name);
+    keys.push_back(&node);
+  }
+
+  std::vector<std::uint64_t> hashes;
+  hashes.reserve(keys.size());
+  for (const Node* node : keys) {
+    hashes.push_back(node->hash);
+  }
+  std::sort(hashes.begin(), hashes.end());
+  if (std::adjacent_find(hashes.begin(), hashes.end()) != hashes.end()) {
+    std::cerr << "psl_compile: hash collision, change the hash in PublicSuffixHash.h\n";
+    return 1;
+  }
+
+  // Hash and displace: place the largest buckets first, searching for a
+  // displacement that sends every key of the bucket to a free slot.
+  const std::uint32_t keyCount = static_cast<std::uint32_t>(keys.size());
+  const std::uint32_t slotCount = keyCount + keyCount / 8 + 1;
+  const std::uint32_t bucketCount = std::max<std::uint32_t>(1, keyCount / 4);
+
+  std::vector<std::vector<Node*>> buckets(bucketCount);
+  for (Node* node : keys) {
+    buckets[psl::bucketFor(node->hash, bucketCount)].push_back(node);
+  }
+  std::vector<std::uint32_t> order(bucketCount);
+  for (std::uint32_t i = 0; i < bucketCount; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+
+  std::vector<std::uint16_t> displacements(bucketCount, 0);
+  std::vector<bool> taken(slotCount, false);
+  std::vector<std::uint32_t> placed;
+  for (std::uint32_t bucket : order) {
+    if (buckets[bucket].empty()) {
+      break;
+    }
+    bool done = false;
+    for (std::uint32_t d = 0; d <= 0xFFFF && !done; ++d) {
+      placed.clear();
+      bool fits = true;
+      for (const Node* node : buckets[bucket]) {
+        const std::uint32_t slot = psl::slotFor(node->hash, d, slotCount);
+        if (taken[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+          fits = false;
+          break;
+        }
+        placed.push_back(slot);
+      }
+      if (!fits) {
+        continue;
+      }
+      for (size_t i = 0; i < placed.size(); ++i) {
+        taken[placed[i]] = true;
+        buckets[bucket][i]->slot = placed[i];
+      }
+      displacements[bucket] = static_cast<std::uint16_t>(d);
+      done = true;
+    }
+    if (!done) {
+      std::cerr << "psl_compile: no displacement found for bucket " << bucket << "\n";
+      return 1;
+    }
+  }
+
+  std::string labelPool;
+  std::map<std::string, std::uint32_t> labelOffsets;
+  std::vector<std::uint64_t> slots(slotCount, 0);
+  for (const auto& [name, node] : nodes) {
+    auto found = labelOffsets.find(node.label);
+    if (found == labelOffsets.end()) {
+      found = labelOffsets.emplace(node.label, static_cast<std::uint32_t>(labelPool.size())).first;
+      labelPool += node.label;
+    }
+    if (labelPool.size() > psl::kLabelOffsetMask) {
+      std::cerr << "psl_compile: label pool too large\n";
+      return 1;
+    }
+    const std::uint64_t parent = node.parent.empty() ? 0 : nodes.at(node.parent).slot + 1;
+    slots[node.slot] = std::uint64_t(found->second) | (std::uint64_t(node.label.size()) << psl::kLabelLengthShift)
+                       | (std::uint64_t(node.flags) << psl::kFlagsShift) | (parent << psl::kParentShift);
+  }
+
+  std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "psl_compile: cannot write " << argv[2] << "\n";
+    return 1;
+  }
+
+  out << "// Generated by tools/psl_compile.cpp. Do not edit.\n\n";
+  out << "namespace xbrowser::psl::table\n{\n";
+  out << "constexpr int kRuleCount = " << ruleCount << ";\n";
+  out << "constexpr std::uint32_t kBucketCount = " << bucketCount << ";\n";
+  out << "constexpr std::uint32_t kSlotCount = " << slotCount << ";\n\n";
+
+  auto writeArray = [&out](const char* decl, const auto& values, int perLine) {
+    out << decl << " = {\n";
+    int column = 0;
+    for (const auto value : values) {
+      out << (column == 0 ? "  " : " ") << static_cast<std::uint64_t>(value) << (sizeof(value) == 8 ? "ULL," : ",");
+      if (++column == perLine) {
+        out << "\n";
+        column = 0;
+      }
+    }
+    out << (column == 0 ? "" : "\n") << "};\n\n";
+  };
+  writeArray("constexpr std::uint16_t kDisplacements[]", displacements, 16);
+  writeArray("constexpr std::uint64_t kSlots[]", slots, 6);
+  std::vector<unsigned char> poolBytes(labelPool.begin(), labelPool.end());
+  writeArray("constexpr unsigned char kLabels[]", poolBytes, 24);
+  out << "}\n";
+
+  if (!out.flush()) {
+    std::cerr << "psl_compile: write failed for " << argv[2] << "\n";
+    return 1;
+  }
+  return 0;
+}
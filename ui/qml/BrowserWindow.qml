@@ -16,6 +16,13 @@ ApplicationWindow {
     title: (browser.tabs.activeIndex >= 0 ? browser.tabs.titleAt(browser.tabs.activeIndex) : "XBrowser")
     flags: Qt.Window | Qt.FramelessWindowHint
 
+    onActiveChanged: {
+        if (active) {
+            windows.activeWindowId = windowId
+        }
+    }
+    onClosing: windows.closeWindow(windowId)
+
     property url glanceUrl: ""
     readonly property bool fullscreenActive: visibility === Window.FullScreen
     property int preFullscreenVisibility: Window.Windowed
@@ -27,6 +34,8 @@ ApplicationWindow {
 
     property var activeDownloadIdByKey: ({})
     property var activeDownloadOpById: ({})
+    // Accelerated downloads this window started, for its finish toasts.
+    property var segmentedDownloadIds: ({})
     property string lastFailedDownloadUri: ""
 
     Timer {
@@ -80,6 +89,8 @@ ApplicationWindow {
     property var glanceView: null
     property var extensionPopupView: null
     property string omniboxQuery: ""
+    property string omniboxTypedText: ""
+    property int omniboxContentRequest: 0
     property bool suppressNextOmniboxUpdate: false
 
     property int webContextMenuTabId: 0
@@ -423,6 +434,36 @@ ApplicationWindow {
         }
     }
 
+    Connections {
+        target: windows
+
+        function onTabHandoffRequested(fromWindowId, tabId, token) {
+            if (fromWindowId !== windowId) {
+                return
+            }
+            const view = tabViews.byId[tabId]
+            if (view) {
+                view.parkForHandoff(token)
+            }
+        }
+    }
+
+    Connections {
+        target: segmentedDownloads
+
+        function onFinished(downloadId, success, error) {
+            if (!root.segmentedDownloadIds[downloadId]) {
+                return
+            }
+            delete root.segmentedDownloadIds[downloadId]
+            if (success) {
+                toast.showToast("Download finished", "Open Folder", "open-latest-download-folder", 6000)
+            } else if (error !== "Cancelled") {
+                toast.showToast("Download failed", "Downloads", "open-downloads", 6000)
+            }
+        }
+    }
+
     Connections {
         target: root.viewSourceTargetView
         function onScriptExecuted(resultJson) {
@@ -531,6 +572,7 @@ ApplicationWindow {
         const topFocused = addressField && addressField.activeFocus
         const sidebarFocused = sidebarAddressField && sidebarAddressField.activeFocus
         layoutController.addressFieldFocused = (topFocused || sidebarFocused) === true
+        root.omniboxTypedText = ""
     }
 
     function syncAddressFieldFromFocused(force) {
@@ -587,6 +629,7 @@ ApplicationWindow {
             return
         }
 
+        root.recordTypedNavigation(parsed.url)
         if (root.focusedView) {
             root.focusedView.navigate(parsed.url)
         } else {
@@ -594,6 +637,39 @@ ApplicationWindow {
         }
     }
 
+    // Field text without an inline completion that is still selected.
+    function typedOmniboxText(field) {
+        const text = String(field.text || "")
+        if (field.selectedText && field.selectionStart > 0 && field.selectionEnd === text.length) {
+            return text.substring(0, field.selectionStart)
+        }
+        return text
+    }
+
+    function recordTypedNavigation(url) {
+        const view = root.focusedView
+        if (view && view.typedNavigationPending !== undefined) {
+            view.typedNavigationPending = true
+        }
+        if (navigationPredictor && root.omniboxTypedText.length > 0) {
+            navigationPredictor.recordTypedNavigation(root.omniboxTypedText, url)
+        }
+    }
+
+    // Only host lookups, from the browser side; predictions come from the
+    // user's history and never go into the page.
+    function warmUpPredictions(predictions) {
+        if (!hostPreresolver || !predictions) {
+            return
+        }
+        for (let i = 0; i < predictions.length; i++) {
+            const p = predictions[i]
+            if (p.hint) {
+                hostPreresolver.preresolve(p.url)
+            }
+        }
+    }
+
     function desiredZoomForUrl(url) {
         if (!browser || !browser.settings) {
             return 1.0
@@ -636,7 +712,10 @@ ApplicationWindow {
             wanted[key] = true
 
             if (!tabViews.byId[tabId]) {
-                const view = tabWebViewComponent.createObject(contentHost, { tabId: tabId })
+                const view = tabWebViewComponent.createObject(contentHost, {
+                    tabId: tabId,
+                    handoffToken: windows.takeHandoffToken(windowId, tabId)
+                })
                 if (view) {
                     tabViews.byId[tabId] = view
                 }
@@ -917,31 +996,35 @@ ApplicationWindow {
         }
     }
 
-    function pushModsCss(targetView) {
-        const css = root.modsModel && root.modsModel.combinedCss ? String(root.modsModel.combinedCss) : ""
-
-        if (targetView && targetView.setUserCss) {
-            targetView.setUserCss(css)
+    function pushModsCss(targetView, url) {
+        if (targetView && targetView.setUserCssSheets) {
+            const pageUrl = url !== undefined ? url : targetView.currentUrl
+            targetView.setUserCssSheets(root.modsModel ? root.modsModel.sheetsForUrl(pageUrl) : [])
             return
         }
 
         for (const key in tabViews.byId) {
-            const view = tabViews.byId[key]
-            if (view && view.setUserCss) {
-                view.setUserCss(css)
-            }
-        }
-
-        if (webPanelWeb && webPanelWeb.setUserCss) {
-            webPanelWeb.setUserCss(css)
+            root.pushModsCss(tabViews.byId[key])
         }
+        root.pushModsCss(webPanelWeb)
+        root.pushModsCss(root.glanceView)
+        root.pushModsCss(root.extensionPopupView)
+    }
 
-        if (root.glanceView && root.glanceView.setUserCss) {
-            root.glanceView.setUserCss(css)
+    function pushModsCssForHosts(hosts, allHosts) {
+        const views = []
+        for (const key in tabViews.byId) {
+            views.push(tabViews.byId[key])
         }
+        views.push(webPanelWeb, root.glanceView, root.extensionPopupView)
 
-        if (root.extensionPopupView && root.extensionPopupView.setUserCss) {
-            root.extensionPopupView.setUserCss(css)
+        for (const view of views) {
+            if (!view || !view.setUserCssSheets) {
+                continue
+            }
+            if (allHosts || root.modsModel.urlMatchesHosts(view.currentUrl, hosts)) {
+                root.pushModsCss(view)
+            }
         }
     }
 
@@ -974,6 +1057,17 @@ ApplicationWindow {
         toast.showToast("Download started", "Downloads", "open-downloads", 3500)
     }
 
+    function handleDownloadIntercepted(uri, resultFilePath, cookieHeader) {
+        const downloadId = segmentedDownloads.start(uri, resultFilePath, cookieHeader)
+        if (downloadId > 0) {
+            segmentedDownloadIds[downloadId] = true
+            toast.showToast("Download started", "Downloads", "open-downloads", 3500)
+        } else {
+            root.lastFailedDownloadUri = String(uri)
+            toast.showToast("Download failed", "Retry", "retry-last-download", 6000)
+        }
+    }
+
     function handleDownloadProgress(tabId, downloadOperationId, bytesReceived, totalBytes, paused, canResume, interruptReason) {
         const key = downloadOpKey(tabId, downloadOperationId)
         const downloadId = Number(activeDownloadIdByKey[key] || 0)
@@ -1012,6 +1106,10 @@ ApplicationWindow {
     }
 
     function pauseDownload(downloadId) {
+        if (segmentedDownloads.handles(downloadId)) {
+            segmentedDownloads.pause(downloadId)
+            return
+        }
         const op = activeDownloadOpById[downloadId]
         if (!op) {
             return
@@ -1023,6 +1121,10 @@ ApplicationWindow {
     }
 
     function resumeDownload(downloadId) {
+        if (segmentedDownloads.handles(downloadId)) {
+            segmentedDownloads.resume(downloadId)
+            return
+        }
         const op = activeDownloadOpById[downloadId]
         if (!op) {
             return
@@ -1034,6 +1136,10 @@ ApplicationWindow {
     }
 
     function cancelDownload(downloadId) {
+        if (segmentedDownloads.handles(downloadId)) {
+            segmentedDownloads.cancel(downloadId)
+            return
+        }
         const op = activeDownloadOpById[downloadId]
         if (!op) {
             return
@@ -1588,52 +1694,34 @@ ApplicationWindow {
         const isCommandMode = trimmed.startsWith(">")
         if (isCommandMode) {
             const query = trimmed.slice(1).trim()
-            const baseCommands = [
-                { group: "Tabs", title: "New Tab", command: "new-tab", args: {}, shortcut: "Ctrl+T" },
-                { group: "Windows", title: "New Window", command: "new-window", args: {}, shortcut: "Ctrl+N" },
-                { group: "Windows", title: "New Incognito Window", command: "new-incognito-window", args: {}, shortcut: "Ctrl+Shift+N" },
-                { group: "Tabs", title: "Close Tab", command: "close-tab", args: { tabId: root.focusedTabId }, shortcut: "Ctrl+W" },
-                { group: "Tabs", title: "Restore Closed Tab", command: "restore-closed-tab", args: {}, shortcut: "Ctrl+Shift+T" },
-                { group: "Tabs", title: "Duplicate Tab", command: "duplicate-tab", args: { tabId: root.focusedTabId }, shortcut: "" },
-                { group: "Tabs", title: "Switch Tab", command: "open-tab-switcher", args: {}, shortcut: "Ctrl+K" },
-                { group: "Navigation", title: "Reload", command: "nav-reload", args: {}, shortcut: "Ctrl+R" },
-                { group: "Navigation", title: "Stop Loading", command: "nav-stop", args: {}, shortcut: "Esc" },
-                { group: "Navigation", title: "Find in Page", command: "open-find", args: {}, shortcut: "Ctrl+F" },
-                 { group: "View", title: "Toggle Sidebar", command: "toggle-sidebar", args: {}, shortcut: "Ctrl+B" },
-                 { group: "View", title: "Toggle Address Bar", command: "toggle-addressbar", args: {}, shortcut: "Ctrl+Shift+L" },
-                 { group: "View", title: root.fullscreenActive ? "Exit Fullscreen" : "Fullscreen", command: "toggle-fullscreen", args: {}, shortcut: "F11" },
-                 { group: "View", title: "Zoom In", command: "zoom-in", args: {}, shortcut: "Ctrl++" },
-                 { group: "View", title: "Zoom Out", command: "zoom-out", args: {}, shortcut: "Ctrl+-" },
-                 { group: "View", title: "Reset Zoom", command: "zoom-reset", args: {}, shortcut: "Ctrl+0" },
-                 { group: "View", title: splitView.enabled ? "Unsplit View" : "Split View", command: "toggle-split-view", args: {}, shortcut: "Ctrl+E" },
-                 { group: "Tools", title: "Settings", command: "open-settings", args: {}, shortcut: "Ctrl+," },
-                 { group: "Tools", title: "Open File", command: "open-file", args: {}, shortcut: "Ctrl+O" },
-                 { group: "Output", title: "Print / Save PDF", command: "open-print", args: {}, shortcut: "Ctrl+P" },
-                 { group: "Tools", title: "Downloads", command: "open-downloads", args: {}, shortcut: "Ctrl+J" },
-                 { group: "Tools", title: "Bookmarks", command: "open-bookmarks", args: {}, shortcut: "Ctrl+D" },
-                 { group: "Tools", title: "History", command: "open-history", args: {}, shortcut: "Ctrl+H" },
-                 { group: "Tools", title: "Mods", command: "open-mods", args: {}, shortcut: "" },
-                 { group: "Tools", title: "Themes", command: "open-themes", args: {}, shortcut: "" },
-                 { group: "Tools", title: "Extensions", command: "open-extensions", args: {}, shortcut: "" },
-                 { group: "Tools", title: "DevTools", command: "open-devtools", args: {}, shortcut: "F12" },
-                 { group: "Workspaces", title: "New Workspace", command: "new-workspace", args: {}, shortcut: "" },
-             ]
-
-            for (let i = 0; i < browser.workspaces.count(); i++) {
-                baseCommands.push({
-                    group: "Workspaces",
-                    title: "Switch Workspace: " + browser.workspaces.nameAt(i),
-                    command: "switch-workspace",
-                    args: { index: i },
-                    shortcut: i < 9 ? ("Alt+" + (i + 1)) : "",
+            const rows = []
+            for (const match of commands.searchCommands(query)) {
+                rows.push({
+                    score: match.score,
+                    cmd: {
+                        group: match.group,
+                        title: match.title,
+                        command: match.command,
+                        args: { tabId: root.focusedTabId },
+                        shortcut: match.shortcut,
+                    },
                 })
             }
 
-            const rows = []
-            for (const cmd of baseCommands) {
-                const score = omniboxUtils.fuzzyScore(query, cmd.title)
+            for (let i = 0; i < browser.workspaces.count(); i++) {
+                const title = "Switch Workspace: " + browser.workspaces.nameAt(i)
+                const score = omniboxUtils.fuzzyScore(query, title)
                 if (score >= 0) {
-                    rows.push({ score: score, cmd: cmd })
+                    rows.push({
+                        score: score,
+                        cmd: {
+                            group: "Workspaces",
+                            title: title,
+                            command: "switch-workspace",
+                            args: { index: i },
+                            shortcut: i < 9 ? ("Alt+" + (i + 1)) : "",
+                        },
+                    })
                 }
             }
             rows.sort((a, b) => b.score - a.score)
@@ -1647,7 +1735,7 @@ ApplicationWindow {
                 grouped[g].push(row.cmd)
             }
 
-            const groupOrder = ["Tabs", "Navigation", "View", "Tools", "Workspaces", "Commands"]
+            const groupOrder = ["Tabs", "Windows", "Navigation", "View", "Tools", "Output", "Workspaces", "Commands"]
             for (const g of groupOrder) {
                 const items = grouped[g]
                 if (!items || items.length === 0) {
@@ -1692,7 +1780,26 @@ ApplicationWindow {
             return
         }
 
-        const parsed = interpretOmniboxInput(trimmed)
+        // Inline-complete only while the typed text grows, so Backspace drops
+        // the suggestion instead of bringing it straight back.
+        let navigateText = trimmed
+        const previousTyped = root.omniboxTypedText
+        const deleting = raw.length <= previousTyped.length && previousTyped.startsWith(raw)
+        root.omniboxTypedText = raw
+        if (urlCompletion && !deleting && raw === trimmed && field.cursorPosition === raw.length) {
+            const inline = urlCompletion.inlineCompletion(raw)
+            if (inline && inline.remainder) {
+                navigateText = inline.text
+                root.suppressNextOmniboxUpdate = true
+                field.text = inline.text
+                field.select(raw.length, inline.text.length)
+            }
+        }
+        if (navigationPredictor && !deleting) {
+            root.warmUpPredictions(navigationPredictor.predictForInput(raw, 2))
+        }
+
+        const parsed = interpretOmniboxInput(navigateText)
         const navTitle = parsed.kind === "search" ? ("Search: " + parsed.display) : ("Go to: " + parsed.display)
         const navFaviconKey = faviconCache ? faviconCache.faviconKeyForUrl(parsed.url, 32) : ""
         const navFaviconUrl = faviconCache ? faviconCache.faviconUrlFor(parsed.url, 32) : ""
@@ -1789,16 +1896,22 @@ ApplicationWindow {
             }
         }
 
-        const tabHits = omniboxUtils.tabSuggestions(browser.tabs, trimmed, 8)
+        if (historyText && parsed.kind === "search") {
+            root.omniboxContentRequest = historyText.search(trimmed, 4)
+        }
+
+        const tabHits = browser.tabIndex.search(trimmed, 8)
         if (tabHits && tabHits.length > 0) {
+            const activeWorkspaceIndex = browser.workspaces.activeIndex
             omniboxModel.append({ type: "header", title: "Tabs" })
             for (const t of tabHits) {
                 omniboxModel.append({
                     type: "item",
                     kind: "tab",
                     title: t.title,
-                    subtitle: t.subtitle,
+                    subtitle: t.workspaceIndex === activeWorkspaceIndex ? t.subtitle : (t.workspaceName + " \u00B7 " + t.subtitle),
                     tabId: t.tabId,
+                    workspaceId: t.workspaceId,
                     faviconUrl: t.faviconUrl,
                     shortcut: "",
                     matchStart: t.matchStart,
@@ -2307,6 +2420,7 @@ ApplicationWindow {
                     Layout.fillWidth: true
                     Layout.fillHeight: true
 
+                    onUserCssRequested: (url) => root.pushModsCss(extPopupWeb, url)
                     Component.onCompleted: {
                         root.extensionPopupView = extPopupWeb
                         root.pushModsCss(extPopupWeb)
@@ -2512,6 +2626,7 @@ ApplicationWindow {
                         id: glanceWeb
                         Layout.fillWidth: true
                         Layout.fillHeight: true
+                        onUserCssRequested: (url) => root.pushModsCss(glanceWeb, url)
                         Component.onCompleted: {
                             root.glanceView = glanceWeb
                             root.pushModsCss(glanceWeb)
@@ -2599,7 +2714,7 @@ ApplicationWindow {
         windowChrome.setCloseButtonItem(windowCloseButton)
 
         if (browser.tabs.count() === 0) {
-            commands.invoke("new-tab", { url: "https://example.com" })
+            browser.newTab("https://example.com")
         }
 
         if (!browser.settings.onboardingSeen) {
@@ -3123,7 +3238,7 @@ ApplicationWindow {
                 return
             }
 
-            const currentQuery = String(field.text || "").trim()
+            const currentQuery = root.typedOmniboxText(field).trim()
             const expectedQuery = String(query || "").trim()
             if (!currentQuery || !expectedQuery || currentQuery !== expectedQuery) {
                 return
@@ -3172,6 +3287,62 @@ ApplicationWindow {
         }
     }
 
+    Connections {
+        target: historyText
+
+        function onSearchFinished(requestId, query, results) {
+            if (requestId !== root.omniboxContentRequest) {
+                return
+            }
+            const field = root.activeAddressField()
+            if (!field || !field.activeFocus) {
+                return
+            }
+            const currentQuery = root.typedOmniboxText(field).trim()
+            if (!currentQuery || currentQuery !== String(query || "").trim()) {
+                return
+            }
+
+            const shown = {}
+            for (let i = omniboxModel.count - 1; i >= 0; i--) {
+                const it = omniboxModel.get(i)
+                if (it && it.group === "page-content") {
+                    omniboxModel.remove(i)
+                } else if (it && it.type === "item" && it.url) {
+                    shown[String(it.url)] = true
+                }
+            }
+
+            const fresh = (results || []).filter((r) => r && r.url && !shown[String(r.url)])
+            if (fresh.length === 0) {
+                return
+            }
+
+            omniboxModel.append({ type: "header", title: "From Page Content", group: "page-content" })
+            for (const r of fresh) {
+                const url = String(r.url)
+                const faviconKey = faviconCache ? faviconCache.faviconKeyForUrl(url, 32) : ""
+                const faviconUrl = faviconCache ? faviconCache.faviconUrlFor(url, 32) : ""
+                omniboxModel.append({
+                    type: "item",
+                    kind: "history",
+                    title: String(r.title || url),
+                    subtitle: url,
+                    url: url,
+                    faviconKey: faviconKey,
+                    faviconUrl: faviconUrl,
+                    group: "page-content",
+                    shortcut: "",
+                    matchStart: -1,
+                    matchLength: 0,
+                })
+            }
+            if (!root.omniboxPopupOpen()) {
+                root.openOmniboxPopup()
+            }
+        }
+    }
+
     Connections {
         target: faviconCache
 
@@ -3346,7 +3517,7 @@ ApplicationWindow {
                      return
                  }
                  if (item.kind === "tab") {
-                     browser.activateTabById(item.tabId)
+                     browser.activateTabInWorkspace(item.workspaceId, item.tabId)
                      if (field) {
                          field.focus = false
                      }
@@ -3362,6 +3533,7 @@ ApplicationWindow {
                 }
 
                 if (item.kind === "url" || item.kind === "search" || item.kind === "bookmark" || item.kind === "history") {
+                    root.recordTypedNavigation(item.url)
                     if (root.focusedView) {
                         root.focusedView.navigate(item.url)
                     } else {
@@ -3608,7 +3780,7 @@ ApplicationWindow {
         Rectangle {
             id: sidebarPane
             Layout.column: browser.settings.sidebarOnRight ? 4 : 0
-            Layout.preferredWidth: showSidebar ? browser.settings.sidebarWidth : 0
+            Layout.preferredWidth: showSidebar ? layoutController.sidebarWidth : 0
             Layout.fillHeight: true
             visible: true
             opacity: showSidebar ? 1.0 : 0.0
@@ -4288,6 +4460,56 @@ ApplicationWindow {
                     }
                 }
 
+                Label {
+                    Layout.fillWidth: true
+                    visible: topSites.count > 0
+                    text: "Most visited"
+                    font.pixelSize: 12
+                    opacity: 0.7
+                }
+
+                Flow {
+                    Layout.fillWidth: true
+                    visible: topSites.count > 0
+                    spacing: 4
+
+                    Repeater {
+                        model: topSites
+
+                        delegate: ToolButton {
+                            id: topSiteButton
+
+                            required property string site
+                            required property string title
+                            required property url url
+                            required property url faviconUrl
+
+                            width: 32
+                            height: 32
+                            display: faviconUrl.toString().length > 0 ? AbstractButton.IconOnly : AbstractButton.TextOnly
+                            icon.source: faviconUrl
+                            icon.width: 16
+                            icon.height: 16
+                            text: title.length > 0 ? title[0].toUpperCase() : ""
+                            ToolTip.visible: hovered
+                            ToolTip.delay: 500
+                            ToolTip.text: title + "\nRight-click to remove"
+
+                            onClicked: commands.invoke("navigate", { url: url })
+
+                            MouseArea {
+                                anchors.fill: parent
+                                acceptedButtons: Qt.RightButton
+                                onClicked: {
+                                    const removed = topSiteButton.site
+                                    topSites.block(topSiteButton.url)
+                                    toast.showToast("Removed " + removed + " from Most visited")
+                                }
+                            }
+                        }
+                    }
+                }
+
                 Item {
                     Layout.fillWidth: true
                     implicitHeight: tabsLabel.implicitHeight
@@ -5463,17 +5685,24 @@ ApplicationWindow {
 
                 onPressed: (mouse) => {
                     startSceneX = mouse.sceneX
-                    startWidth = browser.settings.sidebarWidth
+                    startWidth = layoutController.sidebarWidth
+                    layoutController.beginSidebarResize()
                 }
 
-                onDoubleClicked: browser.settings.sidebarWidth = 260
+                onReleased: layoutController.commitSidebarResize()
+                onCanceled: layoutController.cancelSidebarResize()
+
+                onDoubleClicked: {
+                    layoutController.cancelSidebarResize()
+                    browser.settings.sidebarWidth = 260
+                }
 
                 onPositionChanged: (mouse) => {
                     if (!pressed) {
                         return
                     }
                     const delta = Math.round(mouse.sceneX - startSceneX)
-                    browser.settings.sidebarWidth = browser.settings.sidebarOnRight ? (startWidth - delta) : (startWidth + delta)
+                    layoutController.updateSidebarResize(browser.settings.sidebarOnRight ? (startWidth - delta) : (startWidth + delta))
                 }
             }
         }
@@ -5493,7 +5722,7 @@ ApplicationWindow {
                 }
                 const minPos = Math.min(splitMinPx, Math.round(w * 0.5))
                 const maxPos = Math.max(minPos, w - minPos)
-                const desired = Math.round(w * splitView.splitRatio)
+                const desired = Math.round(w * splitView.liveSplitRatio)
                 return Math.max(minPos, Math.min(maxPos, desired))
             }
             readonly property int gridSplitPosX: {
@@ -5504,7 +5733,7 @@ ApplicationWindow {
                 }
                 const minPos = Math.min(splitMinPx, Math.round(available * 0.5))
                 const maxPos = Math.max(minPos, available - minPos)
-                const desired = Math.round(available * splitView.gridSplitRatioX)
+                const desired = Math.round(available * splitView.liveGridSplitRatioX)
                 return Math.max(minPos, Math.min(maxPos, desired))
             }
             readonly property int gridSplitPosY: {
@@ -5515,7 +5744,7 @@ ApplicationWindow {
                 }
                 const minPos = Math.min(splitMinPx, Math.round(available * 0.5))
                 const maxPos = Math.max(minPos, available - minPos)
-                const desired = Math.round(available * splitView.gridSplitRatioY)
+                const desired = Math.round(available * splitView.liveGridSplitRatioY)
                 return Math.max(minPos, Math.min(maxPos, desired))
             }
 
@@ -5571,6 +5800,8 @@ ApplicationWindow {
                     id: tabWeb
                     required property int tabId
                     property int lastThumbnailCaptureMs: 0
+                    property url lastCommittedUrl
+                    property bool typedNavigationPending: false
 
                     readonly property int paneIndex: splitView.enabled
                                                           ? splitView.paneIndexForTabId(tabId)
@@ -5583,6 +5814,9 @@ ApplicationWindow {
                     width: paneRect.width
                     height: paneRect.height
 
+                    interceptDownloads: browser.settings.acceleratedDownloads
+
+                    onUserCssRequested: (url) => root.pushModsCss(tabWeb, url)
                     Component.onCompleted: {
                         root.pushModsCss(tabWeb)
                         if (root.glanceScript && root.glanceScript.length > 0) {
@@ -5616,6 +5850,9 @@ ApplicationWindow {
                         }
                         if (!isLoading) {
                             scheduleThumbnailCapture()
+                            pageTextCaptureTimer.restart()
+                        } else {
+                            pageTextCaptureTimer.stop()
                         }
                     }
 
@@ -5627,6 +5864,14 @@ ApplicationWindow {
                         if (store && store.addVisit) {
                             store.addVisit(currentUrl, title)
                         }
+                        if (navigationPredictor) {
+                            if (!typedNavigationPending) {
+                                navigationPredictor.recordNavigation(lastCommittedUrl, currentUrl)
+                            }
+                            root.warmUpPredictions(navigationPredictor.predictNext(currentUrl, 2))
+                        }
+                        typedNavigationPending = false
+                        lastCommittedUrl = currentUrl
                     }
 
                     onZoomFactorChanged: {
@@ -5659,6 +5904,9 @@ ApplicationWindow {
                         if (tabId > 0) {
                             browser.setTabFaviconUrlById(tabId, faviconUrl)
                         }
+                        if (faviconCache) {
+                            faviconCache.setPageIcon(currentUrl, faviconUrl)
+                        }
                     }
 
                     Timer {
@@ -5687,6 +5935,26 @@ ApplicationWindow {
                         }
                     }
 
+                    // Late-rendering pages get a moment to settle before their
+                    // text goes into the history text index.
+                    Timer {
+                        id: pageTextCaptureTimer
+                        interval: 1500
+                        repeat: false
+                        onTriggered: {
+                            if (!historyText || !tabWeb.initialized || tabWeb.isLoading || tabWeb.tabId <= 0) {
+                                return
+                            }
+                            tabWeb.capturePageText(historyText.maxCaptureChars)
+                        }
+                    }
+
+                    onPageTextCaptured: (url, title, text) => {
+                        if (historyText) {
+                            historyText.addPage(url, title, text)
+                        }
+                    }
+
                     function scheduleThumbnailCapture() {
                         if (!tabWeb.visible || !tabWeb.initialized || tabWeb.tabId <= 0) {
                             return
@@ -5702,6 +5970,7 @@ ApplicationWindow {
                         if (tabId > 0 && browser && browser.tabs && browser.tabs.setThumbnailPathById) {
                             browser.tabs.setThumbnailPathById(tabId, String(filePath || ""))
                         }
+                        topSites.setThumbnail(currentUrl, String(filePath || ""))
                     }
 
                     onVisibleChanged: {
@@ -5740,6 +6009,9 @@ ApplicationWindow {
                     onDownloadFinished: (downloadOperationId, uri, resultFilePath, success, interruptReason) => {
                         root.handleDownloadFinished(tabId, downloadOperationId, uri, resultFilePath, success, interruptReason)
                     }
+                    onDownloadIntercepted: (uri, resultFilePath, cookieHeader) => {
+                        root.handleDownloadIntercepted(uri, resultFilePath, cookieHeader)
+                    }
 
                         Rectangle {
                             anchors.fill: parent
@@ -5853,9 +6125,16 @@ ApplicationWindow {
                     onPressed: (mouse) => {
                         startSceneX = mouse.sceneX
                         startPos = contentHost.gridSplitPosX
+                        splitView.beginDividerDrag(SplitViewController.GridXDivider)
                     }
 
-                    onDoubleClicked: splitView.gridSplitRatioX = 0.5
+                    onReleased: splitView.commitDividerDrag()
+                    onCanceled: splitView.cancelDividerDrag()
+
+                    onDoubleClicked: {
+                        splitView.cancelDividerDrag()
+                        splitView.gridSplitRatioX = 0.5
+                    }
 
                     onPositionChanged: (mouse) => {
                         if (!pressed) {
@@ -5866,7 +6145,7 @@ ApplicationWindow {
                         const maxPos = Math.max(minPos, available - minPos)
                         const next = startPos + Math.round(mouse.sceneX - startSceneX)
                         const clamped = Math.max(minPos, Math.min(maxPos, next))
-                        splitView.gridSplitRatioX = clamped / available
+                        splitView.updateDividerDrag(clamped / available)
                     }
                 }
             }
@@ -5894,9 +6173,16 @@ ApplicationWindow {
                     onPressed: (mouse) => {
                         startSceneY = mouse.sceneY
                         startPos = contentHost.gridSplitPosY
+                        splitView.beginDividerDrag(SplitViewController.GridYDivider)
                     }
 
-                    onDoubleClicked: splitView.gridSplitRatioY = 0.5
+                    onReleased: splitView.commitDividerDrag()
+                    onCanceled: splitView.cancelDividerDrag()
+
+                    onDoubleClicked: {
+                        splitView.cancelDividerDrag()
+                        splitView.gridSplitRatioY = 0.5
+                    }
 
                     onPositionChanged: (mouse) => {
                         if (!pressed) {
@@ -5907,7 +6193,7 @@ ApplicationWindow {
                         const maxPos = Math.max(minPos, available - minPos)
                         const next = startPos + Math.round(mouse.sceneY - startSceneY)
                         const clamped = Math.max(minPos, Math.min(maxPos, next))
-                        splitView.gridSplitRatioY = clamped / available
+                        splitView.updateDividerDrag(clamped / available)
                     }
                 }
             }
@@ -5933,9 +6219,14 @@ ApplicationWindow {
                     onPressed: (mouse) => {
                         startSceneX = mouse.sceneX
                         startPos = contentHost.splitPos
+                        splitView.beginDividerDrag(SplitViewController.SplitDivider)
                     }
 
+                    onReleased: splitView.commitDividerDrag()
+                    onCanceled: splitView.cancelDividerDrag()
+
                     onDoubleClicked: {
+                        splitView.cancelDividerDrag()
                         splitView.splitRatio = 0.5
                     }
 
@@ -5950,7 +6241,7 @@ ApplicationWindow {
                         const maxPos = Math.max(minPos, contentHost.width - minPos)
                         const next = startPos + Math.round(mouse.sceneX - startSceneX)
                         const clamped = Math.max(minPos, Math.min(maxPos, next))
-                        splitView.splitRatio = clamped / contentHost.width
+                        splitView.updateDividerDrag(clamped / contentHost.width)
                     }
                 }
             }
@@ -6184,6 +6475,7 @@ ApplicationWindow {
                     Layout.fillWidth: true
                     Layout.fillHeight: true
 
+                    onUserCssRequested: (url) => root.pushModsCss(webPanelWeb, url)
                     Component.onCompleted: {
                         root.pushModsCss(webPanelWeb)
                         if (root.webPanelUrl && root.webPanelUrl.toString().length > 0 && root.webPanelUrl.toString() !== "about:blank") {
@@ -6417,8 +6709,8 @@ ApplicationWindow {
     Connections {
         target: root.modsModel
 
-        function onCombinedCssChanged() {
-            root.pushModsCss(null)
+        function onStylesChanged(hosts, allHosts) {
+            root.pushModsCssForHosts(hosts, allHosts)
         }
     }
 
@@ -6469,17 +6761,17 @@ ApplicationWindow {
 
     Connections {
         target: commands
+        enabled: windowId === windows.activeWindowId
 
-        function onCommandInvoked(id, args) {
-            if (id === "focus-address") {
+        readonly property var handlers: ({
+            "focus-address": function(args) {
                 const field = root.activeAddressField()
                 if (field) {
                     field.forceActiveFocus()
                     field.selectAll()
                 }
-                return
-            }
-            if (id === "nav-back") {
+            },
+            "nav-back": function(args) {
                 const view = root.focusedView
                 const tabId = root.focusedTabId
                 if (!view) {
@@ -6494,90 +6786,73 @@ ApplicationWindow {
                     return
                 }
                 view.goBack()
-                return
-            }
-            if (id === "nav-forward") {
+            },
+            "nav-forward": function(args) {
                 if (root.focusedView) {
                     root.focusedView.goForward()
                 }
-                return
-            }
-            if (id === "nav-reload") {
+            },
+            "nav-reload": function(args) {
                 if (root.focusedView) {
                     root.focusedView.reload()
                 }
-                return
-            }
-            if (id === "nav-stop") {
+            },
+            "nav-stop": function(args) {
                 if (root.focusedView) {
                     root.focusedView.stop()
                 }
-                return
-            }
-            if (id === "navigate") {
+            },
+            "navigate": function(args) {
                 if (root.focusedView) {
                     root.focusedView.navigate(args.url)
                 }
-                return
-            }
-            if (id === "zoom-in") {
+            },
+            "zoom-in": function(args) {
                 if (root.focusedView) {
                     root.focusedView.zoomIn()
                 }
-                return
-            }
-            if (id === "zoom-out") {
+            },
+            "zoom-out": function(args) {
                 if (root.focusedView) {
                     root.focusedView.zoomOut()
                 }
-                return
-            }
-            if (id === "zoom-reset") {
+            },
+            "zoom-reset": function(args) {
                 if (root.focusedView) {
                     root.focusedView.zoomReset()
                 }
-                return
-            }
-            if (id === "open-file") {
+            },
+            "open-file": function(args) {
                 openFileDialog.open()
-                return
-            }
-            if (id === "toggle-fullscreen") {
+            },
+            "toggle-fullscreen": function(args) {
                 root.toggleFullscreen()
-                return
-            }
-            if (id === "view-source") {
+            },
+            "view-source": function(args) {
                 const tabId = args && args.tabId !== undefined ? Number(args.tabId) : root.focusedTabId
                 root.openViewSourceForTab(tabId)
-                return
-            }
-            if (id === "open-devtools") {
+            },
+            "open-devtools": function(args) {
                 if (root.focusedView) {
                     root.focusedView.openDevTools()
                 }
-                return
-            }
-            if (id === "open-settings") {
+            },
+            "open-settings": function(args) {
                 root.openOverlay(settingsDialogComponent, "settings")
-                return
-            }
-            if (id === "open-downloads") {
+            },
+            "open-downloads": function(args) {
                 root.toggleTopBarPopup("downloads-panel", downloadsPanelComponent, downloadsButton)
-                return
-            }
-            if (id === "open-bookmarks") {
+            },
+            "open-bookmarks": function(args) {
                 root.openOverlay(bookmarksPanelComponent, "bookmarks")
-                return
-            }
-            if (id === "open-history") {
+            },
+            "open-history": function(args) {
                 root.openOverlay(historyPanelComponent, "history")
-                return
-            }
-            if (id === "open-permissions") {
+            },
+            "open-permissions": function(args) {
                 root.openOverlay(permissionsCenterComponent, "permissions")
-                return
-            }
-            if (id === "open-find") {
+            },
+            "open-find": function(args) {
                 if (root.toolWindowManagerContext === "find-bar" && toolWindowManager.opened && toolWindowManager.popupItem) {
                     if (toolWindowManager.popupItem.focusQuery) {
                         toolWindowManager.popupItem.focusQuery()
@@ -6589,41 +6864,32 @@ ApplicationWindow {
                 const expectsExpandedTopBar = browser.settings.addressBarVisible && !root.singleToolbarActive()
                 const y = Math.round((expectsExpandedTopBar ? topBar.expandedHeight : topBar.height) + 12)
                 toolWindowManager.openAtPoint(findBarComponent, x, y, root)
-                return
-            }
-            if (id === "open-tab-switcher") {
+            },
+            "open-tab-switcher": function(args) {
                 root.toggleTabSwitcherPopup()
-                return
-            }
-            if (id === "open-print") {
+            },
+            "open-print": function(args) {
                 root.openOverlay(printDialogComponent, "print")
-                return
-            }
-            if (id === "open-mods") {
+            },
+            "open-mods": function(args) {
                 root.openOverlay(modsDialogComponent, "mods")
-                return
-            }
-            if (id === "open-themes") {
+            },
+            "open-themes": function(args) {
                 root.openOverlay(themesDialogComponent, "themes")
-                return
-            }
-            if (id === "open-clear-data") {
+            },
+            "open-clear-data": function(args) {
                 root.openOverlay(clearDataDialogComponent, "clear-data")
-                return
-            }
-            if (id === "open-extensions") {
+            },
+            "open-extensions": function(args) {
                 root.openOverlay(extensionsDialogComponent, "extensions")
-                return
-            }
-            if (id === "open-welcome") {
+            },
+            "open-welcome": function(args) {
                 root.openOverlay(onboardingDialogComponent, "onboarding")
-                return
-            }
-            if (id === "open-diagnostics") {
+            },
+            "open-diagnostics": function(args) {
                 root.openOverlay(diagnosticsDialogComponent, "diagnostics")
-                return
-            }
-            if (id === "open-latest-download-file") {
+            },
+            "open-latest-download-file": function(args) {
                 const path = downloads && downloads.latestFinishedFilePath ? downloads.latestFinishedFilePath() : ""
                 if (path && String(path).length > 0) {
                     const ok = nativeUtils.openPath(path)
@@ -6634,9 +6900,8 @@ ApplicationWindow {
                 } else {
                     toast.showToast("No finished downloads")
                 }
-                return
-            }
-            if (id === "open-latest-download-folder") {
+            },
+            "open-latest-download-folder": function(args) {
                 const folder = downloads && downloads.latestFinishedFolderPath ? downloads.latestFinishedFolderPath() : ""
                 if (folder && String(folder).length > 0) {
                     const ok = nativeUtils.openFolder(folder)
@@ -6647,52 +6912,51 @@ ApplicationWindow {
                 } else {
                     toast.showToast("No finished downloads")
                 }
-                return
-            }
-            if (id === "retry-last-download") {
+            },
+            "retry-last-download": function(args) {
                 const url = root.lastFailedDownloadUri ? String(root.lastFailedDownloadUri) : ""
                 if (url.trim().length > 0) {
                     browser.newTab(url)
                 } else {
                     root.toggleTopBarPopup("downloads-panel", downloadsPanelComponent, downloadsButton)
                 }
-                return
-            }
-            if (id === "focus-split-primary") {
+            },
+            "focus-split-primary": function(args) {
                 if (splitView.enabled) {
                     splitView.focusedPane = 0
                 }
-                return
-            }
-            if (id === "focus-split-secondary") {
+            },
+            "focus-split-secondary": function(args) {
                 if (splitView.enabled) {
                     splitView.focusedPane = 1
                 }
-                return
-            }
-            if (id === "split-swap") {
+            },
+            "split-swap": function(args) {
                 if (splitView.enabled) {
                     splitView.swapPanes()
                 }
-                return
-            }
-            if (id === "split-close-pane") {
+            },
+            "split-close-pane": function(args) {
                 if (splitView.enabled) {
                     splitView.closeFocusedPane()
                 }
-                return
-            }
-            if (id === "split-focus-next") {
+            },
+            "split-focus-next": function(args) {
                 if (splitView.enabled) {
                     splitView.focusNextPane()
                 }
-                return
-            }
-            if (id === "theme-update") {
+            },
+            "theme-update": function(args) {
                 if (args && args.themeId) {
                     themes.updateTheme(args.themeId)
                 }
-                return
+            },
+        })
+
+        function onCommandInvoked(id, args) {
+            const handler = handlers[id]
+            if (handler) {
+                handler(args || {})
             }
         }
     }
@@ -6712,9 +6976,7 @@ ApplicationWindow {
 
         ClearDataDialog {
             view: root.focusedView
-            history: root.historyModel
-            downloads: root.downloadsModel
-            sitePermissions: sitePermissions
+            cleaner: browsingDataCleaner
             onCloseRequested: overlayHost.hide()
         }
     }
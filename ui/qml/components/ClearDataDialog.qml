@@ -2,18 +2,19 @@ import QtQuick
 import QtQuick.Controls
 import QtQuick.Layouts
 
+import XBrowser 1.0
+
 Item {
     id: root
     anchors.fill: parent
 
     required property var view
-    required property var history
-    required property var downloads
-    required property var sitePermissions
+    required property var cleaner
 
     signal closeRequested()
 
-    property bool clearing: false
+    readonly property bool clearing: cleaner ? cleaner.running : false
+    property bool started: false
     property int timeRangeIndex: 3 // 0=1h, 1=24h, 2=7d, 3=all
 
     property bool clearHistory: true
@@ -22,8 +23,6 @@ Item {
     property bool clearDownloads: false
     property bool clearPermissions: false
 
-    property int pendingWebKinds: 0
-
     readonly property bool hasSelection: clearHistory || clearCookies || clearCache || clearDownloads || clearPermissions
 
     function timeRangeMs() {
@@ -48,89 +47,43 @@ Item {
         return { fromMs: Math.max(1, toMs - span), toMs: toMs }
     }
 
-    function computeWebKinds() {
+    function computeKinds() {
         let kinds = 0
         if (clearHistory) {
-            kinds |= 0x1000 // COREWEBVIEW2_BROWSING_DATA_KINDS_BROWSING_HISTORY
+            kinds |= BrowsingDataCleaner.History
         }
         if (clearCookies) {
-            kinds |= 0x40 // COREWEBVIEW2_BROWSING_DATA_KINDS_COOKIES
+            kinds |= BrowsingDataCleaner.Cookies
         }
         if (clearCache) {
-            kinds |= 0x100 // COREWEBVIEW2_BROWSING_DATA_KINDS_DISK_CACHE
+            kinds |= BrowsingDataCleaner.Cache
         }
         if (clearDownloads) {
-            kinds |= 0x200 // COREWEBVIEW2_BROWSING_DATA_KINDS_DOWNLOAD_HISTORY
+            kinds |= BrowsingDataCleaner.Downloads
+        }
+        if (clearPermissions) {
+            kinds |= BrowsingDataCleaner.SitePermissions
         }
         return kinds
     }
 
     function clearNow() {
-        if (clearing || !hasSelection) {
+        if (clearing || !hasSelection || !cleaner) {
             return
         }
 
-        clearing = true
         const range = computeRange()
-        const fromMs = range.fromMs
-        const toMs = range.toMs
-
-        if (history) {
-            if (clearHistory) {
-                if (fromMs > 0 && toMs > fromMs && history.clearRange) {
-                    history.clearRange(fromMs, toMs)
-                } else if (history.clearAll) {
-                    history.clearAll()
-                }
-            }
-        }
-
-        if (downloads) {
-            if (clearDownloads) {
-                if (fromMs > 0 && toMs > fromMs && downloads.clearRange) {
-                    downloads.clearRange(fromMs, toMs)
-                } else if (downloads.clearAll) {
-                    downloads.clearAll()
-                } else if (downloads.clearFinished) {
-                    downloads.clearFinished()
-                }
-            }
-        }
-
-        if (sitePermissions && clearPermissions && sitePermissions.clearAll) {
-            sitePermissions.clearAll()
-        }
-
-        const kinds = computeWebKinds()
-        pendingWebKinds = kinds
-        if (kinds === 0) {
-            clearing = false
-            toast.showToast("Cleared browsing data")
-            root.closeRequested()
-            return
-        }
-
-        if (!view || !view.clearBrowsingData) {
-            clearing = false
-            toast.showToast("Web engine unavailable (could not clear cookies/cache)")
-            root.closeRequested()
-            return
-        }
-
-        view.clearBrowsingData(kinds, fromMs, toMs)
+        cleaner.view = view
+        started = cleaner.clear(computeKinds(), range.fromMs, range.toMs)
     }
 
     Connections {
-        target: root.view
-        function onBrowsingDataCleared(dataKinds, success, error) {
-            if (!root.clearing) {
-                return
-            }
-            if (dataKinds !== root.pendingWebKinds) {
+        target: root.cleaner
+        function onFinished(success, error) {
+            if (!root.started) {
                 return
             }
-
-            root.clearing = false
+            root.started = false
 
             if (success) {
                 toast.showToast("Cleared browsing data")
@@ -210,16 +163,17 @@ Item {
                         Layout.fillWidth: true
                         spacing: theme.spacing
 
-                        BusyIndicator {
-                            running: root.clearing
+                        ProgressBar {
+                            Layout.fillWidth: true
+                            from: 0
+                            to: 1
+                            value: root.cleaner ? root.cleaner.progress : 0
                             visible: root.clearing
                         }
 
                         Label {
-                            Layout.fillWidth: true
-                            text: root.clearing ? "Clearing…" : ""
+                            text: root.clearing ? "Clearing… " + Math.round(root.cleaner.progress * 100) + "%" : ""
                             opacity: 0.75
-                            elide: Text.ElideRight
                         }
                     }
                 }
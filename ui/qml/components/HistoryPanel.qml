@@ -31,6 +31,7 @@ Item {
         id: filtered
         sourceHistory: root.history
         searchText: root.searchText
+        textIndex: historyText
     }
 
     function isSelected(historyId) {
@@ -246,6 +247,8 @@ Item {
                         required property string title
                         required property url url
                         required property double visitedMs
+                        required property double firstVisitedMs
+                        required property int visitCount
                         required property int historyId
 
                         width: ListView.view.width
@@ -278,7 +281,16 @@ Item {
                             }
 
                             Label {
-                                text: visitedMs > 0 ? Qt.formatDateTime(new Date(visitedMs), "hh:mm") : ""
+                                text: {
+                                    if (visitedMs <= 0) {
+                                        return ""
+                                    }
+                                    const last = Qt.formatDateTime(new Date(visitedMs), "hh:mm")
+                                    if (visitCount <= 1) {
+                                        return last
+                                    }
+                                    return Qt.formatDateTime(new Date(firstVisitedMs), "hh:mm") + "-" + last + " (" + visitCount + " visits)"
+                                }
                                 opacity: 0.6
                                 font.pixelSize: 11
                             }
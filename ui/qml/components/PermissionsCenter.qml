@@ -328,7 +328,7 @@ Item {
                                     enabled: root.store
                                     onClicked: {
                                         if (root.store) {
-                                            root.store.clearOrigin(root.selectedOrigin)
+                                            root.store.clearSite(root.selectedOrigin)
                                             root.selectedOrigin = ""
                                             root.refreshOrigins()
                                         }
@@ -88,6 +88,19 @@ Item {
         }
     }
 
+    Platform.FileDialog {
+        id: importHistoryDialog
+        title: "Import History"
+        fileMode: Platform.FileDialog.OpenFile
+        nameFilters: ["Browser history (History places.sqlite)", "All files (*)"]
+        onAccepted: {
+            const path = root.dialogPath(importHistoryDialog.file)
+            if (path.length > 0 && historyImporter.importFile(path)) {
+                toast.showToast("Importing history")
+            }
+        }
+    }
+
     Platform.FileDialog {
         id: exportBookmarksDialog
         title: "Export Bookmarks"
@@ -284,6 +297,18 @@ Item {
                                 }
                             }
 
+                            RowLayout {
+                                Layout.fillWidth: true
+                                spacing: theme.spacing
+
+                                CheckBox {
+                                    Layout.fillWidth: true
+                                    text: "Accelerate downloads (parallel connections, resumable after restart)"
+                                    checked: root.settings ? root.settings.acceleratedDownloads : false
+                                    onToggled: if (root.settings) root.settings.acceleratedDownloads = checked
+                                }
+                            }
+
                             RowLayout {
                                 Layout.fillWidth: true
                                 spacing: theme.spacing
@@ -480,6 +505,87 @@ Item {
 
                                 Item { Layout.fillWidth: true }
                             }
+
+                            RowLayout {
+                                Layout.fillWidth: true
+                                spacing: theme.spacing
+
+                                Label {
+                                    Layout.fillWidth: true
+                                    text: "Keep every visit for"
+                                    opacity: 0.85
+                                }
+
+                                SpinBox {
+                                    from: 0
+                                    to: 3650
+                                    editable: true
+                                    value: root.settings ? root.settings.historyDetailDays : 90
+                                    onValueModified: if (root.settings) root.settings.historyDetailDays = value
+                                }
+
+                                Label { text: "days"; opacity: 0.75 }
+                            }
+
+                            RowLayout {
+                                Layout.fillWidth: true
+                                spacing: theme.spacing
+
+                                Label {
+                                    Layout.fillWidth: true
+                                    text: "Keep daily summaries for"
+                                    opacity: 0.85
+                                }
+
+                                SpinBox {
+                                    from: 0
+                                    to: 3650
+                                    editable: true
+                                    value: root.settings ? root.settings.historyRetentionDays : 730
+                                    onValueModified: if (root.settings) root.settings.historyRetentionDays = value
+                                }
+
+                                Label { text: "days"; opacity: 0.75 }
+                            }
+
+                            Label {
+                                Layout.fillWidth: true
+                                text: "Older visits are merged into one entry per page and day. 0 keeps history forever."
+                                wrapMode: Text.Wrap
+                                opacity: 0.7
+                            }
+
+                            Label {
+                                Layout.fillWidth: true
+                                text: "Import history from Chrome, Edge or Firefox. Pick the browser's History or places.sqlite file from its profile folder."
+                                wrapMode: Text.Wrap
+                                opacity: 0.8
+                            }
+
+                            RowLayout {
+                                Layout.fillWidth: true
+                                spacing: theme.spacing
+
+                                Button {
+                                    text: historyImporter.running ? "Importing..." : "Import history"
+                                    enabled: !historyImporter.running
+                                    onClicked: importHistoryDialog.open()
+                                }
+
+                                Button {
+                                    visible: historyImporter.running
+                                    text: "Cancel"
+                                    onClicked: historyImporter.cancel()
+                                }
+
+                                Label {
+                                    visible: historyImporter.running
+                                    text: historyImporter.imported + " visits"
+                                    opacity: 0.7
+                                }
+
+                                Item { Layout.fillWidth: true }
+                            }
                         }
                     }
 
@@ -9,6 +9,7 @@ Rectangle {
 
     property int cornerRadius: 10
     property int spacing: 8
+    property bool allSites: false
 
     required property var view
     required property url pageUrl
@@ -24,10 +25,16 @@ Rectangle {
     implicitWidth: 420
     implicitHeight: Math.min(520, column.implicitHeight + root.spacing * 2)
 
-    WebView2CookieModel {
-        id: cookies
+    WebView2CookieSource {
+        id: cookieSource
         view: root.view
-        url: root.pageUrl
+        onViewChanged: cookies.refresh()
+    }
+
+    CookieModel {
+        id: cookies
+        source: cookieSource
+        url: root.allSites ? "" : root.pageUrl
     }
 
     ColumnLayout {
@@ -77,15 +84,29 @@ Rectangle {
                 onClicked: cookies.refresh()
             }
 
+            Switch {
+                text: "All sites"
+                checked: root.allSites
+                onToggled: root.allSites = checked
+            }
+
             Item { Layout.fillWidth: true }
 
             Button {
-                text: "Clear cookies"
-                enabled: !cookies.loading && cookies.count > 0
+                text: cookies.filterText.length > 0 ? "Clear matching" : "Clear cookies"
+                enabled: !cookies.loading && cookies.matchCount > 0
                 onClicked: cookies.clearAll()
             }
         }
 
+        TextField {
+            Layout.fillWidth: true
+            placeholderText: "Search cookies"
+            selectByMouse: true
+            visible: cookies.count > 0
+            onTextChanged: cookies.filterText = text
+        }
+
         Label {
             Layout.fillWidth: true
             text: cookies.lastError
@@ -102,9 +123,9 @@ Rectangle {
 
         Label {
             Layout.fillWidth: true
-            text: "No cookies found."
+            text: cookies.count > 0 ? "No matching cookies." : "No cookies found."
             opacity: 0.65
-            visible: !cookies.loading && (!cookies.lastError || cookies.lastError.trim().length === 0) && cookies.count === 0
+            visible: !cookies.loading && (!cookies.lastError || cookies.lastError.trim().length === 0) && cookies.matchCount === 0
         }
 
         ListView {
@@ -119,39 +140,76 @@ Rectangle {
             ScrollBar.vertical: ScrollBar { policy: ScrollBar.AsNeeded }
 
             delegate: Rectangle {
+                id: row
+
+                required property int index
+                required property bool isSite
+                required property string site
+                required property int cookieCount
+                required property bool expanded
+                required property string name
+                required property string domain
+                required property string path
+                required property double expiresMs
+                required property bool httpOnly
+                required property bool secure
+                required property bool session
+
                 width: ListView.view.width
+                implicitHeight: content.implicitHeight + 20
                 radius: 8
-                color: Qt.rgba(0, 0, 0, 0.03)
+                color: row.isSite ? Qt.rgba(0, 0, 0, 0.03) : "transparent"
                 border.color: Qt.rgba(0, 0, 0, 0.06)
-                border.width: 1
+                border.width: row.isSite ? 1 : 0
+
+                MouseArea {
+                    anchors.fill: parent
+                    enabled: row.isSite
+                    onClicked: cookies.toggleExpanded(row.index)
+                }
 
                 ColumnLayout {
+                    id: content
                     anchors.fill: parent
                     anchors.margins: 10
+                    anchors.leftMargin: row.isSite ? 10 : 26
                     spacing: 6
 
                     RowLayout {
                         Layout.fillWidth: true
                         spacing: 8
 
+                        Label {
+                            text: row.expanded ? "\u25BE" : "\u25B8"
+                            visible: row.isSite
+                            opacity: 0.65
+                        }
+
                         Label {
                             Layout.fillWidth: true
-                            text: name
+                            text: row.isSite ? row.site : row.name
                             font.bold: true
                             elide: Text.ElideRight
                         }
 
+                        Label {
+                            text: row.cookieCount === 1 ? "1 cookie" : row.cookieCount + " cookies"
+                            visible: row.isSite
+                            opacity: 0.65
+                        }
+
                         ToolButton {
                             text: "Delete"
-                            onClicked: cookies.deleteAt(index)
+                            onClicked: cookies.deleteAt(row.index)
                         }
                     }
 
                     Label {
                         Layout.fillWidth: true
-                        text: domain + path
+                        text: row.domain + row.path
                         opacity: 0.75
                         wrapMode: Text.Wrap
+                        visible: !row.isSite
                     }
 
                     Label {
@@ -160,13 +218,13 @@ Rectangle {
                         wrapMode: Text.Wrap
                         text: {
                             const tags = []
-                            if (secure) tags.push("Secure")
-                            if (httpOnly) tags.push("HttpOnly")
-                            if (session) tags.push("Session")
-                            if (!session && expiresMs > 0) tags.push("Expires: " + (new Date(expiresMs)).toLocaleString())
+                            if (row.secure) tags.push("Secure")
+                            if (row.httpOnly) tags.push("HttpOnly")
+                            if (row.session) tags.push("Session")
+                            if (!row.session && row.expiresMs > 0) tags.push("Expires: " + (new Date(row.expiresMs)).toLocaleString())
                             return tags.join(" · ")
                         }
-                        visible: secure || httpOnly || session || expiresMs > 0
+                        visible: !row.isSite && (row.secure || row.httpOnly || row.session || row.expiresMs > 0)
                     }
                 }
             }
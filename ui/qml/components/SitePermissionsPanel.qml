@@ -173,7 +173,7 @@ Rectangle {
                 enabled: root.store
                 onClicked: {
                     if (root.store) {
-                        root.store.clearOrigin(root.origin)
+                        root.store.clearSite(root.origin)
                     }
                 }
             }